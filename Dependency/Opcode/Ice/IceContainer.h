@@ -12,7 +12,9 @@
 #ifndef __ICECONTAINER_H__
 #define __ICECONTAINER_H__
 
-	#define CONTAINER_STATS
+	// Stats are kept in static counters, updated without any locking: keep them disabled when containers are used by
+	// several threads, e.g. for concurrent queries.
+//	#define CONTAINER_STATS
 
 	enum FindMode
 	{
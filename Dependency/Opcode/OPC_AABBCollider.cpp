@@ -43,7 +43,7 @@ using namespace Opcode;
 //! AABB-triangle test
 #define AABB_PRIM(prim_index, flag)							\
 	/* Request vertices from the app */						\
-	VertexPointers VP;	mIMesh->GetTriangle(VP, prim_index);\
+	VertexPointers VP;	ConversionArea VC;	mIMesh->GetTriangle(VP, prim_index, VC);\
 	mLeafVerts[0] = *VP.Vertex[0];							\
 	mLeafVerts[1] = *VP.Vertex[1];							\
 	mLeafVerts[2] = *VP.Vertex[2];							\
@@ -93,7 +93,15 @@ bool AABBCollider::Collide(AABBCache& cache, const CollisionAABB& box, const Mod
 	// Init collision query
 	if(InitQuery(cache, box))	return true;
 
-	if(!model.HasLeafNodes())
+	if(model.IsWide())
+	{
+		const AABBWideTree* Tree = (const AABBWideTree*)model.GetTree();
+
+		// Perform collision query
+		if(SkipPrimitiveTests())	_CollideNoPrimitiveTest(Tree);
+		else						_Collide(Tree);
+	}
+	else if(!model.HasLeafNodes())
 	{
 		if(model.IsQuantized())
 		{
@@ -552,6 +560,65 @@ void AABBCollider::_Collide(const AABBTreeNode* node)
 
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Stack-based collision queries for 4-wide trees, with or without primitive tests.
+ *	\param		tree	[in] wide tree
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! Stack-based collision query for wide trees
+#define IMPLEMENT_WIDE_COLLIDE(function, leaf_code)								\
+void AABBCollider::function(const AABBWideTree* tree)							\
+{																				\
+	const AABBWideNode* Nodes = tree->GetNodes();								\
+	const udword* Indices = tree->GetIndices();									\
+																				\
+	udword Stack[WIDE_STACK_SIZE];												\
+	udword NbEntries = 0;														\
+	Stack[NbEntries++] = 0;														\
+	while(NbEntries)															\
+	{																			\
+		const AABBWideNode& Node = Nodes[Stack[--NbEntries]];					\
+		for(udword i=0;i<WIDE_TREE_WIDTH;i++)									\
+		{																		\
+			/* Empty slots are always last */									\
+			if(Node.IsEmpty(i))	break;											\
+																				\
+			/* Dequantize box & perform AABB-AABB overlap test */				\
+			Point Center, Extents;												\
+			Node.GetChildBox(i, Center, Extents);								\
+			if(!AABBAABBOverlap(Extents, Center))	continue;					\
+																				\
+			/* The whole child is inside the query box */						\
+			if(AABBContainsBox(Center, Extents))								\
+			{																	\
+				mFlags |= OPC_CONTACT;											\
+				_Dump(tree, &Node, i);											\
+			}																	\
+			else if(Node.IsLeaf(i))												\
+			{																	\
+				const udword* Prims = Indices + Node.GetFirstPrimitive(i);		\
+				udword Nb = Node.GetNbPrimitives(i);							\
+				while(Nb--)														\
+				{																\
+					const udword PrimIndex = *Prims++;							\
+					leaf_code(PrimIndex, OPC_CONTACT)							\
+					if(ContactFound()) return;									\
+				}																\
+			}																	\
+			else																\
+			{																	\
+				ASSERT(NbEntries<WIDE_STACK_SIZE);								\
+				Stack[NbEntries++] = Node.GetChild(i);							\
+			}																	\
+			if(ContactFound()) return;											\
+		}																		\
+	}																			\
+}
+
+IMPLEMENT_WIDE_COLLIDE(_Collide, AABB_PRIM)
+IMPLEMENT_WIDE_COLLIDE(_CollideNoPrimitiveTest, SET_CONTACT)
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Constructor.
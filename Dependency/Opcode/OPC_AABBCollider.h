@@ -70,10 +70,12 @@
 							void			_Collide(const AABBQuantizedNode* node);
 							void			_Collide(const AABBQuantizedNoLeafNode* node);
 							void			_Collide(const AABBTreeNode* node);
+							void			_Collide(const AABBWideTree* tree);
 							void			_CollideNoPrimitiveTest(const AABBCollisionNode* node);
 							void			_CollideNoPrimitiveTest(const AABBNoLeafNode* node);
 							void			_CollideNoPrimitiveTest(const AABBQuantizedNode* node);
 							void			_CollideNoPrimitiveTest(const AABBQuantizedNoLeafNode* node);
+							void			_CollideNoPrimitiveTest(const AABBWideTree* tree);
 			// Overlap tests
 		inline_				BOOL			AABBContainsBox(const Point& bc, const Point& be);
 		inline_				BOOL			AABBAABBOverlap(const Point& b, const Point& Pb);
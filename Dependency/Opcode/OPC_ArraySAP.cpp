@@ -0,0 +1,649 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains an array-based sweep-and-prune, for large sets of moving boxes.
+ *	\file		OPC_ArraySAP.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	An array-based sweep-and-prune.
+ *
+ *	SweepAndPrune keeps sorted linked lists of end points, and updates them one object at a time. That's good when few
+ *	objects move, but with thousands of moving objects, walking the lists & maintaining the pair pool costs more than
+ *	starting again from scratch. This class does just that, as fast as possible:
+ *	- boxes are updated in batches,
+ *	- each frame the boxes are sorted along the sweep axis with a radix sort. The previous order is kept, and reused
+ *	as-is when it's still valid (e.g. nothing moved along the sweep axis),
+ *	- sorted boxes are stored as structure-of-arrays,
+ *	- the sweep tests one box against 4 following boxes at a time, with SSE2,
+ *	- pairs are written to a flat array, and the arrays of two consecutive frames are compared to find created &
+ *	deleted pairs.
+ *
+ *	Large sets of boxes are sorted & swept in parallel, using RunParallel().
+ *
+ *	\class		ArraySAP
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+#include <emmintrin.h>
+
+using namespace Opcode;
+
+#define ASAP_NB_SENTINELS		4		//!< Padding at the end of sorted arrays, so that the sweep can always load 4 boxes
+#define ASAP_RADIX_BITS			8		//!< Radix size, in bits
+#define ASAP_RADIX_SIZE			(1<<ASAP_RADIX_BITS)
+#define ASAP_PARALLEL_THRESHOLD	4096	//!< Sets of boxes smaller than that are processed serially
+#define ASAP_TASKS_PER_THREAD	4		//!< Number of tasks per thread, for load balancing
+
+//! Shared data for parallel tasks
+struct Opcode::ASAP_Job
+{
+	udword			mNbObjects;
+	udword			mNbTasks;
+	udword			mChunkSize;			//!< Number of sorted boxes per task
+	// Radix sort
+	const udword*	mKeysIn;
+	const udword*	mInput;
+	udword*			mKeysOut;
+	udword*			mOutput;
+	udword*			mHistograms;
+	udword			mShift;
+	// Gather
+	const udword*	mRanks;
+	const ASAP_Box*	mBoxes;
+	// Sweep
+	float*			mSortedMin[3];
+	float*			mSortedMax[3];
+	udword*			mSortedIDs;
+	Pairs*			mTaskPairs;
+};
+
+//! Masks out lanes past the last box
+static const udword gLaneMasks[4] = { 0x0, 0x1, 0x3, 0x7 };
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Converts a float to an integer sort key. Keys compare like the original floats.
+ *	\param		f		[in] float value
+ *	\return		sort key
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ udword _EncodeFloat(float f)
+{
+	const udword Bits = IR(f);
+	return Bits & 0x80000000 ? ~Bits : Bits | 0x80000000;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes the range of sorted boxes processed by a task.
+ *	\param		job			[in] job data
+ *	\param		task_index	[in] task index
+ *	\param		start		[out] first sorted box
+ *	\param		end			[out] last sorted box + 1
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ void _GetTaskRange(const ASAP_Job& job, udword task_index, udword& start, udword& end)
+{
+	start = task_index * job.mChunkSize;
+	end = start + job.mChunkSize;
+	if(start>job.mNbObjects)	start = job.mNbObjects;
+	if(end>job.mNbObjects)		end = job.mNbObjects;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Radix sort, first half of a pass: counts the digits of a task's chunk.
+ *	\param		task_index	[in] task index
+ *	\param		user_data	[in] job data
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _RadixCount(udword task_index, void* user_data)
+{
+	const ASAP_Job& Job = *(const ASAP_Job*)user_data;
+	udword Start, End;
+	_GetTaskRange(Job, task_index, Start, End);
+
+	udword* Histogram = Job.mHistograms + task_index*ASAP_RADIX_SIZE;
+	ZeroMemory(Histogram, ASAP_RADIX_SIZE*sizeof(udword));
+	for(udword i=Start;i<End;i++)	Histogram[(Job.mKeysIn[i]>>Job.mShift)&(ASAP_RADIX_SIZE-1)]++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Radix sort, second half of a pass: moves a task's chunk to its sorted location. Histograms have been turned into
+ *	offsets by then.
+ *	\param		task_index	[in] task index
+ *	\param		user_data	[in] job data
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _RadixScatter(udword task_index, void* user_data)
+{
+	const ASAP_Job& Job = *(const ASAP_Job*)user_data;
+	udword Start, End;
+	_GetTaskRange(Job, task_index, Start, End);
+
+	udword* Offsets = Job.mHistograms + task_index*ASAP_RADIX_SIZE;
+	for(udword i=Start;i<End;i++)
+	{
+		const udword Key = Job.mKeysIn[i];
+		const udword Dest = Offsets[(Key>>Job.mShift)&(ASAP_RADIX_SIZE-1)]++;
+		Job.mKeysOut[Dest]	= Key;
+		Job.mOutput[Dest]	= Job.mInput[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Copies a task's chunk of boxes to the sorted arrays.
+ *	\param		task_index	[in] task index
+ *	\param		user_data	[in] job data
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _GatherBoxes(udword task_index, void* user_data)
+{
+	const ASAP_Job& Job = *(const ASAP_Job*)user_data;
+	udword Start, End;
+	_GetTaskRange(Job, task_index, Start, End);
+
+	for(udword i=Start;i<End;i++)
+	{
+		const udword Index = Job.mRanks[i];
+		const ASAP_Box& Box = Job.mBoxes[Index];
+		Job.mSortedIDs[i]		= Index;
+		Job.mSortedMin[0][i]	= Box.mMin[0];
+		Job.mSortedMax[0][i]	= Box.mMax[0];
+		Job.mSortedMin[1][i]	= Box.mMin[1];
+		Job.mSortedMax[1][i]	= Box.mMax[1];
+		Job.mSortedMin[2][i]	= Box.mMin[2];
+		Job.mSortedMax[2][i]	= Box.mMax[2];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Sweeps a task's chunk of sorted boxes. Each box is tested against the following boxes, 4 at a time, until their
+ *	min on the sweep axis goes past the box's max.
+ *	\param		task_index	[in] task index
+ *	\param		user_data	[in] job data
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _SweepBoxes(udword task_index, void* user_data)
+{
+	const ASAP_Job& Job = *(const ASAP_Job*)user_data;
+	udword Start, End;
+	_GetTaskRange(Job, task_index, Start, End);
+
+	Pairs& TaskPairs = Job.mTaskPairs[task_index];
+	TaskPairs.ResetPairs();
+
+	const udword Nb = Job.mNbObjects;
+	const float* Min0 = Job.mSortedMin[0];	const float* Max0 = Job.mSortedMax[0];
+	const float* Min1 = Job.mSortedMin[1];	const float* Max1 = Job.mSortedMax[1];
+	const float* Min2 = Job.mSortedMin[2];	const float* Max2 = Job.mSortedMax[2];
+	const udword* IDs = Job.mSortedIDs;
+
+	for(udword i=Start;i<End;i++)
+	{
+		const __m128 BoxMax0 = _mm_set1_ps(Max0[i]);
+		const __m128 BoxMin1 = _mm_set1_ps(Min1[i]);	const __m128 BoxMax1 = _mm_set1_ps(Max1[i]);
+		const __m128 BoxMin2 = _mm_set1_ps(Min2[i]);	const __m128 BoxMax2 = _mm_set1_ps(Max2[i]);
+		const udword ID0 = IDs[i];
+
+		udword j = i+1;
+		while(j<Nb)
+		{
+			// Boxes are sorted, so the lanes overlapping on the sweep axis always come first
+			udword Active = _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(Min0+j), BoxMax0));
+			if(Nb-j<4)	Active &= gLaneMasks[Nb-j];
+			if(!Active)	break;
+
+			const __m128 Overlap1 = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(Min1+j), BoxMax1), _mm_cmple_ps(BoxMin1, _mm_loadu_ps(Max1+j)));
+			const __m128 Overlap2 = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(Min2+j), BoxMax2), _mm_cmple_ps(BoxMin2, _mm_loadu_ps(Max2+j)));
+			const udword Mask = _mm_movemask_ps(_mm_and_ps(Overlap1, Overlap2)) & Active;
+			if(Mask)
+			{
+				for(udword k=0;k<4;k++)
+				{
+					if(!(Mask & (1<<k)))	continue;
+					const udword ID1 = IDs[j+k];
+					if(ID0<ID1)	TaskPairs.AddPair(ID0, ID1);
+					else		TaskPairs.AddPair(ID1, ID0);
+				}
+			}
+			if(Active!=0xf)	break;
+			j+=4;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ArraySAP::ArraySAP() :
+	mNbObjects		(0),
+	mBoxes			(null),
+	mSortedMemory	(null),
+	mSortedIDs		(null),
+	mKeys			(null),
+	mKeys2			(null),
+	mRanks			(null),
+	mRanks2			(null),
+	mHistograms		(null),
+	mCurrent		(0),
+	mPairOffsets	(null),
+	mNbThreads		(0),
+	mDirty			(false)
+{
+	for(udword i=0;i<3;i++)
+	{
+		mSortedMin[i] = mSortedMax[i] = null;
+		mAxes[i] = i;
+	}
+	for(udword i=0;i<2;i++)
+	{
+		mPairs[i]		= null;
+		mNbPairs[i]		= 0;
+		mMaxNbPairs[i]	= 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ArraySAP::~ArraySAP()
+{
+	Release();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Releases everything.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ArraySAP::Release()
+{
+	DELETEARRAY(mPairOffsets);
+	DELETEARRAY(mPairs[1]);
+	DELETEARRAY(mPairs[0]);
+	DELETEARRAY(mHistograms);
+	DELETEARRAY(mRanks2);
+	DELETEARRAY(mRanks);
+	DELETEARRAY(mKeys2);
+	DELETEARRAY(mKeys);
+	DELETEARRAY(mSortedIDs);
+	DELETEARRAY(mSortedMemory);
+	DELETEARRAY(mBoxes);
+	for(udword i=0;i<3;i++)	mSortedMin[i] = mSortedMax[i] = null;
+	for(udword i=0;i<2;i++)
+	{
+		mNbPairs[i]		= 0;
+		mMaxNbPairs[i]	= 0;
+	}
+	for(udword i=0;i<ASAP_MAX_TASKS;i++)	mTaskPairs[i].ResetPairs();
+	mCreatedPairs.ResetPairs();
+	mDeletedPairs.ResetPairs();
+	mNbObjects	= 0;
+	mCurrent	= 0;
+	mDirty		= false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Initializes the broadphase with a set of boxes, and computes the first set of overlapping pairs.
+ *	\param		nb_objects	[in] number of objects
+ *	\param		boxes		[in] objects' boxes
+ *	\param		axes		[in] projection order. The sweep runs on the first axis.
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ArraySAP::Init(udword nb_objects, const AABB** boxes, const Axes& axes)
+{
+	// Make sure everything has been released
+	Release();
+	if(!nb_objects || !boxes)	return false;
+
+	mNbObjects	= nb_objects;
+	mAxes[0]	= axes.mAxis0;
+	mAxes[1]	= axes.mAxis1;
+	mAxes[2]	= axes.mAxis2;
+
+	// Boxes
+	mBoxes = new ASAP_Box[nb_objects];
+	CHECKALLOC(mBoxes);
+	const udword NbSorted = nb_objects + ASAP_NB_SENTINELS;
+	mSortedMemory = new float[NbSorted*6];
+	CHECKALLOC(mSortedMemory);
+	for(udword j=0;j<3;j++)
+	{
+		mSortedMin[j]	= mSortedMemory + NbSorted*(j*2);
+		mSortedMax[j]	= mSortedMemory + NbSorted*(j*2+1);
+	}
+	// Sentinels are never reported, they just need to be valid floats
+	ZeroMemory(mSortedMemory, NbSorted*6*sizeof(float));
+	for(udword i=nb_objects;i<NbSorted;i++)	mSortedMin[0][i] = MAX_FLOAT;
+
+	mSortedIDs = new udword[nb_objects];
+	CHECKALLOC(mSortedIDs);
+
+	// Radix sort
+	mKeys = new udword[nb_objects];
+	CHECKALLOC(mKeys);
+	mKeys2 = new udword[nb_objects];
+	CHECKALLOC(mKeys2);
+	mRanks = new udword[nb_objects];
+	CHECKALLOC(mRanks);
+	mRanks2 = new udword[nb_objects];
+	CHECKALLOC(mRanks2);
+	mHistograms = new udword[ASAP_MAX_TASKS*ASAP_RADIX_SIZE];
+	CHECKALLOC(mHistograms);
+	for(udword i=0;i<nb_objects;i++)	mRanks[i] = i;
+
+	// Pairs
+	mPairOffsets = new udword[nb_objects];
+	CHECKALLOC(mPairOffsets);
+
+	for(udword i=0;i<nb_objects;i++)
+	{
+		const AABB* Box = boxes[i];
+		for(udword j=0;j<3;j++)
+		{
+			mBoxes[i].mMin[j] = Box->GetMin(mAxes[j]);
+			mBoxes[i].mMax[j] = Box->GetMax(mAxes[j]);
+		}
+	}
+	mDirty = true;
+
+	return UpdatePairs();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Updates a batch of boxes. Nothing is recomputed until UpdatePairs() is called, so all the boxes that moved
+ *	during a frame should be sent at once, or in a few batches.
+ *	\param		nb			[in] number of updated boxes
+ *	\param		indices		[in] objects' indices, or null to update objects 0 to nb-1
+ *	\param		boxes		[in] new boxes, one per index
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ArraySAP::UpdateObjects(udword nb, const udword* indices, const AABB* boxes)
+{
+	// Checkings
+	if(!boxes)	return false;
+	if(!indices && nb>mNbObjects)	return false;
+
+	for(udword i=0;i<nb;i++)
+	{
+		const udword Index = indices ? indices[i] : i;
+		if(Index>=mNbObjects)	return false;
+
+		for(udword j=0;j<3;j++)
+		{
+			mBoxes[Index].mMin[j] = boxes[i].GetMin(mAxes[j]);
+			mBoxes[Index].mMax[j] = boxes[i].GetMax(mAxes[j]);
+		}
+	}
+	if(nb)	mDirty = true;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Sorts the boxes along the sweep axis. The previous order is reused if it's still valid.
+ *	\param		job		[in/out] job data
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ArraySAP::SortBoxes(ASAP_Job& job)
+{
+	const udword Nb = mNbObjects;
+	for(udword i=0;i<Nb;i++)	mKeys[i] = _EncodeFloat(mBoxes[i].mMin[0]);
+
+	// Temporal coherence: nothing to do if the previous order is still valid
+	udword i=1;
+	while(i<Nb && mKeys[mRanks[i-1]]<=mKeys[mRanks[i]])	i++;
+	if(i>=Nb)	return true;
+
+	// Else sort from scratch. Keys move along with indices, so that each pass reads its input sequentially.
+	for(i=0;i<Nb;i++)	mRanks[i] = i;
+
+	job.mHistograms	= mHistograms;
+	for(udword Shift=0;Shift<32;Shift+=ASAP_RADIX_BITS)
+	{
+		job.mShift		= Shift;
+		job.mKeysIn		= mKeys;
+		job.mInput		= mRanks;
+		job.mKeysOut	= mKeys2;
+		job.mOutput		= mRanks2;
+		RunParallel(job.mNbTasks, _RadixCount, &job, mNbThreads);
+
+		// Turn histograms into offsets, digit-major then task-major so that the sort remains stable.
+		// If all keys have the same digit, the pass is skipped.
+		udword Offset = 0;
+		bool Skip = false;
+		for(udword Digit=0;Digit<ASAP_RADIX_SIZE && !Skip;Digit++)
+		{
+			const udword DigitStart = Offset;
+			for(udword Task=0;Task<job.mNbTasks;Task++)
+			{
+				udword& Count = mHistograms[Task*ASAP_RADIX_SIZE+Digit];
+				const udword Tmp = Count;
+				Count = Offset;
+				Offset += Tmp;
+			}
+			if(Offset-DigitStart==Nb)	Skip = true;
+		}
+		if(Skip)	continue;
+
+		RunParallel(job.mNbTasks, _RadixScatter, &job, mNbThreads);
+		TSwap(mKeys, mKeys2);
+		TSwap(mRanks, mRanks2);
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Collects the pairs found by all tasks into the current pair buffer, sorted by id0 then id1.
+ *	\param		nb_tasks	[in] number of sweep tasks
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ArraySAP::SortPairs(udword nb_tasks)
+{
+	// Count pairs per id0...
+	ZeroMemory(mPairOffsets, mNbObjects*sizeof(udword));
+	udword NbPairs = 0;
+	for(udword t=0;t<nb_tasks;t++)
+	{
+		const udword Nb = mTaskPairs[t].GetNbPairs();
+		const Pair* P = mTaskPairs[t].GetPairs();
+		for(udword i=0;i<Nb;i++)	mPairOffsets[P[i].id0]++;
+		NbPairs += Nb;
+	}
+
+	// ...make sure we have enough room...
+	if(NbPairs>mMaxNbPairs[mCurrent])
+	{
+		DELETEARRAY(mPairs[mCurrent]);
+		mMaxNbPairs[mCurrent] = NbPairs + (NbPairs>>2);
+		mPairs[mCurrent] = new Pair[mMaxNbPairs[mCurrent]];
+		CHECKALLOC(mPairs[mCurrent]);
+	}
+	mNbPairs[mCurrent] = NbPairs;
+
+	// ...bucket them by id0...
+	udword Offset = 0;
+	for(udword i=0;i<mNbObjects;i++)
+	{
+		const udword Count = mPairOffsets[i];
+		mPairOffsets[i] = Offset;
+		Offset += Count;
+	}
+	Pair* Dest = mPairs[mCurrent];
+	for(udword t=0;t<nb_tasks;t++)
+	{
+		const udword Nb = mTaskPairs[t].GetNbPairs();
+		const Pair* P = mTaskPairs[t].GetPairs();
+		for(udword i=0;i<Nb;i++)	Dest[mPairOffsets[P[i].id0]++] = P[i];
+	}
+
+	// ...and sort each bucket by id1. Buckets are small, so an insertion sort does the job.
+	udword Start = 0;
+	for(udword i=0;i<mNbObjects;i++)
+	{
+		const udword End = mPairOffsets[i];
+		for(udword j=Start+1;j<End;j++)
+		{
+			const Pair Current = Dest[j];
+			udword k = j;
+			while(k>Start && Dest[k-1].id1>Current.id1)
+			{
+				Dest[k] = Dest[k-1];
+				k--;
+			}
+			Dest[k] = Current;
+		}
+		Start = End;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Compares current & previous pairs to find created & deleted pairs. Both arrays are sorted, so it's a simple merge.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ArraySAP::ComputeChanges()
+{
+	mCreatedPairs.ResetPairs();
+	mDeletedPairs.ResetPairs();
+
+	const Pair* Current = mPairs[mCurrent];
+	const Pair* Previous = mPairs[mCurrent^1];
+	const udword NbCurrent = mNbPairs[mCurrent];
+	const udword NbPrevious = mNbPairs[mCurrent^1];
+
+	udword i=0, j=0;
+	while(i<NbCurrent && j<NbPrevious)
+	{
+		const Pair& C = Current[i];
+		const Pair& P = Previous[j];
+		if(C.id0==P.id0 && C.id1==P.id1)					{ i++; j++;							}
+		else if(C.id0<P.id0 || (C.id0==P.id0 && C.id1<P.id1))	{ mCreatedPairs.AddPair(C);	i++;	}
+		else												{ mDeletedPairs.AddPair(P);	j++;	}
+	}
+	while(i<NbCurrent)	mCreatedPairs.AddPair(Current[i++]);
+	while(j<NbPrevious)	mDeletedPairs.AddPair(Previous[j++]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Recomputes the overlapping pairs after some boxes have been updated. The previous pairs are kept, and
+ *	compared to the new ones to find the pairs created & deleted since last call.
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ArraySAP::UpdatePairs()
+{
+	// Checkings
+	if(!mNbObjects)	return false;
+
+	if(!mDirty)
+	{
+		// Nothing moved => same pairs as before
+		mCreatedPairs.ResetPairs();
+		mDeletedPairs.ResetPairs();
+		return true;
+	}
+
+	// Setup tasks
+	const udword NbThreads = mNbThreads ? mNbThreads : GetNbProcessors();
+	ASAP_Job Job;
+	Job.mNbObjects	= mNbObjects;
+	Job.mNbTasks	= 1;
+	if(NbThreads>1 && mNbObjects>=ASAP_PARALLEL_THRESHOLD)
+	{
+		Job.mNbTasks = NbThreads*ASAP_TASKS_PER_THREAD;
+		if(Job.mNbTasks>ASAP_MAX_TASKS)	Job.mNbTasks = ASAP_MAX_TASKS;
+	}
+	Job.mChunkSize	= (mNbObjects + Job.mNbTasks - 1) / Job.mNbTasks;
+	Job.mTaskPairs	= mTaskPairs;
+
+	// 1) Sort boxes along the sweep axis
+	if(!SortBoxes(Job))	return false;
+
+	// 2) Gather sorted boxes
+	Job.mRanks		= mRanks;
+	Job.mBoxes		= mBoxes;
+	Job.mSortedIDs	= mSortedIDs;
+	for(udword j=0;j<3;j++)
+	{
+		Job.mSortedMin[j]	= mSortedMin[j];
+		Job.mSortedMax[j]	= mSortedMax[j];
+	}
+	RunParallel(Job.mNbTasks, _GatherBoxes, &Job, mNbThreads);
+
+	// 3) Sweep
+	RunParallel(Job.mNbTasks, _SweepBoxes, &Job, mNbThreads);
+
+	// 4) Collect pairs in the other buffer, and compare them to the previous ones
+	mCurrent ^= 1;
+	if(!SortPairs(Job.mNbTasks))	return false;
+	ComputeChanges();
+
+	mDirty = false;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets current pairs.
+ *	\param		pairs		[out] overlapping pairs
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ArraySAP::GetPairs(Pairs& pairs) const
+{
+	const udword Nb = mNbPairs[mCurrent];
+	const Pair* P = mPairs[mCurrent];
+	for(udword i=0;i<Nb;i++)	pairs.AddPair(P[i]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets current pairs through a callback.
+ *	\param		callback	[in] pair callback
+ *	\param		user_data	[in] callback's user data
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ArraySAP::GetPairs(PairCallback callback, void* user_data) const
+{
+	if(!callback)	return;
+
+	const udword Nb = mNbPairs[mCurrent];
+	const Pair* P = mPairs[mCurrent];
+	for(udword i=0;i<Nb;i++)
+	{
+		if(!(callback)(P[i].id0, P[i].id1, user_data))	return;
+	}
+}
@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains an array-based sweep-and-prune, for large sets of moving boxes.
+ *	\file		OPC_ArraySAP.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_ARRAYSAP_H__
+#define __OPC_ARRAYSAP_H__
+
+	#define ASAP_MAX_TASKS		64		//!< Max number of tasks per parallel job
+
+	//! A box, with coordinates in projection order
+	struct ASAP_Box
+	{
+		float	mMin[3];
+		float	mMax[3];
+	};
+
+	struct ASAP_Job;
+
+	class OPCODE_API ArraySAP
+	{
+		public:
+		// Constructor / Destructor
+								ArraySAP();
+								~ArraySAP();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Initializes the broadphase with a set of boxes, and computes the first set of overlapping pairs.
+		 *	\param		nb_objects	[in] number of objects
+		 *	\param		boxes		[in] objects' boxes
+		 *	\param		axes		[in] projection order. The sweep runs on the first axis.
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			Init(udword nb_objects, const AABB** boxes, const Axes& axes=Axes(AXES_XZY));
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Updates a batch of boxes. Nothing is recomputed until UpdatePairs() is called, so all the boxes that moved
+		 *	during a frame should be sent at once, or in a few batches.
+		 *	\param		nb			[in] number of updated boxes
+		 *	\param		indices		[in] objects' indices, or null to update objects 0 to nb-1
+		 *	\param		boxes		[in] new boxes, one per index
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			UpdateObjects(udword nb, const udword* indices, const AABB* boxes);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Recomputes the overlapping pairs after some boxes have been updated. The previous pairs are kept, and
+		 *	compared to the new ones to find the pairs created & deleted since last call.
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			UpdatePairs();
+
+		// Current pairs, sorted by id0 then id1, with id0<id1
+		inline_	udword			GetNbPairs()		const	{ return mNbPairs[mCurrent];	}
+		inline_	const Pair*		GetPairs()			const	{ return mPairs[mCurrent];		}
+		// Changes since previous call to UpdatePairs()
+		inline_	const Pairs&	GetCreatedPairs()	const	{ return mCreatedPairs;			}
+		inline_	const Pairs&	GetDeletedPairs()	const	{ return mDeletedPairs;			}
+		// Same as SweepAndPrune
+				void			GetPairs(Pairs& pairs)								const;
+				void			GetPairs(PairCallback callback, void* user_data)	const;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: sets the number of threads used by UpdatePairs(). Small sets of boxes are always processed serially.
+		 *	\param		nb_threads	[in] number of threads, including the caller. 0 = one per processor, 1 = serial.
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_	void			SetNbThreads(udword nb_threads)		{ mNbThreads = nb_threads;		}
+
+		inline_	udword			GetNbObjects()		const	{ return mNbObjects;			}
+
+				void			Release();
+		private:
+		// Boxes, indexed by object. Index 0 is the sweep axis.
+				udword			mNbObjects;
+				ASAP_Box*		mBoxes;
+				udword			mAxes[3];			//!< Projection order
+		// Boxes sorted along the sweep axis, as structure-of-arrays, padded with sentinels
+				float*			mSortedMemory;		//!< Allocated memory for sorted boxes
+				float*			mSortedMin[3];
+				float*			mSortedMax[3];
+				udword*			mSortedIDs;			//!< Object index for each sorted box
+		// Radix sort
+				udword*			mKeys;				//!< Sort keys
+				udword*			mKeys2;				//!< Scratch buffer
+				udword*			mRanks;				//!< Sorted object indices. Kept from one frame to the next.
+				udword*			mRanks2;			//!< Scratch buffer
+				udword*			mHistograms;		//!< Per-task histograms
+		// Pairs, double-buffered
+				Pair*			mPairs[2];
+				udword			mNbPairs[2];
+				udword			mMaxNbPairs[2];
+				udword			mCurrent;			//!< Current pair buffer
+				udword*			mPairOffsets;		//!< Scratch buffer for pair sorting, one entry per object
+				Pairs			mTaskPairs[ASAP_MAX_TASKS];
+				Pairs			mCreatedPairs;
+				Pairs			mDeletedPairs;
+		// Settings
+				udword			mNbThreads;
+				bool			mDirty;				//!< Boxes have been updated since last call to UpdatePairs()
+		// Internal methods
+				bool			SortBoxes(ASAP_Job& job);
+				bool			SortPairs(udword nb_tasks);
+				void			ComputeChanges();
+	};
+
+#endif // __OPC_ARRAYSAP_H__
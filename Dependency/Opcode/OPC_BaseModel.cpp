@@ -44,6 +44,7 @@ OPCODECREATE::OPCODECREATE()
 	mSettings.mLimit	= 1;	// Mandatory for complete trees
 	mNoLeaf				= true;
 	mQuantized			= true;
+	mWideTree			= false;
 #ifdef __MESHMERIZER_H__
 	mCollisionHull		= false;
 #endif // __MESHMERIZER_H__
@@ -56,7 +57,7 @@ OPCODECREATE::OPCODECREATE()
  *	Constructor.
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-BaseModel::BaseModel() : mIMesh(null), mModelCode(0), mSource(null), mTree(null)
+BaseModel::BaseModel() : mIMesh(null), mModelCode(0), mSource(null), mTree(null), mFile(null)
 {
 }
 
@@ -79,6 +80,8 @@ void BaseModel::ReleaseBase()
 {
 	DELETESINGLE(mSource);
 	DELETESINGLE(mTree);
+	// Must be last: the tree may live in the mapped file
+	DELETESINGLE(mFile);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -94,6 +97,8 @@ bool BaseModel::CreateTree(bool no_leaf, bool quantized)
 	DELETESINGLE(mTree);
 
 	// Setup model code
+	mModelCode &= ~OPC_WIDE;
+
 	if(no_leaf)		mModelCode |= OPC_NO_LEAF;
 	else			mModelCode &= ~OPC_NO_LEAF;
 
@@ -136,3 +141,174 @@ bool BaseModel::Refit()
 //	// Ouch...
 //	return mTree->Build(mSource);
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the collision model, only updating the parts of the tree above moved triangles. Usage is:
+ *	1. modify your mesh vertices (keep the topology constant!)
+ *	2. mark the triangles using those vertices in a bitset (see SetDirtyPrimitive())
+ *	3. refit the tree (call this method)
+ *	\param		settings	[in] refit settings: dirty triangles, threads
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BaseModel::Refit(const RefitSettings& settings)
+{
+	// Single-node models don't have a tree
+	if(!mTree)	return HasSingleNode()!=0;
+
+	return mTree->Refit(mIMesh, settings);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the size of the serialized model.
+ *	\return		size in bytes, a multiple of OPC_SAVE_ALIGNMENT
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword BaseModel::GetSaveSize() const
+{
+	udword Size = sizeof(SavedModelHeader) + GetExtraSaveSize();
+	if(mTree)	Size += mTree->GetSaveSize();
+	return Size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Serializes the model. Layout is: SavedModelHeader, tree, model-specific data. Each block is OPC_SAVE_ALIGNMENT-aligned.
+ *	\param		buffer		[out] destination buffer
+ *	\param		size		[in] size of destination buffer, must be GetSaveSize()
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BaseModel::Save(void* buffer, udword size) const
+{
+	// Checkings
+	if(!buffer || !mIMesh)		return SetIceError("BaseModel::Save: model hasn't been built!", null);
+	if(size!=GetSaveSize())		return SetIceError("BaseModel::Save: invalid buffer size!", null);
+
+	SavedModelHeader* Header = (SavedModelHeader*)buffer;
+	ZeroMemory(Header, sizeof(SavedModelHeader));
+	Header->mMagic			= OPC_MODEL_MAGIC;
+	Header->mVersion		= OPC_MODEL_VERSION;
+	Header->mModelCode		= mModelCode;
+	Header->mNbTriangles	= mIMesh->GetNbTriangles();
+	Header->mNbVertices		= mIMesh->GetNbVertices();
+	Header->mTreeSize		= mTree ? mTree->GetSaveSize() : 0;
+	Header->mExtraSize		= GetExtraSaveSize();
+
+	ubyte* Data = (ubyte*)(Header+1);
+	if(mTree && !mTree->Save(Data))	return false;
+	return SaveExtra(Data + Header->mTreeSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Serializes the model to a file.
+ *	\param		filename	[in] destination file
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BaseModel::Save(const char* filename) const
+{
+	udword Size = GetSaveSize();
+	ubyte* Buffer = new ubyte[Size];
+	CHECKALLOC(Buffer);
+
+	bool Status = Save(Buffer, Size);
+	if(Status)
+	{
+		FILE* fp = fopen(filename, "wb");
+		Status = fp && fwrite(Buffer, Size, 1, fp)==1;
+		if(fp && fclose(fp))	Status = false;
+	}
+	DELETEARRAY(Buffer);
+	if(!Status)	return SetIceError("BaseModel::Save: can't write file!", null);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Setups the model from serialized data. The data is used in place and must remain valid until the model is released.
+ *	Only the header is validated: corrupted nodes are not detected.
+ *	\param		buffer			[in] serialized data
+ *	\param		size			[in] size of serialized data
+ *	\param		mesh_interface	[in] mesh interface
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BaseModel::Load(void* buffer, udword size, const MeshInterface* mesh_interface)
+{
+	// Checkings
+	if(!buffer || !mesh_interface || size<sizeof(SavedModelHeader))	return SetIceError("BaseModel::Load: invalid data!", null);
+	if(size_t(buffer) & (sizeof(float)-1))								return SetIceError("BaseModel::Load: misaligned data!", null);
+
+	const SavedModelHeader* Header = (const SavedModelHeader*)buffer;
+	if(Header->mMagic!=OPC_MODEL_MAGIC)								return SetIceError("BaseModel::Load: not an Opcode model!", null);
+	if(Header->mVersion!=OPC_MODEL_VERSION)							return SetIceError("BaseModel::Load: unsupported version!", null);
+	if(Header->mNbTriangles!=mesh_interface->GetNbTriangles()
+	|| Header->mNbVertices!=mesh_interface->GetNbVertices())		return SetIceError("BaseModel::Load: mesh doesn't match saved model!", null);
+	if(Header->mTreeSize > size - sizeof(SavedModelHeader)
+	|| Header->mExtraSize!=size - sizeof(SavedModelHeader) - Header->mTreeSize)	return SetIceError("BaseModel::Load: invalid size!", null);
+
+	// Discard previous tree
+	ReleaseBase();
+	mModelCode = Header->mModelCode;
+
+	ubyte* Data = (ubyte*)buffer + sizeof(SavedModelHeader);
+	bool Status;
+	if(mModelCode & OPC_SINGLE_NODE)
+	{
+		// No tree for those ones
+		Status = !Header->mTreeSize;
+	}
+	else
+	{
+		if(mModelCode & OPC_WIDE)
+		{
+			mTree = new AABBWideTree;
+			CHECKALLOC(mTree);
+			Status = true;
+		}
+		else Status = CreateTree((mModelCode & OPC_NO_LEAF)!=0, (mModelCode & OPC_QUANTIZED)!=0);
+
+		if(Status)	Status = mTree->Load(Data, Header->mTreeSize);
+	}
+
+	if(Status)	Status = LoadExtra(Data + Header->mTreeSize, Header->mExtraSize);
+
+	if(!Status)
+	{
+		ReleaseBase();
+		LoadExtra(null, 0);	// Drop model-specific data pointing to the buffer
+		mModelCode = 0;
+		return SetIceError("BaseModel::Load: invalid data!", null);
+	}
+
+	SetMeshInterface(mesh_interface);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Setups the model from a file. The file is memory-mapped and used in place.
+ *	\param		filename		[in] saved model
+ *	\param		mesh_interface	[in] mesh interface
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BaseModel::Load(const char* filename, const MeshInterface* mesh_interface)
+{
+	MappedFile* File = new MappedFile;
+	CHECKALLOC(File);
+
+	if(!File->Open(filename) || !Load(File->GetData(), File->GetSize(), mesh_interface))
+	{
+		DELETESINGLE(File);
+		return false;
+	}
+
+	// Keep the file mapped as long as the model uses it
+	mFile = File;
+	return true;
+}
@@ -30,6 +30,8 @@
 		BuildSettings			mSettings;		//!< Builder's settings
 		bool					mNoLeaf;		//!< true => discard leaf nodes (else use a normal tree)
 		bool					mQuantized;		//!< true => quantize the tree (else use a normal tree)
+		bool					mWideTree;		//!< true => build a 4-wide SAH tree (mSettings, mNoLeaf & mQuantized are ignored)
+		WideBuildSettings		mWideSettings;	//!< Wide tree builder's settings
 #ifdef __MESHMERIZER_H__
 		bool					mCollisionHull;	//!< true => use convex hull + GJK
 #endif // __MESHMERIZER_H__
@@ -44,9 +46,28 @@
 	{
 		OPC_QUANTIZED	= (1<<0),	//!< Compressed/uncompressed tree
 		OPC_NO_LEAF		= (1<<1),	//!< Leaf/NoLeaf tree
-		OPC_SINGLE_NODE	= (1<<2)	//!< Special case for 1-node models
+		OPC_SINGLE_NODE	= (1<<2),	//!< Special case for 1-node models
+		OPC_WIDE		= (1<<3)	//!< 4-wide tree
 	};
 
+	#define OPC_MODEL_MAGIC		0x4D43504F	//!< "OPCM"
+	#define OPC_MODEL_VERSION	1			//!< Bump each time the layout of nodes or saved data changes
+
+	//! Header of a serialized model. It's followed by the serialized tree, then by model-specific data.
+	struct OPCODE_API SavedModelHeader
+	{
+		udword				mMagic;			//!< OPC_MODEL_MAGIC
+		udword				mVersion;		//!< OPC_MODEL_VERSION
+		udword				mModelCode;		//!< Model code = combination of ModelFlag(s)
+		udword				mNbTriangles;	//!< Number of triangles in the mesh, checked on load
+		udword				mNbVertices;	//!< Number of vertices in the mesh, checked on load
+		udword				mTreeSize;		//!< Size of serialized tree
+		udword				mExtraSize;		//!< Size of model-specific data
+		udword				mPad[9];
+	};
+
+	ICE_COMPILE_TIME_ASSERT(sizeof(SavedModelHeader)==OPC_SAVE_ALIGNMENT);
+
 	class OPCODE_API BaseModel
 	{
 		public:
@@ -81,6 +102,18 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		virtual			bool				Refit();
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Refits the collision model, only updating the parts of the tree above moved triangles. Usage is:
+		 *	1. modify your mesh vertices (keep the topology constant!)
+		 *	2. mark the triangles using those vertices in a bitset (see SetDirtyPrimitive())
+		 *	3. refit the tree (call this method)
+		 *	\param		settings	[in] refit settings: dirty triangles, threads
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		virtual			bool				Refit(const RefitSettings& settings);
+
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
 		 *	Gets the source tree.
@@ -138,6 +171,14 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		inline_			BOOL				HasSingleNode()		const	{ return mModelCode & OPC_SINGLE_NODE;	}
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Checks whether the tree is a 4-wide tree or not. Wide trees are neither "leaf" nor "no-leaf" trees.
+		 *	\return		true if the tree is an AABBWideTree
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_			BOOL				IsWide()			const	{ return mModelCode & OPC_WIDE;			}
+
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
 		 *	Gets the model's code.
@@ -162,14 +203,71 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		inline_			void				SetMeshInterface(const MeshInterface* imesh)	{ mIMesh = imesh;	}
 
+		// Serialization
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Gets the size of the serialized model.
+		 *	\return		size in bytes
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						udword				GetSaveSize()		const;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Serializes the model. Source trees are not saved.
+		 *	\param		buffer		[out] destination buffer
+		 *	\param		size		[in] size of destination buffer, must be GetSaveSize()
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						bool				Save(void* buffer, udword size)	const;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Serializes the model to a file.
+		 *	\param		filename	[in] destination file
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						bool				Save(const char* filename)		const;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Setups the model from serialized data, replacing the current one. Nothing is rebuilt or copied: the model
+		 *	uses the data in place, so the buffer must remain valid until the model is released, and Refit() writes
+		 *	into it. The buffer should be OPC_SAVE_ALIGNMENT-aligned.
+		 *	\param		buffer			[in] serialized data
+		 *	\param		size			[in] size of serialized data
+		 *	\param		mesh_interface	[in] mesh interface, must match the mesh used to build the saved model
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						bool				Load(void* buffer, udword size, const MeshInterface* mesh_interface);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Setups the model from a file saved with Save(). The file is memory-mapped and used in place.
+		 *	\param		filename		[in] saved model
+		 *	\param		mesh_interface	[in] mesh interface, must match the mesh used to build the saved model
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						bool				Load(const char* filename, const MeshInterface* mesh_interface);
+
 		protected:
 				const	MeshInterface*		mIMesh;			//!< User-defined mesh interface
 						udword				mModelCode;		//!< Model code = combination of ModelFlag(s)
 						AABBTree*			mSource;		//!< Original source tree
 						AABBOptimizedTree*	mTree;			//!< Optimized tree owned by the model
+						MappedFile*			mFile;			//!< Mapped file, for models loaded from a file
 		// Internal methods
 						void				ReleaseBase();
 						bool				CreateTree(bool no_leaf, bool quantized);
+		// Serialization of model-specific data
+		virtual			udword				GetExtraSaveSize()					const	{ return 0;		}
+		virtual			bool				SaveExtra(void* /*buffer*/)			const	{ return true;	}
+		virtual			bool				LoadExtra(void* /*buffer*/, udword size)	{ return !size;	}
 	};
 
 #endif //__OPC_BASEMODEL_H__
\ No newline at end of file
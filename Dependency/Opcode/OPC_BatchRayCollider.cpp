@@ -0,0 +1,727 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for a batched ray collider.
+ *	\file		OPC_BatchRayCollider.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains a batched ray-vs-tree collider.
+ *	This class stabs a whole array of rays at once, and reports a single hit per ray (closest hit, or any hit) in a flat
+ *	array. It's meant for bulk queries: ambient occlusion & shadow baking, picking over dense scenes, etc.
+ *
+ *	On wide trees, queries use SSE2:
+ *	- one ray at a time: the ray is tested against the 4 children of a node at once, and against the (up to) 4 triangles
+ *	of a leaf at once. Children are visited front to back, and subtrees farther than the current closest hit are culled.
+ *	- packets of 4 rays: the 4 rays are tested against each child box at once, and against each triangle at once.
+ *
+ *	Other models are stabbed one ray at a time with the regular RayCollider code.
+ *
+ *	Settings inherited from RayCollider (culling, max distance) are used. First contact & temporal coherence settings are
+ *	ignored, use SetAnyHit() instead.
+ *
+ *	\class		BatchRayCollider
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+#include <emmintrin.h>
+
+using namespace Opcode;
+
+#define BATCH_EPSILON		0.000001f	//!< Same as the scalar ray-triangle test
+#define BATCH_MIN_DIR		1e-20f		//!< Smallest direction component, so that inverse directions remain finite
+#define BATCH_SLAB_SCALE	1.0000004f	//!< Slab test fudge factor (2 ulps), covering rounding errors on grazing rays
+
+//! Gives access to SIMD lanes
+union BatchLanes
+{
+	__m128		mVec;
+	float		mF[4];
+};
+
+//! A ray, or 4 rays, ready for SIMD tests
+struct BatchRaySIMD
+{
+	__m128		mOrig[3];		//!< Origins
+	__m128		mDir[3];		//!< Directions
+	__m128		mInvDir[3];		//!< Inverse directions
+};
+
+//! 4 triangles, or one triangle splatted over 4 lanes
+struct BatchTriangles
+{
+	__m128		mV0[3];			//!< First vertices
+	__m128		mEdge1[3];		//!< vert1 - vert0
+	__m128		mEdge2[3];		//!< vert2 - vert0
+};
+
+//! A packet of 4 rays & its results
+struct Opcode::BatchRayPacket
+{
+	BatchRaySIMD	mRays;			//!< Rays in local space
+	__m128			mMaxDist;		//!< Current limit on each ray. Rays with a negative limit are done.
+	udword			mFaceID[4];		//!< Closest hit so far, or INVALID_ID
+	float			mDistance[4];
+	float			mU[4];
+	float			mV[4];
+};
+
+//! Masks out unused lanes of a partial packet or leaf
+static const udword gLaneMasks[5] = { 0x0, 0x1, 0x3, 0x7, 0xf };
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes the inverse of a direction component, keeping it finite.
+ *	\param		d		[in] direction component
+ *	\return		1/d
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ float _SafeInverse(float d)
+{
+	if(fabsf(d)<BATCH_MIN_DIR)	d = IS_NEGATIVE_FLOAT(d) ? -BATCH_MIN_DIR : BATCH_MIN_DIR;
+	return 1.0f / d;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Converts 4 quantized coordinates to floats.
+ *	\param		bytes	[in] 4 quantized coordinates
+ *	\return		4 floats
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ __m128 _LoadBytes(const ubyte* bytes)
+{
+	const __m128i Zero = _mm_setzero_si128();
+	__m128i Tmp = _mm_cvtsi32_si128(*(const int*)bytes);
+	Tmp = _mm_unpacklo_epi8(Tmp, Zero);
+	Tmp = _mm_unpacklo_epi16(Tmp, Zero);
+	return _mm_cvtepi32_ps(Tmp);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Dequantizes the 4 child boxes of a wide node.
+ *	\param		node	[in] wide node
+ *	\param		min		[out] min points, one child per lane
+ *	\param		max		[out] max points, one child per lane
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ void _DequantizeChildren(const AABBWideNode& node, __m128* min, __m128* max)
+{
+	const __m128 OX = _mm_set1_ps(node.mOrigin.x);	const __m128 SX = _mm_set1_ps(node.mScale.x);
+	const __m128 OY = _mm_set1_ps(node.mOrigin.y);	const __m128 SY = _mm_set1_ps(node.mScale.y);
+	const __m128 OZ = _mm_set1_ps(node.mOrigin.z);	const __m128 SZ = _mm_set1_ps(node.mScale.z);
+	min[0] = _mm_add_ps(OX, _mm_mul_ps(_LoadBytes(node.mMinX), SX));
+	min[1] = _mm_add_ps(OY, _mm_mul_ps(_LoadBytes(node.mMinY), SY));
+	min[2] = _mm_add_ps(OZ, _mm_mul_ps(_LoadBytes(node.mMinZ), SZ));
+	max[0] = _mm_add_ps(OX, _mm_mul_ps(_LoadBytes(node.mMaxX), SX));
+	max[1] = _mm_add_ps(OY, _mm_mul_ps(_LoadBytes(node.mMaxY), SY));
+	max[2] = _mm_add_ps(OZ, _mm_mul_ps(_LoadBytes(node.mMaxZ), SZ));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes 4 ray-AABB slab tests. Either the rays or the boxes can be splatted.
+ *	\param		rays		[in] ray(s)
+ *	\param		min			[in] box min point(s)
+ *	\param		max			[in] box max point(s)
+ *	\param		max_dist	[in] ray(s) upper bound
+ *	\param		near_dist	[out] entry distance(s)
+ *	\return		bit mask of lanes where the ray overlaps the box
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ udword _SlabTest(const BatchRaySIMD& rays, const __m128* min, const __m128* max, __m128 max_dist, __m128& near_dist)
+{
+	const __m128 T0X = _mm_mul_ps(_mm_sub_ps(min[0], rays.mOrig[0]), rays.mInvDir[0]);
+	const __m128 T1X = _mm_mul_ps(_mm_sub_ps(max[0], rays.mOrig[0]), rays.mInvDir[0]);
+	const __m128 T0Y = _mm_mul_ps(_mm_sub_ps(min[1], rays.mOrig[1]), rays.mInvDir[1]);
+	const __m128 T1Y = _mm_mul_ps(_mm_sub_ps(max[1], rays.mOrig[1]), rays.mInvDir[1]);
+	const __m128 T0Z = _mm_mul_ps(_mm_sub_ps(min[2], rays.mOrig[2]), rays.mInvDir[2]);
+	const __m128 T1Z = _mm_mul_ps(_mm_sub_ps(max[2], rays.mOrig[2]), rays.mInvDir[2]);
+
+	__m128 Near = _mm_max_ps(_mm_min_ps(T0X, T1X), _mm_min_ps(T0Y, T1Y));
+	Near = _mm_max_ps(Near, _mm_max_ps(_mm_min_ps(T0Z, T1Z), _mm_setzero_ps()));
+
+	__m128 Far = _mm_min_ps(_mm_max_ps(T0X, T1X), _mm_max_ps(T0Y, T1Y));
+	Far = _mm_min_ps(Far, _mm_max_ps(T0Z, T1Z));
+	Far = _mm_min_ps(_mm_mul_ps(Far, _mm_set1_ps(BATCH_SLAB_SCALE)), max_dist);
+
+	near_dist = Near;
+	return udword(_mm_movemask_ps(_mm_cmple_ps(Near, Far)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes 4 ray-triangle tests, using Mller-Trumbore. Either the rays or the triangles can be splatted.
+ *	\param		rays		[in] ray(s)
+ *	\param		tris		[in] triangle(s)
+ *	\param		max_dist	[in] ray(s) upper bound, exclusive
+ *	\param		culling		[in] true to cull backfaces
+ *	\param		dist		[out] hit distance(s)
+ *	\param		u			[out] hit barycentric coordinate(s)
+ *	\param		v			[out] hit barycentric coordinate(s)
+ *	\return		bit mask of lanes with a valid hit
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ udword _RayTriangles(const BatchRaySIMD& rays, const BatchTriangles& tris, __m128 max_dist, bool culling, __m128& dist, __m128& u, __m128& v)
+{
+	const __m128* Dir = rays.mDir;
+	const __m128* E1 = tris.mEdge1;
+	const __m128* E2 = tris.mEdge2;
+
+	// pvec = dir ^ edge2
+	const __m128 PX = _mm_sub_ps(_mm_mul_ps(Dir[1], E2[2]), _mm_mul_ps(Dir[2], E2[1]));
+	const __m128 PY = _mm_sub_ps(_mm_mul_ps(Dir[2], E2[0]), _mm_mul_ps(Dir[0], E2[2]));
+	const __m128 PZ = _mm_sub_ps(_mm_mul_ps(Dir[0], E2[1]), _mm_mul_ps(Dir[1], E2[0]));
+
+	// det = edge1 | pvec
+	const __m128 Det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(E1[0], PX), _mm_mul_ps(E1[1], PY)), _mm_mul_ps(E1[2], PZ));
+	const __m128 Epsilon = _mm_set1_ps(BATCH_EPSILON);
+	__m128 Valid;
+	if(culling)	Valid = _mm_cmpgt_ps(Det, Epsilon);
+	else		Valid = _mm_or_ps(_mm_cmpgt_ps(Det, Epsilon), _mm_cmplt_ps(Det, _mm_sub_ps(_mm_setzero_ps(), Epsilon)));
+	if(!_mm_movemask_ps(Valid))	return 0;
+	const __m128 OneOverDet = _mm_div_ps(_mm_set1_ps(1.0f), Det);
+
+	// tvec = orig - vert0
+	const __m128 TX = _mm_sub_ps(rays.mOrig[0], tris.mV0[0]);
+	const __m128 TY = _mm_sub_ps(rays.mOrig[1], tris.mV0[1]);
+	const __m128 TZ = _mm_sub_ps(rays.mOrig[2], tris.mV0[2]);
+
+	// U parameter
+	u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(TX, PX), _mm_mul_ps(TY, PY)), _mm_mul_ps(TZ, PZ)), OneOverDet);
+
+	// qvec = tvec ^ edge1
+	const __m128 QX = _mm_sub_ps(_mm_mul_ps(TY, E1[2]), _mm_mul_ps(TZ, E1[1]));
+	const __m128 QY = _mm_sub_ps(_mm_mul_ps(TZ, E1[0]), _mm_mul_ps(TX, E1[2]));
+	const __m128 QZ = _mm_sub_ps(_mm_mul_ps(TX, E1[1]), _mm_mul_ps(TY, E1[0]));
+
+	// V parameter & distance
+	v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Dir[0], QX), _mm_mul_ps(Dir[1], QY)), _mm_mul_ps(Dir[2], QZ)), OneOverDet);
+	dist = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(E2[0], QX), _mm_mul_ps(E2[1], QY)), _mm_mul_ps(E2[2], QZ)), OneOverDet);
+
+	// Hit is valid if inside the triangle, and in [0, max_dist[
+	const __m128 Zero = _mm_setzero_ps();
+	Valid = _mm_and_ps(Valid, _mm_cmpge_ps(u, Zero));
+	Valid = _mm_and_ps(Valid, _mm_cmpge_ps(v, Zero));
+	Valid = _mm_and_ps(Valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	Valid = _mm_and_ps(Valid, _mm_cmpge_ps(dist, Zero));
+	Valid = _mm_and_ps(Valid, _mm_cmplt_ps(dist, max_dist));
+	return udword(_mm_movemask_ps(Valid));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Fetches up to 4 triangles in SIMD-friendly form. Unused lanes duplicate the first triangle.
+ *	\param		imesh		[in] mesh interface
+ *	\param		prims		[in] triangle indices
+ *	\param		nb			[in] number of triangles (1 to 4)
+ *	\param		tris		[out] triangles
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _FetchTriangles(const MeshInterface* imesh, const udword* prims, udword nb, BatchTriangles& tris)
+{
+	BatchLanes V0[3], E1[3], E2[3];
+	for(udword i=0;i<4;i++)
+	{
+		VertexPointers VP;
+		ConversionArea VC;
+		imesh->GetTriangle(VP, prims[i<nb ? i : 0], VC);
+		const Point& P0 = *VP.Vertex[0];
+		const Point& P1 = *VP.Vertex[1];
+		const Point& P2 = *VP.Vertex[2];
+		for(udword j=0;j<3;j++)
+		{
+			V0[j].mF[i] = P0[j];
+			E1[j].mF[i] = P1[j] - P0[j];
+			E2[j].mF[i] = P2[j] - P0[j];
+		}
+	}
+	for(udword j=0;j<3;j++)
+	{
+		tris.mV0[j]		= V0[j].mVec;
+		tris.mEdge1[j]	= E1[j].mVec;
+		tris.mEdge2[j]	= E2[j].mVec;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Fetches a triangle and splats it over 4 lanes.
+ *	\param		imesh		[in] mesh interface
+ *	\param		prim		[in] triangle index
+ *	\param		tris		[out] splatted triangle
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ void _FetchTriangle(const MeshInterface* imesh, udword prim, BatchTriangles& tris)
+{
+	VertexPointers VP;
+	ConversionArea VC;
+	imesh->GetTriangle(VP, prim, VC);
+	const Point& P0 = *VP.Vertex[0];
+	const Point& P1 = *VP.Vertex[1];
+	const Point& P2 = *VP.Vertex[2];
+	for(udword j=0;j<3;j++)
+	{
+		tris.mV0[j]		= _mm_set1_ps(P0[j]);
+		tris.mEdge1[j]	= _mm_set1_ps(P1[j] - P0[j]);
+		tris.mEdge2[j]	= _mm_set1_ps(P2[j] - P0[j]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Hit callback used when stabbing non-wide models. Keeps the closest hit.
+ *	\param		hit			[in] current hit
+ *	\param		user_data	[in] destination hit
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef OPC_RAYHIT_CALLBACK
+static void _KeepClosestHit(const CollisionFace& hit, void* user_data)
+{
+	CollisionFace* Closest = (CollisionFace*)user_data;
+	if(Closest->mFaceID==INVALID_ID || hit.mDistance<Closest->mDistance)	*Closest = hit;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BatchRayCollider::BatchRayCollider() :
+	mAnyHit		(false),
+	mPackets	(false),
+	mNbRayHits	(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BatchRayCollider::~BatchRayCollider()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Validates current settings. You should call this method after all the settings and callbacks have been defined.
+ *	\return		null if everything is ok, else a string describing the problem
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* BatchRayCollider::ValidateSettings()
+{
+	if(TemporalCoherenceEnabled())	return "Temporal coherence not supported by batched queries!";
+	return RayCollider::ValidateSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Batched stabbing query. Each ray gets its own result in the destination array: the closest hit, or any hit
+ *	in "any hit" mode. Rays that don't hit anything get INVALID_ID as face index.
+ *
+ *	Wide trees use a SIMD path (see SetPackets()). Other models are queried one ray at a time.
+ *
+ *	\param		nb_rays			[in] number of rays
+ *	\param		world_rays		[in] stabbing rays in world space
+ *	\param		model			[in] Opcode model to collide with
+ *	\param		hits			[out] one hit per ray
+ *	\param		world			[in] model's world matrix, or null
+ *	\return		true if success
+ *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BatchRayCollider::Collide(udword nb_rays, const Ray* world_rays, const Model& model, CollisionFace* hits, const Matrix4x4* world)
+{
+	// Checkings
+	if(nb_rays && (!world_rays || !hits))	return false;
+	if(!Setup(&model))	return false;
+
+	// Reset stats & contact status
+	Collider::InitQuery();
+	mNbRayBVTests		= 0;
+	mNbRayPrimTests		= 0;
+	mNbIntersections	= 0;
+	mNbRayHits			= 0;
+
+	for(udword i=0;i<nb_rays;i++)
+	{
+		hits[i].mFaceID		= INVALID_ID;
+		hits[i].mDistance	= MAX_FLOAT;
+		hits[i].mU			= 0.0f;
+		hits[i].mV			= 0.0f;
+	}
+
+	if(!model.IsWide())
+	{
+		// Regular trees: one ray at a time
+		for(udword i=0;i<nb_rays;i++)	_Stab(model, world_rays[i], world, hits[i]);
+	}
+	else
+	{
+		const AABBWideTree* Tree = (const AABBWideTree*)model.GetTree();
+
+		// Precompute the world-to-local transform once for the whole batch
+		Matrix3x3 InvRot;
+		Matrix4x4 InvWorld;
+		if(world)
+		{
+			InvRot = *world;
+			InvertPRMatrix(InvWorld, *world);
+		}
+
+		if(mPackets)
+		{
+			for(udword i=0;i<nb_rays;i+=4)
+			{
+				const udword Nb = MIN(nb_rays - i, 4);
+
+				// Gather rays in local space. Unused lanes duplicate the first ray, and are disabled.
+				BatchRayPacket Packet;
+				BatchLanes Orig[3], Dir[3], InvDir[3], MaxDist;
+				for(udword j=0;j<4;j++)
+				{
+					const Ray& R = world_rays[i + (j<Nb ? j : 0)];
+					Point O = R.mOrig;
+					Point D = R.mDir;
+					if(world)
+					{
+						D = InvRot * R.mDir;
+						O = R.mOrig * InvWorld;
+					}
+					for(udword k=0;k<3;k++)
+					{
+						Orig[k].mF[j]	= O[k];
+						Dir[k].mF[j]	= D[k];
+						InvDir[k].mF[j]	= _SafeInverse(D[k]);
+					}
+					MaxDist.mF[j] = j<Nb ? mMaxDist : -1.0f;
+					Packet.mFaceID[j] = INVALID_ID;
+				}
+				for(udword k=0;k<3;k++)
+				{
+					Packet.mRays.mOrig[k]	= Orig[k].mVec;
+					Packet.mRays.mDir[k]	= Dir[k].mVec;
+					Packet.mRays.mInvDir[k]	= InvDir[k].mVec;
+				}
+				Packet.mMaxDist = MaxDist.mVec;
+
+				_Stab(Tree, Packet);
+
+				for(udword j=0;j<Nb;j++)
+				{
+					if(Packet.mFaceID[j]==INVALID_ID)	continue;
+					CollisionFace& Hit = hits[i+j];
+					Hit.mFaceID		= Packet.mFaceID[j];
+					Hit.mDistance	= Packet.mDistance[j];
+					Hit.mU			= Packet.mU[j];
+					Hit.mV			= Packet.mV[j];
+				}
+			}
+		}
+		else
+		{
+			for(udword i=0;i<nb_rays;i++)
+			{
+				if(world)	_Stab(Tree, Ray(world_rays[i].mOrig * InvWorld, InvRot * world_rays[i].mDir), hits[i]);
+				else		_Stab(Tree, world_rays[i], hits[i]);
+			}
+		}
+	}
+
+	// Update contact status
+	for(udword i=0;i<nb_rays;i++)
+	{
+		if(hits[i].mFaceID!=INVALID_ID)	mNbRayHits++;
+	}
+	mNbIntersections = mNbRayHits;
+	if(mNbRayHits)	mFlags |= OPC_CONTACT;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Stabs a wide tree with a single ray. The ray is tested against 4 boxes or 4 triangles at a time.
+ *	\param		tree		[in] wide tree
+ *	\param		ray			[in] ray in local space
+ *	\param		hit			[out] closest (or any) hit
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BatchRayCollider::_Stab(const AABBWideTree* tree, const Ray& ray, CollisionFace& hit)
+{
+	const AABBWideNode* Nodes = tree->GetNodes();
+	const udword* Indices = tree->GetIndices();
+
+	// Splat the ray
+	BatchRaySIMD R;
+	for(udword k=0;k<3;k++)
+	{
+		R.mOrig[k]		= _mm_set1_ps(ray.mOrig[k]);
+		R.mDir[k]		= _mm_set1_ps(ray.mDir[k]);
+		R.mInvDir[k]	= _mm_set1_ps(_SafeInverse(ray.mDir[k]));
+	}
+
+	// Current limit, reduced each time we find a closer hit
+	float MaxDist = mMaxDist;
+
+	udword	StackNodes[WIDE_STACK_SIZE];
+	float	StackDists[WIDE_STACK_SIZE];
+	udword NbEntries = 0;
+	StackNodes[NbEntries] = 0;
+	StackDists[NbEntries++] = 0.0f;
+	while(NbEntries)
+	{
+		// Skip subtrees farther than current hit
+		NbEntries--;
+		if(StackDists[NbEntries]>MaxDist)	continue;
+		const AABBWideNode& Node = Nodes[StackNodes[NbEntries]];
+
+		// Test the 4 children at once
+		__m128 Min[3], Max[3];
+		_DequantizeChildren(Node, Min, Max);
+		BatchLanes Near;
+		udword Mask = _SlabTest(R, Min, Max, _mm_set1_ps(MaxDist), Near.mVec);
+		mNbRayBVTests += WIDE_TREE_WIDTH;
+
+		// Discard empty slots
+		for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+		{
+			if(Node.IsEmpty(i))	Mask &= ~(1<<i);
+		}
+		if(!Mask)	continue;
+
+		// Sort touched children front to back
+		udword Order[WIDE_TREE_WIDTH];
+		udword NbTouched = 0;
+		for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+		{
+			if(!(Mask & (1<<i)))	continue;
+			udword j = NbTouched++;
+			while(j && Near.mF[Order[j-1]]>Near.mF[i])
+			{
+				Order[j] = Order[j-1];
+				j--;
+			}
+			Order[j] = i;
+		}
+
+		// Leaves first, front to back, so that hits can cull the internal nodes
+		for(udword j=0;j<NbTouched;j++)
+		{
+			const udword i = Order[j];
+			if(!Node.IsLeaf(i) || Near.mF[i]>MaxDist)	continue;
+
+			const udword Nb = Node.GetNbPrimitives(i);
+			const udword* Prims = Indices + Node.GetFirstPrimitive(i);
+			BatchTriangles Tris;
+			_FetchTriangles(mIMesh, Prims, Nb, Tris);
+
+			BatchLanes Dist, U, V;
+			const udword HitMask = _RayTriangles(R, Tris, _mm_set1_ps(MaxDist), mCulling, Dist.mVec, U.mVec, V.mVec) & gLaneMasks[Nb];
+			mNbRayPrimTests += Nb;
+			if(!HitMask)	continue;
+
+			// Keep closest hit among the leaf's triangles
+			for(udword k=0;k<Nb;k++)
+			{
+				if(!(HitMask & (1<<k)) || Dist.mF[k]>=MaxDist)	continue;
+				MaxDist			= Dist.mF[k];
+				hit.mFaceID		= Prims[k];
+				hit.mDistance	= Dist.mF[k];
+				hit.mU			= U.mF[k];
+				hit.mV			= V.mF[k];
+			}
+			if(mAnyHit)	return;
+		}
+
+		// Then internal nodes, back to front so that the closest one is popped first
+		for(udword j=NbTouched;j--;)
+		{
+			const udword i = Order[j];
+			if(Node.IsLeaf(i))	continue;
+
+			ASSERT(NbEntries<WIDE_STACK_SIZE);
+			StackNodes[NbEntries] = Node.GetChild(i);
+			StackDists[NbEntries++] = Near.mF[i];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Stabs a wide tree with a packet of 4 rays. The 4 rays are tested against each box or triangle at once.
+ *	\param		tree		[in] wide tree
+ *	\param		packet		[in/out] rays & hits
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BatchRayCollider::_Stab(const AABBWideTree* tree, BatchRayPacket& packet)
+{
+	const AABBWideNode* Nodes = tree->GetNodes();
+	const udword* Indices = tree->GetIndices();
+	const __m128 Done = _mm_set1_ps(-1.0f);
+
+	// Each stack entry keeps the entry distances of the 4 rays, so that we can cull it once all rays found closer hits
+	udword	StackNodes[WIDE_STACK_SIZE];
+	__m128	StackDists[WIDE_STACK_SIZE];
+	udword NbEntries = 0;
+	StackNodes[NbEntries] = 0;
+	StackDists[NbEntries++] = _mm_setzero_ps();
+	while(NbEntries)
+	{
+		NbEntries--;
+		if(!_mm_movemask_ps(_mm_cmple_ps(StackDists[NbEntries], packet.mMaxDist)))	continue;
+		const AABBWideNode& Node = Nodes[StackNodes[NbEntries]];
+
+		// Dequantize the children once, then splat them one by one
+		__m128 Children[6];
+		_DequantizeChildren(Node, Children, Children+3);
+		BatchLanes ChildBounds[6];
+		for(udword k=0;k<6;k++)	ChildBounds[k].mVec = Children[k];
+
+		udword	Internal[WIDE_TREE_WIDTH];
+		__m128	InternalDists[WIDE_TREE_WIDTH];
+		float	InternalKeys[WIDE_TREE_WIDTH];
+		udword NbInternal = 0;
+		for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+		{
+			if(Node.IsEmpty(i))	break;
+
+			__m128 Min[3], Max[3];
+			for(udword k=0;k<3;k++)
+			{
+				Min[k] = _mm_set1_ps(ChildBounds[k].mF[i]);
+				Max[k] = _mm_set1_ps(ChildBounds[k+3].mF[i]);
+			}
+			BatchLanes Near;
+			const udword Mask = _SlabTest(packet.mRays, Min, Max, packet.mMaxDist, Near.mVec);
+			mNbRayBVTests += 4;
+			if(!Mask)	continue;
+
+			if(Node.IsLeaf(i))
+			{
+				udword Nb = Node.GetNbPrimitives(i);
+				const udword* Prims = Indices + Node.GetFirstPrimitive(i);
+				while(Nb--)
+				{
+					const udword PrimIndex = *Prims++;
+					BatchTriangles Tri;
+					_FetchTriangle(mIMesh, PrimIndex, Tri);
+
+					BatchLanes Dist, U, V;
+					const udword HitMask = _RayTriangles(packet.mRays, Tri, packet.mMaxDist, mCulling, Dist.mVec, U.mVec, V.mVec);
+					mNbRayPrimTests += 4;
+					if(!HitMask)	continue;
+
+					BatchLanes MaxDist;
+					MaxDist.mVec = packet.mMaxDist;
+					for(udword k=0;k<4;k++)
+					{
+						if(!(HitMask & (1<<k)))	continue;
+						packet.mFaceID[k]	= PrimIndex;
+						packet.mDistance[k]	= Dist.mF[k];
+						packet.mU[k]		= U.mF[k];
+						packet.mV[k]		= V.mF[k];
+						// In "any hit" mode the ray is done, else it's shortened
+						MaxDist.mF[k]		= mAnyHit ? -1.0f : Dist.mF[k];
+					}
+					packet.mMaxDist = MaxDist.mVec;
+
+					// Early exit when all rays are done
+					if(mAnyHit && _mm_movemask_ps(_mm_cmpgt_ps(packet.mMaxDist, Done))==0)	return;
+				}
+			}
+			else
+			{
+				// Sort by closest entry distance among touched rays
+				float Key = MAX_FLOAT;
+				for(udword k=0;k<4;k++)
+				{
+					if((Mask & (1<<k)) && Near.mF[k]<Key)	Key = Near.mF[k];
+				}
+				// Untouched rays must not keep the node alive
+				BatchLanes Dists;
+				for(udword k=0;k<4;k++)	Dists.mF[k] = (Mask & (1<<k)) ? Near.mF[k] : MAX_FLOAT;
+
+				udword j = NbInternal++;
+				while(j && InternalKeys[j-1]<Key)
+				{
+					Internal[j]			= Internal[j-1];
+					InternalDists[j]	= InternalDists[j-1];
+					InternalKeys[j]		= InternalKeys[j-1];
+					j--;
+				}
+				Internal[j]			= Node.GetChild(i);
+				InternalDists[j]	= Dists.mVec;
+				InternalKeys[j]		= Key;
+			}
+		}
+
+		// Push back to front, so that the closest child is popped first
+		for(udword j=0;j<NbInternal;j++)
+		{
+			ASSERT(NbEntries<WIDE_STACK_SIZE);
+			StackNodes[NbEntries] = Internal[j];
+			StackDists[NbEntries++] = InternalDists[j];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Stabs a regular model with a single ray, using the base RayCollider.
+ *	\param		model		[in] Opcode model
+ *	\param		world_ray	[in] ray in world space
+ *	\param		world		[in] model's world matrix, or null
+ *	\param		hit			[out] closest (or any) hit
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BatchRayCollider::_Stab(const Model& model, const Ray& world_ray, const Matrix4x4* world, CollisionFace& hit)
+{
+	// The base query resets stats & flags, so save them
+	const udword SavedFlags				= mFlags;
+	const udword SavedNbRayBVTests		= mNbRayBVTests;
+	const udword SavedNbRayPrimTests	= mNbRayPrimTests;
+
+	SetFirstContact(mAnyHit);
+	SetTemporalCoherence(false);
+#ifdef OPC_RAYHIT_CALLBACK
+	HitCallback SavedCallback	= mHitCallback;
+	void* SavedUserData			= mUserData;
+	mHitCallback	= _KeepClosestHit;
+	mUserData		= &hit;
+	RayCollider::Collide(world_ray, model, world);
+	mHitCallback	= SavedCallback;
+	mUserData		= SavedUserData;
+#else
+	CollisionFaces Faces;
+	CollisionFaces* SavedFaces	= mStabbedFaces;
+	const bool SavedClosestHit	= mClosestHit;
+	mStabbedFaces	= &Faces;
+	mClosestHit		= !mAnyHit;
+	RayCollider::Collide(world_ray, model, world);
+	if(Faces.GetNbFaces())	hit = *Faces.GetFaces();
+	mStabbedFaces	= SavedFaces;
+	mClosestHit		= SavedClosestHit;
+#endif
+
+	mFlags			= SavedFlags;
+	mNbRayBVTests	+= SavedNbRayBVTests;
+	mNbRayPrimTests	+= SavedNbRayPrimTests;
+}
@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for a batched ray collider.
+ *	\file		OPC_BatchRayCollider.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_BATCHRAYCOLLIDER_H__
+#define __OPC_BATCHRAYCOLLIDER_H__
+
+	struct BatchRayPacket;
+
+	class OPCODE_API BatchRayCollider : public RayCollider
+	{
+		public:
+		// Constructor / Destructor
+											BatchRayCollider();
+		virtual								~BatchRayCollider();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Batched stabbing query. Each ray gets its own result in the destination array: the closest hit, or any hit
+		 *	in "any hit" mode. Rays that don't hit anything get INVALID_ID as face index.
+		 *
+		 *	Wide trees use a SIMD path (see SetPackets()). Other models are queried one ray at a time.
+		 *
+		 *	\param		nb_rays			[in] number of rays
+		 *	\param		world_rays		[in] stabbing rays in world space
+		 *	\param		model			[in] Opcode model to collide with
+		 *	\param		hits			[out] one hit per ray
+		 *	\param		world			[in] model's world matrix, or null
+		 *	\return		true if success
+		 *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool			Collide(udword nb_rays, const Ray* world_rays, const Model& model, CollisionFace* hits, const Matrix4x4* world=null);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: enable or disable "any hit" mode. In this mode the query stops as soon as a ray hits a face, which
+		 *	is enough for shadow & occlusion rays. Else the closest hit is reported.
+		 *	\param		flag		[in] true to report any hit
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_				void			SetAnyHit(bool flag)					{ mAnyHit		= flag;		}
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: enable or disable packet traversal. Packets trace 4 consecutive rays together, which only pays off
+		 *	when the rays are coherent (same origin, similar directions: picking, shadow masks...). Incoherent rays are
+		 *	better traced one by one, testing 4 boxes at a time.
+		 *	\param		flag		[in] true to trace packets of 4 rays
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_				void			SetPackets(bool flag)					{ mPackets		= flag;		}
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Stats: gets the number of rays that hit something during last query.
+		 *	\return		the number of rays with a valid hit
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_				udword			GetNbRayHits()					const	{ return mNbRayHits;		}
+
+		override(RayCollider)	const char*	ValidateSettings();
+
+		protected:
+		// Settings
+							bool			mAnyHit;			//!< Report any hit instead of closest hit
+							bool			mPackets;			//!< Trace packets of 4 rays
+		// Stats
+							udword			mNbRayHits;			//!< Number of rays with a valid hit
+		// Internal methods
+							void			_Stab(const AABBWideTree* tree, const Ray& ray, CollisionFace& hit);
+							void			_Stab(const AABBWideTree* tree, BatchRayPacket& packet);
+							void			_Stab(const Model& model, const Ray& ray, const Matrix4x4* world, CollisionFace& hit);
+	};
+
+#endif // __OPC_BATCHRAYCOLLIDER_H__
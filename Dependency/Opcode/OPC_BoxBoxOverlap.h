@@ -6,20 +6,82 @@
  *	- the fabs matrix is precomputed as well and epsilon-tweaked (RAPID-style, we found this almost mandatory)
  *	- Class III axes can be disabled... (SOLID & Intel fashion)
  *	- ...or enabled to perform some profiling
- *	- CPU comparisons used when appropriate
  *	- lazy evaluation sometimes saves some work in case of early exits (unlike SOLID)
+ *	- the SSE2 version tests each class of 3 axes at once
  *
- *	\param		ea	[in] extents from box A
- *	\param		ca	[in] center from box A
- *	\param		eb	[in] extents from box B
- *	\param		cb	[in] center from box B
+ *	\param		data	[in] precomputed relative transform
+ *	\param		ea		[in] extents from box A
+ *	\param		ca		[in] center from box A
+ *	\param		eb		[in] extents from box B
+ *	\param		cb		[in] center from box B
+ *	\param		full	[in] true to test the class III axes
  *	\return		true if boxes overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL AABBTreeCollider::BoxBoxOverlap(const Point& ea, const Point& ca, const Point& eb, const Point& cb)
+inline_ BOOL BoxBoxTest(const BoxBoxData& data, const Point& ea, const Point& ca, const Point& eb, const Point& cb, BOOL full)
 {
-	// Stats
-	mNbBVBVTests++;
+#ifdef OPC_SIMD_SSE2
+	const __m128 EA = SIMD_LoadPoint(ea);
+	const __m128 EB = SIMD_LoadPoint(eb);
+	const __m128 CB = SIMD_LoadPoint(cb);
+	const __m128 EBx = SIMD_SHUFFLE(EB, 0, 0, 0);
+	const __m128 EBy = SIMD_SHUFFLE(EB, 1, 1, 1);
+	const __m128 EBz = SIMD_SHUFFLE(EB, 2, 2, 2);
+
+	// Class I : A's basis vectors
+	__m128 T =	_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(data.mRows[0]), SIMD_SHUFFLE(CB, 0, 0, 0)), _mm_mul_ps(_mm_loadu_ps(data.mRows[1]), SIMD_SHUFFLE(CB, 1, 1, 1))),
+					_mm_mul_ps(_mm_loadu_ps(data.mRows[2]), SIMD_SHUFFLE(CB, 2, 2, 2)));
+	T = _mm_sub_ps(_mm_add_ps(T, _mm_loadu_ps(data.mT)), SIMD_LoadPoint(ca));
+	__m128 R = _mm_add_ps(_mm_add_ps(_mm_add_ps(EA, _mm_mul_ps(EBx, _mm_loadu_ps(data.mARows[0]))), _mm_mul_ps(EBy, _mm_loadu_ps(data.mARows[1]))), _mm_mul_ps(EBz, _mm_loadu_ps(data.mARows[2])));
+	if(SIMD_Separated(T, R))	return FALSE;
+
+	// Class II : B's basis vectors
+	const __m128 Tx = SIMD_SHUFFLE(T, 0, 0, 0);
+	const __m128 Ty = SIMD_SHUFFLE(T, 1, 1, 1);
+	const __m128 Tz = SIMD_SHUFFLE(T, 2, 2, 2);
+	const __m128 C0 = _mm_loadu_ps(data.mCols[0]);
+	const __m128 C1 = _mm_loadu_ps(data.mCols[1]);
+	const __m128 C2 = _mm_loadu_ps(data.mCols[2]);
+	const __m128 AC0 = _mm_loadu_ps(data.mACols[0]);
+	const __m128 AC1 = _mm_loadu_ps(data.mACols[1]);
+	const __m128 AC2 = _mm_loadu_ps(data.mACols[2]);
+	const __m128 EAx = SIMD_SHUFFLE(EA, 0, 0, 0);
+	const __m128 EAy = SIMD_SHUFFLE(EA, 1, 1, 1);
+	const __m128 EAz = SIMD_SHUFFLE(EA, 2, 2, 2);
+
+	__m128 D = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Tx, C0), _mm_mul_ps(Ty, C1)), _mm_mul_ps(Tz, C2));
+	R = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(EAx, AC0), _mm_mul_ps(EAy, AC1)), _mm_mul_ps(EAz, AC2)), EB);
+	if(SIMD_Separated(D, R))	return FALSE;
+
+	// Class III : 9 cross products
+	if(full)
+	{
+		const __m128 EB0 = SIMD_SHUFFLE(EB, 1, 0, 0);
+		const __m128 EB1 = SIMD_SHUFFLE(EB, 2, 2, 1);
+
+		// L = A0 x B0, A0 x B1, A0 x B2
+		D = _mm_sub_ps(_mm_mul_ps(Tz, C1), _mm_mul_ps(Ty, C2));
+		R = _mm_add_ps(_mm_add_ps(_mm_mul_ps(EAy, AC2), _mm_mul_ps(EAz, AC1)), _mm_mul_ps(EB0, _mm_loadu_ps(data.mACross0[0])));
+		R = _mm_add_ps(R, _mm_mul_ps(EB1, _mm_loadu_ps(data.mACross1[0])));
+		if(SIMD_Separated(D, R))	return FALSE;
+
+		// L = A1 x B0, A1 x B1, A1 x B2
+		D = _mm_sub_ps(_mm_mul_ps(Tx, C2), _mm_mul_ps(Tz, C0));
+		R = _mm_add_ps(_mm_add_ps(_mm_mul_ps(EAx, AC2), _mm_mul_ps(EAz, AC0)), _mm_mul_ps(EB0, _mm_loadu_ps(data.mACross0[1])));
+		R = _mm_add_ps(R, _mm_mul_ps(EB1, _mm_loadu_ps(data.mACross1[1])));
+		if(SIMD_Separated(D, R))	return FALSE;
+
+		// L = A2 x B0, A2 x B1, A2 x B2
+		D = _mm_sub_ps(_mm_mul_ps(Ty, C0), _mm_mul_ps(Tx, C1));
+		R = _mm_add_ps(_mm_add_ps(_mm_mul_ps(EAx, AC1), _mm_mul_ps(EAy, AC0)), _mm_mul_ps(EB0, _mm_loadu_ps(data.mACross0[2])));
+		R = _mm_add_ps(R, _mm_mul_ps(EB1, _mm_loadu_ps(data.mACross1[2])));
+		if(SIMD_Separated(D, R))	return FALSE;
+	}
+	return TRUE;
+#else
+	const Matrix3x3& mR1to0 = data.mR;
+	const Matrix3x3& mAR = data.mAR;
+	const Point& mT1to0 = data.mT;
 
 	float t,t2;
 
@@ -47,9 +109,7 @@ inline_ BOOL AABBTreeCollider::BoxBoxOverlap(const Point& ea, const Point& ca, c
 	if(GREATER(t, t2))	return FALSE;
 
 	// Class III : 9 cross products
-	// Cool trick: always perform the full test for first level, regardless of settings.
-	// That way pathological cases (such as the pencils scene) are quickly rejected anyway !
-	if(mFullBoxBoxTest || mNbBVBVTests==1)
+	if(full)
 	{
 		t = Tz*mR1to0.m[0][1] - Ty*mR1to0.m[0][2];	t2 = ea.y*mAR.m[0][2] + ea.z*mAR.m[0][1] + eb.y*mAR.m[2][0] + eb.z*mAR.m[1][0];	if(GREATER(t, t2))	return FALSE;	// L = A0 x B0
 		t = Tz*mR1to0.m[1][1] - Ty*mR1to0.m[1][2];	t2 = ea.y*mAR.m[1][2] + ea.z*mAR.m[1][1] + eb.x*mAR.m[2][0] + eb.z*mAR.m[0][0];	if(GREATER(t, t2))	return FALSE;	// L = A0 x B1
@@ -62,50 +122,160 @@ inline_ BOOL AABBTreeCollider::BoxBoxOverlap(const Point& ea, const Point& ca, c
 		t = Ty*mR1to0.m[2][0] - Tx*mR1to0.m[2][1];	t2 = ea.x*mAR.m[2][1] + ea.y*mAR.m[2][0] + eb.x*mAR.m[1][2] + eb.y*mAR.m[0][2];	if(GREATER(t, t2))	return FALSE;	// L = A2 x B2
 	}
 	return TRUE;
+#endif
 }
 
-//! A dedicated version when one box is constant
-inline_ BOOL OBBCollider::BoxBoxOverlap(const Point& extents, const Point& center)
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	OBB-AABB overlap test, a dedicated version of BoxBoxTest() when the OBB is constant.
+ *	\param		data	[in] precomputed OBB data
+ *	\param		extents	[in] AABB extents
+ *	\param		center	[in] AABB center
+ *	\param		full	[in] true to test the class III axes
+ *	\return		true if boxes overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL OBBAABBTest(const OBBAABBData& data, const Point& extents, const Point& center, BOOL full)
 {
-	// Stats
-	mNbVolumeBVTests++;
+#ifdef OPC_SIMD_SSE2
+	const __m128 E = SIMD_LoadPoint(extents);
+
+	// Class I : A's basis vectors
+	const __m128 T = _mm_sub_ps(_mm_loadu_ps(data.mT), SIMD_LoadPoint(center));
+	__m128 R = _mm_add_ps(E, _mm_loadu_ps(data.mBB1));
+	if(SIMD_Separated(T, R))	return FALSE;
+
+	// Class II : B's basis vectors
+	const __m128 Tx = SIMD_SHUFFLE(T, 0, 0, 0);
+	const __m128 Ty = SIMD_SHUFFLE(T, 1, 1, 1);
+	const __m128 Tz = SIMD_SHUFFLE(T, 2, 2, 2);
+	const __m128 C0 = _mm_loadu_ps(data.mCols[0]);
+	const __m128 C1 = _mm_loadu_ps(data.mCols[1]);
+	const __m128 C2 = _mm_loadu_ps(data.mCols[2]);
+	const __m128 AC0 = _mm_loadu_ps(data.mACols[0]);
+	const __m128 AC1 = _mm_loadu_ps(data.mACols[1]);
+	const __m128 AC2 = _mm_loadu_ps(data.mACols[2]);
+	const __m128 Ex = SIMD_SHUFFLE(E, 0, 0, 0);
+	const __m128 Ey = SIMD_SHUFFLE(E, 1, 1, 1);
+	const __m128 Ez = SIMD_SHUFFLE(E, 2, 2, 2);
+
+	__m128 D = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Tx, C0), _mm_mul_ps(Ty, C1)), _mm_mul_ps(Tz, C2));
+	R = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Ex, AC0), _mm_mul_ps(Ey, AC1)), _mm_mul_ps(Ez, AC2)), _mm_loadu_ps(data.mExtents));
+	if(SIMD_Separated(D, R))	return FALSE;
+
+	// Class III : 9 cross products
+	if(full)
+	{
+		// L = A0 x B0, A0 x B1, A0 x B2
+		D = _mm_sub_ps(_mm_mul_ps(Tz, C1), _mm_mul_ps(Ty, C2));
+		R = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Ey, AC2), _mm_mul_ps(Ez, AC1)), _mm_loadu_ps(data.mBB[0]));
+		if(SIMD_Separated(D, R))	return FALSE;
+
+		// L = A1 x B0, A1 x B1, A1 x B2
+		D = _mm_sub_ps(_mm_mul_ps(Tx, C2), _mm_mul_ps(Tz, C0));
+		R = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Ex, AC2), _mm_mul_ps(Ez, AC0)), _mm_loadu_ps(data.mBB[1]));
+		if(SIMD_Separated(D, R))	return FALSE;
+
+		// L = A2 x B0, A2 x B1, A2 x B2
+		D = _mm_sub_ps(_mm_mul_ps(Ty, C0), _mm_mul_ps(Tx, C1));
+		R = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Ex, AC1), _mm_mul_ps(Ey, AC0)), _mm_loadu_ps(data.mBB[2]));
+		if(SIMD_Separated(D, R))	return FALSE;
+	}
+	return TRUE;
+#else
+	const Matrix3x3& mRBoxToModel = data.mR;
+	const Matrix3x3& mAR = data.mAR;
 
 	float t,t2;
 
 	// Class I : A's basis vectors
-	float Tx = mTBoxToModel.x - center.x;	t = extents.x + mBBx1;	if(GREATER(Tx, t))	return FALSE;
-	float Ty = mTBoxToModel.y - center.y;	t = extents.y + mBBy1;	if(GREATER(Ty, t))	return FALSE;
-	float Tz = mTBoxToModel.z - center.z;	t = extents.z + mBBz1;	if(GREATER(Tz, t))	return FALSE;
+	float Tx = data.mT.x - center.x;	t = extents.x + data.mBB1.x;	if(GREATER(Tx, t))	return FALSE;
+	float Ty = data.mT.y - center.y;	t = extents.y + data.mBB1.y;	if(GREATER(Ty, t))	return FALSE;
+	float Tz = data.mT.z - center.z;	t = extents.z + data.mBB1.z;	if(GREATER(Tz, t))	return FALSE;
 
 	// Class II : B's basis vectors
 	t = Tx*mRBoxToModel.m[0][0] + Ty*mRBoxToModel.m[0][1] + Tz*mRBoxToModel.m[0][2];
-	t2 = extents.x*mAR.m[0][0] + extents.y*mAR.m[0][1] + extents.z*mAR.m[0][2] + mBoxExtents.x;
+	t2 = extents.x*mAR.m[0][0] + extents.y*mAR.m[0][1] + extents.z*mAR.m[0][2] + data.mExtents.x;
 	if(GREATER(t, t2))	return FALSE;
 
 	t = Tx*mRBoxToModel.m[1][0] + Ty*mRBoxToModel.m[1][1] + Tz*mRBoxToModel.m[1][2];
-	t2 = extents.x*mAR.m[1][0] + extents.y*mAR.m[1][1] + extents.z*mAR.m[1][2] + mBoxExtents.y;
+	t2 = extents.x*mAR.m[1][0] + extents.y*mAR.m[1][1] + extents.z*mAR.m[1][2] + data.mExtents.y;
 	if(GREATER(t, t2))	return FALSE;
 
 	t = Tx*mRBoxToModel.m[2][0] + Ty*mRBoxToModel.m[2][1] + Tz*mRBoxToModel.m[2][2];
-	t2 = extents.x*mAR.m[2][0] + extents.y*mAR.m[2][1] + extents.z*mAR.m[2][2] + mBoxExtents.z;
+	t2 = extents.x*mAR.m[2][0] + extents.y*mAR.m[2][1] + extents.z*mAR.m[2][2] + data.mExtents.z;
 	if(GREATER(t, t2))	return FALSE;
 
 	// Class III : 9 cross products
-	// Cool trick: always perform the full test for first level, regardless of settings.
-	// That way pathological cases (such as the pencils scene) are quickly rejected anyway !
-	if(mFullBoxBoxTest || mNbVolumeBVTests==1)
+	if(full)
 	{
-		t = Tz*mRBoxToModel.m[0][1] - Ty*mRBoxToModel.m[0][2];	t2 = extents.y*mAR.m[0][2] + extents.z*mAR.m[0][1] + mBB_1;	if(GREATER(t, t2))	return FALSE;	// L = A0 x B0
-		t = Tz*mRBoxToModel.m[1][1] - Ty*mRBoxToModel.m[1][2];	t2 = extents.y*mAR.m[1][2] + extents.z*mAR.m[1][1] + mBB_2;	if(GREATER(t, t2))	return FALSE;	// L = A0 x B1
-		t = Tz*mRBoxToModel.m[2][1] - Ty*mRBoxToModel.m[2][2];	t2 = extents.y*mAR.m[2][2] + extents.z*mAR.m[2][1] + mBB_3;	if(GREATER(t, t2))	return FALSE;	// L = A0 x B2
-		t = Tx*mRBoxToModel.m[0][2] - Tz*mRBoxToModel.m[0][0];	t2 = extents.x*mAR.m[0][2] + extents.z*mAR.m[0][0] + mBB_4;	if(GREATER(t, t2))	return FALSE;	// L = A1 x B0
-		t = Tx*mRBoxToModel.m[1][2] - Tz*mRBoxToModel.m[1][0];	t2 = extents.x*mAR.m[1][2] + extents.z*mAR.m[1][0] + mBB_5;	if(GREATER(t, t2))	return FALSE;	// L = A1 x B1
-		t = Tx*mRBoxToModel.m[2][2] - Tz*mRBoxToModel.m[2][0];	t2 = extents.x*mAR.m[2][2] + extents.z*mAR.m[2][0] + mBB_6;	if(GREATER(t, t2))	return FALSE;	// L = A1 x B2
-		t = Ty*mRBoxToModel.m[0][0] - Tx*mRBoxToModel.m[0][1];	t2 = extents.x*mAR.m[0][1] + extents.y*mAR.m[0][0] + mBB_7;	if(GREATER(t, t2))	return FALSE;	// L = A2 x B0
-		t = Ty*mRBoxToModel.m[1][0] - Tx*mRBoxToModel.m[1][1];	t2 = extents.x*mAR.m[1][1] + extents.y*mAR.m[1][0] + mBB_8;	if(GREATER(t, t2))	return FALSE;	// L = A2 x B1
-		t = Ty*mRBoxToModel.m[2][0] - Tx*mRBoxToModel.m[2][1];	t2 = extents.x*mAR.m[2][1] + extents.y*mAR.m[2][0] + mBB_9;	if(GREATER(t, t2))	return FALSE;	// L = A2 x B2
+		t = Tz*mRBoxToModel.m[0][1] - Ty*mRBoxToModel.m[0][2];	t2 = extents.y*mAR.m[0][2] + extents.z*mAR.m[0][1] + data.mBB[0].x;	if(GREATER(t, t2))	return FALSE;	// L = A0 x B0
+		t = Tz*mRBoxToModel.m[1][1] - Ty*mRBoxToModel.m[1][2];	t2 = extents.y*mAR.m[1][2] + extents.z*mAR.m[1][1] + data.mBB[0].y;	if(GREATER(t, t2))	return FALSE;	// L = A0 x B1
+		t = Tz*mRBoxToModel.m[2][1] - Ty*mRBoxToModel.m[2][2];	t2 = extents.y*mAR.m[2][2] + extents.z*mAR.m[2][1] + data.mBB[0].z;	if(GREATER(t, t2))	return FALSE;	// L = A0 x B2
+		t = Tx*mRBoxToModel.m[0][2] - Tz*mRBoxToModel.m[0][0];	t2 = extents.x*mAR.m[0][2] + extents.z*mAR.m[0][0] + data.mBB[1].x;	if(GREATER(t, t2))	return FALSE;	// L = A1 x B0
+		t = Tx*mRBoxToModel.m[1][2] - Tz*mRBoxToModel.m[1][0];	t2 = extents.x*mAR.m[1][2] + extents.z*mAR.m[1][0] + data.mBB[1].y;	if(GREATER(t, t2))	return FALSE;	// L = A1 x B1
+		t = Tx*mRBoxToModel.m[2][2] - Tz*mRBoxToModel.m[2][0];	t2 = extents.x*mAR.m[2][2] + extents.z*mAR.m[2][0] + data.mBB[1].z;	if(GREATER(t, t2))	return FALSE;	// L = A1 x B2
+		t = Ty*mRBoxToModel.m[0][0] - Tx*mRBoxToModel.m[0][1];	t2 = extents.x*mAR.m[0][1] + extents.y*mAR.m[0][0] + data.mBB[2].x;	if(GREATER(t, t2))	return FALSE;	// L = A2 x B0
+		t = Ty*mRBoxToModel.m[1][0] - Tx*mRBoxToModel.m[1][1];	t2 = extents.x*mAR.m[1][1] + extents.y*mAR.m[1][0] + data.mBB[2].y;	if(GREATER(t, t2))	return FALSE;	// L = A2 x B1
+		t = Ty*mRBoxToModel.m[2][0] - Tx*mRBoxToModel.m[2][1];	t2 = extents.x*mAR.m[2][1] + extents.y*mAR.m[2][0] + data.mBB[2].z;	if(GREATER(t, t2))	return FALSE;	// L = A2 x B2
 	}
 	return TRUE;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	AABB-AABB overlap test.
+ *	\param		extents		[in] extents from box A
+ *	\param		center		[in] center from box A
+ *	\param		box_extents	[in] extents from box B
+ *	\param		box_center	[in] center from box B
+ *	\return		true if boxes overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL AABBAABBTest(const Point& extents, const Point& center, const Point& box_extents, const Point& box_center)
+{
+#ifdef OPC_SIMD_SSE2
+	const __m128 T = _mm_sub_ps(SIMD_LoadPoint(box_center), SIMD_LoadPoint(center));
+	const __m128 E = _mm_add_ps(SIMD_LoadPoint(extents), SIMD_LoadPoint(box_extents));
+	return !SIMD_Separated(T, E);
+#else
+	float tx = box_center.x - center.x;	float ex = extents.x + box_extents.x;	if(GREATER(tx, ex))	return FALSE;
+	float ty = box_center.y - center.y;	float ey = extents.y + box_extents.y;	if(GREATER(ty, ey))	return FALSE;
+	float tz = box_center.z - center.z;	float ez = extents.z + box_extents.z;	if(GREATER(tz, ez))	return FALSE;
+
+	return TRUE;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	OBB-OBB overlap test between two tree nodes.
+ *	\param		ea	[in] extents from box A
+ *	\param		ca	[in] center from box A
+ *	\param		eb	[in] extents from box B
+ *	\param		cb	[in] center from box B
+ *	\return		true if boxes overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL AABBTreeCollider::BoxBoxOverlap(const Point& ea, const Point& ca, const Point& eb, const Point& cb)
+{
+	// Stats
+	mNbBVBVTests++;
+
+	// Cool trick: always perform the full test for first level, regardless of settings.
+	// That way pathological cases (such as the pencils scene) are quickly rejected anyway !
+	return BoxBoxTest(mBoxBoxData, ea, ca, eb, cb, mFullBoxBoxTest || mNbBVBVTests==1);
+}
+
+//! A dedicated version when one box is constant
+inline_ BOOL OBBCollider::BoxBoxOverlap(const Point& extents, const Point& center)
+{
+	// Stats
+	mNbVolumeBVTests++;
+
+	// Same trick as above
+	return OBBAABBTest(mBoxBoxData, extents, center, mFullBoxBoxTest || mNbVolumeBVTests==1);
 }
 
 //! A special version for 2 axis-aligned boxes
@@ -114,9 +284,5 @@ inline_ BOOL AABBCollider::AABBAABBOverlap(const Point& extents, const Point& ce
 	// Stats
 	mNbVolumeBVTests++;
 
-	float tx = mBox.mCenter.x - center.x;	float ex = extents.x + mBox.mExtents.x;	if(GREATER(tx, ex))	return FALSE;
-	float ty = mBox.mCenter.y - center.y;	float ey = extents.y + mBox.mExtents.y;	if(GREATER(ty, ey))	return FALSE;
-	float tz = mBox.mCenter.z - center.z;	float ez = extents.z + mBox.mExtents.z;	if(GREATER(tz, ez))	return FALSE;
-
-	return TRUE;
+	return AABBAABBTest(extents, center, mBox.mExtents, mBox.mCenter);
 }
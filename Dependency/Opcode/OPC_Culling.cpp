@@ -0,0 +1,1105 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains a scene-level culling engine: frustum & occlusion culling for large sets of instances.
+ *	\file		OPC_Culling.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	A culling engine for large sets of instances (doodads, buildings, creatures...).
+ *
+ *	- Instance boxes are stored in a tree built by AABBTreeOfAABBsBuilder, with a few instances per leaf. The tree
+ *	is flattened to an array of nodes, and instance boxes are copied in leaf order.
+ *	- Moving instances don't rebuild the tree: their leaves are refit, bottom-up, in Update(). The tree is rebuilt
+ *	from scratch when refits made it too loose, or when too many instances have been added or removed. Instances
+ *	added since last rebuild are tested one by one.
+ *	- Nodes are tested against the culling planes with the same near/far vertex test as PlanesCollider, 4 planes at
+ *	a time with SSE2. The clip mask is passed down to children, so nodes fully inside the frustum aren't tested
+ *	anymore.
+ *	- Occluders are rendered to a small depth buffer, from which a max-depth pyramid is built (hierarchical-Z).
+ *	Nodes & instances are projected to the screen, and discarded when they're behind the occluders on the pyramid
+ *	level where they cover at most 2x2 texels.
+ *
+ *	Occlusion culling is conservative: occluders only cover the pixels they fully cover, at their max depth, and
+ *	occluders or boxes crossing the camera plane are respectively ignored and considered visible.
+ *
+ *	\class		CullingScene
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+using namespace Opcode;
+
+#define CULL_PENDING			0x80000000	//!< Flag for pending instances in mInstanceSlots
+#define CULL_LEAF_SIZE			4			//!< Max number of instances per leaf
+#define CULL_PENDING_RATIO		32			//!< The tree is rebuilt when more than 1/32 of the instances are pending
+#define CULL_REMOVED_RATIO		4			//!< The tree is rebuilt when more than 1/4 of its boxes have been removed
+#define CULL_FULL_REFIT_RATIO	32			//!< The whole tree is refit when more than 1/32 of the nodes are dirty
+#define CULL_MIN_W				1e-4f		//!< Points closer to the camera plane than this are considered behind it
+
+#define CULL_SPLAT(v, i)		_mm_shuffle_ps((v), (v), _MM_SHUFFLE((i), (i), (i), (i)))
+
+static inline_ void SetBox(CULL_Box& dest, const AABB& box)
+{
+	Point Min, Max;
+	box.GetMin(Min);
+	box.GetMax(Max);
+	dest.mMin[0] = Min.x;	dest.mMin[1] = Min.y;	dest.mMin[2] = Min.z;
+	dest.mMax[0] = Max.x;	dest.mMax[1] = Max.y;	dest.mMax[2] = Max.z;
+}
+
+static inline_ void SetEmpty(float* min, float* max)
+{
+	min[0] = min[1] = min[2] = MAX_FLOAT;
+	max[0] = max[1] = max[2] = -MAX_FLOAT;
+}
+
+static inline_ float GetArea(const float* min, const float* max)
+{
+	if(min[0]>max[0])	return 0.0f;
+	const float dx = max[0] - min[0];
+	const float dy = max[1] - min[1];
+	const float dz = max[2] - min[2];
+	return dx*dy + dy*dz + dz*dx;
+}
+
+//! Maps a normalized device coordinate to the screen
+static inline_ float ToScreen(float v, float size)
+{
+	return (v*0.5f + 0.5f)*size;
+}
+
+//! Sets an outward plane from an inward plane computed from the view-projection matrix
+static inline_ void SetFrustumPlane(Plane& plane, float nx, float ny, float nz, float d)
+{
+	plane.Set(-nx, -ny, -nz, -d);
+	plane.Normalize();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CullingScene::CullingScene() :
+	mMaxNbHandles	(0),
+	mNbHandles		(0),
+	mInstanceBoxes	(null),
+	mInstanceSlots	(null),
+	mNbInstances	(0),
+	mNbRemoved		(0),
+	mNbNodes		(0),
+	mNodes			(null),
+	mParents		(null),
+	mDirtyNodes		(null),
+	mNbBoxes		(0),
+	mBoxes			(null),
+	mTreeSize		(0.0f),
+	mBuiltTreeSize	(0.0f),
+	mNbRebuilds		(0),
+	mDirty			(false),
+	mNbPlaneGroups	(0),
+	mClipMask		(0),
+	mOcclusion		(false),
+	mWidth			(256),
+	mHeight			(128),
+	mHiZ			(null),
+	mHiZSize		(0),
+	mNbLevels		(0),
+	mRebuildRatio	(2.0f),
+	mNbNodeTests	(0),
+	mNbBoxTests		(0),
+	mNbOccluded		(0),
+	mVisible		(null)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CullingScene::~CullingScene()
+{
+	Release();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Releases everything.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingScene::Release()
+{
+	DELETEARRAY(mHiZ);
+	DELETEARRAY(mBoxes);
+	DELETEARRAY(mDirtyNodes);
+	DELETEARRAY(mParents);
+	DELETEARRAY(mNodes);
+	DELETEARRAY(mInstanceSlots);
+	DELETEARRAY(mInstanceBoxes);
+	mFreeHandles.Reset();
+	mPending.Reset();
+	mDirtyLeaves.Reset();
+	mOccluders.Reset();
+	mMaxNbHandles	= 0;
+	mNbHandles		= 0;
+	mNbInstances	= 0;
+	mNbRemoved		= 0;
+	mNbNodes		= 0;
+	mNbBoxes		= 0;
+	mHiZSize		= 0;
+	mNbLevels		= 0;
+	mTreeSize		= 0.0f;
+	mBuiltTreeSize	= 0.0f;
+	mDirty			= false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the number of bytes used by the scene.
+ *	\return		amount of bytes used
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword CullingScene::GetUsedBytes() const
+{
+	return	mMaxNbHandles*(sizeof(AABB) + sizeof(udword))
+		+	mNbNodes*(sizeof(CULL_Node) + sizeof(udword) + sizeof(bool))
+		+	mNbBoxes*sizeof(CULL_Box)
+		+	mHiZSize*sizeof(float)
+		+	mFreeHandles.GetUsedRam() + mPending.GetUsedRam() + mDirtyLeaves.GetUsedRam() + mOccluders.GetUsedRam();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Adds an instance. New instances are tested one by one until the tree is rebuilt, which happens
+ *	automatically when there are too many of them.
+ *	\param		box			[in] instance's world box
+ *	\return		instance handle, or INVALID_ID if out of memory
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword CullingScene::AddInstance(const AABB& box)
+{
+	udword Handle;
+	if(mFreeHandles.GetNbEntries())
+	{
+		Handle = mFreeHandles.GetLast();
+		mFreeHandles.DeleteLastEntry();
+	}
+	else
+	{
+		if(mNbHandles==mMaxNbHandles)
+		{
+			// Grow the instance arrays
+			const udword NewMax = mMaxNbHandles ? mMaxNbHandles*2 : 256;
+			AABB* NewBoxes = new AABB[NewMax];
+			udword* NewSlots = new udword[NewMax];
+			if(!NewBoxes || !NewSlots)
+			{
+				DELETEARRAY(NewSlots);
+				DELETEARRAY(NewBoxes);
+				return INVALID_ID;
+			}
+			if(mNbHandles)
+			{
+				CopyMemory(NewBoxes, mInstanceBoxes, mNbHandles*sizeof(AABB));
+				CopyMemory(NewSlots, mInstanceSlots, mNbHandles*sizeof(udword));
+			}
+			DELETEARRAY(mInstanceSlots);
+			DELETEARRAY(mInstanceBoxes);
+			mInstanceBoxes	= NewBoxes;
+			mInstanceSlots	= NewSlots;
+			mMaxNbHandles	= NewMax;
+		}
+		Handle = mNbHandles++;
+	}
+
+	mInstanceBoxes[Handle] = box;
+	mInstanceSlots[Handle] = CULL_PENDING|mPending.GetNbEntries();
+	mPending.Add(Handle);
+	mNbInstances++;
+	mDirty = true;
+	return Handle;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Removes an instance. Its handle can be reused by next AddInstance() calls.
+ *	\param		handle		[in] instance handle
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::RemoveInstance(udword handle)
+{
+	if(handle>=mNbHandles)	return false;
+	const udword Slot = mInstanceSlots[handle];
+	if(Slot==INVALID_ID)	return false;
+
+	if(Slot&CULL_PENDING)
+	{
+		// Move the last pending instance to the free entry
+		const udword Index = Slot&~CULL_PENDING;
+		mPending.DeleteIndex(Index);
+		if(Index<mPending.GetNbEntries())	mInstanceSlots[mPending[Index]] = CULL_PENDING|Index;
+	}
+	else
+	{
+		// Leave a hole in the leaf. It's refit by next Update(), and removed by next rebuild.
+		CULL_Box& Box = mBoxes[Slot];
+		Box.mHandle = INVALID_ID;
+		MarkDirty(Box.mLeaf);
+		mNbRemoved++;
+	}
+
+	mInstanceSlots[handle] = INVALID_ID;
+	mFreeHandles.Add(handle);
+	mNbInstances--;
+	mDirty = true;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Moves an instance. The tree is refit lazily, by next call to Update().
+ *	\param		handle		[in] instance handle
+ *	\param		box			[in] instance's new world box
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::UpdateInstance(udword handle, const AABB& box)
+{
+	if(handle>=mNbHandles)	return false;
+	const udword Slot = mInstanceSlots[handle];
+	if(Slot==INVALID_ID)	return false;
+
+	mInstanceBoxes[handle] = box;
+	if(!(Slot&CULL_PENDING))
+	{
+		CULL_Box& Box = mBoxes[Slot];
+		SetBox(Box, box);
+		MarkDirty(Box.mLeaf);
+	}
+	mDirty = true;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Recomputes the box of a leaf from its instances.
+ *	\param		index		[in] leaf index
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingScene::RefitLeaf(udword index)
+{
+	CULL_Node& Node = mNodes[index];
+
+	float Min[3], Max[3];
+	SetEmpty(Min, Max);
+	const CULL_Box* Box = mBoxes + Node.mData;
+	for(udword i=0;i<Node.mNbBoxes;i++, Box++)
+	{
+		if(Box->mHandle==INVALID_ID)	continue;
+		for(udword j=0;j<3;j++)
+		{
+			if(Box->mMin[j]<Min[j])	Min[j] = Box->mMin[j];
+			if(Box->mMax[j]>Max[j])	Max[j] = Box->mMax[j];
+		}
+	}
+
+	mTreeSize += GetArea(Min, Max) - GetArea(Node.mMin, Node.mMax);
+	for(udword j=0;j<3;j++)
+	{
+		Node.mMin[j] = Min[j];
+		Node.mMax[j] = Max[j];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Recomputes the box of an internal node from its children.
+ *	\param		index		[in] node index
+ *	\return		true if the box has changed
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::RefitNode(udword index)
+{
+	CULL_Node& Node = mNodes[index];
+	const CULL_Node& Pos = mNodes[Node.mData];
+	const CULL_Node& Neg = mNodes[Node.mData+1];
+
+	float Min[3], Max[3];
+	for(udword j=0;j<3;j++)
+	{
+		Min[j] = Pos.mMin[j]<Neg.mMin[j] ? Pos.mMin[j] : Neg.mMin[j];
+		Max[j] = Pos.mMax[j]>Neg.mMax[j] ? Pos.mMax[j] : Neg.mMax[j];
+	}
+
+	if(	Min[0]==Node.mMin[0] && Min[1]==Node.mMin[1] && Min[2]==Node.mMin[2]
+	&&	Max[0]==Node.mMax[0] && Max[1]==Node.mMax[1] && Max[2]==Node.mMax[2])	return false;
+
+	mTreeSize += GetArea(Min, Max) - GetArea(Node.mMin, Node.mMax);
+	for(udword j=0;j<3;j++)
+	{
+		Node.mMin[j] = Min[j];
+		Node.mMax[j] = Max[j];
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the tree after instances have moved, or rebuilds it when needed, i.e. when there are too many new
+ *	or removed instances, or when refits made the tree too loose. This is called by the Cull() methods, but
+ *	it can be called earlier, e.g. right after the instances have been updated.
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::Update()
+{
+	if(!mDirty)	return true;
+	mDirty = false;
+
+	// Rebuild when there are too many instances outside of the tree
+	const udword NbInTree = mNbBoxes - mNbRemoved;
+	if(mPending.GetNbEntries()*CULL_PENDING_RATIO > NbInTree || mNbRemoved*CULL_REMOVED_RATIO > mNbBoxes)	return Rebuild();
+
+	// Refit dirty leaves & their ancestors
+	const udword NbDirty = mDirtyLeaves.GetNbEntries();
+	if(NbDirty)
+	{
+		const udword* Dirty = mDirtyLeaves.GetEntries();
+		if(NbDirty*CULL_FULL_REFIT_RATIO > mNbNodes)
+		{
+			// Lots of changes: refit the whole tree in one linear pass. Children are always stored after their parent.
+			udword i = mNbNodes;
+			while(i--)
+			{
+				if(!mNodes[i].mNbBoxes)		RefitNode(i);
+				else if(mDirtyNodes[i])		RefitLeaf(i);
+			}
+			ZeroMemory(mDirtyNodes, mNbNodes*sizeof(bool));
+		}
+		else
+		{
+			// Few changes: walk up from each leaf, until a node doesn't change
+			for(udword i=0;i<NbDirty;i++)
+			{
+				RefitLeaf(Dirty[i]);
+				mDirtyNodes[Dirty[i]] = false;
+
+				udword Parent = mParents[Dirty[i]];
+				while(Parent!=INVALID_ID && RefitNode(Parent))	Parent = mParents[Parent];
+			}
+		}
+		mDirtyLeaves.Reset();
+	}
+
+	// Rebuild when the tree became too loose
+	if(mTreeSize > mBuiltTreeSize*mRebuildRatio)	return Rebuild();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Rebuilds the tree from all current instances.
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::Rebuild()
+{
+	mNbRebuilds++;
+
+	// Discard the old tree
+	DELETEARRAY(mBoxes);
+	DELETEARRAY(mDirtyNodes);
+	DELETEARRAY(mParents);
+	DELETEARRAY(mNodes);
+	mNbNodes		= 0;
+	mNbBoxes		= 0;
+	mNbRemoved		= 0;
+	mTreeSize		= 0.0f;
+	mBuiltTreeSize	= 0.0f;
+	mPending.Reset();
+	mDirtyLeaves.Reset();
+	if(!mNbInstances)	return true;
+
+	// Gather live instances. Until the new tree is ready, they're pending.
+	AABB* Boxes = new AABB[mNbInstances];
+	udword* Handles = new udword[mNbInstances];
+	if(!Boxes || !Handles)
+	{
+		DELETEARRAY(Handles);
+		DELETEARRAY(Boxes);
+		return false;
+	}
+	udword NbLive = 0;
+	for(udword i=0;i<mNbHandles;i++)
+	{
+		if(mInstanceSlots[i]==INVALID_ID)	continue;
+		mInstanceSlots[i] = CULL_PENDING|NbLive;
+		mPending.Add(i);
+		Boxes[NbLive] = mInstanceBoxes[i];
+		Handles[NbLive++] = i;
+	}
+
+	// Build a tree of boxes, with a few boxes per leaf
+	AABBTreeOfAABBsBuilder TB;
+	TB.mAABBArray			= Boxes;
+	TB.mNbPrimitives		= NbLive;
+	TB.mSettings.mLimit		= CULL_LEAF_SIZE;
+	TB.mSettings.mRules		= SPLIT_SPLATTER_POINTS|SPLIT_GEOM_CENTER;
+	AABBTree Tree;
+	bool Status = Tree.Build(&TB);
+
+	// Flatten the tree, breadth-first, so that children are stored next to each other
+	const AABBTreeNode** Queue = null;
+	if(Status)
+	{
+		mNbNodes	= Tree.GetNbNodes();
+		mNodes		= new CULL_Node[mNbNodes];
+		mParents	= new udword[mNbNodes];
+		mDirtyNodes	= new bool[mNbNodes];
+		mBoxes		= new CULL_Box[NbLive];
+		Queue		= new const AABBTreeNode*[mNbNodes];
+		Status		= mNodes && mParents && mDirtyNodes && mBoxes && Queue;
+	}
+	if(Status)
+	{
+		ZeroMemory(mDirtyNodes, mNbNodes*sizeof(bool));
+
+		Queue[0]	= &Tree;
+		mParents[0]	= INVALID_ID;
+		udword NbQueued = 1;
+		for(udword i=0;i<mNbNodes;i++)
+		{
+			const AABBTreeNode* Current = Queue[i];
+			CULL_Node& Node = mNodes[i];
+			SetEmpty(Node.mMin, Node.mMax);
+
+			if(Current->IsLeaf())
+			{
+				Node.mData		= mNbBoxes;
+				Node.mNbBoxes	= Current->GetNbPrimitives();
+				const udword* Prims = Current->GetPrimitives();
+				for(udword j=0;j<Node.mNbBoxes;j++)
+				{
+					CULL_Box& Box = mBoxes[mNbBoxes];
+					SetBox(Box, Boxes[Prims[j]]);
+					Box.mHandle	= Handles[Prims[j]];
+					Box.mLeaf	= i;
+					mInstanceSlots[Box.mHandle] = mNbBoxes++;
+				}
+			}
+			else
+			{
+				Node.mData		= NbQueued;
+				Node.mNbBoxes	= 0;
+				mParents[NbQueued]		= i;
+				Queue[NbQueued++]		= Current->GetPos();
+				mParents[NbQueued]		= i;
+				Queue[NbQueued++]		= Current->GetNeg();
+			}
+		}
+		mPending.Reset();
+
+		// Compute the boxes, bottom-up
+		udword i = mNbNodes;
+		while(i--)
+		{
+			if(mNodes[i].mNbBoxes)	RefitLeaf(i);
+			else					RefitNode(i);
+		}
+		mBuiltTreeSize = mTreeSize;
+	}
+	else
+	{
+		// Keep all instances pending
+		DELETEARRAY(mBoxes);
+		DELETEARRAY(mDirtyNodes);
+		DELETEARRAY(mParents);
+		DELETEARRAY(mNodes);
+		mNbNodes = 0;
+	}
+
+	DELETEARRAY(Queue);
+	DELETEARRAY(Handles);
+	DELETEARRAY(Boxes);
+	return Status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Adds occluder triangles, used by the Cull() methods taking a view-projection matrix. Occluders should be
+ *	simple, closed meshes (walls, terrain chunks, big buildings) lying inside the objects they stand for.
+ *	Triangles are copied in world space.
+ *	\param		verts		[in] vertices
+ *	\param		indices		[in] 3 vertex indices per triangle, or null for 3 vertices per triangle
+ *	\param		nb_tris		[in] number of triangles
+ *	\param		world		[in] occluder's world matrix, or null
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingScene::AddOccluder(const Point* verts, const udword* indices, udword nb_tris, const Matrix4x4* world)
+{
+	for(udword i=0;i<nb_tris*3;i++)
+	{
+		Point p = verts[indices ? indices[i] : i];
+		if(world)	p *= *world;
+		mOccluders.Add(p.x).Add(p.y).Add(p.z);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Culls the scene against a view. The frustum planes are extracted from the view-projection matrix, and the
+ *	occluders are rendered to a hierarchical-Z buffer. Nodes & instances hidden by occluders are discarded.
+ *	Matrices follow the ICE conventions (row vectors, clip = world * view_proj) & the D3D clip space (0<=z<=w).
+ *	\param		view_proj	[in] view-projection matrix
+ *	\param		visible		[out] handles of visible instances
+ *	\param		occlusion	[in] true to use the occluders
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::Cull(const Matrix4x4& view_proj, Container& visible, bool occlusion)
+{
+	if(!Update())	return false;
+
+	// Extract the frustum planes (Gribb & Hartmann). Near plane first, it discards half the scene.
+	const Matrix4x4& m = view_proj;
+	Plane Planes[6];
+	SetFrustumPlane(Planes[0], m.m[0][2], m.m[1][2], m.m[2][2], m.m[3][2]);
+	SetFrustumPlane(Planes[1], m.m[0][3]+m.m[0][0], m.m[1][3]+m.m[1][0], m.m[2][3]+m.m[2][0], m.m[3][3]+m.m[3][0]);
+	SetFrustumPlane(Planes[2], m.m[0][3]-m.m[0][0], m.m[1][3]-m.m[1][0], m.m[2][3]-m.m[2][0], m.m[3][3]-m.m[3][0]);
+	SetFrustumPlane(Planes[3], m.m[0][3]+m.m[0][1], m.m[1][3]+m.m[1][1], m.m[2][3]+m.m[2][1], m.m[3][3]+m.m[3][1]);
+	SetFrustumPlane(Planes[4], m.m[0][3]-m.m[0][1], m.m[1][3]-m.m[1][1], m.m[2][3]-m.m[2][1], m.m[3][3]-m.m[3][1]);
+	SetFrustumPlane(Planes[5], m.m[0][3]-m.m[0][2], m.m[1][3]-m.m[1][2], m.m[2][3]-m.m[2][2], m.m[3][3]-m.m[3][2]);
+	SetupPlanes(Planes, 6);
+
+	mViewProj	= view_proj;
+	mOcclusion	= occlusion && RenderOccluders();
+
+	CullScene(visible);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Culls the scene against a set of planes. Planes are the same as for PlanesCollider, i.e. normals point
+ *	outwards & instances are visible when they're on the negative side of all planes.
+ *	\param		planes		[in] list of planes in world space
+ *	\param		nb_planes	[in] number of planes, up to CULL_MAX_PLANES
+ *	\param		visible		[out] handles of visible instances
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::Cull(const Plane* planes, udword nb_planes, Container& visible)
+{
+	if(!planes || !nb_planes || nb_planes>CULL_MAX_PLANES)	return false;
+	if(!Update())	return false;
+
+	SetupPlanes(planes, nb_planes);
+	mOcclusion = false;
+
+	CullScene(visible);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Stores the culling planes as structure-of-arrays.
+ *	\param		planes		[in] list of planes
+ *	\param		nb_planes	[in] number of planes
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingScene::SetupPlanes(const Plane* planes, udword nb_planes)
+{
+	mNbPlaneGroups	= (nb_planes+3)>>2;
+	mClipMask		= nb_planes==32 ? 0xffffffff : (1<<nb_planes)-1;
+
+	for(udword i=0;i<mNbPlaneGroups*4;i++)
+	{
+		CULL_Planes& P = mPlanes[i>>2];
+		const udword j = i&3;
+		// Unused lanes are masked out
+		const Plane Current = i<nb_planes ? planes[i] : Plane(0.0f, 0.0f, 0.0f, 0.0f);
+		P.mNX[j]	= Current.n.x;
+		P.mNY[j]	= Current.n.y;
+		P.mNZ[j]	= Current.n.z;
+		P.mD[j]		= Current.d;
+		P.mAbsNX[j]	= fabsf(Current.n.x);
+		P.mAbsNY[j]	= fabsf(Current.n.y);
+		P.mAbsNZ[j]	= fabsf(Current.n.z);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Planes-AABB test, same as PlanesCollider::PlanesAABBOverlap(). The SSE2 version tests 4 planes at a time.
+ *	\param		min				[in] box's min point
+ *	\param		max				[in] box's max point
+ *	\param		out_clip_mask	[out] bitmask for planes crossing the box
+ *	\param		in_clip_mask	[in] bitmask for active planes
+ *	\return		TRUE if the box is not fully outside a plane
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL CullingScene::PlanesTest(const float* min, const float* max, udword& out_clip_mask, udword in_clip_mask) const
+{
+	udword TmpOutClipMask = 0;
+#ifdef OPC_SIMD_SSE2
+	const __m128 Half		= _mm_set1_ps(0.5f);
+	const __m128 Min		= SIMD_LoadPoint(*(const Point*)min);
+	const __m128 Max		= SIMD_LoadPoint(*(const Point*)max);
+	const __m128 Center		= _mm_mul_ps(_mm_add_ps(Max, Min), Half);
+	const __m128 Extents	= _mm_mul_ps(_mm_sub_ps(Max, Min), Half);
+	const __m128 CX = CULL_SPLAT(Center, 0);
+	const __m128 CY = CULL_SPLAT(Center, 1);
+	const __m128 CZ = CULL_SPLAT(Center, 2);
+	const __m128 EX = CULL_SPLAT(Extents, 0);
+	const __m128 EY = CULL_SPLAT(Extents, 1);
+	const __m128 EZ = CULL_SPLAT(Extents, 2);
+
+	for(udword i=0;i<mNbPlaneGroups;i++)
+	{
+		const udword Active = (in_clip_mask>>(i*4))&15;
+		if(!Active)	continue;
+
+		const CULL_Planes& P = mPlanes[i];
+		const __m128 NP = _mm_add_ps(_mm_add_ps(_mm_mul_ps(EX, _mm_loadu_ps(P.mAbsNX)), _mm_mul_ps(EY, _mm_loadu_ps(P.mAbsNY))), _mm_mul_ps(EZ, _mm_loadu_ps(P.mAbsNZ)));
+		const __m128 MP = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(CX, _mm_loadu_ps(P.mNX)), _mm_mul_ps(CY, _mm_loadu_ps(P.mNY))), _mm_mul_ps(CZ, _mm_loadu_ps(P.mNZ))), _mm_loadu_ps(P.mD));
+
+		// Near vertex behind one of the planes => no intersection
+		if(_mm_movemask_ps(_mm_cmplt_ps(NP, MP)) & Active)	return FALSE;
+		// Near and far vertices on different sides of a plane => update the clip mask
+		TmpOutClipMask |= (_mm_movemask_ps(_mm_cmplt_ps(SIMD_Neg(NP), MP)) & Active)<<(i*4);
+	}
+#else
+	float Center[3], Extents[3];
+	for(udword j=0;j<3;j++)
+	{
+		Center[j]	= (max[j] + min[j])*0.5f;
+		Extents[j]	= (max[j] - min[j])*0.5f;
+	}
+
+	udword Mask = 1;
+	for(udword i=0;i<mNbPlaneGroups*4;i++, Mask+=Mask)
+	{
+		if(!(in_clip_mask & Mask))	continue;
+
+		const CULL_Planes& P = mPlanes[i>>2];
+		const udword j = i&3;
+		const float NP = Extents[0]*P.mAbsNX[j] + Extents[1]*P.mAbsNY[j] + Extents[2]*P.mAbsNZ[j];
+		const float MP = Center[0]*P.mNX[j] + Center[1]*P.mNY[j] + Center[2]*P.mNZ[j] + P.mD[j];
+
+		if(NP < MP)		return FALSE;
+		if((-NP) < MP)	TmpOutClipMask |= Mask;
+	}
+#endif
+	out_clip_mask = TmpOutClipMask;
+	return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Renders the occluders to the depth buffer, and builds the hierarchical-Z levels.
+ *	\return		true if some pixels are covered by occluders
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::RenderOccluders()
+{
+	const udword NbTris = mOccluders.GetNbEntries()/9;
+	if(!NbTris || !mWidth || !mHeight)	return false;
+
+	// Setup the levels. Each level halves the resolution of the previous one, rounding up.
+	udword Width = mWidth;
+	udword Height = mHeight;
+	udword Size = 0;
+	mNbLevels = 0;
+	while(mNbLevels<CULL_MAX_LEVELS)
+	{
+		mLevelOffsets[mNbLevels]	= Size;
+		mLevelWidths[mNbLevels]		= Width;
+		mLevelHeights[mNbLevels]	= Height;
+		mNbLevels++;
+		Size += Width*Height;
+		if(Width==1 && Height==1)	break;
+		Width	= (Width+1)>>1;
+		Height	= (Height+1)>>1;
+	}
+	if(Size>mHiZSize)
+	{
+		DELETEARRAY(mHiZ);
+		mHiZSize = 0;
+		mHiZ = new float[Size];
+		if(!mHiZ)	return false;
+		mHiZSize = Size;
+	}
+
+	// Clear the depth buffer
+	for(udword i=0;i<mWidth*mHeight;i++)	mHiZ[i] = MAX_FLOAT;
+
+	// Render the occluders
+	bool Rendered = false;
+	const float* Tri = (const float*)mOccluders.GetEntries();
+	for(udword i=0;i<NbTris;i++, Tri+=9)
+	{
+		HPoint Verts[3];
+		for(udword j=0;j<3;j++)	Verts[j] = HPoint(Tri[j*3+0], Tri[j*3+1], Tri[j*3+2], 1.0f) * mViewProj;
+
+		// Skip triangles crossing the camera plane. Clipping them isn't worth it for occluders.
+		if(Verts[0].w<=CULL_MIN_W || Verts[1].w<=CULL_MIN_W || Verts[2].w<=CULL_MIN_W)	continue;
+
+		// Skip triangles fully outside one of the frustum planes
+		udword Out = 0x3f;
+		for(udword j=0;j<3;j++)
+		{
+			const HPoint& v = Verts[j];
+			udword Code = 0;
+			if(v.x<-v.w)	Code |= 1;
+			if(v.x>v.w)		Code |= 2;
+			if(v.y<-v.w)	Code |= 4;
+			if(v.y>v.w)		Code |= 8;
+			if(v.z>v.w)		Code |= 16;
+			Out &= Code;
+		}
+		if(Out)	continue;
+
+		if(RasterizeTriangle(Verts))	Rendered = true;
+	}
+	if(!Rendered)	return false;
+
+	// Build the max-depth pyramid
+	for(udword l=1;l<mNbLevels;l++)
+	{
+		const float* Src = mHiZ + mLevelOffsets[l-1];
+		float* Dst = mHiZ + mLevelOffsets[l];
+		const udword SrcWidth = mLevelWidths[l-1];
+		const udword SrcHeight = mLevelHeights[l-1];
+		for(udword y=0;y<mLevelHeights[l];y++)
+		{
+			const float* Row0 = Src + (y*2)*SrcWidth;
+			const float* Row1 = Src + (y*2+1<SrcHeight ? y*2+1 : y*2)*SrcWidth;
+			for(udword x=0;x<mLevelWidths[l];x++)
+			{
+				const udword x0 = x*2;
+				const udword x1 = x0+1<SrcWidth ? x0+1 : x0;
+				float Depth = Row0[x0];
+				if(Row0[x1]>Depth)	Depth = Row0[x1];
+				if(Row1[x0]>Depth)	Depth = Row1[x0];
+				if(Row1[x1]>Depth)	Depth = Row1[x1];
+				*Dst++ = Depth;
+			}
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Rasterizes an occluder triangle to the depth buffer. Only the pixels fully covered by the triangle are written,
+ *	with the triangle's max depth, so that the depth buffer never hides more than the occluders.
+ *	\param		verts		[in] triangle's vertices in clip space, in front of the camera
+ *	\return		true if some pixels have been written
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CullingScene::RasterizeTriangle(const HPoint* verts)
+{
+	const float Width = float(mWidth);
+	const float Height = float(mHeight);
+
+	float X[3], Y[3];
+	float Depth = -MAX_FLOAT;
+	for(udword i=0;i<3;i++)
+	{
+		const float w = verts[i].w;
+		X[i] = ToScreen(verts[i].x/w, Width);
+		Y[i] = ToScreen(-verts[i].y/w, Height);
+		const float z = verts[i].z/w;
+		if(z>Depth)	Depth = z;
+	}
+
+	// Occluders are double-sided: make the triangle counter-clockwise
+	const float Area = (X[1]-X[0])*(Y[2]-Y[0]) - (Y[1]-Y[0])*(X[2]-X[0]);
+	if(Area==0.0f)	return false;
+	if(Area<0.0f)
+	{
+		TSwap(X[1], X[2]);
+		TSwap(Y[1], Y[2]);
+	}
+
+	// Bounding rectangle, clipped to the screen
+	const float MinX = MIN(X[0], MIN(X[1], X[2]));
+	const float MaxX = MAX(X[0], MAX(X[1], X[2]));
+	const float MinY = MIN(Y[0], MIN(Y[1], Y[2]));
+	const float MaxY = MAX(Y[0], MAX(Y[1], Y[2]));
+	if(MaxX<0.0f || MaxY<0.0f || MinX>=Width || MinY>=Height)	return false;
+	const udword x0 = MinX<0.0f ? 0 : udword(MinX);
+	const udword y0 = MinY<0.0f ? 0 : udword(MinY);
+	const udword x1 = MaxX>=Width ? mWidth-1 : udword(MaxX);
+	const udword y1 = MaxY>=Height ? mHeight-1 : udword(MaxY);
+
+	// Edge functions E(x, y) = A*x + B*y + C, positive inside. A pixel is fully covered when the edge functions at
+	// its center are larger than the distance to its farthest corner. C includes both the pixel center offset and
+	// that distance, so that pixel (x, y) is covered when E(x, y)>=0 for the 3 edges.
+	float A[3], B[3], C[3];
+	for(udword i=0;i<3;i++)
+	{
+		const udword j = i==2 ? 0 : i+1;
+		A[i] = Y[i] - Y[j];
+		B[i] = X[j] - X[i];
+		C[i] = -(A[i]*(X[i] - 0.5f) + B[i]*(Y[i] - 0.5f)) - (fabsf(A[i]) + fabsf(B[i]))*0.5f;
+	}
+
+	// Each row is a span, found by solving A*x >= -(B*y + C) for the 3 edges
+	bool Written = false;
+	for(udword y=y0;y<=y1;y++)
+	{
+		float Start = float(x0);
+		float End = float(x1);
+		for(udword i=0;i<3;i++)
+		{
+			const float R = -(B[i]*float(y) + C[i]);
+			if(A[i]>0.0f)
+			{
+				const float Bound = R/A[i];
+				if(Bound>Start)	Start = Bound;
+			}
+			else if(A[i]<0.0f)
+			{
+				const float Bound = R/A[i];
+				if(Bound<End)	End = Bound;
+			}
+			else if(R>0.0f)	End = -1.0f;
+		}
+		Start = ceilf(Start);
+		if(Start>End)	continue;
+
+		float* Row = mHiZ + y*mWidth;
+		const udword Last = udword(End);
+		for(udword x=udword(Start);x<=Last;x++)
+		{
+			if(Depth<Row[x])	Row[x] = Depth;
+		}
+		Written = true;
+	}
+	return Written;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Hierarchical-Z test. The box is projected to the screen, and compared to the pyramid level where it covers at
+ *	most 2x2 texels.
+ *	\param		min			[in] box's min point
+ *	\param		max			[in] box's max point
+ *	\return		TRUE if the box is hidden by the occluders
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL CullingScene::OcclusionTest(const float* min, const float* max) const
+{
+	// Project the 8 corners, and compute their bounds in normalized device coordinates
+	float PMin[4], PMax[4];
+#ifdef OPC_SIMD_SSE2
+	const __m128 Half		= _mm_set1_ps(0.5f);
+	const __m128 Min		= SIMD_LoadPoint(*(const Point*)min);
+	const __m128 Max		= SIMD_LoadPoint(*(const Point*)max);
+	const __m128 Center		= _mm_mul_ps(_mm_add_ps(Max, Min), Half);
+	const __m128 Extents	= _mm_mul_ps(_mm_sub_ps(Max, Min), Half);
+	const __m128 R0 = _mm_loadu_ps(mViewProj.m[0]);
+	const __m128 R1 = _mm_loadu_ps(mViewProj.m[1]);
+	const __m128 R2 = _mm_loadu_ps(mViewProj.m[2]);
+	const __m128 R3 = _mm_loadu_ps(mViewProj.m[3]);
+	const __m128 Base = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(CULL_SPLAT(Center, 0), R0), _mm_mul_ps(CULL_SPLAT(Center, 1), R1)), _mm_mul_ps(CULL_SPLAT(Center, 2), R2)), R3);
+	const __m128 AX = _mm_mul_ps(CULL_SPLAT(Extents, 0), R0);
+	const __m128 AY = _mm_mul_ps(CULL_SPLAT(Extents, 1), R1);
+	const __m128 AZ = _mm_mul_ps(CULL_SPLAT(Extents, 2), R2);
+	const __m128 MinW = _mm_set_ss(CULL_MIN_W);
+
+	__m128 Lo = _mm_set1_ps(MAX_FLOAT);
+	__m128 Hi = _mm_set1_ps(-MAX_FLOAT);
+	for(udword i=0;i<8;i++)
+	{
+		__m128 V = i&1 ? _mm_add_ps(Base, AX) : _mm_sub_ps(Base, AX);
+		V = i&2 ? _mm_add_ps(V, AY) : _mm_sub_ps(V, AY);
+		V = i&4 ? _mm_add_ps(V, AZ) : _mm_sub_ps(V, AZ);
+		const __m128 W = CULL_SPLAT(V, 3);
+		// Boxes crossing the camera plane are visible
+		if(_mm_comile_ss(W, MinW))	return FALSE;
+		const __m128 P = _mm_div_ps(V, W);
+		Lo = _mm_min_ps(Lo, P);
+		Hi = _mm_max_ps(Hi, P);
+	}
+	_mm_storeu_ps(PMin, Lo);
+	_mm_storeu_ps(PMax, Hi);
+#else
+	float Center[3], Extents[3];
+	for(udword j=0;j<3;j++)
+	{
+		Center[j]	= (max[j] + min[j])*0.5f;
+		Extents[j]	= (max[j] - min[j])*0.5f;
+	}
+	const float (*m)[4] = mViewProj.m;
+	float Base[4], AX[4], AY[4], AZ[4];
+	for(udword j=0;j<4;j++)
+	{
+		Base[j]	= Center[0]*m[0][j] + Center[1]*m[1][j] + Center[2]*m[2][j] + m[3][j];
+		AX[j]	= Extents[0]*m[0][j];
+		AY[j]	= Extents[1]*m[1][j];
+		AZ[j]	= Extents[2]*m[2][j];
+	}
+
+	for(udword j=0;j<3;j++)
+	{
+		PMin[j] = MAX_FLOAT;
+		PMax[j] = -MAX_FLOAT;
+	}
+	for(udword i=0;i<8;i++)
+	{
+		float V[4];
+		for(udword j=0;j<4;j++)
+		{
+			V[j] = i&1 ? Base[j] + AX[j] : Base[j] - AX[j];
+			V[j] = i&2 ? V[j] + AY[j] : V[j] - AY[j];
+			V[j] = i&4 ? V[j] + AZ[j] : V[j] - AZ[j];
+		}
+		// Boxes crossing the camera plane are visible
+		if(V[3]<=CULL_MIN_W)	return FALSE;
+		for(udword j=0;j<3;j++)
+		{
+			const float p = V[j]/V[3];
+			if(p<PMin[j])	PMin[j] = p;
+			if(p>PMax[j])	PMax[j] = p;
+		}
+	}
+#endif
+
+	// Screen rectangle. Y goes down on screen.
+	const float Width = float(mWidth);
+	const float Height = float(mHeight);
+	const float MinX = ToScreen(PMin[0], Width);
+	const float MaxX = ToScreen(PMax[0], Width);
+	const float MinY = ToScreen(-PMax[1], Height);
+	const float MaxY = ToScreen(-PMin[1], Height);
+	if(MaxX<0.0f || MaxY<0.0f || MinX>=Width || MinY>=Height)	return FALSE;
+	const udword x0 = MinX<0.0f ? 0 : udword(MinX);
+	const udword y0 = MinY<0.0f ? 0 : udword(MinY);
+	const udword x1 = MaxX>=Width ? mWidth-1 : udword(MaxX);
+	const udword y1 = MaxY>=Height ? mHeight-1 : udword(MaxY);
+
+	// Pick the level where the rectangle covers at most 2x2 texels
+	const udword Span = MAX(x1-x0, y1-y0);
+	udword Level = 0;
+	while((Span>>Level) && Level<mNbLevels-1)	Level++;
+
+	// The box is hidden if its nearest point is behind the occluders in all texels
+	const float Depth = PMin[2];
+	const float* Texels = mHiZ + mLevelOffsets[Level];
+	const udword LevelWidth = mLevelWidths[Level];
+	for(udword y=y0>>Level;y<=y1>>Level;y++)
+	{
+		const float* Row = Texels + y*LevelWidth;
+		for(udword x=x0>>Level;x<=x1>>Level;x++)
+		{
+			if(Depth<=Row[x])	return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Culls the tree & the pending instances, with the current planes & occlusion settings.
+ *	\param		visible		[out] handles of visible instances
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingScene::CullScene(Container& visible)
+{
+	visible.Reset();
+	mVisible		= &visible;
+	mNbNodeTests	= 0;
+	mNbBoxTests		= 0;
+	mNbOccluded		= 0;
+
+	if(mNbNodes)	CullNode(0, mClipMask);
+
+	// Instances added since last rebuild
+	const udword NbPending = mPending.GetNbEntries();
+	const udword* Pending = mPending.GetEntries();
+	for(udword i=0;i<NbPending;i++)
+	{
+		CULL_Box Box;
+		SetBox(Box, mInstanceBoxes[Pending[i]]);
+		mNbBoxTests++;
+
+		udword ClipMask;
+		if(!PlanesTest(Box.mMin, Box.mMax, ClipMask, mClipMask))	continue;
+		if(mOcclusion && OcclusionTest(Box.mMin, Box.mMax))
+		{
+			mNbOccluded++;
+			continue;
+		}
+		visible.Add(Pending[i]);
+	}
+	mVisible = null;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Recursive culling of the tree.
+ *	\param		index		[in] node index
+ *	\param		clip_mask	[in] planes crossing the parent node
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingScene::CullNode(udword index, udword clip_mask)
+{
+	const CULL_Node& Node = mNodes[index];
+	// Empty nodes, after removals
+	if(Node.mMin[0]>Node.mMax[0])	return;
+
+	// Frustum test, only against the planes crossing the parent
+	mNbNodeTests++;
+	if(clip_mask && !PlanesTest(Node.mMin, Node.mMax, clip_mask, clip_mask))	return;
+	if(mOcclusion && OcclusionTest(Node.mMin, Node.mMax))
+	{
+		mNbOccluded++;
+		return;
+	}
+
+	if(!Node.mNbBoxes)
+	{
+		CullNode(Node.mData, clip_mask);
+		CullNode(Node.mData+1, clip_mask);
+		return;
+	}
+
+	const CULL_Box* Box = mBoxes + Node.mData;
+	for(udword i=0;i<Node.mNbBoxes;i++, Box++)
+	{
+		if(Box->mHandle==INVALID_ID)	continue;
+
+		if(clip_mask)
+		{
+			mNbBoxTests++;
+			udword BoxClipMask;
+			if(!PlanesTest(Box->mMin, Box->mMax, BoxClipMask, clip_mask))	continue;
+		}
+		// Single-box leaves have already been tested
+		if(mOcclusion && Node.mNbBoxes>1 && OcclusionTest(Box->mMin, Box->mMax))
+		{
+			mNbOccluded++;
+			continue;
+		}
+		mVisible->Add(Box->mHandle);
+	}
+}
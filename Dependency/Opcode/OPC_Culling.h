@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains a scene-level culling engine: frustum & occlusion culling for large sets of instances.
+ *	\file		OPC_Culling.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_CULLING_H__
+#define __OPC_CULLING_H__
+
+	#define CULL_MAX_PLANES		32		//!< Max number of culling planes (one bit per plane in clip masks)
+	#define CULL_MAX_LEVELS		16		//!< Max number of hierarchical-Z levels
+
+	//! A node of the culling tree. Leaves have boxes, other nodes have two children stored next to each other.
+	struct CULL_Node
+	{
+		float	mMin[3];
+		udword	mData;			//!< First child for internal nodes, first box for leaves
+		float	mMax[3];
+		udword	mNbBoxes;		//!< Number of boxes for leaves, 0 for internal nodes
+	};
+
+	//! An instance box, stored in leaf order
+	struct CULL_Box
+	{
+		float	mMin[3];
+		udword	mHandle;		//!< Instance handle, or INVALID_ID for removed instances
+		float	mMax[3];
+		udword	mLeaf;			//!< Leaf containing the box
+	};
+
+	//! 4 culling planes, as structure-of-arrays
+	struct CULL_Planes
+	{
+		float	mNX[4];
+		float	mNY[4];
+		float	mNZ[4];
+		float	mD[4];
+		float	mAbsNX[4];
+		float	mAbsNY[4];
+		float	mAbsNZ[4];
+	};
+
+	class OPCODE_API CullingScene
+	{
+		public:
+		// Constructor / Destructor
+								CullingScene();
+								~CullingScene();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Adds an instance. New instances are tested one by one until the tree is rebuilt, which happens
+		 *	automatically when there are too many of them.
+		 *	\param		box			[in] instance's world box
+		 *	\return		instance handle, or INVALID_ID if out of memory
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				udword			AddInstance(const AABB& box);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Removes an instance. Its handle can be reused by next AddInstance() calls.
+		 *	\param		handle		[in] instance handle
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			RemoveInstance(udword handle);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Moves an instance. The tree is refit lazily, by next call to Update().
+		 *	\param		handle		[in] instance handle
+		 *	\param		box			[in] instance's new world box
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			UpdateInstance(udword handle, const AABB& box);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Refits the tree after instances have moved, or rebuilds it when needed, i.e. when there are too many new
+		 *	or removed instances, or when refits made the tree too loose. This is called by the Cull() methods, but
+		 *	it can be called earlier, e.g. right after the instances have been updated.
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			Update();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Adds occluder triangles, used by the Cull() methods taking a view-projection matrix. Occluders should be
+		 *	simple, closed meshes (walls, terrain chunks, big buildings) lying inside the objects they stand for.
+		 *	Triangles are copied in world space.
+		 *	\param		verts		[in] vertices
+		 *	\param		indices		[in] 3 vertex indices per triangle, or null for 3 vertices per triangle
+		 *	\param		nb_tris		[in] number of triangles
+		 *	\param		world		[in] occluder's world matrix, or null
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				void			AddOccluder(const Point* verts, const udword* indices, udword nb_tris, const Matrix4x4* world=null);
+		inline_	void			ResetOccluders()					{ mOccluders.Reset();			}
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Culls the scene against a view. The frustum planes are extracted from the view-projection matrix, and the
+		 *	occluders are rendered to a hierarchical-Z buffer. Nodes & instances hidden by occluders are discarded.
+		 *	Matrices follow the ICE conventions (row vectors, clip = world * view_proj) & the D3D clip space (0<=z<=w).
+		 *	\param		view_proj	[in] view-projection matrix
+		 *	\param		visible		[out] handles of visible instances
+		 *	\param		occlusion	[in] true to use the occluders
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			Cull(const Matrix4x4& view_proj, Container& visible, bool occlusion=true);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Culls the scene against a set of planes. Planes are the same as for PlanesCollider, i.e. normals point
+		 *	outwards & instances are visible when they're on the negative side of all planes.
+		 *	\param		planes		[in] list of planes in world space
+		 *	\param		nb_planes	[in] number of planes, up to CULL_MAX_PLANES
+		 *	\param		visible		[out] handles of visible instances
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			Cull(const Plane* planes, udword nb_planes, Container& visible);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: sets the hierarchical-Z buffer resolution. Occluders are rendered at this resolution.
+		 *	\param		width		[in] width in pixels
+		 *	\param		height		[in] height in pixels
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_	void			SetOcclusionResolution(udword width, udword height)	{ mWidth = width;	mHeight = height;	}
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: the tree is rebuilt when refits make it larger than rebuild_ratio times the size it had after
+		 *	last rebuild. The size of a tree is the sum of the areas of its nodes.
+		 *	\param		rebuild_ratio	[in] max growth of the tree before it's rebuilt
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_	void			SetRebuildRatio(float rebuild_ratio)		{ mRebuildRatio = rebuild_ratio;	}
+
+		// Data access
+		inline_	udword			GetNbInstances()	const	{ return mNbInstances;			}
+		inline_	udword			GetNbNodes()		const	{ return mNbNodes;				}
+		inline_	udword			GetNbRebuilds()		const	{ return mNbRebuilds;			}
+		// Stats for last Cull() call
+		inline_	udword			GetNbNodeTests()	const	{ return mNbNodeTests;			}
+		inline_	udword			GetNbBoxTests()		const	{ return mNbBoxTests;			}
+		inline_	udword			GetNbOccluded()		const	{ return mNbOccluded;			}	//!< Number of nodes & instances hidden by occluders
+				udword			GetUsedBytes()		const;
+
+				void			Release();
+		private:
+		// Instances, indexed by handle
+				udword			mMaxNbHandles;
+				udword			mNbHandles;
+				AABB*			mInstanceBoxes;
+				udword*			mInstanceSlots;		//!< Box index, or CULL_PENDING|pending index, or INVALID_ID for free handles
+				udword			mNbInstances;
+				Container		mFreeHandles;
+				Container		mPending;			//!< Instances added since last rebuild
+				udword			mNbRemoved;			//!< Instances removed since last rebuild
+		// Tree
+				udword			mNbNodes;
+				CULL_Node*		mNodes;
+				udword*			mParents;			//!< Parent of each node, INVALID_ID for the root
+				bool*			mDirtyNodes;		//!< Leaves to refit
+				Container		mDirtyLeaves;
+				udword			mNbBoxes;
+				CULL_Box*		mBoxes;
+				float			mTreeSize;			//!< Current sum of node areas
+				float			mBuiltTreeSize;		//!< Sum of node areas after last rebuild
+				udword			mNbRebuilds;
+				bool			mDirty;				//!< Instances have changed since last Update()
+		// Culling
+				CULL_Planes		mPlanes[CULL_MAX_PLANES/4];
+				udword			mNbPlaneGroups;
+				udword			mClipMask;			//!< All planes
+				Matrix4x4		mViewProj;
+				Container		mOccluders;			//!< World-space occluder triangles, 9 floats per triangle
+				bool			mOcclusion;			//!< Occlusion is enabled for current query
+		// Hierarchical-Z buffer, one max depth per texel. Level 0 is the depth buffer.
+				udword			mWidth;
+				udword			mHeight;
+				float*			mHiZ;
+				udword			mHiZSize;			//!< Allocated size of mHiZ, in floats
+				udword			mNbLevels;
+				udword			mLevelOffsets[CULL_MAX_LEVELS];
+				udword			mLevelWidths[CULL_MAX_LEVELS];
+				udword			mLevelHeights[CULL_MAX_LEVELS];
+		// Settings
+				float			mRebuildRatio;
+		// Stats
+				udword			mNbNodeTests;
+				udword			mNbBoxTests;
+				udword			mNbOccluded;
+				Container*		mVisible;			//!< Output of current query
+		// Internal methods
+				bool			Rebuild();
+				void			RefitLeaf(udword index);
+				bool			RefitNode(udword index);
+				void			SetupPlanes(const Plane* planes, udword nb_planes);
+				bool			RenderOccluders();
+				bool			RasterizeTriangle(const HPoint* verts);
+				void			CullScene(Container& visible);
+				void			CullNode(udword index, udword clip_mask);
+		inline_	void			MarkDirty(udword leaf)
+								{
+									if(!mDirtyNodes[leaf])
+									{
+										mDirtyNodes[leaf] = true;
+										mDirtyLeaves.Add(leaf);
+									}
+								}
+		inline_	BOOL			PlanesTest(const float* min, const float* max, udword& out_clip_mask, udword in_clip_mask)	const;
+		inline_	BOOL			OcclusionTest(const float* min, const float* max)	const;
+	};
+
+#endif // __OPC_CULLING_H__
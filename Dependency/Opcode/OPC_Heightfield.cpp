@@ -0,0 +1,433 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for heightfields, i.e. regular grids of heights such as terrain chunks.
+ *	\file		OPC_Heightfield.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	A heightfield is a regular grid of heights. It doesn't need a tree: the triangles of a cell are computed on the fly
+ *	from the heights, and a pyramid of min/max heights (one entry per cell, then one per 2x2 block, and so on) is used
+ *	to discard whole blocks of cells at once.
+ *
+ *	Cells are either made of 2 triangles, or of 4 triangles fanned around a center height. The latter is the layout of
+ *	ADT terrain chunks, whose MCVT heights interleave 9 corner heights and 8 center heights per row. Such chunks can be
+ *	used directly, with 8x8 cells and HeightfieldDesc::mInterleaved set. ADT holes cover 2x2 cells each, so they must
+ *	be expanded to one flag per cell.
+ *
+ *	\class		Heightfield
+ *	\version	1.3
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+using namespace Opcode;
+
+#define HF_MAX_CELLS	16384	//!< Max number of cells per side
+
+//! Query range used by Heightfield::WalkCells()
+struct Opcode::HF_Walk
+{
+	udword				mX0, mZ0;		//!< First touched cell
+	udword				mX1, mZ1;		//!< Last touched cell
+	float				mMinY, mMaxY;	//!< Height range
+	HeightfieldCallback	mCallback;
+	void*				mUserData;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Heightfield::Heightfield() :
+	mNbCellsX		(0),
+	mNbCellsZ		(0),
+	mCellSize		(1.0f),
+	mOrigin			(0.0f, 0.0f, 0.0f),
+	mHeights		(null),
+	mInnerHeights	(null),
+	mHoles			(null),
+	mMinMax			(null),
+	mNbLevels		(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Heightfield::~Heightfield()
+{
+	Release();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Releases everything.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Heightfield::Release()
+{
+	DELETEARRAY(mMinMax);
+	DELETEARRAY(mHoles);
+	DELETEARRAY(mInnerHeights);
+	DELETEARRAY(mHeights);
+	mNbLevels	= 0;
+	mNbCellsX	= 0;
+	mNbCellsZ	= 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Initializes the heightfield: copies the heights and builds the min/max levels. There's no tree to build,
+ *	so this is cheap enough to be called again each time the terrain is edited.
+ *	\param		desc		[in] heightfield description
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Heightfield::Init(const HeightfieldDesc& desc)
+{
+	// Checkings
+	if(!desc.mNbCellsX || !desc.mNbCellsZ || !desc.mHeights)			return SetIceError("Heightfield::Init: invalid description!", null);
+	if(desc.mNbCellsX>HF_MAX_CELLS || desc.mNbCellsZ>HF_MAX_CELLS)		return SetIceError("Heightfield::Init: too many cells!", null);
+	if(desc.mCellSize<=0.0f)											return SetIceError("Heightfield::Init: cell size must be positive!", null);
+
+	Release();
+
+	mNbCellsX	= desc.mNbCellsX;
+	mNbCellsZ	= desc.mNbCellsZ;
+	mCellSize	= desc.mCellSize;
+	mOrigin		= desc.mOrigin;
+
+	const udword NbVertsX	= mNbCellsX+1;
+	const udword NbCorners	= NbVertsX*(mNbCellsZ+1);
+	const udword NbCells	= GetNbCells();
+
+	mHeights = new float[NbCorners];
+	CHECKALLOC(mHeights);
+
+	if(desc.mInterleaved || desc.mInnerHeights)
+	{
+		mInnerHeights = new float[NbCells];
+		CHECKALLOC(mInnerHeights);
+	}
+
+	if(desc.mInterleaved)
+	{
+		// Each row of corners is followed by a row of centers, except the last one
+		const float* Src = desc.mHeights;
+		for(udword z=0;z<=mNbCellsZ;z++)
+		{
+			float* Dst = mHeights + z*NbVertsX;
+			for(udword x=0;x<NbVertsX;x++)	Dst[x] = mOrigin.y + *Src++;
+
+			if(z==mNbCellsZ)	break;
+
+			Dst = mInnerHeights + z*mNbCellsX;
+			for(udword x=0;x<mNbCellsX;x++)	Dst[x] = mOrigin.y + *Src++;
+		}
+	}
+	else
+	{
+		for(udword i=0;i<NbCorners;i++)	mHeights[i] = mOrigin.y + desc.mHeights[i];
+
+		if(mInnerHeights)
+		{
+			for(udword i=0;i<NbCells;i++)	mInnerHeights[i] = mOrigin.y + desc.mInnerHeights[i];
+		}
+	}
+
+	if(desc.mHoles)
+	{
+		mHoles = new ubyte[NbCells];
+		CHECKALLOC(mHoles);
+		CopyMemory(mHoles, desc.mHoles, NbCells*sizeof(ubyte));
+	}
+
+	return BuildLevels();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Builds the min/max levels. Level 0 holds the height range of each cell, and each level merges 2x2 blocks of the
+ *	previous one, up to a single block covering the whole heightfield. Holes get an empty range, so they never
+ *	enlarge their parents.
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Heightfield::BuildLevels()
+{
+	// Compute levels' layout
+	udword SizeX = mNbCellsX;
+	udword SizeZ = mNbCellsZ;
+	udword NbBlocks = 0;
+	mNbLevels = 0;
+	while(1)
+	{
+		mLevelOffsets[mNbLevels]	= NbBlocks;
+		mLevelSizeX[mNbLevels]		= SizeX;
+		mLevelSizeZ[mNbLevels]		= SizeZ;
+		NbBlocks += SizeX*SizeZ;
+		mNbLevels++;
+
+		if(SizeX==1 && SizeZ==1)	break;
+		SizeX = (SizeX+1)>>1;
+		SizeZ = (SizeZ+1)>>1;
+	}
+
+	mMinMax = new float[NbBlocks*2];
+	CHECKALLOC(mMinMax);
+
+	// Level 0: cells
+	const udword NbVertsX = mNbCellsX+1;
+	float* Dst = mMinMax;
+	for(udword z=0;z<mNbCellsZ;z++)
+	{
+		const float* H = mHeights + z*NbVertsX;
+		for(udword x=0;x<mNbCellsX;x++)
+		{
+			const udword CellIndex = x + z*mNbCellsX;
+			if(IsHole(CellIndex))
+			{
+				Dst[0] = MAX_FLOAT;
+				Dst[1] = MIN_FLOAT;
+			}
+			else
+			{
+				float Min = H[x];
+				float Max = H[x];
+				const float H1 = H[x+1];			if(H1<Min) Min = H1;	if(H1>Max) Max = H1;
+				const float H2 = H[x+NbVertsX];		if(H2<Min) Min = H2;	if(H2>Max) Max = H2;
+				const float H3 = H[x+NbVertsX+1];	if(H3<Min) Min = H3;	if(H3>Max) Max = H3;
+				if(mInnerHeights)
+				{
+					const float H4 = mInnerHeights[CellIndex];
+					if(H4<Min) Min = H4;
+					if(H4>Max) Max = H4;
+				}
+				Dst[0] = Min;
+				Dst[1] = Max;
+			}
+			Dst+=2;
+		}
+	}
+
+	// Upper levels: 2x2 blocks of previous level
+	for(udword Level=1;Level<mNbLevels;Level++)
+	{
+		const udword PrevSizeX = mLevelSizeX[Level-1];
+		const udword PrevSizeZ = mLevelSizeZ[Level-1];
+		const float* Src = mMinMax + mLevelOffsets[Level-1]*2;
+
+		for(udword z=0;z<mLevelSizeZ[Level];z++)
+		{
+			for(udword x=0;x<mLevelSizeX[Level];x++)
+			{
+				float Min = MAX_FLOAT;
+				float Max = MIN_FLOAT;
+				for(udword j=z*2;j<z*2+2 && j<PrevSizeZ;j++)
+				{
+					for(udword i=x*2;i<x*2+2 && i<PrevSizeX;i++)
+					{
+						const float* MinMax = Src + (i + j*PrevSizeX)*2;
+						if(MinMax[0]<Min)	Min = MinMax[0];
+						if(MinMax[1]>Max)	Max = MinMax[1];
+					}
+				}
+				Dst[0] = Min;
+				Dst[1] = Max;
+				Dst+=2;
+			}
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the triangles of a cell. Cells with inner heights are made of 4 triangles fanned around the center,
+ *	other cells are made of 2 triangles. All triangles face up (+Y). Holes have no triangles.
+ *	Face indices are cell_index*GetNbTrianglesPerCell() + triangle number.
+ *	\param		cell_index	[in] cell index, i.e. x + z*GetNbCellsX()
+ *	\param		verts		[out] triangles' vertices (room for 3*HF_MAX_CELL_TRIANGLES points)
+ *	\return		number of triangles
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword Heightfield::GetCellTriangles(udword cell_index, Point* verts) const
+{
+	if(IsHole(cell_index))	return 0;
+
+	const udword x = cell_index % mNbCellsX;
+	const udword z = cell_index / mNbCellsX;
+	const udword NbVertsX = mNbCellsX+1;
+	const float* H = mHeights + x + z*NbVertsX;
+
+	// Shared edges must be computed the same way in both cells, else we'd get cracks
+	const float x0 = mOrigin.x + float(x)*mCellSize;
+	const float x1 = mOrigin.x + float(x+1)*mCellSize;
+	const float z0 = mOrigin.z + float(z)*mCellSize;
+	const float z1 = mOrigin.z + float(z+1)*mCellSize;
+
+	const Point A(x0, H[0],				z0);
+	const Point B(x1, H[1],				z0);
+	const Point C(x1, H[NbVertsX+1],	z1);
+	const Point D(x0, H[NbVertsX],		z1);
+
+	if(mInnerHeights)
+	{
+		const Point M((x0+x1)*0.5f, mInnerHeights[cell_index], (z0+z1)*0.5f);
+		verts[0] = A;	verts[1] = M;	verts[2] = B;
+		verts[3] = B;	verts[4] = M;	verts[5] = C;
+		verts[6] = C;	verts[7] = M;	verts[8] = D;
+		verts[9] = D;	verts[10] = M;	verts[11] = A;
+		return 4;
+	}
+
+	verts[0] = A;	verts[1] = D;	verts[2] = B;
+	verts[3] = B;	verts[4] = D;	verts[5] = C;
+	return 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the vertices of a triangle, in the same way as MeshInterface::GetTriangle().
+ *	\param		verts		[out] triangle's vertices
+ *	\param		face_id		[in] face index
+ *	\return		true if success, false for invalid faces & holes
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Heightfield::GetTriangle(Point* verts, udword face_id) const
+{
+	const udword NbTris = GetNbTrianglesPerCell();
+	const udword CellIndex = face_id / NbTris;
+	if(CellIndex>=GetNbCells())	return false;
+
+	Point CellVerts[3*HF_MAX_CELL_TRIANGLES];
+	if(!GetCellTriangles(CellIndex, CellVerts))	return false;
+
+	const Point* Src = CellVerts + (face_id % NbTris)*3;
+	verts[0] = Src[0];
+	verts[1] = Src[1];
+	verts[2] = Src[2];
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Walks the cells overlapping a box, using the min/max levels to discard whole blocks of cells at once.
+ *	Holes are never reported.
+ *	\param		min			[in] box's min point, in the heightfield's space
+ *	\param		max			[in] box's max point, in the heightfield's space
+ *	\param		callback	[in] callback called for each touched cell
+ *	\param		user_data	[in] user-defined data
+ *	\return		false if the walk has been stopped by the callback
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Heightfield::WalkCells(const Point& min, const Point& max, HeightfieldCallback callback, void* user_data) const
+{
+	// Checkings
+	if(!mMinMax || !callback)	return true;
+
+	// Compute touched cells
+	const float OneOverCellSize = 1.0f / mCellSize;
+	const float fx0 = (min.x - mOrigin.x)*OneOverCellSize;
+	const float fx1 = (max.x - mOrigin.x)*OneOverCellSize;
+	const float fz0 = (min.z - mOrigin.z)*OneOverCellSize;
+	const float fz1 = (max.z - mOrigin.z)*OneOverCellSize;
+	if(fx1<0.0f || fz1<0.0f || fx0>float(mNbCellsX) || fz0>float(mNbCellsZ))	return true;
+
+	HF_Walk Walk;
+	Walk.mX0		= fx0>0.0f ? udword(fx0) : 0;
+	Walk.mZ0		= fz0>0.0f ? udword(fz0) : 0;
+	Walk.mX1		= fx1<float(mNbCellsX) ? udword(fx1) : mNbCellsX-1;
+	Walk.mZ1		= fz1<float(mNbCellsZ) ? udword(fz1) : mNbCellsZ-1;
+	if(Walk.mX1>=mNbCellsX)	Walk.mX1 = mNbCellsX-1;
+	if(Walk.mZ1>=mNbCellsZ)	Walk.mZ1 = mNbCellsZ-1;
+	Walk.mMinY		= min.y;
+	Walk.mMaxY		= max.y;
+	Walk.mCallback	= callback;
+	Walk.mUserData	= user_data;
+
+	// Walk the levels from the top
+	return _WalkCells(Walk, mNbLevels-1, 0, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Recursive walk for WalkCells().
+ *	\param		walk		[in] query range
+ *	\param		level		[in] current level
+ *	\param		x			[in] block's coordinate in current level
+ *	\param		z			[in] block's coordinate in current level
+ *	\return		false if the walk has been stopped by the callback
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Heightfield::_WalkCells(const HF_Walk& walk, udword level, udword x, udword z) const
+{
+	// Cells covered by the block
+	const udword CX0 = x<<level;
+	const udword CZ0 = z<<level;
+	const udword CX1 = CX0 + (1<<level) - 1;
+	const udword CZ1 = CZ0 + (1<<level) - 1;
+	if(CX0>walk.mX1 || CX1<walk.mX0 || CZ0>walk.mZ1 || CZ1<walk.mZ0)	return true;
+
+	// Height range of the block
+	const float* MinMax = GetMinMax(level, x, z);
+	if(MinMax[0]>walk.mMaxY || MinMax[1]<walk.mMinY)	return true;
+
+	if(!level)
+	{
+		const udword CellIndex = x + z*mNbCellsX;
+		if(IsHole(CellIndex))	return true;
+		return (walk.mCallback)(CellIndex, walk.mUserData);
+	}
+
+	// Recurse into children
+	level--;
+	x<<=1;
+	z<<=1;
+	const udword SizeX = mLevelSizeX[level];
+	const udword SizeZ = mLevelSizeZ[level];
+	if(!_WalkCells(walk, level, x, z))								return false;
+	if(x+1<SizeX && !_WalkCells(walk, level, x+1, z))				return false;
+	if(z+1<SizeZ)
+	{
+		if(!_WalkCells(walk, level, x, z+1))						return false;
+		if(x+1<SizeX && !_WalkCells(walk, level, x+1, z+1))		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the number of bytes used by the heightfield.
+ *	\return		amount of bytes used
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword Heightfield::GetUsedBytes() const
+{
+	if(!mHeights)	return 0;
+
+	const udword NbCells = GetNbCells();
+	udword UsedBytes = (mNbCellsX+1)*(mNbCellsZ+1)*sizeof(float);
+	if(mInnerHeights)	UsedBytes += NbCells*sizeof(float);
+	if(mHoles)			UsedBytes += NbCells*sizeof(ubyte);
+	UsedBytes += (mLevelOffsets[mNbLevels-1]+1)*2*sizeof(float);
+	return UsedBytes;
+}
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for heightfields, i.e. regular grids of heights such as terrain chunks.
+ *	\file		OPC_Heightfield.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_HEIGHTFIELD_H__
+#define __OPC_HEIGHTFIELD_H__
+
+	#define HF_MAX_LEVELS			32		//!< Max number of min/max levels
+	#define HF_MAX_CELL_TRIANGLES	4		//!< Max number of triangles per cell
+
+	//! Heightfield description. Heights are copied by Heightfield::Init().
+	//! The grid lies in the XZ plane, with Y up: corner (x, z) is located at mOrigin + (x*mCellSize, height, z*mCellSize).
+	struct OPCODE_API HeightfieldDesc
+	{
+		//! Constructor
+		inline_					HeightfieldDesc() :
+									mNbCellsX		(0),
+									mNbCellsZ		(0),
+									mHeights		(null),
+									mInnerHeights	(null),
+									mHoles			(null),
+									mCellSize		(1.0f),
+									mOrigin			(0.0f, 0.0f, 0.0f),
+									mInterleaved	(false)
+								{}
+
+				udword			mNbCellsX;		//!< Number of cells along X
+				udword			mNbCellsZ;		//!< Number of cells along Z
+				const float*	mHeights;		//!< (mNbCellsX+1)*(mNbCellsZ+1) corner heights, row by row
+				const float*	mInnerHeights;	//!< mNbCellsX*mNbCellsZ cell-center heights, or null for 2 triangles per cell
+				const ubyte*	mHoles;			//!< One flag per cell (non-zero for holes), or null
+				float			mCellSize;		//!< Size of a cell
+				Point			mOrigin;		//!< Position of corner (0, 0). Heights are relative to mOrigin.y.
+				bool			mInterleaved;	//!< mHeights uses the ADT layout: each row of corners is followed by a row of centers
+	};
+
+	//! Callback called for each cell touched by Heightfield::WalkCells(). Return false to stop the walk.
+	typedef bool	(*HeightfieldCallback)	(udword cell_index, void* user_data);
+
+	struct HF_Walk;
+
+	class OPCODE_API Heightfield
+	{
+		public:
+		// Constructor / Destructor
+								Heightfield();
+								~Heightfield();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Initializes the heightfield: copies the heights and builds the min/max levels. There's no tree to build,
+		 *	so this is cheap enough to be called again each time the terrain is edited.
+		 *	\param		desc		[in] heightfield description
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			Init(const HeightfieldDesc& desc);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Gets the triangles of a cell. Cells with inner heights are made of 4 triangles fanned around the center,
+		 *	other cells are made of 2 triangles. All triangles face up (+Y). Holes have no triangles.
+		 *	Face indices are cell_index*GetNbTrianglesPerCell() + triangle number.
+		 *	\param		cell_index	[in] cell index, i.e. x + z*GetNbCellsX()
+		 *	\param		verts		[out] triangles' vertices (room for 3*HF_MAX_CELL_TRIANGLES points)
+		 *	\return		number of triangles
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				udword			GetCellTriangles(udword cell_index, Point* verts)	const;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Gets the vertices of a triangle, in the same way as MeshInterface::GetTriangle().
+		 *	\param		verts		[out] triangle's vertices
+		 *	\param		face_id		[in] face index
+		 *	\return		true if success, false for invalid faces & holes
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			GetTriangle(Point* verts, udword face_id)			const;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Walks the cells overlapping a box, using the min/max levels to discard whole blocks of cells at once.
+		 *	Holes are never reported.
+		 *	\param		min			[in] box's min point, in the heightfield's space
+		 *	\param		max			[in] box's max point, in the heightfield's space
+		 *	\param		callback	[in] callback called for each touched cell
+		 *	\param		user_data	[in] user-defined data
+		 *	\return		false if the walk has been stopped by the callback
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+				bool			WalkCells(const Point& min, const Point& max, HeightfieldCallback callback, void* user_data)	const;
+
+		// Data access
+		inline_	udword			GetNbCellsX()			const	{ return mNbCellsX;								}
+		inline_	udword			GetNbCellsZ()			const	{ return mNbCellsZ;								}
+		inline_	udword			GetNbCells()			const	{ return mNbCellsX*mNbCellsZ;					}
+		inline_	udword			GetNbTrianglesPerCell()	const	{ return mInnerHeights ? 4 : 2;					}
+		inline_	udword			GetNbTriangles()		const	{ return GetNbCells()*GetNbTrianglesPerCell();	}
+		inline_	float			GetCellSize()			const	{ return mCellSize;								}
+		inline_	const Point&	GetOrigin()				const	{ return mOrigin;								}
+		inline_	float			GetHeight(udword x, udword z)	const	{ return mHeights[x + z*(mNbCellsX+1)];		}
+		inline_	BOOL			IsHole(udword cell_index)		const	{ return mHoles && mHoles[cell_index];		}
+		// Min/max levels. Level 0 holds one entry per cell, each level halves the resolution. Holes are empty.
+		inline_	udword			GetNbLevels()			const	{ return mNbLevels;								}
+		inline_	udword			GetLevelSizeX(udword level)	const	{ return mLevelSizeX[level];				}
+		inline_	udword			GetLevelSizeZ(udword level)	const	{ return mLevelSizeZ[level];				}
+		inline_	const float*	GetMinMax(udword level, udword x, udword z)	const	{ return mMinMax + (mLevelOffsets[level] + x + z*mLevelSizeX[level])*2;	}
+		// Stats
+				udword			GetUsedBytes()			const;
+
+				void			Release();
+		private:
+				udword			mNbCellsX;
+				udword			mNbCellsZ;
+				float			mCellSize;
+				Point			mOrigin;
+				float*			mHeights;		//!< Corner heights, mOrigin.y included
+				float*			mInnerHeights;	//!< Cell-center heights, mOrigin.y included, or null
+				ubyte*			mHoles;			//!< Hole flags, or null
+		// Min/max levels
+				float*			mMinMax;		//!< (min, max) pairs for all levels
+				udword			mNbLevels;
+				udword			mLevelOffsets[HF_MAX_LEVELS];
+				udword			mLevelSizeX[HF_MAX_LEVELS];
+				udword			mLevelSizeZ[HF_MAX_LEVELS];
+		// Internal methods
+				bool			BuildLevels();
+				bool			_WalkCells(const HF_Walk& walk, udword level, udword x, udword z)	const;
+	};
+
+#endif // __OPC_HEIGHTFIELD_H__
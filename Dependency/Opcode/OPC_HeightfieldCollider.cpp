@@ -0,0 +1,538 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains colliders for heightfields.
+ *	\file		OPC_HeightfieldCollider.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains colliders for heightfields. They reuse the settings, init code & primitive tests of the regular colliders,
+ *	but replace the tree traversal:
+ *	- rays walk the cells with a 2D DDA, front to back. Each cell is only tested when the ray's height range within the
+ *	cell overlaps the cell's height range.
+ *	- volumes (spheres, capsules, boxes) compute their bounds in the heightfield's space, and walk the min/max levels
+ *	to find the touched cells.
+ *
+ *	Results are the same as for an Opcode model built from the heightfield's triangles, with the same face indices.
+ *	Temporal coherence isn't supported.
+ *
+ *	\class		HeightfieldRayCollider
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+using namespace Opcode;
+
+#include "OPC_RayTriOverlap.h"
+#include "OPC_LSSTriOverlap.h"
+#include "OPC_TriBoxOverlap.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Triangle-box overlap test for a heightfield cell triangle.
+ *	\param		vert0	[in] triangle vertex in model space
+ *	\param		vert1	[in] triangle vertex in model space
+ *	\param		vert2	[in] triangle vertex in model space
+ *	\return		true if the triangle overlaps the box
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL HeightfieldOBBCollider::CellTriBoxOverlap(const Point& vert0, const Point& vert1, const Point& vert2)
+{
+	// Transform the triangle in box space, as expected by TriBoxOverlap()
+	TransformPoint(mLeafVerts[0], vert0, mRModelToBox, mTModelToBox);
+	TransformPoint(mLeafVerts[1], vert1, mRModelToBox, mTModelToBox);
+	TransformPoint(mLeafVerts[2], vert2, mRModelToBox, mTModelToBox);
+	return TriBoxOverlap();
+}
+
+#define SET_CONTACT(prim_index, flag)											\
+	mNbIntersections++;															\
+	/* Set contact status */													\
+	mFlags |= flag;																\
+	/* In any case the contact has been found and recorded in mStabbedFace  */	\
+	mStabbedFace.mFaceID = prim_index;
+
+#ifdef OPC_RAYHIT_CALLBACK
+
+	#define HANDLE_CONTACT(prim_index, flag)													\
+		SET_CONTACT(prim_index, flag)															\
+																								\
+		if(mHitCallback)	(mHitCallback)(mStabbedFace, mUserData);
+#else
+
+	#define HANDLE_CONTACT(prim_index, flag)													\
+		SET_CONTACT(prim_index, flag)															\
+																								\
+		/* Now we can also record it in mStabbedFaces if available */							\
+		if(mStabbedFaces)																		\
+		{																						\
+			/* If we want all faces or if that's the first one we hit */						\
+			if(!mClosestHit || !mStabbedFaces->GetNbFaces())									\
+			{																					\
+				mStabbedFaces->AddFace(mStabbedFace);											\
+			}																					\
+			else																				\
+			{																					\
+				/* We only keep closest hit */													\
+				CollisionFace* Current = const_cast<CollisionFace*>(mStabbedFaces->GetFaces());	\
+				if(Current && mStabbedFace.mDistance<Current->mDistance)						\
+				{																				\
+					*Current = mStabbedFace;													\
+				}																				\
+			}																					\
+		}
+#endif
+
+//! Tests the triangles of a cell against a volume
+#define HEIGHTFIELD_CELL(prim_test)																\
+	Collider->mNbVolumeBVTests++;																\
+																								\
+	Point Verts[3*HF_MAX_CELL_TRIANGLES];														\
+	const udword NbTris = Collider->mField->GetCellTriangles(cell_index, Verts);				\
+	const udword FaceID = cell_index * Collider->mField->GetNbTrianglesPerCell();				\
+	for(udword i=0;i<NbTris;i++)																\
+	{																							\
+		if(Collider->SkipPrimitiveTests() || prim_test)											\
+		{																						\
+			/* Set contact status */															\
+			Collider->mFlags |= OPC_CONTACT;													\
+			Collider->mTouchedPrimitives->Add(FaceID+i);										\
+			if(Collider->ContactFound())	return false;										\
+		}																						\
+	}																							\
+	return true;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Clips a ray against a slab.
+ *	\param		o			[in] ray origin along the slab's axis
+ *	\param		d			[in] ray direction along the slab's axis
+ *	\param		min			[in] slab's min bound
+ *	\param		max			[in] slab's max bound
+ *	\param		tmin		[in/out] valid range on the ray
+ *	\param		tmax		[in/out] valid range on the ray
+ *	\return		true if the valid range isn't empty
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ bool _ClipSlab(float o, float d, float min, float max, float& tmin, float& tmax)
+{
+	if(d==0.0f)	return o>=min && o<=max;
+
+	const float OneOverD = 1.0f / d;
+	float t0 = (min - o)*OneOverD;
+	float t1 = (max - o)*OneOverD;
+	if(t0>t1)	TSwap(t0, t1);
+	if(t0>tmin)	tmin = t0;
+	if(t1<tmax)	tmax = t1;
+	return tmin<=tmax;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldRayCollider::HeightfieldRayCollider() : mClosestHitOnly(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldRayCollider::~HeightfieldRayCollider()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Validates current settings. You should call this method after all the settings and callbacks have been defined for a collider.
+ *	\return		null if everything is ok, else a string describing the problem
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* HeightfieldRayCollider::ValidateSettings()
+{
+	if(TemporalCoherenceEnabled())	return "Temporal coherence not supported on heightfields!";
+	return RayCollider::ValidateSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Stabbing query for heightfields. Results are reported exactly like for RayCollider, so the Setup*() helpers
+ *	from OPC_Picking.h can be used. Face indices are the heightfield's face indices.
+ *
+ *	\param		world_ray		[in] stabbing ray in world space
+ *	\param		field			[in] heightfield to collide with
+ *	\param		world			[in] heightfield's world matrix, or null
+ *	\return		true if success
+ *	\warning	SCALE NOT SUPPORTED. The matrix must contain rotation & translation parts only.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeightfieldRayCollider::Collide(const Ray& world_ray, const Heightfield& field, const Matrix4x4* world)
+{
+	// Checkings
+	if(TemporalCoherenceEnabled())	return SetIceError("HeightfieldRayCollider::Collide: temporal coherence not supported!", null);
+
+	// No model here
+	mCurrentModel	= null;
+	mIMesh			= null;
+
+	// Init collision query
+	if(InitQuery(world_ray, world))	return true;
+
+	// Perform stabbing query
+	if(field.GetNbLevels())	_Walk(field);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Walks the cells touched by the ray, front to back.
+ *	\param		field			[in] heightfield to collide with
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void HeightfieldRayCollider::_Walk(const Heightfield& field)
+{
+	const udword NbCellsX = field.GetNbCellsX();
+	const udword NbCellsZ = field.GetNbCellsZ();
+	const udword NbTrisPerCell = field.GetNbTrianglesPerCell();
+	const Point& Origin = field.GetOrigin();
+
+	// Ray in grid space, where cells have a unit size along X and Z
+	const float OneOverCellSize = 1.0f / field.GetCellSize();
+	const float ox = (mOrigin.x - Origin.x)*OneOverCellSize;
+	const float oz = (mOrigin.z - Origin.z)*OneOverCellSize;
+	const float dx = mDir.x*OneOverCellSize;
+	const float dz = mDir.z*OneOverCellSize;
+
+	// Clip the ray against the heightfield's bounds. The top level gives the height range of the whole heightfield.
+	const float* Bounds = field.GetMinMax(field.GetNbLevels()-1, 0, 0);
+	float tmin = 0.0f;
+	float tmax = mMaxDist;
+	mNbRayBVTests++;
+	if(!_ClipSlab(ox, dx, 0.0f, float(NbCellsX), tmin, tmax))		return;
+	if(!_ClipSlab(oz, dz, 0.0f, float(NbCellsZ), tmin, tmax))		return;
+	if(!_ClipSlab(mOrigin.y, mDir.y, Bounds[0], Bounds[1], tmin, tmax))	return;
+
+	// Find entry cell
+	sdword x = sdword(ox + tmin*dx);
+	sdword z = sdword(oz + tmin*dz);
+	if(x<0)	x = 0;	else if(x>=sdword(NbCellsX))	x = NbCellsX-1;
+	if(z<0)	z = 0;	else if(z>=sdword(NbCellsZ))	z = NbCellsZ-1;
+
+	const sdword StepX = dx>0.0f ? 1 : -1;
+	const sdword StepZ = dz>0.0f ? 1 : -1;
+	const float OneOverDx = dx!=0.0f ? 1.0f / dx : 0.0f;
+	const float OneOverDz = dz!=0.0f ? 1.0f / dz : 0.0f;
+
+#ifdef OPC_RAYHIT_CALLBACK
+	const bool StopAtFirstCell = mClosestHitOnly;
+#else
+	const bool StopAtFirstCell = mClosestHitOnly || mClosestHit;
+#endif
+
+	float tEnter = tmin;
+	while(1)
+	{
+		// Find where the ray leaves the cell. Boundaries are recomputed from the origin so that errors don't accumulate.
+		const float tNextX = dx!=0.0f ? (float(dx>0.0f ? x+1 : x) - ox)*OneOverDx : MAX_FLOAT;
+		const float tNextZ = dz!=0.0f ? (float(dz>0.0f ? z+1 : z) - oz)*OneOverDz : MAX_FLOAT;
+		float tExit = tNextX<tNextZ ? tNextX : tNextZ;
+		if(tExit>tmax)	tExit = tmax;
+
+		// Ray's height range within the cell, against cell's height range. Holes have an empty range.
+		float y0 = mOrigin.y + tEnter*mDir.y;
+		float y1 = mOrigin.y + tExit*mDir.y;
+		if(y0>y1)	TSwap(y0, y1);
+
+		mNbRayBVTests++;
+		const float* MinMax = field.GetMinMax(0, x, z);
+		if(y0<=MinMax[1] && y1>=MinMax[0])
+		{
+			const udword CellIndex = x + z*NbCellsX;
+			Point Verts[3*HF_MAX_CELL_TRIANGLES];
+			const udword NbTris = field.GetCellTriangles(CellIndex, Verts);
+
+			bool Hit = false;
+			for(udword i=0;i<NbTris;i++)
+			{
+				if(RayTriOverlap(Verts[i*3], Verts[i*3+1], Verts[i*3+2]))
+				{
+					// Intersection point is valid if dist < segment's length
+					// We know dist>0 so we can use integers
+					if(IR(mStabbedFace.mDistance)<IR(mMaxDist))
+					{
+						HANDLE_CONTACT(CellIndex*NbTrisPerCell+i, OPC_CONTACT)
+
+						if(ContactFound())	return;
+						Hit = true;
+					}
+				}
+			}
+			// Hits in next cells are further away
+			if(Hit && StopAtFirstCell)	return;
+		}
+
+		// Move to next cell
+		if(tExit>=tmax)	return;
+		if(tNextX<tNextZ)
+		{
+			x += StepX;
+			if(x<0 || x>=sdword(NbCellsX))	return;
+		}
+		else
+		{
+			z += StepZ;
+			if(z<0 || z>=sdword(NbCellsZ))	return;
+		}
+		tEnter = tExit;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldSphereCollider::HeightfieldSphereCollider() : mField(null)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldSphereCollider::~HeightfieldSphereCollider()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Validates current settings. You should call this method after all the settings and callbacks have been defined for a collider.
+ *	\return		null if everything is ok, else a string describing the problem
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* HeightfieldSphereCollider::ValidateSettings()
+{
+	if(TemporalCoherenceEnabled())	return "Temporal coherence not supported on heightfields!";
+	return SphereCollider::ValidateSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Collision query for heightfields. Touched primitives are the heightfield's face indices.
+ *	\param		cache			[in/out] a sphere cache
+ *	\param		sphere			[in] collision sphere in local space
+ *	\param		field			[in] heightfield to collide with
+ *	\param		worlds			[in] sphere's world matrix, or null
+ *	\param		worldm			[in] heightfield's world matrix, or null
+ *	\return		true if success
+ *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeightfieldSphereCollider::Collide(SphereCache& cache, const Sphere& sphere, const Heightfield& field, const Matrix4x4* worlds, const Matrix4x4* worldm)
+{
+	// Checkings
+	if(TemporalCoherenceEnabled())	return SetIceError("HeightfieldSphereCollider::Collide: temporal coherence not supported!", null);
+
+	// No model here
+	mCurrentModel	= null;
+	mIMesh			= null;
+	mField			= &field;
+
+	// Init collision query
+	if(InitQuery(cache, sphere, worlds, worldm))	return true;
+
+	// Walk the cells touched by the sphere's box
+	const float Radius = sqrtf(mRadius2);
+	const Point Extents(Radius, Radius, Radius);
+	field.WalkCells(mCenter - Extents, mCenter + Extents, _CollideCell, this);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Tests the triangles of a cell. Called by Heightfield::WalkCells().
+ *	\param		cell_index		[in] touched cell
+ *	\param		user_data		[in] the collider
+ *	\return		false to stop the walk
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeightfieldSphereCollider::_CollideCell(udword cell_index, void* user_data)
+{
+	HeightfieldSphereCollider* Collider = (HeightfieldSphereCollider*)user_data;
+
+	HEIGHTFIELD_CELL(Collider->SphereTriOverlap(Verts[i*3], Verts[i*3+1], Verts[i*3+2]))
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldLSSCollider::HeightfieldLSSCollider() : mField(null)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldLSSCollider::~HeightfieldLSSCollider()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Validates current settings. You should call this method after all the settings and callbacks have been defined for a collider.
+ *	\return		null if everything is ok, else a string describing the problem
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* HeightfieldLSSCollider::ValidateSettings()
+{
+	if(TemporalCoherenceEnabled())	return "Temporal coherence not supported on heightfields!";
+	return LSSCollider::ValidateSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Collision query for heightfields, e.g. for character capsules. Touched primitives are the heightfield's face indices.
+ *	\param		cache			[in/out] an lss cache
+ *	\param		lss				[in] collision lss in local space
+ *	\param		field			[in] heightfield to collide with
+ *	\param		worldl			[in] lss world matrix, or null
+ *	\param		worldm			[in] heightfield's world matrix, or null
+ *	\return		true if success
+ *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeightfieldLSSCollider::Collide(LSSCache& cache, const LSS& lss, const Heightfield& field, const Matrix4x4* worldl, const Matrix4x4* worldm)
+{
+	// Checkings
+	if(TemporalCoherenceEnabled())	return SetIceError("HeightfieldLSSCollider::Collide: temporal coherence not supported!", null);
+
+	// No model here
+	mCurrentModel	= null;
+	mIMesh			= null;
+	mField			= &field;
+
+	// Init collision query
+	if(InitQuery(cache, lss, worldl, worldm))	return true;
+
+	// Walk the cells touched by the capsule's box
+	const float Radius = sqrtf(mRadius2);
+	Point Min = mSeg.mP0;	Min.Min(mSeg.mP1);
+	Point Max = mSeg.mP0;	Max.Max(mSeg.mP1);
+	const Point Extents(Radius, Radius, Radius);
+	field.WalkCells(Min - Extents, Max + Extents, _CollideCell, this);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Tests the triangles of a cell. Called by Heightfield::WalkCells().
+ *	\param		cell_index		[in] touched cell
+ *	\param		user_data		[in] the collider
+ *	\return		false to stop the walk
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeightfieldLSSCollider::_CollideCell(udword cell_index, void* user_data)
+{
+	HeightfieldLSSCollider* Collider = (HeightfieldLSSCollider*)user_data;
+
+	HEIGHTFIELD_CELL(Collider->LSSTriOverlap(Verts[i*3], Verts[i*3+1], Verts[i*3+2]))
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldOBBCollider::HeightfieldOBBCollider() : mField(null)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HeightfieldOBBCollider::~HeightfieldOBBCollider()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Validates current settings. You should call this method after all the settings and callbacks have been defined for a collider.
+ *	\return		null if everything is ok, else a string describing the problem
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* HeightfieldOBBCollider::ValidateSettings()
+{
+	if(TemporalCoherenceEnabled())	return "Temporal coherence not supported on heightfields!";
+	return OBBCollider::ValidateSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Collision query for heightfields. Touched primitives are the heightfield's face indices.
+ *	\param		cache			[in/out] a box cache
+ *	\param		box				[in] collision OBB in local space
+ *	\param		field			[in] heightfield to collide with
+ *	\param		worldb			[in] OBB's world matrix, or null
+ *	\param		worldm			[in] heightfield's world matrix, or null
+ *	\return		true if success
+ *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeightfieldOBBCollider::Collide(OBBCache& cache, const OBB& box, const Heightfield& field, const Matrix4x4* worldb, const Matrix4x4* worldm)
+{
+	// Checkings
+	if(TemporalCoherenceEnabled())	return SetIceError("HeightfieldOBBCollider::Collide: temporal coherence not supported!", null);
+
+	// No model here
+	mCurrentModel	= null;
+	mIMesh			= null;
+	mField			= &field;
+
+	// Init collision query
+	if(InitQuery(cache, box, worldb, worldm))	return true;
+
+	// Walk the cells touched by the box's AABB. InitQuery() already computed its extents in heightfield's space.
+	Point Extents;
+	mBoxBoxData.GetAABBExtents(Extents);
+	field.WalkCells(mTBoxToModel - Extents, mTBoxToModel + Extents, _CollideCell, this);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Tests the triangles of a cell. Called by Heightfield::WalkCells().
+ *	\param		cell_index		[in] touched cell
+ *	\param		user_data		[in] the collider
+ *	\return		false to stop the walk
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeightfieldOBBCollider::_CollideCell(udword cell_index, void* user_data)
+{
+	HeightfieldOBBCollider* Collider = (HeightfieldOBBCollider*)user_data;
+
+	HEIGHTFIELD_CELL(Collider->CellTriBoxOverlap(Verts[i*3], Verts[i*3+1], Verts[i*3+2]))
+}
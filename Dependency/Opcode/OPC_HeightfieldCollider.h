@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains colliders for heightfields.
+ *	\file		OPC_HeightfieldCollider.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_HEIGHTFIELDCOLLIDER_H__
+#define __OPC_HEIGHTFIELDCOLLIDER_H__
+
+	class OPCODE_API HeightfieldRayCollider : public RayCollider
+	{
+		public:
+		// Constructor / Destructor
+											HeightfieldRayCollider();
+		virtual								~HeightfieldRayCollider();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Stabbing query for heightfields. Results are reported exactly like for RayCollider, so the Setup*() helpers
+		 *	from OPC_Picking.h can be used. Face indices are the heightfield's face indices.
+		 *
+		 *	\param		world_ray		[in] stabbing ray in world space
+		 *	\param		field			[in] heightfield to collide with
+		 *	\param		world			[in] heightfield's world matrix, or null
+		 *	\return		true if success
+		 *	\warning	SCALE NOT SUPPORTED. The matrix must contain rotation & translation parts only.
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool			Collide(const Ray& world_ray, const Heightfield& field, const Matrix4x4* world=null);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: stop the query after the first cell containing a hit. Cells are visited front to back, so all
+		 *	hits in further cells are further away: this is enough to find the closest hit, without walking the rest
+		 *	of the ray. Don't use this when hits can be discarded by the hit callback (e.g. for culling).
+		 *	\param		flag		[in] true to stop after the first cell containing a hit
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_				void			SetClosestHitOnly(bool flag)	{ mClosestHitOnly = flag;	}
+
+		override(RayCollider)	const char*	ValidateSettings();
+		protected:
+							bool			mClosestHitOnly;	//!< Stop after the first cell containing a hit
+		// Internal methods
+							void			_Walk(const Heightfield& field);
+	};
+
+	class OPCODE_API HeightfieldSphereCollider : public SphereCollider
+	{
+		public:
+		// Constructor / Destructor
+											HeightfieldSphereCollider();
+		virtual								~HeightfieldSphereCollider();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Collision query for heightfields. Touched primitives are the heightfield's face indices.
+		 *	\param		cache			[in/out] a sphere cache
+		 *	\param		sphere			[in] collision sphere in local space
+		 *	\param		field			[in] heightfield to collide with
+		 *	\param		worlds			[in] sphere's world matrix, or null
+		 *	\param		worldm			[in] heightfield's world matrix, or null
+		 *	\return		true if success
+		 *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool			Collide(SphereCache& cache, const Sphere& sphere, const Heightfield& field, const Matrix4x4* worlds=null, const Matrix4x4* worldm=null);
+
+		override(SphereCollider)	const char*	ValidateSettings();
+		protected:
+							const Heightfield*	mField;
+		// Internal methods
+		static				bool			_CollideCell(udword cell_index, void* user_data);
+	};
+
+	class OPCODE_API HeightfieldLSSCollider : public LSSCollider
+	{
+		public:
+		// Constructor / Destructor
+											HeightfieldLSSCollider();
+		virtual								~HeightfieldLSSCollider();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Collision query for heightfields, e.g. for character capsules. Touched primitives are the heightfield's face indices.
+		 *	\param		cache			[in/out] an lss cache
+		 *	\param		lss				[in] collision lss in local space
+		 *	\param		field			[in] heightfield to collide with
+		 *	\param		worldl			[in] lss world matrix, or null
+		 *	\param		worldm			[in] heightfield's world matrix, or null
+		 *	\return		true if success
+		 *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool			Collide(LSSCache& cache, const LSS& lss, const Heightfield& field, const Matrix4x4* worldl=null, const Matrix4x4* worldm=null);
+
+		override(LSSCollider)	const char*		ValidateSettings();
+		protected:
+							const Heightfield*	mField;
+		// Internal methods
+		static				bool			_CollideCell(udword cell_index, void* user_data);
+	};
+
+	class OPCODE_API HeightfieldOBBCollider : public OBBCollider
+	{
+		public:
+		// Constructor / Destructor
+											HeightfieldOBBCollider();
+		virtual								~HeightfieldOBBCollider();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Collision query for heightfields. Touched primitives are the heightfield's face indices.
+		 *	\param		cache			[in/out] a box cache
+		 *	\param		box				[in] collision OBB in local space
+		 *	\param		field			[in] heightfield to collide with
+		 *	\param		worldb			[in] OBB's world matrix, or null
+		 *	\param		worldm			[in] heightfield's world matrix, or null
+		 *	\return		true if success
+		 *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool			Collide(OBBCache& cache, const OBB& box, const Heightfield& field, const Matrix4x4* worldb=null, const Matrix4x4* worldm=null);
+
+		override(OBBCollider)	const char*		ValidateSettings();
+		protected:
+							const Heightfield*	mField;
+		// Internal methods
+		static				bool			_CollideCell(udword cell_index, void* user_data);
+			// Overlap tests
+		inline_				BOOL			CellTriBoxOverlap(const Point& vert0, const Point& vert1, const Point& vert2);
+	};
+
+#endif // __OPC_HEIGHTFIELDCOLLIDER_H__
@@ -95,7 +95,8 @@ HybridModel::HybridModel() :
 	mNbLeaves		(0),
 	mNbPrimitives	(0),
 	mTriangles		(null),
-	mIndices		(null)
+	mIndices		(null),
+	mUserData		(false)
 {
 }
 
@@ -116,9 +117,28 @@ HybridModel::~HybridModel()
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void HybridModel::Release()
 {
+	ReleaseLeaves();
 	ReleaseBase();
-	DELETEARRAY(mIndices);
-	DELETEARRAY(mTriangles);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Releases leaf descriptors & indices.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void HybridModel::ReleaseLeaves()
+{
+	if(mUserData)
+	{
+		mIndices	= null;
+		mTriangles	= null;
+		mUserData	= false;
+	}
+	else
+	{
+		DELETEARRAY(mIndices);
+		DELETEARRAY(mTriangles);
+	}
 	mNbLeaves		= 0;
 	mNbPrimitives	= 0;
 }
@@ -154,6 +174,7 @@ bool HybridModel::Build(const OPCODECREATE& create)
 {
 	// 1) Checkings
 	if(!create.mIMesh || !create.mIMesh->IsValid())	return false;
+	if(create.mWideTree)	return SetIceError("OPCODE WARNING: wide trees are not supported by hybrid models.\n", null);
 
 	// Look for degenerate faces.
 	udword NbDegenerate = create.mIMesh->CheckTopology();
@@ -352,6 +373,7 @@ bool HybridModel::Refit()
 
 	// Bottom-up update
 	VertexPointers VP;
+	ConversionArea VC;
 	Point Min,Max;
 	Point Min_,Max_;
 	udword Index = mTree->GetNbNodes();
@@ -378,7 +400,7 @@ bool HybridModel::Refit()
 				// Loop through triangles and test each of them
 				while(NbTris--)
 				{
-					mIMesh->GetTriangle(VP, *T++);
+					mIMesh->GetTriangle(VP, *T++, VC);
 					ComputeMinMax(TmpMin, TmpMax, VP);
 					Min.Min(TmpMin);
 					Max.Max(TmpMax);
@@ -391,7 +413,7 @@ bool HybridModel::Refit()
 				// Loop through triangles and test each of them
 				while(NbTris--)
 				{
-					mIMesh->GetTriangle(VP, BaseIndex++);
+					mIMesh->GetTriangle(VP, BaseIndex++, VC);
 					ComputeMinMax(TmpMin, TmpMax, VP);
 					Min.Min(TmpMin);
 					Max.Max(TmpMax);
@@ -423,7 +445,7 @@ bool HybridModel::Refit()
 				// Loop through triangles and test each of them
 				while(NbTris--)
 				{
-					mIMesh->GetTriangle(VP, *T++);
+					mIMesh->GetTriangle(VP, *T++, VC);
 					ComputeMinMax(TmpMin, TmpMax, VP);
 					Min_.Min(TmpMin);
 					Max_.Max(TmpMax);
@@ -436,7 +458,7 @@ bool HybridModel::Refit()
 				// Loop through triangles and test each of them
 				while(NbTris--)
 				{
-					mIMesh->GetTriangle(VP, BaseIndex++);
+					mIMesh->GetTriangle(VP, BaseIndex++, VC);
 					ComputeMinMax(TmpMin, TmpMax, VP);
 					Min_.Min(TmpMin);
 					Max_.Max(TmpMax);
@@ -464,3 +486,80 @@ bool HybridModel::Refit()
 	}
 	return true;
 }
+
+	//! Header of serialized hybrid data, followed by leaf descriptors then indices
+	struct SavedHybridHeader
+	{
+		udword	mNbLeaves;		//!< Number of leaf nodes
+		udword	mNbTriangles;	//!< Number of saved leaf descriptors (0 for single-node models)
+		udword	mNbPrimitives;	//!< Number of saved indices (0 if the mesh has been remapped)
+		udword	mPad;
+	};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the size of serialized leaf data.
+ *	\return		size in bytes, a multiple of OPC_SAVE_ALIGNMENT
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword HybridModel::GetExtraSaveSize() const
+{
+	const udword NbTriangles = mTriangles ? mNbLeaves : 0;
+	const udword NbIndices = mIndices ? mNbPrimitives : 0;
+	return OPC_SAVE_ALIGN(sizeof(SavedHybridHeader) + NbTriangles*sizeof(LeafTriangles) + NbIndices*sizeof(udword));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Serializes leaf data.
+ *	\param		buffer		[out] destination buffer, GetExtraSaveSize() bytes
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HybridModel::SaveExtra(void* buffer) const
+{
+	SavedHybridHeader* Header = (SavedHybridHeader*)buffer;
+	Header->mNbLeaves		= mNbLeaves;
+	Header->mNbTriangles	= mTriangles ? mNbLeaves : 0;
+	Header->mNbPrimitives	= mIndices ? mNbPrimitives : 0;
+	Header->mPad			= 0;
+
+	ubyte* Data = (ubyte*)(Header+1);
+	CopyMemory(Data, mTriangles, Header->mNbTriangles*sizeof(LeafTriangles));
+	Data += Header->mNbTriangles*sizeof(LeafTriangles);
+	CopyMemory(Data, mIndices, Header->mNbPrimitives*sizeof(udword));
+	Data += Header->mNbPrimitives*sizeof(udword);
+
+	ZeroMemory(Data, GetExtraSaveSize() - udword(Data - (ubyte*)buffer));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Setups leaf data from serialized data, in place.
+ *	\param		buffer		[in] serialized data, or null to discard current data
+ *	\param		size		[in] size of serialized data
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HybridModel::LoadExtra(void* buffer, udword size)
+{
+	ReleaseLeaves();
+	if(!buffer || size<sizeof(SavedHybridHeader))	return false;
+
+	const SavedHybridHeader* Header = (const SavedHybridHeader*)buffer;
+	if(!Header->mNbLeaves)	return false;
+	if(HasSingleNode() ? Header->mNbTriangles!=0 : Header->mNbTriangles!=Header->mNbLeaves)	return false;
+	if(OPC_SAVE_ALIGN(sizeof(SavedHybridHeader) + Header->mNbTriangles*sizeof(LeafTriangles) + Header->mNbPrimitives*sizeof(udword))!=size)	return false;
+	// Tree's leaves reference leaf descriptors: complete tree over mNbLeaves boxes
+	if(mTree && mTree->GetNbNodes()!=(HasLeafNodes() ? Header->mNbLeaves*2-1 : Header->mNbLeaves-1))	return false;
+
+	ubyte* Data = (ubyte*)(Header+1);
+	mUserData		= true;
+	mNbLeaves		= Header->mNbLeaves;
+	mTriangles		= Header->mNbTriangles ? (LeafTriangles*)Data : null;
+	Data += Header->mNbTriangles*sizeof(LeafTriangles);
+	mNbPrimitives	= Header->mNbPrimitives;
+	mIndices		= Header->mNbPrimitives ? (udword*)Data : null;
+	return true;
+}
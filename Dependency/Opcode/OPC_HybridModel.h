@@ -77,6 +77,16 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		override(BaseModel)	bool					Refit();
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Refits the collision model. Leaves contain several triangles here, so the dirty triangles & threads from the
+		 *	settings are ignored, and the whole tree is refit.
+		 *	\param		settings	[in] refit settings, ignored by hybrid models
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		override(BaseModel)	bool					Refit(const RefitSettings& /*settings*/)	{ return Refit();	}
+
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
 		 *	Gets array of triangles.
@@ -98,9 +108,15 @@
 							LeafTriangles*			mTriangles;		//!< Array of mNbLeaves leaf descriptors
 							udword					mNbPrimitives;	//!< Number of primitives in the model
 							udword*					mIndices;		//!< Array of primitive indices
+							bool					mUserData;		//!< Arrays live in user memory (loaded model)
 
 		// Internal methods
 							void					Release();
+							void					ReleaseLeaves();
+		// Serialization
+		override(BaseModel)	udword					GetExtraSaveSize()					const;
+		override(BaseModel)	bool					SaveExtra(void* buffer)				const;
+		override(BaseModel)	bool					LoadExtra(void* buffer, udword size);
 	};
 
 #endif // __OPC_HYBRIDMODEL_H__
@@ -20,6 +20,12 @@
 	#include <float.h>
 	#include <Math.h>
 
+	// SSE2 intrinsics, when the compiler targets SSE2 (always the case on x64)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+		#define OPC_SSE2_TARGET
+		#include <emmintrin.h>
+	#endif
+
 	#ifndef ASSERT
 		#define	ASSERT(exp)	{}
 	#endif
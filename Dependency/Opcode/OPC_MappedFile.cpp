@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for memory-mapped files.
+ *	\file		OPC_MappedFile.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	A read-only file mapped in memory, used to load collision models in place.
+ *
+ *	\class		MappedFile
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+#ifdef PLATFORM_WINDOWS
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace Opcode;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile() : mData(null), mSize(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Maps a whole file in memory. The mapping is private & copy-on-write: the data can be modified (e.g. when a
+ *	loaded tree is refit), but changes are never written back to the file.
+ *	\param		filename	[in] file to map
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+	if(!filename)	return false;
+
+#ifdef PLATFORM_WINDOWS
+	HANDLE File = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+	if(File==INVALID_HANDLE_VALUE)	return false;
+
+	DWORD SizeHigh = 0;
+	const DWORD Size = GetFileSize(File, &SizeHigh);
+	if(Size==INVALID_FILE_SIZE || SizeHigh || !Size)
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	// The view keeps the mapping alive, so we can close both handles right away
+	HANDLE Mapping = CreateFileMappingA(File, null, PAGE_WRITECOPY, 0, 0, null);
+	CloseHandle(File);
+	if(!Mapping)	return false;
+	mData = MapViewOfFile(Mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(Mapping);
+	if(!mData)	return false;
+	mSize = Size;
+#else
+	const int File = open(filename, O_RDONLY);
+	if(File<0)	return false;
+
+	struct stat Stats;
+	if(fstat(File, &Stats) || !Stats.st_size || Stats.st_size>off_t(0xffffffff))
+	{
+		close(File);
+		return false;
+	}
+
+	void* Data = mmap(null, size_t(Stats.st_size), PROT_READ|PROT_WRITE, MAP_PRIVATE, File, 0);
+	close(File);
+	if(Data==MAP_FAILED)	return false;
+	mData = Data;
+	mSize = udword(Stats.st_size);
+#endif
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Unmaps the file.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void MappedFile::Close()
+{
+	if(mData)
+	{
+#ifdef PLATFORM_WINDOWS
+		UnmapViewOfFile(mData);
+#else
+		munmap(mData, mSize);
+#endif
+	}
+	mData = null;
+	mSize = 0;
+}
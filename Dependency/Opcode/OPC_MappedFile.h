@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for memory-mapped files.
+ *	\file		OPC_MappedFile.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_MAPPEDFILE_H__
+#define __OPC_MAPPEDFILE_H__
+
+	class OPCODE_API MappedFile
+	{
+		public:
+		// Constructor / Destructor
+										MappedFile();
+										~MappedFile();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Maps a whole file in memory. The mapping is private & copy-on-write: the data can be modified (e.g. when a
+		 *	loaded tree is refit), but changes are never written back to the file.
+		 *	\param		filename	[in] file to map
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						bool			Open(const char* filename);
+
+		// Unmaps the file
+						void			Close();
+
+		// Data access
+		inline_			void*			GetData()		const	{ return mData;	}
+		inline_			udword			GetSize()		const	{ return mSize;	}
+
+		private:
+						void*			mData;		//!< Mapped data, page-aligned
+						udword			mSize;		//!< Size of mapped data
+	};
+
+#endif // __OPC_MAPPEDFILE_H__
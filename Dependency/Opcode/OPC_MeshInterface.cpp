@@ -104,6 +104,24 @@
  *	cache misses. Please also note that you *shouldn't* read from AGP or video-memory buffers !
  *
  *
+ *	COMPRESSED MESHES:
+ *
+ *	Using pointers, triangles can also use 16-bit vertex references (IndexedTriangle16) and vertices can be
+ *	quantized to 16 bits per axis (QuantizedVertex), relative to the mesh's bounding box. This halves the
+ *	memory used by the client mesh. Vertices are decoded on the fly in GetTriangle(), to a conversion area
+ *	provided by the caller. QuantizeVertices() computes quantized vertices and the matching dequantization
+ *	parameters from a regular vertex array. Quantization is lossy: the collision trees should be built from
+ *	the compressed mesh, so that they match what the queries see.
+ *
+ *	Ex:
+ *
+ *	\code
+ *		Point Scale, Offset;
+ *		QuantizeVertices(NbVerts, Verts, QVerts, Scale, Offset);
+ *		MeshInterface0->SetPointers(Faces16, QVerts, Scale, Offset);
+ *	\endcode
+ *
+ *
  *	In any case, compilation flags are here to select callbacks/pointers/strides at compile time, so
  *	choose what's best for your application. All of this has been wrapped into this MeshInterface.
  *
@@ -131,7 +149,11 @@ MeshInterface::MeshInterface() :
 	mObjCallback	(null),
 #else
 	mTris			(null),
+	mTris16			(null),
 	mVerts			(null),
+	mQVerts			(null),
+	mDequantScale	(1.0f, 1.0f, 1.0f),
+	mDequantOffset	(0.0f, 0.0f, 0.0f),
 	#ifdef OPC_USE_STRIDE
 	mTriStride		(sizeof(IndexedTriangle)),
 	mVertexStride	(sizeof(Point)),
@@ -163,7 +185,8 @@ bool MeshInterface::IsValid() const
 #ifdef OPC_USE_CALLBACKS
 	if(!mObjCallback)			return false;
 #else
-	if(!mTris || !mVerts)		return false;
+	if(!mTris && !mTris16)		return false;
+	if(!mVerts && !mQVerts)		return false;
 #endif
 	return true;
 }
@@ -184,16 +207,32 @@ udword MeshInterface::CheckTopology()	const
 	udword NbDegenerate = 0;
 
 	VertexPointers VP;
+	ConversionArea VC;
 
 	// Using callbacks, we don't have access to vertex indices. Nevertheless we still can check for
 	// redundant vertex pointers, which cover all possibilities (callbacks/pointers/strides).
+	// Quantized vertices are decoded to the conversion area, so we compare them by value.
+#ifndef OPC_USE_CALLBACKS
+	const bool ByValue = mQVerts!=null;
+#else
+	const bool ByValue = false;
+#endif
 	for(udword i=0;i<mNbTris;i++)
 	{
-		GetTriangle(VP, i);
+		GetTriangle(VP, i, VC);
 
-		if(		(VP.Vertex[0]==VP.Vertex[1])
-			||	(VP.Vertex[1]==VP.Vertex[2])
-			||	(VP.Vertex[2]==VP.Vertex[0]))	NbDegenerate++;
+		if(ByValue)
+		{
+			if(		(*VP.Vertex[0]==*VP.Vertex[1])
+				||	(*VP.Vertex[1]==*VP.Vertex[2])
+				||	(*VP.Vertex[2]==*VP.Vertex[0]))	NbDegenerate++;
+		}
+		else
+		{
+			if(		(VP.Vertex[0]==VP.Vertex[1])
+				||	(VP.Vertex[1]==VP.Vertex[2])
+				||	(VP.Vertex[2]==VP.Vertex[0]))	NbDegenerate++;
+		}
 	}
 
 	return NbDegenerate;
@@ -230,7 +269,90 @@ bool MeshInterface::SetPointers(const IndexedTriangle* tris, const Point* verts)
 	if(!tris || !verts)	return SetIceError("MeshInterface::SetPointers: pointer is null", null);
 
 	mTris	= tris;
+	mTris16	= null;
+	mVerts	= verts;
+	mQVerts	= null;
+	#ifdef OPC_USE_STRIDE
+	mTriStride		= sizeof(IndexedTriangle);
+	mVertexStride	= sizeof(Point);
+	#endif
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Pointers control: setups object pointers for a mesh using 16-bit indices.
+ *	\param		tris	[in] pointer to triangles
+ *	\param		verts	[in] pointer to vertices
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshInterface::SetPointers(const IndexedTriangle16* tris, const Point* verts)
+{
+	if(!tris || !verts)	return SetIceError("MeshInterface::SetPointers: pointer is null", null);
+
+	mTris	= null;
+	mTris16	= tris;
 	mVerts	= verts;
+	mQVerts	= null;
+	#ifdef OPC_USE_STRIDE
+	mTriStride		= sizeof(IndexedTriangle16);
+	mVertexStride	= sizeof(Point);
+	#endif
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Pointers control: setups object pointers for a mesh using quantized vertices.
+ *	\param		tris	[in] pointer to triangles
+ *	\param		verts	[in] pointer to quantized vertices
+ *	\param		scale	[in] dequantization scale
+ *	\param		offset	[in] dequantization offset
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshInterface::SetPointers(const IndexedTriangle* tris, const QuantizedVertex* verts, const Point& scale, const Point& offset)
+{
+	if(!tris || !verts)	return SetIceError("MeshInterface::SetPointers: pointer is null", null);
+
+	mTris			= tris;
+	mTris16			= null;
+	mVerts			= null;
+	mQVerts			= verts;
+	mDequantScale	= scale;
+	mDequantOffset	= offset;
+	#ifdef OPC_USE_STRIDE
+	mTriStride		= sizeof(IndexedTriangle);
+	mVertexStride	= sizeof(QuantizedVertex);
+	#endif
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Pointers control: setups object pointers for a mesh using 16-bit indices and quantized vertices.
+ *	\param		tris	[in] pointer to triangles
+ *	\param		verts	[in] pointer to quantized vertices
+ *	\param		scale	[in] dequantization scale
+ *	\param		offset	[in] dequantization offset
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshInterface::SetPointers(const IndexedTriangle16* tris, const QuantizedVertex* verts, const Point& scale, const Point& offset)
+{
+	if(!tris || !verts)	return SetIceError("MeshInterface::SetPointers: pointer is null", null);
+
+	mTris			= null;
+	mTris16			= tris;
+	mVerts			= null;
+	mQVerts			= verts;
+	mDequantScale	= scale;
+	mDequantOffset	= offset;
+	#ifdef OPC_USE_STRIDE
+	mTriStride		= sizeof(IndexedTriangle16);
+	mVertexStride	= sizeof(QuantizedVertex);
+	#endif
 	return true;
 }
 #ifdef OPC_USE_STRIDE
@@ -244,8 +366,10 @@ bool MeshInterface::SetPointers(const IndexedTriangle* tris, const Point* verts)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool MeshInterface::SetStrides(udword tri_stride, udword vertex_stride)
 {
-	if(tri_stride<sizeof(IndexedTriangle))	return SetIceError("MeshInterface::SetStrides: invalid triangle stride", null);
-	if(vertex_stride<sizeof(Point))			return SetIceError("MeshInterface::SetStrides: invalid vertex stride", null);
+	const udword MinTriStride		= mTris16 ? sizeof(IndexedTriangle16) : sizeof(IndexedTriangle);
+	const udword MinVertexStride	= mQVerts ? sizeof(QuantizedVertex) : sizeof(Point);
+	if(tri_stride<MinTriStride)			return SetIceError("MeshInterface::SetStrides: invalid triangle stride", null);
+	if(vertex_stride<MinVertexStride)	return SetIceError("MeshInterface::SetStrides: invalid vertex stride", null);
 
 	mTriStride		= tri_stride;
 	mVertexStride	= vertex_stride;
@@ -272,28 +396,93 @@ bool MeshInterface::RemapClient(udword nb_indices, const udword* permutation) co
 	// We can't really do that using callbacks
 	return false;
 #else
-	IndexedTriangle* Tmp = new IndexedTriangle[mNbTris];
+	if(mTris16)	return RemapTriangles(mTris16, nb_indices, permutation);
+	return RemapTriangles(mTris, nb_indices, permutation);
+#endif
+}
+
+#ifndef OPC_USE_CALLBACKS
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Remaps client's triangles according to a permutation.
+ *	\param		tris		[in] client's triangles (IndexedTriangle or IndexedTriangle16)
+ *	\param		nb_indices	[in] number of indices in the permutation
+ *	\param		permutation	[in] list of triangle indices
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class T> bool MeshInterface::RemapTriangles(const T* tris, udword nb_indices, const udword* permutation) const
+{
+	T* Tmp = new T[nb_indices];
 	CHECKALLOC(Tmp);
 
 	#ifdef OPC_USE_STRIDE
 	udword Stride = mTriStride;
 	#else
-	udword Stride = sizeof(IndexedTriangle);
+	udword Stride = sizeof(T);
 	#endif
 
-	for(udword i=0;i<mNbTris;i++)
+	for(udword i=0;i<nb_indices;i++)
 	{
-		const IndexedTriangle* T = (const IndexedTriangle*)(((ubyte*)mTris) + i * Stride);
-		Tmp[i] = *T;
+		const T* Tri = (const T*)(((ubyte*)tris) + i * Stride);
+		Tmp[i] = *Tri;
 	}
 
-	for(udword i=0;i<mNbTris;i++)
+	for(udword i=0;i<nb_indices;i++)
 	{
-		IndexedTriangle* T = (IndexedTriangle*)(((ubyte*)mTris) + i * Stride);
-		*T = Tmp[permutation[i]];
+		T* Tri = (T*)(((ubyte*)tris) + i * Stride);
+		*Tri = Tmp[permutation[i]];
 	}
 
 	DELETEARRAY(Tmp);
+	return true;
+}
 #endif
+
+static inline_ uword QuantizeCoord(float q)
+{
+	q += 0.5f;
+	if(q<0.0f)		q = 0.0f;
+	if(q>65535.0f)	q = 65535.0f;
+	return uword(q);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Quantizes vertices to 16 bits per axis, relative to their bounding box.
+ *	\param		nb_verts	[in] number of vertices
+ *	\param		verts		[in] source vertices
+ *	\param		dest		[out] quantized vertices (nb_verts entries)
+ *	\param		scale		[out] dequantization scale
+ *	\param		offset		[out] dequantization offset
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Opcode::QuantizeVertices(udword nb_verts, const Point* verts, QuantizedVertex* dest, Point& scale, Point& offset)
+{
+	if(!nb_verts || !verts || !dest)	return SetIceError("QuantizeVertices: invalid parameters", null);
+
+	// Compute bounding box
+	Point Min = verts[0];
+	Point Max = verts[0];
+	for(udword i=1;i<nb_verts;i++)
+	{
+		Min.Min(verts[i]);
+		Max.Max(verts[i]);
+	}
+
+	// Quantize over the full 16-bit range. Flat axes get a unit scale so that they decode exactly.
+	offset = Min;
+	scale.x = Max.x!=Min.x ? (Max.x - Min.x) / 65535.0f : 1.0f;
+	scale.y = Max.y!=Min.y ? (Max.y - Min.y) / 65535.0f : 1.0f;
+	scale.z = Max.z!=Min.z ? (Max.z - Min.z) / 65535.0f : 1.0f;
+	const Point Quant(1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z);
+
+	for(udword i=0;i<nb_verts;i++)
+	{
+		dest[i].x = QuantizeCoord((verts[i].x - offset.x) * Quant.x);
+		dest[i].y = QuantizeCoord((verts[i].y - offset.y) * Quant.y);
+		dest[i].z = QuantizeCoord((verts[i].z - offset.z) * Quant.z);
+	}
 	return true;
 }
@@ -38,6 +38,35 @@
 		}
 	};
 
+	//! Temporary storage for decoded vertices. Compressed meshes can't return pointers to their vertices, so they're
+	//! decoded here and the vertex pointers point to this area. Must live as long as the vertex pointers are used.
+	typedef Point	ConversionArea[3];
+
+	//! 16-bit indexed triangle
+	struct IndexedTriangle16
+	{
+		uword			mVRef[3];		//!< Vertex references
+	};
+
+	//! 16-bit quantized vertex, decoded as offset + scale * q (see QuantizeVertices)
+	struct QuantizedVertex
+	{
+		uword			x, y, z;		//!< Quantized coordinates
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/**
+	 *	Quantizes vertices to 16 bits per axis, relative to their bounding box.
+	 *	\param		nb_verts	[in] number of vertices
+	 *	\param		verts		[in] source vertices
+	 *	\param		dest		[out] quantized vertices (nb_verts entries)
+	 *	\param		scale		[out] dequantization scale
+	 *	\param		offset		[out] dequantization offset
+	 *	\return		true if success
+	 */
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	OPCODE_API bool QuantizeVertices(udword nb_verts, const Point* verts, QuantizedVertex* dest, Point& scale, Point& offset);
+
 #ifdef OPC_USE_CALLBACKS
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/**
@@ -88,15 +117,51 @@
 		 */
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 						bool				SetPointers(const IndexedTriangle* tris, const Point* verts);
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Pointers control: setups object pointers for compressed meshes. Triangles can use 16-bit indices, and
+		 *	vertices can be quantized to 16 bits per axis (see QuantizeVertices). Decoding happens on the fly when
+		 *	triangles are fetched. Strides are reset to the packed sizes.
+		 *	\param		tris	[in] pointer to triangles
+		 *	\param		verts	[in] pointer to vertices
+		 *	\param		scale	[in] dequantization scale
+		 *	\param		offset	[in] dequantization offset
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						bool				SetPointers(const IndexedTriangle16* tris, const Point* verts);
+						bool				SetPointers(const IndexedTriangle* tris, const QuantizedVertex* verts, const Point& scale, const Point& offset);
+						bool				SetPointers(const IndexedTriangle16* tris, const QuantizedVertex* verts, const Point& scale, const Point& offset);
 		inline_	const	IndexedTriangle*	GetTris()			const	{ return mTris;			}
+		inline_	const	IndexedTriangle16*	GetTris16()			const	{ return mTris16;		}
 		inline_	const	Point*				GetVerts()			const	{ return mVerts;		}
+		inline_	const	QuantizedVertex*	GetQuantizedVerts()	const	{ return mQVerts;		}
+		inline_	const	Point&				GetDequantScale()	const	{ return mDequantScale;	}
+		inline_	const	Point&				GetDequantOffset()	const	{ return mDequantOffset;}
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Decodes a quantized vertex.
+		 *	\param		dest	[out] decoded vertex
+		 *	\param		v		[in] quantized vertex
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_			void				DecodeVertex(Point& dest, const QuantizedVertex& v)	const
+											{
+												// Scalar conversions are used on purpose: the decoded vertices are read back by scalar
+												// code, and SSE2 decoding followed by scalar loads has been measured slower.
+												dest.x = float(v.x) * mDequantScale.x + mDequantOffset.x;
+												dest.y = float(v.y) * mDequantScale.y + mDequantOffset.y;
+												dest.z = float(v.z) * mDequantScale.z + mDequantOffset.z;
+											}
 
 	#ifdef OPC_USE_STRIDE
 		// Strides settings
 
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
-		 *	Strides control
+		 *	Strides control. Must be called after SetPointers(), since valid strides depend on the triangle & vertex formats.
 		 *	\param		tri_stride		[in] size of a triangle in bytes. The first sizeof(IndexedTriangle) bytes are used to get vertex indices.
 		 *	\param		vertex_stride	[in] size of a vertex in bytes. The first sizeof(Point) bytes are used to get vertex position.
 		 *	\return		true if success
@@ -110,27 +175,50 @@
 
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
-		 *	Fetches a triangle given a triangle index.
+		 *	Fetches a triangle given a triangle index. Compressed vertices are decoded to the conversion area.
 		 *	\param		vp		[out] required triangle's vertex pointers
 		 *	\param		index	[in] triangle index
+		 *	\param		vc		[out] conversion area, used by compressed meshes only
 		 */
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		inline_			void				GetTriangle(VertexPointers& vp, udword index)	const
+		inline_			void				GetTriangle(VertexPointers& vp, udword index, ConversionArea vc)	const
 											{
 #ifdef OPC_USE_CALLBACKS
 												(mObjCallback)(index, vp, mUserData);
 #else
-	#ifdef OPC_USE_STRIDE
-												const IndexedTriangle* T = (const IndexedTriangle*)(((ubyte*)mTris) + index * mTriStride);
-												vp.Vertex[0] = (const Point*)(((ubyte*)mVerts) + T->mVRef[0] * mVertexStride);
-												vp.Vertex[1] = (const Point*)(((ubyte*)mVerts) + T->mVRef[1] * mVertexStride);
-												vp.Vertex[2] = (const Point*)(((ubyte*)mVerts) + T->mVRef[2] * mVertexStride);
-	#else
-												const IndexedTriangle* T = &mTris[index];
-												vp.Vertex[0] = &mVerts[T->mVRef[0]];
-												vp.Vertex[1] = &mVerts[T->mVRef[1]];
-												vp.Vertex[2] = &mVerts[T->mVRef[2]];
-	#endif
+												// Fetch vertex references
+												udword VRef0, VRef1, VRef2;
+												if(mTris16)
+												{
+													const IndexedTriangle16* T = GetTri16(index);
+													VRef0 = T->mVRef[0];
+													VRef1 = T->mVRef[1];
+													VRef2 = T->mVRef[2];
+												}
+												else
+												{
+													const IndexedTriangle* T = GetTri(index);
+													VRef0 = T->mVRef[0];
+													VRef1 = T->mVRef[1];
+													VRef2 = T->mVRef[2];
+												}
+
+												// Fetch vertices
+												if(mQVerts)
+												{
+													DecodeVertex(vc[0], *GetQVertex(VRef0));
+													DecodeVertex(vc[1], *GetQVertex(VRef1));
+													DecodeVertex(vc[2], *GetQVertex(VRef2));
+													vp.Vertex[0] = &vc[0];
+													vp.Vertex[1] = &vc[1];
+													vp.Vertex[2] = &vc[2];
+												}
+												else
+												{
+													vp.Vertex[0] = GetVertex(VRef0);
+													vp.Vertex[1] = GetVertex(VRef1);
+													vp.Vertex[2] = GetVertex(VRef2);
+												}
 #endif
 											}
 
@@ -171,11 +259,28 @@
 #else
 		// User pointers
 				const	IndexedTriangle*	mTris;				//!< Array of indexed triangles
+				const	IndexedTriangle16*	mTris16;			//!< Array of 16-bit indexed triangles (exclusive with mTris)
 				const	Point*				mVerts;				//!< Array of vertices
+				const	QuantizedVertex*	mQVerts;			//!< Array of quantized vertices (exclusive with mVerts)
+						Point				mDequantScale;		//!< Dequantization scale for mQVerts
+						Point				mDequantOffset;		//!< Dequantization offset for mQVerts
 	#ifdef OPC_USE_STRIDE
 						udword				mTriStride;			//!< Possible triangle stride in bytes [Opcode 1.3]
 						udword				mVertexStride;		//!< Possible vertex stride in bytes [Opcode 1.3]
 	#endif
+		// Internal methods
+	#ifdef OPC_USE_STRIDE
+		inline_	const	IndexedTriangle*	GetTri(udword i)		const	{ return (const IndexedTriangle*)(((ubyte*)mTris) + i * mTriStride);		}
+		inline_	const	IndexedTriangle16*	GetTri16(udword i)		const	{ return (const IndexedTriangle16*)(((ubyte*)mTris16) + i * mTriStride);	}
+		inline_	const	Point*				GetVertex(udword i)		const	{ return (const Point*)(((ubyte*)mVerts) + i * mVertexStride);				}
+		inline_	const	QuantizedVertex*	GetQVertex(udword i)	const	{ return (const QuantizedVertex*)(((ubyte*)mQVerts) + i * mVertexStride);	}
+	#else
+		inline_	const	IndexedTriangle*	GetTri(udword i)		const	{ return &mTris[i];		}
+		inline_	const	IndexedTriangle16*	GetTri16(udword i)		const	{ return &mTris16[i];	}
+		inline_	const	Point*				GetVertex(udword i)		const	{ return &mVerts[i];	}
+		inline_	const	QuantizedVertex*	GetQVertex(udword i)	const	{ return &mQVerts[i];	}
+	#endif
+		template<class T>	bool			RemapTriangles(const T* tris, udword nb_indices, const udword* permutation)	const;
 #endif
 	};
 
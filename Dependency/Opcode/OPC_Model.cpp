@@ -142,7 +142,7 @@ bool Model::Build(const OPCODECREATE& create)
 	if(!create.mIMesh || !create.mIMesh->IsValid())	return false;
 
 	// For this model, we only support complete trees
-	if(create.mSettings.mLimit!=1)	return SetIceError("OPCODE WARNING: supports complete trees only! Use mLimit = 1.\n", null);
+	if(!create.mWideTree && create.mSettings.mLimit!=1)	return SetIceError("OPCODE WARNING: supports complete trees only! Use mLimit = 1.\n", null);
 
 	// Look for degenerate faces.
 	udword NbDegenerate = create.mIMesh->CheckTopology();
@@ -164,6 +164,18 @@ bool Model::Build(const OPCODECREATE& create)
 		return true;
 	}
 
+	// 2) Wide trees are built directly from the mesh [SAH builder]
+	if(create.mWideTree)
+	{
+		mModelCode |= OPC_WIDE;
+
+		AABBWideTree* Tree = new AABBWideTree;
+		CHECKALLOC(Tree);
+		mTree = Tree;
+
+		return Tree->Build(create.mIMesh, create.mWideSettings);
+	}
+
 	// 2) Build a generic AABB Tree.
 	mSource = new AABBTree;
 	CHECKALLOC(mSource);
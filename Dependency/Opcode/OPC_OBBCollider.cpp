@@ -43,7 +43,7 @@ using namespace Opcode;
 //! OBB-triangle test
 #define OBB_PRIM(prim_index, flag)												\
 	/* Request vertices from the app */											\
-	VertexPointers VP;	mIMesh->GetTriangle(VP, prim_index);					\
+	VertexPointers VP;	ConversionArea VC;	mIMesh->GetTriangle(VP, prim_index, VC);					\
 	/* Transform them in a common space */										\
 	TransformPoint(mLeafVerts[0], *VP.Vertex[0], mRModelToBox, mTModelToBox);	\
 	TransformPoint(mLeafVerts[1], *VP.Vertex[1], mRModelToBox, mTModelToBox);	\
@@ -105,6 +105,7 @@ bool OBBCollider::Collide(OBBCache& cache, const OBB& box, const Model& model, c
 {
 	// Checkings
 	if(!Setup(&model))	return false;
+	if(model.IsWide())	return SetIceError("OPCODE WARNING: wide trees are not supported by this collider.\n", null);
 
 	// Init collision query
 	if(InitQuery(cache, box, worldb, worldm))	return true;
@@ -303,34 +304,12 @@ BOOL OBBCollider::InitQuery(OBBCache& cache, const OBB& box, const Matrix4x4* wo
 
 	// Now we can precompute box-box data
 
-	// Precompute absolute box-to-model rotation matrix
-	for(udword i=0;i<3;i++)
-	{
-		for(udword j=0;j<3;j++)
-		{
-			// Epsilon value prevents floating-point inaccuracies (strategy borrowed from RAPID)
-			mAR.m[i][j] = 1e-6f + fabsf(mRBoxToModel.m[i][j]);
-		}
-	}
-
 	// Precompute bounds for box-in-box test
 	mB0 = mBoxExtents - mTModelToBox;
 	mB1 = - mBoxExtents - mTModelToBox;
 
-	// Precompute box-box data - Courtesy of Erwin de Vries
-	mBBx1 = mBoxExtents.x*mAR.m[0][0] + mBoxExtents.y*mAR.m[1][0] + mBoxExtents.z*mAR.m[2][0];
-	mBBy1 = mBoxExtents.x*mAR.m[0][1] + mBoxExtents.y*mAR.m[1][1] + mBoxExtents.z*mAR.m[2][1];
-	mBBz1 = mBoxExtents.x*mAR.m[0][2] + mBoxExtents.y*mAR.m[1][2] + mBoxExtents.z*mAR.m[2][2];
-
-	mBB_1 = mBoxExtents.y*mAR.m[2][0] + mBoxExtents.z*mAR.m[1][0];
-	mBB_2 = mBoxExtents.x*mAR.m[2][0] + mBoxExtents.z*mAR.m[0][0];
-	mBB_3 = mBoxExtents.x*mAR.m[1][0] + mBoxExtents.y*mAR.m[0][0];
-	mBB_4 = mBoxExtents.y*mAR.m[2][1] + mBoxExtents.z*mAR.m[1][1];
-	mBB_5 = mBoxExtents.x*mAR.m[2][1] + mBoxExtents.z*mAR.m[0][1];
-	mBB_6 = mBoxExtents.x*mAR.m[1][1] + mBoxExtents.y*mAR.m[0][1];
-	mBB_7 = mBoxExtents.y*mAR.m[2][2] + mBoxExtents.z*mAR.m[1][2];
-	mBB_8 = mBoxExtents.x*mAR.m[2][2] + mBoxExtents.z*mAR.m[0][2];
-	mBB_9 = mBoxExtents.x*mAR.m[1][2] + mBoxExtents.y*mAR.m[0][2];
+	// Precompute box-box data, including the absolute box-to-model rotation matrix
+	mBoxBoxData.Init(mRBoxToModel, mTBoxToModel, mBoxExtents);
 
 	return FALSE;
 }
@@ -82,7 +82,6 @@
 
 		protected:
 		// Precomputed data
-							Matrix3x3		mAR;				//!< Absolute rotation matrix
 							Matrix3x3		mRModelToBox;		//!< Rotation from model space to obb space
 							Matrix3x3		mRBoxToModel;		//!< Rotation from obb space to model space
 							Point			mTModelToBox;		//!< Translation from model space to obb space
@@ -92,19 +91,7 @@
 							Point			mB0;				//!< - mTModelToBox + mBoxExtents
 							Point			mB1;				//!< - mTModelToBox - mBoxExtents
 
-							float			mBBx1;
-							float			mBBy1;
-							float			mBBz1;
-
-							float			mBB_1;
-							float			mBB_2;
-							float			mBB_3;
-							float			mBB_4;
-							float			mBB_5;
-							float			mBB_6;
-							float			mBB_7;
-							float			mBB_8;
-							float			mBB_9;
+							OBBAABBData		mBoxBoxData;		//!< Box-box data
 
 		// Leaf description
 							Point			mLeafVerts[3];		//!< Triangle vertices
@@ -75,6 +75,95 @@ using namespace Opcode;
 //! - false to see the effects of quantization errors (faster, but wrong results in some cases)
 static bool gFixQuantized = true;
 
+//! Releases the nodes, unless they belong to the user
+#define RELEASE_NODES					\
+	if(mUserNodes)	mNodes = null;		\
+	else			DELETEARRAY(mNodes);	\
+	mUserNodes = false;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Serializes an array of nodes. Node links are relative offsets, so nodes are simply copied.
+ *	\param		buffer			[out] destination buffer
+ *	\param		nodes			[in] nodes to save
+ *	\param		nb_nodes		[in] number of nodes
+ *	\param		node_size		[in] size of a node
+ *	\param		center_coeff	[in] dequantization coeffs, or null
+ *	\param		extents_coeff	[in] dequantization coeffs, or null
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool _SaveNodes(void* buffer, const void* nodes, udword nb_nodes, udword node_size, const Point* center_coeff, const Point* extents_coeff)
+{
+	if(!buffer || !nodes)	return false;
+
+	SavedTreeHeader* Header = (SavedTreeHeader*)buffer;
+	ZeroMemory(Header, sizeof(SavedTreeHeader));
+	Header->mNbNodes	= nb_nodes;
+	Header->mNodeSize	= node_size;
+	if(center_coeff)	Header->mCenterCoeff	= *center_coeff;
+	if(extents_coeff)	Header->mExtentsCoeff	= *extents_coeff;
+
+	// Copy nodes, and clear the padding so that saved files are deterministic
+	const udword Size = nb_nodes*node_size;
+	ubyte* Nodes = (ubyte*)(Header+1);
+	CopyMemory(Nodes, nodes, Size);
+	ZeroMemory(Nodes + Size, OPC_SAVE_ALIGN(Size) - Size);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Checks serialized nodes and returns them, for in-place use.
+ *	\param		buffer			[in] serialized data
+ *	\param		size			[in] size of serialized data
+ *	\param		node_size		[in] expected size of a node
+ *	\param		nb_nodes		[out] number of nodes
+ *	\param		center_coeff	[out] dequantization coeffs, or null
+ *	\param		extents_coeff	[out] dequantization coeffs, or null
+ *	\return		serialized nodes, or null if data is invalid
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void* _LoadNodes(void* buffer, udword size, udword node_size, udword& nb_nodes, Point* center_coeff, Point* extents_coeff)
+{
+	if(!buffer || size<sizeof(SavedTreeHeader))	return null;
+
+	const SavedTreeHeader* Header = (const SavedTreeHeader*)buffer;
+	if(Header->mNodeSize!=node_size || Header->mNbPrimitives)	return null;
+	if(!Header->mNbNodes || Header->mNbNodes>(size - sizeof(SavedTreeHeader))/node_size)	return null;
+	if(sizeof(SavedTreeHeader) + OPC_SAVE_ALIGN(Header->mNbNodes*node_size)!=size)		return null;
+
+	nb_nodes = Header->mNbNodes;
+	if(center_coeff)	*center_coeff	= Header->mCenterCoeff;
+	if(extents_coeff)	*extents_coeff	= Header->mExtentsCoeff;
+	return (void*)(Header+1);
+}
+
+//! Implements serialization for optimized trees
+#define IMPLEMENT_TREE_SERIALIZATION(base_class, node, center_coeff, extents_coeff)					\
+udword base_class::GetSaveSize() const																\
+{																									\
+	return sizeof(SavedTreeHeader) + OPC_SAVE_ALIGN(mNbNodes*sizeof(node));							\
+}																									\
+																									\
+bool base_class::Save(void* buffer) const															\
+{																									\
+	return _SaveNodes(buffer, mNodes, mNbNodes, sizeof(node), center_coeff, extents_coeff);		\
+}																									\
+																									\
+bool base_class::Load(void* buffer, udword size)													\
+{																									\
+	udword NbNodes;																					\
+	node* Nodes = (node*)_LoadNodes(buffer, size, sizeof(node), NbNodes, center_coeff, extents_coeff);	\
+	if(!Nodes)	return false;																		\
+																									\
+	RELEASE_NODES																					\
+	mNodes		= Nodes;																			\
+	mNbNodes	= NbNodes;																			\
+	mUserNodes	= true;																				\
+	return true;																					\
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Builds an implicit tree from a standard one. An implicit tree is a complete tree (2*N-1 nodes) whose negative
@@ -86,7 +175,7 @@ static bool gFixQuantized = true;
  *			- data (32-bits value)
  *
  *	if data's LSB = 1 =>	remaining bits are a primitive pointer
- *	else					remaining bits are a P-node pointer, and N = P + 1
+ *	else					data is the offset of the P-node in bytes, relative to current node, and N = P + 1
  *
  *	\relates	AABBCollisionNode
  *	\fn			_BuildCollisionTree(AABBCollisionNode* linear, const udword box_id, udword& current_id, const AABBTreeNode* current_node)
@@ -118,8 +207,8 @@ static void _BuildCollisionTree(AABBCollisionNode* linear, const udword box_id,
 		// To make the negative one implicit, we must store P and N in successive order
 		udword PosID = current_id++;	// Get a new id for positive child
 		udword NegID = current_id++;	// Get a new id for negative child
-		// Setup box data as the forthcoming new P pointer
-		linear[box_id].mData = (udword)&linear[PosID];
+		// Setup box data as the offset to the forthcoming P node
+		linear[box_id].mData = (PosID - box_id)*sizeof(AABBCollisionNode);
 		// Make sure it's not marked as leaf
 		ASSERT(!(linear[box_id].mData&1));
 		// Recurse with new IDs
@@ -136,8 +225,8 @@ static void _BuildCollisionTree(AABBCollisionNode* linear, const udword box_id,
  *
  *	Node:
  *			- box
- *			- P pointer => a node (LSB=0) or a primitive (LSB=1)
- *			- N pointer => a node (LSB=0) or a primitive (LSB=1)
+ *			- P offset => a node (LSB=0) or a primitive (LSB=1)
+ *			- N offset => a node (LSB=0) or a primitive (LSB=1)
  *
  *	\relates	AABBNoLeafNode
  *	\fn			_BuildNoLeafTree(AABBNoLeafNode* linear, const udword box_id, udword& current_id, const AABBTreeNode* current_node)
@@ -172,7 +261,7 @@ static void _BuildNoLeafTree(AABBNoLeafNode* linear, const udword box_id, udword
 		// Get a new id for positive child
 		udword PosID = current_id++;
 		// Setup box data
-		linear[box_id].mPosData = (udword)&linear[PosID];
+		linear[box_id].mPosData = (PosID - box_id)*sizeof(AABBNoLeafNode);
 		// Make sure it's not marked as leaf
 		ASSERT(!(linear[box_id].mPosData&1));
 		// Recurse
@@ -193,7 +282,7 @@ static void _BuildNoLeafTree(AABBNoLeafNode* linear, const udword box_id, udword
 		// Get a new id for negative child
 		udword NegID = current_id++;
 		// Setup box data
-		linear[box_id].mNegData = (udword)&linear[NegID];
+		linear[box_id].mNegData = (NegID - box_id)*sizeof(AABBNoLeafNode);
 		// Make sure it's not marked as leaf
 		ASSERT(!(linear[box_id].mNegData&1));
 		// Recurse
@@ -206,7 +295,7 @@ static void _BuildNoLeafTree(AABBNoLeafNode* linear, const udword box_id, udword
  *	Constructor.
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-AABBCollisionTree::AABBCollisionTree() : mNodes(null)
+AABBCollisionTree::AABBCollisionTree() : mNodes(null), mUserNodes(false)
 {
 }
 
@@ -217,7 +306,7 @@ AABBCollisionTree::AABBCollisionTree() : mNodes(null)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 AABBCollisionTree::~AABBCollisionTree()
 {
-	DELETEARRAY(mNodes);
+	RELEASE_NODES
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -237,10 +326,10 @@ bool AABBCollisionTree::Build(AABBTree* tree)
 	if(NbNodes!=NbTriangles*2-1)	return false;
 
 	// Get nodes
-	if(mNbNodes!=NbNodes)	// Same number of nodes => keep moving
+	if(mNbNodes!=NbNodes || mUserNodes)	// Same number of nodes => keep moving
 	{
 		mNbNodes = NbNodes;
-		DELETEARRAY(mNodes);
+		RELEASE_NODES
 		mNodes = new AABBCollisionNode[mNbNodes];
 		CHECKALLOC(mNodes);
 	}
@@ -253,6 +342,44 @@ bool AABBCollisionTree::Build(AABBTree* tree)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refit kernel for AABBCollisionTree nodes. See RefitKernel.
+ *	\param		node		[in] node to refit
+ *	\param		context		[in] refit context
+ *	\param		depth		[in] node's depth
+ *	\return		REFIT_XXX flags
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _RefitCollisionNode(void* node, RefitContext& context, udword depth)
+{
+	if(depth==context.mSplitDepth)	return context.Subtree(node);
+
+	AABBCollisionNode* Current = (AABBCollisionNode*)node;
+	Point Min, Max;
+	if(Current->IsLeaf())
+	{
+		if(context.mGather || !context.IsDirty(Current->GetPrimitive()))	return 0;
+		context.GetTriangleBox(Current->GetPrimitive(), Min, Max);
+	}
+	else
+	{
+		const AABBCollisionNode* Pos = Current->GetPos();
+		const AABBCollisionNode* Neg = Current->GetNeg();
+		const udword Flags = _RefitCollisionNode((void*)Pos, context, depth+1) | _RefitCollisionNode((void*)Neg, context, depth+1);
+		if(context.mGather || !Flags)	return 0;
+
+		Point Min_, Max_;
+		Pos->mAABB.GetMin(Min);
+		Pos->mAABB.GetMax(Max);
+		Neg->mAABB.GetMin(Min_);
+		Neg->mAABB.GetMax(Max_);
+		Min.Min(Min_);
+		Max.Max(Max_);
+	}
+	return context.UpdateBox(Current->mAABB, Min, Max);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Refits the collision tree after vertices have been modified.
@@ -262,8 +389,25 @@ bool AABBCollisionTree::Build(AABBTree* tree)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool AABBCollisionTree::Refit(const MeshInterface* mesh_interface)
 {
-	ASSERT(!"Not implemented since AABBCollisionTrees have twice as more nodes to refit as AABBNoLeafTrees!");
-	return false;
+	return Refit(mesh_interface, RefitSettings());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the collision tree after vertices have been modified, only updating the nodes above dirty primitives.
+ *	\param		mesh_interface	[in] mesh interface for current model
+ *	\param		settings		[in] refit settings
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBCollisionTree::Refit(const MeshInterface* mesh_interface, const RefitSettings& settings)
+{
+	// Checkings
+	if(!mesh_interface || !mNodes)	return false;
+
+	RefitContext Context(mesh_interface, settings.mDirtyPrimitives, _RefitCollisionNode, this);
+	RefitTree(mNodes, mNbNodes, Context, settings);
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -301,7 +445,7 @@ bool AABBCollisionTree::Walk(GenericWalkingCallback callback, void* user_data) c
  *	Constructor.
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-AABBNoLeafTree::AABBNoLeafTree() : mNodes(null)
+AABBNoLeafTree::AABBNoLeafTree() : mNodes(null), mUserNodes(false)
 {
 }
 
@@ -312,7 +456,7 @@ AABBNoLeafTree::AABBNoLeafTree() : mNodes(null)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 AABBNoLeafTree::~AABBNoLeafTree()
 {
-	DELETEARRAY(mNodes);
+	RELEASE_NODES
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -332,10 +476,10 @@ bool AABBNoLeafTree::Build(AABBTree* tree)
 	if(NbNodes!=NbTriangles*2-1)	return false;
 
 	// Get nodes
-	if(mNbNodes!=NbTriangles-1)	// Same number of nodes => keep moving
+	if(mNbNodes!=NbTriangles-1 || mUserNodes)	// Same number of nodes => keep moving
 	{
 		mNbNodes = NbTriangles-1;
-		DELETEARRAY(mNodes);
+		RELEASE_NODES
 		mNodes = new AABBNoLeafNode[mNbNodes];
 		CHECKALLOC(mNodes);
 	}
@@ -348,26 +492,45 @@ bool AABBNoLeafTree::Build(AABBTree* tree)
 	return true;
 }
 
-inline_ void ComputeMinMax(Point& min, Point& max, const VertexPointers& vp)
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refit kernel for AABBNoLeafTree nodes. See RefitKernel.
+ *	\param		node		[in] node to refit
+ *	\param		context		[in] refit context
+ *	\param		depth		[in] node's depth
+ *	\return		REFIT_XXX flags
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _RefitNoLeafNode(void* node, RefitContext& context, udword depth)
 {
-	// Compute triangle's AABB = a leaf box
-#ifdef OPC_USE_FCOMI	// a 15% speedup on my machine, not much
-	min.x = FCMin3(vp.Vertex[0]->x, vp.Vertex[1]->x, vp.Vertex[2]->x);
-	max.x = FCMax3(vp.Vertex[0]->x, vp.Vertex[1]->x, vp.Vertex[2]->x);
-
-	min.y = FCMin3(vp.Vertex[0]->y, vp.Vertex[1]->y, vp.Vertex[2]->y);
-	max.y = FCMax3(vp.Vertex[0]->y, vp.Vertex[1]->y, vp.Vertex[2]->y);
+	if(depth==context.mSplitDepth)	return context.Subtree(node);
+
+	AABBNoLeafNode* Current = (AABBNoLeafNode*)node;
+	udword Flags = 0;
+	if(Current->HasPosLeaf())	{ if(context.IsDirty(Current->GetPosPrimitive()))	Flags |= REFIT_CHANGED;	}
+	else						Flags |= _RefitNoLeafNode((void*)Current->GetPos(), context, depth+1);
+	if(Current->HasNegLeaf())	{ if(context.IsDirty(Current->GetNegPrimitive()))	Flags |= REFIT_CHANGED;	}
+	else						Flags |= _RefitNoLeafNode((void*)Current->GetNeg(), context, depth+1);
+	if(context.mGather || !Flags)	return 0;
+
+	Point Min, Max;
+	if(Current->HasPosLeaf())	context.GetTriangleBox(Current->GetPosPrimitive(), Min, Max);
+	else
+	{
+		Current->GetPos()->mAABB.GetMin(Min);
+		Current->GetPos()->mAABB.GetMax(Max);
+	}
 
-	min.z = FCMin3(vp.Vertex[0]->z, vp.Vertex[1]->z, vp.Vertex[2]->z);
-	max.z = FCMax3(vp.Vertex[0]->z, vp.Vertex[1]->z, vp.Vertex[2]->z);
-#else
-	min = *vp.Vertex[0];
-	max = *vp.Vertex[0];
-	min.Min(*vp.Vertex[1]);
-	max.Max(*vp.Vertex[1]);
-	min.Min(*vp.Vertex[2]);
-	max.Max(*vp.Vertex[2]);
-#endif
+	Point Min_, Max_;
+	if(Current->HasNegLeaf())	context.GetTriangleBox(Current->GetNegPrimitive(), Min_, Max_);
+	else
+	{
+		Current->GetNeg()->mAABB.GetMin(Min_);
+		Current->GetNeg()->mAABB.GetMax(Max_);
+	}
+	Min.Min(Min_);
+	Max.Max(Max_);
+	return context.UpdateBox(Current->mAABB, Min, Max);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -379,54 +542,24 @@ inline_ void ComputeMinMax(Point& min, Point& max, const VertexPointers& vp)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool AABBNoLeafTree::Refit(const MeshInterface* mesh_interface)
 {
-	// Checkings
-	if(!mesh_interface)	return false;
-
-	// Bottom-up update
-	VertexPointers VP;
-	Point Min,Max;
-	Point Min_,Max_;
-	udword Index = mNbNodes;
-	while(Index--)
-	{
-		AABBNoLeafNode& Current = mNodes[Index];
+	return Refit(mesh_interface, RefitSettings());
+}
 
-		if(Current.HasPosLeaf())
-		{
-			mesh_interface->GetTriangle(VP, Current.GetPosPrimitive());
-			ComputeMinMax(Min, Max, VP);
-		}
-		else
-		{
-			const CollisionAABB& CurrentBox = Current.GetPos()->mAABB;
-			CurrentBox.GetMin(Min);
-			CurrentBox.GetMax(Max);
-		}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the collision tree after vertices have been modified, only updating the nodes above dirty primitives.
+ *	\param		mesh_interface	[in] mesh interface for current model
+ *	\param		settings		[in] refit settings
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBNoLeafTree::Refit(const MeshInterface* mesh_interface, const RefitSettings& settings)
+{
+	// Checkings
+	if(!mesh_interface || !mNodes)	return false;
 
-		if(Current.HasNegLeaf())
-		{
-			mesh_interface->GetTriangle(VP, Current.GetNegPrimitive());
-			ComputeMinMax(Min_, Max_, VP);
-		}
-		else
-		{
-			const CollisionAABB& CurrentBox = Current.GetNeg()->mAABB;
-			CurrentBox.GetMin(Min_);
-			CurrentBox.GetMax(Max_);
-		}
-#ifdef OPC_USE_FCOMI
-		Min.x = FCMin2(Min.x, Min_.x);
-		Max.x = FCMax2(Max.x, Max_.x);
-		Min.y = FCMin2(Min.y, Min_.y);
-		Max.y = FCMax2(Max.y, Max_.y);
-		Min.z = FCMin2(Min.z, Min_.z);
-		Max.z = FCMax2(Max.z, Max_.z);
-#else
-		Min.Min(Min_);
-		Max.Max(Max_);
-#endif
-		Current.mAABB.SetMinMax(Min, Max);
-	}
+	RefitContext Context(mesh_interface, settings.mDirtyPrimitives, _RefitNoLeafNode, this);
+	RefitTree(mNodes, mNbNodes, Context, settings);
 	return true;
 }
 
@@ -544,14 +677,17 @@ bool AABBNoLeafTree::Walk(GenericWalkingCallback callback, void* user_data) cons
 		}																			\
 	}
 
+//! Room left for further motion when a refit has to requantize a tree
+#define REFIT_QUANTIZATION_MARGIN	1.25f
+
 #define REMAP_DATA(member)											\
 	/* Fix data */													\
 	Data = Nodes[i].member;											\
 	if(!(Data&1))													\
 	{																\
-		/* Compute box number */									\
-		udword Nb = (Data - udword(Nodes))/Nodes[i].GetNodeSize();	\
-		Data = udword(&mNodes[Nb]);									\
+		/* Compute relative box number */							\
+		udword Nb = Data/Nodes[i].GetNodeSize();					\
+		Data = Nb*mNodes[i].GetNodeSize();							\
 	}																\
 	/* ...remapped */												\
 	mNodes[i].member = Data;
@@ -561,7 +697,7 @@ bool AABBNoLeafTree::Walk(GenericWalkingCallback callback, void* user_data) cons
  *	Constructor.
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-AABBQuantizedTree::AABBQuantizedTree() : mNodes(null)
+AABBQuantizedTree::AABBQuantizedTree() : mNodes(null), mUserNodes(false)
 {
 }
 
@@ -572,7 +708,7 @@ AABBQuantizedTree::AABBQuantizedTree() : mNodes(null)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 AABBQuantizedTree::~AABBQuantizedTree()
 {
-	DELETEARRAY(mNodes);
+	RELEASE_NODES
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -593,7 +729,7 @@ bool AABBQuantizedTree::Build(AABBTree* tree)
 
 	// Get nodes
 	mNbNodes = NbNodes;
-	DELETEARRAY(mNodes);
+	RELEASE_NODES
 	AABBCollisionNode* Nodes = new AABBCollisionNode[mNbNodes];
 	CHECKALLOC(Nodes);
 
@@ -626,6 +762,43 @@ bool AABBQuantizedTree::Build(AABBTree* tree)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refit kernel for AABBQuantizedTree nodes. See RefitKernel.
+ *	\param		node		[in] node to refit
+ *	\param		context		[in] refit context
+ *	\param		depth		[in] node's depth
+ *	\return		REFIT_XXX flags
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _RefitQuantizedNode(void* node, RefitContext& context, udword depth)
+{
+	if(depth==context.mSplitDepth)	return context.Subtree(node);
+
+	AABBQuantizedNode* Current = (AABBQuantizedNode*)node;
+	Point Min, Max;
+	if(Current->IsLeaf())
+	{
+		if(context.mGather || !context.IsDirty(Current->GetPrimitive()))	return 0;
+		context.GetTriangleBox(Current->GetPrimitive(), Min, Max);
+	}
+	else
+	{
+		const AABBQuantizedNode* Pos = Current->GetPos();
+		const AABBQuantizedNode* Neg = Current->GetNeg();
+		const udword Flags = _RefitQuantizedNode((void*)Pos, context, depth+1) | _RefitQuantizedNode((void*)Neg, context, depth+1);
+		if(context.mGather || !Flags)	return 0;
+		if(Flags & REFIT_OVERFLOW)		return REFIT_OVERFLOW;
+
+		Point Min_, Max_;
+		context.GetBox(Pos->mAABB, Min, Max);
+		context.GetBox(Neg->mAABB, Min_, Max_);
+		Min.Min(Min_);
+		Max.Max(Max_);
+	}
+	return context.UpdateBox(Current->mAABB, Min, Max);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Refits the collision tree after vertices have been modified.
@@ -635,8 +808,64 @@ bool AABBQuantizedTree::Build(AABBTree* tree)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool AABBQuantizedTree::Refit(const MeshInterface* mesh_interface)
 {
-	ASSERT(!"Not implemented since requantizing is painful !");
-	return false;
+	return Refit(mesh_interface, RefitSettings());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the collision tree after vertices have been modified, only updating the nodes above dirty primitives.
+ *	Refit nodes are dequantized & requantized on the fly. If the mesh doesn't fit the quantization range anymore,
+ *	the whole tree is requantized.
+ *	\param		mesh_interface	[in] mesh interface for current model
+ *	\param		settings		[in] refit settings
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBQuantizedTree::Refit(const MeshInterface* mesh_interface, const RefitSettings& settings)
+{
+	// Checkings
+	if(!mesh_interface || !mNodes)	return false;
+
+	RefitContext Context(mesh_interface, settings.mDirtyPrimitives, _RefitQuantizedNode, this);
+	Context.SetQuantization(mCenterCoeff, mExtentsCoeff);
+	if(!(RefitTree(mNodes, mNbNodes, Context, settings) & REFIT_OVERFLOW))	return true;
+
+	// Out of range => recompute all boxes, bottom-up. Children are always stored after their parent.
+	AABBCollisionNode* Nodes = new AABBCollisionNode[mNbNodes];
+	CHECKALLOC(Nodes);
+	udword Index = mNbNodes;
+	while(Index--)
+	{
+		const AABBQuantizedNode& Current = mNodes[Index];
+
+		Point Min, Max;
+		if(Current.IsLeaf())	Context.GetTriangleBox(Current.GetPrimitive(), Min, Max);
+		else
+		{
+			const udword Pos = udword(Current.GetPos() - mNodes);
+			Point Min_, Max_;
+			Nodes[Pos].mAABB.GetMin(Min);
+			Nodes[Pos].mAABB.GetMax(Max);
+			Nodes[Pos+1].mAABB.GetMin(Min_);
+			Nodes[Pos+1].mAABB.GetMax(Max_);
+			Min.Min(Min_);
+			Max.Max(Max_);
+		}
+		Nodes[Index].mAABB.SetMinMax(Min, Max);
+	}
+
+	// ...and requantize them with new coeffs
+	FIND_MAX_VALUES
+	CMax *= REFIT_QUANTIZATION_MARGIN;
+	EMax *= REFIT_QUANTIZATION_MARGIN;
+	INIT_QUANTIZATION
+	for(udword i=0;i<mNbNodes;i++)
+	{
+		PERFORM_QUANTIZATION
+	}
+
+	DELETEARRAY(Nodes);
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -675,7 +904,7 @@ bool AABBQuantizedTree::Walk(GenericWalkingCallback callback, void* user_data) c
  *	Constructor.
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-AABBQuantizedNoLeafTree::AABBQuantizedNoLeafTree() : mNodes(null)
+AABBQuantizedNoLeafTree::AABBQuantizedNoLeafTree() : mNodes(null), mUserNodes(false)
 {
 }
 
@@ -686,7 +915,7 @@ AABBQuantizedNoLeafTree::AABBQuantizedNoLeafTree() : mNodes(null)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 AABBQuantizedNoLeafTree::~AABBQuantizedNoLeafTree()
 {
-	DELETEARRAY(mNodes);
+	RELEASE_NODES
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -707,7 +936,7 @@ bool AABBQuantizedNoLeafTree::Build(AABBTree* tree)
 
 	// Get nodes
 	mNbNodes = NbTriangles-1;
-	DELETEARRAY(mNodes);
+	RELEASE_NODES
 	AABBNoLeafNode* Nodes = new AABBNoLeafNode[mNbNodes];
 	CHECKALLOC(Nodes);
 
@@ -742,6 +971,41 @@ bool AABBQuantizedNoLeafTree::Build(AABBTree* tree)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refit kernel for AABBQuantizedNoLeafTree nodes. See RefitKernel.
+ *	\param		node		[in] node to refit
+ *	\param		context		[in] refit context
+ *	\param		depth		[in] node's depth
+ *	\return		REFIT_XXX flags
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _RefitQuantizedNoLeafNode(void* node, RefitContext& context, udword depth)
+{
+	if(depth==context.mSplitDepth)	return context.Subtree(node);
+
+	AABBQuantizedNoLeafNode* Current = (AABBQuantizedNoLeafNode*)node;
+	udword Flags = 0;
+	if(Current->HasPosLeaf())	{ if(context.IsDirty(Current->GetPosPrimitive()))	Flags |= REFIT_CHANGED;	}
+	else						Flags |= _RefitQuantizedNoLeafNode((void*)Current->GetPos(), context, depth+1);
+	if(Current->HasNegLeaf())	{ if(context.IsDirty(Current->GetNegPrimitive()))	Flags |= REFIT_CHANGED;	}
+	else						Flags |= _RefitQuantizedNoLeafNode((void*)Current->GetNeg(), context, depth+1);
+	if(context.mGather || !Flags)	return 0;
+	if(Flags & REFIT_OVERFLOW)		return REFIT_OVERFLOW;
+
+	Point Min, Max;
+	if(Current->HasPosLeaf())	context.GetTriangleBox(Current->GetPosPrimitive(), Min, Max);
+	else						context.GetBox(Current->GetPos()->mAABB, Min, Max);
+
+	Point Min_, Max_;
+	if(Current->HasNegLeaf())	context.GetTriangleBox(Current->GetNegPrimitive(), Min_, Max_);
+	else						context.GetBox(Current->GetNeg()->mAABB, Min_, Max_);
+
+	Min.Min(Min_);
+	Max.Max(Max_);
+	return context.UpdateBox(Current->mAABB, Min, Max);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Refits the collision tree after vertices have been modified.
@@ -751,8 +1015,70 @@ bool AABBQuantizedNoLeafTree::Build(AABBTree* tree)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool AABBQuantizedNoLeafTree::Refit(const MeshInterface* mesh_interface)
 {
-	ASSERT(!"Not implemented since requantizing is painful !");
-	return false;
+	return Refit(mesh_interface, RefitSettings());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the collision tree after vertices have been modified, only updating the nodes above dirty primitives.
+ *	Refit nodes are dequantized & requantized on the fly. If the mesh doesn't fit the quantization range anymore,
+ *	the whole tree is requantized.
+ *	\param		mesh_interface	[in] mesh interface for current model
+ *	\param		settings		[in] refit settings
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBQuantizedNoLeafTree::Refit(const MeshInterface* mesh_interface, const RefitSettings& settings)
+{
+	// Checkings
+	if(!mesh_interface || !mNodes)	return false;
+
+	RefitContext Context(mesh_interface, settings.mDirtyPrimitives, _RefitQuantizedNoLeafNode, this);
+	Context.SetQuantization(mCenterCoeff, mExtentsCoeff);
+	if(!(RefitTree(mNodes, mNbNodes, Context, settings) & REFIT_OVERFLOW))	return true;
+
+	// Out of range => recompute all boxes, bottom-up. Children are always stored after their parent.
+	AABBCollisionNode* Nodes = new AABBCollisionNode[mNbNodes];
+	CHECKALLOC(Nodes);
+	udword Index = mNbNodes;
+	while(Index--)
+	{
+		const AABBQuantizedNoLeafNode& Current = mNodes[Index];
+
+		Point Min, Max;
+		if(Current.HasPosLeaf())	Context.GetTriangleBox(Current.GetPosPrimitive(), Min, Max);
+		else
+		{
+			const udword Pos = udword(Current.GetPos() - mNodes);
+			Nodes[Pos].mAABB.GetMin(Min);
+			Nodes[Pos].mAABB.GetMax(Max);
+		}
+
+		Point Min_, Max_;
+		if(Current.HasNegLeaf())	Context.GetTriangleBox(Current.GetNegPrimitive(), Min_, Max_);
+		else
+		{
+			const udword Neg = udword(Current.GetNeg() - mNodes);
+			Nodes[Neg].mAABB.GetMin(Min_);
+			Nodes[Neg].mAABB.GetMax(Max_);
+		}
+		Min.Min(Min_);
+		Max.Max(Max_);
+		Nodes[Index].mAABB.SetMinMax(Min, Max);
+	}
+
+	// ...and requantize them with new coeffs
+	FIND_MAX_VALUES
+	CMax *= REFIT_QUANTIZATION_MARGIN;
+	EMax *= REFIT_QUANTIZATION_MARGIN;
+	INIT_QUANTIZATION
+	for(udword i=0;i<mNbNodes;i++)
+	{
+		PERFORM_QUANTIZATION
+	}
+
+	DELETEARRAY(Nodes);
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -780,3 +1106,8 @@ bool AABBQuantizedNoLeafTree::Walk(GenericWalkingCallback callback, void* user_d
 	Local::_Walk(mNodes, callback, user_data);
 	return true;
 }
+
+IMPLEMENT_TREE_SERIALIZATION(AABBCollisionTree, AABBCollisionNode, null, null)
+IMPLEMENT_TREE_SERIALIZATION(AABBNoLeafTree, AABBNoLeafNode, null, null)
+IMPLEMENT_TREE_SERIALIZATION(AABBQuantizedTree, AABBQuantizedNode, &mCenterCoeff, &mExtentsCoeff)
+IMPLEMENT_TREE_SERIALIZATION(AABBQuantizedNoLeafTree, AABBQuantizedNoLeafNode, &mCenterCoeff, &mExtentsCoeff)
@@ -20,6 +20,10 @@
 #ifndef __OPC_OPTIMIZEDTREE_H__
 #define __OPC_OPTIMIZEDTREE_H__
 
+	//! Gets a child node from its offset relative to the parent node. Nodes don't store pointers, so that trees can be
+	//! saved & used in place once loaded (see BaseModel::Load()).
+	#define OPC_CHILD_NODE(base_class, offset)	((const base_class*)(((const ubyte*)this) + (offset)))
+
 	//! Common interface for a node of an implicit tree
 	#define IMPLEMENT_IMPLICIT_NODE(base_class, volume)														\
 		public:																								\
@@ -27,16 +31,16 @@
 		inline_								base_class() : mData(0)	{}										\
 		inline_								~base_class()			{}										\
 		/* Leaf test */																						\
-		inline_			BOOL				IsLeaf()		const	{ return mData&1;					}	\
+		inline_			BOOL				IsLeaf()		const	{ return mData&1;						}	\
 		/* Data access */																					\
-		inline_			const base_class*	GetPos()		const	{ return (base_class*)mData;		}	\
-		inline_			const base_class*	GetNeg()		const	{ return ((base_class*)mData)+1;	}	\
-		inline_			udword				GetPrimitive()	const	{ return (mData>>1);				}	\
+		inline_			const base_class*	GetPos()		const	{ return OPC_CHILD_NODE(base_class, mData);		}	\
+		inline_			const base_class*	GetNeg()		const	{ return OPC_CHILD_NODE(base_class, mData)+1;	}	\
+		inline_			udword				GetPrimitive()	const	{ return (mData>>1);					}	\
 		/* Stats */																							\
-		inline_			udword				GetNodeSize()	const	{ return SIZEOFOBJECT;				}	\
+		inline_			udword				GetNodeSize()	const	{ return SIZEOFOBJECT;					}	\
 																											\
 						volume				mAABB;															\
-						udword				mData;
+						udword				mData;			/* Offset of P node in bytes (LSB=0) or primitive index (LSB=1) */
 
 	//! Common interface for a node of a no-leaf tree
 	#define IMPLEMENT_NOLEAF_NODE(base_class, volume)														\
@@ -48,16 +52,16 @@
 		inline_			BOOL				HasPosLeaf()		const	{ return mPosData&1;			}	\
 		inline_			BOOL				HasNegLeaf()		const	{ return mNegData&1;			}	\
 		/* Data access */																					\
-		inline_			const base_class*	GetPos()			const	{ return (base_class*)mPosData;	}	\
-		inline_			const base_class*	GetNeg()			const	{ return (base_class*)mNegData;	}	\
+		inline_			const base_class*	GetPos()			const	{ return OPC_CHILD_NODE(base_class, mPosData);	}	\
+		inline_			const base_class*	GetNeg()			const	{ return OPC_CHILD_NODE(base_class, mNegData);	}	\
 		inline_			udword				GetPosPrimitive()	const	{ return (mPosData>>1);			}	\
 		inline_			udword				GetNegPrimitive()	const	{ return (mNegData>>1);			}	\
 		/* Stats */																							\
 		inline_			udword				GetNodeSize()		const	{ return SIZEOFOBJECT;			}	\
 																											\
 						volume				mAABB;															\
-						udword				mPosData;														\
-						udword				mNegData;
+						udword				mPosData;		/* Offset of P node in bytes (LSB=0) or primitive index (LSB=1) */	\
+						udword				mNegData;		/* Offset of N node in bytes (LSB=0) or primitive index (LSB=1) */
 
 	class OPCODE_API AABBCollisionNode
 	{
@@ -119,17 +123,39 @@
 		override(AABBOptimizedTree)	bool			Build(AABBTree* tree);											\
 		/* Refits the tree */																						\
 		override(AABBOptimizedTree)	bool			Refit(const MeshInterface* mesh_interface);						\
+		override(AABBOptimizedTree)	bool			Refit(const MeshInterface* mesh_interface, const RefitSettings& settings);	\
 		/* Walks the tree */																						\
 		override(AABBOptimizedTree)	bool			Walk(GenericWalkingCallback callback, void* user_data) const;	\
 		/* Data access */																							\
 		inline_						const node*		GetNodes()		const	{ return mNodes;					}	\
 		/* Stats */																									\
 		override(AABBOptimizedTree)	udword			GetUsedBytes()	const	{ return mNbNodes*sizeof(node);		}	\
+		/* Serialization */																							\
+		override(AABBOptimizedTree)	udword			GetSaveSize()	const;											\
+		override(AABBOptimizedTree)	bool			Save(void* buffer)	const;										\
+		override(AABBOptimizedTree)	bool			Load(void* buffer, udword size);								\
 		private:																									\
-									node*			mNodes;
+									node*			mNodes;															\
+									bool			mUserNodes;		/* Nodes live in user memory (loaded tree) */
 
 	typedef		bool				(*GenericWalkingCallback)	(const void* current, void* user_data);
 
+	#define OPC_SAVE_ALIGNMENT		64		//!< Alignment of serialized blocks, so that nodes can be used in place
+	#define OPC_SAVE_ALIGN(size)	(((size) + OPC_SAVE_ALIGNMENT-1) & ~(OPC_SAVE_ALIGNMENT-1))
+
+	//! Header of a serialized tree, followed by the nodes
+	struct OPCODE_API SavedTreeHeader
+	{
+		udword				mNbNodes;			//!< Number of nodes
+		udword				mNodeSize;			//!< Size of a node, in bytes
+		udword				mNbPrimitives;		//!< Number of primitive indices following the nodes, if any
+		Point				mCenterCoeff;		//!< Dequantization coeffs, for quantized trees
+		Point				mExtentsCoeff;		//!< Dequantization coeffs, for quantized trees
+		udword				mPad[7];
+	};
+
+	ICE_COMPILE_TIME_ASSERT(sizeof(SavedTreeHeader)==OPC_SAVE_ALIGNMENT);
+
 	class OPCODE_API AABBOptimizedTree
 	{
 		public:
@@ -157,6 +183,22 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		virtual			bool				Refit(const MeshInterface* mesh_interface)						= 0;
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Refits the collision tree after vertices have been modified. Only the boxes above dirty primitives are
+		 *	recomputed, and propagation stops as soon as a box doesn't change. Large trees are split in subtrees, refit
+		 *	in parallel, then the top of the tree is refit by the calling thread.
+		 *
+		 *	Quantized trees only dequantize & requantize the refit nodes. If a box doesn't fit the quantization range
+		 *	anymore, the whole tree is requantized with new coeffs, keeping some room for further motion.
+		 *
+		 *	\param		mesh_interface	[in] mesh interface for current model
+		 *	\param		settings		[in] refit settings
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		virtual			bool				Refit(const MeshInterface* mesh_interface, const RefitSettings& settings)	= 0;
+
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
 		 *	Walks the tree and call the user back for each node.
@@ -171,6 +213,34 @@
 		virtual			udword				GetUsedBytes()		const										= 0;
 		inline_			udword				GetNbNodes()		const						{ return mNbNodes;	}
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Gets the size of the serialized tree.
+		 *	\return		size in bytes, a multiple of OPC_SAVE_ALIGNMENT
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		virtual			udword				GetSaveSize()		const										= 0;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Serializes the tree.
+		 *	\param		buffer		[out] destination buffer, GetSaveSize() bytes
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		virtual			bool				Save(void* buffer)	const										= 0;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Setups the tree from serialized data. The data is used in place, not copied: it must remain valid as long as the
+		 *	tree is alive, and it gets modified by Refit().
+		 *	\param		buffer		[in] serialized data, OPC_SAVE_ALIGNMENT-aligned
+		 *	\param		size		[in] size of serialized data
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		virtual			bool				Load(void* buffer, udword size)									= 0;
+
 		protected:
 						udword				mNbNodes;
 	};
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains a minimal task runner used to spread tree builds & updates over several cores.
+ *	\file		OPC_Parallel.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	A parallel job is a set of N independent tasks. Threads are created for the duration of the job only, and they
+ *	fetch task indices from a shared counter until the job is done. There's no persistent pool: jobs are expected to
+ *	be coarse (building a subtree, refitting a range of nodes...), so the thread creation cost is negligible.
+ *
+ *	Small jobs (a single task, or a single processor) are executed directly by the calling thread.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+#ifdef PLATFORM_WINDOWS
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+using namespace Opcode;
+
+//! Hard limit on the number of threads used by a single job
+#define MAX_NB_THREADS	64
+
+//! Shared state of a parallel job
+struct ParallelJob
+{
+	ParallelCallback	mCallback;		//!< Task callback
+	void*				mUserData;		//!< Callback's user data
+	udword				mNbTasks;		//!< Number of tasks
+	volatile udword		mNextTask;		//!< Number of tasks fetched so far
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Fetches & executes tasks until the job is done. Executed by all threads taking part in the job.
+ *	\param		job		[in] current job
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _ExecuteTasks(ParallelJob* job)
+{
+	udword Index;
+	while((Index = AtomicIncrement(&job->mNextTask) - 1) < job->mNbTasks)
+	{
+		(job->mCallback)(Index, job->mUserData);
+	}
+}
+
+#ifdef PLATFORM_WINDOWS
+static DWORD WINAPI _ThreadProc(LPVOID param)
+{
+	_ExecuteTasks((ParallelJob*)param);
+	return 0;
+}
+#else
+static void* _ThreadProc(void* param)
+{
+	_ExecuteTasks((ParallelJob*)param);
+	return null;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the number of logical processors available to the process.
+ *	\return		number of processors (at least 1)
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword Opcode::GetNbProcessors()
+{
+#ifdef PLATFORM_WINDOWS
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	udword NbProcessors = Info.dwNumberOfProcessors;
+#else
+	long NbProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return NbProcessors>0 ? udword(NbProcessors) : 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Atomically increments a counter shared between threads.
+ *	\param		value		[in/out] shared counter
+ *	\return		the incremented value
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword Opcode::AtomicIncrement(volatile udword* value)
+{
+#ifdef PLATFORM_WINDOWS
+	return udword(InterlockedIncrement((volatile LONG*)value));
+#else
+	return __sync_add_and_fetch(value, 1);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Runs a set of independent tasks on a set of threads. The calling thread takes part in the job, and the call
+ *	returns once all tasks have been executed. Tasks are fetched dynamically, so they don't need to have the same size.
+ *	\param		nb_tasks	[in] number of tasks
+ *	\param		callback	[in] task callback
+ *	\param		user_data	[in] callback's user data
+ *	\param		nb_threads	[in] max number of threads, including the caller. 0 = one per processor.
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Opcode::RunParallel(udword nb_tasks, ParallelCallback callback, void* user_data, udword nb_threads)
+{
+	// Checkings
+	if(!callback)	return false;
+	if(!nb_tasks)	return true;
+
+	if(!nb_threads)				nb_threads = GetNbProcessors();
+	if(nb_threads>nb_tasks)		nb_threads = nb_tasks;
+	if(nb_threads>MAX_NB_THREADS)	nb_threads = MAX_NB_THREADS;
+
+	ParallelJob Job;
+	Job.mCallback	= callback;
+	Job.mUserData	= user_data;
+	Job.mNbTasks	= nb_tasks;
+	Job.mNextTask	= 0;
+
+	// Spawn workers. If we can't get them all, the ones we got (and the caller) simply take more tasks.
+	udword NbWorkers = 0;
+#ifdef PLATFORM_WINDOWS
+	HANDLE Workers[MAX_NB_THREADS];
+	for(udword i=1;i<nb_threads;i++)
+	{
+		HANDLE Worker = CreateThread(null, 0, _ThreadProc, &Job, 0, null);
+		if(!Worker)	break;
+		Workers[NbWorkers++] = Worker;
+	}
+#else
+	pthread_t Workers[MAX_NB_THREADS];
+	for(udword i=1;i<nb_threads;i++)
+	{
+		if(pthread_create(&Workers[NbWorkers], null, _ThreadProc, &Job))	break;
+		NbWorkers++;
+	}
+#endif
+
+	// The caller works too
+	_ExecuteTasks(&Job);
+
+	// Wait for completion
+#ifdef PLATFORM_WINDOWS
+	if(NbWorkers)	WaitForMultipleObjects(NbWorkers, Workers, TRUE, INFINITE);
+	for(udword i=0;i<NbWorkers;i++)	CloseHandle(Workers[i]);
+#else
+	for(udword i=0;i<NbWorkers;i++)	pthread_join(Workers[i], null);
+#endif
+	return true;
+}
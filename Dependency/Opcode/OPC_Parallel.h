@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains a minimal task runner used to spread tree builds & updates over several cores.
+ *	\file		OPC_Parallel.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_PARALLEL_H__
+#define __OPC_PARALLEL_H__
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/**
+	 *	User-callback, called by OPCODE for each task of a parallel job.
+	 *	\param		task_index	[in] index of the task to execute, in [0, nb_tasks[
+	 *	\param		user_data	[in] user-defined data from RunParallel()
+	 */
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	typedef void	(*ParallelCallback)	(udword task_index, void* user_data);
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/**
+	 *	Gets the number of logical processors available to the process.
+	 *	\return		number of processors (at least 1)
+	 */
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	FUNCTION OPCODE_API udword	GetNbProcessors();
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/**
+	 *	Runs a set of independent tasks on a set of threads. The calling thread takes part in the job, and the call
+	 *	returns once all tasks have been executed. Tasks are fetched dynamically, so they don't need to have the same size.
+	 *	\param		nb_tasks	[in] number of tasks
+	 *	\param		callback	[in] task callback
+	 *	\param		user_data	[in] callback's user data
+	 *	\param		nb_threads	[in] max number of threads, including the caller. 0 = one per processor.
+	 *	\return		true if success
+	 */
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	FUNCTION OPCODE_API bool	RunParallel(udword nb_tasks, ParallelCallback callback, void* user_data, udword nb_threads);
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/**
+	 *	Atomically increments a counter shared between threads.
+	 *	\param		value		[in/out] shared counter
+	 *	\return		the incremented value
+	 */
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	FUNCTION OPCODE_API udword	AtomicIncrement(volatile udword* value);
+
+#endif // __OPC_PARALLEL_H__
@@ -82,84 +82,93 @@ bool Opcode::SetupInOutTest(RayCollider& collider)
 	return true;
 }
 
-bool Opcode::Picking(
-CollisionFace& picked_face,
-const Ray& world_ray, const Model& model, const Matrix4x4* world,
-float min_dist, float max_dist, const Point& view_point, CullModeCallback callback, void* user_data)
+//! Culling data for Picking()
+struct PickingCullData
 {
-	struct Local
+	CollisionFace*			Closest;
+	float					MinLimit;
+	CullModeCallback		Callback;
+	void*					UserData;
+	Point					ViewPoint;
+	const MeshInterface*	IMesh;
+	const Heightfield*		Field;
+};
+
+// Called for each stabbed face
+static void _RenderCullingCallback(const CollisionFace& hit, void* user_data)
+{
+	PickingCullData* Data = (PickingCullData*)user_data;
+
+	// Discard face if we already have a closer hit
+	if(hit.mDistance>=Data->Closest->mDistance)	return;
+
+	// Discard face if hit point is smaller than min limit. This mainly happens when the face is in front
+	// of the near clip plane (or straddles it). If we keep the face nonetheless, the user can select an
+	// object that he may not even be able to see, which is very annoying.
+	if(hit.mDistance<=Data->MinLimit)	return;
+
+	// This is the index of currently stabbed triangle.
+	udword StabbedFaceIndex = hit.mFaceID;
+
+	// We may keep it or not, depending on backface culling
+	bool KeepIt = true;
+
+	// Catch *render* cull mode for this face
+	CullMode CM = (Data->Callback)(StabbedFaceIndex, Data->UserData);
+
+	if(CM!=CULLMODE_NONE)	// Don't even compute culling for double-sided triangles
 	{
-		struct CullData
+		// Compute backface culling for current face
+
+		VertexPointers VP;
+		ConversionArea VC;
+		Point Verts[3];
+		if(Data->IMesh)
 		{
-			CollisionFace*			Closest;
-			float					MinLimit;
-			CullModeCallback		Callback;
-			void*					UserData;
-			Point					ViewPoint;
-			const MeshInterface*	IMesh;
-		};
-
-		// Called for each stabbed face
-		static void RenderCullingCallback(const CollisionFace& hit, void* user_data)
+			Data->IMesh->GetTriangle(VP, StabbedFaceIndex, VC);
+		}
+		else
 		{
-			CullData* Data = (CullData*)user_data;
-
-			// Discard face if we already have a closer hit
-			if(hit.mDistance>=Data->Closest->mDistance)	return;
-
-			// Discard face if hit point is smaller than min limit. This mainly happens when the face is in front
-			// of the near clip plane (or straddles it). If we keep the face nonetheless, the user can select an
-			// object that he may not even be able to see, which is very annoying.
-			if(hit.mDistance<=Data->MinLimit)	return;
-
-			// This is the index of currently stabbed triangle.
-			udword StabbedFaceIndex = hit.mFaceID;
-
-			// We may keep it or not, depending on backface culling
-			bool KeepIt = true;
-
-			// Catch *render* cull mode for this face
-			CullMode CM = (Data->Callback)(StabbedFaceIndex, Data->UserData);
-
-			if(CM!=CULLMODE_NONE)	// Don't even compute culling for double-sided triangles
-			{
-				// Compute backface culling for current face
-
-				VertexPointers VP;
-				Data->IMesh->GetTriangle(VP, StabbedFaceIndex);
-				if(VP.BackfaceCulling(Data->ViewPoint))
-				{
-					if(CM==CULLMODE_CW)		KeepIt = false;
-				}
-				else
-				{
-					if(CM==CULLMODE_CCW)	KeepIt = false;
-				}
-			}
-
-			if(KeepIt)	*Data->Closest = hit;
+			Data->Field->GetTriangle(Verts, StabbedFaceIndex);
+			VP.Vertex[0] = &Verts[0];
+			VP.Vertex[1] = &Verts[1];
+			VP.Vertex[2] = &Verts[2];
 		}
-	};
 
-	RayCollider RC;
-	RC.SetMaxDist(max_dist);
-	RC.SetTemporalCoherence(false);
-	RC.SetCulling(false);		// We need all faces since some of them can be double-sided
-	RC.SetFirstContact(false);
-	RC.SetHitCallback(Local::RenderCullingCallback);
+		if(VP.BackfaceCulling(Data->ViewPoint))
+		{
+			if(CM==CULLMODE_CW)		KeepIt = false;
+		}
+		else
+		{
+			if(CM==CULLMODE_CCW)	KeepIt = false;
+		}
+	}
+
+	if(KeepIt)	*Data->Closest = hit;
+}
+
+static void _SetupPicking(RayCollider& collider, PickingCullData& data, CollisionFace& picked_face, const Matrix4x4* world,
+						float min_dist, float max_dist, const Point& view_point, CullModeCallback callback, void* user_data)
+{
+	collider.SetMaxDist(max_dist);
+	collider.SetTemporalCoherence(false);
+	collider.SetCulling(false);		// We need all faces since some of them can be double-sided
+	collider.SetFirstContact(false);
+	collider.SetHitCallback(_RenderCullingCallback);
 
 	picked_face.mFaceID		= INVALID_ID;
 	picked_face.mDistance	= MAX_FLOAT;
 	picked_face.mU			= 0.0f;
 	picked_face.mV			= 0.0f;
 
-	Local::CullData Data;
-	Data.Closest			= &picked_face;
-	Data.MinLimit			= min_dist;
-	Data.Callback			= callback;
-	Data.UserData			= user_data;
-	Data.ViewPoint			= view_point;
-	Data.IMesh				= model.GetMeshInterface();
+	data.Closest			= &picked_face;
+	data.MinLimit			= min_dist;
+	data.Callback			= callback;
+	data.UserData			= user_data;
+	data.ViewPoint			= view_point;
+	data.IMesh				= null;
+	data.Field				= null;
 
 	if(world)
 	{
@@ -168,10 +177,22 @@ float min_dist, float max_dist, const Point& view_point, CullModeCallback callba
 		InvertPRMatrix(InvWorld, *world);
 
 		// Compute camera position in mesh space
-		Data.ViewPoint *= InvWorld;
+		data.ViewPoint *= InvWorld;
 	}
 
-	RC.SetUserData(&Data);
+	collider.SetUserData(&data);
+}
+
+bool Opcode::Picking(
+CollisionFace& picked_face,
+const Ray& world_ray, const Model& model, const Matrix4x4* world,
+float min_dist, float max_dist, const Point& view_point, CullModeCallback callback, void* user_data)
+{
+	RayCollider RC;
+	PickingCullData Data;
+	_SetupPicking(RC, Data, picked_face, world, min_dist, max_dist, view_point, callback, user_data);
+	Data.IMesh = model.GetMeshInterface();
+
 	if(RC.Collide(world_ray, model, world))
 	{
 		return picked_face.mFaceID!=INVALID_ID;
@@ -179,4 +200,21 @@ float min_dist, float max_dist, const Point& view_point, CullModeCallback callba
 	return false;
 }
 
+bool Opcode::Picking(
+CollisionFace& picked_face,
+const Ray& world_ray, const Heightfield& field, const Matrix4x4* world,
+float min_dist, float max_dist, const Point& view_point, CullModeCallback callback, void* user_data)
+{
+	HeightfieldRayCollider RC;
+	PickingCullData Data;
+	_SetupPicking(RC, Data, picked_face, world, min_dist, max_dist, view_point, callback, user_data);
+	Data.Field = &field;
+
+	if(RC.Collide(world_ray, field, world))
+	{
+		return picked_face.mFaceID!=INVALID_ID;
+	}
+	return false;
+}
+
 #endif
@@ -40,6 +40,11 @@
 						CollisionFace& picked_face,
 						const Ray& world_ray, const Model& model, const Matrix4x4* world,
 						float min_dist, float max_dist, const Point& view_point, CullModeCallback callback, void* user_data);
+
+	OPCODE_API	bool Picking(
+						CollisionFace& picked_face,
+						const Ray& world_ray, const Heightfield& field, const Matrix4x4* world,
+						float min_dist, float max_dist, const Point& view_point, CullModeCallback callback, void* user_data);
 #endif
 
 #endif //__OPC_PICKING_H__
\ No newline at end of file
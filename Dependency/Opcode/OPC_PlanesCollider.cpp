@@ -43,7 +43,7 @@ using namespace Opcode;
 //! Planes-triangle test
 #define PLANES_PRIM(prim_index, flag)		\
 	/* Request vertices from the app */		\
-	mIMesh->GetTriangle(mVP, prim_index);	\
+	mIMesh->GetTriangle(mVP, prim_index, mVC);	\
 	/* Perform triangle-box overlap test */	\
 	if(PlanesTriOverlap(clip_mask))			\
 	{										\
@@ -104,6 +104,7 @@ bool PlanesCollider::Collide(PlanesCache& cache, const Plane* planes, udword nb_
 {
 	// Checkings
 	if(!Setup(&model))	return false;
+	if(model.IsWide())	return SetIceError("OPCODE WARNING: wide trees are not supported by this collider.\n", null);
 
 	// Init collision query
 	if(InitQuery(cache, planes, nb_planes, worldm))	return true;
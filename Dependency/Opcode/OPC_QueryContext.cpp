@@ -0,0 +1,222 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains reentrant queries, for concurrent queries on shared models.
+ *	\file		OPC_QueryContext.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Colliders keep their per-query data (flags, stats, results, model-space query volume) in members, while models,
+ *	trees & mesh interfaces are only read during a query. Traversals are recursive, or use a local stack, so the
+ *	traversal stack lives on the calling thread's stack.
+ *
+ *	The functions below wrap this in a stateless API: all the mutable data lives in a caller-provided QueryContext,
+ *	and settings are passed with each call. Each thread uses its own context, and no locking is needed:
+ *
+ *	QueryContext Context;
+ *	if(RayQuery(Context, WorldRay, SharedModel, &World, QUERY_CLOSEST_HIT) && Context.Faces.GetNbFaces())
+ *		...
+ *
+ *	The mesh interface must be reentrant as well: with OPC_USE_CALLBACKS, the user callback may be called by several
+ *	threads at once.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+using namespace Opcode;
+
+#ifdef OPC_RAYHIT_CALLBACK
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Hit callback for RayQuery(): records all hits in the context.
+ *	\param		hit			[in] current hit
+ *	\param		user_data	[in] query context
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _AddHit(const CollisionFace& hit, void* user_data)
+{
+	QueryContext* Context = (QueryContext*)user_data;
+	Context->Faces.AddFace(hit);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Hit callback for RayQuery(): only keeps the closest hit in the context.
+ *	\param		hit			[in] current hit
+ *	\param		user_data	[in] query context
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _KeepClosestHit(const CollisionFace& hit, void* user_data)
+{
+	QueryContext* Context = (QueryContext*)user_data;
+	if(!Context->Faces.GetNbFaces())
+	{
+		Context->Faces.AddFace(hit);
+	}
+	else
+	{
+		CollisionFace* Current = const_cast<CollisionFace*>(Context->Faces.GetFaces());
+		if(hit.mDistance<Current->mDistance)	*Current = hit;
+	}
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Setups a volume collider for a query.
+ *	\param		collider	[in] context's collider
+ *	\param		flags		[in] query flags
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _SetupVolumeQuery(VolumeCollider& collider, udword flags)
+{
+	collider.SetFirstContact((flags & QUERY_FIRST_CONTACT)!=0);
+	collider.SetTemporalCoherence(false);
+	collider.SetPrimitiveTests(!(flags & QUERY_NO_PRIMITIVE_TESTS));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Copies the results of a volume query to the context.
+ *	\param		context		[out] query context
+ *	\param		collider	[in] context's collider
+ *	\param		cache		[in] context's cache
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _GetVolumeResults(QueryContext& context, const VolumeCollider& collider, const VolumeCache& cache)
+{
+	context.Faces.Reset();
+	context.TouchedPrimitives	= &cache.TouchedPrimitives;
+	context.Contact				= collider.GetContactStatus();
+	context.NbBVTests			= collider.GetNbVolumeBVTests();
+	context.NbPrimTests			= collider.GetNbVolumePrimTests();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Reentrant stabbing query. Results are stored in context.Faces.
+ *	\param		context		[in/out] caller's query context
+ *	\param		world_ray	[in] stabbing ray in world space
+ *	\param		model		[in] Opcode model to collide with
+ *	\param		world		[in] model's world matrix, or null
+ *	\param		flags		[in] combination of QueryFlag
+ *	\param		max_dist	[in] higher distance bound, for segment queries
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Opcode::RayQuery(QueryContext& context, const Ray& world_ray, const Model& model, const Matrix4x4* world, udword flags, float max_dist)
+{
+	RayCollider& RC = context.RC;
+	RC.SetFirstContact((flags & QUERY_FIRST_CONTACT)!=0);
+	RC.SetTemporalCoherence(false);
+	RC.SetCulling((flags & QUERY_CULLING)!=0);
+	RC.SetMaxDist(max_dist);
+#ifdef OPC_RAYHIT_CALLBACK
+	RC.SetHitCallback((flags & QUERY_CLOSEST_HIT) ? _KeepClosestHit : _AddHit);
+	RC.SetUserData(&context);
+#else
+	RC.SetClosestHit((flags & QUERY_CLOSEST_HIT)!=0);
+	RC.SetDestination(&context.Faces);
+#endif
+
+	context.Faces.Reset();
+	context.TouchedPrimitives = null;
+
+	const bool Status = RC.Collide(world_ray, model, world);
+
+	context.Contact		= RC.GetContactStatus();
+	context.NbBVTests	= RC.GetNbRayBVTests();
+	context.NbPrimTests	= RC.GetNbRayPrimTests();
+	return Status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Reentrant sphere query. Results are stored in context.TouchedPrimitives.
+ *	\param		context		[in/out] caller's query context
+ *	\param		sphere		[in] collision sphere in local space
+ *	\param		model		[in] Opcode model to collide with
+ *	\param		worlds		[in] sphere's world matrix, or null
+ *	\param		worldm		[in] model's world matrix, or null
+ *	\param		flags		[in] combination of QueryFlag
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Opcode::SphereQuery(QueryContext& context, const Sphere& sphere, const Model& model, const Matrix4x4* worlds, const Matrix4x4* worldm, udword flags)
+{
+	_SetupVolumeQuery(context.SC, flags);
+	const bool Status = context.SC.Collide(context.SCache, sphere, model, worlds, worldm);
+	_GetVolumeResults(context, context.SC, context.SCache);
+	return Status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Reentrant OBB query. Results are stored in context.TouchedPrimitives.
+ *	\param		context		[in/out] caller's query context
+ *	\param		box			[in] collision OBB in local space
+ *	\param		model		[in] Opcode model to collide with
+ *	\param		worldb		[in] OBB's world matrix, or null
+ *	\param		worldm		[in] model's world matrix, or null
+ *	\param		flags		[in] combination of QueryFlag
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Opcode::OBBQuery(QueryContext& context, const OBB& box, const Model& model, const Matrix4x4* worldb, const Matrix4x4* worldm, udword flags)
+{
+	_SetupVolumeQuery(context.OC, flags);
+	const bool Status = context.OC.Collide(context.OCache, box, model, worldb, worldm);
+	_GetVolumeResults(context, context.OC, context.OCache);
+	return Status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Reentrant AABB query. Results are stored in context.TouchedPrimitives.
+ *	\param		context		[in/out] caller's query context
+ *	\param		box			[in] collision AABB in model space
+ *	\param		model		[in] Opcode model to collide with
+ *	\param		flags		[in] combination of QueryFlag
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Opcode::AABBQuery(QueryContext& context, const CollisionAABB& box, const Model& model, udword flags)
+{
+	_SetupVolumeQuery(context.AC, flags);
+	const bool Status = context.AC.Collide(context.ACache, box, model);
+	_GetVolumeResults(context, context.AC, context.ACache);
+	return Status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Reentrant LSS query. Results are stored in context.TouchedPrimitives.
+ *	\param		context		[in/out] caller's query context
+ *	\param		lss			[in] collision lss in local space
+ *	\param		model		[in] Opcode model to collide with
+ *	\param		worldl		[in] lss world matrix, or null
+ *	\param		worldm		[in] model's world matrix, or null
+ *	\param		flags		[in] combination of QueryFlag
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Opcode::LSSQuery(QueryContext& context, const LSS& lss, const Model& model, const Matrix4x4* worldl, const Matrix4x4* worldm, udword flags)
+{
+	_SetupVolumeQuery(context.LC, flags);
+	const bool Status = context.LC.Collide(context.LCache, lss, model, worldl, worldm);
+	_GetVolumeResults(context, context.LC, context.LCache);
+	return Status;
+}
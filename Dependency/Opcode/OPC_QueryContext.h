@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains reentrant queries, for concurrent queries on shared models.
+ *	\file		OPC_QueryContext.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_QUERYCONTEXT_H__
+#define __OPC_QUERYCONTEXT_H__
+
+	enum QueryFlag
+	{
+		QUERY_FIRST_CONTACT			= OPC_FIRST_CONTACT,		//!< Stop at first contact
+		QUERY_NO_PRIMITIVE_TESTS	= OPC_NO_PRIMITIVE_TESTS,	//!< Volume queries: report all primitives of touched leaves
+		QUERY_CLOSEST_HIT			= (1<<8),					//!< Ray queries: only keep the closest hit
+		QUERY_CULLING				= (1<<9),					//!< Ray queries: discard backfaces
+
+		QUERY_FORCE_DWORD			= 0x7fffffff
+	};
+
+	//! Caller-provided data for a query: results, stats, and the query's working data. Queries only read models & meshes,
+	//! so any number of threads can query the same model at once, each with its own context. Keep one context per thread
+	//! and reuse it from one query to the next, so that its memory is reused as well.
+	struct OPCODE_API QueryContext
+	{
+						QueryContext() : TouchedPrimitives(null), Contact(FALSE), NbBVTests(0), NbPrimTests(0)	{}
+						~QueryContext()																			{}
+
+		inline_	udword			GetNbTouchedPrimitives()	const	{ return TouchedPrimitives ? TouchedPrimitives->GetNbEntries() : 0;	}
+		inline_	const udword*	GetTouchedPrimitives()		const	{ return TouchedPrimitives ? TouchedPrimitives->GetEntries() : null;	}
+
+		// Results of last query
+		CollisionFaces		Faces;				//!< Ray queries: stabbed faces (or closest one)
+		const Container*	TouchedPrimitives;	//!< Volume queries: touched primitives
+		BOOL				Contact;			//!< Contact status
+		// Stats of last query
+		udword				NbBVTests;			//!< Number of BV tests
+		udword				NbPrimTests;		//!< Number of primitive tests
+		// Working data
+		RayCollider			RC;
+		SphereCollider		SC;
+		OBBCollider			OC;
+		AABBCollider		AC;
+		LSSCollider			LC;
+		SphereCache			SCache;
+		OBBCache			OCache;
+		AABBCache			ACache;
+		LSSCache			LCache;
+	};
+
+	OPCODE_API	bool RayQuery	(QueryContext& context, const Ray& world_ray, const Model& model, const Matrix4x4* world=null, udword flags=0, float max_dist=MAX_FLOAT);
+	OPCODE_API	bool SphereQuery(QueryContext& context, const Sphere& sphere, const Model& model, const Matrix4x4* worlds=null, const Matrix4x4* worldm=null, udword flags=0);
+	OPCODE_API	bool OBBQuery	(QueryContext& context, const OBB& box, const Model& model, const Matrix4x4* worldb=null, const Matrix4x4* worldm=null, udword flags=0);
+	OPCODE_API	bool AABBQuery	(QueryContext& context, const CollisionAABB& box, const Model& model, udword flags=0);
+	OPCODE_API	bool LSSQuery	(QueryContext& context, const LSS& lss, const Model& model, const Matrix4x4* worldl=null, const Matrix4x4* worldm=null, udword flags=0);
+
+#endif // __OPC_QUERYCONTEXT_H__
@@ -6,58 +6,109 @@
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- *	Computes a segment-AABB overlap test using the separating axis theorem. Segment is cached within the class.
+ *	Computes a segment-AABB overlap test using the separating axis theorem.
+ *	\param		mid		[in] segment's middle point
+ *	\param		dir		[in] segment's half-direction, i.e. (end - start)*0.5
+ *	\param		fdir	[in] absolute half-direction
  *	\param		center	[in] AABB center
  *	\param		extents	[in] AABB extents
  *	\return		true on overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL RayCollider::SegmentAABBOverlap(const Point& center, const Point& extents)
+inline_ BOOL SegmentAABBTest(const Point& mid, const Point& dir, const Point& fdir, const Point& center, const Point& extents)
 {
-	// Stats
-	mNbRayBVTests++;
+#ifdef OPC_SIMD_SSE2
+	const __m128 E = SIMD_LoadPoint(extents);
+	const __m128 FDir = SIMD_LoadPoint(fdir);
+
+	const __m128 D = _mm_sub_ps(SIMD_LoadPoint(mid), SIMD_LoadPoint(center));
+	if(SIMD_Separated(D, _mm_add_ps(E, FDir)))	return FALSE;
 
-	float Dx = mData2.x - center.x;		if(fabsf(Dx) > extents.x + mFDir.x)	return FALSE;
-	float Dy = mData2.y - center.y;		if(fabsf(Dy) > extents.y + mFDir.y)	return FALSE;
-	float Dz = mData2.z - center.z;		if(fabsf(Dz) > extents.z + mFDir.z)	return FALSE;
+	const __m128 F = SIMD_Cross(SIMD_LoadPoint(dir), D);
+	const __m128 R = _mm_add_ps(_mm_mul_ps(SIMD_SHUFFLE(E, 1, 0, 0), SIMD_SHUFFLE(FDir, 2, 2, 1)), _mm_mul_ps(SIMD_SHUFFLE(E, 2, 2, 1), SIMD_SHUFFLE(FDir, 1, 0, 0)));
+	return !SIMD_Separated(F, R);
+#else
+	float Dx = mid.x - center.x;		if(fabsf(Dx) > extents.x + fdir.x)	return FALSE;
+	float Dy = mid.y - center.y;		if(fabsf(Dy) > extents.y + fdir.y)	return FALSE;
+	float Dz = mid.z - center.z;		if(fabsf(Dz) > extents.z + fdir.z)	return FALSE;
 
 	float f;
-	f = mData.y * Dz - mData.z * Dy;	if(fabsf(f) > extents.y*mFDir.z + extents.z*mFDir.y)	return FALSE;
-	f = mData.z * Dx - mData.x * Dz;	if(fabsf(f) > extents.x*mFDir.z + extents.z*mFDir.x)	return FALSE;
-	f = mData.x * Dy - mData.y * Dx;	if(fabsf(f) > extents.x*mFDir.y + extents.y*mFDir.x)	return FALSE;
+	f = dir.y * Dz - dir.z * Dy;		if(fabsf(f) > extents.y*fdir.z + extents.z*fdir.y)	return FALSE;
+	f = dir.z * Dx - dir.x * Dz;		if(fabsf(f) > extents.x*fdir.z + extents.z*fdir.x)	return FALSE;
+	f = dir.x * Dy - dir.y * Dx;		if(fabsf(f) > extents.x*fdir.y + extents.y*fdir.x)	return FALSE;
 
 	return TRUE;
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- *	Computes a ray-AABB overlap test using the separating axis theorem. Ray is cached within the class.
+ *	Computes a ray-AABB overlap test using the separating axis theorem.
+ *	\param		orig	[in] ray origin
+ *	\param		dir		[in] ray direction
+ *	\param		fdir	[in] absolute ray direction
  *	\param		center	[in] AABB center
  *	\param		extents	[in] AABB extents
  *	\return		true on overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL RayCollider::RayAABBOverlap(const Point& center, const Point& extents)
+inline_ BOOL RayAABBTest(const Point& orig, const Point& dir, const Point& fdir, const Point& center, const Point& extents)
 {
-	// Stats
-	mNbRayBVTests++;
-
-//	float Dx = mOrigin.x - center.x;	if(fabsf(Dx) > extents.x && Dx*mDir.x>=0.0f)	return FALSE;
-//	float Dy = mOrigin.y - center.y;	if(fabsf(Dy) > extents.y && Dy*mDir.y>=0.0f)	return FALSE;
-//	float Dz = mOrigin.z - center.z;	if(fabsf(Dz) > extents.z && Dz*mDir.z>=0.0f)	return FALSE;
+#ifdef OPC_SIMD_SSE2
+	const __m128 E = SIMD_LoadPoint(extents);
+	const __m128 Dir = SIMD_LoadPoint(dir);
 
-	float Dx = mOrigin.x - center.x;	if(GREATER(Dx, extents.x) && Dx*mDir.x>=0.0f)	return FALSE;
-	float Dy = mOrigin.y - center.y;	if(GREATER(Dy, extents.y) && Dy*mDir.y>=0.0f)	return FALSE;
-	float Dz = mOrigin.z - center.z;	if(GREATER(Dz, extents.z) && Dz*mDir.z>=0.0f)	return FALSE;
+	// Separated if the origin is outside a slab, going away from it
+	const __m128 D = _mm_sub_ps(SIMD_LoadPoint(orig), SIMD_LoadPoint(center));
+	const __m128 Out = _mm_and_ps(_mm_cmpgt_ps(SIMD_Abs(D), E), _mm_cmpge_ps(_mm_mul_ps(D, Dir), _mm_setzero_ps()));
+	if(_mm_movemask_ps(Out)&7)	return FALSE;
 
-//	float Dx = mOrigin.x - center.x;	if(GREATER(Dx, extents.x) && ((SIR(Dx)-1)^SIR(mDir.x))>=0.0f)	return FALSE;
-//	float Dy = mOrigin.y - center.y;	if(GREATER(Dy, extents.y) && ((SIR(Dy)-1)^SIR(mDir.y))>=0.0f)	return FALSE;
-//	float Dz = mOrigin.z - center.z;	if(GREATER(Dz, extents.z) && ((SIR(Dz)-1)^SIR(mDir.z))>=0.0f)	return FALSE;
+	const __m128 FDir = SIMD_LoadPoint(fdir);
+	const __m128 F = SIMD_Cross(Dir, D);
+	const __m128 R = _mm_add_ps(_mm_mul_ps(SIMD_SHUFFLE(E, 1, 0, 0), SIMD_SHUFFLE(FDir, 2, 2, 1)), _mm_mul_ps(SIMD_SHUFFLE(E, 2, 2, 1), SIMD_SHUFFLE(FDir, 1, 0, 0)));
+	return !SIMD_Separated(F, R);
+#else
+	float Dx = orig.x - center.x;	if(GREATER(Dx, extents.x) && Dx*dir.x>=0.0f)	return FALSE;
+	float Dy = orig.y - center.y;	if(GREATER(Dy, extents.y) && Dy*dir.y>=0.0f)	return FALSE;
+	float Dz = orig.z - center.z;	if(GREATER(Dz, extents.z) && Dz*dir.z>=0.0f)	return FALSE;
 
 	float f;
-	f = mDir.y * Dz - mDir.z * Dy;		if(fabsf(f) > extents.y*mFDir.z + extents.z*mFDir.y)	return FALSE;
-	f = mDir.z * Dx - mDir.x * Dz;		if(fabsf(f) > extents.x*mFDir.z + extents.z*mFDir.x)	return FALSE;
-	f = mDir.x * Dy - mDir.y * Dx;		if(fabsf(f) > extents.x*mFDir.y + extents.y*mFDir.x)	return FALSE;
+	f = dir.y * Dz - dir.z * Dy;		if(fabsf(f) > extents.y*fdir.z + extents.z*fdir.y)	return FALSE;
+	f = dir.z * Dx - dir.x * Dz;		if(fabsf(f) > extents.x*fdir.z + extents.z*fdir.x)	return FALSE;
+	f = dir.x * Dy - dir.y * Dx;		if(fabsf(f) > extents.x*fdir.y + extents.y*fdir.x)	return FALSE;
 
 	return TRUE;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes a segment-AABB overlap test using the separating axis theorem. Segment is cached within the class.
+ *	\param		center	[in] AABB center
+ *	\param		extents	[in] AABB extents
+ *	\return		true on overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL RayCollider::SegmentAABBOverlap(const Point& center, const Point& extents)
+{
+	// Stats
+	mNbRayBVTests++;
+
+	return SegmentAABBTest(mData2, mData, mFDir, center, extents);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes a ray-AABB overlap test using the separating axis theorem. Ray is cached within the class.
+ *	\param		center	[in] AABB center
+ *	\param		extents	[in] AABB extents
+ *	\return		true on overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL RayCollider::RayAABBOverlap(const Point& center, const Point& extents)
+{
+	// Stats
+	mNbRayBVTests++;
+
+	return RayAABBTest(mOrigin, mDir, mFDir, center, extents);
 }
@@ -173,7 +173,7 @@ using namespace Opcode;
 
 #define SEGMENT_PRIM(prim_index, flag)														\
 	/* Request vertices from the app */														\
-	VertexPointers VP;	mIMesh->GetTriangle(VP, prim_index);								\
+	VertexPointers VP;	ConversionArea VC;	mIMesh->GetTriangle(VP, prim_index, VC);								\
 																							\
 	/* Perform ray-tri overlap test and return */											\
 	if(RayTriOverlap(*VP.Vertex[0], *VP.Vertex[1], *VP.Vertex[2]))							\
@@ -188,7 +188,7 @@ using namespace Opcode;
 
 #define RAY_PRIM(prim_index, flag)															\
 	/* Request vertices from the app */														\
-	VertexPointers VP;	mIMesh->GetTriangle(VP, prim_index);								\
+	VertexPointers VP;	ConversionArea VC;	mIMesh->GetTriangle(VP, prim_index, VC);								\
 																							\
 	/* Perform ray-tri overlap test and return */											\
 	if(RayTriOverlap(*VP.Vertex[0], *VP.Vertex[1], *VP.Vertex[2]))							\
@@ -267,7 +267,15 @@ bool RayCollider::Collide(const Ray& world_ray, const Model& model, const Matrix
 	// Init collision query
 	if(InitQuery(world_ray, world, cache))	return true;
 
-	if(!model.HasLeafNodes())
+	if(model.IsWide())
+	{
+		const AABBWideTree* Tree = (const AABBWideTree*)model.GetTree();
+
+		// Perform stabbing query
+		if(IR(mMaxDist)!=IEEE_MAX_FLOAT)	_SegmentStab(Tree);
+		else								_RayStab(Tree);
+	}
+	else if(!model.HasLeafNodes())
 	{
 		if(model.IsQuantized())
 		{
@@ -388,7 +396,8 @@ BOOL RayCollider::InitQuery(const Ray& world_ray, const Matrix4x4* world, udword
 		{
 			// Request vertices from the app
 			VertexPointers VP;
-			mIMesh->GetTriangle(VP, *face_id);
+			ConversionArea VC;
+			mIMesh->GetTriangle(VP, *face_id, VC);
 			// Perform ray-cached tri overlap test
 			if(RayTriOverlap(*VP.Vertex[0], *VP.Vertex[1], *VP.Vertex[2]))
 			{
@@ -760,3 +769,55 @@ void RayCollider::_RayStab(const AABBTreeNode* node, Container& box_indices)
 		_RayStab(node->GetNeg(), box_indices);
 	}
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Stack-based stabbing queries for 4-wide trees. Children are tested one by one with the usual overlap tests.
+ *	\param		tree	[in] wide tree
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! Stack-based stabbing query for wide trees
+#define IMPLEMENT_WIDE_STAB(function, overlap, prim)							\
+void RayCollider::function(const AABBWideTree* tree)							\
+{																				\
+	const AABBWideNode* Nodes = tree->GetNodes();								\
+	const udword* Indices = tree->GetIndices();									\
+																				\
+	udword Stack[WIDE_STACK_SIZE];												\
+	udword NbEntries = 0;														\
+	Stack[NbEntries++] = 0;														\
+	while(NbEntries)															\
+	{																			\
+		const AABBWideNode& Node = Nodes[Stack[--NbEntries]];					\
+		for(udword i=0;i<WIDE_TREE_WIDTH;i++)									\
+		{																		\
+			/* Empty slots are always last */									\
+			if(Node.IsEmpty(i))	break;											\
+																				\
+			/* Dequantize box & perform overlap test */							\
+			Point Center, Extents;												\
+			Node.GetChildBox(i, Center, Extents);								\
+			if(!overlap(Center, Extents))	continue;							\
+																				\
+			if(Node.IsLeaf(i))													\
+			{																	\
+				const udword* Prims = Indices + Node.GetFirstPrimitive(i);		\
+				udword Nb = Node.GetNbPrimitives(i);							\
+				while(Nb--)														\
+				{																\
+					const udword PrimIndex = *Prims++;							\
+					prim(PrimIndex, OPC_CONTACT)								\
+					if(ContactFound()) return;									\
+				}																\
+			}																	\
+			else																\
+			{																	\
+				ASSERT(NbEntries<WIDE_STACK_SIZE);								\
+				Stack[NbEntries++] = Node.GetChild(i);							\
+			}																	\
+		}																		\
+	}																			\
+}
+
+IMPLEMENT_WIDE_STAB(_SegmentStab, SegmentAABBOverlap, SEGMENT_PRIM)
+IMPLEMENT_WIDE_STAB(_RayStab, RayAABBOverlap, RAY_PRIM)
@@ -209,11 +209,13 @@
 							void			_SegmentStab(const AABBQuantizedNode* node);
 							void			_SegmentStab(const AABBQuantizedNoLeafNode* node);
 							void			_SegmentStab(const AABBTreeNode* node, Container& box_indices);
+							void			_SegmentStab(const AABBWideTree* tree);
 							void			_RayStab(const AABBCollisionNode* node);
 							void			_RayStab(const AABBNoLeafNode* node);
 							void			_RayStab(const AABBQuantizedNode* node);
 							void			_RayStab(const AABBQuantizedNoLeafNode* node);
 							void			_RayStab(const AABBTreeNode* node, Container& box_indices);
+							void			_RayStab(const AABBWideTree* tree);
 			// Overlap tests
 		inline_				BOOL			RayAABBOverlap(const Point& center, const Point& extents);
 		inline_				BOOL			SegmentAABBOverlap(const Point& center, const Point& extents);
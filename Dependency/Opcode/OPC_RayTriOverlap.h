@@ -4,86 +4,150 @@
 /**
  *	Computes a ray-triangle intersection test.
  *	Original code from Tomas Mller's "Fast Minimum Storage Ray-Triangle Intersection".
- *	It's been optimized a bit with integer code, and modified to return a non-intersection if distance from
- *	ray origin to triangle is negative.
+ *	It's been modified to return a non-intersection if distance from ray origin to triangle is negative.
+ *	The SSE2 version computes the cross products with SIMD code.
  *
- *	\param		vert0	[in] triangle vertex
- *	\param		vert1	[in] triangle vertex
- *	\param		vert2	[in] triangle vertex
- *	\return		true on overlap. mStabbedFace is filled with relevant info.
+ *	\param		orig		[in] ray origin
+ *	\param		dir			[in] ray direction
+ *	\param		vert0		[in] triangle vertex
+ *	\param		vert1		[in] triangle vertex
+ *	\param		vert2		[in] triangle vertex
+ *	\param		culling		[in] true to discard backfaces
+ *	\param		face		[out] distance & barycentric coordinates of the hit (undefined if there's no hit)
+ *	\return		true on overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL RayCollider::RayTriOverlap(const Point& vert0, const Point& vert1, const Point& vert2)
+inline_ BOOL RayTriTest(const Point& orig, const Point& dir, const Point& vert0, const Point& vert1, const Point& vert2, BOOL culling, CollisionFace& face)
 {
-	// Stats
-	mNbRayPrimTests++;
+#ifdef OPC_SIMD_SSE2
+	const __m128 V0 = SIMD_LoadPoint(vert0);
+	const __m128 Dir = SIMD_LoadPoint(dir);
 
+	// Find vectors for two edges sharing vert0
+	const __m128 Edge1 = _mm_sub_ps(SIMD_LoadPoint(vert1), V0);
+	const __m128 Edge2 = _mm_sub_ps(SIMD_LoadPoint(vert2), V0);
+
+	// Begin calculating determinant - also used to calculate U parameter
+	const __m128 PVec = SIMD_Cross(Dir, Edge2);
+
+	// If determinant is near zero, ray lies in plane of triangle
+	const float det = SIMD_Dot(Edge1, PVec);
+	if(culling)
+	{
+		if(det<LOCAL_EPSILON)	return FALSE;
+	}
+	else
+	{
+		if(det>-LOCAL_EPSILON && det<LOCAL_EPSILON)	return FALSE;
+	}
+
+	// Calculate distance from vert0 to ray origin
+	const __m128 TVec = _mm_sub_ps(SIMD_LoadPoint(orig), V0);
+	const __m128 QVec = SIMD_Cross(TVec, Edge1);
+	const float u = SIMD_Dot(TVec, PVec);
+	const float v = SIMD_Dot(Dir, QVec);
+	const float t = SIMD_Dot(Edge2, QVec);
+	if(culling)
+	{
+		// From here, det is > 0
+		if(u<0.0f || u>det || v<0.0f || u+v>det || t<0.0f)	return FALSE;
+		const float OneOverDet = 1.0f / det;
+		face.mDistance	= t * OneOverDet;
+		face.mU			= u * OneOverDet;
+		face.mV			= v * OneOverDet;
+	}
+	else
+	{
+		const float OneOverDet = 1.0f / det;
+		face.mU = u * OneOverDet;
+		face.mV = v * OneOverDet;
+		face.mDistance = t * OneOverDet;
+		if(face.mU<0.0f || face.mU>1.0f || face.mV<0.0f || face.mU+face.mV>1.0f || face.mDistance<0.0f)	return FALSE;
+	}
+	return TRUE;
+#else
 	// Find vectors for two edges sharing vert0
 	Point edge1 = vert1 - vert0;
 	Point edge2 = vert2 - vert0;
 
 	// Begin calculating determinant - also used to calculate U parameter
-	Point pvec = mDir^edge2;
+	Point pvec = dir^edge2;
 
 	// If determinant is near zero, ray lies in plane of triangle
 	float det = edge1|pvec;
 
-	if(mCulling)
+	if(culling)
 	{
-		if(det<LOCAL_EPSILON)														return FALSE;
-		// From here, det is > 0. So we can use integer cmp.
+		if(det<LOCAL_EPSILON)									return FALSE;
+		// From here, det is > 0.
 
 		// Calculate distance from vert0 to ray origin
-		Point tvec = mOrigin - vert0;
+		Point tvec = orig - vert0;
 
 		// Calculate U parameter and test bounds
-		mStabbedFace.mU = tvec|pvec;
-//		if(IR(u)&0x80000000 || u>det)					return FALSE;
-		if(IS_NEGATIVE_FLOAT(mStabbedFace.mU) || IR(mStabbedFace.mU)>IR(det))		return FALSE;
+		face.mU = tvec|pvec;
+		if(face.mU<0.0f || face.mU>det)							return FALSE;
 
 		// Prepare to test V parameter
 		Point qvec = tvec^edge1;
 
 		// Calculate V parameter and test bounds
-		mStabbedFace.mV = mDir|qvec;
-		if(IS_NEGATIVE_FLOAT(mStabbedFace.mV) || mStabbedFace.mU+mStabbedFace.mV>det)	return FALSE;
+		face.mV = dir|qvec;
+		if(face.mV<0.0f || face.mU+face.mV>det)					return FALSE;
 
 		// Calculate t, scale parameters, ray intersects triangle
-		mStabbedFace.mDistance = edge2|qvec;
+		face.mDistance = edge2|qvec;
 		// Det > 0 so we can early exit here
 		// Intersection point is valid if distance is positive (else it can just be a face behind the orig point)
-		if(IS_NEGATIVE_FLOAT(mStabbedFace.mDistance))								return FALSE;
+		if(face.mDistance<0.0f)									return FALSE;
 		// Else go on
 		float OneOverDet = 1.0f / det;
-		mStabbedFace.mDistance *= OneOverDet;
-		mStabbedFace.mU *= OneOverDet;
-		mStabbedFace.mV *= OneOverDet;
+		face.mDistance *= OneOverDet;
+		face.mU *= OneOverDet;
+		face.mV *= OneOverDet;
 	}
 	else
 	{
 		// the non-culling branch
-		if(det>-LOCAL_EPSILON && det<LOCAL_EPSILON)									return FALSE;
+		if(det>-LOCAL_EPSILON && det<LOCAL_EPSILON)				return FALSE;
 		float OneOverDet = 1.0f / det;
 
 		// Calculate distance from vert0 to ray origin
-		Point tvec = mOrigin - vert0;
+		Point tvec = orig - vert0;
 
 		// Calculate U parameter and test bounds
-		mStabbedFace.mU = (tvec|pvec) * OneOverDet;
-//		if(IR(u)&0x80000000 || u>1.0f)					return FALSE;
-		if(IS_NEGATIVE_FLOAT(mStabbedFace.mU) || IR(mStabbedFace.mU)>IEEE_1_0)		return FALSE;
+		face.mU = (tvec|pvec) * OneOverDet;
+		if(face.mU<0.0f || face.mU>1.0f)						return FALSE;
 
 		// prepare to test V parameter
 		Point qvec = tvec^edge1;
 
 		// Calculate V parameter and test bounds
-		mStabbedFace.mV = (mDir|qvec) * OneOverDet;
-		if(IS_NEGATIVE_FLOAT(mStabbedFace.mV) || mStabbedFace.mU+mStabbedFace.mV>1.0f)	return FALSE;
+		face.mV = (dir|qvec) * OneOverDet;
+		if(face.mV<0.0f || face.mU+face.mV>1.0f)				return FALSE;
 
 		// Calculate t, ray intersects triangle
-		mStabbedFace.mDistance = (edge2|qvec) * OneOverDet;
+		face.mDistance = (edge2|qvec) * OneOverDet;
 		// Intersection point is valid if distance is positive (else it can just be a face behind the orig point)
-		if(IS_NEGATIVE_FLOAT(mStabbedFace.mDistance))								return FALSE;
+		if(face.mDistance<0.0f)									return FALSE;
 	}
 	return TRUE;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes a ray-triangle intersection test. Ray is cached within the class.
+ *	\param		vert0	[in] triangle vertex
+ *	\param		vert1	[in] triangle vertex
+ *	\param		vert2	[in] triangle vertex
+ *	\return		true on overlap. mStabbedFace is filled with relevant info.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL RayCollider::RayTriOverlap(const Point& vert0, const Point& vert1, const Point& vert2)
+{
+	// Stats
+	mNbRayPrimTests++;
+
+	return RayTriTest(mOrigin, mDir, vert0, vert1, vert2, mCulling, mStabbedFace);
 }
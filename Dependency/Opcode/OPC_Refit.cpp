@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains the incremental & parallel refit engine shared by optimized trees.
+ *	\file		OPC_Refit.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits are driven by a bitset of dirty primitives: each tree provides a kernel that walks the nodes depth-first,
+ *	recomputes the boxes above dirty primitives and reports whether they changed. A node is only recomputed when one
+ *	of its children changed, so static parts of a mesh (or parts that moved without changing the boxes) cost a few
+ *	bit tests.
+ *
+ *	Large trees are refit in two passes. The nodes at a given split depth are collected first, then each of those
+ *	subtrees is refit by a worker thread, and finally the top of the tree is refit by the calling thread, fetching
+ *	the subtrees' results instead of walking them again. Subtrees don't share any node, so no locking is needed.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+using namespace Opcode;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Setups quantization coeffs for quantized trees.
+ *	\param		center_coeff	[in] tree's dequantization coeffs for centers
+ *	\param		extents_coeff	[in] tree's dequantization coeffs for extents
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RefitContext::SetQuantization(const Point& center_coeff, const Point& extents_coeff)
+{
+	mCenterCoeff	= center_coeff;
+	mExtentsCoeff	= extents_coeff;
+	for(udword i=0;i<3;i++)
+	{
+		mCenterQuant[i]		= center_coeff[i]!=0.0f ? 1.0f / center_coeff[i] : 0.0f;
+		mExtentsQuant[i]	= extents_coeff[i]!=0.0f ? 1.0f / extents_coeff[i] : 0.0f;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Dequantizes a box.
+ *	\param		box		[in] quantized box
+ *	\param		min		[out] min point
+ *	\param		max		[out] max point
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RefitContext::GetBox(const QuantizedAABB& box, Point& min, Point& max) const
+{
+	for(udword i=0;i<3;i++)
+	{
+		const float Center	= float(box.mCenter[i]) * mCenterCoeff[i];
+		const float Extents	= float(box.mExtents[i]) * mExtentsCoeff[i];
+		min[i] = Center - Extents;
+		max[i] = Center + Extents;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Quantizes a box. The quantized box always encloses the original one.
+ *	\param		box		[in/out] quantized box
+ *	\param		min		[in] min point
+ *	\param		max		[in] max point
+ *	\return		REFIT_CHANGED if the box has changed, REFIT_OVERFLOW if it can't be quantized with current coeffs
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword RefitContext::UpdateBox(QuantizedAABB& box, const Point& min, const Point& max) const
+{
+	QuantizedAABB NewBox;
+	for(udword i=0;i<3;i++)
+	{
+		// Quantize the center, rounding to nearest
+		sword Center = 0;
+		if(mCenterQuant[i]!=0.0f)
+		{
+			const float QC = (max[i] + min[i]) * 0.5f * mCenterQuant[i];
+			if(QC>32767.0f || QC<-32767.0f)	return REFIT_OVERFLOW;
+			Center = sword(QC>=0.0f ? QC + 0.5f : QC - 0.5f);
+		}
+
+		// Quantize the extents around the dequantized center, rounding up
+		const float DC = float(Center) * mCenterCoeff[i];
+		float Extents = max[i] - DC;
+		if(DC - min[i] > Extents)	Extents = DC - min[i];
+
+		udword QE = 0;
+		if(Extents>0.0f)
+		{
+			if(mExtentsQuant[i]==0.0f)	return REFIT_OVERFLOW;
+			const float QF = Extents * mExtentsQuant[i];
+			if(QF>=65535.0f)	return REFIT_OVERFLOW;
+			// Round up. The loop then only fixes float rounding errors, like the builder does.
+			QE = udword(QF) + 1;
+			while(DC + float(QE)*mExtentsCoeff[i] < max[i] || DC - float(QE)*mExtentsCoeff[i] > min[i])
+			{
+				if(++QE>0xffff)	return REFIT_OVERFLOW;
+			}
+		}
+		NewBox.mCenter[i]	= Center;
+		NewBox.mExtents[i]	= uword(QE);
+	}
+
+	if(	NewBox.mCenter[0]==box.mCenter[0] && NewBox.mCenter[1]==box.mCenter[1] && NewBox.mCenter[2]==box.mCenter[2]
+	&&	NewBox.mExtents[0]==box.mExtents[0] && NewBox.mExtents[1]==box.mExtents[1] && NewBox.mExtents[2]==box.mExtents[2])	return 0;
+	box = NewBox;
+	return REFIT_CHANGED;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits a subtree. Called by worker threads.
+ *	\param		task_index	[in] subtree index
+ *	\param		user_data	[in] refit context
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _RefitSubtree(udword task_index, void* user_data)
+{
+	RefitContext* Context = (RefitContext*)user_data;
+	// Start below the split depth, so that the kernel doesn't stop right away
+	Context->mResults[task_index] = (Context->mKernel)(Context->mSubtrees[task_index], *Context, Context->mSplitDepth+1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits a tree, from its root. Small trees are refit serially by the calling thread. Larger trees are split
+ *	in subtrees at some depth: subtrees are refit in parallel, then the top of the tree is refit by the caller.
+ *	\param		root		[in] root node
+ *	\param		nb_nodes	[in] number of nodes in the tree
+ *	\param		context		[in] refit context
+ *	\param		settings	[in] refit settings
+ *	\return		REFIT_XXX flags for the root
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword Opcode::RefitTree(void* root, udword nb_nodes, RefitContext& context, const RefitSettings& settings)
+{
+	context.mGather		= false;
+	context.mNbSubtrees	= 0;
+	context.mCursor		= 0;
+
+	udword NbThreads = settings.mNbThreads ? settings.mNbThreads : GetNbProcessors();
+	if(NbThreads<2 || nb_nodes<settings.mParallelThreshold)
+	{
+		context.mSplitDepth = INVALID_ID;
+		return (context.mKernel)(root, context, 0);
+	}
+
+	// Around 8 subtrees per thread, so that unbalanced subtrees don't leave threads idle
+	udword SplitDepth = 0;
+	while((1u<<SplitDepth)<NbThreads*8 && (2u<<SplitDepth)<=REFIT_MAX_SUBTREES)	SplitDepth++;
+
+	// Collect subtrees. The depth assumes binary nodes: wider trees have more subtrees at that depth, so go up
+	// until they fit.
+	for(;;)
+	{
+		context.mSplitDepth	= SplitDepth;
+		context.mNbSubtrees	= 0;
+		context.mGather		= true;
+		(context.mKernel)(root, context, 0);
+		context.mGather		= false;
+		if(context.mNbSubtrees<=REFIT_MAX_SUBTREES || !SplitDepth)	break;
+		SplitDepth--;
+	}
+
+	// Refit subtrees in parallel, then the top of the tree
+	RunParallel(context.mNbSubtrees, _RefitSubtree, &context, NbThreads);
+	return (context.mKernel)(root, context, 0);
+}
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains the incremental & parallel refit engine shared by optimized trees.
+ *	\file		OPC_Refit.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_REFIT_H__
+#define __OPC_REFIT_H__
+
+	//! Settings for incremental & parallel refits
+	struct OPCODE_API RefitSettings
+	{
+		//! Constructor
+		inline_					RefitSettings() :
+									mDirtyPrimitives	(null),
+									mNbThreads			(1),
+									mParallelThreshold	(32768)
+								{}
+
+				const udword*	mDirtyPrimitives;	//!< Bitset of moved primitives (primitive i = bit i&31 of word i>>5), or null if they all moved
+				udword			mNbThreads;			//!< Number of refit threads. 0 = one per processor, 1 = serial refit
+				udword			mParallelThreshold;	//!< Trees with less nodes than that are refit serially
+	};
+
+	//! Marks a primitive as dirty in a RefitSettings::mDirtyPrimitives bitset
+	inline_ void	SetDirtyPrimitive(udword* dirty_primitives, udword index)			{ dirty_primitives[index>>5] |= 1<<(index&31);			}
+	//! Checks whether a primitive is dirty in a RefitSettings::mDirtyPrimitives bitset
+	inline_ BOOL	IsDirtyPrimitive(const udword* dirty_primitives, udword index)	{ return dirty_primitives[index>>5] & (1<<(index&31));	}
+
+	#define REFIT_CHANGED			(1<<0)	//!< Box has changed, the parent must be refit
+	#define REFIT_OVERFLOW			(1<<1)	//!< Box doesn't fit the quantization range anymore
+	#define REFIT_MAX_SUBTREES		256		//!< Max number of subtrees refit in parallel
+
+	struct RefitContext;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/**
+	 *	Refit kernel, implemented by each kind of tree. A kernel refits a node after its children, and returns REFIT_XXX
+	 *	flags. It must call RefitContext::Subtree() instead of processing nodes at depth RefitContext::mSplitDepth, and
+	 *	must not modify anything while RefitContext::mGather is true.
+	 *	\param		node		[in] node to refit
+	 *	\param		context		[in] refit context
+	 *	\param		depth		[in] node's depth
+	 *	\return		REFIT_XXX flags
+	 */
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	typedef udword	(*RefitKernel)	(void* node, RefitContext& context, udword depth);
+
+	//! Shared state of a refit
+	struct OPCODE_API RefitContext
+	{
+		//! Constructor
+		inline_					RefitContext(const MeshInterface* mesh_interface, const udword* dirty, RefitKernel kernel, const void* tree) :
+									mIMesh			(mesh_interface),
+									mDirty			(dirty),
+									mKernel			(kernel),
+									mTree			(tree),
+									mSplitDepth		(INVALID_ID),
+									mGather			(false),
+									mNbSubtrees		(0),
+									mCursor			(0)
+								{
+									mCenterCoeff.Zero();
+									mExtentsCoeff.Zero();
+									mCenterQuant.Zero();
+									mExtentsQuant.Zero();
+								}
+
+		// Dirty primitives
+		inline_			BOOL	IsDirty(udword index)	const	{ return !mDirty || IsDirtyPrimitive(mDirty, index);	}
+
+		// Nodes at split depth are refit in parallel
+		inline_			udword	Subtree(void* node)
+								{
+									if(mGather)
+									{
+										// Counted even when the array is full, so that RefitTree() can retry higher up
+										if(mNbSubtrees<REFIT_MAX_SUBTREES)	mSubtrees[mNbSubtrees] = node;
+										mNbSubtrees++;
+										return 0;
+									}
+									return mResults[mCursor++];
+								}
+
+		// Triangle's box
+		inline_			void	GetTriangleBox(udword index, Point& min, Point& max)	const
+								{
+									VertexPointers VP;
+									ConversionArea VC;
+									mIMesh->GetTriangle(VP, index, VC);
+									min = *VP.Vertex[0];
+									max = *VP.Vertex[0];
+									min.Min(*VP.Vertex[1]);
+									max.Max(*VP.Vertex[1]);
+									min.Min(*VP.Vertex[2]);
+									max.Max(*VP.Vertex[2]);
+								}
+
+		// Box update, returns REFIT_CHANGED if the box has changed
+		inline_			udword	UpdateBox(CollisionAABB& box, const Point& min, const Point& max)	const
+								{
+									const Point Center	= (max + min)*0.5f;
+									const Point Extents	= (max - min)*0.5f;
+									if(box.mCenter==Center && box.mExtents==Extents)	return 0;
+									box.mCenter		= Center;
+									box.mExtents	= Extents;
+									return REFIT_CHANGED;
+								}
+
+		// Quantized boxes
+						void	SetQuantization(const Point& center_coeff, const Point& extents_coeff);
+						void	GetBox(const QuantizedAABB& box, Point& min, Point& max)			const;
+						udword	UpdateBox(QuantizedAABB& box, const Point& min, const Point& max)	const;
+
+		const MeshInterface*	mIMesh;			//!< Mesh interface
+		const udword*			mDirty;			//!< Dirty primitives, or null
+		RefitKernel				mKernel;		//!< Tree's kernel
+		const void*				mTree;			//!< Tree being refit
+		Point					mCenterCoeff;	//!< Dequantization coeffs
+		Point					mExtentsCoeff;	//!< Dequantization coeffs
+		Point					mCenterQuant;	//!< Quantization coeffs
+		Point					mExtentsQuant;	//!< Quantization coeffs
+		// Parallel refit
+		udword					mSplitDepth;	//!< Depth of subtrees refit in parallel, or INVALID_ID
+		bool					mGather;		//!< Collecting subtrees
+		udword					mNbSubtrees;	//!< Number of subtrees
+		udword					mCursor;		//!< Next subtree result
+		void*					mSubtrees[REFIT_MAX_SUBTREES];	//!< Subtrees refit in parallel
+		udword					mResults[REFIT_MAX_SUBTREES];	//!< Results of parallel subtrees
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/**
+	 *	Refits a tree, from its root. Small trees are refit serially by the calling thread. Larger trees are split
+	 *	in subtrees at some depth: subtrees are refit in parallel, then the top of the tree is refit by the caller.
+	 *	\param		root		[in] root node
+	 *	\param		nb_nodes	[in] number of nodes in the tree
+	 *	\param		context		[in] refit context
+	 *	\param		settings	[in] refit settings
+	 *	\return		REFIT_XXX flags for the root
+	 */
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	FUNCTION OPCODE_API udword	RefitTree(void* root, udword nb_nodes, RefitContext& context, const RefitSettings& settings);
+
+#endif // __OPC_REFIT_H__
@@ -0,0 +1,233 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains SIMD helpers & precomputed data for the overlap tests.
+ *	\file		OPC_SIMD.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_SIMD_H__
+#define __OPC_SIMD_H__
+
+	// The overlap tests (OPC_*Overlap.h) come in two flavors: a portable scalar version, and an SSE2 version testing
+	// the 3 axes of a class of separating axes at once. Both versions perform the same floating-point operations in
+	// the same order, so they return the same results.
+#if defined(OPC_USE_SIMD) && defined(OPC_SSE2_TARGET)
+	#define OPC_SIMD_SSE2
+#endif
+
+#ifdef OPC_SIMD_SSE2
+	//! Shuffles the 3 first lanes of a vector. The last lane is kept.
+	#define SIMD_SHUFFLE(v, x, y, z)	_mm_shuffle_ps((v), (v), _MM_SHUFFLE(3, (z), (y), (x)))
+
+	//! Loads a point in the 3 first lanes. Doesn't read past the point.
+	inline_ __m128 SIMD_LoadPoint(const Point& p)
+	{
+		return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)&p.x)), _mm_load_ss(&p.z));
+	}
+
+	//! Absolute values
+	inline_ __m128 SIMD_Abs(__m128 v)
+	{
+		return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+	}
+
+	//! Negated values
+	inline_ __m128 SIMD_Neg(__m128 v)
+	{
+		return _mm_xor_ps(v, _mm_castsi128_ps(_mm_set1_epi32(SIGN_BITMASK)));
+	}
+
+	//! Selects a where mask is set, else b
+	inline_ __m128 SIMD_Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	//! Cross product, computed like Point::operator^
+	inline_ __m128 SIMD_Cross(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(	_mm_mul_ps(SIMD_SHUFFLE(a, 1, 2, 0), SIMD_SHUFFLE(b, 2, 0, 1)),
+							_mm_mul_ps(SIMD_SHUFFLE(a, 2, 0, 1), SIMD_SHUFFLE(b, 1, 2, 0)));
+	}
+
+	//! Dot product, computed like Point::operator|
+	inline_ float SIMD_Dot(__m128 a, __m128 b)
+	{
+		const __m128 p = _mm_mul_ps(a, b);
+		return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(p, SIMD_SHUFFLE(p, 1, 1, 1)), SIMD_SHUFFLE(p, 2, 2, 2)));
+	}
+
+	//! Separating axis test for 3 axes at once: true if |d|>r for one of the 3 first lanes
+	inline_ BOOL SIMD_Separated(__m128 d, __m128 r)
+	{
+		return _mm_movemask_ps(_mm_cmpgt_ps(SIMD_Abs(d), r)) & 7;
+	}
+
+	//! Separating axis test for projected intervals: true if min>r or max<-r for one of the 3 first lanes
+	inline_ BOOL SIMD_Separated(__m128 min, __m128 max, __m128 r)
+	{
+		return _mm_movemask_ps(_mm_or_ps(_mm_cmpgt_ps(min, r), _mm_cmplt_ps(max, SIMD_Neg(r)))) & 7;
+	}
+
+	//! Stores the 3 first components of a point, plus a zero
+	inline_ void SIMD_StorePoint(float* dest, const Point& p)
+	{
+		dest[0] = p.x;	dest[1] = p.y;	dest[2] = p.z;	dest[3] = 0.0f;
+	}
+#endif
+
+	//! Precomputed data for OBB-OBB tests with a constant relative transform, e.g. between the nodes of two trees.
+	struct OPCODE_API BoxBoxData
+	{
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Initializes the data.
+		 *	\param		r1to0		[in] rotation from box B's space to box A's space
+		 *	\param		t1to0		[in] translation from box B's space to box A's space
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_	void	Init(const Matrix3x3& r1to0, const Point& t1to0)
+						{
+							Matrix3x3 AR;
+							for(udword i=0;i<3;i++)
+							{
+								for(udword j=0;j<3;j++)
+								{
+									// Epsilon value prevents floating-point inaccuracies (strategy borrowed from RAPID)
+									AR.m[i][j] = 1e-6f + fabsf(r1to0.m[i][j]);
+								}
+							}
+#ifdef OPC_SIMD_SSE2
+							for(udword i=0;i<3;i++)
+							{
+								SIMD_StorePoint(mRows[i], Point(r1to0.m[i][0], r1to0.m[i][1], r1to0.m[i][2]));
+								SIMD_StorePoint(mARows[i], Point(AR.m[i][0], AR.m[i][1], AR.m[i][2]));
+								SIMD_StorePoint(mCols[i], Point(r1to0.m[0][i], r1to0.m[1][i], r1to0.m[2][i]));
+								SIMD_StorePoint(mACols[i], Point(AR.m[0][i], AR.m[1][i], AR.m[2][i]));
+								// Box B's terms for the cross-products axes
+								SIMD_StorePoint(mACross0[i], Point(AR.m[2][i], AR.m[2][i], AR.m[1][i]));
+								SIMD_StorePoint(mACross1[i], Point(AR.m[1][i], AR.m[0][i], AR.m[0][i]));
+							}
+							SIMD_StorePoint(mT, t1to0);
+#else
+							mR	= r1to0;
+							mAR	= AR;
+							mT	= t1to0;
+#endif
+						}
+
+#ifdef OPC_SIMD_SSE2
+				float	mRows[3][4];		//!< Rotation matrix, row by row
+				float	mARows[3][4];		//!< Absolute rotation matrix, row by row
+				float	mCols[3][4];		//!< Rotation matrix, column by column
+				float	mACols[3][4];		//!< Absolute rotation matrix, column by column
+				float	mACross0[3][4];		//!< Absolute rotation terms for cross-product axes
+				float	mACross1[3][4];		//!< Absolute rotation terms for cross-product axes
+				float	mT[4];				//!< Translation
+#else
+				Matrix3x3	mR;				//!< Rotation matrix
+				Matrix3x3	mAR;			//!< Absolute rotation matrix
+				Point		mT;				//!< Translation
+#endif
+	};
+
+	//! Precomputed data for tests between a constant OBB and AABBs
+	struct OPCODE_API OBBAABBData
+	{
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Initializes the data.
+		 *	\param		rbox_to_model	[in] rotation from OBB space to model space
+		 *	\param		tbox_to_model	[in] translation from OBB space to model space
+		 *	\param		box_extents		[in] OBB extents
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_	void	Init(const Matrix3x3& rbox_to_model, const Point& tbox_to_model, const Point& box_extents)
+						{
+							Matrix3x3 AR;
+							for(udword i=0;i<3;i++)
+							{
+								for(udword j=0;j<3;j++)
+								{
+									// Epsilon value prevents floating-point inaccuracies (strategy borrowed from RAPID)
+									AR.m[i][j] = 1e-6f + fabsf(rbox_to_model.m[i][j]);
+								}
+							}
+
+							// Precompute box-box data - Courtesy of Erwin de Vries
+							const Point BB1(	box_extents.x*AR.m[0][0] + box_extents.y*AR.m[1][0] + box_extents.z*AR.m[2][0],
+												box_extents.x*AR.m[0][1] + box_extents.y*AR.m[1][1] + box_extents.z*AR.m[2][1],
+												box_extents.x*AR.m[0][2] + box_extents.y*AR.m[1][2] + box_extents.z*AR.m[2][2]);
+
+							const Point BB123(	box_extents.y*AR.m[2][0] + box_extents.z*AR.m[1][0],
+												box_extents.x*AR.m[2][0] + box_extents.z*AR.m[0][0],
+												box_extents.x*AR.m[1][0] + box_extents.y*AR.m[0][0]);
+							const Point BB456(	box_extents.y*AR.m[2][1] + box_extents.z*AR.m[1][1],
+												box_extents.x*AR.m[2][1] + box_extents.z*AR.m[0][1],
+												box_extents.x*AR.m[1][1] + box_extents.y*AR.m[0][1]);
+							const Point BB789(	box_extents.y*AR.m[2][2] + box_extents.z*AR.m[1][2],
+												box_extents.x*AR.m[2][2] + box_extents.z*AR.m[0][2],
+												box_extents.x*AR.m[1][2] + box_extents.y*AR.m[0][2]);
+#ifdef OPC_SIMD_SSE2
+							for(udword i=0;i<3;i++)
+							{
+								SIMD_StorePoint(mCols[i], Point(rbox_to_model.m[0][i], rbox_to_model.m[1][i], rbox_to_model.m[2][i]));
+								SIMD_StorePoint(mACols[i], Point(AR.m[0][i], AR.m[1][i], AR.m[2][i]));
+							}
+							SIMD_StorePoint(mT, tbox_to_model);
+							SIMD_StorePoint(mExtents, box_extents);
+							SIMD_StorePoint(mBB1, BB1);
+							SIMD_StorePoint(mBB[0], BB123);
+							SIMD_StorePoint(mBB[1], BB456);
+							SIMD_StorePoint(mBB[2], BB789);
+#else
+							mR			= rbox_to_model;
+							mAR			= AR;
+							mT			= tbox_to_model;
+							mExtents	= box_extents;
+							mBB1		= BB1;
+							mBB[0]		= BB123;
+							mBB[1]		= BB456;
+							mBB[2]		= BB789;
+#endif
+						}
+
+		//! Gets the OBB's extents projected on the AABB axes, i.e. the extents of the OBB's bounding box
+		inline_	void	GetAABBExtents(Point& extents)	const
+						{
+#ifdef OPC_SIMD_SSE2
+							extents.Set(mBB1[0], mBB1[1], mBB1[2]);
+#else
+							extents = mBB1;
+#endif
+						}
+
+#ifdef OPC_SIMD_SSE2
+				float	mCols[3][4];		//!< Rotation matrix, column by column
+				float	mACols[3][4];		//!< Absolute rotation matrix, column by column
+				float	mT[4];				//!< Translation
+				float	mExtents[4];		//!< OBB extents
+				float	mBB1[4];			//!< OBB projected on the AABB axes
+				float	mBB[3][4];			//!< OBB terms for cross-product axes
+#else
+				Matrix3x3	mR;				//!< Rotation matrix
+				Matrix3x3	mAR;			//!< Absolute rotation matrix
+				Point		mT;				//!< Translation
+				Point		mExtents;		//!< OBB extents
+				Point		mBB1;			//!< OBB projected on the AABB axes
+				Point		mBB[3];			//!< OBB terms for cross-product axes
+#endif
+	};
+
+#endif // __OPC_SIMD_H__
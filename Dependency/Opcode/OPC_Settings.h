@@ -20,11 +20,14 @@
 #ifndef __OPC_SETTINGS_H__
 #define __OPC_SETTINGS_H__
 
-	//! Use CPU comparisons (comment that line to use standard FPU compares)
-	#define OPC_CPU_COMPARE
+	//! Use CPU comparisons (comment that line to use standard FPU compares). Only a win for x87 code.
+//	#define OPC_CPU_COMPARE
 
-	//! Use FCOMI / FCMOV on Pentium-Pro based processors (comment that line to use plain C++)
-	#define OPC_USE_FCOMI
+	//! Use FCOMI / FCMOV on Pentium-Pro based processors (comment that line to use plain C++). x87 inline assembly, 32-bit MSVC only.
+//	#define OPC_USE_FCOMI
+
+	//! Use SSE2 overlap tests when the compiler targets SSE2 (comment that line to use the portable scalar tests)
+	#define OPC_USE_SIMD
 
 	//! Use epsilon value in tri-tri overlap test
 	#define OPC_TRITRI_EPSILON_TEST
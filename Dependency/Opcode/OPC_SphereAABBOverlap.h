@@ -1,49 +1,34 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Sphere-AABB overlap test, based on Jim Arvo's code.
- *	\param		center		[in] box center
- *	\param		extents		[in] box extents
+ *	\param		sphere_center	[in] sphere center
+ *	\param		radius2			[in] sphere radius squared
+ *	\param		center			[in] box center
+ *	\param		extents			[in] box extents
  *	\return		TRUE on overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL SphereCollider::SphereAABBOverlap(const Point& center, const Point& extents)
-{ 
-	// Stats
-	mNbVolumeBVTests++;
-
+inline_ BOOL SphereAABBTest(const Point& sphere_center, float radius2, const Point& center, const Point& extents)
+{
+#ifdef OPC_SIMD_SSE2
+	// Distance from the sphere center to the box along each axis, i.e. max(|tmp| - extents, 0)
+	const __m128 Tmp = _mm_sub_ps(SIMD_LoadPoint(sphere_center), SIMD_LoadPoint(center));
+	const __m128 S = _mm_max_ps(_mm_sub_ps(SIMD_Abs(Tmp), SIMD_LoadPoint(extents)), _mm_setzero_ps());
+	return SIMD_Dot(S, S) <= radius2;
+#else
 	float d = 0.0f;
 
 	//find the square of the distance
 	//from the sphere to the box
-#ifdef OLDIES
-	for(udword i=0;i<3;i++)
-	{
-		float tmp = mCenter[i] - center[i];
-		float s = tmp + extents[i];
-
-		if(s<0.0f)	d += s*s;
-		else
-		{
-			s = tmp - extents[i];
-			if(s>0.0f)	d += s*s;
-		}
-	}
-#endif
-
-//#ifdef NEW_TEST
-
-//	float tmp = mCenter.x - center.x;
-//	float s = tmp + extents.x;
-
 	float tmp,s;
 
-	tmp = mCenter.x - center.x;
+	tmp = sphere_center.x - center.x;
 	s = tmp + extents.x;
 
 	if(s<0.0f)
 	{
 		d += s*s;
-		if(d>mRadius2)	return FALSE;
+		if(d>radius2)	return FALSE;
 	}
 	else
 	{
@@ -51,17 +36,17 @@ inline_ BOOL SphereCollider::SphereAABBOverlap(const Point& center, const Point&
 		if(s>0.0f)
 		{
 			d += s*s;
-			if(d>mRadius2)	return FALSE;
+			if(d>radius2)	return FALSE;
 		}
 	}
 
-	tmp = mCenter.y - center.y;
+	tmp = sphere_center.y - center.y;
 	s = tmp + extents.y;
 
 	if(s<0.0f)
 	{
 		d += s*s;
-		if(d>mRadius2)	return FALSE;
+		if(d>radius2)	return FALSE;
 	}
 	else
 	{
@@ -69,17 +54,17 @@ inline_ BOOL SphereCollider::SphereAABBOverlap(const Point& center, const Point&
 		if(s>0.0f)
 		{
 			d += s*s;
-			if(d>mRadius2)	return FALSE;
+			if(d>radius2)	return FALSE;
 		}
 	}
 
-	tmp = mCenter.z - center.z;
+	tmp = sphere_center.z - center.z;
 	s = tmp + extents.z;
 
 	if(s<0.0f)
 	{
 		d += s*s;
-		if(d>mRadius2)	return FALSE;
+		if(d>radius2)	return FALSE;
 	}
 	else
 	{
@@ -87,42 +72,25 @@ inline_ BOOL SphereCollider::SphereAABBOverlap(const Point& center, const Point&
 		if(s>0.0f)
 		{
 			d += s*s;
-			if(d>mRadius2)	return FALSE;
+			if(d>radius2)	return FALSE;
 		}
 	}
-//#endif
-
-#ifdef OLDIES
-//	Point Min = center - extents;
-//	Point Max = center + extents;
-
-	float d = 0.0f;
-
-	//find the square of the distance
-	//from the sphere to the box
-	for(udword i=0;i<3;i++)
-	{
-float Min = center[i] - extents[i];
+	return d <= radius2;
+#endif
+}
 
-//		if(mCenter[i]<Min[i])
-		if(mCenter[i]<Min)
-		{
-//			float s = mCenter[i] - Min[i];
-			float s = mCenter[i] - Min;
-			d += s*s;
-		}
-		else
-		{
-float Max = center[i] + extents[i];
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Sphere-AABB overlap test. Sphere is cached within the class.
+ *	\param		center		[in] box center
+ *	\param		extents		[in] box extents
+ *	\return		TRUE on overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL SphereCollider::SphereAABBOverlap(const Point& center, const Point& extents)
+{
+	// Stats
+	mNbVolumeBVTests++;
 
-//			if(mCenter[i]>Max[i])
-			if(mCenter[i]>Max)
-			{
-				float s = mCenter[i] - Max;
-				d += s*s;
-			}
-		}
-	}
-#endif
-	return d <= mRadius2;
+	return SphereAABBTest(mCenter, mRadius2, center, extents);
 }
@@ -47,7 +47,7 @@ using namespace Opcode;
 //! Sphere-triangle overlap test
 #define SPHERE_PRIM(prim_index, flag)									\
 	/* Request vertices from the app */									\
-	VertexPointers VP;	mIMesh->GetTriangle(VP, prim_index);			\
+	VertexPointers VP;	ConversionArea VC;	mIMesh->GetTriangle(VP, prim_index, VC);			\
 																		\
 	/* Perform sphere-tri overlap test */								\
 	if(SphereTriOverlap(*VP.Vertex[0], *VP.Vertex[1], *VP.Vertex[2]))	\
@@ -95,6 +95,7 @@ bool SphereCollider::Collide(SphereCache& cache, const Sphere& sphere, const Mod
 {
 	// Checkings
 	if(!Setup(&model))	return false;
+	if(model.IsWide())	return SetIceError("OPCODE WARNING: wide trees are not supported by this collider.\n", null);
 
 	// Init collision query
 	if(InitQuery(cache, sphere, worlds, worldm))	return true;
@@ -20,6 +20,10 @@
  *	Contains an AABB tree collider.
  *	This class performs a collision test between two AABB trees.
  *
+ *	Large queries can run on several threads (see SetNbThreads()). The top of the recursion is unrolled into a list
+ *	of tasks, i.e. pairs of nodes (or leaf-node pairs) listed in the same order as the serial recursion visits them.
+ *	Tasks are fetched dynamically by the threads, each task writes its own pairs, and pairs are merged in task order.
+ *
  *	\class		AABBTreeCollider
  *	\author		Pierre Terdiman
  *	\version	1.3
@@ -37,6 +41,86 @@ using namespace Opcode;
 #include "OPC_TriBoxOverlap.h"
 #include "OPC_TriTriOverlap.h"
 
+#define TC_PARALLEL_THRESHOLD	8192	//!< Default min number of triangles for parallel queries
+#define TC_TASKS_PER_THREAD		16		//!< Number of tasks per thread, for load balancing
+#define TC_MAX_SPLIT_PASSES		24		//!< Max number of passes when splitting a query into tasks
+
+//! Kinds of trees, for parallel queries
+enum TC_TreeType
+{
+	TC_NORMAL,
+	TC_NO_LEAF,
+	TC_QUANTIZED,
+	TC_QUANTIZED_NO_LEAF
+};
+
+//! Kinds of tasks
+enum TC_TaskType
+{
+	TC_COLLIDE,			//!< Node-node recursion, i.e. _Collide(node0, node1)
+	TC_PRIM_PRIM,		//!< Leaf-leaf test, i.e. PrimTest(prim0, prim1)
+	TC_TRI_INDEX,		//!< No-leaf trees: triangle from A against a leaf from B
+	TC_TRI_BOX,			//!< No-leaf trees: triangle from A against a node from B
+	TC_BOX_TRI			//!< No-leaf trees: node from A against a triangle from B
+};
+
+//! A part of a parallel query
+struct Opcode::TC_Task
+{
+	udword			mType;		//!< TC_TaskType
+	const void*		mNode0;		//!< Node from first tree
+	const void*		mNode1;		//!< Node from second tree
+	udword			mPrim0;		//!< Primitive from first tree
+	udword			mPrim1;		//!< Primitive from second tree
+	// Dequantized boxes, for quantized trees
+	Point			mExtents0;
+	Point			mCenter0;
+	Point			mExtents1;
+	Point			mCenter1;
+};
+
+//! Results of a task
+struct TC_Result
+{
+	Container		mPairs;
+	udword			mNbBVBVTests;
+	udword			mNbPrimPrimTests;
+	udword			mNbBVPrimTests;
+	BOOL			mContact;
+};
+
+//! Parallel query data
+struct Opcode::TC_Job
+{
+	TC_Task			mTasks[2][TC_MAX_TASKS];	//!< Task lists, for the split passes
+	TC_Result		mResults[TC_MAX_TASKS];		//!< One result per task
+	const TC_Task*	mCurrent;					//!< Final task list
+	udword			mNbTasks;					//!< Number of tasks in final list
+	udword			mTreeType;					//!< TC_TreeType
+	AABBTreeCollider* mCollider;				//!< Collider running the query
+	volatile udword	mContact;					//!< Shared "first contact found" flag
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Sets up a task.
+ *	\param		task	[out] task
+ *	\param		type	[in] TC_TaskType
+ *	\param		node0	[in] node from first tree
+ *	\param		node1	[in] node from second tree
+ *	\param		prim0	[in] primitive from first tree
+ *	\param		prim1	[in] primitive from second tree
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ void _SetTask(TC_Task& task, udword type, const void* node0, const void* node1, udword prim0, udword prim1)
+{
+	task.mType	= type;
+	task.mNode0	= node0;
+	task.mNode1	= node1;
+	task.mPrim0	= prim0;
+	task.mPrim1	= prim1;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Constructor.
@@ -49,7 +133,11 @@ AABBTreeCollider::AABBTreeCollider() :
 	mFullBoxBoxTest		(true),
 	mFullPrimBoxTest	(true),
 	mIMesh0				(null),
-	mIMesh1				(null)
+	mIMesh1				(null),
+	mNbThreads			(1),
+	mParallelThreshold	(TC_PARALLEL_THRESHOLD),
+	mJob				(null),
+	mSharedContact		(null)
 {
 }
 
@@ -60,6 +148,7 @@ AABBTreeCollider::AABBTreeCollider() :
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 AABBTreeCollider::~AABBTreeCollider()
 {
+	DELETESINGLE(mJob);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -92,6 +181,7 @@ bool AABBTreeCollider::Collide(BVTCache& cache, const Matrix4x4* world0, const M
 {
 	// Checkings
 	if(!cache.Model0 || !cache.Model1)								return false;
+	if(cache.Model0->IsWide() || cache.Model1->IsWide())			return false;
 	if(cache.Model0->HasLeafNodes()!=cache.Model1->HasLeafNodes())	return false;
 	if(cache.Model0->IsQuantized()!=cache.Model1->IsQuantized())	return false;
 
@@ -255,15 +345,8 @@ void AABBTreeCollider::InitQuery(const Matrix4x4* world0, const Matrix4x4* world
 	mR0to1 = World0to1;		World0to1.GetTrans(mT0to1);
 	mR1to0 = World1to0;		World1to0.GetTrans(mT1to0);
 
-	// Precompute absolute 1-to-0 rotation matrix
-	for(udword i=0;i<3;i++)
-	{
-		for(udword j=0;j<3;j++)
-		{
-			// Epsilon value prevents floating-point inaccuracies (strategy borrowed from RAPID)
-			mAR.m[i][j] = 1e-6f + fabsf(mR1to0.m[i][j]);
-		}
-	}
+	// Precompute box-box data, including the absolute 1-to-0 rotation matrix
+	mBoxBoxData.Init(mR1to0, mT1to0);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -316,7 +399,7 @@ bool AABBTreeCollider::Collide(const AABBCollisionTree* tree0, const AABBCollisi
 	if(CheckTemporalCoherence(cache))		return true;
 
 	// Perform collision query
-	_Collide(tree0->GetNodes(), tree1->GetNodes());
+	if(!_CollideParallel(TC_NORMAL, tree0->GetNodes(), tree1->GetNodes()))	_Collide(tree0->GetNodes(), tree1->GetNodes());
 
 	UPDATE_CACHE
 
@@ -344,7 +427,7 @@ bool AABBTreeCollider::Collide(const AABBNoLeafTree* tree0, const AABBNoLeafTree
 	if(CheckTemporalCoherence(cache))		return true;
 
 	// Perform collision query
-	_Collide(tree0->GetNodes(), tree1->GetNodes());
+	if(!_CollideParallel(TC_NO_LEAF, tree0->GetNodes(), tree1->GetNodes()))	_Collide(tree0->GetNodes(), tree1->GetNodes());
 
 	UPDATE_CACHE
 
@@ -387,7 +470,7 @@ bool AABBTreeCollider::Collide(const AABBQuantizedTree* tree0, const AABBQuantiz
 	const Point Pb(float(N1->mAABB.mCenter[0]) * mCenterCoeff1.x, float(N1->mAABB.mCenter[1]) * mCenterCoeff1.y, float(N1->mAABB.mCenter[2]) * mCenterCoeff1.z);
 
 	// Perform collision query
-	_Collide(N0, N1, a, Pa, b, Pb);
+	if(!_CollideParallel(TC_QUANTIZED, N0, N1))	_Collide(N0, N1, a, Pa, b, Pb);
 
 	UPDATE_CACHE
 
@@ -421,7 +504,7 @@ bool AABBTreeCollider::Collide(const AABBQuantizedNoLeafTree* tree0, const AABBQ
 	mExtentsCoeff1	= tree1->mExtentsCoeff;
 
 	// Perform collision query
-	_Collide(tree0->GetNodes(), tree1->GetNodes());
+	if(!_CollideParallel(TC_QUANTIZED_NO_LEAF, tree0->GetNodes(), tree1->GetNodes()))	_Collide(tree0->GetNodes(), tree1->GetNodes());
 
 	UPDATE_CACHE
 
@@ -454,13 +537,13 @@ void AABBTreeCollider::_Collide(const AABBCollisionNode* b0, const AABBCollision
 	if(b1->IsLeaf() || (!b0->IsLeaf() && (b0->GetSize() > b1->GetSize())))
 	{
 		_Collide(b0->GetNeg(), b1);
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 		_Collide(b0->GetPos(), b1);
 	}
 	else
 	{
 		_Collide(b0, b1->GetNeg());
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 		_Collide(b0, b1->GetPos());
 	}
 }
@@ -491,24 +574,24 @@ void AABBTreeCollider::_Collide(const AABBCollisionNode* b0, const AABBCollision
 		else
 		{
 			_Collide(b0, b1->GetNeg());
-			if(ContactFound()) return;
+			if(StopQuery()) return;
 			_Collide(b0, b1->GetPos());
 		}
 	}
 	else if(b1->IsLeaf())
 	{
 		_Collide(b0->GetNeg(), b1);
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 		_Collide(b0->GetPos(), b1);
 	}
 	else
 	{
 		_Collide(b0->GetNeg(), b1->GetNeg());
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 		_Collide(b0->GetNeg(), b1->GetPos());
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 		_Collide(b0->GetPos(), b1->GetNeg());
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 		_Collide(b0->GetPos(), b1->GetPos());
 	}
 }
@@ -530,8 +613,10 @@ void AABBTreeCollider::PrimTest(udword id0, udword id1)
 	// Request vertices from the app
 	VertexPointers VP0;
 	VertexPointers VP1;
-	mIMesh0->GetTriangle(VP0, id0);
-	mIMesh1->GetTriangle(VP1, id1);
+	ConversionArea VC0;
+	ConversionArea VC1;
+	mIMesh0->GetTriangle(VP0, id0, VC0);
+	mIMesh1->GetTriangle(VP1, id1, VC1);
 
 	// Transform from space 1 to space 0
 	Point u0,u1,u2;
@@ -559,7 +644,8 @@ inline_ void AABBTreeCollider::PrimTestTriIndex(udword id1)
 {
 	// Request vertices from the app
 	VertexPointers VP;
-	mIMesh1->GetTriangle(VP, id1);
+	ConversionArea VC;
+	mIMesh1->GetTriangle(VP, id1, VC);
 
 	// Perform triangle-triangle overlap test
 	if(TriTriOverlap(mLeafVerts[0], mLeafVerts[1], mLeafVerts[2], *VP.Vertex[0], *VP.Vertex[1], *VP.Vertex[2]))
@@ -581,7 +667,8 @@ inline_ void AABBTreeCollider::PrimTestIndexTri(udword id0)
 {
 	// Request vertices from the app
 	VertexPointers VP;
-	mIMesh0->GetTriangle(VP, id0);
+	ConversionArea VC;
+	mIMesh0->GetTriangle(VP, id0, VC);
 
 	// Perform triangle-triangle overlap test
 	if(TriTriOverlap(mLeafVerts[0], mLeafVerts[1], mLeafVerts[2], *VP.Vertex[0], *VP.Vertex[1], *VP.Vertex[2]))
@@ -608,7 +695,7 @@ void AABBTreeCollider::_CollideTriBox(const AABBNoLeafNode* b)
 	if(b->HasPosLeaf())	PrimTestTriIndex(b->GetPosPrimitive());
 	else				_CollideTriBox(b->GetPos());
 
-	if(ContactFound()) return;
+	if(StopQuery()) return;
 
 	// Keep same triangle, deal with second child
 	if(b->HasNegLeaf())	PrimTestTriIndex(b->GetNegPrimitive());
@@ -630,7 +717,7 @@ void AABBTreeCollider::_CollideBoxTri(const AABBNoLeafNode* b)
 	if(b->HasPosLeaf())	PrimTestIndexTri(b->GetPosPrimitive());
 	else				_CollideBoxTri(b->GetPos());
 
-	if(ContactFound()) return;
+	if(StopQuery()) return;
 
 	// Keep same triangle, deal with second child
 	if(b->HasNegLeaf())	PrimTestIndexTri(b->GetNegPrimitive());
@@ -641,7 +728,7 @@ void AABBTreeCollider::_CollideBoxTri(const AABBNoLeafNode* b)
 #define FETCH_LEAF(prim_index, imesh, rot, trans)				\
 	mLeafIndex = prim_index;									\
 	/* Request vertices from the app */							\
-	VertexPointers VP;	imesh->GetTriangle(VP, prim_index);		\
+	VertexPointers VP;	ConversionArea VC;	imesh->GetTriangle(VP, prim_index, VC);		\
 	/* Transform them in a common space */						\
 	TransformPoint(mLeafVerts[0], *VP.Vertex[0], rot, trans);	\
 	TransformPoint(mLeafVerts[1], *VP.Vertex[1], rot, trans);	\
@@ -670,7 +757,7 @@ void AABBTreeCollider::_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b
 		if(BHasPosLeaf)	PrimTestTriIndex(b->GetPosPrimitive());
 		else			_CollideTriBox(b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)	PrimTestTriIndex(b->GetNegPrimitive());
 		else			_CollideTriBox(b->GetNeg());
@@ -685,7 +772,7 @@ void AABBTreeCollider::_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b
 		}
 		else _Collide(a->GetPos(), b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)
 		{
@@ -696,7 +783,7 @@ void AABBTreeCollider::_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b
 		else _Collide(a->GetPos(), b->GetNeg());
 	}
 
-	if(ContactFound()) return;
+	if(StopQuery()) return;
 
 	if(a->HasNegLeaf())
 	{
@@ -705,7 +792,7 @@ void AABBTreeCollider::_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b
 		if(BHasPosLeaf)	PrimTestTriIndex(b->GetPosPrimitive());
 		else			_CollideTriBox(b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)	PrimTestTriIndex(b->GetNegPrimitive());
 		else			_CollideTriBox(b->GetNeg());
@@ -721,7 +808,7 @@ void AABBTreeCollider::_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b
 		}
 		else _Collide(a->GetNeg(), b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)
 		{
@@ -764,7 +851,7 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNode* b0, const AABBQuantized
 		const Point nega(float(Box->mExtents[0]) * mExtentsCoeff0.x, float(Box->mExtents[1]) * mExtentsCoeff0.y, float(Box->mExtents[2]) * mExtentsCoeff0.z);
 		_Collide(b0->GetNeg(), b1, nega, negPa, b, Pb);
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		// Dequantize box
 		Box = &b0->GetPos()->mAABB;
@@ -780,7 +867,7 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNode* b0, const AABBQuantized
 		const Point negb(float(Box->mExtents[0]) * mExtentsCoeff1.x, float(Box->mExtents[1]) * mExtentsCoeff1.y, float(Box->mExtents[2]) * mExtentsCoeff1.z);
 		_Collide(b0, b1->GetNeg(), a, Pa, negb, negPb);
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		// Dequantize box
 		Box = &b1->GetPos()->mAABB;
@@ -814,7 +901,7 @@ void AABBTreeCollider::_CollideTriBox(const AABBQuantizedNoLeafNode* b)
 	if(b->HasPosLeaf())	PrimTestTriIndex(b->GetPosPrimitive());
 	else				_CollideTriBox(b->GetPos());
 
-	if(ContactFound()) return;
+	if(StopQuery()) return;
 
 	if(b->HasNegLeaf())	PrimTestTriIndex(b->GetNegPrimitive());
 	else				_CollideTriBox(b->GetNeg());
@@ -840,7 +927,7 @@ void AABBTreeCollider::_CollideBoxTri(const AABBQuantizedNoLeafNode* b)
 	if(b->HasPosLeaf())	PrimTestIndexTri(b->GetPosPrimitive());
 	else				_CollideBoxTri(b->GetPos());
 
-	if(ContactFound()) return;
+	if(StopQuery()) return;
 
 	if(b->HasNegLeaf())	PrimTestIndexTri(b->GetNegPrimitive());
 	else				_CollideBoxTri(b->GetNeg());
@@ -878,7 +965,7 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNoLeafNode* a, const AABBQuan
 		if(BHasPosLeaf)	PrimTestTriIndex(b->GetPosPrimitive());
 		else			_CollideTriBox(b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)	PrimTestTriIndex(b->GetNegPrimitive());
 		else			_CollideTriBox(b->GetNeg());
@@ -893,7 +980,7 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNoLeafNode* a, const AABBQuan
 		}
 		else _Collide(a->GetPos(), b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)
 		{
@@ -904,7 +991,7 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNoLeafNode* a, const AABBQuan
 		else _Collide(a->GetPos(), b->GetNeg());
 	}
 
-	if(ContactFound()) return;
+	if(StopQuery()) return;
 
 	if(a->HasNegLeaf())
 	{
@@ -913,7 +1000,7 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNoLeafNode* a, const AABBQuan
 		if(BHasPosLeaf)	PrimTestTriIndex(b->GetPosPrimitive());
 		else			_CollideTriBox(b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)	PrimTestTriIndex(b->GetNegPrimitive());
 		else			_CollideTriBox(b->GetNeg());
@@ -929,7 +1016,7 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNoLeafNode* a, const AABBQuan
 		}
 		else _Collide(a->GetNeg(), b->GetPos());
 
-		if(ContactFound()) return;
+		if(StopQuery()) return;
 
 		if(BHasNegLeaf)
 		{
@@ -941,3 +1028,351 @@ void AABBTreeCollider::_Collide(const AABBQuantizedNoLeafNode* a, const AABBQuan
 		else _Collide(a->GetNeg(), b->GetNeg());
 	}
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parallel queries
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Dequantizes a box.
+ *	\param		extents			[out] box extents
+ *	\param		center			[out] box center
+ *	\param		box				[in] quantized box
+ *	\param		extents_coeff	[in] dequantization coeffs for extents
+ *	\param		center_coeff	[in] dequantization coeffs for center
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ void _Dequantize(Point& extents, Point& center, const QuantizedAABB& box, const Point& extents_coeff, const Point& center_coeff)
+{
+	center = Point(float(box.mCenter[0]) * center_coeff.x, float(box.mCenter[1]) * center_coeff.y, float(box.mCenter[2]) * center_coeff.z);
+	extents = Point(float(box.mExtents[0]) * extents_coeff.x, float(box.mExtents[1]) * extents_coeff.y, float(box.mExtents[2]) * extents_coeff.z);
+}
+
+//! Splits half of a no-leaf node-node recursion (see _Collide() for no-leaf trees) into tasks
+#define SPLIT_NO_LEAF_HALF(a, b, has_leaf, get_prim, get_node)																\
+	if(a->has_leaf())																										\
+	{																														\
+		if(b->HasPosLeaf())	_SetTask(dest[nb_tasks++], TC_TRI_INDEX, null, null, a->get_prim(), b->GetPosPrimitive());		\
+		else				_SetTask(dest[nb_tasks++], TC_TRI_BOX, null, b->GetPos(), a->get_prim(), 0);					\
+		if(b->HasNegLeaf())	_SetTask(dest[nb_tasks++], TC_TRI_INDEX, null, null, a->get_prim(), b->GetNegPrimitive());		\
+		else				_SetTask(dest[nb_tasks++], TC_TRI_BOX, null, b->GetNeg(), a->get_prim(), 0);					\
+	}																														\
+	else																													\
+	{																														\
+		if(b->HasPosLeaf())	_SetTask(dest[nb_tasks++], TC_BOX_TRI, a->get_node(), null, 0, b->GetPosPrimitive());			\
+		else				_SetTask(dest[nb_tasks++], TC_COLLIDE, a->get_node(), b->GetPos(), 0, 0);						\
+		if(b->HasNegLeaf())	_SetTask(dest[nb_tasks++], TC_BOX_TRI, a->get_node(), null, 0, b->GetNegPrimitive());			\
+		else				_SetTask(dest[nb_tasks++], TC_COLLIDE, a->get_node(), b->GetNeg(), 0, 0);						\
+	}
+
+//! Splits a no-leaf node-node recursion into tasks
+#define SPLIT_NO_LEAF(a, b)																									\
+	SPLIT_NO_LEAF_HALF(a, b, HasPosLeaf, GetPosPrimitive, GetPos)															\
+	SPLIT_NO_LEAF_HALF(a, b, HasNegLeaf, GetNegPrimitive, GetNeg)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Splits a node-node task into the tasks the serial recursion would perform next, in the same order.
+ *	The BV-BV test of the task is performed here.
+ *	\param		tree_type	[in] TC_TreeType
+ *	\param		task		[in] TC_COLLIDE task
+ *	\param		dest		[out] new tasks (room for 4 tasks)
+ *	\param		nb_tasks	[in/out] number of tasks in dest
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABBTreeCollider::_SplitTask(udword tree_type, const TC_Task& task, TC_Task* dest, udword& nb_tasks)
+{
+	if(tree_type==TC_NORMAL)
+	{
+		const AABBCollisionNode* b0 = (const AABBCollisionNode*)task.mNode0;
+		const AABBCollisionNode* b1 = (const AABBCollisionNode*)task.mNode1;
+
+		// Perform BV-BV overlap test
+		if(!BoxBoxOverlap(b0->mAABB.mExtents, b0->mAABB.mCenter, b1->mAABB.mExtents, b1->mAABB.mCenter))	return;
+
+		if(b0->IsLeaf() && b1->IsLeaf())
+		{
+			_SetTask(dest[nb_tasks++], TC_PRIM_PRIM, null, null, b0->GetPrimitive(), b1->GetPrimitive());
+			return;
+		}
+#ifdef ORIGINAL_CODE
+		if(b1->IsLeaf() || (!b0->IsLeaf() && (b0->GetSize() > b1->GetSize())))
+		{
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetNeg(), b1, 0, 0);
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetPos(), b1, 0, 0);
+		}
+		else
+		{
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0, b1->GetNeg(), 0, 0);
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0, b1->GetPos(), 0, 0);
+		}
+#else
+		if(b0->IsLeaf())
+		{
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0, b1->GetNeg(), 0, 0);
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0, b1->GetPos(), 0, 0);
+		}
+		else if(b1->IsLeaf())
+		{
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetNeg(), b1, 0, 0);
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetPos(), b1, 0, 0);
+		}
+		else
+		{
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetNeg(), b1->GetNeg(), 0, 0);
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetNeg(), b1->GetPos(), 0, 0);
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetPos(), b1->GetNeg(), 0, 0);
+			_SetTask(dest[nb_tasks++], TC_COLLIDE, b0->GetPos(), b1->GetPos(), 0, 0);
+		}
+#endif
+	}
+	else if(tree_type==TC_QUANTIZED)
+	{
+		const AABBQuantizedNode* b0 = (const AABBQuantizedNode*)task.mNode0;
+		const AABBQuantizedNode* b1 = (const AABBQuantizedNode*)task.mNode1;
+
+		// Perform BV-BV overlap test
+		if(!BoxBoxOverlap(task.mExtents0, task.mCenter0, task.mExtents1, task.mCenter1))	return;
+
+		if(b0->IsLeaf() && b1->IsLeaf())
+		{
+			_SetTask(dest[nb_tasks++], TC_PRIM_PRIM, null, null, b0->GetPrimitive(), b1->GetPrimitive());
+			return;
+		}
+
+		// Children inherit the box of the node which isn't split
+		TC_Task& Neg = dest[nb_tasks++];
+		TC_Task& Pos = dest[nb_tasks++];
+		Neg = task;
+		Pos = task;
+		if(b1->IsLeaf() || (!b0->IsLeaf() && (b0->GetSize() > b1->GetSize())))
+		{
+			Neg.mNode0 = b0->GetNeg();	_Dequantize(Neg.mExtents0, Neg.mCenter0, b0->GetNeg()->mAABB, mExtentsCoeff0, mCenterCoeff0);
+			Pos.mNode0 = b0->GetPos();	_Dequantize(Pos.mExtents0, Pos.mCenter0, b0->GetPos()->mAABB, mExtentsCoeff0, mCenterCoeff0);
+		}
+		else
+		{
+			Neg.mNode1 = b1->GetNeg();	_Dequantize(Neg.mExtents1, Neg.mCenter1, b1->GetNeg()->mAABB, mExtentsCoeff1, mCenterCoeff1);
+			Pos.mNode1 = b1->GetPos();	_Dequantize(Pos.mExtents1, Pos.mCenter1, b1->GetPos()->mAABB, mExtentsCoeff1, mCenterCoeff1);
+		}
+	}
+	else if(tree_type==TC_NO_LEAF)
+	{
+		const AABBNoLeafNode* a = (const AABBNoLeafNode*)task.mNode0;
+		const AABBNoLeafNode* b = (const AABBNoLeafNode*)task.mNode1;
+
+		// Perform BV-BV overlap test
+		if(!BoxBoxOverlap(a->mAABB.mExtents, a->mAABB.mCenter, b->mAABB.mExtents, b->mAABB.mCenter))	return;
+
+		SPLIT_NO_LEAF(a, b)
+	}
+	else
+	{
+		const AABBQuantizedNoLeafNode* a = (const AABBQuantizedNoLeafNode*)task.mNode0;
+		const AABBQuantizedNoLeafNode* b = (const AABBQuantizedNoLeafNode*)task.mNode1;
+
+		// Dequantize boxes
+		Point ea, Pa, eb, Pb;
+		_Dequantize(ea, Pa, a->mAABB, mExtentsCoeff0, mCenterCoeff0);
+		_Dequantize(eb, Pb, b->mAABB, mExtentsCoeff1, mCenterCoeff1);
+
+		// Perform BV-BV overlap test
+		if(!BoxBoxOverlap(ea, Pa, eb, Pb))	return;
+
+		SPLIT_NO_LEAF(a, b)
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Runs a task, i.e. performs the same work as the serial recursion for that part of the query.
+ *	\param		tree_type	[in] TC_TreeType
+ *	\param		task		[in] task
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABBTreeCollider::_RunTask(udword tree_type, const TC_Task& task)
+{
+	switch(task.mType)
+	{
+		case TC_COLLIDE:
+		{
+			if(tree_type==TC_NORMAL)			_Collide((const AABBCollisionNode*)task.mNode0, (const AABBCollisionNode*)task.mNode1);
+			else if(tree_type==TC_QUANTIZED)	_Collide((const AABBQuantizedNode*)task.mNode0, (const AABBQuantizedNode*)task.mNode1, task.mExtents0, task.mCenter0, task.mExtents1, task.mCenter1);
+			else if(tree_type==TC_NO_LEAF)		_Collide((const AABBNoLeafNode*)task.mNode0, (const AABBNoLeafNode*)task.mNode1);
+			else								_Collide((const AABBQuantizedNoLeafNode*)task.mNode0, (const AABBQuantizedNoLeafNode*)task.mNode1);
+		}
+		break;
+
+		case TC_PRIM_PRIM:
+		{
+			PrimTest(task.mPrim0, task.mPrim1);
+		}
+		break;
+
+		case TC_TRI_INDEX:
+		{
+			FETCH_LEAF(task.mPrim0, mIMesh0, mR0to1, mT0to1)
+
+			PrimTestTriIndex(task.mPrim1);
+		}
+		break;
+
+		case TC_TRI_BOX:
+		{
+			FETCH_LEAF(task.mPrim0, mIMesh0, mR0to1, mT0to1)
+
+			if(tree_type==TC_NO_LEAF)	_CollideTriBox((const AABBNoLeafNode*)task.mNode1);
+			else						_CollideTriBox((const AABBQuantizedNoLeafNode*)task.mNode1);
+		}
+		break;
+
+		case TC_BOX_TRI:
+		{
+			FETCH_LEAF(task.mPrim1, mIMesh1, mR1to0, mT1to0)
+
+			if(tree_type==TC_NO_LEAF)	_CollideBoxTri((const AABBNoLeafNode*)task.mNode0);
+			else						_CollideBoxTri((const AABBQuantizedNoLeafNode*)task.mNode0);
+		}
+		break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Parallel task callback: runs a task on a private collider, setup like the query's one.
+ *	\param		task_index	[in] task index
+ *	\param		user_data	[in] job data
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABBTreeCollider::_CollideTask(udword task_index, void* user_data)
+{
+	TC_Job& Job = *(TC_Job*)user_data;
+	const AABBTreeCollider& Owner = *Job.mCollider;
+
+	TC_Result& Result = Job.mResults[task_index];
+	Result.mPairs.Reset();
+	Result.mNbBVBVTests		= 0;
+	Result.mNbPrimPrimTests	= 0;
+	Result.mNbBVPrimTests	= 0;
+	Result.mContact			= FALSE;
+
+	// Skip the task if another thread already found the first contact
+	if(Job.mContact)	return;
+
+	AABBTreeCollider Worker;
+	Worker.mFlags			= Owner.mFlags & ~OPC_CONTACT;
+	Worker.mIMesh0			= Owner.mIMesh0;
+	Worker.mIMesh1			= Owner.mIMesh1;
+	Worker.mBoxBoxData		= Owner.mBoxBoxData;
+	Worker.mR0to1			= Owner.mR0to1;
+	Worker.mR1to0			= Owner.mR1to0;
+	Worker.mT0to1			= Owner.mT0to1;
+	Worker.mT1to0			= Owner.mT1to0;
+	Worker.mCenterCoeff0	= Owner.mCenterCoeff0;
+	Worker.mExtentsCoeff0	= Owner.mExtentsCoeff0;
+	Worker.mCenterCoeff1	= Owner.mCenterCoeff1;
+	Worker.mExtentsCoeff1	= Owner.mExtentsCoeff1;
+	Worker.mFullBoxBoxTest	= Owner.mFullBoxBoxTest;
+	Worker.mFullPrimBoxTest	= Owner.mFullPrimBoxTest;
+	Worker.mSharedContact	= &Job.mContact;
+
+	Worker._RunTask(Job.mTreeType, Job.mCurrent[task_index]);
+
+	// Let the other threads know as soon as possible
+	if(Worker.ContactFound())	Job.mContact = TRUE;
+
+	if(Worker.mPairs.GetNbEntries())	Result.mPairs.Add(Worker.mPairs.GetEntries(), Worker.mPairs.GetNbEntries());
+	Result.mNbBVBVTests		= Worker.mNbBVBVTests;
+	Result.mNbPrimPrimTests	= Worker.mNbPrimPrimTests;
+	Result.mNbBVPrimTests	= Worker.mNbBVPrimTests;
+	Result.mContact			= Worker.GetContactStatus();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Performs a collision query on several threads, if it's large enough. Else nothing is done, and the caller
+ *	runs the serial recursion.
+ *	\param		tree_type	[in] TC_TreeType
+ *	\param		node0		[in] root node from first tree
+ *	\param		node1		[in] root node from second tree
+ *	\return		true if the query has been performed
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBTreeCollider::_CollideParallel(udword tree_type, const void* node0, const void* node1)
+{
+	// Checkings
+	const udword NbThreads = mNbThreads ? mNbThreads : GetNbProcessors();
+	if(NbThreads<2)																	return false;
+	if(mIMesh0->GetNbTriangles() + mIMesh1->GetNbTriangles() < mParallelThreshold)	return false;
+
+	if(!mJob)
+	{
+		mJob = new TC_Job;
+		// Can't allocate: run the query serially
+		if(!mJob)	return false;
+	}
+	TC_Job& Job = *mJob;
+
+	// Root task
+	TC_Task* Tasks = Job.mTasks[0];
+	udword NbTasks = 1;
+	_SetTask(Tasks[0], TC_COLLIDE, node0, node1, 0, 0);
+	if(tree_type==TC_QUANTIZED)
+	{
+		_Dequantize(Tasks[0].mExtents0, Tasks[0].mCenter0, ((const AABBQuantizedNode*)node0)->mAABB, mExtentsCoeff0, mCenterCoeff0);
+		_Dequantize(Tasks[0].mExtents1, Tasks[0].mCenter1, ((const AABBQuantizedNode*)node1)->mAABB, mExtentsCoeff1, mCenterCoeff1);
+	}
+
+	// Split the query until there are enough tasks. Tasks are replaced with their children in place, so the list
+	// always follows the order of the serial recursion.
+	udword NbWanted = NbThreads * TC_TASKS_PER_THREAD;
+	if(NbWanted>TC_MAX_TASKS)	NbWanted = TC_MAX_TASKS;
+
+	for(udword Pass=0;Pass<TC_MAX_SPLIT_PASSES && NbTasks && NbTasks<NbWanted;Pass++)
+	{
+		TC_Task* Dest = Job.mTasks[(Pass+1)&1];
+		udword NbDest = 0;
+		bool Split = false;
+		for(udword i=0;i<NbTasks;i++)
+		{
+			// Keep the task as it is if it can't be split, or if there's no room left for its children
+			if(Tasks[i].mType!=TC_COLLIDE || NbDest+(NbTasks-i)+3>TC_MAX_TASKS)
+			{
+				Dest[NbDest++] = Tasks[i];
+			}
+			else
+			{
+				_SplitTask(tree_type, Tasks[i], Dest, NbDest);
+				Split = true;
+			}
+		}
+		Tasks	= Dest;
+		NbTasks	= NbDest;
+		if(!Split)	break;
+	}
+
+	// Run the tasks
+	Job.mCurrent	= Tasks;
+	Job.mNbTasks	= NbTasks;
+	Job.mTreeType	= tree_type;
+	Job.mCollider	= this;
+	Job.mContact	= FALSE;
+	RunParallel(NbTasks, _CollideTask, &Job, NbThreads);
+
+	// Merge results in task order. In "First contact" mode, only the first contact is kept.
+	for(udword i=0;i<NbTasks;i++)
+	{
+		const TC_Result& Result = Job.mResults[i];
+		mNbBVBVTests		+= Result.mNbBVBVTests;
+		mNbPrimPrimTests	+= Result.mNbPrimPrimTests;
+		mNbBVPrimTests		+= Result.mNbBVPrimTests;
+
+		if(Result.mContact && !ContactFound())
+		{
+			mPairs.Add(Result.mPairs.GetEntries(), Result.mPairs.GetNbEntries());
+			mFlags |= OPC_CONTACT;
+		}
+	}
+	return true;
+}
@@ -20,6 +20,11 @@
 #ifndef __OPC_TREECOLLIDER_H__
 #define __OPC_TREECOLLIDER_H__
 
+	#define TC_MAX_TASKS		256		//!< Max number of tasks per parallel query
+
+	struct TC_Task;
+	struct TC_Job;
+
 	//! This structure holds cached information used by the algorithm.
 	//! Two model pointers and two colliding primitives are cached. Model pointers are assigned
 	//! to their respective meshes, and the pair of colliding primitives is used for temporal
@@ -115,6 +120,26 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		inline_				void			SetFullPrimBoxTest(bool flag)			{ mFullPrimBoxTest		= flag;					}
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: number of threads used by a query. Large queries are split into pairs of subtrees, which are
+		 *	collided in parallel. Pairs are reported in the same order as with a serial query. In "First contact" mode,
+		 *	the query stops as soon as any thread finds a contact, so the reported pair may differ from the serial one.
+		 *	\param		nb_threads	[in] number of threads. 0 = one per processor, 1 = serial queries (default)
+		 *	\see		SetParallelThreshold(udword nb_triangles)
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_				void			SetNbThreads(udword nb_threads)			{ mNbThreads			= nb_threads;			}
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Settings: pairs of meshes with less triangles than that (in total) are always collided serially.
+		 *	\param		nb_triangles	[in] min number of triangles for parallel queries
+		 *	\see		SetNbThreads(udword nb_threads)
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_				void			SetParallelThreshold(udword nb_triangles)	{ mParallelThreshold	= nb_triangles;		}
+
 		// Stats
 
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -188,7 +213,7 @@
 							udword			mNbPrimPrimTests;	//!< Number of Primitive-Primitive tests
 							udword			mNbBVPrimTests;		//!< Number of BV-Primitive tests
 		// Precomputed data
-							Matrix3x3		mAR;				//!< Absolute rotation matrix
+							BoxBoxData		mBoxBoxData;		//!< Box-box data, for 1-to-0 boxes
 							Matrix3x3		mR0to1;				//!< Rotation from object0 to object1
 							Matrix3x3		mR1to0;				//!< Rotation from object1 to object0
 							Point			mT0to1;				//!< Translation from object0 to object1
@@ -204,6 +229,11 @@
 		// Settings
 							bool			mFullBoxBoxTest;	//!< Perform full BV-BV tests (true) or SAT-lite tests (false)
 							bool			mFullPrimBoxTest;	//!< Perform full Primitive-BV tests (true) or SAT-lite tests (false)
+		// Parallel queries
+							udword			mNbThreads;			//!< Number of threads. 0 = one per processor, 1 = serial queries
+							udword			mParallelThreshold;	//!< Min number of triangles for parallel queries
+							TC_Job*			mJob;				//!< Parallel query data, allocated on first use
+					volatile udword*		mSharedContact;		//!< Contact flag shared by the threads of a parallel query, or null
 		// Internal methods
 
 			// Standard AABB trees
@@ -218,6 +248,22 @@
 							void			_CollideTriBox(const AABBQuantizedNoLeafNode* b);
 							void			_CollideBoxTri(const AABBQuantizedNoLeafNode* b);
 							void			_Collide(const AABBQuantizedNoLeafNode* a, const AABBQuantizedNoLeafNode* b);
+			// Parallel queries
+							bool			_CollideParallel(udword tree_type, const void* node0, const void* node1);
+							void			_SplitTask(udword tree_type, const TC_Task& task, TC_Task* dest, udword& nb_tasks);
+							void			_RunTask(udword tree_type, const TC_Task& task);
+			static			void			_CollideTask(udword task_index, void* user_data);
+
+			//! Checks whether the query can stop, i.e. if a first contact has been found by this thread or by another thread of a parallel query
+			inline_			BOOL			StopQuery()	const
+											{
+												if(ContactFound())
+												{
+													if(mSharedContact)	*mSharedContact = TRUE;
+													return TRUE;
+												}
+												return mSharedContact && *mSharedContact;
+											}
 			// Overlap tests
 							void			PrimTest(udword id0, udword id1);
 			inline_			void			PrimTestTriIndex(udword id1);
@@ -93,7 +93,7 @@ inline_ BOOL planeBoxOverlap(const Point& normal, const float d, const Point& ma
 	AXISTEST_Y02(e1.z, e1.x, fez1, fex1);			\
 	AXISTEST_Z0(e1.y, e1.x, fey1, fex1);			\
 													\
-	const Point e2 = mLeafVerts[0] - mLeafVerts[2];	\
+	const Point e2 = verts[0] - verts[2];			\
 	const float fey2 = fabsf(e2.y);					\
 	const float fez2 = fabsf(e2.z);					\
 	AXISTEST_X2(e2.z, e2.y, fez2, fey2);			\
@@ -106,20 +106,19 @@ inline_ BOOL planeBoxOverlap(const Point& normal, const float d, const Point& ma
  *	Triangle-Box overlap test using the separating axis theorem.
  *	This is the code from Tomas Mller, a bit optimized:
  *	- with some more lazy evaluation (faster path on PC)
- *	- with a tiny bit of assembly
  *	- with "SAT-lite" applied if needed
  *	- and perhaps with some more minor modifs...
+ *	The SSE2 version tests each class of 3 axes at once.
  *
+ *	\param		verts		[in] triangle vertices
  *	\param		center		[in] box center
  *	\param		extents		[in] box extents
+ *	\param		full		[in] true to test the class III axes
  *	\return		true if triangle & box overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL AABBTreeCollider::TriBoxOverlap(const Point& center, const Point& extents)
+inline_ BOOL TriBoxTest(const Point* verts, const Point& center, const Point& extents, BOOL full)
 {
-	// Stats
-	mNbBVPrimTests++;
-
 	// use separating axis theorem to test overlap between triangle and box 
 	// need to test for overlap in these directions: 
 	// 1) the {x,y,z}-directions (actually, since we use the AABB of the triangle 
@@ -127,56 +126,86 @@ inline_ BOOL AABBTreeCollider::TriBoxOverlap(const Point& center, const Point& e
 	// 2) normal of the triangle 
 	// 3) crossproduct(edge from tri, {x,y,z}-directin) 
 	//    this gives 3x3=9 more tests 
+#ifdef OPC_SIMD_SSE2
+	// move everything so that the boxcenter is in (0,0,0) 
+	const __m128 C = SIMD_LoadPoint(center);
+	const __m128 E = SIMD_LoadPoint(extents);
+	const __m128 P0 = SIMD_LoadPoint(verts[0]);
+	const __m128 P2 = SIMD_LoadPoint(verts[2]);
+	const __m128 V0 = _mm_sub_ps(P0, C);
+	const __m128 V1 = _mm_sub_ps(SIMD_LoadPoint(verts[1]), C);
+	const __m128 V2 = _mm_sub_ps(P2, C);
+
+	// 1) Test overlap in the {x,y,z}-directions
+	if(SIMD_Separated(_mm_min_ps(_mm_min_ps(V0, V1), V2), _mm_max_ps(_mm_max_ps(V0, V1), V2), E))	return FALSE;
 
+	// 2) Test if the box intersects the plane of the triangle
+	const __m128 E0 = _mm_sub_ps(V1, V0);
+	const __m128 E1 = _mm_sub_ps(V2, V1);
+	const __m128 Normal = SIMD_Cross(E0, E1);
+	const float d = -SIMD_Dot(Normal, V0);
+	const __m128 Positive = _mm_cmpgt_ps(Normal, _mm_setzero_ps());
+	const __m128 NegE = SIMD_Neg(E);
+	if(SIMD_Dot(Normal, SIMD_Select(Positive, NegE, E))+d>0.0f)	return FALSE;
+	if(SIMD_Dot(Normal, SIMD_Select(Positive, E, NegE))+d<0.0f)	return FALSE;
+
+	// 3) "Class III" tests. Each edge is tested against the 3 axes at once, using the same vertices as the scalar
+	// version: the projections of an edge's vertices are only equal up to rounding errors.
+	if(full)
+	{
+		const __m128 LaneZ = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, 0));
+		const __m128 E2 = _mm_sub_ps(P0, P2);
+
+		__m128 Min = SIMD_Cross(V0, E0);
+		__m128 Max = SIMD_Cross(V2, E0);
+		Min = SIMD_Select(LaneZ, SIMD_Cross(V1, E0), Min);
+		__m128 A = SIMD_Abs(E0);
+		__m128 Rad = _mm_add_ps(_mm_mul_ps(SIMD_SHUFFLE(A, 2, 2, 1), SIMD_SHUFFLE(E, 1, 0, 0)), _mm_mul_ps(SIMD_SHUFFLE(A, 1, 0, 0), SIMD_SHUFFLE(E, 2, 2, 1)));
+		if(SIMD_Separated(_mm_min_ps(Min, Max), _mm_max_ps(Min, Max), Rad))	return FALSE;
+
+		Min = SIMD_Cross(V0, E1);
+		Max = SIMD_Select(LaneZ, SIMD_Cross(V1, E1), SIMD_Cross(V2, E1));
+		A = SIMD_Abs(E1);
+		Rad = _mm_add_ps(_mm_mul_ps(SIMD_SHUFFLE(A, 2, 2, 1), SIMD_SHUFFLE(E, 1, 0, 0)), _mm_mul_ps(SIMD_SHUFFLE(A, 1, 0, 0), SIMD_SHUFFLE(E, 2, 2, 1)));
+		if(SIMD_Separated(_mm_min_ps(Min, Max), _mm_max_ps(Min, Max), Rad))	return FALSE;
+
+		const __m128 C1 = SIMD_Cross(V1, E2);
+		Min = SIMD_Select(LaneZ, C1, SIMD_Cross(V0, E2));
+		Max = SIMD_Select(LaneZ, SIMD_Cross(V2, E2), C1);
+		A = SIMD_Abs(E2);
+		Rad = _mm_add_ps(_mm_mul_ps(SIMD_SHUFFLE(A, 2, 2, 1), SIMD_SHUFFLE(E, 1, 0, 0)), _mm_mul_ps(SIMD_SHUFFLE(A, 1, 0, 0), SIMD_SHUFFLE(E, 2, 2, 1)));
+		if(SIMD_Separated(_mm_min_ps(Min, Max), _mm_max_ps(Min, Max), Rad))	return FALSE;
+	}
+	return TRUE;
+#else
 	// move everything so that the boxcenter is in (0,0,0) 
 	Point v0, v1, v2;
-	v0.x = mLeafVerts[0].x - center.x;
-	v1.x = mLeafVerts[1].x - center.x;
-	v2.x = mLeafVerts[2].x - center.x;
+	v0.x = verts[0].x - center.x;
+	v1.x = verts[1].x - center.x;
+	v2.x = verts[2].x - center.x;
 
 	// First, test overlap in the {x,y,z}-directions
-#ifdef OPC_USE_FCOMI
-	// find min, max of the triangle in x-direction, and test for overlap in X
-	if(FCMin3(v0.x, v1.x, v2.x)>extents.x)	return FALSE;
-	if(FCMax3(v0.x, v1.x, v2.x)<-extents.x)	return FALSE;
-
-	// same for Y
-	v0.y = mLeafVerts[0].y - center.y;
-	v1.y = mLeafVerts[1].y - center.y;
-	v2.y = mLeafVerts[2].y - center.y;
-
-	if(FCMin3(v0.y, v1.y, v2.y)>extents.y)	return FALSE;
-	if(FCMax3(v0.y, v1.y, v2.y)<-extents.y)	return FALSE;
-
-	// same for Z
-	v0.z = mLeafVerts[0].z - center.z;
-	v1.z = mLeafVerts[1].z - center.z;
-	v2.z = mLeafVerts[2].z - center.z;
-
-	if(FCMin3(v0.z, v1.z, v2.z)>extents.z)	return FALSE;
-	if(FCMax3(v0.z, v1.z, v2.z)<-extents.z)	return FALSE;
-#else
 	float min,max;
 	// Find min, max of the triangle in x-direction, and test for overlap in X
 	FINDMINMAX(v0.x, v1.x, v2.x, min, max);
 	if(min>extents.x || max<-extents.x) return FALSE;
 
 	// Same for Y
-	v0.y = mLeafVerts[0].y - center.y;
-	v1.y = mLeafVerts[1].y - center.y;
-	v2.y = mLeafVerts[2].y - center.y;
+	v0.y = verts[0].y - center.y;
+	v1.y = verts[1].y - center.y;
+	v2.y = verts[2].y - center.y;
 
 	FINDMINMAX(v0.y, v1.y, v2.y, min, max);
 	if(min>extents.y || max<-extents.y) return FALSE;
 
 	// Same for Z
-	v0.z = mLeafVerts[0].z - center.z;
-	v1.z = mLeafVerts[1].z - center.z;
-	v2.z = mLeafVerts[2].z - center.z;
+	v0.z = verts[0].z - center.z;
+	v1.z = verts[1].z - center.z;
+	v2.z = verts[2].z - center.z;
 
 	FINDMINMAX(v0.z, v1.z, v2.z, min, max);
 	if(min>extents.z || max<-extents.z) return FALSE;
-#endif
+
 	// 2) Test if the box intersects the plane of the triangle
 	// compute plane equation of triangle: normal*x+d=0
 	// ### could be precomputed since we use the same leaf triangle several times
@@ -187,11 +216,28 @@ inline_ BOOL AABBTreeCollider::TriBoxOverlap(const Point& center, const Point& e
 	if(!planeBoxOverlap(normal, d, extents)) return FALSE;
 
 	// 3) "Class III" tests
-	if(mFullPrimBoxTest)
+	if(full)
 	{
 		IMPLEMENT_CLASS3_TESTS
 	}
 	return TRUE;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Triangle-Box overlap test, for the cached leaf triangle.
+ *	\param		center		[in] box center
+ *	\param		extents		[in] box extents
+ *	\return		true if triangle & box overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL AABBTreeCollider::TriBoxOverlap(const Point& center, const Point& extents)
+{
+	// Stats
+	mNbBVPrimTests++;
+
+	return TriBoxTest(mLeafVerts, center, extents, mFullPrimBoxTest);
 }
 
 //! A dedicated version where the box is constant
@@ -200,59 +246,8 @@ inline_ BOOL OBBCollider::TriBoxOverlap()
 	// Stats
 	mNbVolumePrimTests++;
 
-	// Hook
-	const Point& extents = mBoxExtents;
-	const Point& v0 = mLeafVerts[0];
-	const Point& v1 = mLeafVerts[1];
-	const Point& v2 = mLeafVerts[2];
-
-	// use separating axis theorem to test overlap between triangle and box 
-	// need to test for overlap in these directions: 
-	// 1) the {x,y,z}-directions (actually, since we use the AABB of the triangle 
-	//    we do not even need to test these) 
-	// 2) normal of the triangle 
-	// 3) crossproduct(edge from tri, {x,y,z}-directin) 
-	//    this gives 3x3=9 more tests 
-
-	// Box center is already in (0,0,0)
-
-	// First, test overlap in the {x,y,z}-directions
-#ifdef OPC_USE_FCOMI
-	// find min, max of the triangle in x-direction, and test for overlap in X
-	if(FCMin3(v0.x, v1.x, v2.x)>mBoxExtents.x)	return FALSE;
-	if(FCMax3(v0.x, v1.x, v2.x)<-mBoxExtents.x)	return FALSE;
-
-	if(FCMin3(v0.y, v1.y, v2.y)>mBoxExtents.y)	return FALSE;
-	if(FCMax3(v0.y, v1.y, v2.y)<-mBoxExtents.y)	return FALSE;
-
-	if(FCMin3(v0.z, v1.z, v2.z)>mBoxExtents.z)	return FALSE;
-	if(FCMax3(v0.z, v1.z, v2.z)<-mBoxExtents.z)	return FALSE;
-#else
-	float min,max;
-	// Find min, max of the triangle in x-direction, and test for overlap in X
-	FINDMINMAX(v0.x, v1.x, v2.x, min, max);
-	if(min>mBoxExtents.x || max<-mBoxExtents.x) return FALSE;
-
-	FINDMINMAX(v0.y, v1.y, v2.y, min, max);
-	if(min>mBoxExtents.y || max<-mBoxExtents.y) return FALSE;
-
-	FINDMINMAX(v0.z, v1.z, v2.z, min, max);
-	if(min>mBoxExtents.z || max<-mBoxExtents.z) return FALSE;
-#endif
-	// 2) Test if the box intersects the plane of the triangle
-	// compute plane equation of triangle: normal*x+d=0
-	// ### could be precomputed since we use the same leaf triangle several times
-	const Point e0 = v1 - v0;
-	const Point e1 = v2 - v1;
-	const Point normal = e0 ^ e1;
-	const float d = -normal|v0;
-	if(!planeBoxOverlap(normal, d, mBoxExtents)) return FALSE;
-
-	// 3) "Class III" tests - here we always do full tests since the box is a primitive (not a BV)
-	{
-		IMPLEMENT_CLASS3_TESTS
-	}
-	return TRUE;
+	// Box center is already in (0,0,0). Here we always do full tests since the box is a primitive (not a BV)
+	return TriBoxTest(mLeafVerts, Point(0.0f, 0.0f, 0.0f), mBoxExtents, TRUE);
 }
 
 //! ...and another one, jeez
@@ -261,79 +256,6 @@ inline_ BOOL AABBCollider::TriBoxOverlap()
 	// Stats
 	mNbVolumePrimTests++;
 
-	// Hook
-	const Point& center		= mBox.mCenter;
-	const Point& extents	= mBox.mExtents;
-
-	// use separating axis theorem to test overlap between triangle and box 
-	// need to test for overlap in these directions: 
-	// 1) the {x,y,z}-directions (actually, since we use the AABB of the triangle 
-	//    we do not even need to test these) 
-	// 2) normal of the triangle 
-	// 3) crossproduct(edge from tri, {x,y,z}-directin) 
-	//    this gives 3x3=9 more tests 
-
-	// move everything so that the boxcenter is in (0,0,0) 
-	Point v0, v1, v2;
-	v0.x = mLeafVerts[0].x - center.x;
-	v1.x = mLeafVerts[1].x - center.x;
-	v2.x = mLeafVerts[2].x - center.x;
-
-	// First, test overlap in the {x,y,z}-directions
-#ifdef OPC_USE_FCOMI
-	// find min, max of the triangle in x-direction, and test for overlap in X
-	if(FCMin3(v0.x, v1.x, v2.x)>extents.x)	return FALSE;
-	if(FCMax3(v0.x, v1.x, v2.x)<-extents.x)	return FALSE;
-
-	// same for Y
-	v0.y = mLeafVerts[0].y - center.y;
-	v1.y = mLeafVerts[1].y - center.y;
-	v2.y = mLeafVerts[2].y - center.y;
-
-	if(FCMin3(v0.y, v1.y, v2.y)>extents.y)	return FALSE;
-	if(FCMax3(v0.y, v1.y, v2.y)<-extents.y)	return FALSE;
-
-	// same for Z
-	v0.z = mLeafVerts[0].z - center.z;
-	v1.z = mLeafVerts[1].z - center.z;
-	v2.z = mLeafVerts[2].z - center.z;
-
-	if(FCMin3(v0.z, v1.z, v2.z)>extents.z)	return FALSE;
-	if(FCMax3(v0.z, v1.z, v2.z)<-extents.z)	return FALSE;
-#else
-	float min,max;
-	// Find min, max of the triangle in x-direction, and test for overlap in X
-	FINDMINMAX(v0.x, v1.x, v2.x, min, max);
-	if(min>extents.x || max<-extents.x) return FALSE;
-
-	// Same for Y
-	v0.y = mLeafVerts[0].y - center.y;
-	v1.y = mLeafVerts[1].y - center.y;
-	v2.y = mLeafVerts[2].y - center.y;
-
-	FINDMINMAX(v0.y, v1.y, v2.y, min, max);
-	if(min>extents.y || max<-extents.y) return FALSE;
-
-	// Same for Z
-	v0.z = mLeafVerts[0].z - center.z;
-	v1.z = mLeafVerts[1].z - center.z;
-	v2.z = mLeafVerts[2].z - center.z;
-
-	FINDMINMAX(v0.z, v1.z, v2.z, min, max);
-	if(min>extents.z || max<-extents.z) return FALSE;
-#endif
-	// 2) Test if the box intersects the plane of the triangle
-	// compute plane equation of triangle: normal*x+d=0
-	// ### could be precomputed since we use the same leaf triangle several times
-	const Point e0 = v1 - v0;
-	const Point e1 = v2 - v1;
-	const Point normal = e0 ^ e1;
-	const float d = -normal|v0;
-	if(!planeBoxOverlap(normal, d, extents)) return FALSE;
-
-	// 3) "Class III" tests - here we always do full tests since the box is a primitive (not a BV)
-	{
-		IMPLEMENT_CLASS3_TESTS
-	}
-	return TRUE;
+	// Here we always do full tests since the box is a primitive (not a BV)
+	return TriBoxTest(mLeafVerts, mBox.mCenter, mBox.mExtents, TRUE);
 }
@@ -72,7 +72,7 @@
 }
 
 //! TO BE DOCUMENTED
-BOOL CoplanarTriTri(const Point& n, const Point& v0, const Point& v1, const Point& v2, const Point& u0, const Point& u1, const Point& u2)
+inline_ BOOL CoplanarTriTri(const Point& n, const Point& v0, const Point& v1, const Point& v2, const Point& u0, const Point& u1, const Point& u2)
 {
 	float A[3];
 	short i0,i1;
@@ -176,11 +176,8 @@ BOOL CoplanarTriTri(const Point& n, const Point& v0, const Point& v1, const Poin
  *	\return		true if triangles overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL AABBTreeCollider::TriTriOverlap(const Point& V0, const Point& V1, const Point& V2, const Point& U0, const Point& U1, const Point& U2)
+inline_ BOOL TriTriTest(const Point& V0, const Point& V1, const Point& V2, const Point& U0, const Point& U1, const Point& U2)
 {
-	// Stats
-	mNbPrimPrimTests++;
-
 	// Compute plane equation of triangle(V0,V1,V2)
 	Point E1 = V1 - V0;
 	Point E2 = V2 - V0;
@@ -277,3 +274,23 @@ inline_ BOOL AABBTreeCollider::TriTriOverlap(const Point& V0, const Point& V1, c
 	if(isect1[1]<isect2[0] || isect2[1]<isect1[0]) return FALSE;
 	return TRUE;
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Triangle/triangle intersection test. Stats are updated, then TriTriTest() does the job.
+ *	\param		V0		[in] triangle 0, vertex 0
+ *	\param		V1		[in] triangle 0, vertex 1
+ *	\param		V2		[in] triangle 0, vertex 2
+ *	\param		U0		[in] triangle 1, vertex 0
+ *	\param		U1		[in] triangle 1, vertex 1
+ *	\param		U2		[in] triangle 1, vertex 2
+ *	\return		true if triangles overlap
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ BOOL AABBTreeCollider::TriTriOverlap(const Point& V0, const Point& V1, const Point& V2, const Point& U0, const Point& U1, const Point& U2)
+{
+	// Stats
+	mNbPrimPrimTests++;
+
+	return TriTriTest(V0, V1, V2, U0, U1, U2);
+}
@@ -101,3 +101,33 @@ IMPLEMENT_NOLEAFDUMP(AABBQuantizedNoLeafNode)
 
 IMPLEMENT_LEAFDUMP(AABBCollisionNode)
 IMPLEMENT_LEAFDUMP(AABBQuantizedNode)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Dumps all primitives below a child of a wide node.
+ *	\param		tree	[in] wide tree
+ *	\param		node	[in] wide node
+ *	\param		i		[in] child index
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VolumeCollider::_Dump(const AABBWideTree* tree, const AABBWideNode* node, udword i)
+{
+	if(node->IsLeaf(i))
+	{
+		const udword* Prims = tree->GetIndices() + node->GetFirstPrimitive(i);
+		udword Nb = node->GetNbPrimitives(i);
+		while(Nb--)	mTouchedPrimitives->Add(*Prims++);
+	}
+	else
+	{
+		const AABBWideNode* Child = tree->GetNodes() + node->GetChild(i);
+		for(udword j=0;j<WIDE_TREE_WIDTH;j++)
+		{
+			if(Child->IsEmpty(j))	break;
+
+			_Dump(tree, Child, j);
+
+			if(ContactFound()) return;
+		}
+	}
+}
@@ -103,6 +103,7 @@
 							void			_Dump(const AABBNoLeafNode* node);
 							void			_Dump(const AABBQuantizedNode* node);
 							void			_Dump(const AABBQuantizedNoLeafNode* node);
+							void			_Dump(const AABBWideTree* tree, const AABBWideNode* node, udword i);
 
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
@@ -0,0 +1,935 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for 4-wide quantized trees, built with a binned SAH.
+ *	\file		OPC_WideTree.cpp
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	A 4-wide tree. Each node is one cache line and stores the boxes of its 4 children, quantized on 8 bits relative
+ *	to the node's own box. Children are either other nodes, or leaves referencing up to 4 consecutive primitives in
+ *	a permuted index array.
+ *
+ *	The tree is built directly from the mesh with a binned SAH (surface area heuristic), instead of the fixed
+ *	splitting rules of AABBTreeBuilder. The SAH gives much tighter trees for meshes mixing large & small triangles,
+ *	typically terrains with buildings on top. The build is done in two passes:
+ *	- a binary tree is built first. Top levels are built serially, then the remaining subtrees are built in parallel.
+ *	Each subtree writes its nodes in a range of slots that only depends on its primitive range, so no locks are needed.
+ *	- the binary tree is then collapsed to a 4-wide tree, by repeatedly opening the largest child of each node.
+ *
+ *	The 4-wide layout divides the tree depth by 2, and the quantized boxes make the whole tree ~2x smaller than a
+ *	quantized no-leaf tree. Both reduce cache misses, which dominate the query time on large meshes.
+ *
+ *	\class		AABBWideTree
+ *	\version	1.3
+ *	\date		October, 19, 2026
+*/
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Precompiled Header
+#include "Stdafx.h"
+
+using namespace Opcode;
+
+#define WIDE_MAX_BINS		32	//!< Max number of SAH bins per axis
+#define WIDE_SAH_MAX_DEPTH	48	//!< Depth after which median splits are used, to bound the tree depth
+#define WIDE_TASK_RATIO		8	//!< Number of parallel subtrees per thread
+#define PRIM_BOXES_BATCH	16384	//!< Number of primitive boxes computed per task
+
+//! Temporary binary node, used during the build
+struct Opcode::WideBuildNode
+{
+	Point		mMin;		//!< Node's box
+	Point		mMax;		//!< Node's box
+	udword		mStart;		//!< Index of first primitive, in the sorted primitive array
+	udword		mNbPrims;	//!< Number of primitives
+	udword		mPos;		//!< "Positive" child, or INVALID_ID for leaves
+	udword		mNeg;		//!< "Negative" child, or INVALID_ID for leaves
+};
+
+//! Primitive reference, sorted in place during the build so that memory accesses remain sequential
+struct WidePrimitive
+{
+	Point		mMin;		//!< Primitive's box
+	udword		mIndex;		//!< Primitive's index
+	Point		mMax;		//!< Primitive's box
+	udword		mPad;
+};
+
+//! Shared build data
+struct WideBuilder
+{
+	const WideBuildSettings*	mSettings;
+	const MeshInterface*		mIMesh;
+	WidePrimitive*				mPrims;			//!< Primitive references
+	WideBuildNode*				mNodes;			//!< Binary nodes, 2*N slots
+	Container*					mTasks;			//!< Deferred subtrees (start, nb, slot, depth), or null
+	udword						mTaskSize;		//!< Subtrees smaller than that are deferred
+	udword						mNbPrims;		//!< Number of primitives
+};
+
+//! Sorting key for a primitive: twice its box center
+#define CENTROID(prim, axis)	((prim).mMin[axis] + (prim).mMax[axis])
+
+//! Half surface area of a box
+inline_ float HalfArea(const Point& min, const Point& max)
+{
+	const Point d = max - min;
+	return d.x*d.y + d.y*d.z + d.z*d.x;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Computes the boxes of a range of primitives. Called in parallel for large meshes.
+ *	\param		task_index	[in] index of the range to process
+ *	\param		user_data	[in] WideBuilder
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _ComputePrimitiveBoxes(udword task_index, void* user_data)
+{
+	WideBuilder& builder = *(WideBuilder*)user_data;
+
+	const udword Start	= task_index * PRIM_BOXES_BATCH;
+	const udword End	= MIN(Start + PRIM_BOXES_BATCH, builder.mNbPrims);
+
+	VertexPointers VP;
+	ConversionArea VC;
+	for(udword i=Start;i<End;i++)
+	{
+		builder.mIMesh->GetTriangle(VP, i, VC);
+
+		WidePrimitive& Prim = builder.mPrims[i];
+		Prim.mIndex = i;
+		Point& Min = Prim.mMin;
+		Point& Max = Prim.mMax;
+		Min = Max = *VP.Vertex[0];
+		Min.Min(*VP.Vertex[1]);	Max.Max(*VP.Vertex[1]);
+		Min.Min(*VP.Vertex[2]);	Max.Max(*VP.Vertex[2]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Partitions a range of primitives so that the primitive of rank k along an axis is at its sorted position, with
+ *	smaller primitives before it and bigger primitives after it (i.e. Hoare's selection algorithm).
+ *	\param		prims		[in/out] primitive references
+ *	\param		nb			[in] number of primitives
+ *	\param		k			[in] rank to select
+ *	\param		axis		[in] sorting axis
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _SelectMedian(WidePrimitive* prims, udword nb, udword k, udword axis)
+{
+	sdword Lo = 0;
+	sdword Hi = sdword(nb) - 1;
+	while(Lo<Hi)
+	{
+		const float Pivot = CENTROID(prims[(Lo+Hi)>>1], axis);
+		sdword i = Lo;
+		sdword j = Hi;
+		do
+		{
+			while(CENTROID(prims[i], axis) < Pivot)	i++;
+			while(CENTROID(prims[j], axis) > Pivot)	j--;
+			if(i<=j)
+			{
+				const WidePrimitive Tmp = prims[i];	prims[i] = prims[j];	prims[j] = Tmp;
+				i++;
+				j--;
+			}
+		}while(i<=j);
+
+		if(sdword(k)<=j)		Hi = j;
+		else if(sdword(k)>=i)	Lo = i;
+		else					break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Finds the best split of a node using a binned SAH, and partitions its primitives accordingly.
+ *	\param		builder		[in] build data
+ *	\param		node		[in] current node (box & primitive range already set)
+ *	\param		cmin		[in] min point of primitive centroids
+ *	\param		cmax		[in] max point of primitive centroids
+ *	\param		depth		[in] node's depth
+ *	\return		number of primitives in the positive child, or 0 to make a leaf
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _Split(const WideBuilder& builder, const WideBuildNode& node, const Point& cmin, const Point& cmax, udword depth)
+{
+	const WideBuildSettings& Settings = *builder.mSettings;
+	WidePrimitive* Prims = builder.mPrims + node.mStart;
+	const udword Nb	= node.mNbPrims;
+
+	const bool MustSplit = Nb > Settings.mMaxLeafSize;
+
+	// Find the axis of largest centroid extent
+	const Point CExtents = cmax - cmin;
+	udword LargestAxis = CExtents.x > CExtents.y ? 0 : 1;
+	if(CExtents.z > CExtents[LargestAxis])	LargestAxis = 2;
+
+	// All centroids are the same: SAH can't do anything for us
+	if(CExtents[LargestAxis]<=0.0f)	return MustSplit ? Nb/2 : 0;
+
+	// Bound the depth of the tree, so that queries can use a fixed-size stack
+	if(depth>=WIDE_SAH_MAX_DEPTH)
+	{
+		if(!MustSplit)	return 0;
+		_SelectMedian(Prims, Nb, Nb/2, LargestAxis);
+		return Nb/2;
+	}
+
+	// Bin primitives along the 3 axes at the same time
+	const udword NbBins = Settings.mNbBins;
+	udword	BinCount[3][WIDE_MAX_BINS];
+	Point	BinMin[3][WIDE_MAX_BINS];
+	Point	BinMax[3][WIDE_MAX_BINS];
+	for(udword Axis=0;Axis<3;Axis++)
+	{
+		for(udword i=0;i<NbBins;i++)
+		{
+			BinCount[Axis][i] = 0;
+			BinMin[Axis][i].SetPlusInfinity();
+			BinMax[Axis][i].SetMinusInfinity();
+		}
+	}
+
+	Point Coeff;
+	for(udword Axis=0;Axis<3;Axis++)	Coeff[Axis] = CExtents[Axis]>0.0f ? float(NbBins)*0.9999f/CExtents[Axis] : 0.0f;
+
+	for(udword i=0;i<Nb;i++)
+	{
+		const Point& Min = Prims[i].mMin;
+		const Point& Max = Prims[i].mMax;
+		for(udword Axis=0;Axis<3;Axis++)
+		{
+			const udword Bin = udword((Min[Axis] + Max[Axis] - cmin[Axis]) * Coeff[Axis]);
+			BinCount[Axis][Bin]++;
+			BinMin[Axis][Bin].Min(Min);
+			BinMax[Axis][Bin].Max(Max);
+		}
+	}
+
+	// Evaluate the SAH for all split planes. Split i puts bins [0, i[ in the positive child.
+	const float NodeArea = HalfArea(node.mMin, node.mMax);
+	const float InvArea = NodeArea>0.0f ? 1.0f/NodeArea : 0.0f;
+	float BestCost = MAX_FLOAT;
+	udword BestAxis = INVALID_ID;
+	udword BestBin = 0;
+	for(udword Axis=0;Axis<3;Axis++)
+	{
+		if(CExtents[Axis]<=0.0f)	continue;
+
+		// Sweep from the right
+		float	RightArea[WIDE_MAX_BINS];
+		udword	RightCount[WIDE_MAX_BINS];
+		Point Min, Max;
+		Min.SetPlusInfinity();
+		Max.SetMinusInfinity();
+		udword Count = 0;
+		for(udword i=NbBins-1;i>0;i--)
+		{
+			Count += BinCount[Axis][i];
+			Min.Min(BinMin[Axis][i]);
+			Max.Max(BinMax[Axis][i]);
+			RightCount[i]	= Count;
+			RightArea[i]	= Count ? HalfArea(Min, Max) : 0.0f;
+		}
+
+		// Sweep from the left & evaluate
+		Min.SetPlusInfinity();
+		Max.SetMinusInfinity();
+		Count = 0;
+		for(udword i=1;i<NbBins;i++)
+		{
+			Count += BinCount[Axis][i-1];
+			Min.Min(BinMin[Axis][i-1]);
+			Max.Max(BinMax[Axis][i-1]);
+			if(!Count || !RightCount[i])	continue;
+
+			const float Cost = HalfArea(Min, Max)*float(Count) + RightArea[i]*float(RightCount[i]);
+			if(Cost<BestCost)
+			{
+				BestCost	= Cost;
+				BestAxis	= Axis;
+				BestBin		= i;
+			}
+		}
+	}
+
+	// Centroids are spread, so both extreme bins are used on at least one axis
+	ASSERT(BestAxis!=INVALID_ID);
+	if(BestAxis==INVALID_ID)	return MustSplit ? Nb/2 : 0;
+
+	// Compare to the cost of a leaf
+	if(!MustSplit)
+	{
+		const float SplitCost = Settings.mTraversalCost + Settings.mIntersectionCost * BestCost * InvArea;
+		const float LeafCost = Settings.mIntersectionCost * float(Nb);
+		if(LeafCost<=SplitCost)	return 0;
+	}
+
+	// Partition primitives. We use the exact same formula as for binning.
+	udword NbPos = 0;
+	udword Last = Nb;
+	while(NbPos<Last)
+	{
+		const udword Bin = udword((CENTROID(Prims[NbPos], BestAxis) - cmin[BestAxis]) * Coeff[BestAxis]);
+		if(Bin<BestBin)	NbPos++;
+		else
+		{
+			Last--;
+			const WidePrimitive Tmp = Prims[NbPos];	Prims[NbPos] = Prims[Last];	Prims[Last] = Tmp;
+		}
+	}
+	ASSERT(NbPos && NbPos<Nb);
+	return NbPos;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Recursively builds a binary subtree. Node slots are implicit: a node for N primitives uses at most 2*N-1 slots,
+ *	so the positive child goes right after its parent, and the negative child right after the positive subtree.
+ *	\param		builder		[in] build data
+ *	\param		start		[in] index of first primitive
+ *	\param		nb			[in] number of primitives
+ *	\param		slot		[in] node's slot
+ *	\param		depth		[in] node's depth
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _BuildSubtree(const WideBuilder& builder, udword start, udword nb, udword slot, udword depth)
+{
+	// Defer the subtree if we're in the serial phase of a parallel build
+	if(builder.mTasks && nb<=builder.mTaskSize)
+	{
+		builder.mTasks->Add(start).Add(nb).Add(slot).Add(depth);
+		return;
+	}
+
+	WideBuildNode& Node = builder.mNodes[slot];
+	Node.mStart		= start;
+	Node.mNbPrims	= nb;
+	Node.mPos		= INVALID_ID;
+	Node.mNeg		= INVALID_ID;
+
+	// Compute node's box and centroid bounds
+	Point CMin, CMax;
+	Node.mMin.SetPlusInfinity();
+	Node.mMax.SetMinusInfinity();
+	CMin.SetPlusInfinity();
+	CMax.SetMinusInfinity();
+	const WidePrimitive* Prims = builder.mPrims + start;
+	for(udword i=0;i<nb;i++)
+	{
+		const Point& Min = Prims[i].mMin;
+		const Point& Max = Prims[i].mMax;
+		Node.mMin.Min(Min);
+		Node.mMax.Max(Max);
+		const Point C = Min + Max;
+		CMin.Min(C);
+		CMax.Max(C);
+	}
+
+	if(nb<=1)	return;
+
+	const udword NbPos = _Split(builder, Node, CMin, CMax, depth);
+	if(!NbPos)	return;
+
+	Node.mPos	= slot + 1;
+	Node.mNeg	= slot + NbPos*2;
+
+	_BuildSubtree(builder, start, NbPos, Node.mPos, depth+1);
+	_BuildSubtree(builder, start + NbPos, nb - NbPos, Node.mNeg, depth+1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Builds a deferred subtree. Called in parallel.
+ *	\param		task_index	[in] index of the subtree
+ *	\param		user_data	[in] WideBuilder
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _BuildDeferredSubtree(udword task_index, void* user_data)
+{
+	const WideBuilder& builder = *(const WideBuilder*)user_data;
+	const udword* Task = builder.mTasks->GetEntries() + task_index*4;
+
+	WideBuilder Local = builder;
+	Local.mTasks = null;
+	_BuildSubtree(Local, Task[0], Task[1], Task[2], Task[3]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Setups the quantization box of a wide node. The scale is rounded up so that the box encloses the given one.
+ *	\param		node		[out] wide node
+ *	\param		min			[in] box min point
+ *	\param		max			[in] box max point
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _SetupQuantization(AABBWideNode& node, const Point& min, const Point& max)
+{
+	node.mOrigin = min;
+	for(udword Axis=0;Axis<3;Axis++)
+	{
+		float Scale = (max[Axis] - min[Axis]) * (1.0f/255.0f);
+		while(min[Axis] + Scale*255.0f < max[Axis])	IR(Scale)++;
+		node.mScale[Axis] = Scale;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Quantizes the box of a child. The quantized box always encloses the original one.
+ *	\param		node		[in/out] wide node
+ *	\param		i			[in] child index
+ *	\param		min			[in] child's box min point
+ *	\param		max			[in] child's box max point
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void _QuantizeChild(AABBWideNode& node, udword i, const Point& min, const Point& max)
+{
+	ubyte* QMin[3] = { node.mMinX, node.mMinY, node.mMinZ };
+	ubyte* QMax[3] = { node.mMaxX, node.mMaxY, node.mMaxZ };
+	for(udword Axis=0;Axis<3;Axis++)
+	{
+		const float Origin	= node.mOrigin[Axis];
+		const float Scale	= node.mScale[Axis];
+		const float Coeff	= Scale>0.0f ? 1.0f/Scale : 0.0f;
+
+		sdword q0 = sdword(floorf((min[Axis] - Origin) * Coeff));
+		if(q0<0)	q0 = 0;
+		if(q0>255)	q0 = 255;
+		while(q0>0 && Origin + float(q0)*Scale > min[Axis])	q0--;
+
+		sdword q1 = sdword(ceilf((max[Axis] - Origin) * Coeff));
+		if(q1<q0)	q1 = q0;
+		if(q1>255)	q1 = 255;
+		while(q1<255 && Origin + float(q1)*Scale < max[Axis])	q1++;
+
+		QMin[Axis][i] = ubyte(q0);
+		QMax[Axis][i] = ubyte(q1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Recursively collapses a binary tree into a 4-wide tree. Nodes are output in depth-first order, so children
+ *	always come after their parent.
+ *	\param		linear		[in] base address of destination nodes
+ *	\param		current_id	[in/out] current running index
+ *	\param		binary		[in] binary nodes
+ *	\param		slot		[in] current binary node
+ *	\return		index of the new wide node
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _CollapseTree(AABBWideNode* linear, udword& current_id, const WideBuildNode* binary, udword slot)
+{
+	const WideBuildNode& Current = binary[slot];
+
+	// Gather up to 4 children, opening the largest internal child first
+	udword Children[WIDE_TREE_WIDTH];
+	udword NbChildren;
+	if(Current.mPos==INVALID_ID)
+	{
+		// Only happens for a leaf root
+		Children[0]	= slot;
+		NbChildren	= 1;
+	}
+	else
+	{
+		Children[0]	= Current.mPos;
+		Children[1]	= Current.mNeg;
+		NbChildren	= 2;
+		while(NbChildren<WIDE_TREE_WIDTH)
+		{
+			udword Best = INVALID_ID;
+			float BestArea = -1.0f;
+			for(udword i=0;i<NbChildren;i++)
+			{
+				const WideBuildNode& Child = binary[Children[i]];
+				if(Child.mPos==INVALID_ID)	continue;
+				const float Area = HalfArea(Child.mMin, Child.mMax);
+				if(Area>BestArea)
+				{
+					BestArea	= Area;
+					Best		= i;
+				}
+			}
+			if(Best==INVALID_ID)	break;
+
+			const WideBuildNode& Opened = binary[Children[Best]];
+			Children[Best]			= Opened.mPos;
+			Children[NbChildren++]	= Opened.mNeg;
+		}
+	}
+
+	const udword NodeID = current_id++;
+	AABBWideNode& Node = linear[NodeID];
+	_SetupQuantization(Node, Current.mMin, Current.mMax);
+
+	for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+	{
+		if(i>=NbChildren)
+		{
+			Node.mMinX[i] = Node.mMinY[i] = Node.mMinZ[i] = 0;
+			Node.mMaxX[i] = Node.mMaxY[i] = Node.mMaxZ[i] = 0;
+			Node.mData[i] = INVALID_ID;
+			continue;
+		}
+
+		const WideBuildNode& Child = binary[Children[i]];
+		_QuantizeChild(Node, i, Child.mMin, Child.mMax);
+
+		if(Child.mPos==INVALID_ID)
+		{
+			ASSERT(Child.mNbPrims && Child.mNbPrims<=WIDE_MAX_LEAF_SIZE);
+			Node.mData[i] = WIDE_LEAF_BIT | (Child.mStart<<WIDE_LEAF_SHIFT) | (Child.mNbPrims-1);
+		}
+		else
+		{
+			Node.mData[i] = _CollapseTree(linear, current_id, binary, Children[i]);
+		}
+	}
+	return NodeID;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Counts internal nodes of a binary tree.
+ *	\param		binary		[in] binary nodes
+ *	\param		slot		[in] current binary node
+ *	\return		number of internal nodes
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _CountInternalNodes(const WideBuildNode* binary, udword slot)
+{
+	const WideBuildNode& Current = binary[slot];
+	if(Current.mPos==INVALID_ID)	return 0;
+	return 1 + _CountInternalNodes(binary, Current.mPos) + _CountInternalNodes(binary, Current.mNeg);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Converts a standard tree into a binary build tree.
+ *	\param		binary		[in] base address of destination nodes
+ *	\param		slot		[in] index of destination node
+ *	\param		current_id	[in/out] current running index
+ *	\param		current_node[in] current node from input tree
+ *	\param		base		[in] input tree's indices
+ *	\return		false if a leaf has too many primitives
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool _ConvertTree(WideBuildNode* binary, udword slot, udword& current_id, const AABBTreeNode* current_node, const udword* base)
+{
+	WideBuildNode& Current = binary[slot];
+	current_node->GetAABB()->GetMin(Current.mMin);
+	current_node->GetAABB()->GetMax(Current.mMax);
+	Current.mStart		= udword(current_node->GetPrimitives() - base);
+	Current.mNbPrims	= current_node->GetNbPrimitives();
+	Current.mPos		= INVALID_ID;
+	Current.mNeg		= INVALID_ID;
+
+	if(current_node->IsLeaf())	return Current.mNbPrims<=WIDE_MAX_LEAF_SIZE;
+
+	Current.mPos = current_id++;
+	Current.mNeg = current_id++;
+	if(!_ConvertTree(binary, Current.mPos, current_id, current_node->GetPos(), base))	return false;
+	return _ConvertTree(binary, Current.mNeg, current_id, current_node->GetNeg(), base);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Constructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+AABBWideTree::AABBWideTree() : mNodeMemory(null), mNodes(null), mIndices(null), mNbPrimitives(0), mUserData(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Destructor.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+AABBWideTree::~AABBWideTree()
+{
+	Release();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Releases the tree.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABBWideTree::Release()
+{
+	DELETEARRAY(mNodeMemory);
+	if(mUserData)	mIndices = null;
+	else			DELETEARRAY(mIndices);
+	mUserData		= false;
+	mNodes			= null;
+	mNbNodes		= 0;
+	mNbPrimitives	= 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Creates the wide nodes from a binary build tree.
+ *	\param		binary		[in] binary nodes. Root is the first one.
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::CreateNodes(const WideBuildNode* binary)
+{
+	// Each wide node eats at least one internal binary node
+	udword NbNodes = _CountInternalNodes(binary, 0);
+	if(!NbNodes)	NbNodes = 1;
+
+	// Allocate cache-aligned nodes
+	mNodeMemory = new ubyte[NbNodes*sizeof(AABBWideNode) + 63];
+	CHECKALLOC(mNodeMemory);
+	mNodes = (AABBWideNode*)((size_t(mNodeMemory) + 63) & ~size_t(63));
+
+	mNbNodes = 0;
+	_CollapseTree(mNodes, mNbNodes, binary, 0);
+	ASSERT(mNbNodes<=NbNodes);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Builds the tree directly from a mesh, using a binned SAH. Large meshes are built in parallel.
+ *	\param		mesh_interface	[in] mesh interface
+ *	\param		settings		[in] builder's settings
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::Build(const MeshInterface* mesh_interface, const WideBuildSettings& settings)
+{
+	// Checkings
+	if(!mesh_interface || !mesh_interface->IsValid())	return false;
+	const udword NbPrims = mesh_interface->GetNbTriangles();
+	if(!NbPrims)	return false;
+	if(NbPrims > (~WIDE_LEAF_BIT>>WIDE_LEAF_SHIFT))	return SetIceError("OPCODE WARNING: too many triangles for a wide tree.\n", null);
+	if(settings.mNbBins<2 || settings.mNbBins>WIDE_MAX_BINS)	return SetIceError("OPCODE WARNING: invalid number of bins.\n", null);
+	if(!settings.mMaxLeafSize || settings.mMaxLeafSize>WIDE_MAX_LEAF_SIZE)	return SetIceError("OPCODE WARNING: invalid leaf size.\n", null);
+
+	Release();
+
+	// Allocate build data
+	WideBuilder Builder;
+	Builder.mSettings	= &settings;
+	Builder.mIMesh		= mesh_interface;
+	Builder.mNbPrims	= NbPrims;
+	Builder.mTasks		= null;
+	Builder.mTaskSize	= 0;
+	Builder.mPrims		= new WidePrimitive[NbPrims];
+	Builder.mNodes		= new WideBuildNode[NbPrims*2];
+	mIndices			= new udword[NbPrims];
+	if(!Builder.mPrims || !Builder.mNodes || !mIndices)
+	{
+		DELETEARRAY(Builder.mNodes);
+		DELETEARRAY(Builder.mPrims);
+		DELETEARRAY(mIndices);
+		return SetIceError("Out of memory.", EC_OUTOFMEMORY);
+	}
+	mNbPrimitives		= NbPrims;
+
+	udword NbThreads = settings.mNbThreads ? settings.mNbThreads : GetNbProcessors();
+	if(NbPrims<settings.mParallelThreshold)	NbThreads = 1;
+
+	// 1) Compute primitive boxes
+	const udword NbBatches = (NbPrims + PRIM_BOXES_BATCH - 1) / PRIM_BOXES_BATCH;
+	RunParallel(NbBatches, _ComputePrimitiveBoxes, &Builder, NbThreads);
+
+	// 2) Build the binary tree. In parallel, the top of the tree is built first and subtrees are deferred.
+	if(NbThreads>1)
+	{
+		Container Tasks;
+		Builder.mTasks		= &Tasks;
+		Builder.mTaskSize	= MAX(NbPrims / (NbThreads*WIDE_TASK_RATIO), 1024);
+		_BuildSubtree(Builder, 0, NbPrims, 0, 0);
+
+		const udword NbTasks = Tasks.GetNbEntries()/4;
+		RunParallel(NbTasks, _BuildDeferredSubtree, &Builder, NbThreads);
+		Builder.mTasks = null;
+	}
+	else
+	{
+		_BuildSubtree(Builder, 0, NbPrims, 0, 0);
+	}
+
+	// Keep the final permutation
+	for(udword i=0;i<NbPrims;i++)	mIndices[i] = Builder.mPrims[i].mIndex;
+	DELETEARRAY(Builder.mPrims);
+
+	// 3) Collapse to a 4-wide tree
+	const bool Status = CreateNodes(Builder.mNodes);
+	DELETEARRAY(Builder.mNodes);
+	return Status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Builds the collision tree from a generic AABB tree.
+ *	\param		tree			[in] generic AABB tree
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::Build(AABBTree* tree)
+{
+	// Checkings
+	if(!tree)	return false;
+	if(tree->ComputeDepth()>WIDE_STACK_SIZE/(WIDE_TREE_WIDTH-1))	return SetIceError("OPCODE WARNING: tree is too deep for a wide tree.\n", null);
+
+	Release();
+
+	// Copy the permutation
+	mNbPrimitives = tree->GetNbPrimitives();
+	mIndices = new udword[mNbPrimitives];
+	CHECKALLOC(mIndices);
+	CopyMemory(mIndices, tree->GetIndices(), mNbPrimitives*sizeof(udword));
+
+	// Convert to a binary build tree
+	WideBuildNode* Binary = new WideBuildNode[tree->GetNbNodes()];
+	CHECKALLOC(Binary);
+	udword CurID = 1;
+	bool Converted = _ConvertTree(Binary, 0, CurID, tree, tree->GetIndices());
+
+	// Collapse to a 4-wide tree
+	bool Status = Converted && CreateNodes(Binary);
+	DELETEARRAY(Binary);
+	if(!Converted)	return SetIceError("OPCODE WARNING: wide trees need leaves with 4 primitives max.\n", null);
+	return Status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refit kernel for AABBWideTree nodes. See RefitKernel. Children are requantized relative to the new box of
+ *	their parent.
+ *	\param		node		[in] node to refit
+ *	\param		context		[in] refit context
+ *	\param		depth		[in] node's depth
+ *	\return		REFIT_XXX flags
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static udword _RefitWideNode(void* node, RefitContext& context, udword depth)
+{
+	if(depth==context.mSplitDepth)	return context.Subtree(node);
+
+	const AABBWideTree* Tree = (const AABBWideTree*)context.mTree;
+	const AABBWideNode* Nodes = Tree->GetNodes();
+	const udword* Indices = Tree->GetIndices();
+	AABBWideNode& Current = *(AABBWideNode*)node;
+
+	// Refit child nodes & look for dirty leaves
+	udword Flags = 0;
+	for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+	{
+		if(Current.IsEmpty(i))	break;
+
+		if(Current.IsLeaf(i))
+		{
+			if(Flags)	continue;
+			const udword* Prims = Indices + Current.GetFirstPrimitive(i);
+			udword Nb = Current.GetNbPrimitives(i);
+			while(Nb--)
+			{
+				if(context.IsDirty(*Prims++))
+				{
+					Flags |= REFIT_CHANGED;
+					break;
+				}
+			}
+		}
+		else Flags |= _RefitWideNode((void*)(Nodes + Current.GetChild(i)), context, depth+1);
+	}
+	if(context.mGather || !Flags)	return 0;
+
+	// Compute new children boxes
+	Point ChildMin[WIDE_TREE_WIDTH];
+	Point ChildMax[WIDE_TREE_WIDTH];
+	Point Min, Max;
+	Min.SetPlusInfinity();
+	Max.SetMinusInfinity();
+	for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+	{
+		if(Current.IsEmpty(i))	break;
+
+		if(Current.IsLeaf(i))
+		{
+			// Always recomputed from the triangles: requantizing dequantized boxes would make them grow over time
+			const udword* Prims = Indices + Current.GetFirstPrimitive(i);
+			udword Nb = Current.GetNbPrimitives(i);
+			ChildMin[i].SetPlusInfinity();
+			ChildMax[i].SetMinusInfinity();
+			while(Nb--)
+			{
+				Point TriMin, TriMax;
+				context.GetTriangleBox(*Prims++, TriMin, TriMax);
+				ChildMin[i].Min(TriMin);
+				ChildMax[i].Max(TriMax);
+			}
+		}
+		else
+		{
+			const AABBWideNode& Child = Nodes[Current.GetChild(i)];
+			Child.GetMin(ChildMin[i]);
+			Child.GetMax(ChildMax[i]);
+		}
+		Min.Min(ChildMin[i]);
+		Max.Max(ChildMax[i]);
+	}
+
+	// Requantize
+	const Point OldOrigin	= Current.mOrigin;
+	const Point OldScale	= Current.mScale;
+	_SetupQuantization(Current, Min, Max);
+	for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+	{
+		if(Current.IsEmpty(i))	break;
+		_QuantizeChild(Current, i, ChildMin[i], ChildMax[i]);
+	}
+	return (Current.mOrigin==OldOrigin && Current.mScale==OldScale) ? 0 : REFIT_CHANGED;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the collision tree after vertices have been modified.
+ *	\param		mesh_interface	[in] mesh interface for current model
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::Refit(const MeshInterface* mesh_interface)
+{
+	return Refit(mesh_interface, RefitSettings());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Refits the collision tree after vertices have been modified, only updating the nodes above dirty primitives.
+ *	\param		mesh_interface	[in] mesh interface for current model
+ *	\param		settings		[in] refit settings
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::Refit(const MeshInterface* mesh_interface, const RefitSettings& settings)
+{
+	// Checkings
+	if(!mesh_interface || !mNodes)	return false;
+
+	RefitContext Context(mesh_interface, settings.mDirtyPrimitives, _RefitWideNode, this);
+	RefitTree(mNodes, mNbNodes, Context, settings);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Walks the tree and call the user back for each node.
+ *	\param		callback	[in] walking callback
+ *	\param		user_data	[in] callback's user data
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::Walk(GenericWalkingCallback callback, void* user_data) const
+{
+	if(!callback || !mNodes)	return false;
+
+	struct Local
+	{
+		static void _Walk(const AABBWideNode* nodes, udword index, GenericWalkingCallback callback, void* user_data)
+		{
+			const AABBWideNode* Current = nodes + index;
+			if(!(callback)(Current, user_data))	return;
+
+			for(udword i=0;i<WIDE_TREE_WIDTH;i++)
+			{
+				if(Current->IsEmpty(i))	break;
+				if(!Current->IsLeaf(i))	_Walk(nodes, Current->GetChild(i), callback, user_data);
+			}
+		}
+	};
+	Local::_Walk(mNodes, 0, callback, user_data);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Gets the size of the serialized tree: header, nodes, then primitive indices.
+ *	\return		size in bytes, a multiple of OPC_SAVE_ALIGNMENT
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+udword AABBWideTree::GetSaveSize() const
+{
+	return sizeof(SavedTreeHeader) + mNbNodes*sizeof(AABBWideNode) + OPC_SAVE_ALIGN(mNbPrimitives*sizeof(udword));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Serializes the tree. Nodes only reference other nodes by index, so they are simply copied.
+ *	\param		buffer		[out] destination buffer, GetSaveSize() bytes
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::Save(void* buffer) const
+{
+	if(!buffer || !mNodes)	return false;
+
+	SavedTreeHeader* Header = (SavedTreeHeader*)buffer;
+	ZeroMemory(Header, sizeof(SavedTreeHeader));
+	Header->mNbNodes		= mNbNodes;
+	Header->mNodeSize		= sizeof(AABBWideNode);
+	Header->mNbPrimitives	= mNbPrimitives;
+
+	ubyte* Data = (ubyte*)(Header+1);
+	CopyMemory(Data, mNodes, mNbNodes*sizeof(AABBWideNode));
+	Data += mNbNodes*sizeof(AABBWideNode);
+
+	const udword IndicesSize = mNbPrimitives*sizeof(udword);
+	CopyMemory(Data, mIndices, IndicesSize);
+	ZeroMemory(Data + IndicesSize, OPC_SAVE_ALIGN(IndicesSize) - IndicesSize);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Setups the tree from serialized data. The data is used in place, not copied.
+ *	\param		buffer		[in] serialized data, OPC_SAVE_ALIGNMENT-aligned
+ *	\param		size		[in] size of serialized data
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBWideTree::Load(void* buffer, udword size)
+{
+	if(!buffer || size<sizeof(SavedTreeHeader))	return false;
+
+	const SavedTreeHeader* Header = (const SavedTreeHeader*)buffer;
+	if(Header->mNodeSize!=sizeof(AABBWideNode) || !Header->mNbNodes || !Header->mNbPrimitives)	return false;
+	const udword Available = size - sizeof(SavedTreeHeader);
+	if(Header->mNbNodes>Available/sizeof(AABBWideNode))	return false;
+	if(Header->mNbPrimitives>(Available - Header->mNbNodes*sizeof(AABBWideNode))/sizeof(udword))	return false;
+	if(sizeof(SavedTreeHeader) + Header->mNbNodes*sizeof(AABBWideNode) + OPC_SAVE_ALIGN(Header->mNbPrimitives*sizeof(udword))!=size)	return false;
+
+	Release();
+
+	ubyte* Data		= (ubyte*)(Header+1);
+	mNodes			= (AABBWideNode*)Data;
+	mIndices		= (udword*)(Data + Header->mNbNodes*sizeof(AABBWideNode));
+	mNbNodes		= Header->mNbNodes;
+	mNbPrimitives	= Header->mNbPrimitives;
+	mUserData		= true;
+	return true;
+}
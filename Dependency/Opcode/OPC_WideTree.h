@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ *	OPCODE - Optimized Collision Detection
+ *	Copyright (C) 2001 Pierre Terdiman
+ *	Homepage: http://www.codercorner.com/Opcode.htm
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Contains code for 4-wide quantized trees, built with a binned SAH.
+ *	\file		OPC_WideTree.h
+ *	\date		October, 19, 2026
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Include Guard
+#ifndef __OPC_WIDETREE_H__
+#define __OPC_WIDETREE_H__
+
+	#define WIDE_TREE_WIDTH		4			//!< Number of children per node
+	#define WIDE_MAX_LEAF_SIZE	4			//!< Max number of primitives in a leaf
+	#define WIDE_STACK_SIZE		256			//!< Traversal stack size. The builder bounds the tree depth accordingly.
+	#define WIDE_LEAF_BIT		0x80000000	//!< Child is a leaf
+	#define WIDE_LEAF_SHIFT		2			//!< Shift for leaf's first primitive
+	#define WIDE_LEAF_MASK		3			//!< Mask for leaf's number of primitives (minus one)
+
+	//! Settings for the binned-SAH builder
+	struct OPCODE_API WideBuildSettings
+	{
+		//! Constructor
+		inline_					WideBuildSettings() :
+									mNbBins				(16),
+									mMaxLeafSize		(WIDE_MAX_LEAF_SIZE),
+									mTraversalCost		(1.0f),
+									mIntersectionCost	(1.0f),
+									mNbThreads			(0),
+									mParallelThreshold	(65536)
+								{}
+
+				udword			mNbBins;			//!< Number of SAH bins per axis (max 32)
+				udword			mMaxLeafSize;		//!< Max number of primitives per leaf (1 to WIDE_MAX_LEAF_SIZE)
+				float			mTraversalCost;		//!< SAH cost of a node traversal
+				float			mIntersectionCost;	//!< SAH cost of a primitive test
+				udword			mNbThreads;			//!< Number of build threads. 0 = one per processor, 1 = serial build
+				udword			mParallelThreshold;	//!< Meshes with less triangles than that are built serially
+	};
+
+	//! A node of a 4-wide tree. Each node stores the quantized boxes of its children, relative to its own box.
+	//! The node is exactly 64 bytes, i.e. one cache line.
+	class OPCODE_API AABBWideNode
+	{
+		public:
+		// Constructor / Destructor
+		inline_						AABBWideNode()		{}
+		inline_						~AABBWideNode()		{}
+
+		// Children tests
+		inline_			BOOL		IsEmpty(udword i)			const	{ return mData[i]==INVALID_ID;						}
+		inline_			BOOL		IsLeaf(udword i)			const	{ return mData[i]&WIDE_LEAF_BIT;					}
+		// Data access
+		inline_			udword		GetChild(udword i)			const	{ return mData[i];									}
+		inline_			udword		GetFirstPrimitive(udword i)	const	{ return (mData[i]&~WIDE_LEAF_BIT)>>WIDE_LEAF_SHIFT;	}
+		inline_			udword		GetNbPrimitives(udword i)	const	{ return (mData[i]&WIDE_LEAF_MASK)+1;				}
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Dequantizes the box of a child.
+		 *	\param		i			[in] child index
+		 *	\param		center		[out] box center
+		 *	\param		extents		[out] box extents
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		inline_			void		GetChildBox(udword i, Point& center, Point& extents)	const
+									{
+										const Point Min(mOrigin.x + float(mMinX[i])*mScale.x, mOrigin.y + float(mMinY[i])*mScale.y, mOrigin.z + float(mMinZ[i])*mScale.z);
+										const Point Max(mOrigin.x + float(mMaxX[i])*mScale.x, mOrigin.y + float(mMaxY[i])*mScale.y, mOrigin.z + float(mMaxZ[i])*mScale.z);
+										center	= (Max + Min)*0.5f;
+										extents	= (Max - Min)*0.5f;
+									}
+
+		// Node's box
+		inline_			void		GetMin(Point& min)			const	{ min = mOrigin;									}
+		inline_			void		GetMax(Point& max)			const	{ max = mOrigin + mScale*255.0f;					}
+
+						Point		mOrigin;		//!< Min point of the node's box
+						Point		mScale;			//!< Size of a quantization step
+						ubyte		mMinX[WIDE_TREE_WIDTH];
+						ubyte		mMinY[WIDE_TREE_WIDTH];
+						ubyte		mMinZ[WIDE_TREE_WIDTH];
+						ubyte		mMaxX[WIDE_TREE_WIDTH];
+						ubyte		mMaxY[WIDE_TREE_WIDTH];
+						ubyte		mMaxZ[WIDE_TREE_WIDTH];
+						udword		mData[WIDE_TREE_WIDTH];	//!< Child node index, or leaf (WIDE_LEAF_BIT | first<<WIDE_LEAF_SHIFT | (nb-1)), or INVALID_ID
+	};
+
+	ICE_COMPILE_TIME_ASSERT(sizeof(AABBWideNode)==64);
+
+	struct WideBuildNode;
+
+	class OPCODE_API AABBWideTree : public AABBOptimizedTree
+	{
+		public:
+		// Constructor / Destructor
+													AABBWideTree();
+		virtual										~AABBWideTree();
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Builds the tree directly from a mesh, using a binned SAH. Large meshes are built in parallel.
+		 *	\param		mesh_interface	[in] mesh interface
+		 *	\param		settings		[in] builder's settings
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+									bool			Build(const MeshInterface* mesh_interface, const WideBuildSettings& settings);
+
+		// Builds from a standard tree. Leaves must contain at most WIDE_MAX_LEAF_SIZE primitives.
+		override(AABBOptimizedTree)	bool			Build(AABBTree* tree);
+		// Refits the tree
+		override(AABBOptimizedTree)	bool			Refit(const MeshInterface* mesh_interface);
+		override(AABBOptimizedTree)	bool			Refit(const MeshInterface* mesh_interface, const RefitSettings& settings);
+		// Walks the tree
+		override(AABBOptimizedTree)	bool			Walk(GenericWalkingCallback callback, void* user_data) const;
+		// Data access
+		inline_						const AABBWideNode*	GetNodes()		const	{ return mNodes;		}
+		inline_						const udword*	GetIndices()		const	{ return mIndices;		}
+		inline_						udword			GetNbPrimitives()	const	{ return mNbPrimitives;	}
+		// Stats
+		override(AABBOptimizedTree)	udword			GetUsedBytes()		const	{ return mNbNodes*sizeof(AABBWideNode) + mNbPrimitives*sizeof(udword);	}
+		// Serialization
+		override(AABBOptimizedTree)	udword			GetSaveSize()		const;
+		override(AABBOptimizedTree)	bool			Save(void* buffer)	const;
+		override(AABBOptimizedTree)	bool			Load(void* buffer, udword size);
+
+						void						Release();
+		private:
+						ubyte*						mNodeMemory;	//!< Allocated memory for nodes
+						AABBWideNode*				mNodes;			//!< Cache-aligned nodes, in depth-first order
+						udword*						mIndices;		//!< Primitive indices, referenced by leaves
+						udword						mNbPrimitives;	//!< Number of primitives
+						bool						mUserData;		//!< Nodes & indices live in user memory (loaded tree)
+		// Internal methods
+						bool						CreateNodes(const WideBuildNode* binary);
+	};
+
+#endif // __OPC_WIDETREE_H__
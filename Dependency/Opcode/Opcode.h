@@ -56,31 +56,43 @@
 		// Bulk-of-the-work
 		#include "OPC_Settings.h"
 		#include "OPC_Common.h"
+		#include "OPC_SIMD.h"
 		#include "OPC_MeshInterface.h"
 		// Builders
 		#include "OPC_TreeBuilders.h"
+		#include "OPC_Parallel.h"
+		#include "OPC_MappedFile.h"
+		#include "OPC_Refit.h"
 		// Trees
 		#include "OPC_AABBTree.h"
 		#include "OPC_OptimizedTree.h"
+		#include "OPC_WideTree.h"
 		// Models
 		#include "OPC_BaseModel.h"
 		#include "OPC_Model.h"
 		#include "OPC_HybridModel.h"
+		#include "OPC_Heightfield.h"
 		// Colliders
 		#include "OPC_Collider.h"
 		#include "OPC_VolumeCollider.h"
 		#include "OPC_TreeCollider.h"
 		#include "OPC_RayCollider.h"
+		#include "OPC_BatchRayCollider.h"
 		#include "OPC_SphereCollider.h"
 		#include "OPC_OBBCollider.h"
 		#include "OPC_AABBCollider.h"
 		#include "OPC_LSSCollider.h"
 		#include "OPC_PlanesCollider.h"
+		#include "OPC_HeightfieldCollider.h"
 		// Usages
 		#include "OPC_Picking.h"
+		#include "OPC_QueryContext.h"
 		// Sweep-and-prune
 		#include "OPC_BoxPruning.h"
 		#include "OPC_SweepAndPrune.h"
+		#include "OPC_ArraySAP.h"
+		// Culling
+		#include "OPC_Culling.h"
 
 		FUNCTION OPCODE_API bool InitOpcode();
 		FUNCTION OPCODE_API bool CloseOpcode();
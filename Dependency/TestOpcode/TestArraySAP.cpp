@@ -0,0 +1,287 @@
+// TestArraySAP.cpp : Tests and benchmark for the ArraySAP broadphase against SweepAndPrune and box pruning.
+//
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+using namespace Opcode;
+
+#define TEST_STATIC         4000        // Enough boxes for the parallel path
+#define TEST_MOVING         1000
+#define TEST_FRAMES         30
+#define BENCH_STATIC        8000
+#define BENCH_MOVING        2000
+#define BENCH_FRAMES        100
+#define SCENE_SIZE          1000.0f
+
+//-----------------------------------------------------------------------------
+// Scene
+//
+// Static doodads and moving creatures scattered over a map. The creatures walk in
+// straight lines and bounce off the map borders.
+
+struct TScene
+{
+	std::vector<AABB> Boxes;
+	std::vector<const AABB*> BoxPointers;
+	std::vector<Point> Centers;
+	std::vector<Point> Extents;
+	std::vector<Point> Velocities;
+	std::vector<udword> Moving;         // Indices of the moving boxes
+	std::vector<AABB> MovingBoxes;      // Their boxes, in the same order
+};
+
+static void MakeScene(udword nStatic, udword nMoving, TScene& Scene)
+{
+	udword nBoxes = nStatic + nMoving;
+
+	Scene.Boxes.resize(nBoxes);
+	Scene.BoxPointers.resize(nBoxes);
+	Scene.Centers.resize(nBoxes);
+	Scene.Extents.resize(nBoxes);
+	Scene.Velocities.resize(nBoxes);
+
+	for(udword i = 0; i < nBoxes; i++)
+	{
+		Scene.Centers[i] = Point(TestRandom() * SCENE_SIZE, TestRandom() * 20.0f, TestRandom() * SCENE_SIZE);
+		Scene.Extents[i] = Point(1.0f + TestRandom() * 4.0f, 1.0f + TestRandom() * 4.0f, 1.0f + TestRandom() * 4.0f);
+		if(i >= nStatic)
+			Scene.Velocities[i] = Point(TestRandom() - 0.5f, 0.0f, TestRandom() - 0.5f) * 4.0f;
+		else
+			Scene.Velocities[i].Zero();
+
+		Scene.Boxes[i].SetCenterExtents(Scene.Centers[i], Scene.Extents[i]);
+		Scene.BoxPointers[i] = &Scene.Boxes[i];
+	}
+
+	for(udword i = nStatic; i < nBoxes; i++)
+		Scene.Moving.push_back(i);
+	Scene.MovingBoxes.resize(nMoving);
+}
+
+static void MoveScene(TScene& Scene)
+{
+	for(size_t k = 0; k < Scene.Moving.size(); k++)
+	{
+		udword i = Scene.Moving[k];
+		Point& Center = Scene.Centers[i];
+		Point& Velocity = Scene.Velocities[i];
+
+		Center += Velocity;
+		if(Center.x < 0.0f || Center.x > SCENE_SIZE)
+			Velocity.x = -Velocity.x;
+		if(Center.z < 0.0f || Center.z > SCENE_SIZE)
+			Velocity.z = -Velocity.z;
+
+		Scene.Boxes[i].SetCenterExtents(Center, Scene.Extents[i]);
+		Scene.MovingBoxes[k] = Scene.Boxes[i];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Pair sets
+
+typedef std::vector<std::pair<udword, udword> > TPairSet;
+
+static void MakePairSet(udword nPairs, const Pair* pPairs, TPairSet& PairSet)
+{
+	PairSet.clear();
+	for(udword i = 0; i < nPairs; i++)
+	{
+		udword id0 = pPairs[i].id0;
+		udword id1 = pPairs[i].id1;
+
+		PairSet.push_back((id0 < id1) ? std::make_pair(id0, id1) : std::make_pair(id1, id0));
+	}
+	std::sort(PairSet.begin(), PairSet.end());
+}
+
+static void MakePairSet(const Pairs& PairList, TPairSet& PairSet)
+{
+	MakePairSet(PairList.GetNbPairs(), PairList.GetPairs(), PairSet);
+}
+
+// Pairs of First that are not in Second
+static void Difference(const TPairSet& First, const TPairSet& Second, TPairSet& Result)
+{
+	Result.clear();
+	std::set_difference(First.begin(), First.end(), Second.begin(), Second.end(), std::back_inserter(Result));
+}
+
+// Brute force reference. It compares the min & max points like the sweeps do:
+// AABB::Intersect works on centers & extents, and rounds differently for boxes
+// that just touch.
+static void BruteForcePairs(const TScene& Scene, TPairSet& PairSet)
+{
+	udword nBoxes = (udword)Scene.Boxes.size();
+	std::vector<Point> Min(nBoxes), Max(nBoxes);
+
+	for(udword i = 0; i < nBoxes; i++)
+	{
+		Scene.Boxes[i].GetMin(Min[i]);
+		Scene.Boxes[i].GetMax(Max[i]);
+	}
+
+	PairSet.clear();
+	for(udword i = 0; i < nBoxes; i++)
+	{
+		for(udword j = i + 1; j < nBoxes; j++)
+		{
+			if(Min[j].x <= Max[i].x && Min[i].x <= Max[j].x
+			&& Min[j].y <= Max[i].y && Min[i].y <= Max[j].y
+			&& Min[j].z <= Max[i].z && Min[i].z <= Max[j].z)
+				PairSet.push_back(std::make_pair(i, j));
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Test
+
+// Every frame, ArraySAP must find the pairs of a brute force test, and the created
+// & deleted pairs must be the changes since last frame. SweepAndPrune is only
+// benchmarked: it may drop boxes that just touch, depending on the order of their
+// end points.
+bool TestArraySAP()
+{
+	TScene Scene;
+	ArraySAP ASAP;
+	TPairSet Previous;
+	udword nMismatches = 0;
+	udword nChangeMismatches = 0;
+	bool bSucceed = true;
+
+	MakeScene(TEST_STATIC, TEST_MOVING, Scene);
+	ASAP.SetNbThreads(4);
+	if(!ASAP.Init((udword)Scene.Boxes.size(), &Scene.BoxPointers[0]))
+	{
+		printf("  failed to initialize the broadphase\n");
+		bSucceed = false;
+	}
+	MakePairSet(ASAP.GetNbPairs(), ASAP.GetPairs(), Previous);
+
+	for(udword f = 0; f < TEST_FRAMES && bSucceed; f++)
+	{
+		TPairSet Expected, Current, Other, Created, Deleted;
+
+		MoveScene(Scene);
+		ASAP.UpdateObjects((udword)Scene.Moving.size(), &Scene.Moving[0], &Scene.MovingBoxes[0]);
+		if(!ASAP.UpdatePairs())
+		{
+			printf("  UpdatePairs failed\n");
+			bSucceed = false;
+			break;
+		}
+		BruteForcePairs(Scene, Expected);
+
+		MakePairSet(ASAP.GetNbPairs(), ASAP.GetPairs(), Current);
+		if(Current != Expected)
+			nMismatches++;
+
+		MakePairSet(ASAP.GetCreatedPairs(), Created);
+		MakePairSet(ASAP.GetDeletedPairs(), Deleted);
+		Difference(Current, Previous, Other);
+		if(Created != Other)
+			nChangeMismatches++;
+		Difference(Previous, Current, Other);
+		if(Deleted != Other)
+			nChangeMismatches++;
+
+		Previous.swap(Current);
+	}
+
+	if(nMismatches || nChangeMismatches)
+	{
+		printf("  %u wrong pair sets, %u wrong created or deleted pairs\n", nMismatches, nChangeMismatches);
+		bSucceed = false;
+	}
+
+	printf("%-24s: %s\n", "array sap", bSucceed ? "OK" : "FAILED");
+	return bSucceed;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+
+// Time per frame to update the moving boxes and get the pairs
+void BenchArraySAP()
+{
+	TScene Scene;
+	ArraySAP ASAP;
+	ArraySAP SerialASAP;
+	SweepAndPrune SAP;
+	udword nBoxes;
+	udword nPairs = 0;
+	udword nCreated = 0;
+	udword nDeleted = 0;
+	double dfASAP = 0.0;
+	double dfSerialASAP = 0.0;
+	double dfSAP = 0.0;
+	double dfPruning = 0.0;
+	double dfStart;
+
+	MakeScene(BENCH_STATIC, BENCH_MOVING, Scene);
+	nBoxes = (udword)Scene.Boxes.size();
+
+	printf("broadphase, %u boxes, %u moving (ms):\n", nBoxes, BENCH_MOVING);
+
+	dfStart = TestTime();
+	ASAP.Init(nBoxes, &Scene.BoxPointers[0]);
+	printf("  %-24s: %8.3f\n", "init, array sap", (TestTime() - dfStart) * 1000.0);
+
+	dfStart = TestTime();
+	SAP.Init(nBoxes, &Scene.BoxPointers[0]);
+	printf("  %-24s: %8.3f\n", "init, sweep and prune", (TestTime() - dfStart) * 1000.0);
+
+	SerialASAP.SetNbThreads(1);
+	SerialASAP.Init(nBoxes, &Scene.BoxPointers[0]);
+
+	for(udword f = 0; f < BENCH_FRAMES; f++)
+	{
+		MoveScene(Scene);
+
+		dfStart = TestTime();
+		ASAP.UpdateObjects(BENCH_MOVING, &Scene.Moving[0], &Scene.MovingBoxes[0]);
+		ASAP.UpdatePairs();
+		dfASAP += TestTime() - dfStart;
+
+		dfStart = TestTime();
+		SerialASAP.UpdateObjects(BENCH_MOVING, &Scene.Moving[0], &Scene.MovingBoxes[0]);
+		SerialASAP.UpdatePairs();
+		dfSerialASAP += TestTime() - dfStart;
+
+		dfStart = TestTime();
+		{
+			Pairs SAPPairs;
+
+			for(udword k = 0; k < BENCH_MOVING; k++)
+				SAP.UpdateObject(Scene.Moving[k], Scene.MovingBoxes[k]);
+			SAP.GetPairs(SAPPairs);
+		}
+		dfSAP += TestTime() - dfStart;
+
+		dfStart = TestTime();
+		{
+			Pairs PruningPairs;
+
+			CompleteBoxPruning(nBoxes, &Scene.BoxPointers[0], PruningPairs, Axes(AXES_XZY));
+		}
+		dfPruning += TestTime() - dfStart;
+
+		nPairs += ASAP.GetNbPairs();
+		nCreated += ASAP.GetCreatedPairs().GetNbPairs();
+		nDeleted += ASAP.GetDeletedPairs().GetNbPairs();
+	}
+
+	printf("  %-24s: %8.3f\n", "frame, array sap", dfASAP * 1000.0 / BENCH_FRAMES);
+	printf("  %-24s: %8.3f\n", "frame, array sap serial", dfSerialASAP * 1000.0 / BENCH_FRAMES);
+	printf("  %-24s: %8.3f\n", "frame, sweep and prune", dfSAP * 1000.0 / BENCH_FRAMES);
+	printf("  %-24s: %8.3f\n", "frame, box pruning", dfPruning * 1000.0 / BENCH_FRAMES);
+	printf("  %u pairs, %u created and %u deleted per frame\n", nPairs / BENCH_FRAMES, nCreated / BENCH_FRAMES, nDeleted / BENCH_FRAMES);
+}
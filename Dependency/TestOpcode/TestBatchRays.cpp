@@ -0,0 +1,267 @@
+// TestBatchRays.cpp : Tests and benchmark for BatchRayCollider against a loop of RayCollider::Collide.
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <vector>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+using namespace Opcode;
+
+#define TEST_GRID           128         // Terrain cells on each side
+#define TEST_BUILDINGS      2000
+#define TEST_RAYS           8192
+#define BENCH_GRID          400
+#define BENCH_BUILDINGS     20000
+#define BENCH_RAYS          200000      // Incoherent rays
+#define BENCH_VIEW          512         // Coherent rays, one per pixel of a square view
+
+//-----------------------------------------------------------------------------
+// Rays
+
+// Rays cast down from above the scene in random directions
+static void MakeRandomRays(udword Grid, udword nRays, std::vector<Ray>& Rays)
+{
+	for(udword i = 0; i < nRays; i++)
+	{
+		Point Dir(TestRandom() - 0.5f, -0.3f - TestRandom(), TestRandom() - 0.5f);
+		Point Orig(TestRandom() * Grid, 40.0f + TestRandom() * 20.0f, TestRandom() * Grid);
+
+		Rays.push_back(Ray(Orig, Dir.Normalize()));
+	}
+}
+
+// Camera rays over the terrain, in 2x2 pixel tiles so that each packet gets neighbouring pixels
+static void MakeViewRays(udword Grid, udword View, std::vector<Ray>& Rays)
+{
+	Point Eye(Grid * 0.5f, 60.0f, -20.0f);
+
+	for(udword ty = 0; ty < View; ty += 2)
+	{
+		for(udword tx = 0; tx < View; tx += 2)
+		{
+			for(udword k = 0; k < 4; k++)
+			{
+				udword x = tx + (k & 1);
+				udword y = ty + (k >> 1);
+				Point Dir((x - View * 0.5f) / View, -0.2f - 0.5f * y / View, 1.0f);
+
+				Rays.push_back(Ray(Eye, Dir.Normalize()));
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Reference: one RayCollider::Collide per ray
+
+struct THit
+{
+	float Distance;
+	udword FaceID;
+};
+
+static void RecordHit(const CollisionFace& Hit, void* pUserData)
+{
+	THit* pHit = (THit*)pUserData;
+
+	if(Hit.mDistance < pHit->Distance)
+	{
+		pHit->Distance = Hit.mDistance;
+		pHit->FaceID = Hit.mFaceID;
+	}
+}
+
+static void CollideLoop(const std::vector<Ray>& Rays, const Model& TestModel, bool bAnyHit, std::vector<THit>& Hits)
+{
+	RayCollider Collider;
+
+	Collider.SetFirstContact(bAnyHit);
+	Collider.SetCulling(false);
+	Collider.SetHitCallback(RecordHit);
+
+	Hits.resize(Rays.size());
+	for(size_t i = 0; i < Rays.size(); i++)
+	{
+		Hits[i].Distance = MAX_FLOAT;
+		Hits[i].FaceID = INVALID_ID;
+		Collider.SetUserData(&Hits[i]);
+		Collider.Collide(Rays[i], TestModel);
+	}
+}
+
+static bool CollideBatch(const std::vector<Ray>& Rays, const Model& TestModel, bool bAnyHit, bool bPackets, std::vector<CollisionFace>& Hits)
+{
+	BatchRayCollider Collider;
+
+	Collider.SetCulling(false);
+	Collider.SetAnyHit(bAnyHit);
+	Collider.SetPackets(bPackets);
+
+	Hits.resize(Rays.size());
+	return Collider.Collide((udword)Rays.size(), &Rays[0], TestModel, &Hits[0]);
+}
+
+// Rays where the batch missed what the loop hit or the other way round. In closest
+// hit mode a different face only counts if it is not at the same distance.
+static udword CountDiffs(const std::vector<THit>& Expected, const std::vector<CollisionFace>& Hits, bool bAnyHit)
+{
+	udword nDiffs = 0;
+
+	for(size_t i = 0; i < Expected.size(); i++)
+	{
+		bool bExpected = (Expected[i].FaceID != INVALID_ID);
+		bool bHit = (Hits[i].mFaceID != INVALID_ID);
+
+		if(bExpected != bHit)
+			nDiffs++;
+		else if(!bAnyHit && bHit && Hits[i].mFaceID != Expected[i].FaceID && fabsf(Hits[i].mDistance - Expected[i].Distance) > 1e-4f)
+			nDiffs++;
+	}
+	return nDiffs;
+}
+
+//-----------------------------------------------------------------------------
+// Test
+
+static bool BuildModels(const MeshInterface& Mesh, Model& NormalModel, Model& WideModel)
+{
+	OPCODECREATE Create;
+
+	Create.mIMesh = &Mesh;
+	Create.mNoLeaf = false;
+	Create.mQuantized = false;
+	if(!NormalModel.Build(Create))
+		return false;
+
+	Create.mWideTree = true;
+	return WideModel.Build(Create);
+}
+
+// Every batch mode must find the hits of the loop, on the wide tree and on the
+// fallback path for other trees
+bool TestBatchRays()
+{
+	std::vector<Point> Vertices;
+	std::vector<IndexedTriangle> Triangles;
+	std::vector<Ray> Rays;
+	MeshInterface Mesh;
+	Model NormalModel;
+	Model WideModel;
+	bool bSucceed = true;
+
+	MakeTestMesh(TEST_GRID, TEST_BUILDINGS, Vertices, Triangles);
+	Mesh.SetNbTriangles((udword)Triangles.size());
+	Mesh.SetNbVertices((udword)Vertices.size());
+	Mesh.SetPointers(&Triangles[0], &Vertices[0]);
+
+	if(!BuildModels(Mesh, NormalModel, WideModel))
+	{
+		printf("  failed to build the models\n");
+		return false;
+	}
+
+	MakeRandomRays(TEST_GRID, TEST_RAYS / 2, Rays);
+	MakeViewRays(TEST_GRID, 64, Rays);
+
+	for(int i = 0; i < 2; i++)
+	{
+		bool bAnyHit = (i != 0);
+		std::vector<THit> Expected;
+		std::vector<CollisionFace> Hits;
+		udword nDiffs = 0;
+		bool bResult = true;
+
+		CollideLoop(Rays, NormalModel, bAnyHit, Expected);
+
+		for(int Mode = 0; Mode < 3 && bResult; Mode++)
+		{
+			const Model& TestModel = (Mode < 2) ? WideModel : NormalModel;
+
+			bResult = CollideBatch(Rays, TestModel, bAnyHit, Mode == 1, Hits);
+			if(bResult)
+				nDiffs += CountDiffs(Expected, Hits, bAnyHit);
+		}
+
+		if(nDiffs)
+		{
+			printf("  %u rays got other hits\n", nDiffs);
+			bResult = false;
+		}
+
+		printf("%-24s: %s\n", bAnyHit ? "batch rays, any hit" : "batch rays, closest hit", bResult ? "OK" : "FAILED");
+		if(!bResult)
+			bSucceed = false;
+	}
+	return bSucceed;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+
+static double RaysPerSecond(size_t nRays, double dfStart)
+{
+	return nRays / (TestTime() - dfStart);
+}
+
+// Rays per second for the loop and the batch modes, on incoherent and camera rays
+void BenchBatchRays()
+{
+	std::vector<Point> Vertices;
+	std::vector<IndexedTriangle> Triangles;
+	MeshInterface Mesh;
+	Model NormalModel;
+	Model WideModel;
+
+	MakeTestMesh(BENCH_GRID, BENCH_BUILDINGS, Vertices, Triangles);
+	Mesh.SetNbTriangles((udword)Triangles.size());
+	Mesh.SetNbVertices((udword)Vertices.size());
+	Mesh.SetPointers(&Triangles[0], &Vertices[0]);
+
+	if(!BuildModels(Mesh, NormalModel, WideModel))
+		return;
+
+	printf("batch rays, %u triangles (rays/s):\n", (udword)Triangles.size());
+	for(int Set = 0; Set < 2; Set++)
+	{
+		std::vector<Ray> Rays;
+
+		if(Set == 0)
+			MakeRandomRays(BENCH_GRID, BENCH_RAYS, Rays);
+		else
+			MakeViewRays(BENCH_GRID, BENCH_VIEW, Rays);
+
+		for(int i = 0; i < 2; i++)
+		{
+			bool bAnyHit = (i != 0);
+			std::vector<THit> Expected;
+			std::vector<CollisionFace> Hits;
+			double dfStart;
+
+			printf("%s rays, %s:\n", Set ? "coherent" : "incoherent", bAnyHit ? "any hit" : "closest hit");
+
+			dfStart = TestTime();
+			CollideLoop(Rays, NormalModel, bAnyHit, Expected);
+			printf("  %-22s: %10.0f\n", "loop, normal tree", RaysPerSecond(Rays.size(), dfStart));
+
+			dfStart = TestTime();
+			CollideLoop(Rays, WideModel, bAnyHit, Expected);
+			printf("  %-22s: %10.0f\n", "loop, wide tree", RaysPerSecond(Rays.size(), dfStart));
+
+			dfStart = TestTime();
+			CollideBatch(Rays, WideModel, bAnyHit, false, Hits);
+			printf("  %-22s: %10.0f\n", "batch, wide tree", RaysPerSecond(Rays.size(), dfStart));
+
+			dfStart = TestTime();
+			CollideBatch(Rays, WideModel, bAnyHit, true, Hits);
+			printf("  %-22s: %10.0f\n", "batch packets", RaysPerSecond(Rays.size(), dfStart));
+
+			dfStart = TestTime();
+			CollideBatch(Rays, NormalModel, bAnyHit, false, Hits);
+			printf("  %-22s: %10.0f\n", "batch, normal tree", RaysPerSecond(Rays.size(), dfStart));
+		}
+	}
+}
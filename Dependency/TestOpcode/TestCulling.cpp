@@ -0,0 +1,436 @@
+// TestCulling.cpp : Tests and benchmark for CullingScene frustum & occlusion culling.
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+using namespace Opcode;
+
+#define WORLD_SIZE          4096.0f     // Instances are scattered over a square map
+#define TEST_INSTANCES      20000
+#define TEST_WALLS          100
+#define TEST_VIEWS          8
+#define BENCH_INSTANCES     100000
+#define BENCH_WALLS         300
+#define BENCH_VIEWS         16
+#define BENCH_FRAMES        60
+
+//-----------------------------------------------------------------------------
+// Scene
+//
+// Instances scattered over the map, and walls around the camera. The walls are
+// added as occluders, and kept as boxes to check what they hide.
+
+struct TCullScene
+{
+	std::vector<AABB> Boxes;
+	std::vector<udword> Handles;
+	std::vector<bool> Alive;            // Instances not removed
+	std::vector<AABB> Walls;
+	Point Eye;
+	CullingScene Scene;
+};
+
+static AABB MakeBox(const Point& Center, const Point& Extents)
+{
+	AABB Box;
+
+	Box.SetCenterExtents(Center, Extents);
+	return Box;
+}
+
+static void BoxCorners(const AABB& Box, Point* Corners)
+{
+	Point Min, Max;
+
+	Box.GetMin(Min);
+	Box.GetMax(Max);
+	for(udword k = 0; k < 8; k++)
+		Corners[k] = Point((k & 1) ? Max.x : Min.x, (k & 2) ? Max.y : Min.y, (k & 4) ? Max.z : Min.z);
+}
+
+static void AddInstances(TCullScene& Scene, udword nInstances)
+{
+	for(udword i = 0; i < nInstances; i++)
+	{
+		Point Center(TestRandom() * WORLD_SIZE, TestRandom() * 40.0f, TestRandom() * WORLD_SIZE);
+		Point Extents(0.5f + TestRandom() * 5.0f, 0.5f + TestRandom() * 5.0f, 0.5f + TestRandom() * 5.0f);
+
+		Scene.Boxes.push_back(MakeBox(Center, Extents));
+		Scene.Handles.push_back(Scene.Scene.AddInstance(Scene.Boxes.back()));
+		Scene.Alive.push_back(true);
+	}
+}
+
+// Thin walls at 40 to 640 units from the camera, along X or Z
+static void AddWalls(TCullScene& Scene, udword nWalls)
+{
+	static const udword BoxFaces[36] =
+	{
+		0,1,3, 0,3,2, 4,6,7, 4,7,5, 0,4,5, 0,5,1,
+		2,3,7, 2,7,6, 0,2,6, 0,6,4, 1,5,7, 1,7,3
+	};
+
+	for(udword i = 0; i < nWalls; i++)
+	{
+		float Angle = TestRandom() * 6.283f;
+		float Distance = 40.0f + TestRandom() * 600.0f;
+		Point Center(Scene.Eye.x + cosf(Angle) * Distance, 15.0f, Scene.Eye.z + sinf(Angle) * Distance);
+		bool bAlongX = (TestRandom() < 0.5f);
+		Point Extents(bAlongX ? 30.0f + TestRandom() * 30.0f : 2.0f, 15.0f + TestRandom() * 10.0f, bAlongX ? 2.0f : 30.0f + TestRandom() * 30.0f);
+		Point Corners[8];
+
+		Scene.Walls.push_back(MakeBox(Center, Extents));
+		BoxCorners(Scene.Walls.back(), Corners);
+		Scene.Scene.AddOccluder(Corners, BoxFaces, 12);
+	}
+}
+
+static void MakeCullScene(TCullScene& Scene, udword nInstances, udword nWalls)
+{
+	Scene.Eye = Point(WORLD_SIZE * 0.5f, 15.0f, WORLD_SIZE * 0.5f);
+	AddInstances(Scene, nInstances);
+	AddWalls(Scene, nWalls);
+	Scene.Scene.Update();
+}
+
+// Moves some random instances on the ground
+static void MoveInstances(TCullScene& Scene, udword nMoves, float Distance)
+{
+	for(udword k = 0; k < nMoves; k++)
+	{
+		udword i = (udword)(TestRandom() * Scene.Boxes.size()) % (udword)Scene.Boxes.size();
+		Point Center, Extents;
+
+		if(!Scene.Alive[i])
+			continue;
+
+		Scene.Boxes[i].GetCenter(Center);
+		Scene.Boxes[i].GetExtents(Extents);
+		Center += Point(TestRandom() - 0.5f, 0.0f, TestRandom() - 0.5f) * Distance;
+		Scene.Boxes[i] = MakeBox(Center, Extents);
+		Scene.Scene.UpdateInstance(Scene.Handles[i], Scene.Boxes[i]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Views
+
+// Camera at the eye looking around the horizon: view i of nViews
+static Matrix4x4 MakeViewProj(const Point& Eye, udword View, udword nViews)
+{
+	const float Fov = 1.2f;
+	const float Aspect = 2.0f;
+	const float ZNear = 1.0f;
+	const float ZFar = 1500.0f;
+	float Angle = View * 6.283f / nViews;
+	Point Front(cosf(Angle), -0.05f, sinf(Angle));
+	Point Right, Up;
+	Matrix4x4 ViewMatrix, Proj;
+
+	Front.Normalize();
+	Right = Point(0.0f, 1.0f, 0.0f) ^ Front;
+	Right.Normalize();
+	Up = Front ^ Right;
+
+	ViewMatrix.Identity();
+	ViewMatrix.m[0][0] = Right.x;	ViewMatrix.m[0][1] = Up.x;	ViewMatrix.m[0][2] = Front.x;
+	ViewMatrix.m[1][0] = Right.y;	ViewMatrix.m[1][1] = Up.y;	ViewMatrix.m[1][2] = Front.y;
+	ViewMatrix.m[2][0] = Right.z;	ViewMatrix.m[2][1] = Up.z;	ViewMatrix.m[2][2] = Front.z;
+	ViewMatrix.m[3][0] = -(Eye | Right);
+	ViewMatrix.m[3][1] = -(Eye | Up);
+	ViewMatrix.m[3][2] = -(Eye | Front);
+
+	// D3D projection, 0 <= z <= w
+	float YScale = 1.0f / tanf(Fov * 0.5f);
+	Proj.Zero();
+	Proj.m[0][0] = YScale / Aspect;
+	Proj.m[1][1] = YScale;
+	Proj.m[2][2] = ZFar / (ZFar - ZNear);
+	Proj.m[2][3] = 1.0f;
+	Proj.m[3][2] = -ZNear * ZFar / (ZFar - ZNear);
+	return ViewMatrix * Proj;
+}
+
+// Frustum planes of a view-projection matrix, normals pointing outwards
+static void FrustumPlanes(const Matrix4x4& ViewProj, Plane* Planes)
+{
+	const float (*m)[4] = ViewProj.m;
+
+	Planes[0].Set(-m[0][2], -m[1][2], -m[2][2], -m[3][2]);
+	Planes[1].Set(-(m[0][3] + m[0][0]), -(m[1][3] + m[1][0]), -(m[2][3] + m[2][0]), -(m[3][3] + m[3][0]));
+	Planes[2].Set(-(m[0][3] - m[0][0]), -(m[1][3] - m[1][0]), -(m[2][3] - m[2][0]), -(m[3][3] - m[3][0]));
+	Planes[3].Set(-(m[0][3] + m[0][1]), -(m[1][3] + m[1][1]), -(m[2][3] + m[2][1]), -(m[3][3] + m[3][1]));
+	Planes[4].Set(-(m[0][3] - m[0][1]), -(m[1][3] - m[1][1]), -(m[2][3] - m[2][1]), -(m[3][3] - m[3][1]));
+	Planes[5].Set(-(m[0][3] - m[0][2]), -(m[1][3] - m[1][2]), -(m[2][3] - m[2][2]), -(m[3][3] - m[3][2]));
+	for(udword i = 0; i < 6; i++)
+		Planes[i].Normalize();
+}
+
+static bool BoxInFrustum(const AABB& Box, const Plane* Planes)
+{
+	Point Center, Extents;
+
+	Box.GetCenter(Center);
+	Box.GetExtents(Extents);
+	for(udword i = 0; i < 6; i++)
+	{
+		const Point& n = Planes[i].n;
+
+		if(Extents.x * fabsf(n.x) + Extents.y * fabsf(n.y) + Extents.z * fabsf(n.z) < (Center | n) + Planes[i].d)
+			return false;
+	}
+	return true;
+}
+
+// Brute force frustum culling, sorted handles
+static void CullBruteForce(const TCullScene& Scene, const Matrix4x4& ViewProj, std::vector<udword>& Visible)
+{
+	Plane Planes[6];
+
+	FrustumPlanes(ViewProj, Planes);
+	Visible.clear();
+	for(size_t i = 0; i < Scene.Boxes.size(); i++)
+	{
+		if(Scene.Alive[i] && BoxInFrustum(Scene.Boxes[i], Planes))
+			Visible.push_back(Scene.Handles[i]);
+	}
+	std::sort(Visible.begin(), Visible.end());
+}
+
+static void SortedHandles(const Container& Visible, std::vector<udword>& Handles)
+{
+	Handles.assign(Visible.GetEntries(), Visible.GetEntries() + Visible.GetNbEntries());
+	std::sort(Handles.begin(), Handles.end());
+}
+
+//-----------------------------------------------------------------------------
+// Occlusion check
+
+// Whether the segment hits the box before reaching its end point
+static bool SegmentHitsBox(const Point& Start, const Point& End, const AABB& Box)
+{
+	Point Min, Max;
+	Point Dir = End - Start;
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+
+	Box.GetMin(Min);
+	Box.GetMax(Max);
+	for(udword k = 0; k < 3; k++)
+	{
+		if(fabsf(Dir[k]) < 1e-12f)
+		{
+			if(Start[k] < Min[k] || Start[k] > Max[k])
+				return false;
+			continue;
+		}
+
+		float ta = (Min[k] - Start[k]) / Dir[k];
+		float tb = (Max[k] - Start[k]) / Dir[k];
+		t0 = std::max(t0, std::min(ta, tb));
+		t1 = std::min(t1, std::max(ta, tb));
+		if(t0 > t1)
+			return false;
+	}
+	return t0 < 0.999f;
+}
+
+// An occluded instance must not have any point in the frustum that the eye can see
+static bool IsHidden(const TCullScene& Scene, const AABB& Box, const Matrix4x4& ViewProj)
+{
+	Point Min, Max;
+
+	Box.GetMin(Min);
+	Box.GetMax(Max);
+	for(udword i = 0; i < 27; i++)
+	{
+		Point p(Min.x + (Max.x - Min.x) * (i % 3) * 0.5f, Min.y + (Max.y - Min.y) * (i / 3 % 3) * 0.5f, Min.z + (Max.z - Min.z) * (i / 9) * 0.5f);
+		HPoint Clip = HPoint(p.x, p.y, p.z, 1.0f) * ViewProj;
+		bool bHidden = false;
+
+		if(Clip.w <= 0.0f || Clip.x < -Clip.w || Clip.x > Clip.w || Clip.y < -Clip.w || Clip.y > Clip.w || Clip.z < 0.0f || Clip.z > Clip.w)
+			continue;
+
+		for(size_t w = 0; w < Scene.Walls.size() && !bHidden; w++)
+			bHidden = SegmentHitsBox(Scene.Eye, p, Scene.Walls[w]);
+		if(!bHidden)
+			return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Test
+
+// Frustum culling must find what a brute force test finds, and occlusion culling
+// must only drop hidden instances
+static bool TestViews(TCullScene& Scene, udword& nOccluded)
+{
+	Container Visible;
+	std::vector<udword> Expected, Frustum, Occlusion;
+	udword nMismatches = 0;
+	udword nWrong = 0;
+
+	nOccluded = 0;
+	for(udword v = 0; v < TEST_VIEWS; v++)
+	{
+		Matrix4x4 ViewProj = MakeViewProj(Scene.Eye, v, TEST_VIEWS);
+
+		CullBruteForce(Scene, ViewProj, Expected);
+		Scene.Scene.Cull(ViewProj, Visible, false);
+		SortedHandles(Visible, Frustum);
+		if(Frustum != Expected)
+			nMismatches++;
+
+		Scene.Scene.Cull(ViewProj, Visible, true);
+		SortedHandles(Visible, Occlusion);
+		for(size_t i = 0; i < Scene.Boxes.size(); i++)
+		{
+			udword Handle = Scene.Handles[i];
+
+			if(!Scene.Alive[i] || !std::binary_search(Expected.begin(), Expected.end(), Handle) || std::binary_search(Occlusion.begin(), Occlusion.end(), Handle))
+				continue;
+
+			nOccluded++;
+			if(!IsHidden(Scene, Scene.Boxes[i], ViewProj))
+				nWrong++;
+		}
+	}
+
+	if(nMismatches || nWrong)
+		printf("  %u views with other visible instances, %u visible instances occluded\n", nMismatches, nWrong);
+	return !nMismatches && !nWrong;
+}
+
+bool TestCulling()
+{
+	TCullScene Scene;
+	udword nOccluded;
+	bool bResult;
+	bool bSucceed = true;
+
+	MakeCullScene(Scene, TEST_INSTANCES, TEST_WALLS);
+
+	bResult = TestViews(Scene, nOccluded);
+	if(bResult && !nOccluded)
+	{
+		printf("  nothing occluded\n");
+		bResult = false;
+	}
+	printf("%-24s: %s\n", "culling, static scene", bResult ? "OK" : "FAILED");
+	bSucceed = bSucceed && bResult;
+
+	// Refits, removals and additions, then enough moves to rebuild the tree
+	MoveInstances(Scene, TEST_INSTANCES / 10, 8.0f);
+	Scene.Scene.Update();
+	for(udword k = 0; k < TEST_INSTANCES / 20; k++)
+	{
+		udword i = (udword)(TestRandom() * TEST_INSTANCES) % TEST_INSTANCES;
+
+		if(Scene.Alive[i])
+		{
+			Scene.Scene.RemoveInstance(Scene.Handles[i]);
+			Scene.Alive[i] = false;
+		}
+	}
+	AddInstances(Scene, TEST_INSTANCES / 40);
+	Scene.Scene.Update();
+	for(udword f = 0; f < 10; f++)
+	{
+		MoveInstances(Scene, TEST_INSTANCES / 5, 200.0f);
+		Scene.Scene.Update();
+	}
+
+	bResult = TestViews(Scene, nOccluded);
+	if(bResult && !Scene.Scene.GetNbRebuilds())
+	{
+		printf("  the tree was never rebuilt\n");
+		bResult = false;
+	}
+	printf("%-24s: %s\n", "culling, moving scene", bResult ? "OK" : "FAILED");
+	return bSucceed && bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+
+// Time per view for brute force, tree frustum culling and tree + occlusion culling,
+// and time per frame to update the tree when instances move
+void BenchCulling()
+{
+	TCullScene Scene;
+	Container Visible;
+	std::vector<udword> Expected;
+	double dfBrute = 0.0;
+	double dfFrustum = 0.0;
+	double dfOcclusion = 0.0;
+	udword nFrustum = 0;
+	udword nOcclusion = 0;
+	udword nRebuilds;
+	double dfStart;
+	double dfUpdate;
+
+	Scene.Eye = Point(WORLD_SIZE * 0.5f, 15.0f, WORLD_SIZE * 0.5f);
+
+	dfStart = TestTime();
+	AddInstances(Scene, BENCH_INSTANCES);
+	dfUpdate = TestTime() - dfStart;
+	dfStart = TestTime();
+	Scene.Scene.Update();
+
+	printf("culling, %u instances, %u occluder triangles (ms):\n", BENCH_INSTANCES, BENCH_WALLS * 12);
+	printf("  %-24s: %8.3f\n", "add instances", dfUpdate * 1000.0);
+	printf("  %-24s: %8.3f, %u nodes, %u bytes\n", "build", (TestTime() - dfStart) * 1000.0, Scene.Scene.GetNbNodes(), Scene.Scene.GetUsedBytes());
+
+	AddWalls(Scene, BENCH_WALLS);
+	for(udword v = 0; v < BENCH_VIEWS; v++)
+	{
+		Matrix4x4 ViewProj = MakeViewProj(Scene.Eye, v, BENCH_VIEWS);
+
+		dfStart = TestTime();
+		CullBruteForce(Scene, ViewProj, Expected);
+		dfBrute += TestTime() - dfStart;
+
+		dfStart = TestTime();
+		Scene.Scene.Cull(ViewProj, Visible, false);
+		dfFrustum += TestTime() - dfStart;
+		nFrustum += Visible.GetNbEntries();
+
+		dfStart = TestTime();
+		Scene.Scene.Cull(ViewProj, Visible, true);
+		dfOcclusion += TestTime() - dfStart;
+		nOcclusion += Visible.GetNbEntries();
+	}
+	printf("  %-24s: %8.3f\n", "view, brute force", dfBrute * 1000.0 / BENCH_VIEWS);
+	printf("  %-24s: %8.3f, %u visible\n", "view, frustum", dfFrustum * 1000.0 / BENCH_VIEWS, nFrustum / BENCH_VIEWS);
+	printf("  %-24s: %8.3f, %u visible\n", "view, occlusion", dfOcclusion * 1000.0 / BENCH_VIEWS, nOcclusion / BENCH_VIEWS);
+
+	nRebuilds = Scene.Scene.GetNbRebuilds();
+	dfUpdate = 0.0;
+	for(udword f = 0; f < BENCH_FRAMES; f++)
+	{
+		MoveInstances(Scene, BENCH_INSTANCES / 10, 8.0f);
+		dfStart = TestTime();
+		Scene.Scene.Update();
+		dfUpdate += TestTime() - dfStart;
+	}
+	printf("  %-24s: %8.3f, %u rebuilds\n", "update, 10% moving", dfUpdate * 1000.0 / BENCH_FRAMES, Scene.Scene.GetNbRebuilds() - nRebuilds);
+
+	nRebuilds = Scene.Scene.GetNbRebuilds();
+	dfUpdate = 0.0;
+	for(udword f = 0; f < BENCH_FRAMES; f++)
+	{
+		MoveInstances(Scene, 200, 2.0f);
+		dfStart = TestTime();
+		Scene.Scene.Update();
+		dfUpdate += TestTime() - dfStart;
+	}
+	printf("  %-24s: %8.3f, %u rebuilds\n", "update, 200 moving", dfUpdate * 1000.0 / BENCH_FRAMES, Scene.Scene.GetNbRebuilds() - nRebuilds);
+}
@@ -0,0 +1,412 @@
+// TestHeightfield.cpp : Tests and benchmark for the heightfield colliders against a model of the same terrain.
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+using namespace Opcode;
+
+#define TERRAIN_CELL_SIZE   4.1666667f  // Size of an ADT cell
+#define TEST_CELLS          64          // Cells on each side
+#define TEST_RAYS           4096
+#define TEST_VOLUMES        2000
+#define BENCH_CELLS         512
+#define BENCH_RAYS          100000
+#define BENCH_VOLUMES       20000
+
+//-----------------------------------------------------------------------------
+// Terrain
+//
+// Rolling terrain with 4 triangles per cell (corner and center heights), and holes
+// in about 1% of the cells. The model gets the same triangles with the same face
+// indices, and degenerate triangles far away for the holes.
+
+struct TTerrain
+{
+	std::vector<float> Heights;
+	std::vector<float> InnerHeights;
+	std::vector<ubyte> Holes;
+	Heightfield Field;
+	std::vector<Point> Vertices;
+	std::vector<IndexedTriangle> Triangles;
+	MeshInterface Mesh;
+	Model TerrainModel;
+	float Extent;
+};
+
+static void MakeHeights(udword nCells, TTerrain& Terrain)
+{
+	Terrain.Heights.resize((nCells + 1) * (nCells + 1));
+	Terrain.InnerHeights.resize(nCells * nCells);
+	Terrain.Holes.assign(nCells * nCells, 0);
+	Terrain.Extent = nCells * TERRAIN_CELL_SIZE;
+
+	for(udword z = 0; z <= nCells; z++)
+	{
+		for(udword x = 0; x <= nCells; x++)
+			Terrain.Heights[x + z * (nCells + 1)] = 20.0f * sinf(x * 0.03f) * cosf(z * 0.02f) + 3.0f * sinf(x * 0.3f + z * 0.2f) + TestRandom() * 0.5f;
+	}
+
+	for(udword z = 0; z < nCells; z++)
+	{
+		for(udword x = 0; x < nCells; x++)
+		{
+			const float* Corner = &Terrain.Heights[x + z * (nCells + 1)];
+			Terrain.InnerHeights[x + z * nCells] = 0.25f * (Corner[0] + Corner[1] + Corner[nCells + 1] + Corner[nCells + 2]) + TestRandom() * 0.5f - 0.25f;
+		}
+	}
+
+	for(udword i = 0; i < nCells * nCells / 100; i++)
+		Terrain.Holes[(udword)(TestRandom() * nCells * nCells) % (nCells * nCells)] = 1;
+}
+
+static bool InitField(udword nCells, TTerrain& Terrain)
+{
+	HeightfieldDesc Desc;
+
+	Desc.mNbCellsX = nCells;
+	Desc.mNbCellsZ = nCells;
+	Desc.mHeights = &Terrain.Heights[0];
+	Desc.mInnerHeights = &Terrain.InnerHeights[0];
+	Desc.mHoles = &Terrain.Holes[0];
+	Desc.mCellSize = TERRAIN_CELL_SIZE;
+	Desc.mOrigin = Point(-100.0f, 5.0f, -50.0f);
+	return Terrain.Field.Init(Desc);
+}
+
+static bool BuildModel(TTerrain& Terrain)
+{
+	OPCODECREATE Create;
+	Point CellVertices[HF_MAX_CELL_TRIANGLES * 3];
+
+	Terrain.Vertices.clear();
+	Terrain.Triangles.clear();
+	for(udword c = 0; c < Terrain.Field.GetNbCells(); c++)
+	{
+		udword nTriangles = Terrain.Field.GetCellTriangles(c, CellVertices);
+
+		for(udword k = 0; k < HF_MAX_CELL_TRIANGLES; k++)
+		{
+			IndexedTriangle Triangle;
+
+			for(udword j = 0; j < 3; j++)
+			{
+				Triangle.mVRef[j] = (udword)Terrain.Vertices.size();
+				Terrain.Vertices.push_back(nTriangles ? CellVertices[k * 3 + j] : Point(-1e4f, -1e4f, -1e4f));
+			}
+			Terrain.Triangles.push_back(Triangle);
+		}
+	}
+
+	Terrain.Mesh.SetNbTriangles((udword)Terrain.Triangles.size());
+	Terrain.Mesh.SetNbVertices((udword)Terrain.Vertices.size());
+	Terrain.Mesh.SetPointers(&Terrain.Triangles[0], &Terrain.Vertices[0]);
+
+	Create.mIMesh = &Terrain.Mesh;
+	Create.mNoLeaf = true;
+	Create.mQuantized = true;
+	return Terrain.TerrainModel.Build(Create);
+}
+
+static bool MakeTerrain(udword nCells, TTerrain& Terrain)
+{
+	MakeHeights(nCells, Terrain);
+	return InitField(nCells, Terrain) && BuildModel(Terrain);
+}
+
+// Picking rays from above the terrain, looking down at various angles
+static void MakeRays(const TTerrain& Terrain, udword nRays, std::vector<Ray>& Rays)
+{
+	const Point& Origin = Terrain.Field.GetOrigin();
+
+	for(udword i = 0; i < nRays; i++)
+	{
+		Point Dir(TestRandom() - 0.5f, -0.15f - TestRandom(), TestRandom() - 0.5f);
+		Point Orig(Origin.x + TestRandom() * Terrain.Extent, 60.0f + TestRandom() * 40.0f, Origin.z + TestRandom() * Terrain.Extent);
+
+		Rays.push_back(Ray(Orig, Dir.Normalize()));
+	}
+}
+
+static float GroundHeight(const Heightfield& Field, float x, float z)
+{
+	HeightfieldRayCollider Collider;
+	CollisionFace Hit;
+
+	SetupClosestHit(Collider, Hit);
+	Collider.Collide(Ray(Point(x, 1000.0f, z), Point(0.0f, -1.0f, 0.0f)), Field);
+	return (Hit.mDistance < MAX_FLOAT) ? 1000.0f - Hit.mDistance : 0.0f;
+}
+
+// Character capsules standing on the ground, some of them a bit above or below it
+static void MakeCapsules(const TTerrain& Terrain, udword nCapsules, std::vector<LSS>& Capsules)
+{
+	const Point& Origin = Terrain.Field.GetOrigin();
+
+	for(udword i = 0; i < nCapsules; i++)
+	{
+		float x = Origin.x + TestRandom() * Terrain.Extent;
+		float z = Origin.z + TestRandom() * Terrain.Extent;
+		float y = GroundHeight(Terrain.Field, x, z) + TestRandom() * 1.2f - 0.3f;
+		float dx = (TestRandom() - 0.5f) * 0.6f;
+		float dz = (TestRandom() - 0.5f) * 0.6f;
+
+		Capsules.push_back(LSS(Segment(Point(x, y + 0.5f, z), Point(x + dx, y + 1.8f, z + dz)), 0.5f));
+	}
+}
+
+// Box turned around the vertical axis, at the top of the capsule
+static OBB CapsuleBox(const LSS& Capsule, udword Index)
+{
+	float Angle = Index * 0.37f;
+	Matrix3x3 Rot;
+
+	Rot.Identity();
+	Rot.m[0][0] = cosf(Angle);	Rot.m[0][2] = -sinf(Angle);
+	Rot.m[2][0] = sinf(Angle);	Rot.m[2][2] = cosf(Angle);
+	return OBB(Capsule.mP1, Point(1.5f, 1.0f, 0.7f), Rot);
+}
+
+//-----------------------------------------------------------------------------
+// Queries
+
+static udword ClosestFace(RayCollider& Collider, const Ray& TestRay, const Model& TestModel)
+{
+	CollisionFace Hit;
+
+	SetupClosestHit(Collider, Hit);
+	Collider.Collide(TestRay, TestModel);
+	return (Hit.mDistance < MAX_FLOAT) ? Hit.mFaceID : INVALID_ID;
+}
+
+static udword ClosestFace(HeightfieldRayCollider& Collider, const Ray& TestRay, const Heightfield& Field)
+{
+	CollisionFace Hit;
+
+	SetupClosestHit(Collider, Hit);
+	Collider.Collide(TestRay, Field);
+	return (Hit.mDistance < MAX_FLOAT) ? Hit.mFaceID : INVALID_ID;
+}
+
+static void TouchedFaces(const VolumeCollider& Collider, std::vector<udword>& Faces)
+{
+	Faces.assign(Collider.GetTouchedPrimitives(), Collider.GetTouchedPrimitives() + Collider.GetNbTouchedPrimitives());
+	std::sort(Faces.begin(), Faces.end());
+}
+
+//-----------------------------------------------------------------------------
+// Test
+
+// Rays must hit the same faces in the heightfield and in the model, with and
+// without culling and in closest-hit-only mode
+static bool TestPicking(const TTerrain& Terrain)
+{
+	std::vector<Ray> Rays;
+	udword nDiffs = 0;
+
+	MakeRays(Terrain, TEST_RAYS, Rays);
+
+	for(udword Mode = 0; Mode < 4; Mode++)
+	{
+		RayCollider ModelCollider;
+		HeightfieldRayCollider FieldCollider;
+
+		ModelCollider.SetCulling((Mode & 1) != 0);
+		FieldCollider.SetCulling((Mode & 1) != 0);
+		FieldCollider.SetClosestHitOnly((Mode & 2) != 0);
+
+		for(udword i = 0; i < TEST_RAYS; i++)
+		{
+			if(ClosestFace(ModelCollider, Rays[i], Terrain.TerrainModel) != ClosestFace(FieldCollider, Rays[i], Terrain.Field))
+				nDiffs++;
+		}
+	}
+
+	if(nDiffs)
+		printf("  %u rays hit other faces\n", nDiffs);
+	return (nDiffs == 0);
+}
+
+// Spheres, capsules and boxes must touch the same faces
+static bool TestVolumes(const TTerrain& Terrain)
+{
+	std::vector<LSS> Capsules;
+	std::vector<udword> ModelFaces, FieldFaces;
+	SphereCollider ModelSphere;
+	HeightfieldSphereCollider FieldSphere;
+	LSSCollider ModelLSS;
+	HeightfieldLSSCollider FieldLSS;
+	OBBCollider ModelOBB;
+	HeightfieldOBBCollider FieldOBB;
+	SphereCache ModelSphereCache, FieldSphereCache;
+	LSSCache ModelLSSCache, FieldLSSCache;
+	OBBCache ModelOBBCache, FieldOBBCache;
+	udword nDiffs = 0;
+
+	MakeCapsules(Terrain, TEST_VOLUMES, Capsules);
+
+	for(udword i = 0; i < TEST_VOLUMES; i++)
+	{
+		Sphere TestSphere(Capsules[i].mP0, 1.0f);
+		OBB TestBox = CapsuleBox(Capsules[i], i);
+
+		ModelSphere.Collide(ModelSphereCache, TestSphere, Terrain.TerrainModel);
+		FieldSphere.Collide(FieldSphereCache, TestSphere, Terrain.Field);
+		TouchedFaces(ModelSphere, ModelFaces);
+		TouchedFaces(FieldSphere, FieldFaces);
+		if(ModelFaces != FieldFaces)
+			nDiffs++;
+
+		ModelLSS.Collide(ModelLSSCache, Capsules[i], Terrain.TerrainModel);
+		FieldLSS.Collide(FieldLSSCache, Capsules[i], Terrain.Field);
+		TouchedFaces(ModelLSS, ModelFaces);
+		TouchedFaces(FieldLSS, FieldFaces);
+		if(ModelFaces != FieldFaces)
+			nDiffs++;
+
+		ModelOBB.Collide(ModelOBBCache, TestBox, Terrain.TerrainModel);
+		FieldOBB.Collide(FieldOBBCache, TestBox, Terrain.Field);
+		TouchedFaces(ModelOBB, ModelFaces);
+		TouchedFaces(FieldOBB, FieldFaces);
+		if(ModelFaces != FieldFaces)
+			nDiffs++;
+	}
+
+	if(nDiffs)
+		printf("  %u volumes touched other faces\n", nDiffs);
+	return (nDiffs == 0);
+}
+
+bool TestHeightfield()
+{
+	TTerrain Terrain;
+	bool bPicking = false;
+	bool bVolumes = false;
+
+	if(MakeTerrain(TEST_CELLS, Terrain))
+	{
+		bPicking = TestPicking(Terrain);
+		bVolumes = TestVolumes(Terrain);
+	}
+	else
+	{
+		printf("  failed to build the terrain\n");
+	}
+
+	printf("%-24s: %s\n", "heightfield, picking", bPicking ? "OK" : "FAILED");
+	printf("%-24s: %s\n", "heightfield, volumes", bVolumes ? "OK" : "FAILED");
+	return bPicking && bVolumes;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+
+static double Microseconds(udword nQueries, double dfTime)
+{
+	return dfTime * 1e6 / nQueries;
+}
+
+// Picking and character queries on a 512 x 512 cells terrain, heightfield vs. model (us/query)
+void BenchHeightfield()
+{
+	TTerrain Terrain;
+	std::vector<Ray> Rays;
+	std::vector<LSS> Capsules;
+	double dfStart;
+	double dfField;
+	double dfModel;
+
+	MakeHeights(BENCH_CELLS, Terrain);
+
+	dfStart = TestTime();
+	if(!InitField(BENCH_CELLS, Terrain))
+		return;
+	dfField = TestTime() - dfStart;
+
+	dfStart = TestTime();
+	if(!BuildModel(Terrain))
+		return;
+	dfModel = TestTime() - dfStart;
+
+	printf("heightfield, %u triangles (us/query):\n", Terrain.Field.GetNbTriangles());
+	printf("  %-24s: %8.2f ms, %u bytes\n", "init, heightfield", dfField * 1000.0, Terrain.Field.GetUsedBytes());
+	printf("  %-24s: %8.2f ms, %u bytes\n", "build, model", dfModel * 1000.0, Terrain.TerrainModel.GetUsedBytes());
+
+	MakeRays(Terrain, BENCH_RAYS, Rays);
+	for(udword Mode = 0; Mode < 3; Mode++)
+	{
+		static const char* ModeNames[] = { "picking, model", "picking, heightfield", "picking, closest only" };
+		RayCollider ModelCollider;
+		HeightfieldRayCollider FieldCollider;
+
+		FieldCollider.SetClosestHitOnly(Mode == 2);
+		dfStart = TestTime();
+		for(udword i = 0; i < BENCH_RAYS; i++)
+		{
+			if(Mode == 0)
+				ClosestFace(ModelCollider, Rays[i], Terrain.TerrainModel);
+			else
+				ClosestFace(FieldCollider, Rays[i], Terrain.Field);
+		}
+		printf("  %-24s: %8.3f\n", ModeNames[Mode], Microseconds(BENCH_RAYS, TestTime() - dfStart));
+	}
+
+	MakeCapsules(Terrain, BENCH_VOLUMES, Capsules);
+	{
+		SphereCollider ModelCollider;
+		HeightfieldSphereCollider FieldCollider;
+		SphereCache ModelCache, FieldCache;
+
+		dfStart = TestTime();
+		for(udword i = 0; i < BENCH_VOLUMES; i++)
+			ModelCollider.Collide(ModelCache, Sphere(Capsules[i].mP0, 1.0f), Terrain.TerrainModel);
+		dfModel = TestTime() - dfStart;
+
+		dfStart = TestTime();
+		for(udword i = 0; i < BENCH_VOLUMES; i++)
+			FieldCollider.Collide(FieldCache, Sphere(Capsules[i].mP0, 1.0f), Terrain.Field);
+		dfField = TestTime() - dfStart;
+
+		printf("  %-24s: %8.3f %8.3f\n", "sphere, model / field", Microseconds(BENCH_VOLUMES, dfModel), Microseconds(BENCH_VOLUMES, dfField));
+	}
+	{
+		LSSCollider ModelCollider;
+		HeightfieldLSSCollider FieldCollider;
+		LSSCache ModelCache, FieldCache;
+
+		dfStart = TestTime();
+		for(udword i = 0; i < BENCH_VOLUMES; i++)
+			ModelCollider.Collide(ModelCache, Capsules[i], Terrain.TerrainModel);
+		dfModel = TestTime() - dfStart;
+
+		dfStart = TestTime();
+		for(udword i = 0; i < BENCH_VOLUMES; i++)
+			FieldCollider.Collide(FieldCache, Capsules[i], Terrain.Field);
+		dfField = TestTime() - dfStart;
+
+		printf("  %-24s: %8.3f %8.3f\n", "capsule, model / field", Microseconds(BENCH_VOLUMES, dfModel), Microseconds(BENCH_VOLUMES, dfField));
+	}
+	{
+		OBBCollider ModelCollider;
+		HeightfieldOBBCollider FieldCollider;
+		OBBCache ModelCache, FieldCache;
+
+		dfStart = TestTime();
+		for(udword i = 0; i < BENCH_VOLUMES; i++)
+			ModelCollider.Collide(ModelCache, CapsuleBox(Capsules[i], i), Terrain.TerrainModel);
+		dfModel = TestTime() - dfStart;
+
+		dfStart = TestTime();
+		for(udword i = 0; i < BENCH_VOLUMES; i++)
+			FieldCollider.Collide(FieldCache, CapsuleBox(Capsules[i], i), Terrain.Field);
+		dfField = TestTime() - dfStart;
+
+		printf("  %-24s: %8.3f %8.3f\n", "box, model / field", Microseconds(BENCH_VOLUMES, dfModel), Microseconds(BENCH_VOLUMES, dfField));
+	}
+}
@@ -0,0 +1,547 @@
+// TestKernels.cpp : Tests and benchmark for the overlap kernels.
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+using namespace Opcode;
+
+#include "OPC_BoxBoxOverlap.h"
+#include "OPC_TriBoxOverlap.h"
+#include "OPC_TriTriOverlap.h"
+#include "OPC_RayAABBOverlap.h"
+#include "OPC_RayTriOverlap.h"
+#include "OPC_SphereAABBOverlap.h"
+
+#define TEST_INPUTS         4096        // Random inputs for each kernel
+#define TEST_TRANSFORMS     16          // Random box transforms, shared by the inputs
+#define BENCH_PASSES        500         // Each benchmark runs over the inputs this many times
+
+//-----------------------------------------------------------------------------
+// Reference tests
+//
+// Scalar versions of the kernels, taken from their portable code paths. The
+// kernels must give the same results whichever path they take, so an SSE2 build
+// is checked against these. The box data is kept in plain matrices here, as its
+// layout depends on the path.
+
+namespace Reference
+{
+	struct TBoxBoxData
+	{
+		Matrix3x3 R;                    // Rotation from box B's space to box A's space
+		Matrix3x3 AR;                   // Absolute rotation, epsilon-tweaked
+		Point T;                        // Translation from box B's space to box A's space
+	};
+
+	struct TOBBAABBData
+	{
+		Matrix3x3 R;                    // Rotation from OBB space to model space
+		Matrix3x3 AR;                   // Absolute rotation, epsilon-tweaked
+		Point T;                        // Translation from OBB space to model space
+		Point Extents;                  // OBB extents
+		Point BB1;                      // OBB projected on the AABB axes
+		Point BB[3];                    // OBB terms for the cross-product axes
+	};
+
+	static void AbsoluteRotation(Matrix3x3& AR, const Matrix3x3& R)
+	{
+		for(udword i = 0; i < 3; i++)
+		{
+			for(udword j = 0; j < 3; j++)
+				AR.m[i][j] = 1e-6f + fabsf(R.m[i][j]);
+		}
+	}
+
+	static void InitBoxBox(TBoxBoxData& Data, const Matrix3x3& R, const Point& T)
+	{
+		Data.R = R;
+		Data.T = T;
+		AbsoluteRotation(Data.AR, R);
+	}
+
+	static void InitOBBAABB(TOBBAABBData& Data, const Matrix3x3& R, const Point& T, const Point& e)
+	{
+		const Matrix3x3& AR = Data.AR;
+
+		Data.R = R;
+		Data.T = T;
+		Data.Extents = e;
+		AbsoluteRotation(Data.AR, R);
+
+		Data.BB1 = Point(e.x*AR.m[0][0] + e.y*AR.m[1][0] + e.z*AR.m[2][0], e.x*AR.m[0][1] + e.y*AR.m[1][1] + e.z*AR.m[2][1], e.x*AR.m[0][2] + e.y*AR.m[1][2] + e.z*AR.m[2][2]);
+		Data.BB[0] = Point(e.y*AR.m[2][0] + e.z*AR.m[1][0], e.x*AR.m[2][0] + e.z*AR.m[0][0], e.x*AR.m[1][0] + e.y*AR.m[0][0]);
+		Data.BB[1] = Point(e.y*AR.m[2][1] + e.z*AR.m[1][1], e.x*AR.m[2][1] + e.z*AR.m[0][1], e.x*AR.m[1][1] + e.y*AR.m[0][1]);
+		Data.BB[2] = Point(e.y*AR.m[2][2] + e.z*AR.m[1][2], e.x*AR.m[2][2] + e.z*AR.m[0][2], e.x*AR.m[1][2] + e.y*AR.m[0][2]);
+	}
+
+	static BOOL BoxBoxTest(const TBoxBoxData& Data, const Point& ea, const Point& ca, const Point& eb, const Point& cb, BOOL full)
+	{
+		const Matrix3x3& R = Data.R;
+		const Matrix3x3& AR = Data.AR;
+		float t, t2;
+
+		// Class I : A's basis vectors
+		float Tx = (R.m[0][0]*cb.x + R.m[1][0]*cb.y + R.m[2][0]*cb.z) + Data.T.x - ca.x;
+		t = ea.x + eb.x*AR.m[0][0] + eb.y*AR.m[1][0] + eb.z*AR.m[2][0];
+		if(fabsf(Tx) > t)	return FALSE;
+
+		float Ty = (R.m[0][1]*cb.x + R.m[1][1]*cb.y + R.m[2][1]*cb.z) + Data.T.y - ca.y;
+		t = ea.y + eb.x*AR.m[0][1] + eb.y*AR.m[1][1] + eb.z*AR.m[2][1];
+		if(fabsf(Ty) > t)	return FALSE;
+
+		float Tz = (R.m[0][2]*cb.x + R.m[1][2]*cb.y + R.m[2][2]*cb.z) + Data.T.z - ca.z;
+		t = ea.z + eb.x*AR.m[0][2] + eb.y*AR.m[1][2] + eb.z*AR.m[2][2];
+		if(fabsf(Tz) > t)	return FALSE;
+
+		// Class II : B's basis vectors
+		t = Tx*R.m[0][0] + Ty*R.m[0][1] + Tz*R.m[0][2];	t2 = ea.x*AR.m[0][0] + ea.y*AR.m[0][1] + ea.z*AR.m[0][2] + eb.x;
+		if(fabsf(t) > t2)	return FALSE;
+
+		t = Tx*R.m[1][0] + Ty*R.m[1][1] + Tz*R.m[1][2];	t2 = ea.x*AR.m[1][0] + ea.y*AR.m[1][1] + ea.z*AR.m[1][2] + eb.y;
+		if(fabsf(t) > t2)	return FALSE;
+
+		t = Tx*R.m[2][0] + Ty*R.m[2][1] + Tz*R.m[2][2];	t2 = ea.x*AR.m[2][0] + ea.y*AR.m[2][1] + ea.z*AR.m[2][2] + eb.z;
+		if(fabsf(t) > t2)	return FALSE;
+
+		// Class III : 9 cross products
+		if(full)
+		{
+			t = Tz*R.m[0][1] - Ty*R.m[0][2];	t2 = ea.y*AR.m[0][2] + ea.z*AR.m[0][1] + eb.y*AR.m[2][0] + eb.z*AR.m[1][0];	if(fabsf(t) > t2)	return FALSE;	// L = A0 x B0
+			t = Tz*R.m[1][1] - Ty*R.m[1][2];	t2 = ea.y*AR.m[1][2] + ea.z*AR.m[1][1] + eb.x*AR.m[2][0] + eb.z*AR.m[0][0];	if(fabsf(t) > t2)	return FALSE;	// L = A0 x B1
+			t = Tz*R.m[2][1] - Ty*R.m[2][2];	t2 = ea.y*AR.m[2][2] + ea.z*AR.m[2][1] + eb.x*AR.m[1][0] + eb.y*AR.m[0][0];	if(fabsf(t) > t2)	return FALSE;	// L = A0 x B2
+			t = Tx*R.m[0][2] - Tz*R.m[0][0];	t2 = ea.x*AR.m[0][2] + ea.z*AR.m[0][0] + eb.y*AR.m[2][1] + eb.z*AR.m[1][1];	if(fabsf(t) > t2)	return FALSE;	// L = A1 x B0
+			t = Tx*R.m[1][2] - Tz*R.m[1][0];	t2 = ea.x*AR.m[1][2] + ea.z*AR.m[1][0] + eb.x*AR.m[2][1] + eb.z*AR.m[0][1];	if(fabsf(t) > t2)	return FALSE;	// L = A1 x B1
+			t = Tx*R.m[2][2] - Tz*R.m[2][0];	t2 = ea.x*AR.m[2][2] + ea.z*AR.m[2][0] + eb.x*AR.m[1][1] + eb.y*AR.m[0][1];	if(fabsf(t) > t2)	return FALSE;	// L = A1 x B2
+			t = Ty*R.m[0][0] - Tx*R.m[0][1];	t2 = ea.x*AR.m[0][1] + ea.y*AR.m[0][0] + eb.y*AR.m[2][2] + eb.z*AR.m[1][2];	if(fabsf(t) > t2)	return FALSE;	// L = A2 x B0
+			t = Ty*R.m[1][0] - Tx*R.m[1][1];	t2 = ea.x*AR.m[1][1] + ea.y*AR.m[1][0] + eb.x*AR.m[2][2] + eb.z*AR.m[0][2];	if(fabsf(t) > t2)	return FALSE;	// L = A2 x B1
+			t = Ty*R.m[2][0] - Tx*R.m[2][1];	t2 = ea.x*AR.m[2][1] + ea.y*AR.m[2][0] + eb.x*AR.m[1][2] + eb.y*AR.m[0][2];	if(fabsf(t) > t2)	return FALSE;	// L = A2 x B2
+		}
+		return TRUE;
+	}
+
+	static BOOL OBBAABBTest(const TOBBAABBData& Data, const Point& extents, const Point& center, BOOL full)
+	{
+		const Matrix3x3& R = Data.R;
+		const Matrix3x3& AR = Data.AR;
+		float t, t2;
+
+		// Class I : A's basis vectors
+		float Tx = Data.T.x - center.x;	t = extents.x + Data.BB1.x;	if(fabsf(Tx) > t)	return FALSE;
+		float Ty = Data.T.y - center.y;	t = extents.y + Data.BB1.y;	if(fabsf(Ty) > t)	return FALSE;
+		float Tz = Data.T.z - center.z;	t = extents.z + Data.BB1.z;	if(fabsf(Tz) > t)	return FALSE;
+
+		// Class II : B's basis vectors
+		t = Tx*R.m[0][0] + Ty*R.m[0][1] + Tz*R.m[0][2];
+		t2 = extents.x*AR.m[0][0] + extents.y*AR.m[0][1] + extents.z*AR.m[0][2] + Data.Extents.x;
+		if(fabsf(t) > t2)	return FALSE;
+
+		t = Tx*R.m[1][0] + Ty*R.m[1][1] + Tz*R.m[1][2];
+		t2 = extents.x*AR.m[1][0] + extents.y*AR.m[1][1] + extents.z*AR.m[1][2] + Data.Extents.y;
+		if(fabsf(t) > t2)	return FALSE;
+
+		t = Tx*R.m[2][0] + Ty*R.m[2][1] + Tz*R.m[2][2];
+		t2 = extents.x*AR.m[2][0] + extents.y*AR.m[2][1] + extents.z*AR.m[2][2] + Data.Extents.z;
+		if(fabsf(t) > t2)	return FALSE;
+
+		// Class III : 9 cross products
+		if(full)
+		{
+			t = Tz*R.m[0][1] - Ty*R.m[0][2];	t2 = extents.y*AR.m[0][2] + extents.z*AR.m[0][1] + Data.BB[0].x;	if(fabsf(t) > t2)	return FALSE;	// L = A0 x B0
+			t = Tz*R.m[1][1] - Ty*R.m[1][2];	t2 = extents.y*AR.m[1][2] + extents.z*AR.m[1][1] + Data.BB[0].y;	if(fabsf(t) > t2)	return FALSE;	// L = A0 x B1
+			t = Tz*R.m[2][1] - Ty*R.m[2][2];	t2 = extents.y*AR.m[2][2] + extents.z*AR.m[2][1] + Data.BB[0].z;	if(fabsf(t) > t2)	return FALSE;	// L = A0 x B2
+			t = Tx*R.m[0][2] - Tz*R.m[0][0];	t2 = extents.x*AR.m[0][2] + extents.z*AR.m[0][0] + Data.BB[1].x;	if(fabsf(t) > t2)	return FALSE;	// L = A1 x B0
+			t = Tx*R.m[1][2] - Tz*R.m[1][0];	t2 = extents.x*AR.m[1][2] + extents.z*AR.m[1][0] + Data.BB[1].y;	if(fabsf(t) > t2)	return FALSE;	// L = A1 x B1
+			t = Tx*R.m[2][2] - Tz*R.m[2][0];	t2 = extents.x*AR.m[2][2] + extents.z*AR.m[2][0] + Data.BB[1].z;	if(fabsf(t) > t2)	return FALSE;	// L = A1 x B2
+			t = Ty*R.m[0][0] - Tx*R.m[0][1];	t2 = extents.x*AR.m[0][1] + extents.y*AR.m[0][0] + Data.BB[2].x;	if(fabsf(t) > t2)	return FALSE;	// L = A2 x B0
+			t = Ty*R.m[1][0] - Tx*R.m[1][1];	t2 = extents.x*AR.m[1][1] + extents.y*AR.m[1][0] + Data.BB[2].y;	if(fabsf(t) > t2)	return FALSE;	// L = A2 x B1
+			t = Ty*R.m[2][0] - Tx*R.m[2][1];	t2 = extents.x*AR.m[2][1] + extents.y*AR.m[2][0] + Data.BB[2].z;	if(fabsf(t) > t2)	return FALSE;	// L = A2 x B2
+		}
+		return TRUE;
+	}
+
+	static BOOL AABBAABBTest(const Point& extents, const Point& center, const Point& box_extents, const Point& box_center)
+	{
+		float tx = box_center.x - center.x;	float ex = extents.x + box_extents.x;	if(fabsf(tx) > ex)	return FALSE;
+		float ty = box_center.y - center.y;	float ey = extents.y + box_extents.y;	if(fabsf(ty) > ey)	return FALSE;
+		float tz = box_center.z - center.z;	float ez = extents.z + box_extents.z;	if(fabsf(tz) > ez)	return FALSE;
+		return TRUE;
+	}
+
+	static BOOL SphereAABBTest(const Point& sphere_center, float radius2, const Point& center, const Point& extents)
+	{
+		float d = 0.0f;
+
+		// Square of the distance from the sphere center to the box, axis by axis
+		for(udword i = 0; i < 3; i++)
+		{
+			float tmp = sphere_center[i] - center[i];
+			float s = tmp + extents[i];
+
+			if(s < 0.0f)
+			{
+				d += s*s;
+				if(d > radius2)	return FALSE;
+			}
+			else
+			{
+				s = tmp - extents[i];
+				if(s > 0.0f)
+				{
+					d += s*s;
+					if(d > radius2)	return FALSE;
+				}
+			}
+		}
+		return d <= radius2;
+	}
+
+	static BOOL SegmentAABBTest(const Point& mid, const Point& dir, const Point& fdir, const Point& center, const Point& extents)
+	{
+		float Dx = mid.x - center.x;	if(fabsf(Dx) > extents.x + fdir.x)	return FALSE;
+		float Dy = mid.y - center.y;	if(fabsf(Dy) > extents.y + fdir.y)	return FALSE;
+		float Dz = mid.z - center.z;	if(fabsf(Dz) > extents.z + fdir.z)	return FALSE;
+
+		float f;
+		f = dir.y * Dz - dir.z * Dy;	if(fabsf(f) > extents.y*fdir.z + extents.z*fdir.y)	return FALSE;
+		f = dir.z * Dx - dir.x * Dz;	if(fabsf(f) > extents.x*fdir.z + extents.z*fdir.x)	return FALSE;
+		f = dir.x * Dy - dir.y * Dx;	if(fabsf(f) > extents.x*fdir.y + extents.y*fdir.x)	return FALSE;
+		return TRUE;
+	}
+
+	static BOOL RayAABBTest(const Point& orig, const Point& dir, const Point& fdir, const Point& center, const Point& extents)
+	{
+		float Dx = orig.x - center.x;	if(fabsf(Dx) > extents.x && Dx*dir.x >= 0.0f)	return FALSE;
+		float Dy = orig.y - center.y;	if(fabsf(Dy) > extents.y && Dy*dir.y >= 0.0f)	return FALSE;
+		float Dz = orig.z - center.z;	if(fabsf(Dz) > extents.z && Dz*dir.z >= 0.0f)	return FALSE;
+
+		float f;
+		f = dir.y * Dz - dir.z * Dy;	if(fabsf(f) > extents.y*fdir.z + extents.z*fdir.y)	return FALSE;
+		f = dir.z * Dx - dir.x * Dz;	if(fabsf(f) > extents.x*fdir.z + extents.z*fdir.x)	return FALSE;
+		f = dir.x * Dy - dir.y * Dx;	if(fabsf(f) > extents.x*fdir.y + extents.y*fdir.x)	return FALSE;
+		return TRUE;
+	}
+
+	static BOOL TriBoxTest(const Point* verts, const Point& center, const Point& extents, BOOL full)
+	{
+		// Move everything so that the box center is in (0,0,0)
+		const Point v0 = verts[0] - center;
+		const Point v1 = verts[1] - center;
+		const Point v2 = verts[2] - center;
+		float min, max;
+
+		// 1) Overlap in the {x,y,z}-directions
+		FINDMINMAX(v0.x, v1.x, v2.x, min, max);
+		if(min>extents.x || max<-extents.x) return FALSE;
+
+		FINDMINMAX(v0.y, v1.y, v2.y, min, max);
+		if(min>extents.y || max<-extents.y) return FALSE;
+
+		FINDMINMAX(v0.z, v1.z, v2.z, min, max);
+		if(min>extents.z || max<-extents.z) return FALSE;
+
+		// 2) Box against the plane of the triangle
+		const Point e0 = v1 - v0;
+		const Point e1 = v2 - v1;
+		const Point normal = e0 ^ e1;
+		const float d = -normal|v0;
+		if(!planeBoxOverlap(normal, d, extents)) return FALSE;
+
+		// 3) "Class III" tests
+		if(full)
+		{
+			IMPLEMENT_CLASS3_TESTS
+		}
+		return TRUE;
+	}
+
+	static BOOL RayTriTest(const Point& orig, const Point& dir, const Point& vert0, const Point& vert1, const Point& vert2, BOOL culling, CollisionFace& face)
+	{
+		const Point edge1 = vert1 - vert0;
+		const Point edge2 = vert2 - vert0;
+		const Point pvec = dir^edge2;
+		const float det = edge1|pvec;
+
+		if(culling)
+		{
+			if(det<LOCAL_EPSILON)						return FALSE;
+
+			const Point tvec = orig - vert0;
+			face.mU = tvec|pvec;
+			if(face.mU<0.0f || face.mU>det)				return FALSE;
+
+			const Point qvec = tvec^edge1;
+			face.mV = dir|qvec;
+			if(face.mV<0.0f || face.mU+face.mV>det)		return FALSE;
+
+			face.mDistance = edge2|qvec;
+			if(face.mDistance<0.0f)						return FALSE;
+
+			const float OneOverDet = 1.0f / det;
+			face.mDistance *= OneOverDet;
+			face.mU *= OneOverDet;
+			face.mV *= OneOverDet;
+		}
+		else
+		{
+			if(det>-LOCAL_EPSILON && det<LOCAL_EPSILON)	return FALSE;
+			const float OneOverDet = 1.0f / det;
+
+			const Point tvec = orig - vert0;
+			face.mU = (tvec|pvec) * OneOverDet;
+			if(face.mU<0.0f || face.mU>1.0f)			return FALSE;
+
+			const Point qvec = tvec^edge1;
+			face.mV = (dir|qvec) * OneOverDet;
+			if(face.mV<0.0f || face.mU+face.mV>1.0f)	return FALSE;
+
+			face.mDistance = (edge2|qvec) * OneOverDet;
+			if(face.mDistance<0.0f)						return FALSE;
+		}
+		return TRUE;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Test data
+
+struct TKernelInput
+{
+	Point Box[4];                       // Extents & center of two boxes
+	Point Tri[6];                       // Two triangles
+	Point Orig;                         // Ray origin, or segment middle
+	Point Dir;                          // Ray direction, or segment half-direction
+	Point FDir;                         // Absolute direction
+	float Radius2;                      // Squared sphere radius
+};
+
+static TKernelInput Inputs[TEST_INPUTS];
+static BoxBoxData BoxBoxTransforms[TEST_TRANSFORMS];
+static OBBAABBData OBBTransforms[TEST_TRANSFORMS];
+static Reference::TBoxBoxData RefBoxBoxTransforms[TEST_TRANSFORMS];
+static Reference::TOBBAABBData RefOBBTransforms[TEST_TRANSFORMS];
+
+static Point RandomPoint(float Size)
+{
+	return Point((TestRandom() * 2.0f - 1.0f) * Size, (TestRandom() * 2.0f - 1.0f) * Size, (TestRandom() * 2.0f - 1.0f) * Size);
+}
+
+static Point RandomExtents()
+{
+	return Point(0.2f + TestRandom() * 2.0f, 0.2f + TestRandom() * 2.0f, 0.2f + TestRandom() * 2.0f);
+}
+
+static Matrix3x3 RandomRotation()
+{
+	Point Axis0 = RandomPoint(1.0f);
+	Point Axis1 = RandomPoint(1.0f);
+	Matrix3x3 Rot;
+
+	Axis0.Normalize();
+	Axis1 = Axis0 ^ Axis1;
+	Axis1.Normalize();
+	Rot.SetRow(0, Axis0);
+	Rot.SetRow(1, Axis1);
+	Rot.SetRow(2, Axis0 ^ Axis1);
+	return Rot;
+}
+
+// Boxes, triangles and rays of about the same size in the same region, so that
+// each test sees both overlaps and misses
+static void MakeInputs()
+{
+	for(udword i = 0; i < TEST_TRANSFORMS; i++)
+	{
+		Matrix3x3 Rot = RandomRotation();
+		Point Trans = RandomPoint(3.0f);
+		Point Extents = RandomExtents();
+
+		BoxBoxTransforms[i].Init(Rot, Trans);
+		Reference::InitBoxBox(RefBoxBoxTransforms[i], Rot, Trans);
+		OBBTransforms[i].Init(Rot, Trans, Extents);
+		Reference::InitOBBAABB(RefOBBTransforms[i], Rot, Trans, Extents);
+	}
+
+	for(udword i = 0; i < TEST_INPUTS; i++)
+	{
+		TKernelInput& Input = Inputs[i];
+
+		Input.Box[0] = RandomExtents();
+		Input.Box[1] = RandomPoint(3.0f);
+		Input.Box[2] = RandomExtents();
+		Input.Box[3] = RandomPoint(3.0f);
+
+		for(udword k = 0; k < 6; k++)
+			Input.Tri[k] = RandomPoint(3.0f);
+
+		// Aim the ray close to the first box
+		Input.Orig = RandomPoint(6.0f);
+		Input.Dir = Input.Box[1] + RandomPoint(2.0f) - Input.Orig;
+		Input.Dir.Normalize();
+		Input.FDir = Point(fabsf(Input.Dir.x), fabsf(Input.Dir.y), fabsf(Input.Dir.z));
+
+		Input.Radius2 = 0.5f + TestRandom() * 4.0f;
+		Input.Radius2 *= Input.Radius2;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Kernels
+//
+// Each function runs a kernel or its reference on one input, and returns 0 if
+// there's no overlap. Ray-triangle tests also return the bits of the hit.
+
+typedef udword (*TKernelFunc)(udword i);
+
+static udword HitDigest(BOOL bHit, const CollisionFace& Face)
+{
+	if(!bHit)
+		return 0;
+	return ((IR(Face.mDistance) * 31 + IR(Face.mU)) * 31 + IR(Face.mV)) | 1;
+}
+
+#define SEGMENT_MID(i)      (Inputs[i].Orig * 0.5f)
+#define SEGMENT_DIR(i)      (Inputs[i].Dir * 2.0f)
+#define SEGMENT_FDIR(i)     (Inputs[i].FDir * 2.0f)
+
+static udword BoxBoxKernel(udword i)            { const TKernelInput& In = Inputs[i]; return BoxBoxTest(BoxBoxTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], In.Box[2], In.Box[3], FALSE); }
+static udword BoxBoxReference(udword i)         { const TKernelInput& In = Inputs[i]; return Reference::BoxBoxTest(RefBoxBoxTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], In.Box[2], In.Box[3], FALSE); }
+static udword BoxBoxFullKernel(udword i)        { const TKernelInput& In = Inputs[i]; return BoxBoxTest(BoxBoxTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], In.Box[2], In.Box[3], TRUE); }
+static udword BoxBoxFullReference(udword i)     { const TKernelInput& In = Inputs[i]; return Reference::BoxBoxTest(RefBoxBoxTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], In.Box[2], In.Box[3], TRUE); }
+static udword OBBAABBKernel(udword i)           { const TKernelInput& In = Inputs[i]; return OBBAABBTest(OBBTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], FALSE); }
+static udword OBBAABBReference(udword i)        { const TKernelInput& In = Inputs[i]; return Reference::OBBAABBTest(RefOBBTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], FALSE); }
+static udword OBBAABBFullKernel(udword i)       { const TKernelInput& In = Inputs[i]; return OBBAABBTest(OBBTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], TRUE); }
+static udword OBBAABBFullReference(udword i)    { const TKernelInput& In = Inputs[i]; return Reference::OBBAABBTest(RefOBBTransforms[i % TEST_TRANSFORMS], In.Box[0], In.Box[1], TRUE); }
+static udword AABBAABBKernel(udword i)          { const TKernelInput& In = Inputs[i]; return AABBAABBTest(In.Box[0], In.Box[1], In.Box[2], In.Box[3]); }
+static udword AABBAABBReference(udword i)       { const TKernelInput& In = Inputs[i]; return Reference::AABBAABBTest(In.Box[0], In.Box[1], In.Box[2], In.Box[3]); }
+static udword SphereAABBKernel(udword i)        { const TKernelInput& In = Inputs[i]; return SphereAABBTest(In.Box[3], In.Radius2, In.Box[1], In.Box[0]); }
+static udword SphereAABBReference(udword i)     { const TKernelInput& In = Inputs[i]; return Reference::SphereAABBTest(In.Box[3], In.Radius2, In.Box[1], In.Box[0]); }
+static udword SegmentAABBKernel(udword i)       { const TKernelInput& In = Inputs[i]; return SegmentAABBTest(SEGMENT_MID(i), SEGMENT_DIR(i), SEGMENT_FDIR(i), In.Box[1], In.Box[0]); }
+static udword SegmentAABBReference(udword i)    { const TKernelInput& In = Inputs[i]; return Reference::SegmentAABBTest(SEGMENT_MID(i), SEGMENT_DIR(i), SEGMENT_FDIR(i), In.Box[1], In.Box[0]); }
+static udword RayAABBKernel(udword i)           { const TKernelInput& In = Inputs[i]; return RayAABBTest(In.Orig, In.Dir, In.FDir, In.Box[1], In.Box[0]); }
+static udword RayAABBReference(udword i)        { const TKernelInput& In = Inputs[i]; return Reference::RayAABBTest(In.Orig, In.Dir, In.FDir, In.Box[1], In.Box[0]); }
+static udword TriBoxKernel(udword i)            { const TKernelInput& In = Inputs[i]; return TriBoxTest(In.Tri, In.Box[1], In.Box[0], TRUE); }
+static udword TriBoxReference(udword i)         { const TKernelInput& In = Inputs[i]; return Reference::TriBoxTest(In.Tri, In.Box[1], In.Box[0], TRUE); }
+static udword TriBoxLiteKernel(udword i)        { const TKernelInput& In = Inputs[i]; return TriBoxTest(In.Tri, In.Box[1], In.Box[0], FALSE); }
+static udword TriBoxLiteReference(udword i)     { const TKernelInput& In = Inputs[i]; return Reference::TriBoxTest(In.Tri, In.Box[1], In.Box[0], FALSE); }
+static udword RayTriKernel(udword i)            { const TKernelInput& In = Inputs[i]; CollisionFace Face; return HitDigest(RayTriTest(In.Orig, In.Dir, In.Tri[0], In.Tri[1], In.Tri[2], FALSE, Face), Face); }
+static udword RayTriReference(udword i)         { const TKernelInput& In = Inputs[i]; CollisionFace Face; return HitDigest(Reference::RayTriTest(In.Orig, In.Dir, In.Tri[0], In.Tri[1], In.Tri[2], FALSE, Face), Face); }
+static udword RayTriCullKernel(udword i)        { const TKernelInput& In = Inputs[i]; CollisionFace Face; return HitDigest(RayTriTest(In.Orig, In.Dir, In.Tri[0], In.Tri[1], In.Tri[2], TRUE, Face), Face); }
+static udword RayTriCullReference(udword i)     { const TKernelInput& In = Inputs[i]; CollisionFace Face; return HitDigest(Reference::RayTriTest(In.Orig, In.Dir, In.Tri[0], In.Tri[1], In.Tri[2], TRUE, Face), Face); }
+static udword TriTriKernel(udword i)            { const TKernelInput& In = Inputs[i]; return TriTriTest(In.Tri[0], In.Tri[1], In.Tri[2], In.Tri[3], In.Tri[4], In.Tri[5]); }
+
+struct TKernelTest
+{
+	const char * szName;
+	TKernelFunc Kernel;
+	TKernelFunc Reference;              // NULL if the kernel has no SIMD path
+};
+
+static const TKernelTest KernelTests[] =
+{
+	{ "box-box",            BoxBoxKernel,       BoxBoxReference      },
+	{ "box-box full",       BoxBoxFullKernel,   BoxBoxFullReference  },
+	{ "obb-aabb",           OBBAABBKernel,      OBBAABBReference     },
+	{ "obb-aabb full",      OBBAABBFullKernel,  OBBAABBFullReference },
+	{ "aabb-aabb",          AABBAABBKernel,     AABBAABBReference    },
+	{ "sphere-aabb",        SphereAABBKernel,   SphereAABBReference  },
+	{ "segment-aabb",       SegmentAABBKernel,  SegmentAABBReference },
+	{ "ray-aabb",           RayAABBKernel,      RayAABBReference     },
+	{ "tri-box",            TriBoxKernel,       TriBoxReference      },
+	{ "tri-box lite",       TriBoxLiteKernel,   TriBoxLiteReference  },
+	{ "ray-tri",            RayTriKernel,       RayTriReference      },
+	{ "ray-tri culling",    RayTriCullKernel,   RayTriCullReference  },
+	{ "tri-tri",            TriTriKernel,       NULL                 },
+};
+
+#define KERNEL_TEST_COUNT (sizeof(KernelTests) / sizeof(KernelTests[0]))
+
+#ifdef OPC_SIMD_SSE2
+#define KERNEL_PATH "sse2"
+#else
+#define KERNEL_PATH "scalar"
+#endif
+
+//-----------------------------------------------------------------------------
+// Tests
+
+bool TestKernels()
+{
+	bool bSucceed = true;
+
+	MakeInputs();
+
+	for(udword i = 0; i < KERNEL_TEST_COUNT; i++)
+	{
+		const TKernelTest& Test = KernelTests[i];
+		udword nMismatches = 0;
+		udword nHits = 0;
+
+		if(Test.Reference == NULL)
+			continue;
+
+		for(udword k = 0; k < TEST_INPUTS; k++)
+		{
+			udword Result = Test.Kernel(k);
+
+			if(Result != Test.Reference(k))
+				nMismatches++;
+			if(Result)
+				nHits++;
+		}
+
+		// Inputs that always or never overlap wouldn't test much
+		if(nHits == 0 || nHits == TEST_INPUTS)
+		{
+			printf("  %s: %u of %u inputs overlap\n", Test.szName, nHits, TEST_INPUTS);
+			nMismatches++;
+		}
+		else if(nMismatches)
+		{
+			printf("  %s: %u of %u results differ from the scalar test\n", Test.szName, nMismatches, TEST_INPUTS);
+		}
+
+		printf("%-24s: %s\n", Test.szName, nMismatches ? "FAILED" : "OK");
+		if(nMismatches)
+			bSucceed = false;
+	}
+	return bSucceed;
+}
+
+static volatile udword g_BenchSink;
+
+static double BenchKernel(TKernelFunc Kernel)
+{
+	udword Sink = 0;
+	double Start = TestTime();
+
+	for(udword p = 0; p < BENCH_PASSES; p++)
+	{
+		for(udword k = 0; k < TEST_INPUTS; k++)
+			Sink += Kernel(k);
+	}
+
+	// Keeps the compiler from dropping the calls
+	g_BenchSink = Sink;
+	return (TestTime() - Start) * 1e9 / ((double)TEST_INPUTS * BENCH_PASSES);
+}
+
+void BenchKernels()
+{
+	MakeInputs();
+
+	printf("kernel throughput, %s kernels vs. scalar reference (ns/test):\n", KERNEL_PATH);
+	for(udword i = 0; i < KERNEL_TEST_COUNT; i++)
+	{
+		const TKernelTest& Test = KernelTests[i];
+
+		if(Test.Reference != NULL)
+			printf("%-24s: %7.2f %7.2f\n", Test.szName, BenchKernel(Test.Kernel), BenchKernel(Test.Reference));
+		else
+			printf("%-24s: %7.2f\n", Test.szName, BenchKernel(Test.Kernel));
+	}
+}
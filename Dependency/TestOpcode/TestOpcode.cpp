@@ -0,0 +1,147 @@
+// TestOpcode.cpp : Defines the entry point for the console application.
+//
+
+#include "stdafx.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+#pragma comment(lib, "Opcode.lib")
+
+using namespace Opcode;
+
+static unsigned int g_Seed = 12345;
+
+float TestRandom()
+{
+	// Plain LCG, so that every platform gets the same test data
+	g_Seed = g_Seed * 1664525 + 1013904223;
+	return (g_Seed >> 8) * (1.0f / 16777216.0f);
+}
+
+double TestTime()
+{
+#ifdef _WIN32
+	LARGE_INTEGER Frequency, Counter;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Counter);
+	return (double)Counter.QuadPart / (double)Frequency.QuadPart;
+#else
+	timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return Now.tv_sec + Now.tv_nsec * 1e-9;
+#endif
+}
+
+// A terrain grid with boxes scattered over it, roughly what a map tile looks like
+void MakeTestMesh(udword Grid, udword Buildings, std::vector<Point>& Vertices, std::vector<IndexedTriangle>& Triangles)
+{
+	static const udword BoxFaces[12][3] =
+	{
+		{0,1,3}, {0,3,2}, {4,6,7}, {4,7,5}, {0,4,5}, {0,5,1},
+		{2,3,7}, {2,7,6}, {0,2,6}, {0,6,4}, {1,5,7}, {1,7,3}
+	};
+	IndexedTriangle Triangle;
+
+	for(udword z = 0; z <= Grid; z++)
+	{
+		for(udword x = 0; x <= Grid; x++)
+			Vertices.push_back(Point(float(x), 10.0f * sinf(x * 0.05f) * cosf(z * 0.07f) + TestRandom(), float(z)));
+	}
+
+	for(udword z = 0; z < Grid; z++)
+	{
+		for(udword x = 0; x < Grid; x++)
+		{
+			udword Corner = z * (Grid + 1) + x;
+
+			Triangle.mVRef[0] = Corner;
+			Triangle.mVRef[1] = Corner + Grid + 1;
+			Triangle.mVRef[2] = Corner + 1;
+			Triangles.push_back(Triangle);
+
+			Triangle.mVRef[0] = Corner + 1;
+			Triangle.mVRef[1] = Corner + Grid + 1;
+			Triangle.mVRef[2] = Corner + Grid + 2;
+			Triangles.push_back(Triangle);
+		}
+	}
+
+	for(udword i = 0; i < Buildings; i++)
+	{
+		Point Center(TestRandom() * Grid, TestRandom() * 20.0f, TestRandom() * Grid);
+		float Size = 0.5f + TestRandom() * 3.0f;
+		udword Base = (udword)Vertices.size();
+
+		for(udword k = 0; k < 8; k++)
+			Vertices.push_back(Center + Point((k & 1) ? Size : -Size, (k & 2) ? Size : -Size, (k & 4) ? Size : -Size));
+
+		for(udword f = 0; f < 12; f++)
+		{
+			Triangle.mVRef[0] = Base + BoxFaces[f][0];
+			Triangle.mVRef[1] = Base + BoxFaces[f][1];
+			Triangle.mVRef[2] = Base + BoxFaces[f][2];
+			Triangles.push_back(Triangle);
+		}
+	}
+}
+
+// Runs the tests. Pass "bench" to also run the benchmarks.
+int main(int argc, char* argv[])
+{
+	bool bBench = (argc > 1 && !strcmp(argv[1], "bench"));
+	bool bSucceed = true;
+
+	Opcode::InitOpcode();
+
+	if(!TestKernels())
+		bSucceed = false;
+
+	if(!TestQueryContext())
+		bSucceed = false;
+
+	if(!TestBatchRays())
+		bSucceed = false;
+
+	if(!TestRefit())
+		bSucceed = false;
+
+	if(!TestArraySAP())
+		bSucceed = false;
+
+	if(!TestHeightfield())
+		bSucceed = false;
+
+	if(!TestCulling())
+		bSucceed = false;
+
+	if(bBench)
+	{
+		BenchKernels();
+		BenchBatchRays();
+		BenchRefit();
+		BenchArraySAP();
+		BenchHeightfield();
+		BenchCulling();
+	}
+
+	Opcode::CloseOpcode();
+
+	if(bSucceed)
+		printf("test succeed!\n");
+	else
+		printf("test failed!\n");
+
+	return bSucceed ? 0 : 1;
+}
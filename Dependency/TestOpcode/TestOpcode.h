@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+// Each test returns true on success
+
+bool TestQueryContext();
+bool TestKernels();
+void BenchKernels();
+bool TestBatchRays();
+void BenchBatchRays();
+bool TestRefit();
+void BenchRefit();
+bool TestArraySAP();
+void BenchArraySAP();
+bool TestHeightfield();
+void BenchHeightfield();
+bool TestCulling();
+void BenchCulling();
+
+// Helpers shared by the tests
+
+float TestRandom();                     // Repeatable random number in [0, 1)
+double TestTime();                      // Seconds, for the benchmarks
+
+// Terrain grid of Grid x Grid cells with Buildings boxes scattered over it
+void MakeTestMesh(udword Grid, udword Buildings, std::vector<Point>& Vertices, std::vector<IndexedTriangle>& Triangles);
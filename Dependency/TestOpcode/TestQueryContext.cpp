@@ -0,0 +1,281 @@
+// TestQueryContext.cpp : Concurrent queries on one shared model, one QueryContext per thread.
+//
+
+#include "stdafx.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <math.h>
+#include <vector>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+using namespace Opcode;
+
+#define TEST_THREADS        32
+#define TEST_QUERIES        3000
+#define TEST_PASSES         2           // Each thread runs every query this many times
+#define TEST_GRID           256         // Terrain cells on each side
+#define TEST_BUILDINGS      1000
+
+//-----------------------------------------------------------------------------
+// Queries
+
+enum
+{
+	QUERY_TYPE_RAY,                     // Closest hit, like picking
+	QUERY_TYPE_SPHERE,
+	QUERY_TYPE_OBB,
+	QUERY_TYPE_COUNT
+};
+
+struct TQuery
+{
+	udword Type;
+	Ray QueryRay;
+	Sphere QuerySphere;
+	OBB QueryBox;
+};
+
+static Point RandomPosition()
+{
+	return Point(TestRandom() * TEST_GRID, TestRandom() * 20.0f - 5.0f, TestRandom() * TEST_GRID);
+}
+
+static void MakeQueries(std::vector<TQuery>& Queries)
+{
+	Queries.resize(TEST_QUERIES);
+
+	for(udword i = 0; i < TEST_QUERIES; i++)
+	{
+		TQuery& Query = Queries[i];
+		Query.Type = i % QUERY_TYPE_COUNT;
+
+		Point Dir(TestRandom() - 0.5f, -0.3f - TestRandom(), TestRandom() - 0.5f);
+		Query.QueryRay.mOrig = Point(TestRandom() * TEST_GRID, 40.0f + TestRandom() * 20.0f, TestRandom() * TEST_GRID);
+		Query.QueryRay.mDir = Dir.Normalize();
+
+		Query.QuerySphere.mCenter = RandomPosition();
+		Query.QuerySphere.mRadius = 0.5f + TestRandom() * 4.0f;
+
+		// Box turned around the vertical axis
+		float Angle = TestRandom() * 6.28f;
+		Matrix3x3 Rot;
+		Rot.Identity();
+		Rot.m[0][0] = cosf(Angle);	Rot.m[0][2] = -sinf(Angle);
+		Rot.m[2][0] = sinf(Angle);	Rot.m[2][2] = cosf(Angle);
+		Point Extents(0.5f + TestRandom() * 3.0f, 0.5f + TestRandom() * 3.0f, 0.5f + TestRandom() * 3.0f);
+		Query.QueryBox = OBB(RandomPosition(), Extents, Rot);
+	}
+}
+
+static bool RunQuery(QueryContext& Context, const TQuery& Query, const Model& TestModel)
+{
+	switch(Query.Type)
+	{
+		case QUERY_TYPE_RAY:	return RayQuery(Context, Query.QueryRay, TestModel, null, QUERY_CLOSEST_HIT);
+		case QUERY_TYPE_SPHERE:	return SphereQuery(Context, Query.QuerySphere, TestModel);
+		default:				return OBBQuery(Context, Query.QueryBox, TestModel);
+	}
+}
+
+// Digest of the results of the last query
+static udword QueryResult(const QueryContext& Context, const TQuery& Query)
+{
+	if(Query.Type == QUERY_TYPE_RAY)
+		return Context.Faces.GetNbFaces() ? Context.Faces.GetFaces()->mFaceID : 0xFFFFFFFF;
+
+	const udword* Touched = Context.GetTouchedPrimitives();
+	udword Digest = 2166136261u;
+
+	// The order of the touched primitives depends on the traversal only, so it is
+	// the same on every thread
+	Digest = (Digest ^ Context.GetNbTouchedPrimitives()) * 16777619;
+	for(udword i = 0; i < Context.GetNbTouchedPrimitives(); i++)
+		Digest = (Digest ^ Touched[i]) * 16777619;
+	return Digest;
+}
+
+//-----------------------------------------------------------------------------
+// Worker threads
+
+struct TQueryThread
+{
+	const Model* pModel;
+	const TQuery* pQueries;
+	const udword* pExpected;            // Results of a single-threaded run
+	udword ThreadIndex;
+
+	udword nMismatches;
+	udword nFailures;
+};
+
+static void RunQueryThread(TQueryThread* pThread)
+{
+	// Each thread runs the queries in its own order, so that the threads don't
+	// all run the same kind of query at the same time
+	QueryContext Context;
+
+	for(udword p = 0; p < TEST_PASSES; p++)
+	{
+		for(udword k = 0; k < TEST_QUERIES; k++)
+		{
+			udword i = (k * 7919 + pThread->ThreadIndex * 1013 + p * 31) % TEST_QUERIES;
+			const TQuery& Query = pThread->pQueries[i];
+
+			if(!RunQuery(Context, Query, *pThread->pModel))
+				pThread->nFailures++;
+			if(QueryResult(Context, Query) != pThread->pExpected[i])
+				pThread->nMismatches++;
+		}
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI QueryThreadProc(LPVOID lpParameter)
+{
+	RunQueryThread((TQueryThread*)lpParameter);
+	return 0;
+}
+#else
+static void* QueryThreadProc(void* lpParameter)
+{
+	RunQueryThread((TQueryThread*)lpParameter);
+	return NULL;
+}
+#endif
+
+static bool RunQueryThreads(TQueryThread* Threads)
+{
+	bool bStarted = true;
+	udword nStarted;
+
+#ifdef _WIN32
+	HANDLE Handles[TEST_THREADS];
+
+	for(nStarted = 0; nStarted < TEST_THREADS; nStarted++)
+	{
+		Handles[nStarted] = CreateThread(NULL, 0, QueryThreadProc, &Threads[nStarted], 0, NULL);
+		if(Handles[nStarted] == NULL)
+			break;
+	}
+
+	for(udword i = 0; i < nStarted; i++)
+	{
+		WaitForSingleObject(Handles[i], INFINITE);
+		CloseHandle(Handles[i]);
+	}
+#else
+	pthread_t Handles[TEST_THREADS];
+
+	for(nStarted = 0; nStarted < TEST_THREADS; nStarted++)
+	{
+		if(pthread_create(&Handles[nStarted], NULL, QueryThreadProc, &Threads[nStarted]) != 0)
+			break;
+	}
+
+	for(udword i = 0; i < nStarted; i++)
+		pthread_join(Handles[i], NULL);
+#endif
+
+	if(nStarted < TEST_THREADS)
+	{
+		printf("  only %u of %u threads started\n", nStarted, TEST_THREADS);
+		bStarted = false;
+	}
+	return bStarted;
+}
+
+//-----------------------------------------------------------------------------
+// Test
+
+// Runs the queries on a single thread, then on all threads at once against the
+// same model. Every thread must get the single-threaded results.
+static bool TestSharedModel(const MeshInterface& Mesh, const std::vector<TQuery>& Queries, bool bQuantized)
+{
+	OPCODECREATE Create;
+	Model TestModel;
+	QueryContext Context;
+	std::vector<udword> Expected(TEST_QUERIES);
+	TQueryThread Threads[TEST_THREADS];
+	udword nMismatches = 0;
+	udword nFailures = 0;
+
+	Create.mIMesh = &Mesh;
+	Create.mQuantized = bQuantized;
+	if(!TestModel.Build(Create))
+	{
+		printf("  failed to build the model\n");
+		return false;
+	}
+
+	for(udword i = 0; i < TEST_QUERIES; i++)
+	{
+		if(!RunQuery(Context, Queries[i], TestModel))
+		{
+			printf("  query %u failed\n", i);
+			return false;
+		}
+		Expected[i] = QueryResult(Context, Queries[i]);
+	}
+
+	for(udword t = 0; t < TEST_THREADS; t++)
+	{
+		Threads[t].pModel = &TestModel;
+		Threads[t].pQueries = &Queries[0];
+		Threads[t].pExpected = &Expected[0];
+		Threads[t].ThreadIndex = t;
+		Threads[t].nMismatches = 0;
+		Threads[t].nFailures = 0;
+	}
+
+	if(!RunQueryThreads(Threads))
+		return false;
+
+	for(udword t = 0; t < TEST_THREADS; t++)
+	{
+		nMismatches += Threads[t].nMismatches;
+		nFailures += Threads[t].nFailures;
+	}
+
+	if(nMismatches || nFailures)
+	{
+		printf("  %u of %u queries got other results, %u failed\n", nMismatches, TEST_THREADS * TEST_PASSES * TEST_QUERIES, nFailures);
+		return false;
+	}
+	return true;
+}
+
+bool TestQueryContext()
+{
+	std::vector<Point> Vertices;
+	std::vector<IndexedTriangle> Triangles;
+	std::vector<TQuery> Queries;
+	MeshInterface Mesh;
+	bool bSucceed = true;
+
+	MakeTestMesh(TEST_GRID, TEST_BUILDINGS, Vertices, Triangles);
+	MakeQueries(Queries);
+
+	Mesh.SetNbTriangles((udword)Triangles.size());
+	Mesh.SetNbVertices((udword)Vertices.size());
+	Mesh.SetPointers(&Triangles[0], &Vertices[0]);
+
+	for(int i = 0; i < 2; i++)
+	{
+		bool bQuantized = (i == 0);
+		bool bResult = TestSharedModel(Mesh, Queries, bQuantized);
+
+		printf("%-24s: %s\n", bQuantized ? "queries, quantized tree" : "queries, normal tree", bResult ? "OK" : "FAILED");
+		if(!bResult)
+			bSucceed = false;
+	}
+	return bSucceed;
+}
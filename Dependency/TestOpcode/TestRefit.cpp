@@ -0,0 +1,356 @@
+// TestRefit.cpp : Tests and benchmark for refitting the trees of a skinned mesh.
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <vector>
+
+#include "Opcode.h"
+#include "TestOpcode.h"
+
+using namespace Opcode;
+
+#define SKIN_RINGS          250         // Vertices around the tube
+#define SKIN_LENGTH         100         // Segments along the tube, 2 x 250 x 100 = 50000 triangles
+#define SKIN_BONES          16
+#define SKIN_MOVING_BONES   4           // Bones animated in a partial pose, at the end of the chain
+#define TEST_FRAMES         10
+#define TEST_RAYS           4096
+#define BENCH_FRAMES        300         // 5 seconds at 60 Hz
+
+//-----------------------------------------------------------------------------
+// Skinned mesh
+//
+// A bent tube, like the body of a creature, with a chain of bones along it. Each
+// vertex is weighted on two bones.
+
+struct TSkinVertex
+{
+	Point Position;                     // Bind pose
+	udword Bone0;
+	udword Bone1;
+	float Weight0;
+};
+
+struct TSkinnedMesh
+{
+	std::vector<TSkinVertex> Skin;
+	std::vector<Point> Vertices;        // Skinned positions, used by the mesh interface
+	std::vector<IndexedTriangle> Triangles;
+	std::vector<udword> Dirty;          // Triangles moved by a partial pose
+	MeshInterface Mesh;
+};
+
+static void MakeSkinnedMesh(TSkinnedMesh& Skinned)
+{
+	IndexedTriangle Triangle;
+
+	for(udword l = 0; l <= SKIN_LENGTH; l++)
+	{
+		float Bone = l * (SKIN_BONES - 1) / float(SKIN_LENGTH);
+
+		for(udword a = 0; a < SKIN_RINGS; a++)
+		{
+			float Angle = a * 2.0f * PI / SKIN_RINGS;
+			TSkinVertex Vertex;
+
+			Vertex.Position = Point(float(l), 3.0f * cosf(Angle), 3.0f * sinf(Angle));
+			Vertex.Bone0 = (udword)Bone;
+			Vertex.Bone1 = (Vertex.Bone0 + 1 < SKIN_BONES) ? Vertex.Bone0 + 1 : Vertex.Bone0;
+			Vertex.Weight0 = 1.0f - (Bone - Vertex.Bone0);
+			Skinned.Skin.push_back(Vertex);
+			Skinned.Vertices.push_back(Vertex.Position);
+		}
+	}
+
+	for(udword l = 0; l < SKIN_LENGTH; l++)
+	{
+		for(udword a = 0; a < SKIN_RINGS; a++)
+		{
+			udword i0 = l * SKIN_RINGS + a;
+			udword i1 = l * SKIN_RINGS + (a + 1) % SKIN_RINGS;
+
+			Triangle.mVRef[0] = i0;
+			Triangle.mVRef[1] = i1;
+			Triangle.mVRef[2] = i0 + SKIN_RINGS;
+			Skinned.Triangles.push_back(Triangle);
+
+			Triangle.mVRef[0] = i1;
+			Triangle.mVRef[1] = i1 + SKIN_RINGS;
+			Triangle.mVRef[2] = i0 + SKIN_RINGS;
+			Skinned.Triangles.push_back(Triangle);
+		}
+	}
+
+	// A partial pose only moves the triangles weighted on the last bones
+	Skinned.Dirty.assign((Skinned.Triangles.size() + 31) / 32, 0);
+	for(udword i = 0; i < (udword)Skinned.Triangles.size(); i++)
+	{
+		for(udword k = 0; k < 3; k++)
+		{
+			if(Skinned.Skin[Skinned.Triangles[i].mVRef[k]].Bone1 >= SKIN_BONES - SKIN_MOVING_BONES)
+				SetDirtyPrimitive(&Skinned.Dirty[0], i);
+		}
+	}
+
+	Skinned.Mesh.SetNbTriangles((udword)Skinned.Triangles.size());
+	Skinned.Mesh.SetNbVertices((udword)Skinned.Vertices.size());
+	Skinned.Mesh.SetPointers(&Skinned.Triangles[0], &Skinned.Vertices[0]);
+}
+
+// Back to the bind pose, the mesh interface keeps pointing to the same vertices
+static void ResetPose(TSkinnedMesh& Skinned)
+{
+	for(size_t i = 0; i < Skinned.Skin.size(); i++)
+		Skinned.Vertices[i] = Skinned.Skin[i].Position;
+}
+
+// Each bone turns around the vertical axis at its joint, on top of its parents
+static void PoseBones(float Time, bool bPartial, Matrix4x4* Bones)
+{
+	float Angle = 0.0f;
+
+	for(udword b = 0; b < SKIN_BONES; b++)
+	{
+		if(!bPartial || b >= SKIN_BONES - SKIN_MOVING_BONES)
+			Angle += 0.15f * sinf(Time * 2.0f + b * 0.5f);
+
+		float c = cosf(Angle);
+		float s = sinf(Angle);
+		float Joint = float(b) * SKIN_LENGTH / SKIN_BONES;
+
+		Bones[b].Identity();
+		Bones[b].m[0][0] = c;	Bones[b].m[0][2] = -s;
+		Bones[b].m[2][0] = s;	Bones[b].m[2][2] = c;
+		Bones[b].m[3][0] = Joint - c * Joint;
+		Bones[b].m[3][2] = -s * Joint;
+	}
+}
+
+static void SkinVertices(TSkinnedMesh& Skinned, float Time, bool bPartial)
+{
+	Matrix4x4 Bones[SKIN_BONES];
+
+	PoseBones(Time, bPartial, Bones);
+	for(size_t i = 0; i < Skinned.Skin.size(); i++)
+	{
+		const TSkinVertex& Vertex = Skinned.Skin[i];
+
+		if(bPartial && Vertex.Bone1 < SKIN_BONES - SKIN_MOVING_BONES)
+			continue;
+		Skinned.Vertices[i] = (Vertex.Position * Bones[Vertex.Bone0]) * Vertex.Weight0 + (Vertex.Position * Bones[Vertex.Bone1]) * (1.0f - Vertex.Weight0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Trees
+
+enum
+{
+	TREE_NORMAL,
+	TREE_NO_LEAF,
+	TREE_QUANTIZED,
+	TREE_QUANTIZED_NO_LEAF,
+	TREE_WIDE,
+	TREE_COUNT
+};
+
+static const char* TreeNames[TREE_COUNT] = { "normal", "no-leaf", "quantized", "quantized no-leaf", "wide" };
+
+static bool BuildModel(const TSkinnedMesh& Skinned, udword Tree, Model& TestModel)
+{
+	OPCODECREATE Create;
+
+	Create.mIMesh = &Skinned.Mesh;
+	Create.mNoLeaf = (Tree == TREE_NO_LEAF || Tree == TREE_QUANTIZED_NO_LEAF);
+	Create.mQuantized = (Tree == TREE_QUANTIZED || Tree == TREE_QUANTIZED_NO_LEAF);
+	Create.mWideTree = (Tree == TREE_WIDE);
+	return TestModel.Build(Create);
+}
+
+static void RefitFrame(TSkinnedMesh& Skinned, Model& TestModel, udword Frame, bool bPartial, udword nThreads)
+{
+	RefitSettings Settings;
+
+	SkinVertices(Skinned, Frame / 60.0f, bPartial);
+	Settings.mNbThreads = nThreads;
+	Settings.mParallelThreshold = 4096;
+	if(bPartial)
+		Settings.mDirtyPrimitives = &Skinned.Dirty[0];
+	TestModel.Refit(Settings);
+}
+
+//-----------------------------------------------------------------------------
+// Test
+
+struct THit
+{
+	float Distance;
+	udword FaceID;
+	udword Count;
+};
+
+static void RecordHit(const CollisionFace& Hit, void* pUserData)
+{
+	THit* pHit = (THit*)pUserData;
+
+	pHit->Count++;
+	if(Hit.mDistance < pHit->Distance)
+	{
+		pHit->Distance = Hit.mDistance;
+		pHit->FaceID = Hit.mFaceID;
+	}
+}
+
+static THit CastRay(RayCollider& Collider, const Ray& TestRay, const Model& TestModel)
+{
+	THit Hit = { MAX_FLOAT, INVALID_ID, 0 };
+
+	Collider.SetUserData(&Hit);
+	Collider.Collide(TestRay, TestModel);
+	return Hit;
+}
+
+// Rays against the refit tree must hit what they hit in a tree built from scratch
+static udword CompareWithRebuild(const TSkinnedMesh& Skinned, udword Tree, const Model& TestModel)
+{
+	RayCollider Collider;
+	Model Rebuilt;
+	udword nDiffs = 0;
+
+	if(!BuildModel(Skinned, Tree, Rebuilt))
+		return TEST_RAYS;
+
+	Collider.SetFirstContact(false);
+	Collider.SetCulling(false);
+	Collider.SetHitCallback(RecordHit);
+
+	for(udword i = 0; i < TEST_RAYS; i++)
+	{
+		Point Dir(TestRandom() - 0.5f, TestRandom() - 0.5f, -1.0f);
+		Ray TestRay(Point(TestRandom() * SKIN_LENGTH * 1.2f - 10.0f, TestRandom() * 40.0f - 20.0f, 30.0f), Dir.Normalize());
+		THit Refit = CastRay(Collider, TestRay, TestModel);
+		THit Built = CastRay(Collider, TestRay, Rebuilt);
+
+		if(Refit.Count != Built.Count || Refit.FaceID != Built.FaceID)
+			nDiffs++;
+	}
+	return nDiffs;
+}
+
+// Animates the mesh for a few frames with full and partial poses, serially and on
+// 4 threads, for every kind of tree
+bool TestRefit()
+{
+	static const udword ThreadCounts[] = { 1, 4 };
+	TSkinnedMesh Skinned;
+	bool bSucceed = true;
+
+	MakeSkinnedMesh(Skinned);
+
+	for(udword Pass = 0; Pass < 2; Pass++)
+	{
+		bool bPartial = (Pass != 0);
+		udword nDiffs = 0;
+		bool bResult = true;
+
+		for(udword Tree = 0; Tree < TREE_COUNT && bResult; Tree++)
+		{
+			for(udword t = 0; t < 2; t++)
+			{
+				Model TestModel;
+
+				ResetPose(Skinned);
+				if(!BuildModel(Skinned, Tree, TestModel))
+				{
+					printf("  failed to build the %s tree\n", TreeNames[Tree]);
+					bResult = false;
+					break;
+				}
+
+				for(udword f = 0; f < TEST_FRAMES; f++)
+					RefitFrame(Skinned, TestModel, f * 7, bPartial, ThreadCounts[t]);
+				nDiffs += CompareWithRebuild(Skinned, Tree, TestModel);
+			}
+		}
+
+		if(nDiffs)
+		{
+			printf("  %u rays got other hits than on a rebuilt tree\n", nDiffs);
+			bResult = false;
+		}
+
+		printf("%-24s: %s\n", bPartial ? "refit, partial pose" : "refit, full pose", bResult ? "OK" : "FAILED");
+		if(!bResult)
+			bSucceed = false;
+	}
+	return bSucceed;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+
+// Average and worst refit time per frame of an animation at 60 Hz, serial and
+// with one thread per processor
+void BenchRefit()
+{
+	static const udword ThreadCounts[] = { 1, 0 };
+	TSkinnedMesh Skinned;
+	udword nDirty = 0;
+
+	MakeSkinnedMesh(Skinned);
+	for(udword i = 0; i < (udword)Skinned.Triangles.size(); i++)
+	{
+		if(IsDirtyPrimitive(&Skinned.Dirty[0], i))
+			nDirty++;
+	}
+
+	printf("refit, %u triangles, %u moved by a partial pose (avg / worst ms per frame):\n", (udword)Skinned.Triangles.size(), nDirty);
+	for(udword Pass = 0; Pass < 2; Pass++)
+	{
+		bool bPartial = (Pass != 0);
+
+		for(udword Tree = 0; Tree < TREE_COUNT; Tree++)
+		{
+			char szName[0x40];
+
+			sprintf(szName, "%s, %s", bPartial ? "partial" : "full", TreeNames[Tree]);
+			printf("  %-26s:", szName);
+
+			for(udword t = 0; t < 2; t++)
+			{
+				Model TestModel;
+				double dfTotal = 0.0;
+				double dfWorst = 0.0;
+
+				ResetPose(Skinned);
+				if(!BuildModel(Skinned, Tree, TestModel))
+					break;
+
+				for(udword f = 0; f < BENCH_FRAMES; f++)
+				{
+					RefitSettings Settings;
+					double dfStart;
+					double dfTime;
+
+					SkinVertices(Skinned, f / 60.0f, bPartial);
+					Settings.mNbThreads = ThreadCounts[t];
+					Settings.mParallelThreshold = 4096;
+					if(bPartial)
+						Settings.mDirtyPrimitives = &Skinned.Dirty[0];
+
+					dfStart = TestTime();
+					TestModel.Refit(Settings);
+					dfTime = TestTime() - dfStart;
+
+					dfTotal += dfTime;
+					if(dfTime > dfWorst)
+						dfWorst = dfTime;
+				}
+				printf(" %s %6.3f / %6.3f", ThreadCounts[t] ? "serial" : "threads", dfTotal * 1000.0 / BENCH_FRAMES, dfWorst * 1000.0);
+			}
+			printf("\n");
+		}
+	}
+}
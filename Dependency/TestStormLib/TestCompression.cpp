@@ -0,0 +1,344 @@
+// TestCompression.cpp : Tests and benchmark for the Huffman, PKLIB and ADPCM codecs.
+//
+
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "StormLib.h"
+#include "TestStormLib.h"
+
+//-----------------------------------------------------------------------------
+// Test data
+
+// Every codec runs over each kind of data at each of these sizes
+static const int DataSizes[] = { 1, 7, 100, 1000, 4096, 4097, 8192, 12000, 65536, 200000 };
+
+#define DATA_SIZE_COUNT (sizeof(DataSizes) / sizeof(DataSizes[0]))
+#define DATA_SIZE_MAX   200000
+
+enum
+{
+	DATA_RANDOM,        // Incompressible bytes
+	DATA_TEXT,          // Repeated text with a few random characters
+	DATA_ZEROS,         // All zeros
+	DATA_WAVE,          // 16-bit triangle wave with noise, the kind of data ADPCM is meant for
+	DATA_RUNS,          // Slowly changing bytes with random spikes
+	DATA_KIND_COUNT
+};
+
+struct TCodecTest
+{
+	const char * szName;
+	unsigned uCompressionMask;
+	int nCmpType;
+	int nCmpLevel;
+	bool bLossless;
+
+	// Digests of the compressed streams and of the decompressed data, over all
+	// kinds and sizes. They were taken with the codecs before the decoders were
+	// rewritten, so any difference from the old output shows up here.
+	DWORD dwPackedDigest;
+	DWORD dwUnpackedDigest;
+};
+
+static const TCodecTest CodecTests[] =
+{
+	// Huffman runs with the type ADPCM selects for it. Type 0 starts from an empty
+	// tree and cannot code long runs of one byte, which MPQs never ask of it.
+	{ "pkware",               MPQ_COMPRESSION_PKWARE,                                  0, 0, true,  0xD6B84598, 0x5125B20A },
+	{ "huffman",              MPQ_COMPRESSION_HUFFMANN,                                6, 0, true,  0xEB3F271D, 0x5125B20A },
+	{ "adpcm mono",           MPQ_COMPRESSION_ADPCM_MONO,                              0, 0, false, 0x960740D5, 0x2D9B35C7 },
+	{ "adpcm stereo",         MPQ_COMPRESSION_ADPCM_STEREO,                            0, 0, false, 0x4431B191, 0x29FE3CE7 },
+	{ "adpcm mono+huffman",   MPQ_COMPRESSION_ADPCM_MONO | MPQ_COMPRESSION_HUFFMANN,   0, 1, false, 0x2FE2DCBE, 0x7103A6F5 },
+	{ "adpcm stereo+huffman", MPQ_COMPRESSION_ADPCM_STEREO | MPQ_COMPRESSION_HUFFMANN, 0, 1, false, 0x6EB806FB, 0xBF3F4B38 },
+	{ "adpcm stereo+huffman", MPQ_COMPRESSION_ADPCM_STEREO | MPQ_COMPRESSION_HUFFMANN, 0, 3, false, 0xE3A0F218, 0xF204E119 },
+};
+
+#define CODEC_TEST_COUNT (sizeof(CodecTests) / sizeof(CodecTests[0]))
+
+// Guard bytes behind every output buffer, to catch decoders writing past the end
+#define GUARD_SIZE  64
+#define GUARD_BYTE  0xCC
+
+// Integer-only generator, so the data is the same with every compiler and CRT
+static DWORD Random(DWORD & dwSeed)
+{
+	dwSeed = dwSeed * 1103515245 + 12345;
+	return dwSeed >> 8;
+}
+
+static void FillData(LPBYTE pbData, int cbData, int nKind, DWORD dwSeed)
+{
+	static const char szText[] = "the quick brown fox jumps over the lazy dog\r\n";
+
+	for(int i = 0; i < cbData; i++)
+	{
+		switch(nKind)
+		{
+			case DATA_RANDOM:
+				pbData[i] = (BYTE)Random(dwSeed);
+				break;
+
+			case DATA_TEXT:
+				pbData[i] = (Random(dwSeed) % 46 < 40) ? szText[i % 45] : (BYTE)Random(dwSeed);
+				break;
+
+			case DATA_ZEROS:
+				pbData[i] = 0;
+				break;
+
+			case DATA_WAVE:
+			{
+				int nPhase = (i / 2) % 400;
+				int nSample = ((nPhase < 200) ? nPhase : 400 - nPhase) * 80 - 8000 + (int)(Random(dwSeed) % 200);
+				pbData[i] = (BYTE)((i & 1) ? (nSample >> 8) : nSample);
+				break;
+			}
+
+			case DATA_RUNS:
+				pbData[i] = (Random(dwSeed) % 5 == 0) ? (BYTE)Random(dwSeed) : (BYTE)(i / 7);
+				break;
+		}
+	}
+}
+
+// FNV-1a, folded over several buffers
+static DWORD Digest(DWORD dwDigest, const void * pvData, int cbData)
+{
+	const BYTE * pbData = (const BYTE *)pvData;
+
+	for(int i = 0; i < cbData; i++)
+		dwDigest = (dwDigest ^ pbData[i]) * 16777619;
+	return dwDigest;
+}
+
+#define DIGEST_INIT 2166136261U
+
+// ADPCM works on whole 16-bit samples, so its data is cut down to whole stereo samples
+static int DataSize(const TCodecTest & Test, size_t nSizeIndex)
+{
+	if(Test.uCompressionMask & (MPQ_COMPRESSION_ADPCM_MONO | MPQ_COMPRESSION_ADPCM_STEREO))
+		return DataSizes[nSizeIndex] & ~3;
+	return DataSizes[nSizeIndex];
+}
+
+static bool CheckGuard(LPBYTE pbGuard)
+{
+	for(int i = 0; i < GUARD_SIZE; i++)
+	{
+		if(pbGuard[i] != GUARD_BYTE)
+			return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+
+// Damages a compressed stream the way a bad archive would: a few flipped bits
+// or a cut-off end. The decoder may fail, but must stay inside its buffer.
+static int TestDamagedStream(const TCodecTest & Test, LPBYTE pbPacked, int cbPacked, int cbUnpacked, LPBYTE pbOutput, DWORD & dwSeed)
+{
+	LPBYTE pbDamaged = (LPBYTE)malloc(cbPacked);
+	int nError = ERROR_SUCCESS;
+
+	for(int nMode = 0; nMode < 6 && nError == ERROR_SUCCESS; nMode++)
+	{
+		int cbDamaged = cbPacked;
+		int cbOutput = cbUnpacked;
+
+		memcpy(pbDamaged, pbPacked, cbPacked);
+		if(nMode < 3)
+		{
+			// Keep the compression byte, or only the dispatch gets tested
+			for(int i = 0; i <= nMode; i++)
+				pbDamaged[1 + Random(dwSeed) % (cbPacked - 1)] ^= (BYTE)(1 << (Random(dwSeed) % 8));
+		}
+		else
+		{
+			cbDamaged = 1 + Random(dwSeed) % (cbPacked - 1);
+		}
+
+		memset(pbOutput, GUARD_BYTE, cbUnpacked + GUARD_SIZE);
+		SCompDecompress(pbOutput, &cbOutput, pbDamaged, cbDamaged);
+		if(cbOutput < 0 || cbOutput > cbUnpacked || !CheckGuard(pbOutput + cbUnpacked))
+		{
+			printf("  %s: damaged stream (%d bytes, mode %d) overran the output buffer\n", Test.szName, cbUnpacked, nMode);
+			nError = ERROR_INSUFFICIENT_BUFFER;
+		}
+	}
+
+	free(pbDamaged);
+	return nError;
+}
+
+static int TestCodec(const TCodecTest & Test, LPBYTE pbData, LPBYTE pbPacked, LPBYTE pbOutput)
+{
+	DWORD dwPackedDigest = DIGEST_INIT;
+	DWORD dwUnpackedDigest = DIGEST_INIT;
+	DWORD dwSeed = 0x5EED;
+	int nError = ERROR_SUCCESS;
+
+	for(int nKind = 0; nKind < DATA_KIND_COUNT && nError == ERROR_SUCCESS; nKind++)
+	{
+		for(size_t s = 0; s < DATA_SIZE_COUNT && nError == ERROR_SUCCESS; s++)
+		{
+			int cbData = DataSize(Test, s);
+			int cbPacked = cbData * 2 + 1000;
+			int cbOutput = cbData;
+
+			if(cbData == 0)
+				continue;
+
+			FillData(pbData, cbData, nKind, 12345 + nKind * 1000 + (DWORD)s);
+			if(!SCompCompress(pbPacked, &cbPacked, pbData, cbData, Test.uCompressionMask, Test.nCmpType, Test.nCmpLevel))
+			{
+				printf("  %s: failed to compress %d bytes\n", Test.szName, cbData);
+				nError = GetLastError();
+				break;
+			}
+
+			memset(pbOutput, GUARD_BYTE, cbData + GUARD_SIZE);
+			if(!SCompDecompress(pbOutput, &cbOutput, pbPacked, cbPacked) || cbOutput != cbData)
+			{
+				printf("  %s: failed to decompress %d bytes\n", Test.szName, cbData);
+				nError = ERROR_FILE_CORRUPT;
+				break;
+			}
+
+			if(!CheckGuard(pbOutput + cbData))
+			{
+				printf("  %s: decompression of %d bytes overran the output buffer\n", Test.szName, cbData);
+				nError = ERROR_INSUFFICIENT_BUFFER;
+				break;
+			}
+
+			if(Test.bLossless && memcmp(pbOutput, pbData, cbData))
+			{
+				printf("  %s: round trip of %d bytes changed the data\n", Test.szName, cbData);
+				nError = ERROR_FILE_CORRUPT;
+				break;
+			}
+
+			dwPackedDigest = Digest(dwPackedDigest, &cbPacked, sizeof(int));
+			dwPackedDigest = Digest(dwPackedDigest, pbPacked, cbPacked);
+			dwUnpackedDigest = Digest(dwUnpackedDigest, pbOutput, cbOutput);
+
+			// Streams the codec could not shrink are stored as they are, and damaging
+			// those would test whatever codec their first byte happens to select
+			if(cbPacked < cbData)
+				nError = TestDamagedStream(Test, pbPacked, cbPacked, cbData, pbOutput, dwSeed);
+		}
+	}
+
+	if(nError == ERROR_SUCCESS && (dwPackedDigest != Test.dwPackedDigest || dwUnpackedDigest != Test.dwUnpackedDigest))
+	{
+		printf("  %s (level %d): output differs from the old codecs, digests %08X %08X, expected %08X %08X\n",
+			Test.szName, Test.nCmpLevel, dwPackedDigest, dwUnpackedDigest, Test.dwPackedDigest, Test.dwUnpackedDigest);
+		nError = ERROR_FILE_CORRUPT;
+	}
+
+	return nError;
+}
+
+// Compresses and decompresses every kind and size of test data with every codec.
+// Lossless codecs must give the data back. All codecs must give exactly the
+// bytes the old decoders gave, and must survive damaged streams.
+int TestCompression()
+{
+	LPBYTE pbData = (LPBYTE)malloc(DATA_SIZE_MAX);
+	LPBYTE pbPacked = (LPBYTE)malloc(DATA_SIZE_MAX * 2 + 1000);
+	LPBYTE pbOutput = (LPBYTE)malloc(DATA_SIZE_MAX + GUARD_SIZE);
+	int nResult = ERROR_SUCCESS;
+
+	for(size_t i = 0; i < CODEC_TEST_COUNT; i++)
+	{
+		int nError = TestCodec(CodecTests[i], pbData, pbPacked, pbOutput);
+
+		printf("%-24s level %d: %s\n", CodecTests[i].szName, CodecTests[i].nCmpLevel, (nError == ERROR_SUCCESS) ? "OK" : "FAILED");
+		if(nError != ERROR_SUCCESS)
+			nResult = nError;
+	}
+
+	free(pbOutput);
+	free(pbPacked);
+	free(pbData);
+	return nResult;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+
+// Decompression speed of each codec on the compressible test data of 4 KB and
+// more, in MB of output per second
+int BenchCompression()
+{
+	LPBYTE pbData = (LPBYTE)malloc(DATA_SIZE_MAX);
+	LPBYTE pbOutput = (LPBYTE)malloc(DATA_SIZE_MAX);
+	int nResult = ERROR_SUCCESS;
+
+	for(size_t i = 0; i < CODEC_TEST_COUNT; i++)
+	{
+		const TCodecTest & Test = CodecTests[i];
+		LPBYTE Streams[DATA_KIND_COUNT * DATA_SIZE_COUNT];
+		int StreamSizes[DATA_KIND_COUNT * DATA_SIZE_COUNT];
+		int DataSizesUsed[DATA_KIND_COUNT * DATA_SIZE_COUNT];
+		int nStreams = 0;
+
+		for(int nKind = 0; nKind < DATA_KIND_COUNT; nKind++)
+		{
+			if(nKind == DATA_RANDOM)
+				continue;
+
+			for(size_t s = 0; s < DATA_SIZE_COUNT; s++)
+			{
+				int cbData = DataSize(Test, s);
+				int cbPacked = cbData * 2 + 1000;
+
+				if(cbData < 4096)
+					continue;
+
+				FillData(pbData, cbData, nKind, 12345 + nKind * 1000 + (DWORD)s);
+				Streams[nStreams] = (LPBYTE)malloc(cbPacked);
+				if(!SCompCompress(Streams[nStreams], &cbPacked, pbData, cbData, Test.uCompressionMask, Test.nCmpType, Test.nCmpLevel))
+				{
+					free(Streams[nStreams]);
+					nResult = GetLastError();
+					continue;
+				}
+
+				StreamSizes[nStreams] = cbPacked;
+				DataSizesUsed[nStreams] = cbData;
+				nStreams++;
+			}
+		}
+
+		// Run for about a second
+		double dfBytes = 0;
+		clock_t Start = clock();
+		clock_t Elapsed = 0;
+
+		while((Elapsed = clock() - Start) < CLOCKS_PER_SEC)
+		{
+			for(int j = 0; j < nStreams; j++)
+			{
+				int cbOutput = DataSizesUsed[j];
+
+				SCompDecompress(pbOutput, &cbOutput, Streams[j], StreamSizes[j]);
+				dfBytes += cbOutput;
+			}
+		}
+
+		printf("%-24s level %d: %8.1f MB/s\n", Test.szName, Test.nCmpLevel, dfBytes / ((double)Elapsed / CLOCKS_PER_SEC) / (1024 * 1024));
+
+		for(int j = 0; j < nStreams; j++)
+			free(Streams[j]);
+	}
+
+	free(pbOutput);
+	free(pbData);
+	return nResult;
+}
@@ -0,0 +1,441 @@
+// TestHttpStream.cpp : Range requests of the HTTP stream, against a local stand-in server.
+//
+
+#include "stdafx.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <strings.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "StormLib.h"
+#include "TestStormLib.h"
+
+#ifdef _WIN32
+typedef SOCKET TSocket;
+typedef int socklen_t;
+#define closesocket_ closesocket
+#define strncasecmp _strnicmp
+#else
+typedef int TSocket;
+#define INVALID_SOCKET  -1
+#define closesocket_ close
+#endif
+
+//-----------------------------------------------------------------------------
+// Stand-in server
+//
+// Serves one file from memory at every path. It understands "Range: bytes=a-b",
+// answers one request per connection and logs the ranges it was asked for.
+
+#define TEST_FILE_SIZE      1000003     // Not a multiple of the sparse block size
+#define TEST_BLOCK_SIZE     0x4000
+#define MAX_LOGGED_REQUESTS 256
+
+struct TRangeRequest
+{
+	long long Start;                    // -1 if the request had no range
+	long long End;
+};
+
+struct TTestServer
+{
+	TSocket ListenSocket;
+	unsigned short Port;
+	volatile bool bStop;
+
+	LPBYTE pbFile;
+
+	// Each entry is written before the response is sent, so the client sees it
+	// once its read has returned
+	TRangeRequest Requests[MAX_LOGGED_REQUESTS];
+	volatile int nRequests;
+};
+
+static void ServeRequest(TTestServer * pServer, TSocket sock)
+{
+	char szRequest[0x1000];
+	char szHeader[0x200];
+	const char * szRange;
+	long long Start = -1;
+	long long End = TEST_FILE_SIZE - 1;
+	int cbRequest = 0;
+	int cbHeader;
+	int nSent;
+
+	// Receive the request header
+	szRequest[0] = 0;
+	while(strstr(szRequest, "\r\n\r\n") == NULL && cbRequest < (int)sizeof(szRequest) - 1)
+	{
+		int nReceived = recv(sock, szRequest + cbRequest, sizeof(szRequest) - 1 - cbRequest, 0);
+		if(nReceived <= 0)
+			return;
+		cbRequest += nReceived;
+		szRequest[cbRequest] = 0;
+	}
+
+	// Find the range
+	for(szRange = strstr(szRequest, "\r\n"); szRange != NULL; szRange = strstr(szRange, "\r\n"))
+	{
+		szRange += 2;
+		if(!strncasecmp(szRange, "Range: bytes=", 13))
+		{
+			if(sscanf(szRange + 13, "%lld-%lld", &Start, &End) != 2)
+				Start = -1;
+			break;
+		}
+	}
+
+	if(pServer->nRequests < MAX_LOGGED_REQUESTS)
+	{
+		pServer->Requests[pServer->nRequests].Start = Start;
+		pServer->Requests[pServer->nRequests].End = End;
+		pServer->nRequests++;
+	}
+
+	// Answer with the part of the file, the whole file or an error
+	if(Start >= TEST_FILE_SIZE)
+	{
+		cbHeader = sprintf(szHeader, "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+		send(sock, szHeader, cbHeader, 0);
+		return;
+	}
+
+	if(Start >= 0)
+	{
+		if(End >= TEST_FILE_SIZE)
+			End = TEST_FILE_SIZE - 1;
+		cbHeader = sprintf(szHeader, "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lld-%lld/%d\r\nContent-Length: %lld\r\nConnection: close\r\n\r\n",
+			Start, End, TEST_FILE_SIZE, End - Start + 1);
+	}
+	else
+	{
+		Start = 0;
+		cbHeader = sprintf(szHeader, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", TEST_FILE_SIZE);
+	}
+
+	// The client may hang up early, e.g. after reading the headers only
+	if(send(sock, szHeader, cbHeader, 0) != cbHeader)
+		return;
+	for(long long Offset = Start; Offset <= End; Offset += nSent)
+	{
+		nSent = send(sock, (const char *)pServer->pbFile + Offset, (int)(End - Offset + 1), 0);
+		if(nSent <= 0)
+			break;
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI ServerThread(LPVOID pvServer)
+#else
+static void * ServerThread(void * pvServer)
+#endif
+{
+	TTestServer * pServer = (TTestServer *)pvServer;
+
+	for(;;)
+	{
+		TSocket sock = accept(pServer->ListenSocket, NULL, NULL);
+
+		if(pServer->bStop)
+		{
+			if(sock != INVALID_SOCKET)
+				closesocket_(sock);
+			break;
+		}
+
+		if(sock != INVALID_SOCKET)
+		{
+			ServeRequest(pServer, sock);
+			closesocket_(sock);
+		}
+	}
+
+	return 0;
+}
+
+static bool StartServer(TTestServer * pServer)
+{
+	struct sockaddr_in Addr;
+	socklen_t cbAddr = sizeof(Addr);
+
+	memset(&Addr, 0, sizeof(Addr));
+	Addr.sin_family = AF_INET;
+	Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	Addr.sin_port = 0;
+
+	// Listen on any free port
+	pServer->ListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if(pServer->ListenSocket == INVALID_SOCKET)
+		return false;
+	if(bind(pServer->ListenSocket, (struct sockaddr *)&Addr, sizeof(Addr)) != 0 ||
+	   getsockname(pServer->ListenSocket, (struct sockaddr *)&Addr, &cbAddr) != 0 ||
+	   listen(pServer->ListenSocket, 16) != 0)
+	{
+		closesocket_(pServer->ListenSocket);
+		return false;
+	}
+
+	pServer->Port = ntohs(Addr.sin_port);
+	pServer->bStop = false;
+	pServer->nRequests = 0;
+	return true;
+}
+
+// Wakes the server thread up with a connection of our own
+static void StopServer(TTestServer * pServer)
+{
+	struct sockaddr_in Addr;
+	TSocket sock;
+
+	memset(&Addr, 0, sizeof(Addr));
+	Addr.sin_family = AF_INET;
+	Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	Addr.sin_port = htons(pServer->Port);
+
+	pServer->bStop = true;
+	sock = socket(AF_INET, SOCK_STREAM, 0);
+	if(sock != INVALID_SOCKET)
+	{
+		connect(sock, (struct sockaddr *)&Addr, sizeof(Addr));
+		closesocket_(sock);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+
+// Reads a part of the stream and checks it against the file. If bNewRequest
+// is set, the read must have gone to the server, and its last range request
+// must cover the read. Opening the source may take a request before that.
+static int TestRead(TFileStream * pStream, TTestServer * pServer, ULONGLONG ByteOffset, DWORD dwBytesToRead, bool bNewRequest, LPBYTE pbBuffer)
+{
+	int nRequests = pServer->nRequests;
+
+	if(!FileStream_Read(pStream, &ByteOffset, pbBuffer, dwBytesToRead))
+	{
+		printf("  failed to read %u bytes at %u\n", dwBytesToRead, (DWORD)ByteOffset);
+		return GetLastError();
+	}
+
+	if(memcmp(pbBuffer, pServer->pbFile + ByteOffset, dwBytesToRead))
+	{
+		printf("  wrong data in %u bytes at %u\n", dwBytesToRead, (DWORD)ByteOffset);
+		return ERROR_FILE_CORRUPT;
+	}
+
+	if(bNewRequest)
+	{
+		const TRangeRequest & Request = pServer->Requests[pServer->nRequests - 1];
+
+		if(pServer->nRequests == nRequests || Request.Start < 0 ||
+		   Request.Start > (long long)ByteOffset || Request.End < (long long)(ByteOffset + dwBytesToRead - 1))
+		{
+			printf("  read of %u bytes at %u was not a range request\n", dwBytesToRead, (DWORD)ByteOffset);
+			return ERROR_CAN_NOT_COMPLETE;
+		}
+	}
+	else if(pServer->nRequests != nRequests)
+	{
+		printf("  read of %u bytes at %u went to the server\n", dwBytesToRead, (DWORD)ByteOffset);
+		return ERROR_CAN_NOT_COMPLETE;
+	}
+
+	return ERROR_SUCCESS;
+}
+
+// Reads straight from the server. Every read is a range request,
+// and the size comes from the server's answer when the stream is open.
+static int TestHttpRead(TTestServer * pServer, const char * szUrl)
+{
+	TFileStream * pStream;
+	ULONGLONG FileSize = 0;
+	ULONGLONG ByteOffset = TEST_FILE_SIZE - 10;
+	LPBYTE pbBuffer = (LPBYTE)malloc(TEST_FILE_SIZE);
+	int nError = ERROR_SUCCESS;
+
+	pStream = FileStream_OpenFile(szUrl, STREAM_FLAG_READ_ONLY | STREAM_PROVIDER_LINEAR | BASE_PROVIDER_HTTP);
+	if(pStream == NULL)
+	{
+		printf("  failed to open %s\n", szUrl);
+		free(pbBuffer);
+		return GetLastError();
+	}
+
+	FileStream_GetSize(pStream, &FileSize);
+	if(FileSize != TEST_FILE_SIZE)
+	{
+		printf("  file size is %u, expected %u\n", (DWORD)FileSize, TEST_FILE_SIZE);
+		nError = ERROR_BAD_FORMAT;
+	}
+
+	if(nError == ERROR_SUCCESS)
+		nError = TestRead(pStream, pServer, 0, 100, true, pbBuffer);
+	if(nError == ERROR_SUCCESS)
+		nError = TestRead(pStream, pServer, 500000, 70000, true, pbBuffer);
+	if(nError == ERROR_SUCCESS)
+		nError = TestRead(pStream, pServer, TEST_FILE_SIZE - 10, 10, true, pbBuffer);
+
+	// Reading past the end must fail
+	if(nError == ERROR_SUCCESS && FileStream_Read(pStream, &ByteOffset, pbBuffer, 20))
+	{
+		printf("  read past the end of the file did not fail\n");
+		nError = ERROR_CAN_NOT_COMPLETE;
+	}
+
+	FileStream_Close(pStream);
+	free(pbBuffer);
+	return nError;
+}
+
+// Fetch callback that fails the way a broken connection would
+static bool WINAPI FailingFetch(void * /* pvUserData */, ULONGLONG /* ByteOffset */, void * /* pvBuffer */, DWORD /* dwBytesToFetch */)
+{
+	SetLastError(ERROR_ACCESS_DENIED);
+	return false;
+}
+
+// Reads through a sparse file. The missing blocks are fetched with one
+// block-aligned range request, and they are not fetched again.
+static int TestSparseRead(TTestServer * pServer, const char * szUrl)
+{
+	const char * szSparseFile = "TestHttpStream.sparse";
+	TFileStreamStats Stats;
+	TFileStream * pStream;
+	LPBYTE pbBuffer = (LPBYTE)malloc(TEST_FILE_SIZE);
+	int nError = ERROR_SUCCESS;
+
+	if(!FileStream_CreateSparse(szSparseFile, szUrl, 0, TEST_BLOCK_SIZE))
+	{
+		printf("  failed to create %s\n", szSparseFile);
+		free(pbBuffer);
+		return GetLastError();
+	}
+
+	pStream = FileStream_OpenFile(szSparseFile, STREAM_PROVIDER_SPARSE | BASE_PROVIDER_FILE);
+	if(pStream == NULL)
+	{
+		printf("  failed to open %s\n", szSparseFile);
+		remove(szSparseFile);
+		free(pbBuffer);
+		return GetLastError();
+	}
+
+	nError = TestRead(pStream, pServer, 100000, 50000, true, pbBuffer);
+	if(nError == ERROR_SUCCESS)
+	{
+		const TRangeRequest & Request = pServer->Requests[pServer->nRequests - 1];
+
+		if((Request.Start % TEST_BLOCK_SIZE) != 0 || ((Request.End + 1) % TEST_BLOCK_SIZE) != 0)
+		{
+			printf("  fetch of bytes %lld-%lld is not block-aligned\n", Request.Start, Request.End);
+			nError = ERROR_CAN_NOT_COMPLETE;
+		}
+	}
+
+	// Reads from the fetched blocks stay local, the incomplete last block is fetched once
+	if(nError == ERROR_SUCCESS)
+		nError = TestRead(pStream, pServer, 110000, 30000, false, pbBuffer);
+	if(nError == ERROR_SUCCESS)
+		nError = TestRead(pStream, pServer, TEST_FILE_SIZE - 5, 5, true, pbBuffer);
+	if(nError == ERROR_SUCCESS)
+		nError = TestRead(pStream, pServer, TEST_FILE_SIZE - 500, 500, false, pbBuffer);
+
+	if(nError == ERROR_SUCCESS && FileStream_GetStats(pStream, &Stats) && Stats.FetchRequests != 2)
+	{
+		printf("  %u fetch requests, expected 2\n", (DWORD)Stats.FetchRequests);
+		nError = ERROR_CAN_NOT_COMPLETE;
+	}
+
+	// A failed fetch keeps the error of the source, it is not reported as corruption
+	if(nError == ERROR_SUCCESS)
+	{
+		ULONGLONG ByteOffset = 0;
+
+		FileStream_SetFetchCallback(pStream, FailingFetch, NULL);
+		if(FileStream_Read(pStream, &ByteOffset, pbBuffer, 100) || GetLastError() != ERROR_ACCESS_DENIED)
+		{
+			printf("  failed fetch was reported with error %u\n", (DWORD)GetLastError());
+			nError = ERROR_CAN_NOT_COMPLETE;
+		}
+	}
+
+	FileStream_Close(pStream);
+	remove(szSparseFile);
+	free(pbBuffer);
+	return nError;
+}
+
+int TestHttpStream()
+{
+	TTestServer Server;
+	char szUrl[0x40];
+	DWORD dwSeed = 0x5EED;
+	int nError = ERROR_SUCCESS;
+
+#ifdef _WIN32
+	WSADATA WsaData;
+	HANDLE hThread;
+
+	WSAStartup(MAKEWORD(2, 2), &WsaData);
+#else
+	pthread_t Thread;
+#endif
+
+	Server.pbFile = (LPBYTE)malloc(TEST_FILE_SIZE);
+	for(int i = 0; i < TEST_FILE_SIZE; i++)
+	{
+		dwSeed = dwSeed * 1103515245 + 12345;
+		Server.pbFile[i] = (BYTE)(dwSeed >> 16);
+	}
+
+	if(!StartServer(&Server))
+	{
+		printf("http stream: failed to start the server\n");
+		free(Server.pbFile);
+		return ERROR_CAN_NOT_COMPLETE;
+	}
+
+#ifdef _WIN32
+	hThread = CreateThread(NULL, 0, ServerThread, &Server, 0, NULL);
+#else
+	pthread_create(&Thread, NULL, ServerThread, &Server);
+#endif
+
+	sprintf(szUrl, "http://127.0.0.1:%u/test.bin", Server.Port);
+
+	nError = TestHttpRead(&Server, szUrl);
+	printf("%-24s: %s\n", "http stream", (nError == ERROR_SUCCESS) ? "OK" : "FAILED");
+
+	if(nError == ERROR_SUCCESS)
+	{
+		nError = TestSparseRead(&Server, szUrl);
+		printf("%-24s: %s\n", "sparse stream over http", (nError == ERROR_SUCCESS) ? "OK" : "FAILED");
+	}
+
+	StopServer(&Server);
+#ifdef _WIN32
+	WaitForSingleObject(hThread, INFINITE);
+	CloseHandle(hThread);
+#else
+	pthread_join(Thread, NULL);
+#endif
+	closesocket_(Server.ListenSocket);
+	free(Server.pbFile);
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return nError;
+}
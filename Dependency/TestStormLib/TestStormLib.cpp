@@ -0,0 +1,40 @@
+// TestStormLib.cpp : Defines the entry point for the console application.
+//
+
+#include "stdafx.h"
+
+#include <string.h>
+
+#include "StormLib.h"
+#include "TestStormLib.h"
+
+#pragma comment(lib, "stormlib.lib")
+
+// Runs the tests. Pass "bench" to also measure the codecs and the archive verification.
+int main(int argc, char* argv[])
+{
+	bool bBench = (argc > 1 && !strcmp(argv[1], "bench"));
+	int err = ERROR_SUCCESS;
+
+	if(TestCompression() != ERROR_SUCCESS)
+		err = ERROR_CAN_NOT_COMPLETE;
+
+	if(TestHttpStream() != ERROR_SUCCESS)
+		err = ERROR_CAN_NOT_COMPLETE;
+
+	if(TestVerify() != ERROR_SUCCESS)
+		err = ERROR_CAN_NOT_COMPLETE;
+
+	if(bBench)
+	{
+		BenchCompression();
+		BenchVerify();
+	}
+
+	if(err == ERROR_SUCCESS)
+		printf("test succeed!\n");
+	else
+		printf("test failed!\n");
+
+	return (err == ERROR_SUCCESS) ? 0 : 1;
+}
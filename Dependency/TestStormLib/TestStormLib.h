@@ -0,0 +1,9 @@
+#pragma once
+
+// Each test returns ERROR_SUCCESS or the error it ran into
+
+int TestCompression();
+int BenchCompression();
+int TestHttpStream();
+int TestVerify();
+int BenchVerify();
@@ -0,0 +1,343 @@
+// TestVerify.cpp : Parallel verification of whole archives against SFileVerifyFile.
+//
+
+#include "stdafx.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "StormLib.h"
+#include "TestStormLib.h"
+
+//-----------------------------------------------------------------------------
+// Test archive
+
+#define TEST_ARCHIVE_NAME   "TestVerify.mpq"
+#define TEST_FILE_COUNT     600
+#define TEST_FILE_MAX_SIZE  100000
+#define TEST_THREAD_COUNT   4
+
+#define BENCH_FILE_COUNT    2000
+#define BENCH_FILE_MAX_SIZE 200000      // About 200 MB in all
+
+#define RESULT_NOT_FOUND    0xFFFFFFFF  // The file has not been found by name
+
+static DWORD Random(DWORD & dwSeed)
+{
+	dwSeed = dwSeed * 1103515245 + 12345;
+	return (dwSeed >> 16) & 0x7FFF;
+}
+
+static double TestTime()
+{
+#ifdef _WIN32
+	LARGE_INTEGER Frequency, Counter;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Counter);
+	return (double)Counter.QuadPart / (double)Frequency.QuadPart;
+#else
+	timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return Now.tv_sec + Now.tv_nsec * 1e-9;
+#endif
+}
+
+// Creates an archive with CRC32 and MD5 in (attributes). The files are stored
+// plain, compressed with sector CRCs, and compressed and encrypted, in turn.
+static int CreateTestArchive(DWORD dwFileCount, DWORD dwMaxFileSize)
+{
+	SFILE_CREATE_MPQ CreateInfo;
+	HANDLE hMpq = NULL;
+	HANDLE hFile = NULL;
+	LPBYTE pbData = (LPBYTE)malloc(dwMaxFileSize);
+	DWORD dwSeed = 0x1234;
+	int nError = ERROR_SUCCESS;
+
+	remove(TEST_ARCHIVE_NAME);
+
+	memset(&CreateInfo, 0, sizeof(CreateInfo));
+	CreateInfo.cbSize = sizeof(SFILE_CREATE_MPQ);
+	CreateInfo.dwMpqVersion = MPQ_FORMAT_VERSION_1;
+	CreateInfo.dwFileFlags1 = MPQ_FILE_COMPRESS;
+	CreateInfo.dwFileFlags2 = MPQ_FILE_COMPRESS;
+	CreateInfo.dwAttrFlags = MPQ_ATTRIBUTE_CRC32 | MPQ_ATTRIBUTE_MD5;
+	CreateInfo.dwSectorSize = 0x1000;
+	CreateInfo.dwMaxFileCount = dwFileCount + 0x10;
+	if(!SFileCreateArchive2(TEST_ARCHIVE_NAME, &CreateInfo, &hMpq))
+	{
+		printf("  failed to create %s\n", TEST_ARCHIVE_NAME);
+		free(pbData);
+		return GetLastError();
+	}
+
+	for(DWORD i = 0; i < dwFileCount && nError == ERROR_SUCCESS; i++)
+	{
+		static const DWORD FileFlags[] = { 0, MPQ_FILE_COMPRESS | MPQ_FILE_SECTOR_CRC, MPQ_FILE_COMPRESS | MPQ_FILE_ENCRYPTED };
+		DWORD dwFileSize = (Random(dwSeed) * 0x8000 + Random(dwSeed)) % dwMaxFileSize;
+		char szFileName[MAX_PATH];
+
+		// Compressible data with some noise in it
+		for(DWORD j = 0; j < dwFileSize; j++)
+			pbData[j] = (j % 7) ? (BYTE)(j / 13) : (BYTE)Random(dwSeed);
+
+		sprintf(szFileName, "data\\file%05u.bin", i);
+		if(!SFileCreateFile(hMpq, szFileName, 0, dwFileSize, 0, FileFlags[i % 3], &hFile))
+		{
+			printf("  failed to add %s\n", szFileName);
+			nError = GetLastError();
+			break;
+		}
+
+		if(!SFileWriteFile(hFile, pbData, dwFileSize, MPQ_COMPRESSION_ZLIB))
+			nError = GetLastError();
+		if(!SFileFinishFile(hFile) && nError == ERROR_SUCCESS)
+			nError = GetLastError();
+	}
+
+	if(!SFileCloseArchive(hMpq, false) && nError == ERROR_SUCCESS)
+		nError = GetLastError();
+	free(pbData);
+	return nError;
+}
+
+// Overwrites a few bytes at several places in the file data of the archive.
+// The tables at the end of the archive stay intact, so it still opens.
+static int CorruptTestArchive()
+{
+	FILE * fp = fopen(TEST_ARCHIVE_NAME, "r+b");
+	long FileSize;
+
+	if(fp == NULL)
+		return ERROR_FILE_NOT_FOUND;
+
+	fseek(fp, 0, SEEK_END);
+	FileSize = ftell(fp);
+	for(int i = 1; i <= 6; i++)
+	{
+		fseek(fp, FileSize / 10 * i, SEEK_SET);
+		fputc(0x55, fp);
+		fputc(0xAA, fp);
+	}
+
+	fclose(fp);
+	return ERROR_SUCCESS;
+}
+
+// Verifies every file by name with SFileVerifyFile. The results are stored
+// by file table index, like in the report of SFileVerifyArchiveFiles.
+static DWORD VerifySerial(HANDLE hMpq, LPDWORD Results, DWORD dwMaxResults)
+{
+	SFILE_FIND_DATA FindData;
+	HANDLE hFind;
+	DWORD dwFileCount = 0;
+
+	for(DWORD i = 0; i < dwMaxResults; i++)
+		Results[i] = RESULT_NOT_FOUND;
+
+	hFind = SFileFindFirstFile(hMpq, "data\\*", &FindData, NULL);
+	if(hFind != NULL)
+	{
+		do
+		{
+			if(FindData.dwBlockIndex < dwMaxResults)
+			{
+				Results[FindData.dwBlockIndex] = SFileVerifyFile(hMpq, FindData.cFileName, SFILE_VERIFY_ALL);
+				dwFileCount++;
+			}
+		}
+		while(SFileFindNextFile(hFind, &FindData));
+
+		SFileFindClose(hFind);
+	}
+
+	return dwFileCount;
+}
+
+// Every file verified by name must be in the report with the same result
+static int CompareReport(PSFILE_VERIFY_REPORT pReport, LPDWORD Results, DWORD dwMaxResults, DWORD dwFileCount)
+{
+	DWORD dwMatched = 0;
+
+	for(DWORD i = 0; i < pReport->dwFileCount; i++)
+	{
+		const SFILE_VERIFY_ENTRY & Entry = pReport->Entries[i];
+
+		if(Entry.dwFileIndex >= dwMaxResults || Results[Entry.dwFileIndex] == RESULT_NOT_FOUND)
+			continue;
+
+		if(Entry.dwVerifyResult != Results[Entry.dwFileIndex])
+		{
+			printf("  file %u: parallel result %04X, SFileVerifyFile gave %04X\n", Entry.dwFileIndex, Entry.dwVerifyResult, Results[Entry.dwFileIndex]);
+			return ERROR_CAN_NOT_COMPLETE;
+		}
+		dwMatched++;
+	}
+
+	if(dwMatched != dwFileCount)
+	{
+		printf("  %u of %u files are in the report\n", dwMatched, dwFileCount);
+		return ERROR_CAN_NOT_COMPLETE;
+	}
+	return ERROR_SUCCESS;
+}
+
+static DWORD CountErrors(LPDWORD Results, DWORD dwMaxResults)
+{
+	DWORD dwErrors = 0;
+
+	for(DWORD i = 0; i < dwMaxResults; i++)
+	{
+		if(Results[i] != RESULT_NOT_FOUND && (Results[i] & VERIFY_FILE_ERROR_MASK))
+			dwErrors++;
+	}
+	return dwErrors;
+}
+
+// Opens the test archive and checks that the parallel verification gives
+// what SFileVerifyFile gives for each file. bCorrupt tells whether errors are expected.
+static int VerifyTestArchive(bool bCorrupt)
+{
+	PSFILE_VERIFY_REPORT pReport = NULL;
+	HANDLE hMpq = NULL;
+	DWORD dwMaxResults = TEST_FILE_COUNT + 0x10;
+	LPDWORD Results = (LPDWORD)malloc(dwMaxResults * sizeof(DWORD));
+	DWORD dwFileCount;
+	DWORD dwErrors;
+	int nError = ERROR_SUCCESS;
+
+	if(!SFileOpenArchive(TEST_ARCHIVE_NAME, 0, STREAM_FLAG_READ_ONLY, &hMpq))
+	{
+		printf("  failed to open %s\n", TEST_ARCHIVE_NAME);
+		free(Results);
+		return GetLastError();
+	}
+
+	dwFileCount = VerifySerial(hMpq, Results, dwMaxResults);
+	dwErrors = CountErrors(Results, dwMaxResults);
+	if(dwFileCount != TEST_FILE_COUNT)
+	{
+		printf("  found %u files, expected %u\n", dwFileCount, TEST_FILE_COUNT);
+		nError = ERROR_FILE_NOT_FOUND;
+	}
+	else if(bCorrupt != (dwErrors != 0))
+	{
+		printf("  SFileVerifyFile found %u damaged files\n", dwErrors);
+		nError = ERROR_CAN_NOT_COMPLETE;
+	}
+
+	if(nError == ERROR_SUCCESS && !SFileVerifyArchiveFiles(hMpq, SFILE_VERIFY_ALL, TEST_THREAD_COUNT, &pReport))
+	{
+		printf("  SFileVerifyArchiveFiles failed\n");
+		nError = GetLastError();
+	}
+
+	if(nError == ERROR_SUCCESS)
+		nError = CompareReport(pReport, Results, dwMaxResults, dwFileCount);
+
+	if(pReport != NULL)
+		SFileFreeVerifyReport(pReport);
+	SFileCloseArchive(hMpq, false);
+	free(Results);
+	return nError;
+}
+
+//-----------------------------------------------------------------------------
+// Test
+
+// Verifies a good archive, then the same archive with damaged file data
+int TestVerify()
+{
+	int nError = CreateTestArchive(TEST_FILE_COUNT, TEST_FILE_MAX_SIZE);
+
+	if(nError == ERROR_SUCCESS)
+	{
+		nError = VerifyTestArchive(false);
+		printf("%-24s: %s\n", "verify, good archive", (nError == ERROR_SUCCESS) ? "OK" : "FAILED");
+	}
+
+	if(nError == ERROR_SUCCESS)
+		nError = CorruptTestArchive();
+	if(nError == ERROR_SUCCESS)
+	{
+		nError = VerifyTestArchive(true);
+		printf("%-24s: %s\n", "verify, damaged archive", (nError == ERROR_SUCCESS) ? "OK" : "FAILED");
+	}
+
+	remove(TEST_ARCHIVE_NAME);
+	return nError;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+
+// Time to verify a larger archive file by file, then with 1, 2, 4 and one
+// worker thread per CPU. The archive is read once before, so all runs find
+// it in the file cache.
+int BenchVerify()
+{
+	static const DWORD ThreadCounts[] = { 1, 2, 4, SFILE_VERIFY_THREADS_DEFAULT };
+	PSFILE_VERIFY_REPORT pReport;
+	HANDLE hMpq = NULL;
+	DWORD dwMaxResults = BENCH_FILE_COUNT + 0x10;
+	LPDWORD Results = (LPDWORD)malloc(dwMaxResults * sizeof(DWORD));
+	double dfSerial;
+	double dfStart;
+	double dfMBytes;
+	int nError;
+
+	nError = CreateTestArchive(BENCH_FILE_COUNT, BENCH_FILE_MAX_SIZE);
+	if(nError == ERROR_SUCCESS && !SFileOpenArchive(TEST_ARCHIVE_NAME, 0, STREAM_FLAG_READ_ONLY, &hMpq))
+		nError = GetLastError();
+
+	if(nError == ERROR_SUCCESS)
+	{
+		VerifySerial(hMpq, Results, dwMaxResults);
+
+		dfStart = TestTime();
+		VerifySerial(hMpq, Results, dwMaxResults);
+		dfSerial = TestTime() - dfStart;
+
+		if(SFileVerifyArchiveFiles(hMpq, SFILE_VERIFY_ALL, 1, &pReport))
+		{
+			dfMBytes = (double)pReport->BytesVerified / (1024 * 1024);
+			printf("%-24s: %8.3f s, %8.1f MB/s\n", "verify, file by file", dfSerial, dfMBytes / dfSerial);
+			SFileFreeVerifyReport(pReport);
+
+			for(size_t i = 0; i < sizeof(ThreadCounts) / sizeof(ThreadCounts[0]); i++)
+			{
+				char szName[0x20];
+				double dfTime;
+
+				dfStart = TestTime();
+				if(!SFileVerifyArchiveFiles(hMpq, SFILE_VERIFY_ALL, ThreadCounts[i], &pReport))
+				{
+					nError = GetLastError();
+					break;
+				}
+				dfTime = TestTime() - dfStart;
+
+				sprintf(szName, "verify, %u threads", pReport->dwThreadCount);
+				printf("%-24s: %8.3f s, %8.1f MB/s, x%.2f\n", szName, dfTime, dfMBytes / dfTime, dfSerial / dfTime);
+				SFileFreeVerifyReport(pReport);
+			}
+		}
+		else
+		{
+			nError = GetLastError();
+		}
+	}
+
+	if(hMpq != NULL)
+		SFileCloseArchive(hMpq, false);
+	remove(TEST_ARCHIVE_NAME);
+	free(Results);
+	return nError;
+}
@@ -0,0 +1,25 @@
+#include "stdafx.h"
+
+#include <stdlib.h>
+
+// StormLib leaves its allocator to the application
+
+void* Malloc(size_t nSize)
+{
+	return malloc(nSize);
+}
+
+void Free(void * ptr)
+{
+	free(ptr);
+}
+
+void* TempMalloc(size_t nSize)
+{
+	return malloc(nSize);
+}
+
+void TempFree(void* ptr)
+{
+	free(ptr);
+}
@@ -0,0 +1,49 @@
+/*
+** $Id: lbundle.h $
+** Bundles of precompiled chunks
+** See Copyright Notice in lua.h
+*/
+
+
+#ifndef lbundle_h
+#define lbundle_h
+
+
+#include "lua.h"
+
+
+/*
+** A bundle packs the precompiled chunks of a script tree into one file,
+** as written by `luacompiler -b':
+**   header   luaL_BundleHeader
+**   index    luaL_BundleEntry[count], sorted by module name (strcmp)
+**   names    module names ("ui.button"), each followed by '\0'
+**   chunks   bytecode, as written by luaU_dump
+** Offsets are from the start of the file. Like the bytecode itself, all
+** fields are in the byte order of the machine that wrote the bundle.
+*/
+
+#define LUA_BUNDLESIGNATURE	"\033LuB"
+#define LUA_BUNDLEVERSION	1
+
+
+typedef struct luaL_BundleHeader {
+  char signature[4];  /* LUA_BUNDLESIGNATURE */
+  LUAI_UINT32 version;  /* LUA_BUNDLEVERSION */
+  LUAI_UINT32 count;  /* number of entries in the index */
+  LUAI_UINT32 size;  /* total size of the bundle */
+} luaL_BundleHeader;
+
+
+typedef struct luaL_BundleEntry {
+  LUAI_UINT32 name;  /* offset of the module name */
+  LUAI_UINT32 offset;  /* offset of the chunk */
+  LUAI_UINT32 size;  /* size of the chunk */
+  LUAI_UINT32 hash;  /* hash of the script the chunk was compiled from */
+} luaL_BundleEntry;
+
+
+LUALIB_API int (luaL_openbundle) (lua_State *L, const char *filename);
+
+
+#endif
@@ -100,6 +100,18 @@ typedef lu_int32 Instruction;
 #endif
 
 
+/* strings up to this length are hashed in full, longer ones are sampled */
+#ifndef LUAI_HASHLIMIT
+#define LUAI_HASHLIMIT	256
+#endif
+
+
+/* string table buckets rehashed each time a string is created */
+#ifndef LUAI_REHASHSTEP
+#define LUAI_REHASHSTEP	4
+#endif
+
+
 /* minimum size for string buffer */
 #ifndef LUA_MINBUFFER
 #define LUA_MINBUFFER	32
@@ -0,0 +1,42 @@
+/*
+** $Id: lpool.h $
+** Pooled allocator and frame-budgeted garbage collection
+** See Copyright Notice in lua.h
+*/
+
+
+#ifndef lpool_h
+#define lpool_h
+
+
+#include <stddef.h>
+
+#include "lua.h"
+
+
+/* blocks up to this size are served from size-class pools */
+#define LUAL_POOLMAX	256
+
+
+typedef struct luaL_PoolStats {
+  size_t inuse;       /* bytes currently allocated by the state */
+  size_t peak;        /* highest value reached by `inuse' */
+  size_t arena;       /* bytes reserved in arena pages */
+  size_t nalloc;      /* number of new blocks */
+  size_t nfree;       /* number of released blocks */
+  size_t nrealloc;    /* number of resized blocks */
+  size_t npooled;     /* blocks handed out by the size-class pools */
+  size_t nlarge;      /* blocks handed out by malloc */
+  size_t gcsteps;     /* collector steps run by luaL_gcbudget */
+  size_t gccycles;    /* collection cycles finished by luaL_gcbudget */
+  double gctime;      /* microseconds spent in luaL_gcbudget */
+  double gclast;      /* microseconds spent in the last luaL_gcbudget */
+} luaL_PoolStats;
+
+
+LUALIB_API lua_State *(luaL_newpoolstate) (void);
+LUALIB_API int (luaL_poolstats) (lua_State *L, luaL_PoolStats *s);
+LUALIB_API int (luaL_gcbudget) (lua_State *L, int usec);
+
+
+#endif
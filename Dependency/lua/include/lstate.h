@@ -39,6 +39,10 @@ typedef struct stringtable {
   GCObject **hash;
   lu_int32 nuse;  /* number of elements */
   int size;
+  GCObject **oldhash;  /* previous `hash' while it is being rehashed */
+  int oldsize;  /* size of `oldhash' (0 if not rehashing) */
+  int rehashpos;  /* first bucket of `oldhash' not yet moved */
+  int minsize;  /* size reserved with LUA_GCRESERVESTR */
 } stringtable;
 
 
@@ -71,7 +75,7 @@ typedef struct global_State {
   void *ud;         /* auxiliary data to `frealloc' */
   lu_byte currentwhite;
   lu_byte gcstate;  /* state of garbage collector */
-  int sweepstrgc;  /* position of sweep in `strt' */
+  int sweepstrgc;  /* position of sweep in `strt' (old buckets first) */
   GCObject *rootgc;  /* list of all collectable objects */
   GCObject **sweepgc;  /* position of sweep in `rootgc' */
   GCObject *gray;  /* list of gray objects */
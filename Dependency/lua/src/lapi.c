@@ -948,6 +948,10 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
       g->gcstepmul = data;
       break;
     }
+    case LUA_GCRESERVESTR: {
+      res = luaS_reserve(L, data);
+      break;
+    }
     default: res = -1;  /* invalid option */
   }
   lua_unlock(L);
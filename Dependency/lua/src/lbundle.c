@@ -0,0 +1,232 @@
+/*
+** $Id: lbundle.c $
+** Bundles of precompiled chunks
+** See Copyright Notice in lua.h
+*/
+
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/* This file uses only the official API of Lua.
+** Any function declared here could be written as an application function.
+*/
+
+#define lbundle_c
+#define LUA_LIB
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lbundle.h"
+#include "lualib.h"
+
+
+#define BUNDLEHANDLE	"BUNDLE*"
+
+
+/*
+** A mapped bundle, kept alive by the loaders that use it and unmapped
+** when it is collected. Chunks are undumped straight from the mapping,
+** and the undumped functions do not point into it.
+*/
+typedef struct Bundle {
+  const char *data;  /* mapped file, or NULL */
+  size_t size;
+#if defined(_WIN32)
+  HANDLE file;
+  HANDLE mapping;
+#endif
+} Bundle;
+
+
+static int map_bundle (Bundle *b, const char *filename) {
+#if defined(_WIN32)
+  LARGE_INTEGER size;
+  b->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (b->file == INVALID_HANDLE_VALUE) return 0;
+  if (!GetFileSizeEx(b->file, &size) || size.QuadPart == 0) return 0;
+  b->mapping = CreateFileMappingA(b->file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (b->mapping == NULL) return 0;
+  b->data = (const char *)MapViewOfFile(b->mapping, FILE_MAP_READ, 0, 0, 0);
+  b->size = (size_t)size.QuadPart;
+#else
+  struct stat st;
+  void *p;
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return 0;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+  p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  /* the mapping stays valid */
+  if (p == MAP_FAILED) return 0;
+  b->data = (const char *)p;
+  b->size = (size_t)st.st_size;
+#endif
+  return b->data != NULL;
+}
+
+
+static void unmap_bundle (Bundle *b) {
+#if defined(_WIN32)
+  if (b->data) UnmapViewOfFile(b->data);
+  if (b->mapping) CloseHandle(b->mapping);
+  if (b->file != INVALID_HANDLE_VALUE) CloseHandle(b->file);
+  b->mapping = NULL;
+  b->file = INVALID_HANDLE_VALUE;
+#else
+  if (b->data) munmap((void *)b->data, b->size);
+#endif
+  b->data = NULL;
+}
+
+
+static int bundle_gc (lua_State *L) {
+  unmap_bundle((Bundle *)lua_touserdata(L, 1));
+  return 0;
+}
+
+
+static const luaL_BundleHeader *getheader (const Bundle *b) {
+  return (const luaL_BundleHeader *)b->data;
+}
+
+
+static const luaL_BundleEntry *getindex (const Bundle *b) {
+  return (const luaL_BundleEntry *)(getheader(b) + 1);
+}
+
+
+/* checks that the header, the index and all names lie in the file */
+static int check_bundle (const Bundle *b) {
+  const luaL_BundleHeader *h = getheader(b);
+  const luaL_BundleEntry *e = getindex(b);
+  LUAI_UINT32 i;
+  if (b->size < sizeof(luaL_BundleHeader) ||
+      memcmp(h->signature, LUA_BUNDLESIGNATURE, sizeof(h->signature)) != 0 ||
+      h->version != LUA_BUNDLEVERSION || h->size != b->size ||
+      h->count > (b->size - sizeof(*h)) / sizeof(*e))
+    return 0;
+  for (i = 0; i < h->count; i++) {
+    if (e[i].name >= b->size ||
+        memchr(b->data + e[i].name, '\0', b->size - e[i].name) == NULL ||
+        e[i].offset > b->size || e[i].size > b->size - e[i].offset)
+      return 0;
+  }
+  return 1;
+}
+
+
+static const luaL_BundleEntry *findentry (const Bundle *b, const char *name) {
+  const luaL_BundleEntry *e = getindex(b);
+  LUAI_UINT32 lo = 0;
+  LUAI_UINT32 hi = getheader(b)->count;
+  while (lo < hi) {  /* binary search in the sorted index */
+    LUAI_UINT32 mid = lo + (hi - lo) / 2;
+    int c = strcmp(name, b->data + e[mid].name);
+    if (c == 0) return &e[mid];
+    else if (c < 0) hi = mid;
+    else lo = mid + 1;
+  }
+  return NULL;
+}
+
+
+typedef struct LoadB {
+  const char *s;
+  size_t size;
+} LoadB;
+
+
+static const char *getB (lua_State *L, void *ud, size_t *size) {
+  LoadB *lb = (LoadB *)ud;
+  (void)L;
+  if (lb->size == 0) return NULL;
+  *size = lb->size;  /* the whole chunk, read in place from the mapping */
+  lb->size = 0;
+  return lb->s;
+}
+
+
+/* package.loaders entry; upvalues are the bundle and its file name */
+static int loader_bundle (lua_State *L) {
+  const char *name = luaL_checkstring(L, 1);
+  Bundle *b = (Bundle *)lua_touserdata(L, lua_upvalueindex(1));
+  const luaL_BundleEntry *e = (b->data != NULL) ? findentry(b, name) : NULL;
+  LoadB lb;
+  if (e == NULL) {
+    lua_pushfstring(L, "\n\tno module " LUA_QS " in bundle " LUA_QS, name,
+                       lua_tostring(L, lua_upvalueindex(2)));
+    return 1;
+  }
+  lb.s = b->data + e->offset;
+  lb.size = e->size;
+  if (lua_load(L, getB, &lb, name) != 0)
+    luaL_error(L, "error loading module " LUA_QS " from bundle " LUA_QS ":\n\t%s",
+                  name, lua_tostring(L, lua_upvalueindex(2)),
+                  lua_tostring(L, -1));
+  return 1;  /* library loader */
+}
+
+
+/*
+** Maps a bundle written by `luacompiler -b' and adds a loader for it to
+** package.loaders, right after the preload loader, so `require' finds
+** its modules before searching package.path. Modules are undumped on
+** first `require' only. Bundles opened later take precedence. Returns 0,
+** or LUA_ERRFILE with an error message on the stack.
+*/
+LUALIB_API int luaL_openbundle (lua_State *L, const char *filename) {
+  Bundle *b;
+  int n;
+  lua_getfield(L, LUA_GLOBALSINDEX, LUA_LOADLIBNAME);
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    lua_pushliteral(L, "cannot open bundle: package library not opened");
+    return LUA_ERRFILE;
+  }
+  lua_getfield(L, -1, "loaders");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 2);
+    lua_pushliteral(L, LUA_QL("package.loaders") " must be a table");
+    return LUA_ERRFILE;
+  }
+  b = (Bundle *)lua_newuserdata(L, sizeof(Bundle));
+  memset(b, 0, sizeof(Bundle));
+#if defined(_WIN32)
+  b->file = INVALID_HANDLE_VALUE;
+#endif
+  if (luaL_newmetatable(L, BUNDLEHANDLE)) {
+    lua_pushcfunction(L, bundle_gc);
+    lua_setfield(L, -2, "__gc");
+  }
+  lua_setmetatable(L, -2);
+  if (!map_bundle(b, filename) || !check_bundle(b)) {
+    unmap_bundle(b);
+    lua_pop(L, 3);
+    lua_pushfstring(L, "cannot open bundle %s", filename);
+    return LUA_ERRFILE;
+  }
+  lua_pushstring(L, filename);
+  lua_pushcclosure(L, loader_bundle, 2);
+  for (n = (int)lua_objlen(L, -2); n >= 2; n--) {  /* make room at 2 */
+    lua_rawgeti(L, -2, n);
+    lua_rawseti(L, -3, n + 1);
+  }
+  lua_rawseti(L, -2, 2);
+  lua_pop(L, 2);
+  return 0;
+}
+
@@ -452,6 +452,12 @@ LUA_API int lua_yield (lua_State *L, int nresults) {
 }
 
 
+/* true if lua_yield would succeed, i.e. no C call or metamethod in between */
+LUA_API int lua_isyieldable (lua_State *L) {
+  return L->nCcalls <= L->baseCcalls;
+}
+
+
 int luaD_pcall (lua_State *L, Pfunc func, void *u,
                 ptrdiff_t old_top, ptrdiff_t ef) {
   int status;
@@ -432,7 +432,7 @@ static void checkSizes (lua_State *L) {
   global_State *g = G(L);
   /* check size of string hash */
   if (g->strt.nuse < cast(lu_int32, g->strt.size/4) &&
-      g->strt.size > MINSTRTABSIZE*2)
+      g->strt.size > MINSTRTABSIZE*2 && g->strt.size > g->strt.minsize)
     luaS_resize(L, g->strt.size/2);  /* table is too big */
   /* check size of buffer */
   if (luaZ_sizebuffer(&g->buff) > LUA_MINBUFFER*2) {  /* buffer too big? */
@@ -485,6 +485,8 @@ void luaC_freeall (lua_State *L) {
   int i;
   g->currentwhite = WHITEBITS | bitmask(SFIXEDBIT);  /* mask to collect all elements */
   sweepwholelist(L, &g->rootgc);
+  for (i = 0; i < g->strt.oldsize; i++)  /* free lists not yet rehashed */
+    sweepwholelist(L, &g->strt.oldhash[i]);
   for (i = 0; i < g->strt.size; i++)  /* free all string lists */
     sweepwholelist(L, &g->strt.hash[i]);
 }
@@ -571,8 +573,14 @@ static l_mem singlestep (lua_State *L) {
     }
     case GCSsweepstring: {
       lu_mem old = g->totalbytes;
-      sweepwholelist(L, &g->strt.hash[g->sweepstrgc++]);
-      if (g->sweepstrgc >= g->strt.size)  /* nothing more to sweep? */
+      stringtable *tb = &g->strt;
+      if (g->sweepstrgc < tb->rehashpos)  /* moved buckets are empty */
+        g->sweepstrgc = tb->rehashpos;
+      if (g->sweepstrgc < tb->oldsize)  /* table being rehashed? */
+        sweepwholelist(L, &tb->oldhash[g->sweepstrgc++]);
+      else
+        sweepwholelist(L, &tb->hash[g->sweepstrgc++ - tb->oldsize]);
+      if (g->sweepstrgc >= tb->oldsize + tb->size)  /* nothing more to sweep? */
         g->gcstate = GCSsweep;  /* end sweep-string phase */
       lua_assert(old >= g->totalbytes);
       g->estimate -= old - g->totalbytes;
@@ -0,0 +1,280 @@
+/*
+** $Id: lpool.c $
+** Pooled allocator and frame-budgeted garbage collection
+** See Copyright Notice in lua.h
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <time.h>
+#endif
+
+
+/* This file uses only the official API of Lua.
+** Any function declared here could be written as an application function.
+*/
+
+#define lpool_c
+#define LUA_LIB
+
+#include "lua.h"
+
+#include "lpool.h"
+
+
+/*
+** {======================================================
+** Size-class pools
+** =======================================================
+*/
+
+/*
+** Small blocks are rounded up to a multiple of POOL_GRAIN and carved out
+** of POOL_ARENA-sized pages; freed blocks go to a free list per size
+** class. Lua always passes the exact old size of a block to the
+** allocator, so the size class is recovered from `osize' and blocks need
+** no header. Each state owns its pool, and a state is only ever run by
+** one thread at a time, so no locking is needed.
+*/
+
+#define POOL_GRAIN	8
+#define POOL_CLASSES	(LUAL_POOLMAX / POOL_GRAIN)
+#define POOL_ARENA	(64 * 1024)
+
+#define sizeclass(s)	(((s) + POOL_GRAIN - 1) / POOL_GRAIN - 1)
+#define classsize(c)	(((c) + 1) * POOL_GRAIN)
+
+
+typedef struct FreeBlock {
+  struct FreeBlock *next;
+} FreeBlock;
+
+
+typedef union Arena {
+  union Arena *next;  /* list of arenas owned by the pool */
+  LUAI_USER_ALIGNMENT_T dummy;
+} Arena;
+
+
+typedef struct Pool {
+  FreeBlock *freelist[POOL_CLASSES];
+  Arena *arenas;
+  char *top;  /* first free byte in the current arena */
+  char *limit;  /* end of the current arena */
+  int *closed;  /* set when the pool is released while creating a state */
+  luaL_PoolStats stats;
+} Pool;
+
+
+static void *page_alloc (size_t size) {
+#if defined(_WIN32)
+  return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON,
+                 -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+#endif
+}
+
+
+static void page_free (void *p, size_t size) {
+#if defined(_WIN32)
+  (void)size;
+  VirtualFree(p, 0, MEM_RELEASE);
+#else
+  munmap(p, size);
+#endif
+}
+
+
+static void *block_alloc (Pool *p, size_t size) {
+  if (size > LUAL_POOLMAX) {
+    p->stats.nlarge++;
+    return malloc(size);
+  }
+  else {
+    int c = sizeclass(size);
+    FreeBlock *b = p->freelist[c];
+    size_t csize = classsize(c);
+    p->stats.npooled++;
+    if (b != NULL) {
+      p->freelist[c] = b->next;
+      return b;
+    }
+    if ((size_t)(p->limit - p->top) < csize) {  /* current arena full? */
+      Arena *a = (Arena *)page_alloc(POOL_ARENA);
+      if (a == NULL) return NULL;
+      a->next = p->arenas;
+      p->arenas = a;
+      p->top = (char *)(a + 1);
+      p->limit = (char *)a + POOL_ARENA;
+      p->stats.arena += POOL_ARENA;
+    }
+    p->top += csize;
+    return p->top - csize;
+  }
+}
+
+
+static void block_free (Pool *p, void *ptr, size_t size) {
+  if (size > LUAL_POOLMAX)
+    free(ptr);
+  else {
+    int c = sizeclass(size);
+    FreeBlock *b = (FreeBlock *)ptr;
+    b->next = p->freelist[c];
+    p->freelist[c] = b;
+  }
+}
+
+
+static void pool_release (Pool *p) {
+  Arena *a = p->arenas;
+  while (a != NULL) {
+    Arena *next = a->next;
+    page_free(a, POOL_ARENA);
+    a = next;
+  }
+  if (p->closed) *p->closed = 1;
+  free(p);
+}
+
+
+static void *pool_alloc (void *ud, void *ptr, size_t osize, size_t nsize) {
+  Pool *p = (Pool *)ud;
+  void *nptr;
+  if (nsize == 0) {
+    if (ptr != NULL) {
+      block_free(p, ptr, osize);
+      p->stats.nfree++;
+      p->stats.inuse -= osize;
+      /* the state block is the last one freed by `lua_close' */
+      if (p->stats.inuse == 0) pool_release(p);
+    }
+    return NULL;
+  }
+  if (ptr == NULL) {
+    nptr = block_alloc(p, nsize);
+    if (nptr == NULL) return NULL;
+    p->stats.nalloc++;
+  }
+  else {
+    if (osize > LUAL_POOLMAX && nsize > LUAL_POOLMAX)
+      nptr = realloc(ptr, nsize);
+    else if (osize <= LUAL_POOLMAX && nsize <= LUAL_POOLMAX &&
+             sizeclass(osize) == sizeclass(nsize))
+      nptr = ptr;  /* still fits in its block */
+    else {
+      nptr = block_alloc(p, nsize);
+      if (nptr == NULL) return NULL;
+      memcpy(nptr, ptr, (osize < nsize) ? osize : nsize);
+      block_free(p, ptr, osize);
+    }
+    if (nptr == NULL) return NULL;
+    p->stats.nrealloc++;
+  }
+  p->stats.inuse += nsize - osize;
+  if (p->stats.inuse > p->stats.peak) p->stats.peak = p->stats.inuse;
+  return nptr;
+}
+
+
+static int panic (lua_State *L) {
+  (void)L;  /* to avoid warnings */
+  fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n",
+                   lua_tostring(L, -1));
+  return 0;
+}
+
+
+LUALIB_API lua_State *luaL_newpoolstate (void) {
+  lua_State *L;
+  int closed = 0;
+  Pool *p = (Pool *)calloc(1, sizeof(Pool));
+  if (p == NULL) return NULL;
+  p->closed = &closed;
+  L = lua_newstate(pool_alloc, p);
+  if (L == NULL) {
+    if (!closed) pool_release(p);  /* failed before any block was freed */
+    return NULL;
+  }
+  p->closed = NULL;
+  lua_atpanic(L, &panic);
+  return L;
+}
+
+
+LUALIB_API int luaL_poolstats (lua_State *L, luaL_PoolStats *s) {
+  void *ud;
+  if (lua_getallocf(L, &ud) != pool_alloc) return 0;
+  *s = ((Pool *)ud)->stats;
+  return 1;
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Frame-budgeted collection
+** =======================================================
+*/
+
+
+static double clock_usec (void) {
+#if defined(_WIN32)
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart * 1e6 / (double)f.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec * 1e6 + (double)t.tv_nsec * 1e-3;
+#else
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return (double)t.tv_sec * 1e6 + (double)t.tv_usec;
+#endif
+}
+
+
+/*
+** Runs single collector steps until `usec' microseconds have elapsed or
+** the current cycle finishes. At least one step is always run. Returns 1
+** if a cycle finished. Call it once per frame; raising the collector
+** pause (LUA_GCSETPAUSE) moves more of the collection work into the
+** budget and out of allocations.
+*/
+LUALIB_API int luaL_gcbudget (lua_State *L, int usec) {
+  void *ud;
+  Pool *p = (lua_getallocf(L, &ud) == pool_alloc) ? (Pool *)ud : NULL;
+  double start = clock_usec();
+  double elapsed;
+  int steps = 0;
+  int done;
+  do {
+    done = lua_gc(L, LUA_GCSTEP, 0);
+    steps++;
+    elapsed = clock_usec() - start;
+  } while (!done && elapsed < usec);
+  if (p != NULL) {
+    p->stats.gcsteps += steps;
+    p->stats.gccycles += done;
+    p->stats.gctime += elapsed;
+    p->stats.gclast = elapsed;
+  }
+  return done;
+}
+
+/* }====================================================== */
+
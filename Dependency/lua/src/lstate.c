@@ -108,6 +108,7 @@ static void close_state (lua_State *L) {
   luaC_freeall(L);  /* collect all objects */
   lua_assert(g->rootgc == obj2gco(L));
   lua_assert(g->strt.nuse == 0);
+  luaM_freearray(L, G(L)->strt.oldhash, G(L)->strt.oldsize, TString *);
   luaM_freearray(L, G(L)->strt.hash, G(L)->strt.size, TString *);
   luaZ_freebuffer(L, &g->buff);
   freestack(L, L);
@@ -163,6 +164,10 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->strt.size = 0;
   g->strt.nuse = 0;
   g->strt.hash = NULL;
+  g->strt.oldhash = NULL;
+  g->strt.oldsize = 0;
+  g->strt.rehashpos = 0;
+  g->strt.minsize = 0;
   setnilvalue(registry(L));
   luaZ_initbuffer(L, &g->buff);
   g->panic = NULL;
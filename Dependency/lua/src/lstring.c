@@ -19,34 +19,106 @@
 
 
 
+/* hint the processor to start loading the next node of a chain */
+#if defined(__GNUC__)
+#define prefetch(p)	__builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#define prefetch(p)	_mm_prefetch(cast(const char *, p), _MM_HINT_T0)
+#else
+#define prefetch(p)	((void)0)
+#endif
+
+
+static void movelist (GCObject *p, GCObject **newhash, int newsize) {
+  while (p) {  /* for each node in the list */
+    GCObject *next = p->gch.next;  /* save next */
+    unsigned int h = gco2ts(p)->hash;
+    int h1 = lmod(h, newsize);  /* new position */
+    lua_assert(cast_int(h%newsize) == lmod(h, newsize));
+    p->gch.next = newhash[h1];  /* chain it */
+    newhash[h1] = p;
+    p = next;
+  }
+}
+
+
+static void endrehash (lua_State *L, stringtable *tb) {
+  luaM_freearray(L, tb->oldhash, tb->oldsize, TString *);
+  tb->oldhash = NULL;
+  tb->oldsize = 0;
+  tb->rehashpos = 0;
+}
+
+
+/*
+** move a few buckets of the previous table into the current one, so that
+** growing a large string table does not stall the program
+*/
+static void rehashstep (lua_State *L, stringtable *tb) {
+  int n = LUAI_REHASHSTEP;
+  if (G(L)->gcstate == GCSsweepstring)
+    return;  /* cannot move strings during GC traverse */
+  while (n-- > 0 && tb->rehashpos < tb->oldsize) {
+    movelist(tb->oldhash[tb->rehashpos], tb->hash, tb->size);
+    tb->oldhash[tb->rehashpos++] = NULL;
+  }
+  if (tb->rehashpos >= tb->oldsize)
+    endrehash(L, tb);
+}
+
+
+static void grow (lua_State *L, stringtable *tb) {
+  GCObject **newhash;
+  int i, newsize = tb->size*2;
+  if (G(L)->gcstate == GCSsweepstring)
+    return;  /* cannot resize during GC traverse */
+  newhash = luaM_newvector(L, newsize, GCObject *);
+  for (i=0; i<newsize; i++) newhash[i] = NULL;
+  tb->oldhash = tb->hash;  /* moved by `rehashstep' */
+  tb->oldsize = tb->size;
+  tb->rehashpos = 0;
+  tb->hash = newhash;
+  tb->size = newsize;
+}
+
+
 void luaS_resize (lua_State *L, int newsize) {
   GCObject **newhash;
   stringtable *tb;
   int i;
   if (G(L)->gcstate == GCSsweepstring)
     return;  /* cannot resize during GC traverse */
-  newhash = luaM_newvector(L, newsize, GCObject *);
   tb = &G(L)->strt;
+  if (newsize < tb->minsize)
+    newsize = tb->minsize;
+  newhash = luaM_newvector(L, newsize, GCObject *);
   for (i=0; i<newsize; i++) newhash[i] = NULL;
   /* rehash */
-  for (i=0; i<tb->size; i++) {
-    GCObject *p = tb->hash[i];
-    while (p) {  /* for each node in the list */
-      GCObject *next = p->gch.next;  /* save next */
-      unsigned int h = gco2ts(p)->hash;
-      int h1 = lmod(h, newsize);  /* new position */
-      lua_assert(cast_int(h%newsize) == lmod(h, newsize));
-      p->gch.next = newhash[h1];  /* chain it */
-      newhash[h1] = p;
-      p = next;
-    }
-  }
+  for (i=tb->rehashpos; i<tb->oldsize; i++)  /* unfinished grow */
+    movelist(tb->oldhash[i], newhash, newsize);
+  if (tb->oldhash)
+    endrehash(L, tb);
+  for (i=0; i<tb->size; i++)
+    movelist(tb->hash[i], newhash, newsize);
   luaM_freearray(L, tb->hash, tb->size, TString *);
   tb->size = newsize;
   tb->hash = newhash;
 }
 
 
+int luaS_reserve (lua_State *L, int n) {
+  stringtable *tb = &G(L)->strt;
+  int size = MINSTRTABSIZE;
+  while (size < n && size <= MAX_INT/2)
+    size *= 2;
+  tb->minsize = (n > 0) ? size : 0;
+  if (size > tb->size)
+    luaS_resize(L, size);
+  return tb->size;
+}
+
+
 static TString *newlstr (lua_State *L, const char *str, size_t l,
                                        unsigned int h) {
   TString *ts;
@@ -66,28 +138,69 @@ static TString *newlstr (lua_State *L, const char *str, size_t l,
   ts->tsv.next = tb->hash[h];  /* chain new entry */
   tb->hash[h] = obj2gco(ts);
   tb->nuse++;
-  if (tb->nuse > cast(lu_int32, tb->size) && tb->size <= MAX_INT/2)
-    luaS_resize(L, tb->size*2);  /* too crowded */
+  if (tb->oldhash)
+    rehashstep(L, tb);
+  else if (tb->nuse > cast(lu_int32, tb->size) && tb->size <= MAX_INT/2)
+    grow(L, tb);  /* too crowded */
   return ts;
 }
 
 
-TString *luaS_newlstr (lua_State *L, const char *str, size_t l) {
-  GCObject *o;
+/*
+** strings up to LUAI_HASHLIMIT chars are hashed in full, four at a time;
+** longer ones hash at most about 32 chars, as in stock Lua 5.1
+*/
+static unsigned int hashstr (const char *str, size_t l) {
   unsigned int h = cast(unsigned int, l);  /* seed */
-  size_t step = (l>>5)+1;  /* if string is too long, don't hash all its chars */
   size_t l1;
-  for (l1=l; l1>=step; l1-=step)  /* compute hash */
-    h = h ^ ((h<<5)+(h>>2)+cast(unsigned char, str[l1-1]));
-  for (o = G(L)->strt.hash[lmod(h, G(L)->strt.size)];
-       o != NULL;
-       o = o->gch.next) {
+  if (l <= LUAI_HASHLIMIT) {
+    for (l1=0; l1+4<=l; l1+=4) {
+      lu_int32 w;
+      memcpy(&w, str+l1, sizeof(w));
+      h = (h ^ w) * 0x9e3779b1u;
+      h ^= h >> 15;
+    }
+    for (; l1<l; l1++)
+      h = h ^ ((h<<5)+(h>>2)+cast(unsigned char, str[l1]));
+    h ^= h >> 13;  /* buckets are picked by the low bits */
+    h *= 0x85ebca6bu;
+    h ^= h >> 16;
+  }
+  else {
+    size_t step = (l>>5)+1;  /* if string is too long, don't hash all its chars */
+    for (l1=l; l1>=step; l1-=step)  /* compute hash */
+      h = h ^ ((h<<5)+(h>>2)+cast(unsigned char, str[l1-1]));
+  }
+  return h;
+}
+
+
+static TString *findstr (GCObject *o, const char *str, size_t l,
+                                      unsigned int h) {
+  for (; o != NULL; o = o->gch.next) {
     TString *ts = rawgco2ts(o);
-    if (ts->tsv.len == l && (memcmp(str, getstr(ts), l) == 0)) {
-      /* string may be dead */
-      if (isdead(G(L), o)) changewhite(o);
+    prefetch(o->gch.next);
+    if (ts->tsv.hash == h && ts->tsv.len == l &&
+        memcmp(str, getstr(ts), l) == 0)
       return ts;
-    }
+  }
+  return NULL;
+}
+
+
+TString *luaS_newlstr (lua_State *L, const char *str, size_t l) {
+  stringtable *tb = &G(L)->strt;
+  unsigned int h = hashstr(str, l);
+  TString *ts = findstr(tb->hash[lmod(h, tb->size)], str, l, h);
+  if (ts == NULL && tb->oldhash) {
+    int i = lmod(h, tb->oldsize);
+    if (i >= tb->rehashpos)  /* bucket not moved yet? */
+      ts = findstr(tb->oldhash[i], str, l, h);
+  }
+  if (ts != NULL) {
+    /* string may be dead */
+    if (isdead(G(L), obj2gco(ts))) changewhite(obj2gco(ts));
+    return ts;
   }
   return newlstr(L, str, l, h);  /* not found */
 }
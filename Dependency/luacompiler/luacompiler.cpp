@@ -1,29 +1,31 @@
 // luacompiler.cpp : Defines the entry point for the console application.
 //
+// Compiles every .lua file below a source directory to a .luao file below an
+// output directory, mirroring the tree. Files are compiled on a pool of worker
+// threads, each with its own lua_State. A manifest in the output directory keeps
+// the content hash of every script, so files that did not change since the last
+// build are skipped. With -b all chunks are also packed into one bundle (see lbundle.h).
 
 #include "stdafx.h"
 #include "utility.h"
 
-#define PROGNAME	"luac"		/* default program name */
-#define	OUTPUT		PROGNAME ".out"	/* default output file */
+#define PROGNAME	"luacompiler"		/* default program name */
+#define MANIFEST	"luacompiler.manifest"	/* manifest file, in the output directory */
+#define MAX_WORKERS	64
 
-static int listing=0;			/* list bytecodes? */
-static int dumping=1;			/* dump bytecodes? */
 static int stripping=0;			/* strip debug information? */
-static char Output[]={ OUTPUT };	/* default output file name */
-static const char* output=Output;	/* actual output file name */
+static int forcing=0;			/* ignore the manifest? */
+static int quiet=0;			/* list compiled files? */
+static int workers=0;			/* number of worker threads, 0 = one per processor */
+static const char* srcdir=NULL;		/* script tree */
+static const char* outdir=NULL;		/* output tree */
+static const char* bundle=NULL;		/* bundle file name, if any */
 static const char* progname=PROGNAME;	/* actual program name */
 
 static void fatal(const char* message)
 {
 	fprintf(stderr,"%s: %s\n",progname,message);
-	//exit(EXIT_FAILURE);
-}
-
-static void cannot(const char* what)
-{
-	fprintf(stderr,"%s: cannot %s %s: %s\n",progname,what,output,strerror(errno));
-	//exit(EXIT_FAILURE);
+	exit(EXIT_FAILURE);
 }
 
 static void usage(const char* message)
@@ -33,17 +35,17 @@ static void usage(const char* message)
 	else
 		fprintf(stderr,"%s: %s\n",progname,message);
 	fprintf(stderr,
-		"usage: %s [options] [filenames].\n"
+		"usage: %s [options] srcdir outdir.\n"
 		"Available options are:\n"
-		"  -        process stdin\n"
-		"  -l       list\n"
-		"  -o name  output to file " LUA_QL("name") " (default is \"%s\")\n"
-		"  -p       parse only\n"
+		"  -b name  also pack all chunks into bundle " LUA_QL("name") "\n"
+		"  -f       rebuild all files, ignoring the manifest\n"
+		"  -j n     use n worker threads (default is one per processor)\n"
+		"  -q       do not list compiled files\n"
 		"  -s       strip debug information\n"
 		"  -v       show version information\n"
 		"  --       stop handling options\n",
-		progname,Output);
-	//exit(EXIT_FAILURE);
+		progname);
+	exit(EXIT_FAILURE);
 }
 
 #define	IS(s)	(strcmp(argv[i],s)==0)
@@ -60,21 +62,22 @@ static int doargs(int argc, char* argv[])
 		else if (IS("--"))			/* end of options; skip it */
 		{
 			++i;
-			if (version) ++version;
 			break;
 		}
-		else if (IS("-"))			/* end of options; use stdin */
-			break;
-		else if (IS("-l"))			/* list */
-			++listing;
-		else if (IS("-o"))			/* output file */
+		else if (IS("-b"))			/* bundle file */
+		{
+			bundle=argv[++i];
+			if (bundle==NULL || *bundle==0) usage(LUA_QL("-b") " needs argument");
+		}
+		else if (IS("-f"))			/* force rebuild */
+			forcing=1;
+		else if (IS("-j"))			/* worker threads */
 		{
-			output=argv[++i];
-			if (output==NULL || *output==0) usage(LUA_QL("-o") " needs argument");
-			if (IS("-")) output=NULL;
+			if (argv[++i]==NULL) usage(LUA_QL("-j") " needs argument");
+			workers=atoi(argv[i]);
 		}
-		else if (IS("-p"))			/* parse only */
-			dumping=0;
+		else if (IS("-q"))			/* quiet */
+			quiet=1;
 		else if (IS("-s"))			/* strip debug information */
 			stripping=1;
 		else if (IS("-v"))			/* show version */
@@ -82,160 +85,312 @@ static int doargs(int argc, char* argv[])
 		else					/* unknown option */
 			usage(argv[i]);
 	}
-	if (i==argc && (listing || !dumping))
-	{
-		dumping=0;
-		argv[--i]=Output;
-	}
 	if (version)
 	{
 		printf("%s  %s\n",LUA_RELEASE,LUA_COPYRIGHT);
-		if (version==argc-1) exit(EXIT_SUCCESS);
+		if (i==argc) exit(EXIT_SUCCESS);
 	}
+	if (argc-i!=2) usage("source and output directories expected");
+	srcdir=argv[i];
+	outdir=argv[i+1];
 	return i;
 }
 
 #define toproto(L,i) (clvalue(L->top+(i))->l.p)
 
-static const Proto* combine(lua_State* L, int n)
+static int writer(lua_State* L, const void* p, size_t size, void* u)
 {
-	if (n==1)
-		return toproto(L,-1);
-	else
+	UNUSED(L);
+	((std::string*)u)->append((const char*)p,size);
+	return 0;
+}
+
+/* 64-bit FNV-1a */
+static unsigned long long hashData(const std::string& data)
+{
+	unsigned long long h=14695981039346656037ULL;
+	for (size_t i=0; i<data.size(); i++)
 	{
-		int i,pc;
-		Proto* f=luaF_newproto(L);
-		setptvalue2s(L,L->top,f); incr_top(L);
-		f->source=luaS_newliteral(L,"=(" PROGNAME ")");
-		f->maxstacksize=1;
-		pc=2*n+1;
-		f->code=luaM_newvector(L,pc,Instruction);
-		f->sizecode=pc;
-		f->p=luaM_newvector(L,n,Proto*);
-		f->sizep=n;
-		pc=0;
-		for (i=0; i<n; i++)
-		{
-			f->p[i]=toproto(L,i-n-1);
-			f->code[pc++]=CREATE_ABx(OP_CLOSURE,0,i);
-			f->code[pc++]=CREATE_ABC(OP_CALL,0,1,1);
-		}
-		f->code[pc++]=CREATE_ABC(OP_RETURN,0,1,0);
-		return f;
+		h^=(unsigned char)data[i];
+		h*=1099511628211ULL;
 	}
+	return h;
 }
 
-static int writer(lua_State* L, const void* p, size_t size, void* u)
+struct ManifestEntry
 {
-	UNUSED(L);
-	return (fwrite(p,size,1,(FILE*)u)!=1) && (size!=0);
-}
+	unsigned long long hash;	/* hash of the script */
+	int stripped;			/* compiled with -s? */
+};
+
+typedef std::map<std::string, ManifestEntry> Manifest;
 
-struct Smain {
-	int argc;
-	char** argv;
+struct Script
+{
+	std::string path;		/* path relative to srcdir */
+	std::string module;		/* module name, e.g. "ui.button" for ui\button.lua */
+	std::string chunk;		/* bytecode, kept only when building a bundle */
+	std::string error;		/* error message, if the script failed to build */
+	unsigned long long hash;	/* hash of the script */
+	bool compiled;			/* compiled by this build, false if it was up to date */
+	bool failed;
 };
 
-static int pmain(lua_State* L)
+struct Build
 {
-	struct Smain* s = (struct Smain*)lua_touserdata(L, 1);
-	int argc=s->argc;
-	char** argv=s->argv;
-	const Proto* f;
-	int i;
-	if (!lua_checkstack(L,argc)) fatal("too many input files");
-	for (i=0; i<argc; i++)
+	std::vector<Script> scripts;
+	Manifest manifest;		/* manifest of the previous build */
+	volatile LONG next;		/* next script to build */
+};
+
+static std::string outputPath(const Script& s)
+{
+	std::string path=std::string(outdir)+"\\"+s.path;
+	return path.substr(0,path.size()-4)+".luao";	/* .lua -> .luao */
+}
+
+static void buildScript(lua_State* L, Build* b, Script& s)
+{
+	std::string source;
+	std::string inpath=std::string(srcdir)+"\\"+s.path;
+	std::string outpath=outputPath(s);
+	if (!readFile(inpath.c_str(),source))
 	{
-		const char* filename=IS("-") ? NULL : argv[i];
-		if (luaL_loadfile(L,filename)!=0) fatal(lua_tostring(L,-1));
+		s.failed=true;
+		s.error="cannot read "+inpath;
+		return;
 	}
-	f=combine(L,argc);
-	if (listing) luaU_print(f,listing>1);
-	if (dumping)
+	s.hash=hashData(source);
+
+	/* up to date? */
+	Manifest::const_iterator m=b->manifest.find(s.path);
+	if (!forcing && m!=b->manifest.end() && m->second.hash==s.hash && m->second.stripped==stripping
+		&& _access(outpath.c_str(),0)==0)
 	{
-		FILE* D= (output==NULL) ? stdout : fopen(output,"wb");
-		if (D==NULL) cannot("open");
-		lua_lock(L);
-		luaU_dump(L,f,writer,D,stripping);
-		lua_unlock(L);
-		if (ferror(D)) cannot("write");
-		if (fclose(D)) cannot("close");
+		if (bundle!=NULL && !readFile(outpath.c_str(),s.chunk))
+		{
+			s.failed=true;
+			s.error="cannot read "+outpath;
+		}
+		return;
 	}
-	return 0;
-}
 
-const char* basedir = "E:\\work\\myeditor\\Dependency\\luatest";
+	std::string chunkname="@"+s.path;
+	if (luaL_loadbuffer(L,source.data(),source.size(),chunkname.c_str())!=0)
+	{
+		s.failed=true;
+		s.error=lua_tostring(L,-1);
+		lua_settop(L,0);
+		return;
+	}
+	std::string chunk;
+	lua_lock(L);
+	luaU_dump(L,toproto(L,-1),writer,&chunk,stripping);
+	lua_unlock(L);
+	lua_settop(L,0);
 
-void funcLuaCompile(const char* filename, void* args )
-{
-	char ext[5];
-	getFileExtensionA(filename, ext, 5);
-	if (stricmp(ext, "lua") != 0)
+	makeParentDirectories(outpath.c_str());
+	if (!writeFile(outpath.c_str(),chunk.data(),chunk.size()))
+	{
+		s.failed=true;
+		s.error="cannot write "+outpath;
 		return;
+	}
+	if (bundle!=NULL) s.chunk.swap(chunk);
+	s.compiled=true;
+	if (!quiet) printf("%s\n",inpath.c_str());
+}
 
-	int argc = 4;
-	char* argvs[4];
-	argvs[0] = (char*)args;
-	argvs[1] = "-o";
+static DWORD WINAPI worker(LPVOID args)
+{
+	Build* b=(Build*)args;
+	lua_State* L=luaL_newpoolstate();
+	for (;;)
+	{
+		LONG i=InterlockedIncrement(&b->next)-1;
+		if (i>=(LONG)b->scripts.size()) break;
+		Script& s=b->scripts[i];
+		if (L==NULL)
+		{
+			s.failed=true;
+			s.error="not enough memory for state";
+			continue;
+		}
+		buildScript(L,b,s);
+	}
+	if (L!=NULL) lua_close(L);
+	return 0;
+}
 
-	char outfilename[256];
-	strcpy_s(outfilename, 256, basedir);
-	strcat_s(outfilename, 256, "\\");
+static void collectScript(const char* path, void* args)
+{
+	Build* b=(Build*)args;
+	Script s;
+	s.path=path+strlen(srcdir);
+	while (!s.path.empty() && (s.path[0]=='\\' || s.path[0]=='/')) s.path.erase(0,1);
+	s.module=s.path.substr(0,s.path.size()-4);
+	for (size_t i=0; i<s.module.size(); i++)
+		if (s.module[i]=='\\' || s.module[i]=='/') s.module[i]='.';
+	s.hash=0;
+	s.compiled=false;
+	s.failed=false;
+	b->scripts.push_back(s);
+}
 
-	char outname[64];
-	getFileNameNoExtensionA(filename, outname, 64);
-	strcat_s(outfilename, outname);
-	strcat_s(outfilename, ".luao");
+static bool pathLess(const Script& a, const Script& b)
+{
+	return a.path<b.path;
+}
+
+static void loadManifest(Build* b)
+{
+	std::string path=std::string(outdir)+"\\" MANIFEST;
+	FILE* f=fopen(path.c_str(),"r");
+	if (f==NULL) return;
+	char line[MAX_PATH+64];
+	while (fgets(line,sizeof(line),f)!=NULL)
+	{
+		ManifestEntry e;
+		int n=0;
+		if (sscanf(line,"%llx %d %n",&e.hash,&e.stripped,&n)<2) continue;
+		char* name=line+n;
+		name[strcspn(name,"\r\n")]=0;
+		b->manifest[name]=e;
+	}
+	fclose(f);
+}
 
-	argvs[2] = outfilename;
+static void saveManifest(Build* b)
+{
+	std::string path=std::string(outdir)+"\\" MANIFEST;
+	makeParentDirectories(path.c_str());
+	FILE* f=fopen(path.c_str(),"w");
+	if (f==NULL) fatal(("cannot write "+path).c_str());
+	for (size_t i=0; i<b->scripts.size(); i++)
+	{
+		const Script& s=b->scripts[i];
+		if (!s.failed) fprintf(f,"%016llx %d %s\n",s.hash,stripping,s.path.c_str());
+	}
+	if (fclose(f)!=0) fatal(("cannot write "+path).c_str());
+}
 
-	char infilename[256];
-	strcpy_s(infilename, 256, basedir);
-	strcat_s(infilename, 256, "\\");
-	strcat_s(infilename, 256, filename);
+static bool moduleLess(const Script* a, const Script* b)
+{
+	return strcmp(a->module.c_str(),b->module.c_str())<0;
+}
 
-	argvs[3] = infilename;
+static void writeBundle(Build* b)
+{
+	std::vector<const Script*> sorted;
+	for (size_t i=0; i<b->scripts.size(); i++)
+		if (!b->scripts[i].failed) sorted.push_back(&b->scripts[i]);
+	std::sort(sorted.begin(),sorted.end(),moduleLess);
 
-	char** argv = argvs;
+	std::string names;
+	std::vector<luaL_BundleEntry> index;
+	std::vector<const Script*> bundled;
+	size_t data=0;
+	for (size_t i=0; i<sorted.size(); i++)
+	{
+		const Script* s=sorted[i];
+		if (i>0 && s->module==sorted[i-1]->module)
+		{
+			fprintf(stderr,"%s: module %s is defined twice, %s is not bundled\n",progname,s->module.c_str(),s->path.c_str());
+			continue;
+		}
+		luaL_BundleEntry e;
+		e.name=(LUAI_UINT32)names.size();
+		e.offset=(LUAI_UINT32)data;
+		e.size=(LUAI_UINT32)s->chunk.size();
+		e.hash=(LUAI_UINT32)(s->hash^(s->hash>>32));
+		index.push_back(e);
+		bundled.push_back(s);
+		names.append(s->module.c_str(),s->module.size()+1);
+		data+=s->chunk.size();
+	}
 
-	//do compile;
-	lua_State* L;
-	struct Smain s;
-	int i=doargs(argc,argv);
-	argc-=i; argv+=i;
-	if (argc<=0) usage("no input files given");
+	/* offsets so far are relative to their section */
+	luaL_BundleHeader h;
+	memcpy(h.signature,LUA_BUNDLESIGNATURE,sizeof(h.signature));
+	h.version=LUA_BUNDLEVERSION;
+	h.count=(LUAI_UINT32)index.size();
+	size_t namebase=sizeof(h)+index.size()*sizeof(luaL_BundleEntry);
+	size_t database=namebase+names.size();
+	h.size=(LUAI_UINT32)(database+data);
+	for (size_t i=0; i<index.size(); i++)
+	{
+		index[i].name+=(LUAI_UINT32)namebase;
+		index[i].offset+=(LUAI_UINT32)database;
+	}
 
-	L=lua_open();
-	if (L==NULL) fatal("not enough memory for state");
-	s.argc=argc;
-	s.argv=argv;
-	if (lua_cpcall(L,pmain,&s)!=0) fatal(lua_tostring(L,-1));
-	lua_close(L);
+	std::string out;
+	out.reserve(h.size);
+	out.append((const char*)&h,sizeof(h));
+	if (!index.empty()) out.append((const char*)&index[0],index.size()*sizeof(luaL_BundleEntry));
+	out.append(names);
+	for (size_t i=0; i<bundled.size(); i++)
+		out.append(bundled[i]->chunk);
 
-	printf(infilename);
-	printf("\n");
+	makeParentDirectories(bundle);
+	if (!writeFile(bundle,out.data(),out.size())) fatal((std::string("cannot write ")+bundle).c_str());
 }
 
 int main(int argc, char* argv[])
 {
+	doargs(argc,argv);
+
+	LARGE_INTEGER freq, start, end;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&start);
+
+	Build b;
+	b.next=0;
+	iterateFiles(srcdir,"lua",collectScript,&b);
+	std::sort(b.scripts.begin(),b.scripts.end(),pathLess);
+	if (!forcing) loadManifest(&b);
 
-	iterateFiles(basedir, "*.lua", funcLuaCompile, argv);
+	int n=workers;
+	if (n<=0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		n=(int)info.dwNumberOfProcessors;
+	}
+	if (n>(int)b.scripts.size()) n=(int)b.scripts.size();
+	if (n>MAX_WORKERS) n=MAX_WORKERS;
+	if (n<1) n=1;
+
+	HANDLE threads[MAX_WORKERS];
+	for (int i=0; i<n; i++)
+	{
+		threads[i]=CreateThread(NULL,0,worker,&b,0,NULL);
+		if (threads[i]==NULL) fatal("cannot create worker thread");
+	}
+	WaitForMultipleObjects(n,threads,TRUE,INFINITE);
+	for (int i=0; i<n; i++) CloseHandle(threads[i]);
+
+	int compiled=0, failed=0;
+	for (size_t i=0; i<b.scripts.size(); i++)
+	{
+		const Script& s=b.scripts[i];
+		if (s.failed)
+		{
+			fprintf(stderr,"%s: %s\n",progname,s.error.c_str());
+			failed++;
+		}
+		else if (s.compiled)
+			compiled++;
+	}
 
-	/*
-	lua_State* L;
-	struct Smain s;
-	int i=doargs(argc,argv);
-	argc-=i; argv+=i;
-	if (argc<=0) usage("no input files given");
-	L=lua_open();
-	if (L==NULL) fatal("not enough memory for state");
-	s.argc=argc;
-	s.argv=argv;
-	if (lua_cpcall(L,pmain,&s)!=0) fatal(lua_tostring(L,-1));
-	lua_close(L);
-	*/
+	/* the bundle is rewritten when anything changed, including removed scripts */
+	saveManifest(&b);
+	if (bundle!=NULL && (compiled>0 || forcing || b.manifest.size()!=b.scripts.size()-failed || _access(bundle,0)!=0))
+		writeBundle(&b);
 
-	getchar();
+	QueryPerformanceCounter(&end);
+	printf("%s: %d compiled, %d up to date, %d failed, %d threads, %.0f ms\n",progname,
+		compiled,(int)b.scripts.size()-compiled-failed,failed,n,
+		(double)(end.QuadPart-start.QuadPart)*1000.0/(double)freq.QuadPart);
 
-	return EXIT_SUCCESS;
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
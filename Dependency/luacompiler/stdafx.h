@@ -13,6 +13,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <io.h>
+#include <direct.h>
+#include <windows.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
 
 #define luac_c
 #define LUA_CORE
@@ -22,6 +29,8 @@ extern "C"
 
 #include "lua.h"
 #include "lauxlib.h"
+#include "lpool.h"
+#include "lbundle.h"
 
 #include "ldo.h"
 #include "lfunc.h"
@@ -3,16 +3,21 @@
 
 #define MAX_PATH 260
 
-bool iterateFiles( const char* dirname, const char* ext, ITERATEFILECALLBACK callback, void* args )
+static void appendSeparator(char* path, size_t size)
 {
-	char path[MAX_PATH];
-	strcpy_s(path, MAX_PATH, dirname);
 	char last = path[strlen(path) -1];
 	if (last != '/' && last != '\\' )
 	{
-		strcat_s(path, MAX_PATH, "\\");
+		strcat_s(path, size, "\\");
 	}
-	strcat_s(path, MAX_PATH, ext);
+}
+
+bool iterateFiles( const char* dirname, const char* ext, ITERATEFILECALLBACK callback, void* args )
+{
+	char path[MAX_PATH];
+	strcpy_s(path, MAX_PATH, dirname);
+	appendSeparator(path, MAX_PATH);
+	strcat_s(path, MAX_PATH, "*");
 
 	_finddata_t finddata;
 	intptr_t hfile = _findfirst(path, &finddata);
@@ -27,32 +32,26 @@ bool iterateFiles( const char* dirname, const char* ext, ITERATEFILECALLBACK cal
 		if (finddata.attrib & (_A_HIDDEN | _A_SYSTEM))
 			continue;
 
+		char subpath[MAX_PATH];
+		strcpy_s(subpath, MAX_PATH, dirname);
+		appendSeparator(subpath, MAX_PATH);
+		strcat_s(subpath, MAX_PATH, finddata.name);
+
 		if (finddata.attrib & _A_SUBDIR)
 		{
-			char subpath[MAX_PATH];
-			strcpy_s(subpath, dirname);
-			last = subpath[strlen(subpath) -1];
-			if (last != '/' && last != '\\' )
-			{
-				strcat_s(subpath, MAX_PATH, "\\");
-			}
-			strcat_s(subpath, finddata.name);
 			iterateFiles(subpath, ext, callback, args);
 		}
 		else
 		{
-			callback(finddata.name, args);
+			char fileext[16];
+			getFileExtensionA(finddata.name, fileext, 16);
+			if (_stricmp(fileext, ext) == 0)
+				callback(subpath, args);
 		}
 	} while (_findnext(hfile, &finddata) != -1);
 
-	if (errno != ENOENT)
-	{
-		_findclose(hfile);
-		return false;
-	}
-
 	_findclose(hfile);
-	return false;
+	return true;
 }
 
 void getFileNameNoExtensionA( const char* filename, char* outfilename, size_t size )
@@ -84,3 +83,46 @@ void getFileExtensionA( const char* filename, char* outfilename, size_t size )
 		strcpy_s( outfilename, size, p+1 );
 }
 
+bool readFile( const char* path, std::string& data )
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL)
+		return false;
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	data.resize(size);
+	bool ok = size == 0 || fread(&data[0], size, 1, f) == 1;
+	fclose(f);
+	return ok;
+}
+
+bool writeFile( const char* path, const void* data, size_t size )
+{
+	FILE* f = fopen(path, "wb");
+	if (f == NULL)
+		return false;
+
+	bool ok = size == 0 || fwrite(data, size, 1, f) == 1;
+	if (fclose(f) != 0)
+		ok = false;
+	return ok;
+}
+
+void makeParentDirectories( const char* path )
+{
+	char dir[MAX_PATH];
+	strcpy_s(dir, MAX_PATH, path);
+	for (char* p = dir; *p; ++p)
+	{
+		if ((*p == '/' || *p == '\\') && p != dir && *(p-1) != ':')
+		{
+			char c = *p;
+			*p = '\0';
+			_mkdir(dir);		// fails harmlessly if it already exists
+			*p = c;
+		}
+	}
+}
@@ -1,9 +1,17 @@
 #pragma once
 
-typedef void (*ITERATEFILECALLBACK)(const char* filename, void* args);
+typedef void (*ITERATEFILECALLBACK)(const char* path, void* args);
 
+// calls callback with the path of every file below dirname whose extension is ext
 bool iterateFiles(const char* dirname, const char* ext, ITERATEFILECALLBACK callback, void* args);
 
 void getFileNameNoExtensionA(const char* filename, char* outfilename, size_t size );
 
 void getFileExtensionA(const char* filename, char* outfilename, size_t size );
+
+bool readFile(const char* path, std::string& data);
+
+bool writeFile(const char* path, const void* data, size_t size);
+
+// creates the missing directories of a file path
+void makeParentDirectories(const char* path);
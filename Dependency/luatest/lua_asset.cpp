@@ -0,0 +1,695 @@
+// lua_asset.cpp
+//
+// Asynchronous asset reads for lua coroutines.
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <algorithm>
+#include <map>
+
+extern "C"
+{
+	#include "lua.h"
+	#include "lualib.h"
+	#include "lauxlib.h"
+};
+
+#include "lua_tinker.h"
+#include "lua_asset.h"
+#include "lua_thread.h"
+
+#define ASSET_SLICE		"ASSETSLICE*"
+#define ASSET_SYSTEM	"ASSETSYSTEM*"
+
+static char asset_key;
+
+/*---------------------------------------------------------------------------*/
+/* Slices                                                                    */
+/*---------------------------------------------------------------------------*/
+namespace
+{
+	// file data, shared by the slices made from it. refs is only touched on the lua thread
+	struct asset_buffer
+	{
+		std::vector<char>	data;
+		int					refs;
+	};
+
+	struct asset_slice
+	{
+		asset_buffer*	buffer;
+		size_t			offset;
+		size_t			size;
+	};
+}
+
+static void push_slice(lua_State *L, asset_buffer* buffer, size_t offset, size_t size)
+{
+	asset_slice* s = (asset_slice*)lua_newuserdata(L, sizeof(asset_slice));
+	s->buffer = buffer;
+	s->offset = offset;
+	s->size = size;
+	++buffer->refs;
+	luaL_getmetatable(L, ASSET_SLICE);
+	lua_setmetatable(L, -2);
+}
+
+static asset_slice* check_slice(lua_State *L, int index)
+{
+	return (asset_slice*)luaL_checkudata(L, index, ASSET_SLICE);
+}
+
+static const unsigned char* slice_data(asset_slice* s)
+{
+	std::vector<char>& data = s->buffer->data;
+	return data.empty() ? NULL : (const unsigned char*)&data[0] + s->offset;
+}
+
+// string.sub rules for [i, j] : 1-based, negative from the end, clamped to the slice
+static bool slice_range(asset_slice* s, ptrdiff_t i, ptrdiff_t j, size_t* start, size_t* end)
+{
+	ptrdiff_t len = (ptrdiff_t)s->size;
+	if(i < 0) i += len + 1;
+	if(j < 0) j += len + 1;
+	if(i < 1) i = 1;
+	if(j > len) j = len;
+	if(i > j)
+		return false;
+	*start = (size_t)i - 1;
+	*end = (size_t)j;
+	return true;
+}
+
+// start of a width byte value at 1-based offset arg
+static const unsigned char* slice_at(lua_State *L, asset_slice* s, int arg, size_t width)
+{
+	lua_Integer i = luaL_checkinteger(L, arg);
+	luaL_argcheck(L, i >= 1 && (size_t)i - 1 + width <= s->size, arg, "out of range");
+	return slice_data(s) + (i - 1);
+}
+
+static unsigned int read_u32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static int slice_len(lua_State *L)
+{
+	lua_pushinteger(L, (lua_Integer)check_slice(L, 1)->size);
+	return 1;
+}
+
+static int slice_tostring(lua_State *L)
+{
+	asset_slice* s = check_slice(L, 1);
+	lua_pushfstring(L, "asset slice: %p (%d bytes)", (void*)s, (int)s->size);
+	return 1;
+}
+
+static int slice_gc(lua_State *L)
+{
+	asset_slice* s = check_slice(L, 1);
+	if(s->buffer && --s->buffer->refs == 0)
+		delete s->buffer;
+	s->buffer = NULL;
+	return 0;
+}
+
+static int slice_byte(lua_State *L)
+{
+	asset_slice* s = check_slice(L, 1);
+	ptrdiff_t i = luaL_optinteger(L, 2, 1);
+	size_t start, end;
+	if(!slice_range(s, i, luaL_optinteger(L, 3, i), &start, &end))
+		return 0;
+	luaL_checkstack(L, (int)(end - start), "slice too long");
+	const unsigned char* p = slice_data(s);
+	for(size_t k=start; k<end; ++k)
+		lua_pushinteger(L, p[k]);
+	return (int)(end - start);
+}
+
+static int slice_sub(lua_State *L)
+{
+	asset_slice* s = check_slice(L, 1);
+	size_t start = 0, end = 0;
+	slice_range(s, luaL_optinteger(L, 2, 1), luaL_optinteger(L, 3, -1), &start, &end);
+	push_slice(L, s->buffer, s->offset + start, end - start);
+	return 1;
+}
+
+static int slice_string(lua_State *L)
+{
+	asset_slice* s = check_slice(L, 1);
+	size_t start = 0, end = 0;
+	if(slice_range(s, luaL_optinteger(L, 2, 1), luaL_optinteger(L, 3, -1), &start, &end))
+		lua_pushlstring(L, (const char*)slice_data(s) + start, end - start);
+	else
+		lua_pushliteral(L, "");
+	return 1;
+}
+
+static int slice_u8(lua_State *L)
+{
+	lua_pushinteger(L, *slice_at(L, check_slice(L, 1), 2, 1));
+	return 1;
+}
+
+static int slice_u16(lua_State *L)
+{
+	const unsigned char* p = slice_at(L, check_slice(L, 1), 2, 2);
+	lua_pushinteger(L, p[0] | (p[1] << 8));
+	return 1;
+}
+
+static int slice_u32(lua_State *L)
+{
+	lua_pushnumber(L, read_u32(slice_at(L, check_slice(L, 1), 2, 4)));
+	return 1;
+}
+
+static int slice_i32(lua_State *L)
+{
+	lua_pushnumber(L, (int)read_u32(slice_at(L, check_slice(L, 1), 2, 4)));
+	return 1;
+}
+
+static int slice_f32(lua_State *L)
+{
+	unsigned int u = read_u32(slice_at(L, check_slice(L, 1), 2, 4));
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	lua_pushnumber(L, f);
+	return 1;
+}
+
+static const luaL_Reg slice_methods[] =
+{
+	{ "byte", slice_byte },
+	{ "sub", slice_sub },
+	{ "string", slice_string },
+	{ "u8", slice_u8 },
+	{ "u16", slice_u16 },
+	{ "u32", slice_u32 },
+	{ "i32", slice_i32 },
+	{ "f32", slice_f32 },
+	{ NULL, NULL }
+};
+
+/*---------------------------------------------------------------------------*/
+/* I/O Pool                                                                  */
+/*---------------------------------------------------------------------------*/
+namespace
+{
+	struct asset_group;
+
+	struct asset_request
+	{
+		std::string		name;
+		asset_group*	group;
+		asset_buffer*	buffer;		// set by the I/O thread on success
+		std::string		error;
+		bool			done;		// guarded by the system lock
+	};
+
+	// the reads of one asset.read or asset.read_many call
+	struct asset_group
+	{
+		lua_State*		co;			// coroutine to resume, NULL if the main thread waits
+		int				ref;		// keeps co alive
+		bool			many;
+		int				remaining;	// requests not delivered yet
+		std::vector<asset_request*> requests;
+	};
+
+	struct asset_system;
+
+	struct asset_io
+	{
+		asset_system*				system;
+		lua_tinker::asset_reader*	reader;
+		lua_tinker::thread_handle	thread;
+		bool						started;
+	};
+
+	struct asset_system
+	{
+		std::vector<asset_io*>		threads;
+		std::vector<asset_group*>	groups;		// live groups, lua thread only
+		std::map<lua_State*, asset_group*>	waiting;	// coroutine -> group it yielded for, lua thread only
+		int							pending;	// requests not delivered, lua thread only
+
+		lua_tinker::thread_lock		lock;		// guards the fields below
+		lua_tinker::thread_cond		work;		// requests were queued, or stopping
+		lua_tinker::thread_cond		done;		// a request is done
+		std::deque<asset_request*>	queue;
+		std::vector<asset_request*>	finished;
+		bool						stopping;
+	};
+}
+
+static void asset_io_proc(void* param)
+{
+	asset_io* io = (asset_io*)param;
+	asset_system* sys = io->system;
+
+	for(;;)
+	{
+		lua_tinker::lock_enter(&sys->lock);
+		while(sys->queue.empty() && !sys->stopping)
+			lua_tinker::cond_wait(&sys->work, &sys->lock);
+		if(sys->stopping)
+		{
+			lua_tinker::lock_leave(&sys->lock);
+			break;
+		}
+		asset_request* r = sys->queue.front();
+		sys->queue.pop_front();
+		lua_tinker::lock_leave(&sys->lock);
+
+		std::vector<char> data;
+		if(io->reader->read(r->name.c_str(), data, r->error))
+		{
+			r->buffer = new asset_buffer;
+			r->buffer->data.swap(data);
+			r->buffer->refs = 0;
+		}
+
+		lua_tinker::lock_enter(&sys->lock);
+		r->done = true;
+		sys->finished.push_back(r);
+		lua_tinker::cond_broadcast(&sys->done);
+		lua_tinker::lock_leave(&sys->lock);
+	}
+}
+
+static void delete_group(asset_system* sys, asset_group* g)
+{
+	for(size_t i=0; i<g->requests.size(); ++i)
+	{
+		asset_request* r = g->requests[i];
+		if(r->buffer && r->buffer->refs == 0)
+			delete r->buffer;
+		delete r;
+	}
+	sys->groups.erase(std::remove(sys->groups.begin(), sys->groups.end(), g), sys->groups.end());
+	delete g;
+}
+
+static void shutdown_system(asset_system* sys)
+{
+	lua_tinker::lock_enter(&sys->lock);
+	sys->stopping = true;
+	lua_tinker::cond_broadcast(&sys->work);
+	lua_tinker::lock_leave(&sys->lock);
+
+	for(size_t i=0; i<sys->threads.size(); ++i)
+	{
+		asset_io* io = sys->threads[i];
+		if(io->started)
+			lua_tinker::thread_join(&io->thread);
+		delete io->reader;
+		delete io;
+	}
+
+	while(!sys->groups.empty())
+		delete_group(sys, sys->groups.back());
+
+	lua_tinker::cond_free(&sys->done);
+	lua_tinker::cond_free(&sys->work);
+	lua_tinker::lock_free(&sys->lock);
+	delete sys;
+}
+
+static int asset_system_gc(lua_State *L)
+{
+	asset_system** p = (asset_system**)luaL_checkudata(L, 1, ASSET_SYSTEM);
+	if(*p)
+		shutdown_system(*p);
+	*p = NULL;
+	return 0;
+}
+
+static asset_system* get_system(lua_State *L)
+{
+	lua_pushlightuserdata(L, &asset_key);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	asset_system* sys = lua_isuserdata(L, -1) ? *(asset_system**)lua_touserdata(L, -1) : NULL;
+	lua_pop(L, 1);
+	return sys;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Lua Functions                                                             */
+/*---------------------------------------------------------------------------*/
+static int push_results(lua_State *L, asset_group* g)
+{
+	if(!g->many)
+	{
+		asset_request* r = g->requests[0];
+		if(r->buffer)
+		{
+			push_slice(L, r->buffer, 0, r->buffer->data.size());
+			return 1;
+		}
+		lua_pushnil(L);
+		lua_pushstring(L, r->error.c_str());
+		return 2;
+	}
+
+	lua_createtable(L, (int)g->requests.size(), 0);
+	lua_newtable(L);
+	for(size_t i=0; i<g->requests.size(); ++i)
+	{
+		asset_request* r = g->requests[i];
+		if(r->buffer)
+		{
+			push_slice(L, r->buffer, 0, r->buffer->data.size());
+		}
+		else
+		{
+			lua_pushboolean(L, 0);
+			lua_pushstring(L, r->error.c_str());
+			lua_rawseti(L, -3, (int)i + 1);
+		}
+		lua_rawseti(L, -3, (int)i + 1);
+	}
+	return 2;
+}
+
+// queues the reads of g, then yields or, on the main thread, waits for them
+static int start_group(lua_State *L, asset_system* sys, asset_group* g)
+{
+	bool main_thread = lua_pushthread(L) != 0;
+	if(main_thread)
+	{
+		lua_pop(L, 1);
+		g->co = NULL;
+		g->ref = LUA_NOREF;
+	}
+	else if(!lua_isyieldable(L))
+	{
+		// fail before queuing anything, lua_yield would raise after the reads started
+		delete_group(sys, g);
+		return luaL_error(L, "asset: cannot wait for a read across pcall or a metamethod");
+	}
+	else
+	{
+		g->co = L;
+		g->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+
+	g->remaining = (int)g->requests.size();
+	sys->groups.push_back(g);
+	sys->pending += g->remaining;
+
+	lua_tinker::lock_enter(&sys->lock);
+	for(size_t i=0; i<g->requests.size(); ++i)
+		sys->queue.push_back(g->requests[i]);
+	lua_tinker::cond_broadcast(&sys->work);
+	lua_tinker::lock_leave(&sys->lock);
+
+	if(!main_thread)
+	{
+		sys->waiting[L] = g;
+		return lua_yield(L, 0);
+	}
+
+	lua_tinker::lock_enter(&sys->lock);
+	for(size_t i=0; i<g->requests.size(); ++i)
+	{
+		while(!g->requests[i]->done)
+			lua_tinker::cond_wait(&sys->done, &sys->lock);
+	}
+	std::vector<asset_request*>& f = sys->finished;
+	for(size_t i=0; i<g->requests.size(); ++i)
+		f.erase(std::remove(f.begin(), f.end(), g->requests[i]), f.end());
+	lua_tinker::lock_leave(&sys->lock);
+
+	sys->pending -= g->remaining;
+	int n = push_results(L, g);
+	delete_group(sys, g);
+	return n;
+}
+
+static asset_group* new_group(bool many)
+{
+	asset_group* g = new asset_group;
+	g->co = NULL;
+	g->ref = LUA_NOREF;
+	g->many = many;
+	g->remaining = 0;
+	return g;
+}
+
+static void add_request(asset_group* g, const char* name)
+{
+	asset_request* r = new asset_request;
+	r->name = name;
+	r->group = g;
+	r->buffer = NULL;
+	r->done = false;
+	g->requests.push_back(r);
+}
+
+static int asset_read(lua_State *L)
+{
+	asset_system* sys = (asset_system*)lua_touserdata(L, lua_upvalueindex(1));
+	const char* name = luaL_checkstring(L, 1);
+
+	asset_group* g = new_group(false);
+	add_request(g, name);
+	return start_group(L, sys, g);
+}
+
+static int asset_read_many(lua_State *L)
+{
+	asset_system* sys = (asset_system*)lua_touserdata(L, lua_upvalueindex(1));
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	int n = (int)lua_objlen(L, 1);
+	for(int i=1; i<=n; ++i)
+	{
+		lua_rawgeti(L, 1, i);
+		if(!lua_isstring(L, -1))
+			return luaL_error(L, "asset.read_many: entry %d is not a string", i);
+		lua_pop(L, 1);
+	}
+	if(n == 0)
+	{
+		lua_newtable(L);
+		lua_newtable(L);
+		return 2;
+	}
+
+	asset_group* g = new_group(true);
+	for(int i=1; i<=n; ++i)
+	{
+		lua_rawgeti(L, 1, i);
+		add_request(g, lua_tostring(L, -1));
+		lua_pop(L, 1);
+	}
+	return start_group(L, sys, g);
+}
+
+static int asset_pending_count(lua_State *L)
+{
+	asset_system* sys = (asset_system*)lua_touserdata(L, lua_upvalueindex(1));
+	lua_pushinteger(L, sys->pending);
+	return 1;
+}
+
+static const luaL_Reg asset_funcs[] =
+{
+	{ "read", asset_read },
+	{ "read_many", asset_read_many },
+	{ "pending", asset_pending_count },
+	{ NULL, NULL }
+};
+
+/*---------------------------------------------------------------------------*/
+/* Asset API                                                                 */
+/*---------------------------------------------------------------------------*/
+bool lua_tinker::asset_open(lua_State *L, asset_reader_func create, void* ud, int threads)
+{
+	if(get_system(L))
+		return false;
+
+	if(threads <= 0)
+		threads = core_count();
+
+	asset_system* sys = new asset_system;
+	sys->pending = 0;
+	sys->stopping = false;
+	lock_init(&sys->lock);
+	cond_init(&sys->work);
+	cond_init(&sys->done);
+
+	bool ok = true;
+	for(int i=0; ok && i<threads; ++i)
+	{
+		asset_io* io = new asset_io;
+		io->system = sys;
+		io->reader = create(ud);
+		io->started = false;
+		sys->threads.push_back(io);
+		ok = io->reader && thread_start(&io->thread, asset_io_proc, io);
+		io->started = ok;
+	}
+	if(!ok)
+	{
+		print_error(L, "lua_tinker::asset_open() can not start the I/O threads");
+		shutdown_system(sys);
+		return false;
+	}
+
+	// the system lives as long as L
+	lua_pushlightuserdata(L, &asset_key);
+	asset_system** p = (asset_system**)lua_newuserdata(L, sizeof(asset_system*));
+	*p = sys;
+	luaL_newmetatable(L, ASSET_SYSTEM);
+	lua_pushcfunction(L, asset_system_gc);
+	lua_setfield(L, -2, "__gc");
+	lua_setmetatable(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+
+	luaL_newmetatable(L, ASSET_SLICE);
+	lua_pushcfunction(L, slice_gc);
+	lua_setfield(L, -2, "__gc");
+	lua_pushcfunction(L, slice_len);
+	lua_setfield(L, -2, "__len");
+	lua_pushcfunction(L, slice_tostring);
+	lua_setfield(L, -2, "__tostring");
+	lua_newtable(L);
+	luaL_register(L, NULL, slice_methods);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	lua_newtable(L);
+	for(const luaL_Reg* f = asset_funcs; f->name; ++f)
+	{
+		lua_pushlightuserdata(L, sys);
+		lua_pushcclosure(L, f->func, 1);
+		lua_setfield(L, -2, f->name);
+	}
+	lua_setglobal(L, "asset");
+	return true;
+}
+
+// true if co is suspended in asset.read or asset.read_many, not in coroutine.yield
+static bool yielded_in_read(lua_State *co)
+{
+	lua_Debug ar;
+	if(lua_status(co) != LUA_YIELD || !lua_getstack(co, 0, &ar))
+		return false;
+
+	lua_getinfo(co, "f", &ar);
+	lua_CFunction f = lua_tocfunction(co, -1);
+	lua_pop(co, 1);
+	return f == asset_read || f == asset_read_many;
+}
+
+int lua_tinker::asset_update(lua_State *L)
+{
+	asset_system* sys = get_system(L);
+	if(sys == NULL)
+		return 0;
+
+	std::vector<asset_request*> done;
+	lock_enter(&sys->lock);
+	done.swap(sys->finished);
+	lock_leave(&sys->lock);
+
+	std::vector<asset_group*> ready;
+	for(size_t i=0; i<done.size(); ++i)
+	{
+		asset_group* g = done[i]->group;
+		--sys->pending;
+		if(--g->remaining == 0)
+			ready.push_back(g);
+	}
+
+	int resumed = 0;
+	for(size_t i=0; i<ready.size(); ++i)
+	{
+		asset_group* g = ready[i];
+		lua_State* co = g->co;
+		int ref = g->ref;
+
+		// only resume co if it still waits for g, it may have been resumed by
+		// someone else since and now be suspended for another reason
+		bool resume = false;
+		std::map<lua_State*, asset_group*>::iterator w = sys->waiting.find(co);
+		if(w != sys->waiting.end() && w->second == g)
+		{
+			sys->waiting.erase(w);
+			resume = yielded_in_read(co);
+		}
+
+		int n = 0;
+		if(resume)
+			n = push_results(co, g);
+		delete_group(sys, g);
+
+		if(resume)
+		{
+			++resumed;
+			int status = lua_resume(co, n);
+			if(status != 0 && status != LUA_YIELD)
+				print_error(co, "%s", lua_tostring(co, -1));
+		}
+		luaL_unref(L, LUA_REGISTRYINDEX, ref);
+	}
+	return resumed;
+}
+
+int lua_tinker::asset_pending(lua_State *L)
+{
+	asset_system* sys = get_system(L);
+	return sys ? sys->pending : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Loose Files                                                               */
+/*---------------------------------------------------------------------------*/
+namespace
+{
+	class file_asset_reader : public lua_tinker::asset_reader
+	{
+	public:
+		file_asset_reader(const char* root) : m_root(root) {}
+
+		bool read(const char* name, std::vector<char>& data, std::string& error)
+		{
+			std::string path = m_root + "/" + name;
+#if !defined(_WIN32)
+			std::replace(path.begin(), path.end(), '\\', '/');
+#endif
+			FILE* f = fopen(path.c_str(), "rb");
+			if(f == NULL)
+			{
+				error = "cannot open " + path;
+				return false;
+			}
+
+			fseek(f, 0, SEEK_END);
+			long size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+			data.resize(size > 0 ? size : 0);
+			bool ok = size >= 0 && (size == 0 || fread(&data[0], 1, size, f) == (size_t)size);
+			fclose(f);
+			if(!ok)
+				error = "cannot read " + path;
+			return ok;
+		}
+
+	private:
+		std::string m_root;
+	};
+}
+
+lua_tinker::asset_reader* lua_tinker::file_reader(void* root)
+{
+	return new file_asset_reader((const char*)root);
+}
@@ -0,0 +1,59 @@
+// lua_asset.h
+//
+// Asynchronous asset reads for lua coroutines.
+//
+// asset_open() registers an `asset' table in a lua state and starts a pool of I/O
+// threads, each with its own reader (loose files, a CASC storage or an MPQ archive).
+//
+//   local data = asset.read("World\\Maps\\Azeroth\\Azeroth.wdt")
+//   local list, errors = asset.read_many({ "a.m2", "b.m2", "c.skin" })
+//
+// Called from a coroutine, asset.read and asset.read_many queue the reads and yield;
+// asset_update(), called once per frame on the lua thread, resumes the coroutine
+// when its data is ready. Called from the main thread they wait for the data.
+// A yielding read can not be made through pcall or a metamethod, it raises an
+// error there before any read is queued.
+//
+// Data comes back as slice userdata referencing the read buffer, so no lua string
+// is made unless asked for:
+//   #s, s:byte(i [, j]), s:u8(i), s:u16(i), s:u32(i), s:i32(i), s:f32(i),
+//   s:sub(i [, j]) (another slice of the same buffer), s:string([i [, j]])
+// Offsets are 1-based like string.byte, numbers are little endian.
+
+#if !defined(_LUA_ASSET_H_)
+#define _LUA_ASSET_H_
+
+#include <string>
+#include <vector>
+
+namespace lua_tinker
+{
+	// reads files for one I/O thread, never called from two threads at once
+	class asset_reader
+	{
+	public:
+		virtual ~asset_reader() {}
+
+		// reads a whole file, returns false with a message in error
+		virtual bool read(const char* name, std::vector<char>& data, std::string& error) = 0;
+	};
+
+	// creates the reader of one I/O thread, NULL on failure
+	typedef asset_reader* (*asset_reader_func)(void* ud);
+
+	asset_reader*	file_reader(void* root);		// loose files under a directory, ud is a const char*
+	asset_reader*	casc_reader(void* storage);		// CASC storage, ud is a const TCHAR* (lua_asset_casc.cpp)
+	asset_reader*	mpq_reader(void* archive);		// MPQ archive, ud is a const TCHAR* (lua_asset_mpq.cpp)
+
+	// the pool is shut down when L is closed
+	bool	asset_open(lua_State *L, asset_reader_func create, void* ud, int threads = 2);
+
+	// resumes coroutines whose reads are done, returns how many were resumed
+	int		asset_update(lua_State *L);
+
+	// reads queued or in progress
+	int		asset_pending(lua_State *L);
+
+} // namespace lua_tinker
+
+#endif //_LUA_ASSET_H_
@@ -0,0 +1,66 @@
+// lua_asset_casc.cpp
+//
+// CASC storage reader for lua_asset.
+
+#include <stdio.h>
+
+#include "../CascLib/CascLib.h"
+
+extern "C"
+{
+	#include "lua.h"
+};
+
+#include "lua_asset.h"
+
+#pragma comment(lib, "CascLib.lib")
+
+namespace
+{
+	// CascLib handles are not thread safe, every I/O thread opens its own storage
+	class casc_asset_reader : public lua_tinker::asset_reader
+	{
+	public:
+		casc_asset_reader(HANDLE storage) : m_storage(storage) {}
+		~casc_asset_reader() { CascCloseStorage(m_storage); }
+
+		bool read(const char* name, std::vector<char>& data, std::string& error)
+		{
+			HANDLE file;
+			if(!CascOpenFile(m_storage, name, CASC_LOCALE_ALL, 0, &file))
+				return fail(name, "cannot open", error);
+
+			DWORD size = CascGetFileSize(file, NULL);
+			DWORD read = 0;
+			bool ok = size != CASC_INVALID_SIZE;
+			if(ok && size)
+			{
+				data.resize(size);
+				ok = CascReadFile(file, &data[0], size, &read) && read == size;
+			}
+			if(!ok)
+				fail(name, "cannot read", error);
+			CascCloseFile(file);
+			return ok;
+		}
+
+	private:
+		static bool fail(const char* name, const char* what, std::string& error)
+		{
+			char temp[64];
+			sprintf(temp, " (error %d)", (int)GetLastError());
+			error = std::string(what) + " " + name + temp;
+			return false;
+		}
+
+		HANDLE m_storage;
+	};
+}
+
+lua_tinker::asset_reader* lua_tinker::casc_reader(void* storage)
+{
+	HANDLE handle;
+	if(!CascOpenStorage((const TCHAR*)storage, 0, &handle))
+		return NULL;
+	return new casc_asset_reader(handle);
+}
@@ -0,0 +1,66 @@
+// lua_asset_mpq.cpp
+//
+// MPQ archive reader for lua_asset.
+
+#include <stdio.h>
+
+#include "../stormlib/StormLib.h"
+
+extern "C"
+{
+	#include "lua.h"
+};
+
+#include "lua_asset.h"
+
+#pragma comment(lib, "stormlib.lib")
+
+namespace
+{
+	// StormLib handles are not thread safe, every I/O thread opens its own archive
+	class mpq_asset_reader : public lua_tinker::asset_reader
+	{
+	public:
+		mpq_asset_reader(HANDLE archive) : m_archive(archive) {}
+		~mpq_asset_reader() { SFileCloseArchive(m_archive, false); }
+
+		bool read(const char* name, std::vector<char>& data, std::string& error)
+		{
+			HANDLE file;
+			if(!SFileOpenFileEx(m_archive, name, SFILE_OPEN_FROM_MPQ, &file))
+				return fail(name, "cannot open", error);
+
+			DWORD size = SFileGetFileSize(file, NULL);
+			DWORD read = 0;
+			bool ok = size != SFILE_INVALID_SIZE;
+			if(ok && size)
+			{
+				data.resize(size);
+				ok = SFileReadFile(file, &data[0], size, &read, NULL) && read == size;
+			}
+			if(!ok)
+				fail(name, "cannot read", error);
+			SFileCloseFile(file);
+			return ok;
+		}
+
+	private:
+		static bool fail(const char* name, const char* what, std::string& error)
+		{
+			char temp[64];
+			sprintf(temp, " (error %d)", (int)GetLastError());
+			error = std::string(what) + " " + name + temp;
+			return false;
+		}
+
+		HANDLE m_archive;
+	};
+}
+
+lua_tinker::asset_reader* lua_tinker::mpq_reader(void* archive)
+{
+	HANDLE handle;
+	if(!SFileOpenArchive((const TCHAR*)archive, 0, MPQ_OPEN_READ_ONLY, &handle))
+		return NULL;
+	return new mpq_asset_reader(handle);
+}
@@ -0,0 +1,524 @@
+// lua_profiler.cpp
+//
+// Sampling profiler for lua states bound with LuaTinker.
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
+extern "C"
+{
+	#include "lua.h"
+	#include "lualib.h"
+	#include "lauxlib.h"
+};
+
+#include "lua_profiler.h"
+
+/*---------------------------------------------------------------------------*/
+/* Profiler State                                                            */
+/*---------------------------------------------------------------------------*/
+// sample record in the ring : depth, time (2 words, microseconds), frame ids from the root
+#define PROFILE_RING_WORDS	(1 << 20)
+#define PROFILE_MAX_DEPTH	64
+#define PROFILE_RECORD_WORDS	3
+
+#if defined(_WIN32)
+#define PROFILE_BARRIER()	MemoryBarrier()
+typedef HANDLE profile_thread;
+#else
+#define PROFILE_BARRIER()	__sync_synchronize()
+typedef pthread_t profile_thread;
+#endif
+
+static char				names_key;				// registry key of the function -> binding name table
+
+static lua_State*		s_L = NULL;				// profiled state
+static volatile int		s_running = 0;
+static volatile int		s_due = 0;				// raised by the timer thread, cleared by the hook
+static int				s_interval = 1000;
+static profile_thread	s_thread;
+static double			s_start = 0;
+static double			s_stop = 0;
+
+// single producer (the hook) / single consumer (profile_drain) ring
+static unsigned int*	s_ring = NULL;
+static volatile unsigned int s_head = 0;
+static volatile unsigned int s_tail = 0;
+static unsigned int		s_dropped = 0;
+
+// drained samples, same layout as the ring
+static std::vector<unsigned int> s_samples;
+static unsigned int		s_nsamples = 0;
+
+// frame names, only touched by the hook while profiling
+static std::vector<std::string> s_frames;
+static std::map<std::string, unsigned int> s_frame_ids;
+
+static double profile_clock()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER f, c;
+	QueryPerformanceFrequency(&f);
+	QueryPerformanceCounter(&c);
+	return (double)c.QuadPart * 1e6 / (double)f.QuadPart;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec * 1e6 + (double)t.tv_nsec * 1e-3;
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/* Timer Thread                                                              */
+/*---------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static DWORD WINAPI timer_proc(LPVOID)
+{
+	DWORD ms = s_interval >= 2000 ? s_interval / 1000 : 1;
+	timeBeginPeriod(1);
+	while(s_running)
+	{
+		Sleep(ms);
+		s_due = 1;
+	}
+	timeEndPeriod(1);
+	return 0;
+}
+#else
+static void* timer_proc(void*)
+{
+	while(s_running)
+	{
+		usleep(s_interval);
+		s_due = 1;
+	}
+	return NULL;
+}
+#endif
+
+static bool start_timer()
+{
+#if defined(_WIN32)
+	s_thread = CreateThread(NULL, 0, timer_proc, NULL, 0, NULL);
+	return s_thread != NULL;
+#else
+	return pthread_create(&s_thread, NULL, timer_proc, NULL) == 0;
+#endif
+}
+
+static void join_timer()
+{
+#if defined(_WIN32)
+	WaitForSingleObject(s_thread, INFINITE);
+	CloseHandle(s_thread);
+#else
+	pthread_join(s_thread, NULL);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/* Binding Names                                                             */
+/*---------------------------------------------------------------------------*/
+// maps the global functions and the C functions of LuaTinker class tables to
+// "name" or "class:method", inherited methods keep their parent's name.
+static void build_names(lua_State *L)
+{
+	lua_pushlightuserdata(L, &names_key);
+	lua_newtable(L);
+	int names = lua_gettop(L);
+
+	lua_pushnil(L);
+	while(lua_next(L, LUA_GLOBALSINDEX))
+	{
+		if(lua_type(L, -2) == LUA_TSTRING)
+		{
+			if(lua_isfunction(L, -1))
+			{
+				lua_pushvalue(L, -1);
+				lua_pushvalue(L, -3);
+				lua_rawset(L, names);
+			}
+			else if(lua_istable(L, -1))
+			{
+				lua_pushstring(L, "__name");
+				lua_rawget(L, -2);
+				const char* cls = lua_tostring(L, -1);
+				lua_pushstring(L, "__parent");
+				lua_rawget(L, -3);
+				int parent = lua_gettop(L);
+				if(cls)
+				{
+					lua_pushnil(L);
+					while(lua_next(L, -4))
+					{
+						bool inherited = false;
+						if(lua_istable(L, parent))
+						{
+							lua_pushvalue(L, -2);
+							lua_rawget(L, parent);
+							inherited = lua_rawequal(L, -1, -2) != 0;
+							lua_pop(L, 1);
+						}
+						if(lua_iscfunction(L, -1) && lua_type(L, -2) == LUA_TSTRING && !inherited)
+						{
+							lua_pushvalue(L, -1);
+							lua_pushfstring(L, "%s:%s", cls, lua_tostring(L, -3));
+							lua_rawset(L, names);
+						}
+						lua_pop(L, 1);
+					}
+				}
+				lua_pop(L, 2);
+			}
+		}
+		lua_pop(L, 1);
+	}
+
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Sampling                                                                  */
+/*---------------------------------------------------------------------------*/
+static unsigned int intern_frame(const char* name)
+{
+	std::map<std::string, unsigned int>::iterator it = s_frame_ids.find(name);
+	if(it != s_frame_ids.end())
+		return it->second;
+
+	unsigned int id = (unsigned int)s_frames.size();
+	s_frames.push_back(name);
+	s_frame_ids[name] = id;
+	return id;
+}
+
+// frame name of the function pushed by lua_getinfo("f")
+static unsigned int frame_id(lua_State *L, lua_Debug* ar)
+{
+	char temp[512];
+	if(*ar->what == 'C')
+	{
+		int top = lua_gettop(L);
+		lua_pushlightuserdata(L, &names_key);
+		lua_rawget(L, LUA_REGISTRYINDEX);
+		const char* bound = NULL;
+		if(lua_istable(L, -1))
+		{
+			lua_pushvalue(L, top);
+			lua_rawget(L, -2);
+			bound = lua_tostring(L, -1);
+		}
+		snprintf(temp, sizeof(temp), "%s [C]", bound ? bound : ar->name ? ar->name : "?");
+		lua_settop(L, top);
+	}
+	else if(*ar->what == 'm')
+	{
+		snprintf(temp, sizeof(temp), "main (%s)", ar->short_src);
+	}
+	else
+	{
+		const char* name = ar->name;
+		int top = lua_gettop(L);
+		if(name == NULL)
+		{
+			// called from C, e.g. by lua_tinker::call
+			lua_pushlightuserdata(L, &names_key);
+			lua_rawget(L, LUA_REGISTRYINDEX);
+			if(lua_istable(L, -1))
+			{
+				lua_pushvalue(L, top);
+				lua_rawget(L, -2);
+				name = lua_tostring(L, -1);
+			}
+		}
+		snprintf(temp, sizeof(temp), "%s (%s:%d)", name ? name : "?", ar->short_src, ar->linedefined);
+		lua_settop(L, top);
+	}
+
+	temp[sizeof(temp)-1] = 0;
+
+	// ';' separates frames in folded stacks
+	for(char* p = temp; *p; ++p)
+		if(*p == ';') *p = ':';
+
+	return intern_frame(temp);
+}
+
+static void take_sample(lua_State *L)
+{
+	unsigned int ids[PROFILE_MAX_DEPTH];
+	int depth = 0;
+	lua_Debug ar;
+	while(depth < PROFILE_MAX_DEPTH && lua_getstack(L, depth, &ar))
+	{
+		lua_getinfo(L, "Snf", &ar);
+		ids[depth++] = frame_id(L, &ar);
+		lua_pop(L, 1);
+	}
+
+	unsigned int words = PROFILE_RECORD_WORDS + depth;
+	if(PROFILE_RING_WORDS - (s_head - s_tail) < words)
+	{
+		++s_dropped;
+		return;
+	}
+
+	unsigned long long t = (unsigned long long)(profile_clock() - s_start);
+	unsigned int head = s_head;
+	s_ring[head++ & (PROFILE_RING_WORDS-1)] = depth;
+	s_ring[head++ & (PROFILE_RING_WORDS-1)] = (unsigned int)t;
+	s_ring[head++ & (PROFILE_RING_WORDS-1)] = (unsigned int)(t >> 32);
+	for(int i=depth-1; i>=0; --i)
+		s_ring[head++ & (PROFILE_RING_WORDS-1)] = ids[i];
+
+	PROFILE_BARRIER();
+	s_head = head;
+}
+
+// true if L is a thread of the profiled state, whose registry holds the names table
+static bool is_profiled(lua_State *L)
+{
+	lua_pushlightuserdata(L, &names_key);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	bool profiled = lua_istable(L, -1);
+	lua_pop(L, 1);
+	return profiled;
+}
+
+static void profile_hook(lua_State *L, lua_Debug * /*ar*/)
+{
+	// coroutines inherit the hook of the thread that created them, so it can outlive
+	// profile_stop or run in a state that is not profiled: remove it there
+	if(!s_running)
+	{
+		lua_sethook(L, NULL, 0, 0);
+		return;
+	}
+
+	if(!s_due)
+		return;
+
+	if(!is_profiled(L))
+	{
+		lua_sethook(L, NULL, 0, 0);
+		return;
+	}
+
+	s_due = 0;
+	take_sample(L);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Profiler Control                                                          */
+/*---------------------------------------------------------------------------*/
+bool lua_tinker::profile_start(lua_State *L, int interval_us, int hook_count)
+{
+	if(s_running)
+		return false;
+
+	if(s_ring == NULL)
+		s_ring = new unsigned int[PROFILE_RING_WORDS];
+
+	build_names(L);
+
+	s_L = L;
+	s_interval = interval_us > 0 ? interval_us : 1;
+	s_due = 0;
+	s_start = profile_clock();
+	s_running = 1;
+	if(!start_timer())
+	{
+		s_running = 0;
+		lua_pushlightuserdata(L, &names_key);
+		lua_pushnil(L);
+		lua_rawset(L, LUA_REGISTRYINDEX);
+		return false;
+	}
+
+	lua_sethook(L, profile_hook, LUA_MASKCOUNT, hook_count > 0 ? hook_count : 1);
+	return true;
+}
+
+void lua_tinker::profile_stop(lua_State *L)
+{
+	if(!s_running || L != s_L)
+		return;
+
+	lua_sethook(L, NULL, 0, 0);
+	s_running = 0;
+	join_timer();
+	s_stop = profile_clock();
+
+	lua_pushlightuserdata(L, &names_key);
+	lua_pushnil(L);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+
+	profile_drain();
+}
+
+bool lua_tinker::profile_running()
+{
+	return s_running != 0;
+}
+
+void lua_tinker::profile_drain()
+{
+	unsigned int head = s_head;
+	PROFILE_BARRIER();
+	unsigned int tail = s_tail;
+	while(tail != head)
+	{
+		unsigned int depth = s_ring[tail & (PROFILE_RING_WORDS-1)];
+		for(unsigned int i=0; i<PROFILE_RECORD_WORDS+depth; ++i)
+			s_samples.push_back(s_ring[tail++ & (PROFILE_RING_WORDS-1)]);
+		++s_nsamples;
+	}
+	PROFILE_BARRIER();
+	s_tail = tail;
+}
+
+void lua_tinker::profile_get_stats(profile_stats* stats)
+{
+	stats->samples = s_nsamples;
+	stats->dropped = s_dropped;
+	stats->frames = (unsigned int)s_frames.size();
+	stats->duration = (s_running ? profile_clock() : s_stop) - s_start;
+}
+
+void lua_tinker::profile_clear()
+{
+	if(s_running)
+		return;
+
+	s_samples.clear();
+	s_nsamples = 0;
+	s_dropped = 0;
+	s_frames.clear();
+	s_frame_ids.clear();
+	s_head = s_tail = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Export                                                                    */
+/*---------------------------------------------------------------------------*/
+// one "root;...;leaf count" line per distinct stack
+bool lua_tinker::profile_write_folded(const char* filename)
+{
+	if(s_running)
+		return false;
+
+	std::map<std::string, unsigned int> stacks;
+	for(size_t i=0; i<s_samples.size(); )
+	{
+		unsigned int depth = s_samples[i];
+		std::string stack;
+		for(unsigned int d=0; d<depth; ++d)
+		{
+			if(d) stack += ';';
+			stack += s_frames[s_samples[i+PROFILE_RECORD_WORDS+d]];
+		}
+		if(depth)
+			++stacks[stack];
+		i += PROFILE_RECORD_WORDS + depth;
+	}
+
+	FILE* f = fopen(filename, "w");
+	if(f == NULL)
+		return false;
+
+	for(std::map<std::string, unsigned int>::iterator it = stacks.begin(); it != stacks.end(); ++it)
+		fprintf(f, "%s %u\n", it->first.c_str(), it->second);
+
+	return fclose(f) == 0;
+}
+
+static void write_json_string(FILE* f, const std::string& s)
+{
+	fputc('"', f);
+	for(size_t i=0; i<s.size(); ++i)
+	{
+		unsigned char c = (unsigned char)s[i];
+		if(c == '"' || c == '\\')
+			fprintf(f, "\\%c", c);
+		else if(c < 0x20)
+			fprintf(f, "\\u%04x", c);
+		else
+			fputc(c, f);
+	}
+	fputc('"', f);
+}
+
+static void write_event(FILE* f, bool& first, unsigned int frame, unsigned long long start, unsigned long long end)
+{
+	fprintf(f, first ? "\n" : ",\n");
+	first = false;
+	fprintf(f, "{\"name\":");
+	write_json_string(f, s_frames[frame]);
+	fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu}", start, end > start ? end - start : 1);
+}
+
+// consecutive samples sharing a stack prefix become one "X" event per frame
+bool lua_tinker::profile_write_chrome(const char* filename)
+{
+	if(s_running)
+		return false;
+
+	FILE* f = fopen(filename, "w");
+	if(f == NULL)
+		return false;
+
+	fprintf(f, "{\"traceEvents\":[");
+	bool first = true;
+
+	std::vector<unsigned int> open;				// frames of the previous sample
+	std::vector<unsigned long long> opened;		// when they were entered
+	unsigned long long t = 0;
+	for(size_t i=0; i<s_samples.size(); )
+	{
+		unsigned int depth = s_samples[i];
+		t = s_samples[i+1] | ((unsigned long long)s_samples[i+2] << 32);
+		const unsigned int* frames = &s_samples[i+PROFILE_RECORD_WORDS];
+
+		size_t common = 0;
+		while(common < open.size() && common < depth && open[common] == frames[common])
+			++common;
+		while(open.size() > common)
+		{
+			write_event(f, first, open.back(), opened.back(), t);
+			open.pop_back();
+			opened.pop_back();
+		}
+		for(size_t d=common; d<depth; ++d)
+		{
+			open.push_back(frames[d]);
+			opened.push_back(t);
+		}
+		i += PROFILE_RECORD_WORDS + depth;
+	}
+	t += s_interval;
+	while(!open.empty())
+	{
+		write_event(f, first, open.back(), opened.back(), t);
+		open.pop_back();
+		opened.pop_back();
+	}
+
+	fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	return fclose(f) == 0;
+}
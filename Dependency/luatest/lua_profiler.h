@@ -0,0 +1,55 @@
+// lua_profiler.h
+//
+// Sampling profiler for lua states bound with LuaTinker.
+//
+// A timer thread raises a flag every interval, and a count hook installed on the
+// profiled state records the current call stack the next time it runs after that.
+// The hook does nothing else, so the cost is one flag test per hook_count VM
+// instructions. Stacks go into a lock-free ring buffer and are exported as folded
+// stacks (for flamegraph.pl) or as a Chrome trace (chrome://tracing).
+//
+// C functions show up when they are on the stack below lua code, named after their
+// global or "class:method" LuaTinker binding. Time spent in a C function that does
+// not call back into lua is charged to the lua line that called it.
+
+#if !defined(_LUA_PROFILER_H_)
+#define _LUA_PROFILER_H_
+
+namespace lua_tinker
+{
+	struct profile_stats
+	{
+		unsigned int	samples;	// samples recorded
+		unsigned int	dropped;	// samples lost because the ring buffer was full
+		unsigned int	frames;		// distinct frames seen
+		double			duration;	// profiled time, in microseconds
+	};
+
+	// starts profiling L, only one state can be profiled at a time.
+	// functions bound after this call are not resolved to their binding names.
+	bool	profile_start(lua_State *L, int interval_us = 1000, int hook_count = 1000);
+	void	profile_stop(lua_State *L);
+	bool	profile_running();
+
+	// moves recorded samples out of the ring buffer, may be called from any one thread
+	void	profile_drain();
+
+	// exports and statistics, for a stopped profiler
+	void	profile_get_stats(profile_stats* stats);
+	bool	profile_write_folded(const char* filename);
+	bool	profile_write_chrome(const char* filename);
+	void	profile_clear();
+
+	// profiles a frame or an editor command
+	struct profile_scope
+	{
+		profile_scope(lua_State *L, int interval_us = 1000) : m_L(L) { m_started = profile_start(L, interval_us); }
+		~profile_scope() { if(m_started) profile_stop(m_L); }
+
+		lua_State* m_L;
+		bool m_started;
+	};
+
+} // namespace lua_tinker
+
+#endif //_LUA_PROFILER_H_
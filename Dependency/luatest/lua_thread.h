@@ -0,0 +1,117 @@
+// lua_thread.h
+//
+// Threads, locks and condition variables for the LuaTinker helpers that run
+// work off the lua thread (lua_worker, lua_asset). Include from .cpp files only.
+
+#if !defined(_LUA_THREAD_H_)
+#define _LUA_THREAD_H_
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace lua_tinker
+{
+	typedef void (*thread_func)(void* param);
+
+#if defined(_WIN32)
+	typedef HANDLE				thread_handle;
+	typedef CRITICAL_SECTION	thread_lock;
+	typedef CONDITION_VARIABLE	thread_cond;
+	typedef volatile LONG		thread_counter;
+
+	inline void lock_init(thread_lock* l)		{ InitializeCriticalSection(l); }
+	inline void lock_free(thread_lock* l)		{ DeleteCriticalSection(l); }
+	inline void lock_enter(thread_lock* l)		{ EnterCriticalSection(l); }
+	inline void lock_leave(thread_lock* l)		{ LeaveCriticalSection(l); }
+	inline void cond_init(thread_cond* c)		{ InitializeConditionVariable(c); }
+	inline void cond_free(thread_cond*)			{}
+	inline void cond_wait(thread_cond* c, thread_lock* l)	{ SleepConditionVariableCS(c, l, INFINITE); }
+	inline void cond_signal(thread_cond* c)		{ WakeConditionVariable(c); }
+	inline void cond_broadcast(thread_cond* c)	{ WakeAllConditionVariable(c); }
+	inline void counter_add(thread_counter* n)	{ InterlockedIncrement(n); }
+	inline void counter_sub(thread_counter* n)	{ InterlockedDecrement(n); }
+	inline long counter_get(thread_counter* n)	{ return InterlockedCompareExchange(n, 0, 0); }
+
+	inline int core_count()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return (int)info.dwNumberOfProcessors;
+	}
+#else
+	typedef pthread_t			thread_handle;
+	typedef pthread_mutex_t		thread_lock;
+	typedef pthread_cond_t		thread_cond;
+	typedef volatile long		thread_counter;
+
+	inline void lock_init(thread_lock* l)		{ pthread_mutex_init(l, NULL); }
+	inline void lock_free(thread_lock* l)		{ pthread_mutex_destroy(l); }
+	inline void lock_enter(thread_lock* l)		{ pthread_mutex_lock(l); }
+	inline void lock_leave(thread_lock* l)		{ pthread_mutex_unlock(l); }
+	inline void cond_init(thread_cond* c)		{ pthread_cond_init(c, NULL); }
+	inline void cond_free(thread_cond* c)		{ pthread_cond_destroy(c); }
+	inline void cond_wait(thread_cond* c, thread_lock* l)	{ pthread_cond_wait(c, l); }
+	inline void cond_signal(thread_cond* c)		{ pthread_cond_signal(c); }
+	inline void cond_broadcast(thread_cond* c)	{ pthread_cond_broadcast(c); }
+	inline void counter_add(thread_counter* n)	{ __sync_add_and_fetch(n, 1); }
+	inline void counter_sub(thread_counter* n)	{ __sync_sub_and_fetch(n, 1); }
+	inline long counter_get(thread_counter* n)	{ return __sync_fetch_and_add(n, 0); }
+
+	inline int core_count()
+	{
+		return (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+#endif
+
+	struct thread_start_param
+	{
+		thread_func	func;
+		void*		param;
+	};
+
+#if defined(_WIN32)
+	inline DWORD WINAPI thread_proc(LPVOID p)
+#else
+	inline void* thread_proc(void* p)
+#endif
+	{
+		thread_start_param start = *(thread_start_param*)p;
+		delete (thread_start_param*)p;
+		start.func(start.param);
+		return 0;
+	}
+
+	inline bool thread_start(thread_handle* thread, thread_func func, void* param)
+	{
+		thread_start_param* p = new thread_start_param;
+		p->func = func;
+		p->param = param;
+#if defined(_WIN32)
+		*thread = CreateThread(NULL, 0, thread_proc, p, 0, NULL);
+		if(*thread != NULL)
+			return true;
+#else
+		if(pthread_create(thread, NULL, thread_proc, p) == 0)
+			return true;
+#endif
+		delete p;
+		return false;
+	}
+
+	inline void thread_join(thread_handle* thread)
+	{
+#if defined(_WIN32)
+		WaitForSingleObject(*thread, INFINITE);
+		CloseHandle(*thread);
+#else
+		pthread_join(*thread, NULL);
+#endif
+	}
+
+} // namespace lua_tinker
+
+#endif //_LUA_THREAD_H_
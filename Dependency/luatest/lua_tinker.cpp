@@ -18,6 +18,9 @@ extern "C"
 #include "lua_tinker.h"
 
 
+static const char s64_name[] = "__s64";
+static const char u64_name[] = "__u64";
+
 /*---------------------------------------------------------------------------*/ 
 /* init                                                                      */ 
 /*---------------------------------------------------------------------------*/ 
@@ -62,7 +65,7 @@ static int le_s64(lua_State *L)
 /*---------------------------------------------------------------------------*/ 
 void lua_tinker::init_s64(lua_State *L)
 {
-	const char* name = "__s64";
+	const char* name = s64_name;
 	lua_pushstring(L, name);
 	lua_newtable(L);
 
@@ -86,6 +89,8 @@ void lua_tinker::init_s64(lua_State *L)
 	lua_pushcclosure(L, le_s64, 0);
 	lua_rawset(L, -3);	
 
+	add_meta(L, name);
+
 	lua_settable(L, LUA_GLOBALSINDEX);
 }
 
@@ -124,7 +129,7 @@ static int le_u64(lua_State *L)
 /*---------------------------------------------------------------------------*/ 
 void lua_tinker::init_u64(lua_State *L)
 {
-	const char* name = "__u64";
+	const char* name = u64_name;
 	lua_pushstring(L, name);
 	lua_newtable(L);
 
@@ -148,6 +153,8 @@ void lua_tinker::init_u64(lua_State *L)
 	lua_pushcclosure(L, le_u64, 0);
 	lua_rawset(L, -3);	
 
+	add_meta(L, name);
+
 	lua_settable(L, LUA_GLOBALSINDEX);
 }
 
@@ -505,16 +512,14 @@ template<>
 void lua_tinker::push(lua_State *L, long long ret)			
 { 
 	*(long long*)lua_newuserdata(L, sizeof(long long)) = ret;
-	lua_pushstring(L, "__s64");
-	lua_gettable(L, LUA_GLOBALSINDEX);
+	push_meta(L, s64_name);
 	lua_setmetatable(L, -2);
 }
 template<>
 void lua_tinker::push(lua_State *L, unsigned long long ret)
 {
 	*(unsigned long long*)lua_newuserdata(L, sizeof(unsigned long long)) = ret;
-	lua_pushstring(L, "__u64");
-	lua_gettable(L, LUA_GLOBALSINDEX);
+	push_meta(L, u64_name);
 	lua_setmetatable(L, -2);
 }
 
@@ -570,12 +575,7 @@ int lua_tinker::meta_get(lua_State *L)
 	lua_pushvalue(L,2);
 	lua_rawget(L,-2);
 
-	if(lua_isuserdata(L,-1))
-	{
-		user2type<var_base*>::invoke(L,-1)->get(L);
-		lua_remove(L, -2);
-	}
-	else if(lua_isnil(L,-1))
+	if(lua_isnil(L,-1))
 	{
 		lua_remove(L,-1);
 		invoke_parent(L);
@@ -586,6 +586,12 @@ int lua_tinker::meta_get(lua_State *L)
 		}
 	} 
 
+	if(lua_isuserdata(L,-1))
+	{
+		user2type<var_base*>::invoke(L,-1)->get(L);
+		lua_remove(L, -2);
+	}
+
 	lua_remove(L,-2);
 
 	return 1;
@@ -598,6 +604,12 @@ int lua_tinker::meta_set(lua_State *L)
 	lua_pushvalue(L,2);
 	lua_rawget(L,-2);
 
+	if(lua_isnil(L, -1))
+	{
+		lua_remove(L,-1);
+		invoke_parent(L);
+	}
+
 	if(lua_isuserdata(L,-1))
 	{
 		user2type<var_base*>::invoke(L,-1)->set(L);
@@ -615,8 +627,133 @@ int lua_tinker::meta_set(lua_State *L)
 /*---------------------------------------------------------------------------*/ 
 void lua_tinker::push_meta(lua_State *L, const char* name)
 {
-	lua_pushstring(L, name);
-	lua_gettable(L, LUA_GLOBALSINDEX);
+	// class tables are cached in the registry by name address (see add_meta)
+	lua_pushlightuserdata(L, (void*)name);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if(lua_isnil(L, -1))
+	{
+		lua_pop(L, 1);
+		lua_pushstring(L, name);
+		lua_gettable(L, LUA_GLOBALSINDEX);
+	}
+}
+
+/*---------------------------------------------------------------------------*/ 
+void lua_tinker::add_meta(lua_State *L, const char* name)
+{
+	lua_pushlightuserdata(L, (void*)name);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+/*---------------------------------------------------------------------------*/ 
+/* Tinker Pointer Cache                                                      */ 
+/*---------------------------------------------------------------------------*/ 
+static char cache_key;
+
+/*---------------------------------------------------------------------------*/ 
+int lua_tinker::push_cache(lua_State *L, void* ptr, const char* name)
+{
+	// class_cache turns the cache on in the class table, so it's per lua_State
+	int result = cache_off;
+
+	push_meta(L, name);
+	if(lua_istable(L, -1))
+	{
+		lua_pushstring(L, "__cache");
+		lua_rawget(L, -2);
+		if(lua_toboolean(L, -1))
+			result = cache_miss;
+		lua_pop(L, 1);
+	}
+
+	if(result == cache_miss)
+	{
+		lua_pushlightuserdata(L, &cache_key);
+		lua_rawget(L, LUA_REGISTRYINDEX);
+		if(lua_istable(L, -1))
+		{
+			lua_pushlightuserdata(L, ptr);
+			lua_rawget(L, -2);
+
+			// a base class object can share its address with the derived object
+			if(lua_isuserdata(L, -1) && lua_getmetatable(L, -1))
+			{
+				if(lua_rawequal(L, -1, -4))
+					result = cache_hit;
+				lua_pop(L, 1);
+			}
+
+			if(result == cache_hit)
+			{
+				// meta, cache, userdata -> userdata
+				lua_replace(L, -3);
+				lua_pop(L, 1);
+				return result;
+			}
+			lua_pop(L, 1);
+		}
+		lua_pop(L, 1);
+	}
+	lua_pop(L, 1);
+	return result;
+}
+
+/*---------------------------------------------------------------------------*/ 
+void lua_tinker::add_cache(lua_State *L, void* ptr)
+{
+	lua_pushlightuserdata(L, &cache_key);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if(!lua_istable(L, -1))
+	{
+		lua_pop(L, 1);
+
+		// weak values, the cache doesn't keep objects alive
+		lua_newtable(L);
+		lua_newtable(L);
+		lua_pushstring(L, "__mode");
+		lua_pushstring(L, "v");
+		lua_rawset(L, -3);
+		lua_setmetatable(L, -2);
+
+		lua_pushlightuserdata(L, &cache_key);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, LUA_REGISTRYINDEX);
+	}
+
+	lua_pushlightuserdata(L, ptr);
+	lua_pushvalue(L, -3);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+}
+
+/*---------------------------------------------------------------------------*/ 
+void lua_tinker::copy_parent(lua_State *L)
+{
+	// flatten parent members into the class table, members of the class win
+	lua_pushstring(L, "__parent");
+	lua_rawget(L, -2);
+	if(lua_istable(L, -1))
+	{
+		lua_pushnil(L);
+		while(lua_next(L, -2))
+		{
+			lua_pushvalue(L, -2);
+			lua_rawget(L, -5);
+			if(lua_isnil(L, -1))
+			{
+				lua_pop(L, 1);
+				lua_pushvalue(L, -2);
+				lua_insert(L, -2);
+				lua_rawset(L, -5);
+			}
+			else
+			{
+				lua_pop(L, 2);
+			}
+		}
+	}
+	lua_pop(L, 1);
 }
 
 /*---------------------------------------------------------------------------*/ 
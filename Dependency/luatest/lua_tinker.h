@@ -89,6 +89,10 @@ namespace lua_tinker
 	template<> struct is_obj<unsigned long long>	{ static const bool value = false; };
 	template<> struct is_obj<table>					{ static const bool value = false; };
 
+	// values without destructor are stored as plain data in userdata
+	template<typename A>
+	struct has_trivial_destructor { static const bool value = __has_trivial_destructor(A); };
+
 	/////////////////////////////////
 	enum { no = 1, yes = 2 }; 
 	typedef char (& no_type )[no]; 
@@ -144,11 +148,12 @@ namespace lua_tinker
 		}
 	};
 
+	// userdata header, m_destroy is NULL when the userdata doesn't own a value
 	struct user
 	{
-		user(void* p) : m_p(p) {}
-		virtual ~user() {}
+		user(void* p, void (*destroy)(user*) = NULL) : m_p(p), m_destroy(destroy) {}
 		void* m_p;
+		void (*m_destroy)(user*);
 	};
 
 	template<typename T>  
@@ -162,11 +167,13 @@ namespace lua_tinker
 	{ 
 		static T invoke(lua_State *L, int index) 
 		{ 
+#if !defined(LUA_TINKER_TRUSTED)
 			if(!lua_isuserdata(L,index))
 			{
 				lua_pushstring(L, "no class at first argument. (forgot ':' expression ?)");
 				lua_error(L);
 			}
+#endif
 			return void2type<T>::invoke(user2type<user*>::invoke(L,index)->m_p); 
 		} 
 	};
@@ -180,27 +187,48 @@ namespace lua_tinker
 				>::type::invoke(L, index);
 	}
 
+	template<typename T>
+	struct val_destroyer { static void invoke(user* u) { ((T*)u->m_p)->~T(); } };
+
+	// the value is stored inline, right after the header
 	template<typename T>
 	struct val2user : user
 	{
-		val2user() : user(new T) {}
+		static void (*destroy_func())(user*) { return has_trivial_destructor<T>::value ? NULL : val_destroyer<T>::invoke; }
+
+		val2user() : user(m_data, destroy_func()) { new(m_data) T; }
 
 		template<typename T1>
-		val2user(T1 t1) : user(new T(t1)) {}
+		val2user(T1 t1) : user(m_data, destroy_func()) { new(m_data) T(t1); }
 
 		template<typename T1, typename T2>
-		val2user(T1 t1, T2 t2) : user(new T(t1, t2)) {}
+		val2user(T1 t1, T2 t2) : user(m_data, destroy_func()) { new(m_data) T(t1, t2); }
 
 		template<typename T1, typename T2, typename T3>
-		val2user(T1 t1, T2 t2, T3 t3) : user(new T(t1, t2, t3)) {}
+		val2user(T1 t1, T2 t2, T3 t3) : user(m_data, destroy_func()) { new(m_data) T(t1, t2, t3); }
 
 		template<typename T1, typename T2, typename T3, typename T4>
-		val2user(T1 t1, T2 t2, T3 t3, T4 t4) : user(new T(t1, t2, t3,t4)) {}
+		val2user(T1 t1, T2 t2, T3 t3, T4 t4) : user(m_data, destroy_func()) { new(m_data) T(t1, t2, t3,t4); }
 
 		template<typename T1, typename T2, typename T3, typename T4, typename T5>
-		val2user(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5) : user(new T(t1, t2, t3,t4,t5)) {}
+		val2user(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5) : user(m_data, destroy_func()) { new(m_data) T(t1, t2, t3,t4,t5); }
 
-		~val2user() { delete ((T*)m_p); }
+		template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+		val2user(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6) : user(m_data, destroy_func()) { new(m_data) T(t1,t2,t3,t4,t5,t6); }
+
+		template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+		val2user(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6, T7 t7) : user(m_data, destroy_func()) { new(m_data) T(t1,t2,t3,t4,t5,t6,t7); }
+
+		template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+		val2user(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6, T7 t7, T8 t8) : user(m_data, destroy_func()) { new(m_data) T(t1,t2,t3,t4,t5,t6,t7,t8); }
+
+		union
+		{
+			char		m_data[sizeof(T)];
+			double		m_align;
+			void*		m_align_ptr;
+			long long	m_align_s64;
+		};
 	};
 
 	template<typename T>
@@ -215,13 +243,42 @@ namespace lua_tinker
 		ref2user(T& t) : user(&t) {}
 	};
 
+	// pointer cache
+	enum { cache_off, cache_hit, cache_miss };
+	void push_meta(lua_State *L, const char* name);
+	int push_cache(lua_State *L, void* ptr, const char* name);
+	void add_cache(lua_State *L, void* ptr);
+
+	template<typename T>
+	void set_meta(lua_State *L) { push_meta(L, class_name<typename class_type<T>::type>::name()); lua_setmetatable(L, -2); }
+
 	// to lua
 	template<typename T>
-	struct val2lua { static void invoke(lua_State *L, T& input){ new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(input); } };
+	struct val2lua { static void invoke(lua_State *L, T& input){ new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(input); set_meta<T>(L); } };
 	template<typename T>
-	struct ptr2lua { static void invoke(lua_State *L, T* input){ if(input) new(lua_newuserdata(L, sizeof(ptr2user<T>))) ptr2user<T>(input); else lua_pushnil(L); } };
+	struct ptr2lua
+	{
+		static void invoke(lua_State *L, T* input)
+		{
+			typedef typename class_type<T>::type C;
+			if(!input)
+			{
+				lua_pushnil(L);
+				return;
+			}
+
+			int cached = push_cache(L, (void*)input, class_name<C>::name());
+			if(cached != cache_hit)
+			{
+				new(lua_newuserdata(L, sizeof(ptr2user<T>))) ptr2user<T>(input);
+				set_meta<T>(L);
+				if(cached == cache_miss)
+					add_cache(L, (void*)input);
+			}
+		}
+	};
 	template<typename T>
-	struct ref2lua { static void invoke(lua_State *L, T& input){ new(lua_newuserdata(L, sizeof(ref2user<T>))) ref2user<T>(input); } };
+	struct ref2lua { static void invoke(lua_State *L, T& input){ ptr2lua<T>::invoke(L, &input); } };
 
 	template<typename T>
 	struct enum2lua { static void invoke(lua_State *L, T val) { lua_pushnumber(L, (int)val); } };
@@ -238,9 +295,6 @@ namespace lua_tinker
 					,val2lua<typename base_type<T>::type>
 				>::type
 			>::type::invoke(L, val);
-
-			push_meta(L, class_name<typename class_type<T>::type>::name());
-			lua_setmetatable(L, -2);
 		} 
 	};
 
@@ -311,72 +365,149 @@ namespace lua_tinker
 	template<>	void	pop(lua_State *L);
 	template<>	table	pop(lua_State *L);
 
+	// argument and return value of a bound function. arithmetic types are read and
+	// pushed inline as lua_Number, everything else goes through read<T>/push<T>.
+	// build with LUA_TINKER_TRUSTED when scripts always pass the declared types : the
+	// userdata check on class arguments and `self' is skipped (a wrong type crashes
+	// instead of raising an error) and bool is read with plain lua truth.
+	template<typename T>
+	struct stack_value
+	{
+		static T get(lua_State *L, int index)	{ return read<T>(L, index); }
+		static void put(lua_State *L, T value)	{ push(L, value); }
+	};
+
+	template<typename T>
+	struct number_value
+	{
+		static T get(lua_State *L, int index)	{ return (T)lua_tonumber(L, index); }
+		static void put(lua_State *L, T value)	{ lua_pushnumber(L, (lua_Number)value); }
+	};
+
+	template<> struct stack_value<char>				: number_value<char> {};
+	template<> struct stack_value<unsigned char>	: number_value<unsigned char> {};
+	template<> struct stack_value<short>			: number_value<short> {};
+	template<> struct stack_value<unsigned short>	: number_value<unsigned short> {};
+	template<> struct stack_value<long>				: number_value<long> {};
+	template<> struct stack_value<unsigned long>	: number_value<unsigned long> {};
+	template<> struct stack_value<int>				: number_value<int> {};
+	template<> struct stack_value<unsigned int>		: number_value<unsigned int> {};
+	template<> struct stack_value<float>			: number_value<float> {};
+	template<> struct stack_value<double>			: number_value<double> {};
+
+	template<>
+	struct stack_value<bool>
+	{
+#if defined(LUA_TINKER_TRUSTED)
+		static bool get(lua_State *L, int index)	{ return lua_toboolean(L, index) != 0; }
+#else
+		static bool get(lua_State *L, int index)	{ return read<bool>(L, index); }
+#endif
+		static void put(lua_State *L, bool value)	{ lua_pushboolean(L, value); }
+	};
+
 	// functor (with return value)
-	template<typename RVal, typename T1=void, typename T2=void, typename T3=void, typename T4=void, typename T5=void>
+	template<typename RVal, typename T1=void, typename T2=void, typename T3=void, typename T4=void, typename T5=void, typename T6=void, typename T7=void, typename T8=void>
 	struct functor
 	{
-		static int invoke(lua_State *L) { push(L,upvalue_<RVal(*)(T1,T2,T3,T4,T5)>(L)(read<T1>(L,1),read<T2>(L,2),read<T3>(L,3),read<T4>(L,4),read<T5>(L,5))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1,T2,T3,T4,T5,T6,T7,T8)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5),stack_value<T6>::get(L,6),stack_value<T7>::get(L,7),stack_value<T8>::get(L,8))); return 1; }
+	};
+
+	template<typename RVal, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+	struct functor<RVal,T1,T2,T3,T4,T5,T6,T7> 
+	{
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1,T2,T3,T4,T5,T6,T7)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5),stack_value<T6>::get(L,6),stack_value<T7>::get(L,7))); return 1; }
+	};
+
+	template<typename RVal, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+	struct functor<RVal,T1,T2,T3,T4,T5,T6> 
+	{
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1,T2,T3,T4,T5,T6)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5),stack_value<T6>::get(L,6))); return 1; }
+	};
+
+	template<typename RVal, typename T1, typename T2, typename T3, typename T4, typename T5>
+	struct functor<RVal,T1,T2,T3,T4,T5> 
+	{
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1,T2,T3,T4,T5)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5))); return 1; }
 	};
 
 	template<typename RVal, typename T1, typename T2, typename T3, typename T4>
 	struct functor<RVal,T1,T2,T3,T4> 
 	{
-		static int invoke(lua_State *L) { push(L,upvalue_<RVal(*)(T1,T2,T3,T4)>(L)(read<T1>(L,1),read<T2>(L,2),read<T3>(L,3),read<T4>(L,4))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1,T2,T3,T4)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4))); return 1; }
 	};
 
 	template<typename RVal, typename T1, typename T2, typename T3>
 	struct functor<RVal,T1,T2,T3> 
 	{
-		static int invoke(lua_State *L) { push(L,upvalue_<RVal(*)(T1,T2,T3)>(L)(read<T1>(L,1),read<T2>(L,2),read<T3>(L,3))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1,T2,T3)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3))); return 1; }
 	};
 
 	template<typename RVal, typename T1, typename T2>
 	struct functor<RVal,T1,T2> 
 	{
-		static int invoke(lua_State *L) { push(L,upvalue_<RVal(*)(T1,T2)>(L)(read<T1>(L,1),read<T2>(L,2))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1,T2)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2))); return 1; }
 	};
 
 	template<typename RVal, typename T1>
 	struct functor<RVal,T1> 
 	{
-		static int invoke(lua_State *L) { push(L,upvalue_<RVal(*)(T1)>(L)(read<T1>(L,1))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)(T1)>(L)(stack_value<T1>::get(L,1))); return 1; }
 	};
 
 	template<typename RVal>
 	struct functor<RVal>
 	{
-		static int invoke(lua_State *L) { push(L,upvalue_<RVal(*)()>(L)()); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,upvalue_<RVal(*)()>(L)()); return 1; }
 	};
 
 	// functor (without return value)
+	template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+	struct functor<void, T1, T2, T3, T4, T5, T6, T7, T8>
+	{
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3,T4,T5,T6,T7,T8)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5),stack_value<T6>::get(L,6),stack_value<T7>::get(L,7),stack_value<T8>::get(L,8)); return 0; }
+	};
+
+	template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+	struct functor<void, T1, T2, T3, T4, T5, T6, T7>
+	{
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3,T4,T5,T6,T7)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5),stack_value<T6>::get(L,6),stack_value<T7>::get(L,7)); return 0; }
+	};
+
+	template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+	struct functor<void, T1, T2, T3, T4, T5, T6>
+	{
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3,T4,T5,T6)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5),stack_value<T6>::get(L,6)); return 0; }
+	};
+
 	template<typename T1, typename T2, typename T3, typename T4, typename T5>
 	struct functor<void, T1, T2, T3, T4, T5>
 	{
-		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3,T4,T5)>(L)(read<T1>(L,1),read<T2>(L,2),read<T3>(L,3),read<T4>(L,4),read<T5>(L,5)); return 0; }
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3,T4,T5)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4),stack_value<T5>::get(L,5)); return 0; }
 	};
 
 	template<typename T1, typename T2, typename T3, typename T4>
 	struct functor<void, T1, T2, T3, T4>
 	{
-		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3,T4)>(L)(read<T1>(L,1),read<T2>(L,2),read<T3>(L,3),read<T4>(L,4)); return 0; }
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3,T4)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3),stack_value<T4>::get(L,4)); return 0; }
 	};
 
 	template<typename T1, typename T2, typename T3>
 	struct functor<void, T1, T2, T3>
 	{
-		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3)>(L)(read<T1>(L,1),read<T2>(L,2),read<T3>(L,3)); return 0; }
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2,T3)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2),stack_value<T3>::get(L,3)); return 0; }
 	};
 
 	template<typename T1, typename T2>
 	struct functor<void, T1, T2>
 	{
-		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2)>(L)(read<T1>(L,1),read<T2>(L,2)); return 0; }
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1,T2)>(L)(stack_value<T1>::get(L,1),stack_value<T2>::get(L,2)); return 0; }
 	};
 
 	template<typename T1>
 	struct functor<void, T1>
 	{
-		static int invoke(lua_State *L) { upvalue_<void(*)(T1)>(L)(read<T1>(L,1)); return 0; }
+		static int invoke(lua_State *L) { upvalue_<void(*)(T1)>(L)(stack_value<T1>::get(L,1)); return 0; }
 	};
 
 	template<>
@@ -389,7 +520,7 @@ namespace lua_tinker
 	template<typename T1>
 	struct functor<int, lua_State*, T1>
 	{
-		static int invoke(lua_State *L) { return upvalue_<int(*)(lua_State*,T1)>(L)(L,read<T1>(L,1)); }
+		static int invoke(lua_State *L) { return upvalue_<int(*)(lua_State*,T1)>(L)(L,stack_value<T1>::get(L,1)); }
 	};
 
 	template<>
@@ -435,6 +566,24 @@ namespace lua_tinker
 		lua_pushcclosure(L, functor<RVal,T1,T2,T3,T4,T5>::invoke, 1);
 	}
 
+	template<typename RVal, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6> 
+	void push_functor(lua_State *L, RVal (*func)(T1,T2,T3,T4,T5,T6))
+	{ 
+		lua_pushcclosure(L, functor<RVal,T1,T2,T3,T4,T5,T6>::invoke, 1);
+	}
+
+	template<typename RVal, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7> 
+	void push_functor(lua_State *L, RVal (*func)(T1,T2,T3,T4,T5,T6,T7))
+	{ 
+		lua_pushcclosure(L, functor<RVal,T1,T2,T3,T4,T5,T6,T7>::invoke, 1);
+	}
+
+	template<typename RVal, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8> 
+	void push_functor(lua_State *L, RVal (*func)(T1,T2,T3,T4,T5,T6,T7,T8))
+	{ 
+		lua_pushcclosure(L, functor<RVal,T1,T2,T3,T4,T5,T6,T7,T8>::invoke, 1);
+	}
+
 	// member variable
 	struct var_base
 	{
@@ -447,76 +596,112 @@ namespace lua_tinker
 	{
 		V T::*_var;
 		mem_var(V T::*val) : _var(val) {}
-		void get(lua_State *L)	{ push<if_<is_obj<V>::value,V&,V>::type>(L, read<T*>(L,1)->*(_var));	}
+		void get(lua_State *L)	{ push<typename if_<is_obj<V>::value,V&,V>::type>(L, read<T*>(L,1)->*(_var));	}
 		void set(lua_State *L)	{ read<T*>(L,1)->*(_var) = read<V>(L, 3);	}
 	};
 
 	// class member functor (with return value)
-	template<typename RVal, typename T, typename T1=void, typename T2=void, typename T3=void, typename T4=void, typename T5=void>
+	template<typename RVal, typename T, typename T1=void, typename T2=void, typename T3=void, typename T4=void, typename T5=void, typename T6=void, typename T7=void, typename T8=void>
 	struct mem_functor
 	{
-		static int invoke(lua_State *L) { push(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3,T4,T5)>(L))(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4),read<T4>(L,5),read<T5>(L,6)));; return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3,T4,T5,T6,T7,T8)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7),stack_value<T7>::get(L,8),stack_value<T8>::get(L,9))); return 1; }
+	};
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7> 
+	struct mem_functor<RVal,T,T1,T2,T3,T4,T5,T6,T7>
+	{
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3,T4,T5,T6,T7)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7),stack_value<T7>::get(L,8))); return 1; }
+	};
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6> 
+	struct mem_functor<RVal,T,T1,T2,T3,T4,T5,T6>
+	{
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3,T4,T5,T6)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7))); return 1; }
+	};
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5> 
+	struct mem_functor<RVal,T,T1,T2,T3,T4,T5>
+	{
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3,T4,T5)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6))); return 1; }
 	};
 
 	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4> 
 	struct mem_functor<RVal,T,T1,T2,T3,T4>
 	{
-		static int invoke(lua_State *L) { push(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3,T4)>(L))(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4),read<T4>(L,5))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3,T4)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5))); return 1; }
 	};
 
 	template<typename RVal, typename T, typename T1, typename T2, typename T3> 
 	struct mem_functor<RVal,T,T1,T2,T3>
 	{
-		static int invoke(lua_State *L) { push(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3)>(L))(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2,T3)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4))); return 1; }
 	};
 
 	template<typename RVal, typename T, typename T1, typename T2> 
 	struct mem_functor<RVal,T,T1, T2>
 	{
-		static int invoke(lua_State *L) { push(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2)>(L))(read<T1>(L,2),read<T2>(L,3))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1,T2)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3))); return 1; }
 	};
 
 	template<typename RVal, typename T, typename T1> 
 	struct mem_functor<RVal,T,T1>
 	{
-		static int invoke(lua_State *L) { push(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1)>(L))(read<T1>(L,2))); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)(T1)>(L))(stack_value<T1>::get(L,2))); return 1; }
 	};
 
 	template<typename RVal, typename T> 
 	struct mem_functor<RVal,T>
 	{
-		static int invoke(lua_State *L) { push(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)()>(L))()); return 1; }
+		static int invoke(lua_State *L) { stack_value<RVal>::put(L,(read<T*>(L,1)->*upvalue_<RVal(T::*)()>(L))()); return 1; }
 	};
 
 	// class member functor (without return value)
+	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+	struct mem_functor<void,T,T1,T2,T3,T4,T5,T6,T7,T8>
+	{
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3,T4,T5,T6,T7,T8)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7),stack_value<T7>::get(L,8),stack_value<T8>::get(L,9)); return 0; }
+	};
+
+	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+	struct mem_functor<void,T,T1,T2,T3,T4,T5,T6,T7>
+	{
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3,T4,T5,T6,T7)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7),stack_value<T7>::get(L,8)); return 0; }
+	};
+
+	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+	struct mem_functor<void,T,T1,T2,T3,T4,T5,T6>
+	{
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3,T4,T5,T6)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7)); return 0; }
+	};
+
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5>
 	struct mem_functor<void,T,T1,T2,T3,T4,T5>
 	{
-		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3,T4,T5)>(L))(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4),read<T4>(L,5),read<T5>(L,6)); return 0; }
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3,T4,T5)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6)); return 0; }
 	};
 
 	template<typename T, typename T1, typename T2, typename T3, typename T4>
 	struct mem_functor<void,T,T1,T2,T3,T4>
 	{
-		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3,T4)>(L))(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4),read<T4>(L,5)); return 0; }
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3,T4)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5)); return 0; }
 	};
 
 	template<typename T, typename T1, typename T2, typename T3>
 	struct mem_functor<void,T,T1,T2,T3>
 	{
-		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3)>(L))(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4)); return 0; }
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2,T3)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4)); return 0; }
 	};
 
 	template<typename T, typename T1, typename T2>
 	struct mem_functor<void,T,T1,T2>
 	{
-		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2)>(L))(read<T1>(L,2),read<T2>(L,3)); return 0; }
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1,T2)>(L))(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3)); return 0; }
 	};
 
 	template<typename T, typename T1>
 	struct mem_functor<void,T,T1>
 	{
-		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1)>(L))(read<T1>(L,2)); return 0; }
+		static int invoke(lua_State *L)  { (read<T*>(L,1)->*upvalue_<void(T::*)(T1)>(L))(stack_value<T1>::get(L,2)); return 0; }
 	};
 
 	template<typename T>
@@ -529,7 +714,7 @@ namespace lua_tinker
 	template<typename T, typename T1> 
 	struct mem_functor<int,T,lua_State*,T1>
 	{
-		static int invoke(lua_State *L) { return (read<T*>(L,1)->*upvalue_<int(T::*)(lua_State*,T1)>(L))(L, read<T1>(L,2)); }
+		static int invoke(lua_State *L) { return (read<T*>(L,1)->*upvalue_<int(T::*)(lua_State*,T1)>(L))(L, stack_value<T1>::get(L,2)); }
 	};
 
 	template<typename T> 
@@ -611,13 +796,75 @@ namespace lua_tinker
 		lua_pushcclosure(L, mem_functor<RVal,T,T1,T2,T3,T4,T5>::invoke, 1); 
 	}
 
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+	void push_functor(lua_State *L, RVal (T::*func)(T1,T2,T3,T4,T5,T6)) 
+	{ 
+		lua_pushcclosure(L, mem_functor<RVal,T,T1,T2,T3,T4,T5,T6>::invoke, 1); 
+	}
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+	void push_functor(lua_State *L, RVal (T::*func)(T1,T2,T3,T4,T5,T6) const) 
+	{ 
+		lua_pushcclosure(L, mem_functor<RVal,T,T1,T2,T3,T4,T5,T6>::invoke, 1); 
+	}
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+	void push_functor(lua_State *L, RVal (T::*func)(T1,T2,T3,T4,T5,T6,T7)) 
+	{ 
+		lua_pushcclosure(L, mem_functor<RVal,T,T1,T2,T3,T4,T5,T6,T7>::invoke, 1); 
+	}
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+	void push_functor(lua_State *L, RVal (T::*func)(T1,T2,T3,T4,T5,T6,T7) const) 
+	{ 
+		lua_pushcclosure(L, mem_functor<RVal,T,T1,T2,T3,T4,T5,T6,T7>::invoke, 1); 
+	}
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+	void push_functor(lua_State *L, RVal (T::*func)(T1,T2,T3,T4,T5,T6,T7,T8)) 
+	{ 
+		lua_pushcclosure(L, mem_functor<RVal,T,T1,T2,T3,T4,T5,T6,T7,T8>::invoke, 1); 
+	}
+
+	template<typename RVal, typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+	void push_functor(lua_State *L, RVal (T::*func)(T1,T2,T3,T4,T5,T6,T7,T8) const) 
+	{ 
+		lua_pushcclosure(L, mem_functor<RVal,T,T1,T2,T3,T4,T5,T6,T7,T8>::invoke, 1); 
+	}
+
 	// constructor
+	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+	int constructor(lua_State *L) 
+	{ 
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7),stack_value<T7>::get(L,8),stack_value<T8>::get(L,9));
+		set_meta<T>(L);
+
+		return 1; 
+	}
+
+	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+	int constructor(lua_State *L) 
+	{ 
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7),stack_value<T7>::get(L,8));
+		set_meta<T>(L);
+
+		return 1; 
+	}
+
+	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+	int constructor(lua_State *L) 
+	{ 
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6),stack_value<T6>::get(L,7));
+		set_meta<T>(L);
+
+		return 1; 
+	}
+
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5>
 	int constructor(lua_State *L) 
 	{ 
-		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4),read<T4>(L,5),read<T5>(L,6));
-		push_meta(L, class_name<typename class_type<T>::type>::name());
-		lua_setmetatable(L, -2);
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5),stack_value<T5>::get(L,6));
+		set_meta<T>(L);
 
 		return 1; 
 	}
@@ -625,9 +872,8 @@ namespace lua_tinker
 	template<typename T, typename T1, typename T2, typename T3, typename T4>
 	int constructor(lua_State *L) 
 	{ 
-		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4),read<T4>(L,5));
-		push_meta(L, class_name<typename class_type<T>::type>::name());
-		lua_setmetatable(L, -2);
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4),stack_value<T4>::get(L,5));
+		set_meta<T>(L);
 
 		return 1; 
 	}
@@ -635,9 +881,8 @@ namespace lua_tinker
 	template<typename T, typename T1, typename T2, typename T3>
 	int constructor(lua_State *L) 
 	{ 
-		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(read<T1>(L,2),read<T2>(L,3),read<T3>(L,4));
-		push_meta(L, class_name<typename class_type<T>::type>::name());
-		lua_setmetatable(L, -2);
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3),stack_value<T3>::get(L,4));
+		set_meta<T>(L);
 
 		return 1; 
 	}
@@ -645,9 +890,8 @@ namespace lua_tinker
 	template<typename T, typename T1, typename T2>
 	int constructor(lua_State *L) 
 	{ 
-		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(read<T1>(L,2),read<T2>(L,3));
-		push_meta(L, class_name<typename class_type<T>::type>::name());
-		lua_setmetatable(L, -2);
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2),stack_value<T2>::get(L,3));
+		set_meta<T>(L);
 
 		return 1; 
 	}
@@ -655,9 +899,8 @@ namespace lua_tinker
 	template<typename T, typename T1>
 	int constructor(lua_State *L) 
 	{ 
-		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(read<T1>(L,2));
-		push_meta(L, class_name<typename class_type<T>::type>::name());
-		lua_setmetatable(L, -2);
+		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>(stack_value<T1>::get(L,2));
+		set_meta<T>(L);
 
 		return 1; 
 	}
@@ -666,8 +909,7 @@ namespace lua_tinker
 	int constructor(lua_State *L) 
 	{ 
 		new(lua_newuserdata(L, sizeof(val2user<T>))) val2user<T>();
-		push_meta(L, class_name<typename class_type<T>::type>::name());
-		lua_setmetatable(L, -2);
+		set_meta<T>(L);
 
 		return 1; 
 	}
@@ -676,7 +918,8 @@ namespace lua_tinker
 	template<typename T>
 	int destroyer(lua_State *L) 
 	{ 
-		((user*)lua_touserdata(L, 1))->~user();
+		user* u = (user*)lua_touserdata(L, 1);
+		if(u->m_destroy) u->m_destroy(u);
 		return 0;
 	}
 
@@ -808,7 +1051,8 @@ namespace lua_tinker
 	// class helper
 	int meta_get(lua_State *L);
 	int meta_set(lua_State *L);
-	void push_meta(lua_State *L, const char* name);
+	void add_meta(lua_State *L, const char* name);
+	void copy_parent(lua_State *L);
 
 	// class init
 	template<typename T>
@@ -835,9 +1079,25 @@ namespace lua_tinker
 		lua_pushcclosure(L, destroyer<T>, 0);
 		lua_rawset(L, -3);
 
+		add_meta(L, class_name<T>::name());
+
 		lua_settable(L, LUA_GLOBALSINDEX);
 	}
 
+	// Tinker Class Pointer Cache : pushing the same pointer again reuses its userdata
+	template<typename T>
+	void class_cache(lua_State* L, bool enable = true)
+	{
+		push_meta(L, class_name<T>::name());
+		if(lua_istable(L, -1))
+		{
+			lua_pushstring(L, "__cache");
+			lua_pushboolean(L, enable);
+			lua_rawset(L, -3);
+		}
+		lua_pop(L, 1);
+	}
+
 	// Tinker Class Inheritence
 	template<typename T, typename P>
 	void class_inh(lua_State* L)
@@ -848,6 +1108,7 @@ namespace lua_tinker
 			lua_pushstring(L, "__parent");
 			push_meta(L, class_name<P>::name());
 			lua_rawset(L, -3);
+			copy_parent(L);
 		}
 		lua_pop(L, 1);
 	}
@@ -900,7 +1161,7 @@ namespace lua_tinker
 	template<typename T>
 	struct class_name
 	{
-		// global name
+		// global name, its address is the registry key of the class table
 		static const char* name(const char* name = NULL)
 		{
 			static char temp[256] = "";
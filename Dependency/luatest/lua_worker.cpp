@@ -0,0 +1,591 @@
+// lua_worker.cpp
+//
+// Pool of lua states for parallel batch jobs.
+
+#include <string.h>
+#include <deque>
+
+extern "C"
+{
+	#include "lua.h"
+	#include "lualib.h"
+	#include "lauxlib.h"
+	#include "lpool.h"
+	#include "lbundle.h"
+};
+
+#include "lua_tinker.h"
+#include "lua_worker.h"
+#include "lua_thread.h"
+
+/*---------------------------------------------------------------------------*/
+/* Packet                                                                    */
+/*---------------------------------------------------------------------------*/
+// value tags, integers and lengths follow as 7 bit varints
+enum
+{
+	PACKET_NIL,
+	PACKET_FALSE,
+	PACKET_TRUE,
+	PACKET_INT,			// zigzag encoded
+	PACKET_NUMBER,		// raw double
+	PACKET_STRING,		// length, bytes
+	PACKET_TABLE,		// key, value pairs up to PACKET_END
+	PACKET_END
+};
+
+// also stops cyclic tables
+#define PACKET_MAX_DEPTH	32
+
+void lua_tinker::packet::write_tag(unsigned char tag)
+{
+	m_data += (char)tag;
+}
+
+void lua_tinker::packet::write_uint(unsigned int value)
+{
+	while(value >= 0x80)
+	{
+		m_data += (char)(value | 0x80);
+		value >>= 7;
+	}
+	m_data += (char)value;
+}
+
+void lua_tinker::packet::write_number(double value)
+{
+	if(value >= -2147483648.0 && value <= 2147483647.0 && (double)(int)value == value)
+	{
+		int i = (int)value;
+		write_tag(PACKET_INT);
+		write_uint(((unsigned int)i << 1) ^ (unsigned int)(i >> 31));
+	}
+	else
+	{
+		write_tag(PACKET_NUMBER);
+		m_data.append((const char*)&value, sizeof(value));
+	}
+}
+
+void lua_tinker::packet::write_string(const char* value, size_t len)
+{
+	write_tag(PACKET_STRING);
+	write_uint((unsigned int)len);
+	m_data.append(value, len);
+}
+
+void lua_tinker::packet::put_nil()					{ write_tag(PACKET_NIL); ++m_count; }
+void lua_tinker::packet::put(bool value)			{ write_tag(value ? PACKET_TRUE : PACKET_FALSE); ++m_count; }
+void lua_tinker::packet::put(int value)				{ write_number(value); ++m_count; }
+void lua_tinker::packet::put(double value)			{ write_number(value); ++m_count; }
+void lua_tinker::packet::put(const char* value)		{ write_string(value, strlen(value)); ++m_count; }
+void lua_tinker::packet::put(const char* value, size_t len)	{ write_string(value, len); ++m_count; }
+
+bool lua_tinker::packet::write_value(lua_State *L, int index, int depth)
+{
+	switch(lua_type(L, index))
+	{
+	case LUA_TNIL:
+		write_tag(PACKET_NIL);
+		return true;
+	case LUA_TBOOLEAN:
+		write_tag(lua_toboolean(L, index) ? PACKET_TRUE : PACKET_FALSE);
+		return true;
+	case LUA_TNUMBER:
+		write_number(lua_tonumber(L, index));
+		return true;
+	case LUA_TSTRING:
+		{
+			size_t len;
+			const char* s = lua_tolstring(L, index, &len);
+			write_string(s, len);
+		}
+		return true;
+	case LUA_TTABLE:
+		if(depth >= PACKET_MAX_DEPTH || !lua_checkstack(L, 3))
+			return false;
+		write_tag(PACKET_TABLE);
+		lua_pushnil(L);
+		while(lua_next(L, index))
+		{
+			int top = lua_gettop(L);
+			if(!write_value(L, top-1, depth+1) || !write_value(L, top, depth+1))
+			{
+				lua_pop(L, 2);
+				return false;
+			}
+			lua_pop(L, 1);
+		}
+		write_tag(PACKET_END);
+		return true;
+	}
+	return false;
+}
+
+bool lua_tinker::packet::pack(lua_State *L, int index, int count)
+{
+	if(index < 0)
+		index = lua_gettop(L) + index + 1;
+
+	size_t size = m_data.size();
+	for(int i=0; i<count; ++i)
+	{
+		if(!write_value(L, index+i, 0))
+		{
+			m_data.resize(size);
+			return false;
+		}
+	}
+	m_count += count;
+	return true;
+}
+
+namespace
+{
+	struct packet_reader
+	{
+		const unsigned char* p;
+		const unsigned char* end;
+
+		bool read_uint(unsigned int* value)
+		{
+			*value = 0;
+			for(int shift=0; shift<35 && p<end; shift+=7)
+			{
+				unsigned char c = *p++;
+				*value |= (unsigned int)(c & 0x7f) << shift;
+				if(!(c & 0x80))
+					return true;
+			}
+			return false;
+		}
+
+		bool read_value(lua_State *L, int depth)
+		{
+			if(p >= end || !lua_checkstack(L, 3))
+				return false;
+
+			unsigned int n;
+			switch(*p++)
+			{
+			case PACKET_NIL:	lua_pushnil(L); return true;
+			case PACKET_FALSE:	lua_pushboolean(L, 0); return true;
+			case PACKET_TRUE:	lua_pushboolean(L, 1); return true;
+			case PACKET_INT:
+				if(!read_uint(&n))
+					return false;
+				lua_pushnumber(L, (int)(n >> 1) ^ -(int)(n & 1));
+				return true;
+			case PACKET_NUMBER:
+				{
+					double d;
+					if(end - p < (int)sizeof(d))
+						return false;
+					memcpy(&d, p, sizeof(d));
+					p += sizeof(d);
+					lua_pushnumber(L, d);
+				}
+				return true;
+			case PACKET_STRING:
+				if(!read_uint(&n) || (unsigned int)(end - p) < n)
+					return false;
+				lua_pushlstring(L, (const char*)p, n);
+				p += n;
+				return true;
+			case PACKET_TABLE:
+				if(depth >= PACKET_MAX_DEPTH)
+					return false;
+				lua_newtable(L);
+				while(p < end && *p != PACKET_END)
+				{
+					if(!read_value(L, depth+1))
+						return false;
+					// nil and NaN keys would raise an error in lua_rawset
+					if(lua_isnil(L, -1) || (lua_isnumber(L, -1) && lua_tonumber(L, -1) != lua_tonumber(L, -1)))
+						return false;
+					if(!read_value(L, depth+1))
+						return false;
+					lua_rawset(L, -3);
+				}
+				if(p >= end)
+					return false;
+				++p;
+				return true;
+			}
+			return false;
+		}
+	};
+}
+
+bool lua_tinker::packet::unpack(lua_State *L) const
+{
+	int top = lua_gettop(L);
+	packet_reader r;
+	r.p = (const unsigned char*)m_data.data();
+	r.end = r.p + m_data.size();
+	for(int i=0; i<m_count; ++i)
+	{
+		if(!r.read_value(L, 0))
+		{
+			lua_settop(L, top);
+			return false;
+		}
+	}
+	if(r.p != r.end)
+	{
+		lua_settop(L, top);
+		return false;
+	}
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Worker Pool                                                               */
+/*---------------------------------------------------------------------------*/
+namespace
+{
+	struct worker_job
+	{
+		std::string				func;
+		lua_tinker::packet		args;
+		lua_tinker::packet		result;
+		std::string				error;
+		bool					failed;
+	};
+
+	struct worker
+	{
+		lua_tinker::worker_pool::impl*	pool;
+		int						index;
+		lua_State*				L;
+		lua_tinker::thread_handle	thread;
+		bool					started;
+		lua_tinker::thread_lock	lock;		// guards queue
+		std::deque<worker_job*>	queue;
+	};
+}
+
+struct lua_tinker::worker_pool::impl
+{
+	std::vector<worker*>		workers;
+	std::vector<worker_job*>	jobs;		// only touched by the submitting thread
+	unsigned int				next;		// queue of the next job
+	bool						waited;		// a new submit starts a new batch
+
+	lua_tinker::thread_lock		lock;		// guards the fields below
+	lua_tinker::thread_cond		work;		// jobs were queued, or stopping
+	lua_tinker::thread_cond		done;		// the batch is finished
+	lua_tinker::thread_counter	queued;		// jobs in all queues, also changed outside the lock
+	int							submitted;
+	int							finished;
+	bool						stopping;
+};
+
+static worker_job* take_job(worker* w)
+{
+	worker_job* job = NULL;
+	std::vector<worker*>& workers = w->pool->workers;
+
+	// own jobs newest first, they are the most likely to be warm
+	lua_tinker::lock_enter(&w->lock);
+	if(!w->queue.empty())
+	{
+		job = w->queue.back();
+		w->queue.pop_back();
+	}
+	lua_tinker::lock_leave(&w->lock);
+
+	// then the oldest job of the others
+	for(size_t i=1; job == NULL && i<workers.size(); ++i)
+	{
+		worker* victim = workers[(w->index + i) % workers.size()];
+		lua_tinker::lock_enter(&victim->lock);
+		if(!victim->queue.empty())
+		{
+			job = victim->queue.front();
+			victim->queue.pop_front();
+		}
+		lua_tinker::lock_leave(&victim->lock);
+	}
+
+	if(job)
+		lua_tinker::counter_sub(&w->pool->queued);
+	return job;
+}
+
+static int on_job_error(lua_State *L)
+{
+	lua_getfield(L, LUA_GLOBALSINDEX, "debug");
+	if(lua_istable(L, -1))
+	{
+		lua_getfield(L, -1, "traceback");
+		if(lua_isfunction(L, -1))
+		{
+			lua_pushvalue(L, 1);
+			lua_pushinteger(L, 2);
+			lua_call(L, 2, 1);
+			return 1;
+		}
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+// pushes a global function, looked up through tables for "a.b.c"
+static bool push_job_func(lua_State *L, const char* name)
+{
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+	for(;;)
+	{
+		const char* dot = strchr(name, '.');
+		if(!lua_istable(L, -1))
+			return false;
+		lua_pushlstring(L, name, dot ? dot - name : strlen(name));
+		lua_gettable(L, -2);
+		lua_remove(L, -2);
+		if(dot == NULL)
+			break;
+		name = dot + 1;
+	}
+	return lua_isfunction(L, -1) != 0;
+}
+
+static void run_job(lua_State *L, worker_job* job)
+{
+	lua_settop(L, 0);
+	lua_pushcfunction(L, on_job_error);
+
+	job->failed = true;
+	if(!push_job_func(L, job->func.c_str()))
+	{
+		job->error = "attempt to call `" + job->func + "' (not a function)";
+	}
+	else if(!job->args.unpack(L))
+	{
+		job->error = "corrupt arguments for `" + job->func + "'";
+	}
+	else if(lua_pcall(L, job->args.count(), LUA_MULTRET, 1) != 0)
+	{
+		const char* msg = lua_tostring(L, -1);
+		job->error = msg ? msg : "(error object is not a string)";
+	}
+	else if(!job->result.pack(L, 2, lua_gettop(L) - 1))
+	{
+		job->error = "results of `" + job->func + "' can not be packed";
+	}
+	else
+	{
+		job->failed = false;
+	}
+
+	lua_settop(L, 0);
+}
+
+static void worker_proc(void* param)
+{
+	worker* w = (worker*)param;
+	lua_tinker::worker_pool::impl* p = w->pool;
+
+	for(;;)
+	{
+		worker_job* job = take_job(w);
+		if(job == NULL)
+		{
+			lua_tinker::lock_enter(&p->lock);
+			while(lua_tinker::counter_get(&p->queued) == 0 && !p->stopping)
+				lua_tinker::cond_wait(&p->work, &p->lock);
+			bool quit = p->stopping;
+			lua_tinker::lock_leave(&p->lock);
+			if(quit)
+				break;
+			continue;
+		}
+
+		run_job(w->L, job);
+
+		lua_tinker::lock_enter(&p->lock);
+		if(++p->finished == p->submitted)
+			lua_tinker::cond_broadcast(&p->done);
+		lua_tinker::lock_leave(&p->lock);
+	}
+}
+
+lua_tinker::worker_pool::worker_pool()
+{
+	m_impl = new impl;
+	m_impl->next = 0;
+	m_impl->waited = false;
+	m_impl->queued = 0;
+	m_impl->submitted = 0;
+	m_impl->finished = 0;
+	m_impl->stopping = false;
+	lock_init(&m_impl->lock);
+	cond_init(&m_impl->work);
+	cond_init(&m_impl->done);
+}
+
+lua_tinker::worker_pool::~worker_pool()
+{
+	stop();
+	cond_free(&m_impl->done);
+	cond_free(&m_impl->work);
+	lock_free(&m_impl->lock);
+	delete m_impl;
+}
+
+bool lua_tinker::worker_pool::start(int workers, init_func init, void* ud, const char* bundle)
+{
+	if(!m_impl->workers.empty())
+		return false;
+
+	if(workers <= 0)
+		workers = core_count();
+	if(workers <= 0)
+		workers = 1;
+
+	// states are set up one by one on this thread, init does not need to be thread safe
+	for(int i=0; i<workers; ++i)
+	{
+		lua_State* L = luaL_newpoolstate();
+		if(L == NULL)
+		{
+			stop();
+			return false;
+		}
+
+		luaL_openlibs(L);
+		if(bundle && luaL_openbundle(L, bundle) != 0)
+		{
+			print_error(L, "%s", lua_tostring(L, -1));
+			lua_close(L);
+			stop();
+			return false;
+		}
+		if(init)
+			init(L, ud);
+		lua_settop(L, 0);
+
+		worker* w = new worker;
+		w->pool = m_impl;
+		w->index = i;
+		w->L = L;
+		w->started = false;
+		lock_init(&w->lock);
+		m_impl->workers.push_back(w);
+	}
+
+	m_impl->stopping = false;
+	for(size_t i=0; i<m_impl->workers.size(); ++i)
+	{
+		if(!thread_start(&m_impl->workers[i]->thread, worker_proc, m_impl->workers[i]))
+		{
+			stop();
+			return false;
+		}
+		m_impl->workers[i]->started = true;
+	}
+	return true;
+}
+
+void lua_tinker::worker_pool::stop()
+{
+	impl* p = m_impl;
+	if(p->workers.empty())
+		return;
+
+	wait();
+
+	lock_enter(&p->lock);
+	p->stopping = true;
+	cond_broadcast(&p->work);
+	lock_leave(&p->lock);
+
+	// all threads first, idle workers still look into the others' queues
+	for(size_t i=0; i<p->workers.size(); ++i)
+	{
+		if(p->workers[i]->started)
+			thread_join(&p->workers[i]->thread);
+	}
+
+	for(size_t i=0; i<p->workers.size(); ++i)
+	{
+		worker* w = p->workers[i];
+		lua_close(w->L);
+		lock_free(&w->lock);
+		delete w;
+	}
+	p->workers.clear();
+
+	for(size_t i=0; i<p->jobs.size(); ++i)
+		delete p->jobs[i];
+	p->jobs.clear();
+	p->submitted = p->finished = 0;
+	p->waited = false;
+}
+
+int lua_tinker::worker_pool::workers() const
+{
+	return (int)m_impl->workers.size();
+}
+
+int lua_tinker::worker_pool::submit(const char* func, const packet& args)
+{
+	impl* p = m_impl;
+	if(p->workers.empty())
+		return -1;
+
+	if(p->waited)
+	{
+		// previous batch is done and collected
+		for(size_t i=0; i<p->jobs.size(); ++i)
+			delete p->jobs[i];
+		p->jobs.clear();
+		p->submitted = p->finished = 0;
+		p->waited = false;
+	}
+
+	worker_job* job = new worker_job;
+	job->func = func;
+	job->args = args;
+	job->failed = false;
+	p->jobs.push_back(job);
+
+	worker* w = p->workers[p->next++ % p->workers.size()];
+	lock_enter(&w->lock);
+	w->queue.push_back(job);
+	lock_leave(&w->lock);
+
+	lock_enter(&p->lock);
+	++p->submitted;
+	counter_add(&p->queued);
+	cond_signal(&p->work);
+	lock_leave(&p->lock);
+
+	return (int)p->jobs.size() - 1;
+}
+
+void lua_tinker::worker_pool::wait()
+{
+	impl* p = m_impl;
+	lock_enter(&p->lock);
+	while(p->finished != p->submitted)
+		cond_wait(&p->done, &p->lock);
+	lock_leave(&p->lock);
+	p->waited = true;
+}
+
+const lua_tinker::packet& lua_tinker::worker_pool::result(int job) const
+{
+	return m_impl->jobs[job]->result;
+}
+
+const char* lua_tinker::worker_pool::error(int job) const
+{
+	worker_job* j = m_impl->jobs[job];
+	return j->failed ? j->error.c_str() : NULL;
+}
+
+int lua_tinker::worker_pool::jobs() const
+{
+	return (int)m_impl->jobs.size();
+}
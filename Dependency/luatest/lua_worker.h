@@ -0,0 +1,93 @@
+// lua_worker.h
+//
+// Pool of lua states for parallel batch jobs.
+//
+// Each worker thread owns its own lua state, created by the pool with the same
+// LuaTinker bindings and script bundle, so no state is ever shared between threads.
+// A job names a global lua function ("validate" or "npc.validate") and carries its
+// arguments in a packet; the values it returns come back in another packet.
+//
+// Jobs are spread over per-worker queues. A worker runs its own jobs newest first
+// and, when its queue is empty, steals the oldest job of another worker.
+
+#if !defined(_LUA_WORKER_H_)
+#define _LUA_WORKER_H_
+
+#include <string>
+#include <vector>
+
+namespace lua_tinker
+{
+	// lua values serialized for another state : nil, boolean, number, string and
+	// tables of those. functions, userdata, threads and cycles can not be packed.
+	class packet
+	{
+	public:
+		packet() : m_count(0) {}
+
+		void	clear() { m_data.clear(); m_count = 0; }
+		int		count() const { return m_count; }
+		size_t	size() const { return m_data.size(); }
+
+		// appends values, from C++ or from lua stack [index, index+count)
+		void	put_nil();
+		void	put(bool value);
+		void	put(int value);
+		void	put(double value);
+		void	put(const char* value);
+		void	put(const char* value, size_t len);
+		bool	pack(lua_State *L, int index, int count);
+
+		// pushes all values on L, returns false if the packet is corrupt
+		bool	unpack(lua_State *L) const;
+
+	private:
+		void	write_tag(unsigned char tag);
+		void	write_uint(unsigned int value);
+		void	write_number(double value);
+		void	write_string(const char* value, size_t len);
+		bool	write_value(lua_State *L, int index, int depth);
+
+		std::string	m_data;
+		int			m_count;
+	};
+
+	class worker_pool
+	{
+	public:
+		// called once per worker state, on the thread calling start(), to bind
+		// classes and functions and to load scripts
+		typedef void (*init_func)(lua_State *L, void* ud);
+
+		worker_pool();
+		~worker_pool();
+
+		// workers <= 0 uses one worker per core. bundle, if not NULL, is opened
+		// with luaL_openbundle in every state before init runs.
+		bool	start(int workers, init_func init, void* ud = NULL, const char* bundle = NULL);
+		void	stop();
+		int		workers() const;
+
+		// queues a job and returns its id, ids count from 0 for every batch
+		int		submit(const char* func, const packet& args);
+
+		// blocks until all submitted jobs are done
+		void	wait();
+
+		// results of a finished batch, valid until the next submit after wait()
+		const packet&	result(int job) const;
+		const char*		error(int job) const;	// NULL if the job succeeded
+		int				jobs() const;
+
+		struct impl;
+
+	private:
+		worker_pool(const worker_pool&);
+		worker_pool& operator=(const worker_pool&);
+
+		impl*	m_impl;
+	};
+
+} // namespace lua_tinker
+
+#endif //_LUA_WORKER_H_
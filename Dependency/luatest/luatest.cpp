@@ -1,5 +1,15 @@
 #include "luatest.h"
 #include "lua_tinker.h"
+#include "lua_worker.h"
+#include "lua_asset.h"
+#include "lua_thread.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
 
 void test1(lua_State* L);
 void test2(lua_State* L);
@@ -7,10 +17,14 @@ void test3(lua_State* L);
 void test4(lua_State* L);
 void test5(lua_State* L);
 void test6(lua_State* L);
+void test7(lua_State* L, const char* data);
+void test8(lua_State* L);
+void test9(lua_State* L);
+void test10(lua_State* L);
 
-int main()
+int main(int /*argc*/, char* /*argv*/[])
 {
-	lua_State* L = lua_open();
+	lua_State* L = luaL_newpoolstate();
 
 	luaopen_base(L);
 
@@ -21,6 +35,11 @@ int main()
 	test3(L);
 	//test4(L);
 	//test5(L);
+	//test6(L);
+	//test7(L, argc > 1 ? argv[1] : NULL);
+	//test8(L);
+	//test9(L);
+	//test10(L);
 
 	lua_close(L);
 
@@ -179,4 +198,366 @@ void test5(lua_State* L)
 
 	printf("%s\n","-------------------------- calling test_error()");
 	lua_tinker::call<void>(L, "test_error");
-}
\ No newline at end of file
+}
+
+//test6
+
+double elapsed_ms()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER f, c;
+	QueryPerformanceFrequency(&f);
+	QueryPerformanceCounter(&c);
+	return (double)c.QuadPart * 1000.0 / (double)f.QuadPart;
+#else
+	struct timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec * 1000.0 + t.tv_usec / 1000.0;
+#endif
+}
+
+int npc_checksum(const char* name, int seed)
+{
+	unsigned int h = (unsigned int)seed;
+	while(*name)
+		h = h * 16777619 ^ (unsigned char)*name++;
+	return (int)(h & 0x7fffffff);
+}
+
+void bind_npc(lua_State* L, void* /*ud*/)
+{
+	lua_tinker::def(L, "npc_checksum", npc_checksum);
+
+	lua_tinker::dofile(L, "sample6.lua");
+}
+
+void test6(lua_State* L)
+{
+	const int rows = 2000;
+
+	int cores = lua_tinker::core_count();
+
+	double base = 0;
+	for(int workers = 1; workers <= cores; workers *= 2)
+	{
+		lua_tinker::worker_pool pool;
+		if(!pool.start(workers, bind_npc))
+			break;
+
+		double start = elapsed_ms();
+		for(int i = 0; i < rows; ++i)
+		{
+			char name[32];
+			sprintf(name, "npc_%d", i);
+
+			lua_tinker::packet args;
+			args.put(i);
+			args.put(name);
+			args.put(i % 120);
+			args.put(100.0 + i);
+			pool.submit("validate_npc", args);
+		}
+		pool.wait();
+		double time = elapsed_ms() - start;
+		if(workers == 1)
+			base = time;
+
+		// results come back into this state
+		int failed = 0, invalid = 0;
+		for(int i = 0; i < pool.jobs(); ++i)
+		{
+			if(pool.error(i))
+			{
+				printf("job %d : %s\n", i, pool.error(i));
+				++failed;
+				continue;
+			}
+			pool.result(i).unpack(L);
+			lua_tinker::table row = lua_tinker::pop<lua_tinker::table>(L);
+			if(!row.get<bool>("ok"))
+				++invalid;
+		}
+
+		printf("%d workers : %d rows in %.1f ms, x%.2f (%d failed, %d invalid)\n",
+			workers, rows, time, base / time, failed, invalid);
+	}
+}
+
+//test7
+
+void sleep_ms(int ms)
+{
+#if defined(_WIN32)
+	Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+// runs frames until the map is loaded, returns the worst frame
+double run_frames(lua_State* L, bool async, int* frames)
+{
+	double worst = 0;
+	for(*frames = 0; ; ++*frames)
+	{
+		double start = elapsed_ms();
+		if(*frames == 0)
+		{
+			if(async)
+				lua_tinker::call<void>(L, "start_map_load", "Azeroth", 30, 35);
+			else
+			{
+				lua_tinker::set(L, "map_chunks", lua_tinker::call<int>(L, "load_map", "Azeroth", 30, 35));
+				lua_tinker::set(L, "map_loaded", true);
+			}
+		}
+		lua_tinker::asset_update(L);
+		double time = elapsed_ms() - start;
+		if(time > worst)
+			worst = time;
+
+		if(lua_tinker::get<bool>(L, "map_loaded"))
+			break;
+		sleep_ms(1);
+	}
+	return worst;
+}
+
+// data is the game's Data directory on windows, read as CASC storage, elsewhere a
+// directory holding the extracted files
+void test7(lua_State* L, const char* data)
+{
+	if(data == NULL)
+	{
+		printf("test7 : pass the data directory as the first argument\n");
+		return;
+	}
+
+	luaopen_table(L);
+	luaopen_math(L);
+
+#if defined(_WIN32)
+	lua_tinker::asset_reader_func reader = lua_tinker::casc_reader;
+#else
+	lua_tinker::asset_reader_func reader = lua_tinker::file_reader;
+#endif
+	if(!lua_tinker::asset_open(L, reader, (void*)data, 2))
+		return;
+
+	lua_tinker::dofile(L, "sample7.lua");
+
+	int frames;
+	double worst = run_frames(L, false, &frames);
+	printf("load_map       : worst frame %.1f ms, %d frames, %d chunks\n", worst, frames + 1, lua_tinker::get<int>(L, "map_chunks"));
+
+	worst = run_frames(L, true, &frames);
+	printf("start_map_load : worst frame %.1f ms, %d frames, %d chunks\n", worst, frames + 1, lua_tinker::get<int>(L, "map_chunks"));
+}
+
+//test8
+
+void test8(lua_State* /*L*/)
+{
+	const int models = 300000;
+	const int frame = 5000;
+
+	// a fresh state for each run, so both start with an empty string table
+	for(int reserve = 0; reserve <= 1; ++reserve)
+	{
+		lua_State* S = luaL_newpoolstate();
+		luaopen_base(S);
+		luaopen_string(S);
+		lua_tinker::dofile(S, "sample8.lua");
+
+		if(reserve)
+			lua_gc(S, LUA_GCRESERVESTR, models);
+
+		// one batch of models per frame, the worst frame shows string table resizes
+		double worst = 0;
+		double start = elapsed_ms();
+		for(int first = 1; first <= models; first += frame)
+		{
+			double time = elapsed_ms();
+			lua_tinker::call<void>(S, "index_models", first, first + frame - 1);
+			time = elapsed_ms() - time;
+			if(time > worst)
+				worst = time;
+		}
+		double build = elapsed_ms() - start;
+
+		start = elapsed_ms();
+		int found = lua_tinker::call<int>(S, "find_models", models);
+		double find = elapsed_ms() - start;
+
+		start = elapsed_ms();
+		lua_gc(S, LUA_GCCOLLECT, 0);
+		double collect = elapsed_ms() - start;
+
+		printf("%s : index %.1f ms (worst frame %.2f ms), find %.1f ms (%d found), full gc %.1f ms\n",
+			reserve ? "reserved" : "growing ", build, worst, find, found, collect);
+
+		lua_close(S);
+	}
+}
+
+//test9
+
+struct unit_base
+{
+	unit_base() : id(1) {}
+
+	int get_id() { return id; }
+
+	int id;
+};
+
+struct unit : public unit_base
+{
+	unit() : x(2.0f) {}
+
+	float get_x() { return x; }
+
+	float x;
+};
+
+struct creature : public unit
+{
+	creature() : flags(3) {}
+
+	int get_flags() { return flags; }
+	void set_flags(int f) { flags = f; }
+
+	int flags;
+};
+
+creature g_creatures[1024];
+
+creature* get_creature(int i)
+{
+	return &g_creatures[i & 1023];
+}
+
+long long get_guid(int i)
+{
+	return (long long)i << 33;
+}
+
+// calls and field accesses through lua_tinker, inherited members come from two levels up
+void test9(lua_State* L)
+{
+	const int count = 2000000;
+	const char* loops[] = { "push_objects", "own_call", "inherited_call", "own_field", "inherited_field", "field_write", "push_int64" };
+
+	lua_tinker::class_add<unit_base>(L, "unit_base");
+	lua_tinker::class_def<unit_base>(L, "get_id", &unit_base::get_id);
+	lua_tinker::class_mem<unit_base>(L, "id", &unit_base::id);
+
+	lua_tinker::class_add<unit>(L, "unit");
+	lua_tinker::class_inh<unit, unit_base>(L);
+	lua_tinker::class_def<unit>(L, "get_x", &unit::get_x);
+	lua_tinker::class_mem<unit>(L, "x", &unit::x);
+
+	lua_tinker::class_add<creature>(L, "creature");
+	lua_tinker::class_inh<creature, unit>(L);
+	lua_tinker::class_def<creature>(L, "get_flags", &creature::get_flags);
+	lua_tinker::class_def<creature>(L, "set_flags", &creature::set_flags);
+	lua_tinker::class_mem<creature>(L, "flags", &creature::flags);
+
+	lua_tinker::def(L, "get_creature", get_creature);
+	lua_tinker::def(L, "get_guid", get_guid);
+	lua_tinker::set(L, "creature_0", &g_creatures[0]);
+
+	lua_tinker::dofile(L, "sample9.lua");
+
+	// best of 3 runs, timings vary a lot between runs
+	for(int i = 0; i < (int)(sizeof(loops) / sizeof(loops[0])); ++i)
+	{
+		double best = 0;
+		for(int run = 0; run < 3; ++run)
+		{
+			double start = elapsed_ms();
+			lua_tinker::call<int>(L, loops[i], count);
+			double time = elapsed_ms() - start;
+			if(run == 0 || time < best)
+				best = time;
+		}
+		printf("%-15s : %.2f million/s\n", loops[i], count / best / 1000.0);
+	}
+	g_creatures[0].flags = 3;
+}
+
+//test10
+
+lua_State* new_state(bool pool)
+{
+	lua_State* S = pool ? luaL_newpoolstate() : lua_open();
+	luaopen_base(S);
+	luaopen_string(S);
+	return S;
+}
+
+// the same runs on a plain malloc state and on the pooled allocator, then on the pool with
+// a collector budget spent after every frame instead of the automatic steps
+void test10(lua_State* /*L*/)
+{
+	const int states = 300;
+	const int frames = 1000;
+	const int entities = 500;
+
+	// short lived states, each loads a sample script and indexes a few models
+	for(int pool = 0; pool <= 1; ++pool)
+	{
+		double best = 0;
+		for(int run = 0; run < 3; ++run)
+		{
+			double start = elapsed_ms();
+			for(int i = 0; i < states; ++i)
+			{
+				lua_State* S = new_state(pool != 0);
+				lua_tinker::dofile(S, "sample8.lua");
+				lua_tinker::call<void>(S, "index_models", 1, 200);
+				lua_close(S);
+			}
+			double time = elapsed_ms() - start;
+			if(run == 0 || time < best)
+				best = time;
+		}
+		printf("%s : %.1f us per sample state\n", pool ? "pool  " : "malloc", best * 1000.0 / states);
+	}
+
+	// table churn, the worst frame shows the collector pauses
+	for(int run = 0; run < 3; ++run)
+	{
+		lua_State* S = new_state(run > 0);
+		lua_tinker::dofile(S, "sample10.lua");
+
+		const int budget = run == 2 ? 1000 : 0;
+		if(budget)
+			lua_gc(S, LUA_GCSETPAUSE, 400);
+
+		double worst = 0;
+		double start = elapsed_ms();
+		for(int i = 0; i < frames; ++i)
+		{
+			double time = elapsed_ms();
+			lua_tinker::call<double>(S, "frame", entities);
+			if(budget)
+				luaL_gcbudget(S, budget);
+			time = elapsed_ms() - time;
+			if(time > worst)
+				worst = time;
+		}
+		double total = elapsed_ms() - start;
+
+		printf("%s : %d frames in %.1f ms, worst frame %.2f ms, %d KB live",
+			run == 0 ? "malloc" : run == 1 ? "pool  " : "budget", frames, total, worst, lua_gc(S, LUA_GCCOUNT, 0));
+
+		luaL_PoolStats stats;
+		if(luaL_poolstats(S, &stats))
+			printf(", %u KB arenas, %u pooled, %u malloc blocks",
+				(unsigned)(stats.arena / 1024), (unsigned)stats.npooled, (unsigned)stats.nlarge);
+		printf("\n");
+
+		lua_close(S);
+	}
+}
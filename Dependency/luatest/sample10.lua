@@ -0,0 +1,21 @@
+-- allocator sample, a frame of short-lived tables, closures and strings
+
+-- the last 5000 entities stay alive across frames
+ring = {}
+ring_index = 0
+
+function frame(n)
+	local acc = 0
+	for i = 1, n do
+		local t = { x = i, y = i * 2, name = "e" .. (i % 97) }
+		local f = function() return t.x + t.y end
+		acc = acc + f() + #t.name
+
+		ring_index = ring_index + 1
+		if ring_index > 5000 then
+			ring_index = 1
+		end
+		ring[ring_index] = { t, { i } }
+	end
+	return acc
+end
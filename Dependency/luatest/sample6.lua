@@ -0,0 +1,15 @@
+-- worker pool sample, run by every worker state
+
+-- checks one npc row, the loop stands in for real validation work
+function validate_npc(id, name, level, hp)
+	local h = 0
+	for i = 1, 20000 do
+		h = (h * 31 + id + i) % 1000003
+	end
+
+	local row = {}
+	row.id = id
+	row.ok = level >= 1 and level <= 100 and hp > 0
+	row.checksum = npc_checksum(name, h)
+	return row
+end
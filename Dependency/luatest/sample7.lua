@@ -0,0 +1,55 @@
+-- asset sample, loads the tiles of a map the way the editor does
+
+-- wdt and adt names of the tiles [first, last] on both axes
+function map_files(map, first, last)
+	local files = { "World\\Maps\\" .. map .. "\\" .. map .. ".wdt" }
+	for x = first, last do
+		for y = first, last do
+			files[#files + 1] = string.format("World\\Maps\\%s\\%s_%d_%d.adt", map, map, x, y)
+		end
+	end
+	return files
+end
+
+-- walks the chunks of a file, stands in for real parsing
+local function count_chunks(data)
+	local chunks = 0
+	local pos = 1
+	while pos + 8 <= #data do
+		pos = pos + 8 + data:u32(pos + 4)
+		chunks = chunks + 1
+	end
+	return chunks
+end
+
+-- reads the map 16 files at a time, returns the number of chunks
+function load_map(map, first, last)
+	local files = map_files(map, first, last)
+	local chunks = 0
+	for i = 1, #files, 16 do
+		local batch = {}
+		for j = i, math.min(i + 15, #files) do
+			batch[#batch + 1] = files[j]
+		end
+
+		local list, errors = asset.read_many(batch)
+		for j = 1, #batch do
+			if list[j] then
+				chunks = chunks + count_chunks(list[j])
+			else
+				print(errors[j])
+			end
+		end
+	end
+	return chunks
+end
+
+-- same load in a coroutine, map_loaded is set when it is done
+function start_map_load(map, first, last)
+	map_loaded = false
+	local co = coroutine.create(function()
+		map_chunks = load_map(map, first, last)
+		map_loaded = true
+	end)
+	assert(coroutine.resume(co))
+end
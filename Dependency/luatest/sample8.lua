@@ -0,0 +1,33 @@
+-- string table sample, indexes model paths the way the model browser does
+
+-- model path -> model number
+models = {}
+
+local races = { "Human", "Orc", "Dwarf", "NightElf", "Scourge", "Tauren", "Gnome", "Troll", "BloodElf", "Draenei" }
+
+-- path of the i-th model, paths share long prefixes and differ in a few chars
+function model_path(i)
+	local race = races[i % #races + 1]
+	local gender = (i % 2 == 0) and "Male" or "Female"
+	return string.format("Character\\%s\\%s\\%s%s_%06d.m2", race, gender, race, gender, i)
+end
+
+-- adds models [first, last] to the index
+function index_models(first, last)
+	local index = models
+	for i = first, last do
+		index[model_path(i)] = i
+	end
+end
+
+-- looks every model up again, returns how many were found
+function find_models(count)
+	local index = models
+	local found = 0
+	for i = 1, count do
+		if index[model_path(i)] == i then
+			found = found + 1
+		end
+	end
+	return found
+end
@@ -0,0 +1,67 @@
+-- lua_tinker call sample, hot loops over a bound class hierarchy
+
+-- get_creature() pushes a C++ object each time
+function push_objects(n)
+	local count = 0
+	for i = 1, n do
+		local c = get_creature(i)
+		count = count + 1
+	end
+	return count
+end
+
+-- method of creature itself
+function own_call(n)
+	local c = creature_0
+	local sum = 0
+	for i = 1, n do
+		sum = sum + c:get_flags()
+	end
+	return sum
+end
+
+-- method inherited from unit_base, two levels up
+function inherited_call(n)
+	local c = creature_0
+	local sum = 0
+	for i = 1, n do
+		sum = sum + c:get_id()
+	end
+	return sum
+end
+
+function own_field(n)
+	local c = creature_0
+	local sum = 0
+	for i = 1, n do
+		sum = sum + c.flags
+	end
+	return sum
+end
+
+function inherited_field(n)
+	local c = creature_0
+	local sum = 0
+	for i = 1, n do
+		sum = sum + c.id
+	end
+	return sum
+end
+
+function field_write(n)
+	local c = creature_0
+	for i = 1, n do
+		c.flags = i
+	end
+	return n
+end
+
+-- 64-bit values are bound objects too
+function push_int64(n)
+	local count = 0
+	for i = 1, n do
+		local v = get_guid(i)
+		count = count + 1
+	end
+	return count
+end
@@ -18,6 +18,12 @@
 #include "StormCommon.h"
 #include "FileStream.h"
 
+#ifndef PLATFORM_WINDOWS
+#include <sys/socket.h>                         // Sockets for the HTTP stream
+#include <netinet/in.h>
+#include <netdb.h>
+#endif
+
 #ifdef _MSC_VER
 #pragma comment(lib, "wininet.lib")             // Internet functions for HTTP stream
 #pragma warning(disable: 4800)                  // 'BOOL' : forcing value to bool 'true' or 'false' (performance warning)
@@ -30,11 +36,18 @@
 #define INVALID_HANDLE_VALUE ((HANDLE)-1)
 #endif
 
+#define STREAM_CACHE_MIN_WINDOW     0x00004000  // Initial size of the readahead window (16 KB)
+#define STREAM_CACHE_MAX_WINDOW     0x00040000  // Maximum size of the readahead window (256 KB)
+
+#define SPARSE_DEFAULT_BLOCK_SIZE   0x00004000  // Default size of one block of a sparse file (16 KB)
+#define SPARSE_MAX_FETCH_SIZE       0x00100000  // Maximum number of bytes fetched by one request (1 MB)
+#define SPARSE_DATA_ALIGNMENT       0x00001000  // Alignment of the first block in a sparse file
+
 //-----------------------------------------------------------------------------
 // Local functions - platform-specific functions
 
 #ifndef PLATFORM_WINDOWS
-static int nLastError = ERROR_SUCCESS;
+static __thread int nLastError = ERROR_SUCCESS;    // Per-thread, same like GetLastError on Windows
 
 int GetLastError()
 {
@@ -123,13 +136,14 @@ static bool Dummy_GetBitmap(
 //-----------------------------------------------------------------------------
 // Local functions - base file support
 
-static bool BaseFile_Read(
+// Reads data from the given file offset, bypassing the readahead cache
+static bool BaseFile_ReadRaw(
     TFileStream * pStream,                  // Pointer to an open stream
-    ULONGLONG * pByteOffset,                // Pointer to file byte offset. If NULL, it reads from the current position
+    ULONGLONG ByteOffset,                   // File byte offset
     void * pvBuffer,                        // Pointer to data to be read
-    DWORD dwBytesToRead)                    // Number of bytes to read from the file
+    DWORD dwBytesToRead,                    // Number of bytes to read from the file
+    LPDWORD pdwBytesRead)                   // Receives number of bytes read
 {
-    ULONGLONG ByteOffset = (pByteOffset != NULL) ? *pByteOffset : pStream->Base.File.FilePos;
     DWORD dwBytesRead = 0;                  // Must be set by platform-specific code
 
 #ifdef PLATFORM_WINDOWS
@@ -138,11 +152,6 @@ static bool BaseFile_Read(
         // Thus, we can use the OVERLAPPED structure to specify
         // file offset to read from file. This allows us to skip
         // one system call to SetFilePointer
-
-        // Update the byte offset
-        pStream->Base.File.FilePos = ByteOffset;
-
-        // Read the data
         if(dwBytesToRead != 0)
         {
             OVERLAPPED Overlapped;
@@ -153,24 +162,6 @@ static bool BaseFile_Read(
             if(!ReadFile(pStream->Base.File.hFile, pvBuffer, dwBytesToRead, &dwBytesRead, &Overlapped))
                 return false;
         }
-/*
-        // If the byte offset is different from the current file position,
-        // we have to update the file position
-        if(ByteOffset != pStream->Base.File.FilePos)
-        {
-            LONG ByteOffsetHi = (LONG)(ByteOffset >> 32);
-
-            SetFilePointer(pStream->Base.File.hFile, (LONG)ByteOffset, &ByteOffsetHi, FILE_BEGIN);
-            pStream->Base.File.FilePos = ByteOffset;
-        }
-
-        // Read the data
-        if(dwBytesToRead != 0)
-        {
-            if(!ReadFile(pStream->Base.File.hFile, pvBuffer, dwBytesToRead, &dwBytesRead, NULL))
-                return false;
-        }
-*/
     }
 #endif
 
@@ -178,18 +169,11 @@ static bool BaseFile_Read(
     {
         ssize_t bytes_read;
 
-        // If the byte offset is different from the current file position,
-        // we have to update the file position
-        if(ByteOffset != pStream->Base.File.FilePos)
-        {
-            lseek((intptr_t)pStream->Base.File.hFile, (off_t)(ByteOffset), SEEK_SET);
-            pStream->Base.File.FilePos = ByteOffset;
-        }
-
-        // Perform the read operation
+        // Use pread, so we don't need to call lseek before each read
+        // and we don't need to keep the file pointer in sync with the stream position
         if(dwBytesToRead != 0)
         {
-            bytes_read = read((intptr_t)pStream->Base.File.hFile, pvBuffer, (size_t)dwBytesToRead);
+            bytes_read = pread((intptr_t)pStream->Base.File.hFile, pvBuffer, (size_t)dwBytesToRead, (off_t)ByteOffset);
             if(bytes_read == -1)
             {
                 nLastError = errno;
@@ -201,6 +185,111 @@ static bool BaseFile_Read(
     }
 #endif
 
+    // Update the statistics
+    if(dwBytesToRead != 0)
+    {
+        pStream->Stats.ReadCalls++;
+        pStream->Stats.BytesRead += dwBytesRead;
+    }
+
+    *pdwBytesRead = dwBytesRead;
+    return true;
+}
+
+// Reads data from the file. Small reads that follow each other (with possible
+// gaps up to the readahead window size) are served from a readahead cache.
+// The window doubles with every sequential read that misses the cache,
+// and is reset to minimum size by a random read.
+static bool BaseFile_Read(
+    TFileStream * pStream,                  // Pointer to an open stream
+    ULONGLONG * pByteOffset,                // Pointer to file byte offset. If NULL, it reads from the current position
+    void * pvBuffer,                        // Pointer to data to be read
+    DWORD dwBytesToRead)                    // Number of bytes to read from the file
+{
+    ULONGLONG ByteOffset = (pByteOffset != NULL) ? *pByteOffset : pStream->Base.File.FilePos;
+    ULONGLONG CacheEnd = pStream->Base.File.CacheOffset + pStream->Base.File.cbCache;
+    ULONGLONG ReadOffset;
+    LPBYTE pbBuffer = (LPBYTE)pvBuffer;
+    DWORD dwBytesRead = 0;
+    DWORD dwBytesToCopy;
+    DWORD dwRawBytes;
+
+    // Update the statistics
+    pStream->Stats.ReadRequests++;
+    pStream->Stats.BytesRequested += dwBytesToRead;
+
+    // Detect (near-)sequential access. The read is sequential
+    // if it begins in the cache or not far after the previous read
+    if((ByteOffset >= pStream->Base.File.CacheOffset && ByteOffset < CacheEnd) ||
+       (ByteOffset >= pStream->Base.File.FilePos && (ByteOffset - pStream->Base.File.FilePos) <= pStream->Base.File.cbWindow))
+    {
+        pStream->Base.File.dwSequential++;
+        pStream->Stats.SequentialReads++;
+    }
+    else
+    {
+        pStream->Base.File.dwSequential = 0;
+        pStream->Base.File.cbWindow = STREAM_CACHE_MIN_WINDOW;
+    }
+
+    // Serve the begin of the data from the readahead cache, if we have it
+    if(ByteOffset >= pStream->Base.File.CacheOffset && ByteOffset < CacheEnd)
+    {
+        dwBytesToCopy = (DWORD)STORMLIB_MIN(CacheEnd - ByteOffset, (ULONGLONG)dwBytesToRead);
+        memcpy(pbBuffer, pStream->Base.File.pbCache + (size_t)(ByteOffset - pStream->Base.File.CacheOffset), dwBytesToCopy);
+        dwBytesRead = dwBytesToCopy;
+
+        if(dwBytesRead == dwBytesToRead)
+            pStream->Stats.CacheHits++;
+    }
+
+    // Read the rest from the file
+    if(dwBytesRead < dwBytesToRead)
+    {
+        ReadOffset = ByteOffset + dwBytesRead;
+
+        // Allocate the readahead cache when the reads become sequential
+        if(pStream->Base.File.dwSequential != 0 && pStream->Base.File.pbCache == NULL)
+            pStream->Base.File.pbCache = STORM_ALLOC(BYTE, STREAM_CACHE_MAX_WINDOW);
+
+        // Only small sequential reads that don't cross the end of the file go through the cache.
+        // Large reads are faster directly into the caller's buffer
+        if(pStream->Base.File.dwSequential != 0 && pStream->Base.File.pbCache != NULL &&
+           (dwBytesToRead - dwBytesRead) < pStream->Base.File.cbWindow &&
+           (ReadOffset + (dwBytesToRead - dwBytesRead)) <= pStream->Base.File.FileSize)
+        {
+            dwBytesToCopy = dwBytesToRead - dwBytesRead;
+            dwRawBytes = (DWORD)STORMLIB_MIN((ULONGLONG)pStream->Base.File.cbWindow, pStream->Base.File.FileSize - ReadOffset);
+
+            // Load one readahead window to the cache
+            pStream->Base.File.cbCache = 0;
+            if(!BaseFile_ReadRaw(pStream, ReadOffset, pStream->Base.File.pbCache, dwRawBytes, &dwRawBytes))
+                return false;
+            pStream->Base.File.CacheOffset = ReadOffset;
+            pStream->Base.File.cbCache = dwRawBytes;
+
+            // Copy the requested part
+            dwBytesToCopy = STORMLIB_MIN(dwBytesToCopy, dwRawBytes);
+            memcpy(pbBuffer + dwBytesRead, pStream->Base.File.pbCache, dwBytesToCopy);
+            dwBytesRead += dwBytesToCopy;
+
+#ifdef PLATFORM_LINUX
+            // Let the kernel load the next window while we are processing this one
+            posix_fadvise((intptr_t)pStream->Base.File.hFile, (off_t)(ReadOffset + dwRawBytes), (off_t)pStream->Base.File.cbWindow, POSIX_FADV_WILLNEED);
+#endif
+
+            // Enlarge the window for the next time
+            if(pStream->Base.File.cbWindow < STREAM_CACHE_MAX_WINDOW)
+                pStream->Base.File.cbWindow <<= 1;
+        }
+        else
+        {
+            if(!BaseFile_ReadRaw(pStream, ReadOffset, pbBuffer + dwBytesRead, dwBytesToRead - dwBytesRead, &dwRawBytes))
+                return false;
+            dwBytesRead += dwRawBytes;
+        }
+    }
+
     // Increment the current file position by number of bytes read
     // If the number of bytes read doesn't match to required amount, return false
     pStream->Base.File.FilePos = ByteOffset + dwBytesRead;
@@ -221,6 +310,9 @@ static bool BaseFile_Write(TFileStream * pStream, ULONGLONG * pByteOffset, const
     ULONGLONG ByteOffset = (pByteOffset != NULL) ? *pByteOffset : pStream->Base.File.FilePos;
     DWORD dwBytesWritten = 0;               // Must be set by platform-specific code
 
+    // The readahead cache might contain the data being overwritten
+    pStream->Base.File.cbCache = 0;
+
 #ifdef PLATFORM_WINDOWS
     {
         // Note: StormLib no longer supports Windows 9x.
@@ -267,16 +359,9 @@ static bool BaseFile_Write(TFileStream * pStream, ULONGLONG * pByteOffset, const
     {
         ssize_t bytes_written;
 
-        // If the byte offset is different from the current file position,
-        // we have to update the file position
-        if(ByteOffset != pStream->Base.File.FilePos)
-        {
-            lseek((intptr_t)pStream->Base.File.hFile, (off_t)(ByteOffset), SEEK_SET);
-            pStream->Base.File.FilePos = ByteOffset;
-        }
-
-        // Perform the read operation
-        bytes_written = write((intptr_t)pStream->Base.File.hFile, pvBuffer, (size_t)dwBytesToWrite);
+        // Perform the write operation. Note that the file pointer is not kept
+        // in sync with the stream position (BaseFile_Read uses pread)
+        bytes_written = pwrite((intptr_t)pStream->Base.File.hFile, pvBuffer, (size_t)dwBytesToWrite, (off_t)ByteOffset);
         if(bytes_written == -1)
         {
             nLastError = errno;
@@ -321,6 +406,9 @@ static bool BaseFile_GetSize(
  */
 static bool BaseFile_SetSize(TFileStream * pStream, ULONGLONG NewFileSize)
 {
+    // Invalidate the readahead cache
+    pStream->Base.File.cbCache = 0;
+
 #ifdef PLATFORM_WINDOWS
     {
         LONG FileSizeHi = (LONG)(NewFileSize >> 32);
@@ -400,6 +488,12 @@ static void BaseFile_Close(TFileStream * pStream)
 #endif
     }
 
+    // Free the readahead cache
+    if(pStream->Base.File.pbCache != NULL)
+        STORM_FREE(pStream->Base.File.pbCache);
+    pStream->Base.File.pbCache = NULL;
+    pStream->Base.File.cbCache = 0;
+
     // Also invalidate the handle
     pStream->Base.File.hFile = INVALID_HANDLE_VALUE;
 }
@@ -450,9 +544,14 @@ static bool BaseFile_Create(
     pStream->BaseGetTime = BaseFile_GetTime;
     pStream->BaseClose   = BaseFile_Close;
 
-    // Reset the file position
+    // Reset the file position and the readahead cache
     pStream->Base.File.FileSize = 0;
     pStream->Base.File.FilePos = 0;
+    pStream->Base.File.CacheOffset = 0;
+    pStream->Base.File.pbCache = NULL;
+    pStream->Base.File.cbCache = 0;
+    pStream->Base.File.cbWindow = STREAM_CACHE_MIN_WINDOW;
+    pStream->Base.File.dwSequential = 0;
     pStream->dwFlags = dwStreamFlags;
     return true;
 }
@@ -527,8 +626,13 @@ static bool BaseFile_Open(
     pStream->BaseGetTime = BaseFile_GetTime;
     pStream->BaseClose   = BaseFile_Close;
 
-    // Reset the file position
+    // Reset the file position and the readahead cache
     pStream->Base.File.FilePos = 0;
+    pStream->Base.File.CacheOffset = 0;
+    pStream->Base.File.pbCache = NULL;
+    pStream->Base.File.cbCache = 0;
+    pStream->Base.File.cbWindow = STREAM_CACHE_MIN_WINDOW;
+    pStream->Base.File.dwSequential = 0;
     pStream->dwFlags = dwStreamFlags;
     return true;
 }
@@ -721,6 +825,250 @@ static const TCHAR * BaseHttp_ExtractServerName(const TCHAR * szFileName, TCHAR
     return szFileName;
 }
 
+// Cuts the optional port number off the server name. Returns the port number
+static DWORD BaseHttp_ExtractPort(TCHAR * szServerName)
+{
+    TCHAR * szPort = _tcschr(szServerName, _T(':'));
+    DWORD dwPort = 80;
+
+    if(szPort != NULL)
+    {
+        dwPort = (DWORD)_tcstoul(szPort + 1, NULL, 10);
+        *szPort = 0;
+    }
+
+    return dwPort;
+}
+
+#ifndef PLATFORM_WINDOWS
+
+// Finds the value of a HTTP header. The header names are case-insensitive
+static const char * BaseHttp_FindHeader(const char * szHeaders, const char * szName)
+{
+    size_t nLength = strlen(szName);
+
+    for(szHeaders = strstr(szHeaders, "\r\n"); szHeaders != NULL; szHeaders = strstr(szHeaders, "\r\n"))
+    {
+        szHeaders += 2;
+        if(!strncasecmp(szHeaders, szName, nLength) && szHeaders[nLength] == ':')
+        {
+            szHeaders += nLength + 1;
+            while(szHeaders[0] == ' ')
+                szHeaders++;
+            return szHeaders;
+        }
+    }
+
+    return NULL;
+}
+
+static int BaseHttp_Connect(const char * szServerName, DWORD dwPort)
+{
+    struct addrinfo * pAddrInfo = NULL;
+    struct addrinfo Hints;
+    char szPort[0x10];
+    int sock = -1;
+
+    // Resolve the server name
+    memset(&Hints, 0, sizeof(struct addrinfo));
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_socktype = SOCK_STREAM;
+    sprintf(szPort, "%u", dwPort);
+    if(getaddrinfo(szServerName, szPort, &Hints, &pAddrInfo) != 0)
+    {
+        nLastError = ERROR_FILE_NOT_FOUND;
+        return -1;
+    }
+
+    // Connect to the first address that accepts it
+    for(struct addrinfo * pAddr = pAddrInfo; pAddr != NULL; pAddr = pAddr->ai_next)
+    {
+        sock = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+        if(sock != -1)
+        {
+            if(connect(sock, pAddr->ai_addr, pAddr->ai_addrlen) == 0)
+                break;
+            nLastError = errno;
+            close(sock);
+            sock = -1;
+        }
+    }
+
+    freeaddrinfo(pAddrInfo);
+    return sock;
+}
+
+// Sends a range request to the server and receives the data.
+// If pFileSize is not NULL, it receives the total size of the file.
+static bool BaseHttp_Request(
+    TFileStream * pStream,                  // Pointer to an open stream
+    ULONGLONG ByteOffset,                   // File byte offset
+    void * pvBuffer,                        // Pointer to data to be read
+    DWORD dwBytesToRead,                    // Number of bytes to read from the file
+    LPDWORD pdwBytesRead,                   // Receives number of bytes read
+    ULONGLONG * pFileSize)                  // Receives the file size
+{
+    ULONGLONG RangeStart = 0;
+    ULONGLONG RangeEnd = 0;
+    ULONGLONG FileSize = 0;
+    ULONGLONG BytesToSkip = 0;
+    const char * szFileName;
+    const char * szValue;
+    char szServerName[MAX_PATH];
+    char szHostName[MAX_PATH];
+    char szBuffer[0x1000];
+    char * szHeaderEnd = NULL;
+    LPBYTE pbBuffer = (LPBYTE)pvBuffer;
+    DWORD dwBytesRead = 0;
+    DWORD dwCopy;
+    DWORD dwPort;
+    size_t cbBuffer = 0;
+    size_t cbHeader;
+    ssize_t nTransferred;
+    int nStatusCode = 0;
+    int nError = ERROR_SUCCESS;
+    int nLength;
+    int sock;
+
+    // Split the URL to the server name, port and file name
+    szFileName = BaseHttp_ExtractServerName(pStream->szFileName, szHostName);
+    strcpy(szServerName, szHostName);
+    dwPort = BaseHttp_ExtractPort(szServerName);
+    if(szFileName[0] == 0)
+        szFileName = "/";
+
+    // Connect to the server
+    sock = BaseHttp_Connect(szServerName, dwPort);
+    if(sock == -1)
+        return false;
+
+    // Send the range request. The connection is not reused,
+    // so we let the server close it after the response
+    nLength = sprintf(szBuffer, "GET %s HTTP/1.1\r\nHost: %s\r\nRange: bytes=%llu-%llu\r\nConnection: close\r\n\r\n",
+                                szFileName,
+                                szHostName,
+                                (unsigned long long)ByteOffset,
+                                (unsigned long long)(ByteOffset + dwBytesToRead - 1));
+    if(send(sock, szBuffer, nLength, 0) != nLength)
+        nError = ERROR_CAN_NOT_COMPLETE;
+
+    // Receive the entire response header
+    while(nError == ERROR_SUCCESS && szHeaderEnd == NULL)
+    {
+        if(cbBuffer >= sizeof(szBuffer) - 1)
+        {
+            nError = ERROR_BAD_FORMAT;
+            break;
+        }
+
+        nTransferred = recv(sock, szBuffer + cbBuffer, sizeof(szBuffer) - 1 - cbBuffer, 0);
+        if(nTransferred <= 0)
+        {
+            nError = ERROR_CAN_NOT_COMPLETE;
+            break;
+        }
+
+        cbBuffer += nTransferred;
+        szBuffer[cbBuffer] = 0;
+        szHeaderEnd = strstr(szBuffer, "\r\n\r\n");
+    }
+
+    // Parse the response header
+    if(nError == ERROR_SUCCESS)
+    {
+        cbHeader = (szHeaderEnd - szBuffer) + 4;
+        szHeaderEnd[2] = 0;
+
+        if(sscanf(szBuffer, "HTTP/%*d.%*d %d", &nStatusCode) != 1)
+            nStatusCode = 0;
+
+        switch(nStatusCode)
+        {
+            case 206:   // Partial content. The total size is in "Content-Range: bytes 0-0/1234"
+                szValue = BaseHttp_FindHeader(szBuffer, "Content-Range");
+                if(szValue == NULL || sscanf(szValue, "bytes %llu-%llu/%llu", &RangeStart, &RangeEnd, &FileSize) != 3 || RangeStart != ByteOffset)
+                    nError = ERROR_BAD_FORMAT;
+                break;
+
+            case 200:   // The server ignored the range and sends the whole file
+                szValue = BaseHttp_FindHeader(szBuffer, "Content-Length");
+                if(szValue == NULL || sscanf(szValue, "%llu", &FileSize) != 1)
+                    nError = ERROR_BAD_FORMAT;
+                BytesToSkip = ByteOffset;
+                break;
+
+            case 416:   // Range not satisfiable: reading beyond the end of the file
+                nError = ERROR_HANDLE_EOF;
+                break;
+
+            default:
+                nError = ERROR_FILE_NOT_FOUND;
+                break;
+        }
+    }
+
+    // Move the begin of the data that came with the header
+    if(nError == ERROR_SUCCESS)
+    {
+        cbBuffer -= cbHeader;
+        memmove(szBuffer, szBuffer + cbHeader, cbBuffer);
+    }
+
+    // Receive the data
+    while(nError == ERROR_SUCCESS && dwBytesRead < dwBytesToRead)
+    {
+        // Skip the data before the requested offset
+        if(BytesToSkip != 0)
+        {
+            dwCopy = (DWORD)STORMLIB_MIN(BytesToSkip, (ULONGLONG)cbBuffer);
+            memmove(szBuffer, szBuffer + dwCopy, cbBuffer - dwCopy);
+            BytesToSkip -= dwCopy;
+            cbBuffer -= dwCopy;
+        }
+
+        // Copy the data from the buffer
+        if(BytesToSkip == 0 && cbBuffer != 0)
+        {
+            dwCopy = (DWORD)STORMLIB_MIN((size_t)(dwBytesToRead - dwBytesRead), cbBuffer);
+            memcpy(pbBuffer + dwBytesRead, szBuffer, dwCopy);
+            dwBytesRead += dwCopy;
+            cbBuffer = 0;
+        }
+
+        // Receive more data. When not skipping, receive directly to the caller's buffer
+        if(dwBytesRead < dwBytesToRead)
+        {
+            if(BytesToSkip != 0)
+                nTransferred = recv(sock, szBuffer, sizeof(szBuffer), 0);
+            else
+                nTransferred = recv(sock, pbBuffer + dwBytesRead, dwBytesToRead - dwBytesRead, 0);
+            if(nTransferred <= 0)
+                break;
+
+            if(BytesToSkip != 0)
+                cbBuffer = nTransferred;
+            else
+                dwBytesRead += nTransferred;
+        }
+    }
+
+    close(sock);
+
+    // Give the results
+    if(nError != ERROR_SUCCESS)
+    {
+        nLastError = nError;
+        return false;
+    }
+
+    if(pFileSize != NULL)
+        *pFileSize = FileSize;
+    *pdwBytesRead = dwBytesRead;
+    return true;
+}
+
+#endif // PLATFORM_WINDOWS
+
 static bool BaseHttp_Read(
     TFileStream * pStream,                  // Pointer to an open stream
     ULONGLONG * pByteOffset,                // Pointer to file byte offset. If NULL, it reads from the current position
@@ -787,13 +1135,28 @@ static bool BaseHttp_Read(
 
 #else
 
-    // Not supported
-    pStream = pStream;
-    pByteOffset = pByteOffset;
-    pvBuffer = pvBuffer;
-    dwBytesToRead = dwBytesToRead;
-    SetLastError(ERROR_NOT_SUPPORTED);
-    return false;
+    ULONGLONG ByteOffset = (pByteOffset != NULL) ? *pByteOffset : pStream->Base.Http.FilePos;
+    DWORD dwBytesToRequest = dwBytesToRead;
+    DWORD dwTotalBytesRead = 0;
+
+    // Do we have to read anything at all?
+    if(dwBytesToRead != 0 && ByteOffset < pStream->Base.Http.FileSize)
+    {
+        // Don't ask for data beyond the end of the file
+        if((ByteOffset + dwBytesToRequest) > pStream->Base.Http.FileSize)
+            dwBytesToRequest = (DWORD)(pStream->Base.Http.FileSize - ByteOffset);
+
+        if(!BaseHttp_Request(pStream, ByteOffset, pvBuffer, dwBytesToRequest, &dwTotalBytesRead, NULL))
+            return false;
+    }
+
+    // Increment the current file position by number of bytes read
+    pStream->Base.Http.FilePos = ByteOffset + dwTotalBytesRead;
+
+    // If the number of bytes read doesn't match the required amount, return false
+    if(dwTotalBytesRead != dwBytesToRead)
+        SetLastError(ERROR_HANDLE_EOF);
+    return (dwTotalBytesRead == dwBytesToRead);
 
 #endif
 }
@@ -868,12 +1231,14 @@ static bool BaseHttp_Open(
     {
         TCHAR szServerName[MAX_PATH];
         DWORD dwFlags = INTERNET_FLAG_KEEP_CONNECTION | INTERNET_FLAG_NO_UI | INTERNET_FLAG_NO_CACHE_WRITE;
+        DWORD dwPort;
 
         // Initiate connection with the server
         szFileName = BaseHttp_ExtractServerName(szFileName, szServerName);
+        dwPort = BaseHttp_ExtractPort(szServerName);
         pStream->Base.Http.hConnect = InternetConnect(pStream->Base.Http.hInternet,
                                                       szServerName,
-                                                      INTERNET_DEFAULT_HTTP_PORT,
+                                                      (INTERNET_PORT)dwPort,
                                                       NULL,
                                                       NULL,
                                                       INTERNET_SERVICE_HTTP,
@@ -918,6 +1283,30 @@ static bool BaseHttp_Open(
         }
     }
 
+#else
+
+    ULONGLONG FileSize = 0;
+    DWORD dwBytesRead = 0;
+    BYTE FirstByte;
+    bool bFileAvailable = false;
+
+    // Ask for the first byte of the file. This verifies that the server
+    // supports range requests, and the response also contains the file size.
+    // Note that szFileName is already stored in the stream
+    szFileName = szFileName;
+    if(BaseHttp_Request(pStream, 0, &FirstByte, 1, &dwBytesRead, &FileSize))
+    {
+        if(FileSize != 0)
+        {
+            pStream->Base.Http.FileSize = FileSize;
+            pStream->Base.Http.FilePos = 0;
+            pStream->Base.Http.FileTime = 0;
+            bFileAvailable = true;
+        }
+    }
+
+#endif
+
     // If the file is not there and is not available for random access,
     // report error
     if(bFileAvailable == false)
@@ -934,16 +1323,6 @@ static bool BaseHttp_Open(
     pStream->BaseClose   = BaseHttp_Close;
     pStream->dwFlags = dwStreamFlags;
     return true;
-
-#else
-
-    // Not supported
-    pStream = pStream;
-    szFileName = szFileName;
-    SetLastError(ERROR_NOT_SUPPORTED);
-    return false;
-
-#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -1383,6 +1762,390 @@ static bool PartialStream_Open(TPartialStream * pStream)
     return false;
 }
 
+//-----------------------------------------------------------------------------
+// Local functions - sparse stream support
+//
+// Sparse file is a local file that holds the blocks of the source file
+// that have been read so far, each at its position in the source file.
+// The missing blocks are fetched from the source (another file, a file on
+// a web server or a custom fetch callback) at the time they are read.
+
+static bool IsSparseHeader(PSPARSE_FILE_HEADER pSparseHdr)
+{
+    // Signature and version must match
+    if(pSparseHdr->Signature == SPARSE_FILE_SIGNATURE && pSparseHdr->Version == SPARSE_FILE_VERSION)
+    {
+        // Block size must be power of 2
+        if(pSparseHdr->BlockSize != 0 && (pSparseHdr->BlockSize & (pSparseHdr->BlockSize - 1)) == 0)
+        {
+            // The source name must be zero-terminated
+            if(memchr(pSparseHdr->szSourceName, 0, SPARSE_SOURCE_NAME_MAX) != NULL)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+static TFileStream * SparseStream_OpenSource(const TCHAR * szSourceName)
+{
+    DWORD dwBaseProvider = _tcsnicmp(szSourceName, _T("http://"), 7) ? BASE_PROVIDER_FILE : BASE_PROVIDER_HTTP;
+
+    return FileStream_OpenFile(szSourceName, STREAM_FLAG_READ_ONLY | STREAM_PROVIDER_LINEAR | dwBaseProvider);
+}
+
+static bool SparseStream_IsBlockPresent(TSparseStream * pStream, DWORD BlockIndex)
+{
+    return (pStream->pbBitmap[BlockIndex / 8] & (1 << (BlockIndex & 7))) ? true : false;
+}
+
+// Fetches a run of blocks from the source and stores them to the sparse file.
+// The block data are written before the bitmap, so a fetch that has been
+// interrupted only causes the blocks to be fetched again
+static bool SparseStream_FetchBlocks(TSparseStream * pStream, DWORD BlockIndex, DWORD BlockCount)
+{
+    ULONGLONG ByteOffset = (ULONGLONG)BlockIndex * pStream->BlockSize;
+    ULONGLONG RawByteOffset;
+    DWORD dwBytesToFetch = BlockCount * pStream->BlockSize;
+    DWORD dwStartByte;
+    DWORD dwEndByte;
+    bool bResult;
+
+    // Sanity check
+    assert(BlockCount != 0 && BlockCount <= pStream->MaxFetchBlocks);
+
+    // The last block may be incomplete
+    if((ByteOffset + dwBytesToFetch) > pStream->VirtualSize)
+        dwBytesToFetch = (DWORD)(pStream->VirtualSize - ByteOffset);
+
+    // Fetch the blocks from the source
+    if(pStream->PfnFetch == NULL)
+    {
+        // Open the source when fetching for the first time
+        if(pStream->pSource == NULL)
+        {
+            pStream->pSource = SparseStream_OpenSource(pStream->szSourceName);
+            if(pStream->pSource == NULL)
+                return false;
+        }
+
+        bResult = FileStream_Read(pStream->pSource, &ByteOffset, pStream->pbFetchBuffer, dwBytesToFetch);
+    }
+    else
+    {
+        // The callback reports the reason of a failure by SetLastError
+        SetLastError(ERROR_SUCCESS);
+        bResult = pStream->PfnFetch(pStream->pvFetchData, ByteOffset, pStream->pbFetchBuffer, dwBytesToFetch);
+        if(bResult == false && GetLastError() == ERROR_SUCCESS)
+            SetLastError(ERROR_CAN_NOT_COMPLETE);
+    }
+
+    if(bResult == false)
+        return false;
+
+    // Update the statistics
+    pStream->Stats.FetchRequests++;
+    pStream->Stats.BytesFetched += dwBytesToFetch;
+
+    // Store the block data to the sparse file
+    RawByteOffset = pStream->DataOffset + ByteOffset;
+    if(!pStream->BaseWrite(pStream, &RawByteOffset, pStream->pbFetchBuffer, dwBytesToFetch))
+        return false;
+
+    // Mark the blocks as present and write the changed part of the bitmap
+    for(DWORD i = BlockIndex; i < BlockIndex + BlockCount; i++)
+        pStream->pbBitmap[i / 8] |= (BYTE)(1 << (i & 7));
+    dwStartByte = BlockIndex / 8;
+    dwEndByte = ((BlockIndex + BlockCount - 1) / 8) + 1;
+
+    RawByteOffset = sizeof(SPARSE_FILE_HEADER) + dwStartByte;
+    return pStream->BaseWrite(pStream, &RawByteOffset, pStream->pbBitmap + dwStartByte, dwEndByte - dwStartByte);
+}
+
+// Makes sure that all blocks from StartBlock to EndBlock are present in the sparse file.
+// Every run of missing blocks is fetched by as few requests as possible, in the order
+// the reader needs them. If the last missing run reaches the end of the read, it is
+// extended by up to dwPrefetch missing blocks that follow, so they come with the same request.
+static bool SparseStream_EnsureBlocks(TSparseStream * pStream, DWORD StartBlock, DWORD EndBlock, DWORD dwPrefetch)
+{
+    DWORD PrefetchEnd = STORMLIB_MIN(EndBlock + dwPrefetch, pStream->BlockCount);
+    DWORD BlockIndex = StartBlock;
+    DWORD RunStart;
+    DWORD RunEnd;
+    DWORD RunLength;
+
+    while(BlockIndex < EndBlock)
+    {
+        // Skip the blocks that are already present
+        if(SparseStream_IsBlockPresent(pStream, BlockIndex))
+        {
+            BlockIndex++;
+            continue;
+        }
+
+        // Find the end of the run of missing blocks
+        RunStart = RunEnd = BlockIndex;
+        while(RunEnd < EndBlock && !SparseStream_IsBlockPresent(pStream, RunEnd))
+            RunEnd++;
+
+        // Extend the run by the blocks that are likely to be read next
+        if(RunEnd == EndBlock)
+        {
+            while(RunEnd < PrefetchEnd && !SparseStream_IsBlockPresent(pStream, RunEnd))
+                RunEnd++;
+        }
+
+        // Fetch the run, one batch at a time
+        while(RunStart < RunEnd)
+        {
+            RunLength = STORMLIB_MIN(RunEnd - RunStart, pStream->MaxFetchBlocks);
+            if(!SparseStream_FetchBlocks(pStream, RunStart, RunLength))
+                return false;
+            RunStart += RunLength;
+        }
+
+        BlockIndex = RunEnd;
+    }
+
+    return true;
+}
+
+static bool SparseStream_Read(
+    TSparseStream * pStream,
+    ULONGLONG * pByteOffset,
+    void * pvBuffer,
+    DWORD dwBytesToRead)
+{
+    ULONGLONG ByteOffset = (pByteOffset != NULL) ? *pByteOffset : pStream->VirtualPos;
+    ULONGLONG RawByteOffset;
+    DWORD dwBytesRemaining = dwBytesToRead;
+    DWORD StartBlock;
+    DWORD EndBlock;
+
+    // Check if the file position is not at or beyond end of the file
+    if(ByteOffset >= pStream->VirtualSize)
+    {
+        SetLastError(ERROR_HANDLE_EOF);
+        return false;
+    }
+
+    // If the number of bytes remaining goes past
+    // the end of the file, cut them
+    if((ByteOffset + dwBytesRemaining) > pStream->VirtualSize)
+        dwBytesRemaining = (DWORD)(pStream->VirtualSize - ByteOffset);
+
+    if(dwBytesRemaining != 0)
+    {
+        StartBlock = (DWORD)(ByteOffset / pStream->BlockSize);
+        EndBlock = (DWORD)((ByteOffset + dwBytesRemaining - 1) / pStream->BlockSize) + 1;
+
+        // Reads that follow the previous one double the prefetch,
+        // random reads don't prefetch at all
+        if(ByteOffset >= pStream->VirtualPos && (ByteOffset - pStream->VirtualPos) < pStream->BlockSize)
+            pStream->dwPrefetch = STORMLIB_MIN(pStream->dwPrefetch ? (pStream->dwPrefetch << 1) : 1, pStream->MaxFetchBlocks);
+        else
+            pStream->dwPrefetch = 0;
+
+        // Fetch the blocks that are not in the sparse file yet.
+        // On failure, keep the error set by the source or the fetch callback
+        if(!SparseStream_EnsureBlocks(pStream, StartBlock, EndBlock, pStream->dwPrefetch))
+            return false;
+
+        // Now all the data are in the sparse file
+        RawByteOffset = pStream->DataOffset + ByteOffset;
+        if(!pStream->BaseRead(pStream, &RawByteOffset, pvBuffer, dwBytesRemaining))
+        {
+            SetLastError(ERROR_FILE_CORRUPT);
+            return false;
+        }
+    }
+
+    // Move the file position by the number of bytes read
+    pStream->VirtualPos = ByteOffset + dwBytesRemaining;
+    if(dwBytesRemaining != dwBytesToRead)
+        SetLastError(ERROR_HANDLE_EOF);
+    return (dwBytesRemaining == dwBytesToRead);
+}
+
+static bool SparseStream_GetPos(
+    TSparseStream * pStream,
+    ULONGLONG * pByteOffset)
+{
+    *pByteOffset = pStream->VirtualPos;
+    return true;
+}
+
+static bool SparseStream_GetSize(
+    TSparseStream * pStream,                // Pointer to an open stream
+    ULONGLONG * pFileSize)                  // Pointer where to store file size
+{
+    *pFileSize = pStream->VirtualSize;
+    return true;
+}
+
+static bool SparseStream_GetBitmap(
+    TSparseStream * pStream,
+    TFileBitmap * pBitmap,
+    DWORD Length,
+    LPDWORD LengthNeeded)
+{
+    DWORD TotalLength = sizeof(TFileBitmap) + pStream->BitmapSize;
+    bool bResult = false;
+
+    // Give the bitmap length
+    if(LengthNeeded != NULL)
+        *LengthNeeded = TotalLength;
+
+    // Do we have enough to fill at least the header?
+    if(Length >= sizeof(TFileBitmap))
+    {
+        // Fill the bitmap header
+        pBitmap->StartOffset = 0;
+        pBitmap->EndOffset  = pStream->VirtualSize;
+        pBitmap->IsComplete = 1;
+        pBitmap->BitmapSize = pStream->BitmapSize;
+        pBitmap->BlockSize = pStream->BlockSize;
+        pBitmap->Reserved = 0;
+
+        // Is there at least one missing block?
+        for(DWORD i = 0; i < pStream->BlockCount; i++)
+        {
+            if(!SparseStream_IsBlockPresent(pStream, i))
+            {
+                pBitmap->IsComplete = 0;
+                break;
+            }
+        }
+
+        bResult = true;
+    }
+
+    // Do we have enough space for supplying the bitmap?
+    if(Length >= TotalLength)
+    {
+        memcpy(pBitmap + 1, pStream->pbBitmap, pStream->BitmapSize);
+        bResult = true;
+    }
+
+    return bResult;
+}
+
+static void SparseStream_Close(TSparseStream * pStream)
+{
+    // Close the source stream
+    if(pStream->pSource != NULL)
+        FileStream_Close(pStream->pSource);
+    pStream->pSource = NULL;
+
+    // Free the bitmap and the fetch buffer
+    if(pStream->pbFetchBuffer != NULL)
+        STORM_FREE(pStream->pbFetchBuffer);
+    pStream->pbFetchBuffer = NULL;
+
+    if(pStream->pbBitmap != NULL)
+        STORM_FREE(pStream->pbBitmap);
+    pStream->pbBitmap = NULL;
+
+    // Clear variables
+    pStream->VirtualSize = 0;
+    pStream->VirtualPos = 0;
+
+    // Close the base stream
+    assert(pStream->BaseClose != NULL);
+    pStream->BaseClose(pStream);
+}
+
+static bool SparseStream_Open(TSparseStream * pStream)
+{
+    SPARSE_FILE_HEADER SparseHdr;
+    ULONGLONG VirtualSize;
+    ULONGLONG ByteOffset = 0;
+    DWORD BlockCount;
+    DWORD BitmapSize;
+
+    // Sanity check
+    assert(pStream->BaseRead != NULL);
+
+    // The fetched blocks are stored to the sparse file,
+    // so the base file must be open for write
+    if(pStream->BaseWrite == NULL || (pStream->dwFlags & STREAM_FLAG_READ_ONLY))
+    {
+        SetLastError(ERROR_NOT_SUPPORTED);
+        return false;
+    }
+
+    // Attempt to read the sparse file header
+    if(pStream->BaseRead(pStream, &ByteOffset, &SparseHdr, sizeof(SPARSE_FILE_HEADER)))
+    {
+        // We need to swap the header on big-endian platforms
+        BSWAP_ARRAY32_UNSIGNED(&SparseHdr, 6 * sizeof(DWORD));
+
+        // Verify the sparse file header
+        if(IsSparseHeader(&SparseHdr))
+        {
+            // Calculate the number of blocks in the file
+            VirtualSize = MAKE_OFFSET64(SparseHdr.FileSizeHi, SparseHdr.FileSizeLo);
+            BlockCount = (DWORD)((VirtualSize + SparseHdr.BlockSize - 1) / SparseHdr.BlockSize);
+            BitmapSize = (BlockCount + 7) / 8;
+
+            // The bitmap must fit between the header and the first block
+            if(BlockCount != 0 && SparseHdr.DataOffset >= sizeof(SPARSE_FILE_HEADER) + BitmapSize)
+            {
+                pStream->MaxFetchBlocks = STORMLIB_MIN(SPARSE_MAX_FETCH_SIZE / SparseHdr.BlockSize, BlockCount);
+                if(pStream->MaxFetchBlocks == 0)
+                    pStream->MaxFetchBlocks = 1;
+
+                // Allocate the bitmap and the buffer for fetched blocks
+                pStream->pbBitmap = STORM_ALLOC(BYTE, BitmapSize);
+                pStream->pbFetchBuffer = STORM_ALLOC(BYTE, pStream->MaxFetchBlocks * SparseHdr.BlockSize);
+                if(pStream->pbBitmap != NULL && pStream->pbFetchBuffer != NULL)
+                {
+                    // Load the block bitmap
+                    if(pStream->BaseRead(pStream, NULL, pStream->pbBitmap, BitmapSize))
+                    {
+                        // Copy the source name
+                        for(size_t i = 0; i < SPARSE_SOURCE_NAME_MAX; i++)
+                            pStream->szSourceName[i] = SparseHdr.szSourceName[i];
+
+                        // Fill the members of sparse file stream
+                        pStream->VirtualSize   = VirtualSize;
+                        pStream->VirtualPos    = 0;
+                        pStream->DataOffset    = SparseHdr.DataOffset;
+                        pStream->BlockCount    = BlockCount;
+                        pStream->BlockSize     = SparseHdr.BlockSize;
+                        pStream->BitmapSize    = BitmapSize;
+                        pStream->dwPrefetch    = 0;
+
+                        // Set new function pointers
+                        pStream->StreamRead    = (STREAM_READ)SparseStream_Read;
+                        pStream->StreamGetPos  = (STREAM_GETPOS)SparseStream_GetPos;
+                        pStream->StreamGetSize = (STREAM_GETSIZE)SparseStream_GetSize;
+                        pStream->StreamGetTime = pStream->BaseGetTime;
+                        pStream->StreamGetBmp  = (STREAM_GETBMP)SparseStream_GetBitmap;
+                        pStream->StreamClose   = (STREAM_CLOSE)SparseStream_Close;
+
+                        // The stream itself is read only
+                        pStream->dwFlags |= STREAM_FLAG_READ_ONLY;
+                        return true;
+                    }
+                }
+
+                // Free the buffers
+                if(pStream->pbFetchBuffer != NULL)
+                    STORM_FREE(pStream->pbFetchBuffer);
+                pStream->pbFetchBuffer = NULL;
+
+                if(pStream->pbBitmap != NULL)
+                    STORM_FREE(pStream->pbBitmap);
+                pStream->pbBitmap = NULL;
+            }
+        }
+    }
+
+    SetLastError(ERROR_BAD_FORMAT);
+    return false;
+}
+
 //-----------------------------------------------------------------------------
 // Local functions - encrypted stream support
 
@@ -1773,6 +2536,8 @@ TFileStream * FileStream_CreateFile(
  * - The parameters of the function must be validate by the caller
  * - The function must check if the file is a PART file,
  *   and create TPartialStream object if so.
+ * - Sparse files (STREAM_PROVIDER_SPARSE) are always open for read-write,
+ *   because the fetched blocks are stored to them. The stream is read-only.
  * - The function must initialize all stream function pointers in TFileStream
  * - If the function fails from any reason, it must close all handles
  *   and free all memory that has been allocated in the process of stream creation,
@@ -1808,6 +2573,11 @@ TFileStream * FileStream_OpenFile(
             StreamSize = sizeof(TEncryptedStream);
             break;
 
+        case STREAM_PROVIDER_SPARSE:    // The base file must be writable, the stream is made read-only later
+            dwStreamFlags &= ~STREAM_FLAG_READ_ONLY;
+            StreamSize = sizeof(TSparseStream);
+            break;
+
         default:
             return NULL;
     }
@@ -1860,6 +2630,10 @@ TFileStream * FileStream_OpenFile(
         case STREAM_PROVIDER_ENCRYPTED:
             bStreamResult = EncryptedStream_Open((TEncryptedStream *)pStream);
             break;
+
+        case STREAM_PROVIDER_SPARSE:
+            bStreamResult = SparseStream_Open((TSparseStream *)pStream);
+            break;
     }
 
     // If the operation failed, free the stream and set it to NULL
@@ -2072,6 +2846,137 @@ bool FileStream_GetBitmap(TFileStream * pStream, TFileBitmap * pBitmap, DWORD Le
     return pStream->StreamGetBmp(pStream, pBitmap, Length, LengthNeeded);
 }
 
+/**
+ * Retrieves the read statistics of the stream. The counters are maintained
+ * by the file base provider. The difference between ReadRequests and ReadCalls
+ * shows how many reads have been saved by the readahead cache.
+ *
+ * \a pStream Pointer to an open stream
+ * \a pStats Pointer to structure that receives the statistics
+ */
+bool FileStream_GetStats(TFileStream * pStream, TFileStreamStats * pStats)
+{
+    *pStats = pStream->Stats;
+    return true;
+}
+
+/**
+ * Creates an empty sparse file for the given source. The source can be
+ * a local file or a file on a web server ("http://server[:port]/path").
+ * The sparse file can then be open with STREAM_PROVIDER_SPARSE. Every block
+ * is fetched from the source when it is read for the first time.
+ *
+ * \a szFileName Name of the sparse file to create
+ * \a szSourceName Name of the source file. Stored in the sparse file
+ * \a SourceSize Size of the source file. If zero, the source is open to query its size
+ * \a dwBlockSize Size of one block. Must be power of 2. If zero, the default block size is used
+ */
+bool FileStream_CreateSparse(const TCHAR * szFileName, const TCHAR * szSourceName, ULONGLONG SourceSize, DWORD dwBlockSize)
+{
+    SPARSE_FILE_HEADER SparseHdr;
+    TFileStream * pStream;
+    ULONGLONG ByteOffset = 0;
+    LPBYTE pbBitmap = NULL;
+    size_t nLength = _tcslen(szSourceName);
+    DWORD BlockCount;
+    DWORD BitmapSize;
+    int nError = ERROR_SUCCESS;
+
+    // Check the parameters
+    if(dwBlockSize == 0)
+        dwBlockSize = SPARSE_DEFAULT_BLOCK_SIZE;
+    if((dwBlockSize & (dwBlockSize - 1)) != 0 || nLength >= SPARSE_SOURCE_NAME_MAX)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+
+    // If the source size is not given, query it from the source
+    if(SourceSize == 0)
+    {
+        pStream = SparseStream_OpenSource(szSourceName);
+        if(pStream == NULL)
+            return false;
+
+        FileStream_GetSize(pStream, &SourceSize);
+        FileStream_Close(pStream);
+    }
+
+    // Calculate the number of blocks
+    BlockCount = (DWORD)((SourceSize + dwBlockSize - 1) / dwBlockSize);
+    BitmapSize = (BlockCount + 7) / 8;
+    if(BlockCount == 0)
+        nError = ERROR_INVALID_PARAMETER;
+
+    // Prepare the header and the empty bitmap
+    if(nError == ERROR_SUCCESS)
+    {
+        memset(&SparseHdr, 0, sizeof(SPARSE_FILE_HEADER));
+        SparseHdr.Signature  = SPARSE_FILE_SIGNATURE;
+        SparseHdr.Version    = SPARSE_FILE_VERSION;
+        SparseHdr.BlockSize  = dwBlockSize;
+        SparseHdr.DataOffset = (sizeof(SPARSE_FILE_HEADER) + BitmapSize + SPARSE_DATA_ALIGNMENT - 1) & ~(SPARSE_DATA_ALIGNMENT - 1);
+        SparseHdr.FileSizeLo = (DWORD)SourceSize;
+        SparseHdr.FileSizeHi = (DWORD)(SourceSize >> 32);
+        for(size_t i = 0; i < nLength; i++)
+            SparseHdr.szSourceName[i] = (char)szSourceName[i];
+        BSWAP_ARRAY32_UNSIGNED(&SparseHdr, 6 * sizeof(DWORD));
+
+        pbBitmap = STORM_ALLOC(BYTE, BitmapSize);
+        if(pbBitmap != NULL)
+            memset(pbBitmap, 0, BitmapSize);
+        else
+            nError = ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    // Write the sparse file
+    if(nError == ERROR_SUCCESS)
+    {
+        pStream = FileStream_CreateFile(szFileName, STREAM_PROVIDER_LINEAR | BASE_PROVIDER_FILE);
+        if(pStream != NULL)
+        {
+            if(!FileStream_Write(pStream, &ByteOffset, &SparseHdr, sizeof(SPARSE_FILE_HEADER)) ||
+               !FileStream_Write(pStream, NULL, pbBitmap, BitmapSize))
+                nError = GetLastError();
+            FileStream_Close(pStream);
+        }
+        else
+            nError = GetLastError();
+    }
+
+    // Cleanup and exit
+    if(pbBitmap != NULL)
+        STORM_FREE(pbBitmap);
+    if(nError != ERROR_SUCCESS)
+        SetLastError(nError);
+    return (nError == ERROR_SUCCESS);
+}
+
+/**
+ * Sets a custom block source for a sparse stream. The callback
+ * must fill the buffer with dwBytesToFetch bytes from the given offset
+ * of the source file, and return true if succeeded. On failure, the callback
+ * should call SetLastError; the read of the sparse stream fails with that error.
+ * If the callback is NULL, the blocks are read from the source stored in the sparse file.
+ *
+ * \a pStream Pointer to an open sparse stream
+ * \a FetchCB Pointer to the fetch callback, or NULL
+ * \a pvUserData User data passed to the callback
+ */
+bool FileStream_SetFetchCallback(TFileStream * pStream, SFILE_FETCH_CALLBACK FetchCB, void * pvUserData)
+{
+    TSparseStream * pSparseStream;
+
+    // It must be a sparse stream
+    if((pStream->dwFlags & STREAM_PROVIDER_MASK) != STREAM_PROVIDER_SPARSE)
+        return false;
+    pSparseStream = (TSparseStream *)pStream;
+
+    pSparseStream->PfnFetch = FetchCB;
+    pSparseStream->pvFetchData = pvUserData;
+    return true;
+}
+
 /**
  * This function closes an archive file and frees any data buffers
  * that have been allocated for stream management. The function must also
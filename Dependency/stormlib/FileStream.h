@@ -89,6 +89,26 @@ typedef struct _PART_FILE_MAP_ENTRY
 
 } PART_FILE_MAP_ENTRY, *PPART_FILE_MAP_ENTRY;
 
+//-----------------------------------------------------------------------------
+// Local structures - sparse file structure
+
+#define SPARSE_FILE_SIGNATURE   0x53525053  // 'SPRS'
+#define SPARSE_FILE_VERSION     1           // Current version of the sparse file
+#define SPARSE_SOURCE_NAME_MAX  0x104       // Maximum length of the source name, including the terminator
+
+typedef struct _SPARSE_FILE_HEADER
+{
+    DWORD Signature;                        // Always set to SPARSE_FILE_SIGNATURE
+    DWORD Version;                          // Always set to SPARSE_FILE_VERSION
+    DWORD BlockSize;                        // Size of one file block, in bytes. Must be power of 2
+    DWORD DataOffset;                       // Offset of the first block. Block N is at (DataOffset + N * BlockSize)
+    DWORD FileSizeLo;                       // Low 32 bits of the contained file size
+    DWORD FileSizeHi;                       // High 32 bits of the contained file size
+    char  szSourceName[SPARSE_SOURCE_NAME_MAX]; // Name of the source file or "http://" URL
+
+    // Followed by the block bitmap. 1 means the block is present in the file
+} SPARSE_FILE_HEADER, *PSPARSE_FILE_HEADER;
+
 //-----------------------------------------------------------------------------
 // Local structures
 
@@ -100,6 +120,11 @@ union TBaseData
         ULONGLONG FilePos;                  // Current file position
         ULONGLONG FileTime;                 // Date/time of last modification of the file
         HANDLE hFile;                       // File handle
+        ULONGLONG CacheOffset;              // File offset of the first byte in the readahead cache
+        LPBYTE pbCache;                     // Readahead cache. NULL until the first readahead
+        DWORD cbCache;                      // Number of valid bytes in the readahead cache
+        DWORD cbWindow;                     // Current readahead window size. Grows while the reads are sequential
+        DWORD dwSequential;                 // Number of consecutive (near-)sequential reads
     } File;
 
     struct
@@ -139,6 +164,7 @@ struct TFileStream
     // Stream provider data members
     TCHAR szFileName[MAX_PATH];             // File name
     DWORD dwFlags;                          // Stream flags
+    TFileStreamStats Stats;                 // Read statistics of the base provider
 
     // Base provider functions
     STREAM_READ    BaseRead;
@@ -176,6 +202,29 @@ struct TPartialStream : public TFileStream
     PPART_FILE_MAP_ENTRY PartMap;           // File map, variable length
 };
 
+//-----------------------------------------------------------------------------
+// Structure for sparse stream
+
+struct TSparseStream : public TFileStream
+{
+    ULONGLONG VirtualSize;                  // Size of the source file
+    ULONGLONG VirtualPos;                   // Virtual position in the file
+    ULONGLONG DataOffset;                   // Offset of the first block in the sparse file
+    DWORD     BlockCount;                   // Number of file blocks
+    DWORD     BlockSize;                    // Size of one block
+    DWORD     BitmapSize;                   // Size of the block bitmap, in bytes
+    DWORD     MaxFetchBlocks;               // Maximum number of blocks fetched by one request
+    DWORD     dwPrefetch;                   // Number of blocks to prefetch after a sequential read
+
+    LPBYTE    pbBitmap;                     // Block bitmap, copy of the one in the sparse file
+    LPBYTE    pbFetchBuffer;                // Buffer for one batch of fetched blocks
+
+    SFILE_FETCH_CALLBACK PfnFetch;          // Custom fetch callback. If NULL, the blocks are read from pSource
+    void    * pvFetchData;                  // User data for the fetch callback
+    TFileStream * pSource;                  // Source stream. Opened on the first fetch
+    TCHAR     szSourceName[SPARSE_SOURCE_NAME_MAX];
+};
+
 //-----------------------------------------------------------------------------
 // Structure for encrypted stream
 
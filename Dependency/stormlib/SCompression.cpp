@@ -273,26 +273,21 @@ static void Compress_PKLIB(void * pvOutBuffer, int * pcbOutBuffer, void * pvInBu
 
 static int Decompress_PKLIB(void * pvOutBuffer, int * pcbOutBuffer, void * pvInBuffer, int cbInBuffer)
 {
-    TDataInfo Info;                             // Data information
     char * work_buf = STORM_TEMP_ALLOC(char, EXP_BUFFER_SIZE);// Pklib's work buffer
+    unsigned int cbOutBuffer = (unsigned int)*pcbOutBuffer;
 
-    // Fill data information structure
+    // Do the decompression. The data are decompressed directly
+    // into the output buffer, no need for read/write callbacks
     memset(work_buf, 0, EXP_BUFFER_SIZE);
-    Info.pbInBuff     = (unsigned char *)pvInBuffer;
-    Info.pbInBuffEnd  = (unsigned char *)pvInBuffer + cbInBuffer;
-    Info.pbOutBuff    = (unsigned char *)pvOutBuffer;
-    Info.pbOutBuffEnd = (unsigned char *)pvOutBuffer + *pcbOutBuffer;
-
-    // Do the decompression
-    explode(ReadInputData, WriteOutputData, work_buf, &Info);
+    explode_buffer((char *)pvOutBuffer, &cbOutBuffer, (char *)pvInBuffer, (unsigned int)cbInBuffer, work_buf);
+    STORM_TEMP_FREE(work_buf);
     
     // If PKLIB is unable to decompress the data, return 0;
-    if(Info.pbOutBuff == pvOutBuffer)
+    if(cbOutBuffer == 0)
         return 0;
 
     // Give away the number of decompressed bytes
-    *pcbOutBuffer = (int)(Info.pbOutBuff - (unsigned char *)pvOutBuffer);
-    STORM_FREE(work_buf);
+    *pcbOutBuffer = (int)cbOutBuffer;
     return 1;
 }
 
@@ -26,6 +26,18 @@
 
 #define MPQ_DIGEST_UNIT_SIZE      0x10000
 
+#define VERIFY_PENDING         0xFFFFFFFF   // The file has not been verified yet
+#define VERIFY_BATCH_SIZE            0x10   // Number of neighbouring files taken by a verify worker at once
+
+#ifdef PLATFORM_WINDOWS
+typedef HANDLE VERIFY_THREAD;
+#define VerifyAtomicAdd(pValue, dwAdd)  (DWORD)InterlockedExchangeAdd((volatile LONG *)(pValue), (LONG)(dwAdd))
+#else
+#include <pthread.h>
+typedef pthread_t VERIFY_THREAD;
+#define VerifyAtomicAdd(pValue, dwAdd)  __sync_fetch_and_add((pValue), (dwAdd))
+#endif
+
 typedef struct _MPQ_SIGNATURE_INFO
 {
     ULONGLONG BeginMpqData;                 // File offset where the hashing starts
@@ -39,6 +51,27 @@ typedef struct _MPQ_SIGNATURE_INFO
 
 } MPQ_SIGNATURE_INFO, *PMPQ_SIGNATURE_INFO;
 
+// Shared state of SFileVerifyArchiveFiles
+typedef struct _MPQ_VERIFY_CONTEXT
+{
+    TMPQArchive * ha;                       // The archive being verified. Its file table is not modified during verification
+    PSFILE_VERIFY_REPORT pReport;           // The report being filled, entries are sorted by file offset
+    DWORD dwStreamFlags;                    // Stream flags for opening the archive by the workers
+    DWORD dwFlags;                          // See SFILE_VERIFY_XXX
+    volatile DWORD dwNextEntry;             // Index of the next report entry to be taken by a worker
+
+} MPQ_VERIFY_CONTEXT, *PMPQ_VERIFY_CONTEXT;
+
+// Data of one verify worker thread
+typedef struct _MPQ_VERIFY_WORKER
+{
+    PMPQ_VERIFY_CONTEXT pContext;           // Shared verification state
+    VERIFY_THREAD hThread;                  // Handle of the worker thread
+    ULONGLONG BytesVerified;                // Number of file bytes verified by this worker
+    bool bThreadStarted;                    // If true, hThread is valid and must be joined
+
+} MPQ_VERIFY_WORKER, *PMPQ_VERIFY_WORKER;
+
 //-----------------------------------------------------------------------------
 // Known Blizzard public keys
 // Created by Jean-Francois Roy using OpenSSL
@@ -789,6 +822,316 @@ static DWORD VerifyFile(
     return dwVerifyResult;
 }
 
+//-----------------------------------------------------------------------------
+// Verification of all files in the archive
+
+// Opens a file from the given file entry. Unlike SFileOpenFileEx, this doesn't
+// search the hash table and doesn't modify the file table of the archive
+static TMPQFile * OpenFileEntry(
+    TMPQArchive * ha,
+    TFileEntry * pFileEntry,
+    const char * szFileName)
+{
+    TMPQFile * hf;
+
+    hf = CreateMpqFile(ha);
+    if(hf != NULL)
+    {
+        hf->pFileEntry = pFileEntry;
+        hf->MpqFilePos = pFileEntry->ByteOffset;
+        hf->RawFilePos = ha->MpqPos + hf->MpqFilePos;
+        hf->dwDataSize = pFileEntry->dwFileSize;
+
+        // Encrypted files need the file name for the decryption key.
+        // If we don't know it, SFileReadFile detects the key from the file content
+        if(szFileName != NULL && (pFileEntry->dwFlags & MPQ_FILE_ENCRYPTED))
+        {
+            hf->dwFileKey = DecryptFileKey(szFileName,
+                                           pFileEntry->ByteOffset,
+                                           pFileEntry->dwFileSize,
+                                           pFileEntry->dwFlags);
+        }
+
+        // Patch files have the patch info before the sector offset table
+        if(pFileEntry->dwFlags & MPQ_FILE_PATCH_FILE)
+        {
+            if(AllocatePatchInfo(hf, true) != ERROR_SUCCESS)
+                FreeMPQFile(hf);
+        }
+    }
+
+    return hf;
+}
+
+// Verifies one file. The file data are read from pFileEntry of the "ha" archive,
+// the expected checksums and the file name are taken from pExpected.
+static DWORD VerifyFileEntry(
+    TMPQArchive * ha,
+    TFileEntry * pFileEntry,
+    TFileEntry * pExpected,
+    DWORD dwFlags,
+    LPBYTE pbBuffer,
+    DWORD cbBuffer,
+    ULONGLONG * pBytesVerified)
+{
+    hash_state md5_state;
+    unsigned char * pFileMd5 = pExpected->md5;
+    unsigned char md5[MD5_DIGEST_SIZE];
+    TMPQFile * hf = NULL;
+    DWORD dwVerifyResult = 0;
+    DWORD dwTotalBytes = pFileEntry->dwFileSize;
+    DWORD dwBytesRead;
+    DWORD dwCrc32;
+
+    // If the archive supports raw data MD5, check it before anything else
+    if((dwFlags & SFILE_VERIFY_RAW_MD5) && ha->pHeader->dwRawChunkSize != 0)
+    {
+        dwVerifyResult |= VERIFY_FILE_HAS_RAW_MD5;
+        if(VerifyRawMpqData(ha, pFileEntry->ByteOffset, pFileEntry->dwCmpSize) != ERROR_SUCCESS)
+            return dwVerifyResult | VERIFY_FILE_RAW_MD5_ERROR;
+    }
+
+    // Initialize the CRC32 and MD5 contexts
+    md5_init(&md5_state);
+    dwCrc32 = crc32(0, Z_NULL, 0);
+
+    // Files that are neither compressed nor encrypted are stored as they are.
+    // Pass them through the checksums directly from the archive stream
+    if((pFileEntry->dwFlags & (MPQ_FILE_COMPRESSED | MPQ_FILE_ENCRYPTED | MPQ_FILE_PATCH_FILE)) == 0)
+    {
+        ULONGLONG RawFilePos = ha->MpqPos + pFileEntry->ByteOffset;
+
+        while(dwTotalBytes != 0)
+        {
+            dwBytesRead = STORMLIB_MIN(dwTotalBytes, cbBuffer);
+            if(!FileStream_Read(ha->pStream, &RawFilePos, pbBuffer, dwBytesRead))
+                break;
+
+            if(dwFlags & SFILE_VERIFY_FILE_CRC)
+                dwCrc32 = crc32(dwCrc32, pbBuffer, dwBytesRead);
+            if(dwFlags & SFILE_VERIFY_FILE_MD5)
+                md5_process(&md5_state, pbBuffer, dwBytesRead);
+
+            RawFilePos += dwBytesRead;
+            dwTotalBytes -= dwBytesRead;
+        }
+    }
+    else
+    {
+        // Open the file from its file entry
+        hf = OpenFileEntry(ha, pFileEntry, pExpected->szFileName);
+        if(hf == NULL)
+            return dwVerifyResult | VERIFY_OPEN_ERROR;
+        dwTotalBytes = SFileGetFileSize(hf, NULL);
+
+        // Also turn on sector checksum verification
+        if(dwFlags & SFILE_VERIFY_SECTOR_CRC)
+            hf->bCheckSectorCRCs = true;
+
+        // The buffer holds whole sectors, so the data
+        // are decompressed directly into it
+        for(;;)
+        {
+            SFileReadFile(hf, pbBuffer, cbBuffer, &dwBytesRead, NULL);
+            if(dwBytesRead == 0)
+            {
+                if(GetLastError() == ERROR_CHECKSUM_ERROR)
+                    dwVerifyResult |= VERIFY_FILE_SECTOR_CRC_ERROR;
+                break;
+            }
+
+            if(dwFlags & SFILE_VERIFY_FILE_CRC)
+                dwCrc32 = crc32(dwCrc32, pbBuffer, dwBytesRead);
+            if(dwFlags & SFILE_VERIFY_FILE_MD5)
+                md5_process(&md5_state, pbBuffer, dwBytesRead);
+
+            dwTotalBytes -= dwBytesRead;
+        }
+
+        // If the file has sector checksums, indicate it in the flags
+        if(dwFlags & SFILE_VERIFY_SECTOR_CRC)
+        {
+            if((pFileEntry->dwFlags & MPQ_FILE_SECTOR_CRC) && hf->SectorChksums != NULL && hf->SectorChksums[0] != 0)
+                dwVerifyResult |= VERIFY_FILE_HAS_SECTOR_CRC;
+        }
+
+        // Patch files have their MD5 saved in the patch info
+        if(hf->pPatchInfo != NULL)
+            pFileMd5 = hf->pPatchInfo->md5;
+    }
+
+    // No point in checking CRC32 and MD5 if not all data have been read
+    if(dwTotalBytes == 0)
+    {
+        // Only check the CRC32 if it is valid
+        if((dwFlags & SFILE_VERIFY_FILE_CRC) && pExpected->dwCrc32 != 0)
+        {
+            dwVerifyResult |= VERIFY_FILE_HAS_CHECKSUM;
+            if(dwCrc32 != pExpected->dwCrc32)
+                dwVerifyResult |= VERIFY_FILE_CHECKSUM_ERROR;
+        }
+
+        // Only check the MD5 if it is valid
+        if(dwFlags & SFILE_VERIFY_FILE_MD5)
+        {
+            md5_done(&md5_state, md5);
+            if(is_valid_md5(pFileMd5))
+            {
+                dwVerifyResult |= VERIFY_FILE_HAS_MD5;
+                if(memcmp(md5, pFileMd5, MD5_DIGEST_SIZE))
+                    dwVerifyResult |= VERIFY_FILE_MD5_ERROR;
+            }
+        }
+    }
+    else
+    {
+        dwVerifyResult |= VERIFY_READ_ERROR;
+    }
+
+    // Give the number of verified bytes
+    *pBytesVerified += (pFileEntry->dwFileSize - dwTotalBytes);
+
+    if(hf != NULL)
+        FreeMPQFile(hf);
+    return dwVerifyResult;
+}
+
+static int CompareVerifyEntries(const void * pvEntry1, const void * pvEntry2)
+{
+    PSFILE_VERIFY_ENTRY pEntry1 = (PSFILE_VERIFY_ENTRY)pvEntry1;
+    PSFILE_VERIFY_ENTRY pEntry2 = (PSFILE_VERIFY_ENTRY)pvEntry2;
+
+    if(pEntry1->ByteOffset != pEntry2->ByteOffset)
+        return (pEntry1->ByteOffset < pEntry2->ByteOffset) ? -1 : +1;
+    return (int)pEntry1->dwFileIndex - (int)pEntry2->dwFileIndex;
+}
+
+// Size of the buffer for reading file data. Rounded up to the sector size,
+// so that SFileReadFile can always decompress whole sectors into it.
+static DWORD GetVerifyBufferSize(TMPQArchive * ha)
+{
+    DWORD dwSectorSize = (ha->dwSectorSize != 0) ? ha->dwSectorSize : MPQ_DIGEST_UNIT_SIZE;
+
+    return ((MPQ_DIGEST_UNIT_SIZE + dwSectorSize - 1) / dwSectorSize) * dwSectorSize;
+}
+
+// Verifies batches of neighbouring files until there are none left.
+// Files are read from "ha", which is either the verified archive or its worker copy
+static void VerifyArchiveFileBatches(
+    PMPQ_VERIFY_CONTEXT pContext,
+    TMPQArchive * ha,
+    ULONGLONG * pBytesVerified)
+{
+    PSFILE_VERIFY_REPORT pReport = pContext->pReport;
+    PSFILE_VERIFY_ENTRY pEntry;
+    TFileEntry * pFileEntry;
+    TFileEntry * pExpected;
+    LPBYTE pbBuffer;
+    DWORD cbBuffer = GetVerifyBufferSize(ha);
+    DWORD dwFirstEntry;
+    DWORD dwLastEntry;
+
+    pbBuffer = STORM_ALLOC(BYTE, cbBuffer);
+    if(pbBuffer == NULL)
+        return;
+
+    for(;;)
+    {
+        // Take the next batch of files
+        dwFirstEntry = VerifyAtomicAdd(&pContext->dwNextEntry, VERIFY_BATCH_SIZE);
+        if(dwFirstEntry >= pReport->dwFileCount)
+            break;
+        dwLastEntry = STORMLIB_MIN(dwFirstEntry + VERIFY_BATCH_SIZE, pReport->dwFileCount);
+
+        for(DWORD i = dwFirstEntry; i < dwLastEntry; i++)
+        {
+            pEntry = pReport->Entries + i;
+            if(pEntry->dwVerifyResult != VERIFY_PENDING)
+                continue;
+
+            pFileEntry = ha->pFileTable + pEntry->dwFileIndex;
+            pExpected = pContext->ha->pFileTable + pEntry->dwFileIndex;
+
+            // If the worker's copy of the file table differs, leave the file for the final pass
+            if(pFileEntry->ByteOffset != pExpected->ByteOffset || pFileEntry->dwFlags != pExpected->dwFlags)
+                continue;
+
+            pEntry->dwVerifyResult = VerifyFileEntry(ha, pFileEntry, pExpected, pContext->dwFlags, pbBuffer, cbBuffer, pBytesVerified);
+        }
+    }
+
+    STORM_FREE(pbBuffer);
+}
+
+static void VerifyWorkerMain(PMPQ_VERIFY_WORKER pWorker)
+{
+    PMPQ_VERIFY_CONTEXT pContext = pWorker->pContext;
+    TMPQArchive * ha;
+    HANDLE hMpq = NULL;
+
+    // Each worker has its own archive handle, so it has its own stream
+    // and file table. The internal listfile is not needed, file names
+    // are taken from the file table of the verified archive.
+    if(SFileOpenArchive(FileStream_GetFileName(pContext->ha->pStream), 0, pContext->dwStreamFlags, &hMpq))
+    {
+        ha = (TMPQArchive *)hMpq;
+        if(ha->dwFileTableSize == pContext->ha->dwFileTableSize)
+            VerifyArchiveFileBatches(pContext, ha, &pWorker->BytesVerified);
+        SFileCloseArchive(hMpq, false);
+    }
+}
+
+#ifdef PLATFORM_WINDOWS
+static DWORD WINAPI VerifyThreadProc(LPVOID pvWorker)
+{
+    VerifyWorkerMain((PMPQ_VERIFY_WORKER)pvWorker);
+    return 0;
+}
+
+static bool StartVerifyThread(PMPQ_VERIFY_WORKER pWorker)
+{
+    pWorker->hThread = CreateThread(NULL, 0, VerifyThreadProc, pWorker, 0, NULL);
+    return (pWorker->hThread != NULL);
+}
+
+static void JoinVerifyThread(PMPQ_VERIFY_WORKER pWorker)
+{
+    WaitForSingleObject(pWorker->hThread, INFINITE);
+    CloseHandle(pWorker->hThread);
+}
+
+static DWORD GetVerifyCpuCount()
+{
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+}
+#else
+static void * VerifyThreadProc(void * pvWorker)
+{
+    VerifyWorkerMain((PMPQ_VERIFY_WORKER)pvWorker);
+    return NULL;
+}
+
+static bool StartVerifyThread(PMPQ_VERIFY_WORKER pWorker)
+{
+    return (pthread_create(&pWorker->hThread, NULL, VerifyThreadProc, pWorker) == 0);
+}
+
+static void JoinVerifyThread(PMPQ_VERIFY_WORKER pWorker)
+{
+    pthread_join(pWorker->hThread, NULL);
+}
+
+static DWORD GetVerifyCpuCount()
+{
+    long nCpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (nCpuCount > 0) ? (DWORD)nCpuCount : 1;
+}
+#endif
+
 //-----------------------------------------------------------------------------
 // Public (exported) functions
 
@@ -931,3 +1274,142 @@ DWORD WINAPI SFileVerifyArchive(HANDLE hMpq)
 
     return ERROR_VERIFY_FAILED;
 }
+
+// Verifies all files in the archive against their checksums, using multiple threads.
+// Files are verified in the order of their data offset.
+bool WINAPI SFileVerifyArchiveFiles(HANDLE hMpq, DWORD dwFlags, DWORD dwThreadCount, PSFILE_VERIFY_REPORT * ppReport)
+{
+    MPQ_VERIFY_CONTEXT Context;
+    PMPQ_VERIFY_WORKER pWorkers = NULL;
+    PSFILE_VERIFY_REPORT pReport;
+    PSFILE_VERIFY_ENTRY pEntry;
+    TMPQArchive * ha = (TMPQArchive *)hMpq;
+    TFileEntry * pFileEntryEnd;
+    TFileEntry * pFileEntry;
+    ULONGLONG BytesVerified = 0;
+    DWORD dwStreamFlags = 0;
+    DWORD dwBatchCount;
+    DWORD dwFileCount = 0;
+
+    // Verify input parameters
+    if(!IsValidMpqHandle(ha) || ppReport == NULL)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+    *ppReport = NULL;
+
+    // Count the files that are to be verified
+    pFileEntryEnd = ha->pFileTable + ha->dwFileTableSize;
+    for(pFileEntry = ha->pFileTable; pFileEntry < pFileEntryEnd; pFileEntry++)
+    {
+        if((pFileEntry->dwFlags & (MPQ_FILE_EXISTS | MPQ_FILE_DELETE_MARKER)) == MPQ_FILE_EXISTS)
+            dwFileCount++;
+    }
+
+    // Allocate the report
+    pReport = (PSFILE_VERIFY_REPORT)STORM_ALLOC(BYTE, sizeof(SFILE_VERIFY_REPORT) + dwFileCount * sizeof(SFILE_VERIFY_ENTRY));
+    if(pReport == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return false;
+    }
+    memset(pReport, 0, sizeof(SFILE_VERIFY_REPORT));
+
+    // Fill the entries and sort them by the file data offset
+    pEntry = pReport->Entries;
+    for(pFileEntry = ha->pFileTable; pFileEntry < pFileEntryEnd; pFileEntry++)
+    {
+        if((pFileEntry->dwFlags & (MPQ_FILE_EXISTS | MPQ_FILE_DELETE_MARKER)) == MPQ_FILE_EXISTS)
+        {
+            pEntry->ByteOffset = pFileEntry->ByteOffset;
+            pEntry->dwFileIndex = (DWORD)(pFileEntry - ha->pFileTable);
+            pEntry->dwVerifyResult = VERIFY_PENDING;
+            pEntry++;
+        }
+    }
+    pReport->dwFileCount = dwFileCount;
+    qsort(pReport->Entries, dwFileCount, sizeof(SFILE_VERIFY_ENTRY), CompareVerifyEntries);
+
+    // Prepare the shared context
+    FileStream_GetFlags(ha->pStream, &dwStreamFlags);
+    memset(&Context, 0, sizeof(MPQ_VERIFY_CONTEXT));
+    Context.ha = ha;
+    Context.pReport = pReport;
+    Context.dwStreamFlags = (dwStreamFlags & STREAM_OPTIONS_MASK) | STREAM_FLAG_READ_ONLY | MPQ_OPEN_NO_LISTFILE | MPQ_OPEN_NO_ATTRIBUTES;
+    Context.dwFlags = dwFlags;
+
+    // Decide the number of worker threads. Modified archives can't be reopened
+    // by the workers, because their file tables are not saved yet
+    dwBatchCount = (dwFileCount + VERIFY_BATCH_SIZE - 1) / VERIFY_BATCH_SIZE;
+    if(dwThreadCount == SFILE_VERIFY_THREADS_DEFAULT)
+        dwThreadCount = GetVerifyCpuCount();
+    dwThreadCount = STORMLIB_MIN(dwThreadCount, SFILE_VERIFY_THREADS_MAX);
+    dwThreadCount = STORMLIB_MIN(dwThreadCount, dwBatchCount);
+    if(ha->dwFlags & (MPQ_FLAG_CHANGED | MPQ_FLAG_INV_LISTFILE | MPQ_FLAG_INV_ATTRIBUTES))
+        dwThreadCount = 0;
+
+    // Start the workers
+    if(dwThreadCount > 1)
+    {
+        pWorkers = STORM_ALLOC(MPQ_VERIFY_WORKER, dwThreadCount);
+        if(pWorkers != NULL)
+        {
+            memset(pWorkers, 0, dwThreadCount * sizeof(MPQ_VERIFY_WORKER));
+            for(DWORD i = 0; i < dwThreadCount; i++)
+            {
+                pWorkers[i].pContext = &Context;
+                pWorkers[i].bThreadStarted = StartVerifyThread(&pWorkers[i]);
+                if(pWorkers[i].bThreadStarted)
+                    pReport->dwThreadCount++;
+            }
+
+            // Wait for all workers to complete
+            for(DWORD i = 0; i < dwThreadCount; i++)
+            {
+                if(pWorkers[i].bThreadStarted)
+                {
+                    JoinVerifyThread(&pWorkers[i]);
+                    BytesVerified += pWorkers[i].BytesVerified;
+                }
+            }
+
+            STORM_FREE(pWorkers);
+        }
+    }
+
+    // Verify whatever the workers have not done, using the caller's archive handle.
+    // If there were no workers, this verifies all files on the current thread.
+    pEntry = pReport->Entries;
+    for(DWORD i = 0; i < dwFileCount; i++, pEntry++)
+    {
+        if(pEntry->dwVerifyResult == VERIFY_PENDING)
+        {
+            Context.dwNextEntry = i;
+            VerifyArchiveFileBatches(&Context, ha, &BytesVerified);
+            break;
+        }
+    }
+    if(pReport->dwThreadCount == 0)
+        pReport->dwThreadCount = 1;
+
+    // Sum up the results
+    pEntry = pReport->Entries;
+    for(DWORD i = 0; i < dwFileCount; i++, pEntry++)
+    {
+        if(pEntry->dwVerifyResult == VERIFY_PENDING)
+            pEntry->dwVerifyResult = VERIFY_READ_ERROR;
+        if(pEntry->dwVerifyResult & VERIFY_FILE_ERROR_MASK)
+            pReport->dwErrorCount++;
+    }
+
+    pReport->BytesVerified = BytesVerified;
+    *ppReport = pReport;
+    return true;
+}
+
+void WINAPI SFileFreeVerifyReport(PSFILE_VERIFY_REPORT pReport)
+{
+    if(pReport != NULL)
+        STORM_FREE(pReport);
+}
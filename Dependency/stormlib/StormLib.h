@@ -246,6 +246,7 @@ extern "C" {
 #define STREAM_PROVIDER_LINEAR      0x00000000  // Stream is linear with no offset mapping
 #define STREAM_PROVIDER_PARTIAL     0x00000010  // Stream is partial file (.part)
 #define STREAM_PROVIDER_ENCRYPTED   0x00000020  // Stream is an encrypted MPQ
+#define STREAM_PROVIDER_SPARSE      0x00000030  // Stream is a sparse local file, missing blocks are fetched from the source
 #define STREAM_PROVIDER_MASK        0x000000F0  // Mask for stream provider value
 
 #define STREAM_FLAG_READ_ONLY       0x00000100  // Stream is read only
@@ -308,6 +309,10 @@ extern "C" {
 #define ERROR_WEAK_SIGNATURE_ERROR           3  // There is a weak signature but sign check failed
 #define ERROR_STRONG_SIGNATURE_OK            4  // There is a strong signature and sign check passed
 #define ERROR_STRONG_SIGNATURE_ERROR         5  // There is a strong signature but sign check failed
+
+// Values for SFileVerifyArchiveFiles
+#define SFILE_VERIFY_THREADS_DEFAULT         0  // Use one worker thread per CPU
+#define SFILE_VERIFY_THREADS_MAX            64  // Maximum number of worker threads
                                            
 #ifndef MD5_DIGEST_SIZE
 #define MD5_DIGEST_SIZE                   0x10
@@ -333,6 +338,7 @@ extern "C" {
                                       
 typedef void (WINAPI * SFILE_ADDFILE_CALLBACK)(void * pvUserData, DWORD dwBytesWritten, DWORD dwTotalBytes, bool bFinalCall);
 typedef void (WINAPI * SFILE_COMPACT_CALLBACK)(void * pvUserData, DWORD dwWorkType, ULONGLONG BytesProcessed, ULONGLONG TotalBytes);
+typedef bool (WINAPI * SFILE_FETCH_CALLBACK)(void * pvUserData, ULONGLONG ByteOffset, void * pvBuffer, DWORD dwBytesToFetch);
 
 typedef struct TFileStream TFileStream;
 
@@ -361,6 +367,19 @@ typedef struct _TFileBitmap
     // Followed by file bitmap (variable length), array of BYTEs)
 } TFileBitmap;
 
+// Structure for read statistics of a file stream. Used by FileStream_GetStats
+typedef struct _TFileStreamStats
+{
+    ULONGLONG ReadRequests;                     // Number of read requests passed to the base provider
+    ULONGLONG ReadCalls;                        // Number of read operations done on the underlying file
+    ULONGLONG BytesRequested;                   // Number of bytes requested by the read requests
+    ULONGLONG BytesRead;                        // Number of bytes read from the underlying file, including readahead
+    ULONGLONG CacheHits;                        // Number of read requests served entirely from the readahead cache
+    ULONGLONG SequentialReads;                  // Number of read requests detected as (near-)sequential
+    ULONGLONG FetchRequests;                    // Number of block fetches done by a sparse stream
+    ULONGLONG BytesFetched;                     // Number of bytes fetched from the source by a sparse stream
+} TFileStreamStats;
+
 //-----------------------------------------------------------------------------
 // Structures related to MPQ format
 //
@@ -774,6 +793,25 @@ typedef struct _SFILE_CREATE_MPQ
 
 } SFILE_CREATE_MPQ, *PSFILE_CREATE_MPQ;
 
+// Result of verification of one file. Used by SFileVerifyArchiveFiles
+typedef struct _SFILE_VERIFY_ENTRY
+{
+    ULONGLONG ByteOffset;               // Position of the file data in the MPQ, relative to the MPQ header
+    DWORD dwFileIndex;                  // Index of the file in the file table
+    DWORD dwVerifyResult;               // Combination of VERIFY_XXX flags (same as from SFileVerifyFile)
+} SFILE_VERIFY_ENTRY, *PSFILE_VERIFY_ENTRY;
+
+// Report returned by SFileVerifyArchiveFiles. Free it with SFileFreeVerifyReport
+typedef struct _SFILE_VERIFY_REPORT
+{
+    DWORD dwFileCount;                  // Number of entries in the Entries array
+    DWORD dwErrorCount;                 // Number of files with any of VERIFY_FILE_ERROR_MASK set
+    DWORD dwThreadCount;                // Number of worker threads that have been used
+    DWORD Reserved;                     // Alignment
+    ULONGLONG BytesVerified;            // Total number of file bytes passed through the checksums
+    SFILE_VERIFY_ENTRY Entries[1];      // Per-file results, sorted by file data offset (variable length)
+} SFILE_VERIFY_REPORT, *PSFILE_VERIFY_REPORT;
+
 //-----------------------------------------------------------------------------
 // Stream support - functions
 
@@ -792,6 +830,9 @@ bool FileStream_GetFlags(TFileStream * pStream, LPDWORD pdwStreamFlags);
 bool FileStream_Switch(TFileStream * pStream, TFileStream * pTempStream);
 bool FileStream_SetBitmap(TFileStream * pStream, TFileBitmap * pBitmap);
 bool FileStream_GetBitmap(TFileStream * pStream, TFileBitmap * pBitmap, DWORD Length, LPDWORD LengthNeeded);
+bool FileStream_GetStats(TFileStream * pStream, TFileStreamStats * pStats);
+bool FileStream_CreateSparse(const TCHAR * szFileName, const TCHAR * szSourceName, ULONGLONG SourceSize, DWORD dwBlockSize);
+bool FileStream_SetFetchCallback(TFileStream * pStream, SFILE_FETCH_CALLBACK FetchCB, void * pvUserData);
 void FileStream_Close(TFileStream * pStream);
 
 //-----------------------------------------------------------------------------
@@ -883,6 +924,10 @@ int    WINAPI SFileVerifyRawData(HANDLE hMpq, DWORD dwWhatToVerify, const char *
 // Verifies the signature, if present
 DWORD  WINAPI SFileVerifyArchive(HANDLE hMpq);
 
+// Verifies all files in the archive on multiple threads. See SFILE_VERIFY_XXX for dwFlags
+bool   WINAPI SFileVerifyArchiveFiles(HANDLE hMpq, DWORD dwFlags, DWORD dwThreadCount, PSFILE_VERIFY_REPORT * ppReport);
+void   WINAPI SFileFreeVerifyReport(PSFILE_VERIFY_REPORT pReport);
+
 //-----------------------------------------------------------------------------
 // Functions for file searching
 
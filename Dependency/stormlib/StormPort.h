@@ -154,7 +154,9 @@
   #define _tcslen   strlen
   #define _tcscpy   strcpy
   #define _tcscat   strcat
+  #define _tcschr   strchr
   #define _tcsrchr  strrchr
+  #define _tcstoul  strtoul
   #define _tprintf  printf
   #define _stprintf sprintf
   #define _tremove  remove
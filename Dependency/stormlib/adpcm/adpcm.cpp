@@ -343,8 +343,10 @@ int DecompressADPCM(void * pvOutBuffer, int cbOutBuffer, void * pvInBuffer, int
     {
 //      _tprintf(_T("DCMP: Loaded Encoded Sample: %02X\n"), (unsigned int)(unsigned char)EncodedSample);
 
-        // If we have two channels, we need to flip the channel index
-        ChannelIndex = (ChannelIndex + 1) % ChannelCount;
+        // If we have two channels, we need to flip the channel index.
+        // Note: This is done for every sample, so avoid the division
+        if(++ChannelIndex >= ChannelCount)
+            ChannelIndex = 0;
 
         if(EncodedSample == 0x80)
         {
@@ -365,7 +367,8 @@ int DecompressADPCM(void * pvOutBuffer, int cbOutBuffer, void * pvInBuffer, int
 //          _tprintf(_T("DCMP: New value of StepIndex: %04lX\n"), (unsigned int)(unsigned short)StepIndexes[ChannelIndex]);
 
             // Next pass, keep going on the same channel
-            ChannelIndex = (ChannelIndex + 1) % ChannelCount;
+            if(++ChannelIndex >= ChannelCount)
+                ChannelIndex = 0;
         }
         else
         {
@@ -270,19 +270,25 @@ TInputStream::TInputStream(void * pvInBuffer, size_t cbInBuffer)
     BitCount = 0;
 }
 
+// Reloads the bit buffer with whole bytes from the input buffer, as long as
+// they fit into it. This way we only touch the input buffer once per 3-4 bytes
+// instead of once per byte. Never reads beyond the end of the input buffer.
+void TInputStream::ReloadBits()
+{
+    while(BitCount <= 24 && pbInBuffer < pbInBufferEnd)
+    {
+        BitBuffer |= (unsigned int)(*pbInBuffer++) << BitCount;
+        BitCount += 8;
+    }
+}
+
 // Gets 7 bits from the stream. DOES NOT remove the bits from input stream
 unsigned int TInputStream::Peek7Bits()
 {
-    unsigned int dwReloadByte = 0;
-
     // If there is not enough bits to get the value,
-    // we have to add 8 more bits from the input buffer
+    // we have to reload the bit buffer from the input buffer
     if(BitCount < 7)
-    {
-        dwReloadByte = *pbInBuffer++;
-        BitBuffer |= dwReloadByte << BitCount;
-        BitCount += 8;
-    }
+        ReloadBits();
 
     // Return the first available 7 bits. DO NOT remove them from the input stream
     return (BitBuffer & 0x7F);
@@ -296,9 +302,9 @@ unsigned int TInputStream::Get1Bit()
     // Ensure that the input stream is reloaded, if there are no bits left
     if(BitCount == 0)
     {
-        // Refill the bit buffer
-        BitBuffer = *pbInBuffer++;
-        BitCount = 8;
+        ReloadBits();
+        if(BitCount == 0)
+            return 0;
     }
 
     // Copy the bit from bit buffer to the variable
@@ -312,41 +318,30 @@ unsigned int TInputStream::Get1Bit()
 // Gets the whole byte from the input stream.
 unsigned int TInputStream::Get8Bits()
 {
-    unsigned int dwReloadByte = 0;
     unsigned int dwOneByte = 0;
 
     // If there is not enough bits to get the value,
-    // we have to add 8 more bits from the input buffer
+    // we have to reload the bit buffer from the input buffer
     if(BitCount < 8)
-    {
-        dwReloadByte = *pbInBuffer++;
-        BitBuffer |= dwReloadByte << BitCount;
-        BitCount += 8;
-    }
+        ReloadBits();
 
     // Return the lowest 8 its
     dwOneByte = (BitBuffer & 0xFF);
     BitBuffer >>= 8;
-    BitCount -= 8;
+    BitCount = (BitCount > 8) ? (BitCount - 8) : 0;
     return dwOneByte;
 }
 
 void TInputStream::SkipBits(unsigned int dwBitsToSkip)
 {
-    unsigned int dwReloadByte = 0;
-
     // If there is not enough bits in the buffer,
-    // we have to add 8 more bits from the input buffer
+    // we have to reload the bit buffer from the input buffer
     if(BitCount < dwBitsToSkip)
-    {
-        dwReloadByte = *pbInBuffer++;
-        BitBuffer |= dwReloadByte << BitCount;
-        BitCount += 8;
-    }
+        ReloadBits();
 
     // Skip the remaining bits
     BitBuffer >>= dwBitsToSkip;
-    BitCount -= dwBitsToSkip;
+    BitCount = (BitCount > dwBitsToSkip) ? (BitCount - dwBitsToSkip) : 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -647,6 +642,9 @@ void THuffmannTree::InsertNewBranchAndRebalance(unsigned int Value1, unsigned in
     pLastItem->pChildLo = pChildLo;
     ItemsByByte[Value2] = pChildLo;
 
+    // The last item is no longer a leaf. Invalidate all quick-link items.
+    MinValidValue++;
+
     IncWeightsAndRebalance(pChildLo);
 }
 
@@ -686,8 +684,9 @@ unsigned int THuffmannTree::DecodeOneByte(TInputStream * is)
     // Get the eventual quick-link index
     ItemLinkIndex = is->Peek7Bits();
     
-    // Is the quick-link item valid?
-    if(QuickLinks[ItemLinkIndex].ValidValue > MinValidValue)
+    // Is the quick-link item valid? Items stored since the last tree change
+    // have ValidValue equal to MinValidValue, older items have it lower
+    if(QuickLinks[ItemLinkIndex].ValidValue >= MinValidValue)
     {
         // If that item needs less than 7 bits, we can get decompressed value directly
         if(QuickLinks[ItemLinkIndex].ValidBits <= 7)
@@ -830,6 +829,10 @@ unsigned int THuffmannTree::Decompress(void * pvOutBuffer, unsigned int cbOutLen
     // Get the compression type from the input stream
     CompressionType = is->Get8Bits();
     bIsCmp0 = (CompressionType == 0) ? 1 : 0;
+
+    // Corrupt data may contain compression type that we don't have weights for
+    if((CompressionType & 0x0F) > 0x08)
+        return 0;
  
     // Build the Huffman tree
     BuildTree(CompressionType);    
@@ -847,6 +850,10 @@ unsigned int THuffmannTree::Decompress(void * pvOutBuffer, unsigned int cbOutLen
             // The decompressed byte is stored in the next 8 bits
             DecompressedValue = is->Get8Bits();
 
+            // Corrupt data could make us run out of the item pool
+            if((ItemsUsed + 2) > HUFF_ITEM_COUNT)
+                return 0;
+
             InsertNewBranchAndRebalance(pLast->DecompressedValue, DecompressedValue);
 
             if(bIsCmp0 == 0)
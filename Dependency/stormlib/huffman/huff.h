@@ -32,6 +32,7 @@ class TInputStream
     unsigned int Peek7Bits();
     unsigned int Get8Bits();
     void SkipBits(unsigned int BitCount);
+    void ReloadBits();
  
     unsigned char * pbInBufferEnd;      // End position in the the input buffer
     unsigned char * pbInBuffer;         // Current position in the the input buffer
@@ -88,7 +89,7 @@ struct THTreeItem
 // byte directly.
 struct TQuickLink
 {      
-    unsigned int ValidValue;            // If greater than THuffmannTree::MinValidValue, the entry is valid
+    unsigned int ValidValue;            // If greater or equal to THuffmannTree::MinValidValue, the entry is valid
     unsigned int ValidBits;             // Number of bits that are valid for this item link
     union
     {
@@ -241,6 +241,10 @@ static int WasteBits(TDcmpStruct * pWork, unsigned int nBits)
     pWork->bit_buff >>= pWork->extra_bits;
     if(pWork->in_pos == pWork->in_bytes)
     {
+        // When decompressing from a memory buffer, there is nothing more to load
+        if(pWork->read_buf == NULL)
+            return PKDCL_STREAM_END;
+
         pWork->in_pos = sizeof(pWork->in_buff);
         if((pWork->in_bytes = pWork->read_buf((char *)pWork->in_buff, &pWork->in_pos, pWork->param)) == 0)
             return PKDCL_STREAM_END;
@@ -248,7 +252,7 @@ static int WasteBits(TDcmpStruct * pWork, unsigned int nBits)
     }
 
     // Update bit buffer
-    pWork->bit_buff  |= (pWork->in_buff[pWork->in_pos++] << 8);
+    pWork->bit_buff  |= (pWork->in_data[pWork->in_pos++] << 8);
     pWork->bit_buff >>= (nBits - pWork->extra_bits);
     pWork->extra_bits = (pWork->extra_bits - nBits) + 8;
     return PKDCL_OK;
@@ -388,6 +392,31 @@ static unsigned int DecodeDist(TDcmpStruct * pWork, unsigned int rep_length)
     return distance + 1;
 }
 
+//-----------------------------------------------------------------------------
+// Copies the repeating sequence. Non-overlapping repetitions (the majority)
+// are copied as a block, a run of one byte is filled. When the repetition
+// overlaps the target, it must be copied byte-by-byte, because the copy
+// reads the bytes it has just written.
+
+static void CopyRepetition(unsigned char * target, unsigned int minus_dist, unsigned int rep_length)
+{
+    unsigned char * source = target - minus_dist;
+
+    if(minus_dist >= rep_length)
+    {
+        memcpy(target, source, rep_length);
+    }
+    else if(minus_dist == 1)
+    {
+        memset(target, *source, rep_length);
+    }
+    else
+    {
+        while(rep_length-- > 0)
+            *target++ = *source++;
+    }
+}
+
 static unsigned int Expand(TDcmpStruct * pWork)
 {
     unsigned int next_literal;         // Literal decoded from the compressed data
@@ -410,8 +439,6 @@ static unsigned int Expand(TDcmpStruct * pWork)
         // literal of 0x305 means repeating sequence of 0x207 bytes
         if(next_literal >= 0x100)
         {
-            unsigned char * source;
-            unsigned char * target;
             unsigned int rep_length;       // Length of the repetition, in bytes
             unsigned int minus_dist;       // Backward distance to the repetition, relative to the current buffer position
 
@@ -427,16 +454,9 @@ static unsigned int Expand(TDcmpStruct * pWork)
                 break;
             }
 
-            // Target and source pointer
-            target = &pWork->out_buff[pWork->outputPos];
-            source = target - minus_dist;
-
-            // Update buffer output position
+            // Copy the repeating sequence and update buffer output position
+            CopyRepetition(&pWork->out_buff[pWork->outputPos], minus_dist, rep_length);
             pWork->outputPos += rep_length;
-
-            // Copy the repeating sequence
-            while(rep_length-- > 0)
-                *target++ = *source++;
         }
         else
         {
@@ -466,31 +486,67 @@ static unsigned int Expand(TDcmpStruct * pWork)
     return result;
 }
 
-
 //-----------------------------------------------------------------------------
-// Main exploding function.
+// Same like Expand, but decompresses directly into the caller's buffer.
+// The already decompressed data serve as the dictionary, so there is no need
+// to keep them in the circle buffer and flush them through write_buf.
 
-unsigned int explode(
-        unsigned int (*read_buf)(char *buf, unsigned  int *size, void *param),
-        void         (*write_buf)(char *buf, unsigned  int *size, void *param),
-        char         *work_buf,
-        void         *param)
+static unsigned int ExpandBuffer(TDcmpStruct * pWork, unsigned char * out_buf, unsigned int * out_size)
 {
-    TDcmpStruct * pWork = (TDcmpStruct *)work_buf;
+    unsigned char * out_end = out_buf + *out_size;
+    unsigned char * target = out_buf;
+    unsigned int next_literal;         // Literal decoded from the compressed data
+    unsigned int result = 0;           // Value to be returned
 
-    // Initialize work struct and load compressed data
-    // Note: The caller must zero the "work_buff" before passing it to explode
-    pWork->read_buf   = read_buf;
-    pWork->write_buf  = write_buf;
-    pWork->param      = param;
-    pWork->in_pos     = sizeof(pWork->in_buff);
-    pWork->in_bytes   = pWork->read_buf((char *)pWork->in_buff, &pWork->in_pos, pWork->param);
-    if(pWork->in_bytes <= 4)
-        return CMP_BAD_DATA;
+    while(target < out_end && (result = next_literal = DecodeLit(pWork)) < 0x305)
+    {
+        if(next_literal >= 0x100)
+        {
+            unsigned int rep_length = next_literal - 0xFE;
+            unsigned int minus_dist;
+
+            // Get backward distance to the repetition
+            if((minus_dist = DecodeDist(pWork, rep_length)) == 0)
+            {
+                result = 0x306;
+                break;
+            }
+
+            // Never write beyond the end of the output buffer
+            if(rep_length > (unsigned int)(out_end - target))
+                rep_length = (unsigned int)(out_end - target);
+
+            // Corrupt data may refer before the begin of the output.
+            // Expand reads zeros from the zeroed out_buff there, so do we.
+            while(rep_length > 0 && minus_dist > (unsigned int)(target - out_buf))
+            {
+                *target++ = 0;
+                rep_length--;
+            }
+
+            CopyRepetition(target, minus_dist, rep_length);
+            target += rep_length;
+        }
+        else
+        {
+            *target++ = (unsigned char)next_literal;
+        }
+    }
+
+    // Give the number of decompressed bytes
+    *out_size = (unsigned int)(target - out_buf);
+    return (target < out_end) ? result : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Prepares the decompression tables. The caller must have loaded
+// the beginning of the compressed data into in_data
 
-    pWork->ctype      = pWork->in_buff[0]; // Get the compression type (CMP_BINARY or CMP_ASCII)
-    pWork->dsize_bits = pWork->in_buff[1]; // Get the dictionary size
-    pWork->bit_buff   = pWork->in_buff[2]; // Initialize 16-bit bit buffer
+static unsigned int InitDecompression(TDcmpStruct * pWork)
+{
+    pWork->ctype      = pWork->in_data[0]; // Get the compression type (CMP_BINARY or CMP_ASCII)
+    pWork->dsize_bits = pWork->in_data[1]; // Get the dictionary size
+    pWork->bit_buff   = pWork->in_data[2]; // Initialize 16-bit bit buffer
     pWork->extra_bits = 0;                 // Extra (over 8) bits
     pWork->in_pos     = 3;                 // Position in input buffer
 
@@ -515,8 +571,74 @@ unsigned int explode(
     memcpy(pWork->LenBase, LenBase, sizeof(pWork->LenBase));
     memcpy(pWork->DistBits, DistBits, sizeof(pWork->DistBits));
     GenDecodeTabs(pWork->DistPosCodes, DistCode, pWork->DistBits, sizeof(pWork->DistBits));
+    return CMP_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// Main exploding function.
+
+unsigned int explode(
+        unsigned int (*read_buf)(char *buf, unsigned  int *size, void *param),
+        void         (*write_buf)(char *buf, unsigned  int *size, void *param),
+        char         *work_buf,
+        void         *param)
+{
+    TDcmpStruct * pWork = (TDcmpStruct *)work_buf;
+    unsigned int nError;
+
+    // Initialize work struct and load compressed data
+    // Note: The caller must zero the "work_buff" before passing it to explode
+    pWork->read_buf   = read_buf;
+    pWork->write_buf  = write_buf;
+    pWork->param      = param;
+    pWork->in_data    = pWork->in_buff;
+    pWork->in_pos     = sizeof(pWork->in_buff);
+    pWork->in_bytes   = pWork->read_buf((char *)pWork->in_buff, &pWork->in_pos, pWork->param);
+    if(pWork->in_bytes <= 4)
+        return CMP_BAD_DATA;
+
+    if((nError = InitDecompression(pWork)) != CMP_NO_ERROR)
+        return nError;
+
     if(Expand(pWork) != 0x306)
         return CMP_NO_ERROR;
         
     return CMP_ABORT;
 }
+
+//-----------------------------------------------------------------------------
+// Exploding function working with memory buffers. On input, out_size holds
+// the size of the output buffer, on output the number of decompressed bytes.
+
+unsigned int explode_buffer(
+        char         *out_buf,
+        unsigned int *out_size,
+        char         *in_buf,
+        unsigned int  in_size,
+        char         *work_buf)
+{
+    TDcmpStruct * pWork = (TDcmpStruct *)work_buf;
+    unsigned int out_length = *out_size;
+    unsigned int nError;
+
+    // Initialize work struct. There are no callbacks,
+    // the compressed data are read directly from the caller's buffer
+    // Note: The caller must zero the "work_buff" before passing it to explode_buffer
+    *out_size = 0;
+    pWork->read_buf   = NULL;
+    pWork->write_buf  = NULL;
+    pWork->param      = NULL;
+    pWork->in_data    = (unsigned char *)in_buf;
+    pWork->in_bytes   = in_size;
+    if(pWork->in_bytes <= 4)
+        return CMP_BAD_DATA;
+
+    if((nError = InitDecompression(pWork)) != CMP_NO_ERROR)
+        return nError;
+
+    if(ExpandBuffer(pWork, (unsigned char *)out_buf, &out_length) == 0x306)
+        nError = CMP_ABORT;
+
+    *out_size = out_length;
+    return nError;
+}
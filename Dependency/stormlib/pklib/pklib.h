@@ -110,6 +110,7 @@ typedef struct
     unsigned char LenBits[0x10];            // 30F4: Numbers of bits for skip copied block length
     unsigned char ExLenBits[0x10];          // 3104: Number of valid bits for copied block
     unsigned short LenBase[0x10];           // 3114: Buffer for 
+    unsigned char * in_data;                // 3134: Data to be decompressed. Either in_buff or the caller's buffer
 } TDcmpStruct;
 
 #define EXP_BUFFER_SIZE sizeof(TDcmpStruct) // Size of decompression structure
@@ -137,6 +138,15 @@ unsigned int PKEXPORT explode(
    char         *work_buf,
    void         *param);
 
+// Decompresses data from one memory buffer directly into another one,
+// without the read_buf/write_buf callbacks and the intermediate buffers
+unsigned int PKEXPORT explode_buffer(
+   char         *out_buf,
+   unsigned int *out_size,
+   char         *in_buf,
+   unsigned int  in_size,
+   char         *work_buf);
+
 // The original name "crc32" was changed to "crc32pk" due
 // to compatibility with zlib
 unsigned long PKEXPORT crc32_pklib(char *buffer, unsigned int *size, unsigned long *old_crc);